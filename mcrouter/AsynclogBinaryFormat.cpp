@@ -0,0 +1,96 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "AsynclogBinaryFormat.h"
+
+#include <cstring>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+template <class T>
+void appendInt(T value, std::string& out) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendString(folly::StringPiece s, std::string& out) {
+  appendInt<uint32_t>(s.size(), out);
+  out.append(s.data(), s.size());
+}
+
+template <class T>
+bool readInt(folly::StringPiece& data, T& value) {
+  if (data.size() < sizeof(T)) {
+    return false;
+  }
+  memcpy(&value, data.data(), sizeof(T));
+  data.advance(sizeof(T));
+  return true;
+}
+
+bool readString(folly::StringPiece& data, folly::StringPiece& s) {
+  uint32_t len;
+  if (!readInt(data, len) || data.size() < len) {
+    return false;
+  }
+  s.assign(data.data(), data.data() + len);
+  data.advance(len);
+  return true;
+}
+
+} // anonymous namespace
+
+void asynclogSerializeBinaryEntry(const AsynclogBinaryEntry& entry,
+                                  std::string& out) {
+  appendInt(kAsynclogBinaryMagic, out);
+  const auto sizePos = out.size();
+  appendInt<uint32_t>(0, out);  // payload size, patched below
+  const auto payloadPos = out.size();
+
+  appendInt(entry.timestampMs, out);
+  appendInt(entry.port, out);
+  appendString(entry.flavor, out);
+  appendString(entry.host, out);
+  appendString(entry.pool, out);
+  appendString(entry.key, out);
+
+  const uint32_t payloadSize = out.size() - payloadPos;
+  memcpy(&out[sizePos], &payloadSize, sizeof(payloadSize));
+}
+
+AsynclogSpoolReader::AsynclogSpoolReader(const std::string& path)
+    : mapping_(path.c_str()),
+      data_(mapping_.data()) {
+}
+
+bool AsynclogSpoolReader::nextEntry(AsynclogBinaryEntry& entry) {
+  auto data = data_;
+  uint32_t magic;
+  uint32_t payloadSize;
+  if (!readInt(data, magic) || magic != kAsynclogBinaryMagic ||
+      !readInt(data, payloadSize) || data.size() < payloadSize) {
+    return false;
+  }
+
+  auto payload = data.subpiece(0, payloadSize);
+  if (!readInt(payload, entry.timestampMs) ||
+      !readInt(payload, entry.port) ||
+      !readString(payload, entry.flavor) ||
+      !readString(payload, entry.host) ||
+      !readString(payload, entry.pool) ||
+      !readString(payload, entry.key)) {
+    return false;
+  }
+
+  data_.advance(2 * sizeof(uint32_t) + payloadSize);
+  return true;
+}
+
+}}}  // facebook::memcache::mcrouter
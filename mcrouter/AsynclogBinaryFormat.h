@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <folly/MemoryMapping.h>
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Binary asynclog spool format (--use-asynclog-binary-format).
+ *
+ * The spool is a sequence of length-prefixed records in host byte order
+ * (a spool is always replayed on the host that wrote it):
+ *
+ *   uint32_t magic;        // kAsynclogBinaryMagic; embeds the version
+ *   uint32_t payloadSize;  // bytes following the header
+ *
+ * The payload carries the same fields as the AS2.0 text format,
+ * fixed-width integers first, then length-prefixed strings:
+ *
+ *   uint64_t timestampMs;  // wall clock, milliseconds since epoch
+ *   uint16_t port;
+ *   uint32_t len; char data[len];  // flavor, host, pool, key - in order
+ */
+constexpr uint32_t kAsynclogBinaryMagic = 0x31425341;  // "ASB1"
+
+struct AsynclogBinaryEntry {
+  uint64_t timestampMs{0};
+  uint16_t port{0};
+  folly::StringPiece flavor;
+  folly::StringPiece host;
+  folly::StringPiece pool;
+  folly::StringPiece key;
+};
+
+/**
+ * Appends one binary spool record for the given entry to 'out'.
+ */
+void asynclogSerializeBinaryEntry(const AsynclogBinaryEntry& entry,
+                                  std::string& out);
+
+/**
+ * Streams records out of a binary asynclog spool file via mmap, without
+ * copying: the StringPieces of each returned entry point into the
+ * mapping and remain valid for the reader's lifetime.
+ */
+class AsynclogSpoolReader {
+ public:
+  /**
+   * @throws std::runtime_error  if the file can't be opened or mapped
+   */
+  explicit AsynclogSpoolReader(const std::string& path);
+
+  /**
+   * Reads the next record into 'entry'.
+   *
+   * @return false on end of spool or on a corrupt record; a torn record
+   *         at the tail is expected after a crash and ends the stream.
+   */
+  bool nextEntry(AsynclogBinaryEntry& entry);
+
+ private:
+  folly::MemoryMapping mapping_;
+  folly::StringPiece data_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -7,15 +7,32 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <algorithm>
 #include <mutex>
-#include <set>
+#include <vector>
 
 #include <glog/logging.h>
 
-#include "mcrouter/lib/fbi/cpp/sfrlock.h"
-
 namespace facebook { namespace memcache { namespace mcrouter {
 
+/* CallbackPool::Data
+ *
+ * Subscribers live in an immutable snapshot vector.  notify() atomically
+ * loads the current snapshot and iterates it without any lock; subscribe
+ * and unsubscribe build a new vector under modifyLock and swap it in, so
+ * notification never blocks on subscription churn and vice versa.
+ */
+template<typename... Args>
+struct CallbackPool<Args...>::Data {
+  using Snapshot = std::vector<std::shared_ptr<const OnUpdateFunc>>;
+
+  // Serializes snapshot replacement; notify() doesn't take it.
+  std::mutex modifyLock;
+  std::shared_ptr<const Snapshot> snapshot;
+
+  Data() : snapshot(std::make_shared<Snapshot>()) {}
+};
+
 /* CallbackPool::CallbackHandle */
 template<typename... Args>
 struct CallbackPool<Args...>::CallbackHandleImpl {
@@ -23,30 +40,34 @@ struct CallbackPool<Args...>::CallbackHandleImpl {
   CallbackHandleImpl(const CallbackHandleImpl&) = delete;
   CallbackHandleImpl& operator=(const CallbackHandleImpl&) = delete;
   ~CallbackHandleImpl() {
-    std::lock_guard<SFRWriteLock> lck(data_->callbackLock.writeLock());
-    data_->callbacks.erase(this);
+    std::lock_guard<std::mutex> lck(data_->modifyLock);
+    auto next = std::make_shared<typename Data::Snapshot>(*data_->snapshot);
+    auto it = std::find(next->begin(), next->end(), func_);
+    if (it != next->end()) {
+      next->erase(it);
+    }
+    std::atomic_store(
+        &data_->snapshot,
+        std::shared_ptr<const typename Data::Snapshot>(std::move(next)));
   }
  private:
   friend class CallbackPool;
 
   std::shared_ptr<Data> data_;
-  const OnUpdateFunc func_;
+  const std::shared_ptr<const OnUpdateFunc> func_;
 
   CallbackHandleImpl(std::shared_ptr<Data> data, OnUpdateFunc func)
       : data_(std::move(data)),
-        func_(std::move(func)) {
-    std::lock_guard<SFRWriteLock> lck(data_->callbackLock.writeLock());
-    data_->callbacks.insert(this);
+        func_(std::make_shared<const OnUpdateFunc>(std::move(func))) {
+    std::lock_guard<std::mutex> lck(data_->modifyLock);
+    auto next = std::make_shared<typename Data::Snapshot>(*data_->snapshot);
+    next->push_back(func_);
+    std::atomic_store(
+        &data_->snapshot,
+        std::shared_ptr<const typename Data::Snapshot>(std::move(next)));
   }
 };
 
-/* CallbackPool::Data */
-template<typename... Args>
-struct CallbackPool<Args...>::Data {
-  std::set<CallbackHandleImpl*> callbacks;
-  SFRLock callbackLock;
-};
-
 /* CallbackPool */
 
 template<typename... Args>
@@ -56,10 +77,12 @@ CallbackPool<Args...>::CallbackPool()
 
 template<typename... Args>
 void CallbackPool<Args...>::notify(Args... args) {
-  std::lock_guard<SFRReadLock> lck(data_->callbackLock.readLock());
-  for (auto& it : data_->callbacks) {
+  // The snapshot keeps every callback it references alive, so a handle
+  // destroyed during this loop only unsubscribes from later notifies.
+  auto snapshot = std::atomic_load(&data_->snapshot);
+  for (const auto& func : *snapshot) {
     try {
-      it->func_(args...);
+      (*func)(args...);
     } catch (const std::exception& e) {
       LOG(ERROR) << "Error occured in callback: " << e.what();
     } catch (...) {
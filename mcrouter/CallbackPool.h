@@ -20,6 +20,14 @@ namespace facebook { namespace memcache { namespace mcrouter {
  * with 'notify', order of calls in undefined. Exceptions in callbacks are
  * caught and logged.
  *
+ * notify() iterates an immutable snapshot of the subscriber list, so it
+ * never blocks on (or is blocked by) concurrent subscribe/unsubscribe.
+ * As a consequence destroying a CallbackHandle is not a synchronization
+ * point: a notify() already in flight on another thread may invoke the
+ * callback one last time after the handle's destructor returns, and
+ * anything the callback captures must stay valid until such a notify
+ * completes.
+ *
  * @param Args arguments to pass to callbacks on 'notify'.
  *        NOTE: arguments would be copied for each callback. Use const reference
  *        or pointer type to avoid copy.
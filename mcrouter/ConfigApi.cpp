@@ -14,6 +14,7 @@
 #include <folly/dynamic.h>
 #include <folly/FileUtil.h>
 #include <folly/Memory.h>
+#include <folly/MemoryMapping.h>
 
 #include "mcrouter/config.h"
 #include "mcrouter/FileDataProvider.h"
@@ -76,8 +77,16 @@ bool ConfigApi::checkFileUpdate() {
     // hasUpdate reads events from inotify, so we need to poll all
     // providers to reconfigure only once when multiple files have changed
     try {
-      if (file.provider) {
-        hasUpdate |= file.provider->hasUpdate();
+      if (file.provider && file.provider->hasUpdate()) {
+        // inotify fires on touches and symlink shuffles that leave the
+        // bytes intact; verify the content actually changed before paying
+        // for a full reconfiguration.
+        try {
+          hasUpdate |= file.checkMd5Changed();
+        } catch (const std::exception&) {
+          // can't read the file (possibly mid-rewrite), assume it changed
+          hasUpdate = true;
+        }
       }
     } catch (const std::exception& e) {
       LOG(ERROR) << "Check " << file.path << " for update failed: "
@@ -149,11 +158,16 @@ void ConfigApi::configThreadRun() {
 
 bool ConfigApi::FileInfo::checkMd5Changed() {
   auto previousHash = md5;
-  std::string contents;
-  if (!folly::readFile(path.data(), contents)) {
-    throw std::runtime_error("Error reading from config file " + path);
+  try {
+    // hash the file in place instead of copying it into a string first
+    folly::MemoryMapping contents(path.data());
+    auto range = contents.range();
+    md5 = Md5Hash(folly::StringPiece(
+        reinterpret_cast<const char*>(range.begin()), range.size()));
+  } catch (const std::exception& e) {
+    throw std::runtime_error("Error reading from config file " + path +
+                             ": " + e.what());
   }
-  md5 = Md5Hash(contents);
   lastMd5Check = nowWallSec();
 
   return md5 != previousHash;
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ConfigCost.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/ProxyConfig.h"
+#include "mcrouter/ProxyDestination.h"
+#include "mcrouter/routes/ProxyRoute.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+// Rough size of one route handle object, including the shared_ptr
+// control block and small owned state (names, child vectors).
+constexpr size_t kPerRouteHandleBytes = 512;
+
+} // anonymous namespace
+
+folly::dynamic configCostReport(const ProxyConfig& config) {
+  folly::dynamic report = folly::dynamic::object;
+
+  // Pools and destinations.
+  folly::dynamic pools = folly::dynamic::object;
+  size_t numDestinations = 0;
+  for (const auto& pool : config.getPools()) {
+    pools[pool.first] = pool.second.size();
+    numDestinations += pool.second.size();
+  }
+  report["pools"] = std::move(pools);
+  report["num_pools"] = config.getPools().size();
+  report["num_destinations"] = numDestinations;
+
+  // Distinct clients, i.e. how many connections each proxy may open.
+  const size_t numClients = config.calcNumClients();
+  report["num_clients"] = numClients;
+
+  // Tree shape.  Hash-style routes only traverse the child they would
+  // pick, so the sampled count is the working set of one get request,
+  // not the whole tree; num_destinations covers the fanned-out leaves.
+  std::unordered_set<const McrouterRouteHandleIf*> seen;
+  size_t depth = 0;
+  size_t sampledDepth = 0;
+  RouteHandleTraverser<McrouterRouteHandleIf> t(
+      [&seen, &depth, &sampledDepth](const McrouterRouteHandleIf& rh) {
+        seen.insert(&rh);
+        ++depth;
+        sampledDepth = std::max(sampledDepth, depth);
+      },
+      [&depth]() {
+        --depth;
+      });
+  config.proxyRoute().traverse(
+      TypedThriftRequest<cpp2::McGetRequest>("sample-key"), t);
+  report["route_handles_sampled_get"] = seen.size();
+  report["route_depth_sampled_get"] = sampledDepth;
+
+  const auto maxDepth = config.routeHandlesMaxDepth();
+  report["route_max_depth"] = maxDepth == kUnknownRouteDepth
+      ? folly::dynamic("unbounded")
+      : folly::dynamic(maxDepth);
+  report["may_block"] = config.routeHandlesMayBlock();
+
+  // Rough per-proxy memory: each distinct client becomes a
+  // ProxyDestination, each destination leaf and sampled inner handle a
+  // few hundred bytes.  Excludes connection and write buffers, which
+  // are pooled and traffic-dependent, so treat this as a lower bound.
+  report["estimated_bytes_per_proxy"] =
+      numClients * sizeof(ProxyDestination) +
+      (numDestinations + seen.size()) * kPerRouteHandleBytes;
+
+  return report;
+}
+
+}}} // facebook::memcache::mcrouter
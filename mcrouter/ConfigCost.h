@@ -0,0 +1,29 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+namespace folly {
+struct dynamic;
+} // folly
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+class ProxyConfig;
+
+/**
+ * Builds a resource-cost report for a fully built config: pool and
+ * destination counts, route handle tree shape, and a rough estimate of
+ * per-proxy memory.  Used by the "config_cost" service info command and
+ * by --validate-config=cost to judge what a config will cost before it
+ * is deployed.
+ */
+folly::dynamic configCostReport(const ProxyConfig& config);
+
+}}} // facebook::memcache::mcrouter
@@ -27,7 +27,10 @@ void CyclesObserver::runnable(uintptr_t id) noexcept {
 }
 
 void CyclesObserver::stopped(uintptr_t id) noexcept {
-  if (auto sharedCtx = fiber_local::getSharedCtx()) {
+  /* Observe through the reference in the fiber locals; no need to take
+     (and pay for) one of our own on every fiber switch. */
+  const auto& sharedCtx = fiber_local::getSharedCtx();
+  if (sharedCtx.get() != nullptr) {
     // Currently we don't use operation class, so just pass 0 for now.
     cycles::label(0, sharedCtx->requestId());
   }
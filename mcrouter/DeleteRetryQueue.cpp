@@ -0,0 +1,124 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "DeleteRetryQueue.h"
+
+#include <folly/Memory.h>
+
+#include "mcrouter/async.h"
+#include "mcrouter/awriter.h"
+#include "mcrouter/config.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/McrouterInstance.h"
+#include "mcrouter/McrouterLogFailure.h"
+#include "mcrouter/proxy.h"
+#include "mcrouter/ProxyDestination.h"
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+DeleteRetryQueue::DeleteRetryQueue(proxy_t& proxy,
+                                   size_t maxEntries,
+                                   size_t maxRetries,
+                                   uint32_t retryIntervalMs)
+    : proxy_(proxy),
+      maxEntries_(maxEntries),
+      maxRetries_(maxRetries),
+      retryIntervalMs_(retryIntervalMs) {
+}
+
+bool DeleteRetryQueue::add(std::shared_ptr<ProxyDestination> destination,
+                           std::string key,
+                           std::string asynclogName,
+                           std::chrono::milliseconds timeout) {
+  if (numEntries_ >= maxEntries_) {
+    return false;
+  }
+  ++numEntries_;
+
+  auto entry = std::make_shared<Entry>();
+  entry->destination = std::move(destination);
+  entry->key = std::move(key);
+  entry->asynclogName = std::move(asynclogName);
+  entry->timeout = timeout;
+  entry->retriesLeft = maxRetries_;
+
+  scheduleRetry(std::move(entry));
+  return true;
+}
+
+void DeleteRetryQueue::scheduleRetry(std::shared_ptr<Entry> entry) {
+  proxy_.eventBase().runAfterDelay(
+    [this, entry]() {
+      proxy_.fiberManager.addTask([this, entry]() {
+        retry(entry);
+      });
+    },
+    retryIntervalMs_);
+}
+
+void DeleteRetryQueue::retry(std::shared_ptr<Entry> entry) {
+  --entry->retriesLeft;
+
+  if (entry->destination->may_send()) {
+    TypedThriftRequest<cpp2::McDeleteRequest> req;
+    req.setKey(entry->key);
+
+    DestinationRequestCtx dctx(nowUs());
+    auto reply = entry->destination->send(req, dctx, entry->timeout);
+    if (!reply.isFailoverError()) {
+      /* Delivered (or rejected for a non-transient reason); done. */
+      --numEntries_;
+      stat_incr(proxy_.stats, retried_deletes_stat, 1);
+      return;
+    }
+  }
+
+  if (entry->retriesLeft > 0) {
+    scheduleRetry(std::move(entry));
+    return;
+  }
+  spill(std::move(entry));
+}
+
+void DeleteRetryQueue::spill(std::shared_ptr<Entry> entry) {
+  --numEntries_;
+
+  auto proxy = &proxy_;
+  auto lane = asynclog_lane(proxy, entry->asynclogName);
+  if (proxy->asynclogLanes[lane].ring &&
+      asynclog_ring_append(proxy, lane,
+                           asynclog_delete_record(
+                               proxy,
+                               *entry->destination->accessPoint(),
+                               entry->key,
+                               entry->asynclogName))) {
+    stat_incr(proxy_.stats, asynclog_requests_stat, 1);
+    return;
+  }
+
+  auto res = proxy_.router().asynclogWriter(lane).run([entry, proxy, lane]() {
+    asynclog_delete(proxy,
+                    lane,
+                    *entry->destination->accessPoint(),
+                    entry->key,
+                    entry->asynclogName);
+  });
+  if (!res) {
+    MC_LOG_FAILURE(proxy_.router().opts(),
+                   memcache::failure::Category::kOutOfResources,
+                   "Could not enqueue asynclog request (key {}, pool {})",
+                   entry->key, entry->asynclogName);
+  } else {
+    stat_incr(proxy_.stats, asynclog_requests_stat, 1);
+  }
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+class ProxyDestination;
+struct proxy_t;
+
+/**
+ * Bounded in-memory retry stage ahead of the asynclog spill
+ * (--asynclog-retry-count).
+ *
+ * Most failed deletes are caused by transient destination blips, so
+ * instead of going straight to disk each one is parked here and resent
+ * a few times on a timer; only deletes that keep failing (or don't fit
+ * in the queue) are spilled to the asynclog file. Everything runs on
+ * the proxy thread: the delay is scheduled on the proxy's EventBase,
+ * whose timeouts are backed by a timing wheel, and the resend runs on
+ * a proxy fiber.
+ *
+ * Queued deletes are lost if the process dies before they are resent
+ * or spilled; enabling the retry stage trades that small durability
+ * window for much less spool traffic.
+ */
+class DeleteRetryQueue {
+ public:
+  DeleteRetryQueue(proxy_t& proxy,
+                   size_t maxEntries,
+                   size_t maxRetries,
+                   uint32_t retryIntervalMs);
+
+  /**
+   * Parks a failed delete for retry.
+   *
+   * @return false if the queue is full; the caller should spill the
+   *         delete to the asynclog instead.
+   */
+  bool add(std::shared_ptr<ProxyDestination> destination,
+           std::string key,
+           std::string asynclogName,
+           std::chrono::milliseconds timeout);
+
+ private:
+  struct Entry {
+    std::shared_ptr<ProxyDestination> destination;
+    std::string key;
+    std::string asynclogName;
+    std::chrono::milliseconds timeout;
+    size_t retriesLeft;
+  };
+
+  void scheduleRetry(std::shared_ptr<Entry> entry);
+  void retry(std::shared_ptr<Entry> entry);
+  void spill(std::shared_ptr<Entry> entry);
+
+  proxy_t& proxy_;
+  const size_t maxEntries_;
+  const size_t maxRetries_;
+  const uint32_t retryIntervalMs_;
+  size_t numEntries_{0};
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -19,6 +19,9 @@
 
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
+#include <folly/MemoryMapping.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
 
 using boost::filesystem::complete;
 using boost::filesystem::path;
@@ -93,6 +96,26 @@ std::string FileDataProvider::load() const {
   return result;
 }
 
+bool FileDataProvider::hasContentChanged() {
+  std::string hash;
+  try {
+    folly::MemoryMapping mapping(filePath_.data());
+    auto range = mapping.range();
+    hash = Md5Hash(folly::StringPiece(
+        reinterpret_cast<const char*>(range.begin()), range.size()));
+  } catch (const std::exception& e) {
+    throw std::runtime_error(
+      folly::format(
+        "Can not map file '{}': {}", filePath_.data(), e.what()).str());
+  }
+
+  if (hash == contentMd5_) {
+    return false;
+  }
+  contentMd5_ = std::move(hash);
+  return true;
+}
+
 bool FileDataProvider::hasUpdate() {
   if (!inotify_) {
     return false;
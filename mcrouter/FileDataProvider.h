@@ -42,9 +42,33 @@ class FileDataProvider {
    * @throw runtime_error if inotify watch can not be checked or recreated
    */
   bool hasUpdate();
+
+  /**
+   * Hashes the file's current content (mmap'd, so nothing is copied) and
+   * compares it to the content seen by the previous call.  Lets callers
+   * skip reloading and reparsing when an inotify event fired without an
+   * actual byte change (touch, a symlink re-pointed at identical data,
+   * editor shuffles).
+   *
+   * @return true on the first call and whenever the bytes differ from
+   *         the previous call, false if the content is unchanged
+   * @throw runtime_error if the file can not be opened or mapped
+   */
+  bool hasContentChanged();
+
+  /**
+   * @return file descriptor of the underlying inotify instance (-1 if none),
+   *   suitable for waiting on with poll/epoll instead of calling hasUpdate()
+   *   periodically. The descriptor is replaced whenever hasUpdate() observes
+   *   an event and recreates the watch.
+   */
+  int inotifyFD() const {
+    return inotify_ ? inotify_.fd() : -1;
+  }
  private:
   const std::string filePath_;
   folly::File inotify_;
+  std::string contentMd5_;
 
   /**
    * Updates the inotify watch.
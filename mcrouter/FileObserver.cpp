@@ -15,6 +15,7 @@
 #include <glog/logging.h>
 
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
 #include <folly/Memory.h>
 
 #include "mcrouter/FileDataProvider.h"
@@ -47,10 +48,20 @@ struct FileObserverData {
   std::function<void()> fallbackOnError;
   uint32_t pollPeriodMs;
   uint32_t sleepBeforeUpdateMs;
+  /// Set for cancellable observations; observation stops once it expires.
+  std::weak_ptr<const bool> alive;
+  bool cancellable{false};
+
+  bool cancelled() const {
+    return cancellable && alive.expired();
+  }
 };
 
 void scheduleObserveFile(folly::EventBase& evb, FileObserverData data) {
   evb.runAfterDelay([&evb, data = std::move(data)]() {
+    if (data.cancelled()) {
+      return;
+    }
     bool hasUpdate;
     try {
       hasUpdate = data.provider->hasUpdate();
@@ -63,8 +74,13 @@ void scheduleObserveFile(folly::EventBase& evb, FileObserverData data) {
 
     if (hasUpdate) {
       evb.runAfterDelay([&evb, data = std::move(data)]() {
+        if (data.cancelled()) {
+          return;
+        }
         try {
-          data.onUpdate(data.provider->load());
+          if (data.provider->hasContentChanged()) {
+            data.onUpdate(data.provider->load());
+          }
           scheduleObserveFile(evb, std::move(data));
         } catch (...) {
           checkAndExecuteFallbackOnError(std::move(data.fallbackOnError));
@@ -78,19 +94,94 @@ void scheduleObserveFile(folly::EventBase& evb, FileObserverData data) {
   }, data.pollPeriodMs);
 }
 
-} // anonymous namespace
+/**
+ * Waits for events on the inotify descriptor owned by FileDataProvider,
+ * so file changes are detected as soon as they happen, without periodic
+ * timer wakeups. The handler keeps itself alive (via self_) for as long
+ * as the file is observed.
+ */
+class FileObserverHandler
+    : public folly::EventHandler,
+      public std::enable_shared_from_this<FileObserverHandler> {
+ public:
+  FileObserverHandler(folly::EventBase& evb, FileObserverData data)
+      : folly::EventHandler(&evb, data.provider->inotifyFD()),
+        evb_(evb),
+        data_(std::move(data)) {}
+
+  /**
+   * Starts waiting for inotify events.
+   *
+   * @return true on success, false if the descriptor can not be registered
+   *   with the event base (the caller should fall back to polling).
+   */
+  bool start() {
+    if (!registerHandler(folly::EventHandler::READ)) {
+      return false;
+    }
+    self_ = shared_from_this();
+    return true;
+  }
 
-bool startObservingFile(const std::string& filePath,
-                        folly::EventBase& evb,
-                        uint32_t pollPeriodMs,
-                        uint32_t sleepBeforeUpdateMs,
-                        std::function<void(std::string)> onUpdate,
-                        std::function<void()> fallbackOnError) {
+  FileObserverData releaseData() {
+    return std::move(data_);
+  }
+
+  void handlerReady(uint16_t) noexcept override {
+    // Wait a bit before reloading as a crude protection against partial
+    // writes. More inotify events arriving in the meantime are coalesced
+    // into a single reload.
+    evb_.runAfterDelay([this]() { processUpdate(); },
+                       data_.sleepBeforeUpdateMs);
+  }
+
+ private:
+  folly::EventBase& evb_;
+  FileObserverData data_;
+  std::shared_ptr<FileObserverHandler> self_;
+
+  void processUpdate() {
+    if (data_.cancelled()) {
+      self_.reset();
+      return;
+    }
+    bool rearmed = false;
+    try {
+      if (data_.provider->hasUpdate() &&
+          data_.provider->hasContentChanged()) {
+        data_.onUpdate(data_.provider->load());
+      }
+      // hasUpdate() recreates the watch, so re-register with the new fd
+      changeHandlerFD(data_.provider->inotifyFD());
+      rearmed = registerHandler(folly::EventHandler::READ);
+    } catch (...) {
+      rearmed = false;
+    }
+    if (!rearmed) {
+      LOG_FAILURE("mcrouter", failure::Category::kOther,
+                  "Error while observing file for update");
+      checkAndExecuteFallbackOnError(std::move(data_.fallbackOnError));
+      self_.reset();
+    }
+  }
+};
+
+bool startObservingFileImpl(const std::string& filePath,
+                            folly::EventBase& evb,
+                            uint32_t pollPeriodMs,
+                            uint32_t sleepBeforeUpdateMs,
+                            std::function<void(std::string)> onUpdate,
+                            std::function<void()> fallbackOnError,
+                            std::weak_ptr<const bool> alive,
+                            bool cancellable) {
 
   std::shared_ptr<FileDataProvider> provider;
   try {
     provider = std::make_shared<FileDataProvider>(filePath);
 
+    /* Record the initial content hash so that a later inotify event for
+       byte-identical data doesn't trigger a redundant reload. */
+    provider->hasContentChanged();
     onUpdate(provider->load());
   } catch (const std::exception& e) {
     VLOG(0) << "Can not start watching " << filePath <<
@@ -105,9 +196,48 @@ bool startObservingFile(const std::string& filePath,
                         std::move(fallbackOnError),
                         pollPeriodMs,
                         sleepBeforeUpdateMs);
-  return evb.runInEventBaseThread([&evb, data = std::move(data)]() {
-    scheduleObserveFile(evb, std::move(data));
+  data.alive = std::move(alive);
+  data.cancellable = cancellable;
+  return evb.runInEventBaseThread([&evb, data = std::move(data)]() mutable {
+    auto handler = std::make_shared<FileObserverHandler>(evb, std::move(data));
+    if (!handler->start()) {
+      // the inotify fd can not be registered with this event base,
+      // fall back to periodic polling
+      scheduleObserveFile(evb, handler->releaseData());
+    }
   });
 }
 
+} // anonymous namespace
+
+bool startObservingFile(const std::string& filePath,
+                        folly::EventBase& evb,
+                        uint32_t pollPeriodMs,
+                        uint32_t sleepBeforeUpdateMs,
+                        std::function<void(std::string)> onUpdate,
+                        std::function<void()> fallbackOnError) {
+  return startObservingFileImpl(filePath, evb, pollPeriodMs,
+                                sleepBeforeUpdateMs, std::move(onUpdate),
+                                std::move(fallbackOnError),
+                                std::weak_ptr<const bool>(),
+                                /* cancellable */ false);
+}
+
+FileObserverHandle startObservingFileCancellable(
+    const std::string& filePath,
+    folly::EventBase& evb,
+    uint32_t pollPeriodMs,
+    uint32_t sleepBeforeUpdateMs,
+    std::function<void(std::string)> onUpdate,
+    std::function<void()> fallbackOnError) {
+  auto token = std::make_shared<bool>(true);
+  if (!startObservingFileImpl(filePath, evb, pollPeriodMs,
+                              sleepBeforeUpdateMs, std::move(onUpdate),
+                              std::move(fallbackOnError), token,
+                              /* cancellable */ true)) {
+    return nullptr;
+  }
+  return token;
+}
+
 }}} // facebook::memcache::mcrouter
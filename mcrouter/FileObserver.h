@@ -10,6 +10,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace folly {
@@ -19,11 +20,14 @@ class EventBase;
 namespace facebook { namespace memcache { namespace mcrouter {
 
 /**
- * Starts a periodic thread that watches the given file path for changes.
+ * Starts watching the given file path for changes. Changes are detected
+ * by waiting for inotify events on the event base, so updates propagate
+ * without periodic timer wakeups.
  *
  * @param filePath path to the file to watch (can be a symlink)
  * @param pollPeriodMs how much to wait between asking inotify if
- *        any updates happened
+ *        any updates happened; only used as a fallback if the inotify
+ *        descriptor can not be registered with the event base
  * @param sleepAfterUpdateMs how much to wait before calling onUpdate
  *        once an inotify event happens (as a crude protection against
  *        partial writes race condition).
@@ -37,4 +41,26 @@ bool startObservingFile(const std::string& filePath,
                         std::function<void(std::string)> onUpdate,
                         std::function<void()> fallbackOnError = nullptr);
 
+/**
+ * Keeps a cancellable file observation alive: observation stops and the
+ * inotify watch is released shortly after the handle is destroyed.
+ * An empty handle means observation could not be started.
+ */
+using FileObserverHandle = std::shared_ptr<void>;
+
+/**
+ * Same as startObservingFile(), but observation is tied to the lifetime
+ * of the returned handle instead of lasting forever. Useful for watchers
+ * owned by a single config generation.
+ *
+ * @return handle that keeps the observation alive, empty handle on error
+ */
+FileObserverHandle startObservingFileCancellable(
+    const std::string& filePath,
+    folly::EventBase& evb,
+    uint32_t pollPeriodMs,
+    uint32_t sleepBeforeUpdateMs,
+    std::function<void(std::string)> onUpdate,
+    std::function<void()> fallbackOnError = nullptr);
+
 }}} // facebook::memcache::mcrouter
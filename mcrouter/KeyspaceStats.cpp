@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "KeyspaceStats.h"
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/McResUtil.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+KeyspaceStats::KeyspaceStats(const folly::dynamic& json,
+                             CounterMap& counters) {
+  checkLogic(json.isObject(), "keyspaces is not an object");
+
+  Trie<Counters*> table;
+  for (const auto& it : json.items()) {
+    checkLogic(it.first.isString(), "keyspaces: prefix is not a string");
+    auto prefix = it.first.stringPiece();
+    checkLogic(!prefix.empty(), "keyspaces: empty prefix");
+    checkLogic(it.second.isString(),
+               "keyspaces: namespace for '{}' is not a string", prefix);
+    table.emplace(prefix, &counters[it.second.stringPiece()]);
+  }
+  table_ = CompactTrie<Counters*>(table);
+}
+
+void KeyspaceStats::record(folly::StringPiece key, mc_res_t result) const {
+  const auto* match = table_.findPrefix(key);
+  if (match == nullptr) {
+    return;
+  }
+  auto& counters = *match->second;
+  ++counters.requests;
+  if (isHitResult(result)) {
+    ++counters.hits;
+  } else if (isMissResult(result)) {
+    ++counters.misses;
+  } else if (isErrorResult(result)) {
+    ++counters.errors;
+  }
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/Range.h>
+
+#include "mcrouter/lib/fbi/cpp/CompactTrie.h"
+#include "mcrouter/lib/mc/msg.h"
+
+namespace folly {
+struct dynamic;
+} // folly
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Per-namespace hit/miss accounting keyed by key prefix.
+ *
+ * A config may define a "keyspaces" object mapping key prefixes to
+ * namespace names:
+ *
+ *   "keyspaces": { "user:": "user", "feed:": "feed" }
+ *
+ * Each reply is attributed to the namespace of the longest prefix
+ * matching its key: one walk of the same CompactTrie machinery
+ * RoutePolicyMap routes with, so the accounting is cheap enough to
+ * stay always-on.  Query with "stats keyspaces".
+ */
+class KeyspaceStats {
+ public:
+  struct Counters {
+    uint64_t requests{0};
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t errors{0};
+  };
+
+  /**
+   * Counter storage, keyed by namespace name.  Owned by the proxy
+   * rather than by this object so counts survive config swaps; the
+   * prefix table of the active config points into it (entries are
+   * created on demand and never removed, so the pointers stay valid).
+   */
+  using CounterMap = folly::StringKeyedUnorderedMap<Counters>;
+
+  /**
+   * Compiles the prefix table from the "keyspaces" config object.
+   *
+   * @param json      object mapping key prefix to namespace name
+   * @param counters  proxy-owned counter storage
+   * @throws std::logic_error on invalid json
+   */
+  KeyspaceStats(const folly::dynamic& json, CounterMap& counters);
+
+  /**
+   * Attributes one reply to the namespace owning the longest prefix of
+   * key, if any.  Called on the owning proxy thread only.
+   */
+  void record(folly::StringPiece key, mc_res_t result) const;
+
+ private:
+  CompactTrie<Counters*> table_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -9,6 +9,8 @@
  */
 #include "LeaseTokenMap.h"
 
+#include <folly/Memory.h>
+
 namespace facebook { namespace memcache { namespace mcrouter {
 
 namespace {
@@ -25,14 +27,21 @@ inline uint64_t applyMagic(uint32_t id) {
 
 } // anonymous
 
+constexpr size_t LeaseTokenMap::kNumShards;
+
 LeaseTokenMap::LeaseTokenMap(folly::ScopedEventBaseThread& evbThread,
                              uint32_t leaseTokenTtl)
     : evbThread_(evbThread),
-      timeoutHandler_(*this, *evbThread.getEventBase()),
       leaseTokenTtlMs_(leaseTokenTtl) {
   assert(leaseTokenTtlMs_ > 0);
+  for (auto& shard : shards_) {
+    shard.timeoutHandler = folly::make_unique<TimeoutHandler>(
+        *this, shard, *evbThread.getEventBase());
+  }
   evbThread_.getEventBase()->runInEventBaseThread([this]() {
-    timeoutHandler_.scheduleTimeout(leaseTokenTtlMs_);
+    for (auto& shard : shards_) {
+      shard.timeoutHandler->scheduleTimeout(leaseTokenTtlMs_);
+    }
   });
 }
 
@@ -40,22 +49,26 @@ LeaseTokenMap::~LeaseTokenMap() {
   if (evbThread_.running()) {
     evbThread_.getEventBase()->runImmediatelyOrRunInEventBaseThreadAndWait(
       [this]() {
-        timeoutHandler_.cancelTimeout();
+        for (auto& shard : shards_) {
+          shard.timeoutHandler->cancelTimeout();
+        }
       });
   }
 }
 
 uint64_t LeaseTokenMap::insert(std::string routeName, Item item) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t specialToken =
+      applyMagic(nextId_.fetch_add(1, std::memory_order_relaxed));
+  auto& shard = shardFor(specialToken);
 
-  uint64_t specialToken = applyMagic(nextId_++);
+  std::lock_guard<std::mutex> lock(shard.mutex);
 
-  auto it = data_.emplace(specialToken,
-                          LeaseTokenMap::ListItem(specialToken,
-                                                  std::move(routeName),
-                                                  std::move(item),
-                                                  leaseTokenTtlMs_));
-  invalidationQueue_.push_back(it.first->second);
+  auto it = shard.data.emplace(specialToken,
+                               LeaseTokenMap::ListItem(specialToken,
+                                                       std::move(routeName),
+                                                       std::move(item),
+                                                       leaseTokenTtlMs_));
+  shard.invalidationQueue.push_back(it.first->second);
 
   return specialToken;
 }
@@ -69,11 +82,12 @@ folly::Optional<LeaseTokenMap::Item> LeaseTokenMap::query(
   }
 
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = data_.find(token);
-    if (it != data_.end() && it->second.routeName == routeName) {
+    auto& shard = shardFor(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.data.find(token);
+    if (it != shard.data.end() && it->second.routeName == routeName) {
       item.emplace(std::move(it->second.item));
-      data_.erase(it);
+      shard.data.erase(it);
     }
   }
 
@@ -87,38 +101,43 @@ uint64_t LeaseTokenMap::getOriginalLeaseToken(folly::StringPiece routeName,
   }
 
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = data_.find(token);
-    if (it != data_.end() && it->second.routeName == routeName) {
+    auto& shard = shardFor(token);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.data.find(token);
+    if (it != shard.data.end() && it->second.routeName == routeName) {
       return it->second.item.originalToken;
     }
   }
   return token;
 }
 
-void LeaseTokenMap::onTimeout() {
-  std::lock_guard<std::mutex> lock(mutex_);
+void LeaseTokenMap::onTimeout(Shard& shard) {
+  std::lock_guard<std::mutex> lock(shard.mutex);
 
   auto now = ListItem::Clock::now();
-  auto cur = invalidationQueue_.begin();
-  while (cur != invalidationQueue_.end() && cur->tokenTimeout <= now) {
+  auto cur = shard.invalidationQueue.begin();
+  while (cur != shard.invalidationQueue.end() && cur->tokenTimeout <= now) {
     uint64_t specialToken = cur->specialToken;
-    cur = invalidationQueue_.erase(cur);
-    data_.erase(specialToken);
+    cur = shard.invalidationQueue.erase(cur);
+    shard.data.erase(specialToken);
   }
 
-  if (invalidationQueue_.empty()) {
-    timeoutHandler_.scheduleTimeout(leaseTokenTtlMs_);
+  if (shard.invalidationQueue.empty()) {
+    shard.timeoutHandler->scheduleTimeout(leaseTokenTtlMs_);
   } else {
     auto nextExpiration = std::chrono::duration_cast<std::chrono::milliseconds>(
-        invalidationQueue_.front().tokenTimeout - now).count();
-    timeoutHandler_.scheduleTimeout(std::max<uint32_t>(nextExpiration, 1));
+        shard.invalidationQueue.front().tokenTimeout - now).count();
+    shard.timeoutHandler->scheduleTimeout(std::max<uint32_t>(nextExpiration, 1));
   }
 }
 
 size_t LeaseTokenMap::size() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return data_.size();
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total += shard.data.size();
+  }
+  return total;
 }
 
 bool LeaseTokenMap::conflicts(uint64_t originalToken) {
@@ -9,8 +9,11 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -24,6 +27,10 @@ namespace facebook { namespace memcache { namespace mcrouter {
 /**
  * Class responsible for mapping lease-tokens to destinations.
  * All operations are thread-safe.
+ *
+ * Internally the map is sharded by the low bits of the token, with a
+ * separate lock, invalidation queue and timeout per shard, so that
+ * lease-heavy workloads don't serialize on a single mutex.
  */
 class LeaseTokenMap {
  public:
@@ -119,35 +126,56 @@ class LeaseTokenMap {
     folly::IntrusiveListHook listHook;
   };
 
+  class TimeoutHandler;
+
+  // Number of shards. Tokens are mapped to shards by their low bits,
+  // so this must be a power of two.
+  static constexpr size_t kNumShards = 16;
+
+  struct Shard {
+    // Underlying data structure.
+    std::unordered_map<uint64_t, ListItem> data;
+    // Keeps an in-order list of what should be invalidated.
+    folly::IntrusiveList<ListItem, &ListItem::listHook> invalidationQueue;
+    // Synchronizes access to this shard.
+    mutable std::mutex mutex;
+    // Expires tokens of this shard. Constructed by LeaseTokenMap.
+    std::unique_ptr<TimeoutHandler> timeoutHandler;
+  };
+
   // Hold the id of the next element to be inserted in the data structure.
-  uint32_t nextId_{0};
+  // Sequential ids spread consecutive inserts over all shards.
+  std::atomic<uint32_t> nextId_{0};
 
-  // Underlying data structure.
-  std::unordered_map<uint64_t, ListItem> data_;
-  // Keeps an in-order list of what should be invalidated.
-  folly::IntrusiveList<ListItem, &ListItem::listHook> invalidationQueue_;
-  // Mutex to synchronize access to underlying data structure
-  mutable std::mutex mutex_;
+  std::array<Shard, kNumShards> shards_;
 
   // Handles timeout
   class TimeoutHandler : public folly::AsyncTimeout {
    public:
-    explicit TimeoutHandler(LeaseTokenMap& parent, folly::EventBase& evb)
+    TimeoutHandler(LeaseTokenMap& parent, Shard& shard, folly::EventBase& evb)
         : folly::AsyncTimeout(&evb),
-          parent_(parent) {
+          parent_(parent),
+          shard_(shard) {
     }
     void timeoutExpired() noexcept override final {
-      parent_.onTimeout();
+      parent_.onTimeout(shard_);
     }
 
    private:
     LeaseTokenMap& parent_;
+    Shard& shard_;
   };
   folly::ScopedEventBaseThread& evbThread_;
-  TimeoutHandler timeoutHandler_;
   uint32_t leaseTokenTtlMs_;
 
-  void onTimeout();
+  Shard& shardFor(uint64_t token) {
+    return shards_[token & (kNumShards - 1)];
+  }
+  const Shard& shardFor(uint64_t token) const {
+    return shards_[token & (kNumShards - 1)];
+  }
+
+  void onTimeout(Shard& shard);
 };
 
 }}} // facebook::memcache::mcrouter
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Fixed-memory histogram with logarithmic buckets.
+ *
+ * Each power-of-two range of sample values is split into SubBuckets
+ * equally sized buckets, so the value reported for any percentile is
+ * within a factor of (1 + 1/SubBuckets) of the true one.  Recording a
+ * sample is a single array increment, which makes it cheap enough for
+ * per-request measurements (e.g. per-destination latencies).
+ *
+ * Two histograms with the same SubBuckets can be merged bucket by
+ * bucket, so per-thread instances can be combined into one snapshot
+ * without any synchronization on the write path.
+ */
+template <size_t SubBuckets = 8>
+class LogScaleHistogram {
+ public:
+  static_assert(SubBuckets >= 2 && (SubBuckets & (SubBuckets - 1)) == 0,
+                "SubBuckets should be a power of two >= 2");
+
+  void insertSample(uint64_t sample) {
+    ++counts_[bucketOf(sample)];
+    ++total_;
+  }
+
+  /**
+   * @return total number of samples recorded (including merged ones)
+   */
+  uint64_t count() const {
+    return total_;
+  }
+
+  /**
+   * Upper bound of the bucket that contains the given quantile
+   * (e.g. 0.99 for p99). Returns 0 if the histogram is empty.
+   */
+  uint64_t getPercentile(double quantile) const {
+    assert(quantile >= 0.0 && quantile <= 1.0);
+    if (total_ == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * total_);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      seen += counts_[i];
+      if (seen > rank) {
+        return bucketMax(i);
+      }
+    }
+    return bucketMax(kNumBuckets - 1);
+  }
+
+  void merge(const LogScaleHistogram& other) {
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+  }
+
+ private:
+  static constexpr size_t kSubBucketBits = __builtin_ctzll(SubBuckets);
+  // one group of SubBuckets exact buckets for samples < SubBuckets, then
+  // one group per remaining power of two of the 64-bit sample range
+  static constexpr size_t kNumBuckets = (65 - kSubBucketBits) * SubBuckets;
+
+  uint64_t counts_[kNumBuckets] = {0};
+  uint64_t total_{0};
+
+  static size_t bucketOf(uint64_t sample) {
+    if (sample < SubBuckets) {
+      return sample;
+    }
+    size_t topBit = 63 - __builtin_clzll(sample);
+    size_t group = topBit - kSubBucketBits + 1;
+    size_t sub = (sample >> (topBit - kSubBucketBits)) & (SubBuckets - 1);
+    return group * SubBuckets + sub;
+  }
+
+  static uint64_t bucketMax(size_t index) {
+    size_t group = index / SubBuckets;
+    if (group == 0) {
+      return index;
+    }
+    size_t shift = group - 1;
+    uint64_t sub = index % SubBuckets;
+    return ((SubBuckets + sub + 1) << shift) - 1;
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -83,7 +83,7 @@ bool McrouterClient::send(const Request& req,
                           F&& callback,
                           folly::StringPiece ipAddr) {
   auto makePreq = [this, ipAddr, &req, &callback] {
-    auto preq = createProxyRequestContext(*proxy_, req, [
+    auto preq = createProxyRequestContext(pickProxy(), req, [
       this,
       cb = std::forward<F>(callback)
     ](const Request& request, ReplyT<Request>&& reply) mutable {
@@ -110,6 +110,40 @@ bool McrouterClient::send(const Request& req,
   return sendMultiImpl(1, makePreq, cancelRemaining);
 }
 
+template <class Request, class F>
+typename std::enable_if<!std::is_reference<Request>::value, bool>::type
+McrouterClient::send(Request&& req,
+                     F&& callback,
+                     folly::StringPiece ipAddr) {
+  auto makePreq = [this, ipAddr, &req, &callback] {
+    auto preq = createOwnedProxyRequestContext(pickProxy(), std::move(req), [
+      this,
+      cb = std::forward<F>(callback)
+    ](const Request& request, ReplyT<Request>&& reply) mutable {
+      detail::bumpMcrouterClientStats(stats_, request, reply);
+      if (disconnected_) {
+        // "Cancelled" reply.
+        cb(request, ReplyT<Request>(mc_res_unknown));
+      } else {
+        cb(request, std::move(reply));
+      }
+    });
+
+    preq->requester_ = self_;
+    if (!ipAddr.empty()) {
+      preq->setUserIpAddress(ipAddr);
+    }
+    return preq;
+  };
+
+  /* Only called if makePreq wasn't, so req hasn't been moved from */
+  auto cancelRemaining = [&req, &callback]() {
+    callback(req, ReplyT<Request>(mc_res_local_error));
+  };
+
+  return sendMultiImpl(1, makePreq, cancelRemaining);
+}
+
 template <class F, class G>
 bool McrouterClient::sendMultiImpl(
     size_t nreqs,
@@ -181,7 +215,7 @@ bool McrouterClient::send(
 
   auto makeNextPreq = [this, ipAddr, &callback, &begin]() {
     auto preq = createProxyRequestContext(
-        *proxy_,
+        pickProxy(),
         detail::unwrapRequest(*begin),
         [this, callback](
             const Request& request, ReplyT<Request>&& reply) mutable {
@@ -13,19 +13,96 @@
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/proxy.h"
 #include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/stats.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+/* Don't steal until the pinned proxy is ahead by at least this many
+   outstanding requests; small imbalances aren't worth giving up the
+   pinned proxy's cache locality. */
+constexpr uint64_t kWorkStealMinImbalance = 16;
+
+void bindToProxy(proxy_t* proxy) {
+  ++proxy->boundClients;
+}
+
+void unbindFromProxy(proxy_t* proxy) {
+  if (--proxy->boundClients == 0 && proxy->beingRetired) {
+    /* wake the retiring proxy thread so it can finish draining */
+    proxy->eventBase().runInEventBaseThread([] {});
+  }
+}
+}  // anonymous namespace
+
 void McrouterClient::sendRemoteThread(
     std::unique_ptr<ProxyRequestContext> req) {
-  proxy_->messageQueue_->blockingWriteRelaxed(ProxyMessage::Type::REQUEST,
+  // The request must go to the queue of the proxy it was bound to, which
+  // with work stealing is not necessarily the pinned proxy_.
+  auto& proxy = req->proxy();
+  if (batchingWrites_ && &proxy == proxy_) {
+    proxy.messageQueue_->blockingWriteNoNotify(ProxyMessage::Type::REQUEST,
+                                               req.release());
+    ++unnotifiedWrites_;
+  } else {
+    proxy.messageQueue_->blockingWriteRelaxed(ProxyMessage::Type::REQUEST,
                                               req.release());
+  }
+}
+
+void McrouterClient::startRequestBatch() {
+  batchingWrites_ = true;
+}
+
+void McrouterClient::finishRequestBatch() {
+  batchingWrites_ = false;
+  if (unnotifiedWrites_ > 0) {
+    unnotifiedWrites_ = 0;
+    proxy_->messageQueue_->notifyRelaxed();
+  }
 }
 
 void McrouterClient::sendSameThread(std::unique_ptr<ProxyRequestContext> req) {
   proxy_->messageReady(ProxyMessage::Type::REQUEST, req.release());
 }
 
+proxy_t& McrouterClient::pickProxy() {
+  if (!workStealing_) {
+    return *proxy_;
+  }
+  auto router = router_.lock();
+  if (!router) {
+    return *proxy_;
+  }
+
+  auto pinnedLoad = stat_get_uint64(proxy_->stats,
+                                    proxy_request_num_outstanding_stat);
+  auto best = proxy_;
+  auto bestLoad = pinnedLoad;
+  auto numProxies = router->proxyCount();
+  for (size_t i = 0; i < numProxies; ++i) {
+    auto proxy = router->getProxy(i);
+    if (proxy == nullptr) {
+      /* The live count shrank under us (concurrent proxy retirement);
+         getProxy() is bounded by it, so higher indexes are gone too. */
+      break;
+    }
+    auto load = stat_get_uint64(proxy->stats,
+                                proxy_request_num_outstanding_stat);
+    if (load < bestLoad) {
+      best = proxy;
+      bestLoad = load;
+    }
+  }
+  // Loads are updated with relaxed atomics from other threads, so they
+  // are only estimates; the hysteresis below also keeps a stale read
+  // from bouncing requests between proxies.
+  if (pinnedLoad > 2 * bestLoad + kWorkStealMinImbalance) {
+    return *best;
+  }
+  return *proxy_;
+}
+
 McrouterClient::McrouterClient(
   std::weak_ptr<McrouterInstance> rtr,
   size_t maxOutstanding,
@@ -44,11 +121,29 @@ McrouterClient::McrouterClient(
   }
 
   if (auto router = router_.lock()) {
-    std::lock_guard<std::mutex> guard(router->nextProxyMutex_);
-    assert(router->nextProxy_ < router->opts().num_proxies);
-    proxy_ = router->getProxy(router->nextProxy_);
-    router->nextProxy_ =
-      (router->nextProxy_ + 1) % router->opts().num_proxies;
+    {
+      std::lock_guard<std::mutex> guard(router->nextProxyMutex_);
+      auto numProxies = router->proxyCount();
+      assert(router->nextProxy_ < numProxies);
+      proxy_ = router->getProxy(router->nextProxy_);
+      router->nextProxy_ = (router->nextProxy_ + 1) % numProxies;
+      bindToProxy(proxy_);
+    }
+    workStealing_ = !sameThread_ && router->opts().work_stealing &&
+                    router->proxyCount() > 1;
+  }
+}
+
+void McrouterClient::setProxy(proxy_t* proxy) {
+  if (proxy_ == proxy) {
+    return;
+  }
+  if (proxy_) {
+    unbindFromProxy(proxy_);
+  }
+  proxy_ = proxy;
+  if (proxy_) {
+    bindToProxy(proxy_);
   }
 }
 
@@ -68,6 +163,11 @@ McrouterClient::Pointer McrouterClient::create(
 
 McrouterClient::~McrouterClient() {
   assert(disconnected_);
+  /* All outstanding requests are done by now (they share ownership of
+     this object), so the pin can be dropped. */
+  if (proxy_) {
+    unbindFromProxy(proxy_);
+  }
 }
 
 }}}  // facebook::memcache::mcrouter
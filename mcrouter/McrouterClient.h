@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <type_traits>
+
 #include <folly/detail/CacheLocality.h>
 #include <folly/IntrusiveList.h>
 #include <folly/Optional.h>
@@ -33,7 +35,8 @@ class ProxyRequestContext;
 /**
  * A mcrouter client is used to communicate with a mcrouter instance.
  * Typically a client is long lived. Request sent through a single client
- * will be sent to the same mcrouter thread that's determined once on creation.
+ * will be sent to the same mcrouter thread that's determined once on creation
+ * (unless work stealing is enabled, see the work_stealing option).
  *
  * Create via McrouterInstance::createClient().
  */
@@ -83,6 +86,22 @@ class McrouterClient {
             F&& callback,
             folly::StringPiece ipAddr = folly::StringPiece());
 
+  /**
+   * Same as send() above, but takes ownership of the request. Mcrouter
+   * serializes directly from the request's ref-counted IOBuf chains, so
+   * a caller that already holds its value in IOBufs can move them into
+   * the request and send with no value copy and no lifetime management:
+   * the request is kept alive until the callback completes.
+   *
+   * Restricted to rvalues so lvalue requests keep taking the
+   * caller-owned overload above.
+   */
+  template <class Request, class F>
+  typename std::enable_if<!std::is_reference<Request>::value, bool>::type
+  send(Request&& req,
+       F&& callback,
+       folly::StringPiece ipAddr = folly::StringPiece());
+
   /**
    * Multi requests version of send.
    * @param callback  callback to call for each request, should be callable
@@ -119,9 +138,17 @@ class McrouterClient {
   /**
    * Override default proxy assignment.
    */
-  void setProxy(proxy_t* proxy) {
-    proxy_ = proxy;
-  }
+  void setProxy(proxy_t* proxy);
+
+  /**
+   * Defer proxy queue notifications for requests sent between
+   * startRequestBatch() and finishRequestBatch(), posting at most one
+   * notification per batch.  Calls must be paired and made from the
+   * sending thread.  No-op for same-thread clients, which bypass the
+   * message queue entirely.
+   */
+  void startRequestBatch();
+  void finishRequestBatch();
 
   McrouterClient(const McrouterClient&) = delete;
   McrouterClient(McrouterClient&&) noexcept = delete;
@@ -135,9 +162,16 @@ class McrouterClient {
   bool sameThread_{false};
 
   proxy_t* proxy_{nullptr};
+  /// If true, requests may be bound to a less loaded proxy than proxy_
+  bool workStealing_{false};
 
   CacheClientStats stats_;
 
+  /// True between startRequestBatch() and finishRequestBatch()
+  bool batchingWrites_{false};
+  /// Number of queue writes in the current batch with deferred notification
+  size_t unnotifiedWrites_{0};
+
   /// Maximum allowed requests in flight (unlimited if 0)
   const unsigned int maxOutstanding_;
   /// If true, error is immediately returned when maxOutstanding_ limit is hit
@@ -188,6 +222,14 @@ class McrouterClient {
   void sendRemoteThread(std::unique_ptr<ProxyRequestContext> req);
   void sendSameThread(std::unique_ptr<ProxyRequestContext> req);
 
+  /**
+   * Proxy to bind the next request to. Normally the pinned proxy_; with
+   * work stealing enabled, the least loaded proxy when the pinned one is
+   * significantly busier. A request can't move once created, it holds a
+   * reference to its proxy.
+   */
+  proxy_t& pickProxy();
+
   friend class McrouterInstance;
   friend class ProxyRequestContext;
 };
@@ -16,9 +16,10 @@
 #include <folly/Range.h>
 #include <folly/ScopeGuard.h>
 
-namespace facebook { namespace memcache { namespace mcrouter {
+#include "mcrouter/lib/network/RequestAborter.h"
+#include "mcrouter/ProxyRequestContextPtr.h"
 
-class ProxyRequestContext;
+namespace facebook { namespace memcache { namespace mcrouter {
 
 class RequestClass {
  public:
@@ -51,7 +52,34 @@ class RequestClass {
 namespace fiber_local { namespace detail {
 
 struct McrouterFiberContext {
-  std::shared_ptr<ProxyRequestContext> sharedCtx;
+  McrouterFiberContext() = default;
+  McrouterFiberContext(McrouterFiberContext&&) = default;
+  McrouterFiberContext& operator=(McrouterFiberContext&&) = default;
+
+  /* Fiber locals are copied into child fibers by the FiberManager (and
+     saved/restored by runWithLocals); sharedCtx is a move-only counted
+     reference, so spell the clone out here. */
+  McrouterFiberContext(const McrouterFiberContext& other)
+      : sharedCtx(other.sharedCtx.clone()),
+        asynclogName(other.asynclogName),
+        requestClass(other.requestClass),
+        failoverTag(other.failoverTag),
+        failoverDisabled(other.failoverDisabled),
+        requestAborter(other.requestAborter),
+        requestDeadlineUs(other.requestDeadlineUs) {}
+
+  McrouterFiberContext& operator=(const McrouterFiberContext& other) {
+    sharedCtx = other.sharedCtx.clone();
+    asynclogName = other.asynclogName;
+    requestClass = other.requestClass;
+    failoverTag = other.failoverTag;
+    failoverDisabled = other.failoverDisabled;
+    requestAborter = other.requestAborter;
+    requestDeadlineUs = other.requestDeadlineUs;
+    return *this;
+  }
+
+  ProxyRequestContextPtr sharedCtx;
 
   folly::StringPiece asynclogName;
 
@@ -60,6 +88,12 @@ struct McrouterFiberContext {
   bool failoverTag{false};
 
   bool failoverDisabled{false};
+
+  std::shared_ptr<RequestAborter> requestAborter;
+
+  /* Absolute deadline (us) by which the client expects a reply; 0 if
+     unknown. */
+  int64_t requestDeadlineUs{0};
 };
 
 }  // detail
@@ -97,7 +131,7 @@ inline typename std::result_of<F()>::type runWithLocals(F&& f) {
 /**
  * Update ProxyRequestContext for current fiber (thread, if we're not on fiber)
  */
-inline void setSharedCtx(std::shared_ptr<ProxyRequestContext> ctx) {
+inline void setSharedCtx(ProxyRequestContextPtr ctx) {
   folly::fibers::local<detail::McrouterFiberContext>().sharedCtx =
     std::move(ctx);
 }
@@ -105,7 +139,7 @@ inline void setSharedCtx(std::shared_ptr<ProxyRequestContext> ctx) {
 /**
  * Get ProxyRequestContext of current fiber (thread, if we're not on fiber)
  */
-inline const std::shared_ptr<ProxyRequestContext>& getSharedCtx() {
+inline const ProxyRequestContextPtr& getSharedCtx() {
   return folly::fibers::local<detail::McrouterFiberContext>().sharedCtx;
 }
 
@@ -172,4 +206,39 @@ inline bool getFailoverDisabled() {
   return folly::fibers::local<detail::McrouterFiberContext>().failoverDisabled;
 }
 
+/**
+ * Set RequestAborter for current fiber (thread, if we're not on fiber).
+ * Network requests sent from this fiber register with the aborter, so that
+ * the owner of the aborter can tear them down before they hit the wire.
+ */
+inline void setRequestAborter(std::shared_ptr<RequestAborter> aborter) {
+  folly::fibers::local<detail::McrouterFiberContext>().requestAborter =
+    std::move(aborter);
+}
+
+/**
+ * Get RequestAborter of current fiber (thread, if we're not on fiber)
+ */
+inline const std::shared_ptr<RequestAborter>& getRequestAborter() {
+  return folly::fibers::local<detail::McrouterFiberContext>().requestAborter;
+}
+
+/**
+ * Set the request deadline for current fiber (thread, if we're not on fiber).
+ * The deadline is the absolute time (in us, on the nowUs() clock) by which
+ * the client expects a reply; routes that queue requests may fast-fail
+ * entries that can't make it. 0 means the deadline is unknown.
+ */
+inline void setRequestDeadlineUs(int64_t value) {
+  folly::fibers::local<detail::McrouterFiberContext>().requestDeadlineUs =
+    value;
+}
+
+/**
+ * Get the request deadline of current fiber (thread, if we're not on fiber)
+ */
+inline int64_t getRequestDeadlineUs() {
+  return folly::fibers::local<detail::McrouterFiberContext>().requestDeadlineUs;
+}
+
 }}}}  // facebook::memcache::mcrouter::fiber_local
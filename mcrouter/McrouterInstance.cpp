@@ -9,6 +9,9 @@
  */
 #include "McrouterInstance.h"
 
+#include <atomic>
+#include <thread>
+
 #include <boost/filesystem/operations.hpp>
 
 #include <folly/DynamicConverter.h>
@@ -21,6 +24,8 @@
 #include "mcrouter/FileObserver.h"
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/network/HostResolver.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/McrouterLogger.h"
 #include "mcrouter/proxy.h"
@@ -29,6 +34,7 @@
 #include "mcrouter/ProxyThread.h"
 #include "mcrouter/RuntimeVarsData.h"
 #include "mcrouter/stats.h"
+#include "mcrouter/StatsExporter.h"
 #include "mcrouter/ThreadUtil.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -223,6 +229,26 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
   // Must init compression before creating proxies.
   if (opts_.enable_compression) {
     initCompression(*this);
+    if (opts_.compression_dictionary_training_interval_s > 0) {
+      dictionaryTrainer_ = folly::make_unique<CompressionDictionaryTrainer>();
+      dictionaryTrainer_->start(
+          std::chrono::seconds(
+              opts_.compression_dictionary_training_interval_s),
+          [this](const std::string& poolTag, std::string dictionary) {
+            LOG(INFO) << "Trained compression dictionary ("
+                      << dictionary.size() << " bytes) for pool '"
+                      << poolTag << "'";
+            if (onDictionaryTrained_) {
+              onDictionaryTrained_(poolTag, std::move(dictionary));
+            }
+          });
+    }
+  }
+
+  /* Reserve the full scaling capacity up front so the vector never
+     reallocates under readers of getProxy(). */
+  if (evbs.empty()) {
+    proxyThreads_.reserve(std::max(opts_.num_proxies, opts_.max_proxies));
   }
 
   for (size_t i = 0; i < opts_.num_proxies; i++) {
@@ -238,6 +264,7 @@ bool McrouterInstance::spinUp(const std::vector<folly::EventBase*>& evbs) {
       return false;
     }
   }
+  proxyCount_.store(opts_.num_proxies, std::memory_order_release);
 
   if (!reconfigure()) {
     LOG(ERROR) << "Failed to configure proxies";
@@ -298,11 +325,108 @@ proxy_t* McrouterInstance::getProxy(size_t index) const {
     return index < proxies_.size() ? proxies_[index].get() : nullptr;
   } else {
     assert(proxies_.empty());
-    return index < proxyThreads_.size() ?
+    /* Bounded by the published live count, not the vector size: slots
+       past proxyCount() hold retired threads that are still draining. */
+    return index < proxyCount_.load(std::memory_order_acquire) ?
                    &proxyThreads_[index]->proxy() : nullptr;
   }
 }
 
+bool McrouterInstance::addProxyThread() {
+  std::lock_guard<std::mutex> lg(proxyScalingMutex_);
+
+  if (!proxies_.empty() || opts_.shared_connections) {
+    LOG(ERROR) << "Can't add a proxy thread: runtime scaling requires "
+                  "mcrouter-owned proxy threads without shared connections";
+    return false;
+  }
+  auto count = proxyCount_.load();
+  if (count >= std::max(opts_.num_proxies, opts_.max_proxies)) {
+    LOG(WARNING) << "Can't add a proxy thread: already at the "
+                    "--max-proxies bound of " << count;
+    return false;
+  }
+
+  if (proxyThreads_.size() > count) {
+    /* The slot is occupied by a retired thread; reap it if it has
+       finished draining, otherwise try again later. */
+    if (!proxyThreads_[count]->readyToReap()) {
+      LOG(WARNING) << "Can't add a proxy thread: the previously retired "
+                      "thread is still draining";
+      return false;
+    }
+    proxyThreads_[count]->stopAndJoin();
+    proxyThreads_[count] = folly::make_unique<ProxyThread>(*this, count);
+  } else {
+    proxyThreads_.emplace_back(
+      folly::make_unique<ProxyThread>(*this, count));
+  }
+  auto& proxyThread = *proxyThreads_[count];
+
+  /* Configure the new proxy before publishing it: a published proxy can
+     be assigned clients right away and must be able to route. */
+  {
+    std::lock_guard<std::mutex> cfgLg(configReconfigLock_);
+    std::string config;
+    std::string path;
+    if (!configApi_->getConfigFile(config, path)) {
+      MC_LOG_FAILURE(opts(), failure::Category::kBadEnvironment,
+                     "Can not read config from {} for a new proxy thread",
+                     path);
+      return false;
+    }
+    try {
+      ProxyConfigBuilder builder(opts_, configApi(), config);
+      proxy_config_swap(&proxyThread.proxy(),
+                        builder.buildConfig(proxyThread.proxy()));
+    } catch (const std::exception& e) {
+      MC_LOG_FAILURE(opts(), failure::Category::kInvalidConfig,
+                     "Failed to configure a new proxy thread: {}", e.what());
+      return false;
+    }
+  }
+
+  try {
+    proxyThread.spawn();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Failed to start a new proxy thread: " << e.what();
+    return false;
+  }
+
+  proxyCount_.store(count + 1, std::memory_order_release);
+  VLOG(1) << "Added proxy thread " << count;
+  return true;
+}
+
+bool McrouterInstance::removeProxyThread() {
+  std::lock_guard<std::mutex> lg(proxyScalingMutex_);
+
+  if (!proxies_.empty()) {
+    LOG(ERROR) << "Can't remove a proxy thread: proxies run on "
+                  "caller-owned event bases";
+    return false;
+  }
+  auto count = proxyCount_.load();
+  if (count <= 1) {
+    LOG(WARNING) << "Can't remove the last proxy thread";
+    return false;
+  }
+
+  {
+    /* Unpublish first so no new client gets pinned to the retiring
+       proxy; clients already pinned keep it alive until they go away. */
+    std::lock_guard<std::mutex> guard(nextProxyMutex_);
+    proxyCount_.store(count - 1, std::memory_order_release);
+    if (nextProxy_ >= count - 1) {
+      nextProxy_ = 0;
+    }
+  }
+
+  proxyThreads_[count - 1]->beginRetirement();
+  VLOG(1) << "Retiring proxy thread " << (count - 1);
+  return true;
+}
+
 proxy_t::Pointer McrouterInstance::releaseProxy(size_t index) {
   assert(index < proxies_.size());
   return std::move(proxies_[index]);
@@ -312,10 +436,17 @@ McrouterInstance::McrouterInstance(McrouterOptions input_options) :
     opts_(std::move(input_options)),
     pid_(getpid()),
     configApi_(createConfigApi(opts_)),
-    asyncWriter_(folly::make_unique<AsyncWriter>()),
     statsLogWriter_(folly::make_unique<AsyncWriter>(
                       opts_.stats_async_queue_length)),
+    /* bounded so a shadow mismatch storm drops comparisons (counted by
+       shadow_validation_dropped) instead of buffering reply values */
+    shadowValidationWriter_(folly::make_unique<AsyncWriter>(1024)),
     leaseTokenMap_(folly::make_unique<LeaseTokenMap>(evbAuxiliaryThread_)) {
+  auto lanes = std::max<size_t>(1, opts_.asynclog_lanes);
+  asyncWriters_.reserve(lanes);
+  for (size_t i = 0; i < lanes; ++i) {
+    asyncWriters_.push_back(folly::make_unique<AsyncWriter>());
+  }
 }
 
 void McrouterInstance::shutdownImpl() noexcept {
@@ -353,13 +484,23 @@ void McrouterInstance::spawnAuxiliaryThreads() {
 
   startAwriterThreads();
   startObservingRuntimeVarsFile();
+  if (opts_.max_proxies > 0 && proxies_.empty() &&
+      !opts_.shared_connections) {
+    subscribeToProxyScalingVar();
+  }
   statUpdaterThread_ = std::thread(
     [this] () {
       statUpdaterThreadRun();
     });
   spawnStatLoggerThread();
+  if (!opts_.stats_export_socket_path.empty()) {
+    statsExporter_ = folly::make_unique<StatsExporter>(*this);
+    statsExporter_->start();
+  }
   if (opts_.cpu_cycles) {
-    cycles::startExtracting([this](cycles::CycleStats stats) {
+    cycles::setPerfEventsEnabled(opts_.cycles_perf_events);
+    cycles::registerStatsSink(
+        "mcrouter_stats", [this](const cycles::CycleStats& stats) {
       auto anyProxy = getProxy(0);
       if (anyProxy) {
         stat_set_uint64(anyProxy->stats, cycles_avg_stat, stats.avg);
@@ -371,21 +512,63 @@ void McrouterInstance::spawnAuxiliaryThreads() {
         stat_set_uint64(anyProxy->stats, cycles_p95_stat, stats.p95);
         stat_set_uint64(anyProxy->stats, cycles_p99_stat, stats.p99);
         stat_set_uint64(anyProxy->stats, cycles_num_stat, stats.numSamples);
+        if (opts_.cycles_perf_events) {
+          stat_set_uint64(
+              anyProxy->stats, cycles_llc_misses_stat, stats.llcMisses);
+          stat_set_uint64(
+              anyProxy->stats, cycles_stalled_stat, stats.stalledCycles);
+          stat_set_uint64(
+              anyProxy->stats, cycles_branch_misses_stat, stats.branchMisses);
+        }
       }
     });
+    cycles::startExtracting();
   }
 }
 
 void McrouterInstance::startAwriterThreads() {
   if (!opts_.asynclog_disable) {
-    if (!asyncWriter_->start("mcrtr-awriter")) {
-      throw std::runtime_error("failed to spawn mcrouter awriter thread");
+    for (size_t i = 0; i < asyncWriters_.size(); ++i) {
+      /* lane 0 keeps the historical name */
+      auto name = i == 0 ? std::string("mcrtr-awriter")
+                         : folly::to<std::string>("mcrtr-awriter", i);
+      if (!asyncWriters_[i]->start(name)) {
+        throw std::runtime_error("failed to spawn mcrouter awriter thread");
+      }
     }
   }
 
   if (!statsLogWriter_->start("mcrtr-statsw")) {
     throw std::runtime_error("failed to spawn mcrouter stats writer thread");
   }
+
+  if (!shadowValidationWriter_->start("mcrtr-shadowv")) {
+    throw std::runtime_error(
+        "failed to spawn mcrouter shadow validation thread");
+  }
+}
+
+void McrouterInstance::subscribeToProxyScalingVar() {
+  proxyScalingHandle_ = rtVarsData_.subscribe(
+    [this](std::shared_ptr<const RuntimeVarsData> /* oldVars */,
+           std::shared_ptr<const RuntimeVarsData> newVars) {
+      if (!newVars) {
+        return;
+      }
+      const auto* val = newVars->getVariablePtrByName("num_proxies");
+      if (val == nullptr) {
+        return;
+      }
+      if (!val->isInt() || val->asInt() < 1) {
+        LOG(ERROR) << "runtime vars: num_proxies must be a positive integer";
+        return;
+      }
+      auto target = static_cast<size_t>(val->asInt());
+      while (proxyCount() < target && addProxyThread()) {
+      }
+      while (proxyCount() > target && removeProxyThread()) {
+      }
+    });
 }
 
 void McrouterInstance::startObservingRuntimeVarsFile() {
@@ -434,12 +617,22 @@ void McrouterInstance::statUpdaterThreadRun() {
       }
     }
 
-    // to avoid inconsistence among proxies, we lock all mutexes together
-    for (size_t i = 0; i < opts_.num_proxies; ++i) {
+    /* Serialize with runtime proxy scaling for the rest of the cycle:
+       getProxy() re-checks the live count, so a concurrent retirement
+       would otherwise turn it nullptr between the lock and unlock
+       loops below (leaking a locked mutex), and a reap could destroy a
+       retired proxy while we hold its stats_lock. */
+    std::lock_guard<std::mutex> scalingLg(proxyScalingMutex_);
+    auto numProxies = proxyCount();
+
+    // The locks only guard the bins and window counters shared with
+    // stats queries; to avoid inconsistence among proxies, we lock all
+    // mutexes together.
+    for (size_t i = 0; i < numProxies; ++i) {
       getProxy(i)->stats_lock.lock();
     }
 
-    for (size_t i = 0; i < opts_.num_proxies; ++i) {
+    for (size_t i = 0; i < numProxies; ++i) {
       auto proxy = getProxy(i);
       if (proxy->num_bins_used < BIN_NUM) {
         ++proxy->num_bins_used;
@@ -447,18 +640,23 @@ void McrouterInstance::statUpdaterThreadRun() {
 
       for (int j = 0; j < num_stats; ++j) {
         if (proxy->stats[j].group & rate_stats) {
+          // rate stats are monotonic; bin the delta since the last
+          // snapshot, so the proxy's counter is never written from here
+          auto value =
+            stat_get_uint64(proxy->stats, static_cast<stat_name_t>(j));
+          auto delta = value - proxy->stats_prev_rate_value[j];
+          proxy->stats_prev_rate_value[j] = value;
           proxy->stats_num_within_window[j] -= proxy->stats_bin[j][idx];
-          proxy->stats_bin[j][idx] = proxy->stats[j].data.uint64;
-          proxy->stats_num_within_window[j] += proxy->stats_bin[j][idx];
-          proxy->stats[j].data.uint64 = 0;
+          proxy->stats_bin[j][idx] = delta;
+          proxy->stats_num_within_window[j] += delta;
         } else if (proxy->stats[j].group & max_stats) {
-          proxy->stats_bin[j][idx] = proxy->stats[j].data.uint64;
-          proxy->stats[j].data.uint64 = 0;
+          proxy->stats_bin[j][idx] = stat_fetch_reset_uint64(
+            proxy->stats, static_cast<stat_name_t>(j));
         }
       }
     }
 
-    for (size_t i = 0; i < opts_.num_proxies; ++i) {
+    for (size_t i = 0; i < numProxies; ++i) {
       getProxy(i)->stats_lock.unlock();
     }
 
@@ -472,8 +670,9 @@ void McrouterInstance::spawnStatLoggerThread() {
 }
 
 void McrouterInstance::joinAuxiliaryThreads() noexcept {
-  // unsubscribe from config update
+  // unsubscribe from config update and runtime var driven proxy scaling
   configUpdateHandle_.reset();
+  proxyScalingHandle_.reset();
   if (configApi_) {
     configApi_->stopObserving(pid_);
   }
@@ -491,20 +690,33 @@ void McrouterInstance::joinAuxiliaryThreads() noexcept {
 
   if (opts_.cpu_cycles) {
     cycles::stopExtracting();
+    /* The sink captures this instance; drop it before we go away. */
+    cycles::unregisterStatsSink("mcrouter_stats");
+  }
+
+  if (dictionaryTrainer_) {
+    dictionaryTrainer_->stop();
   }
 
   if (mcrouterLogger_) {
     mcrouterLogger_->stop();
   }
 
+  if (statsExporter_) {
+    statsExporter_->stop();
+  }
+
   stopAwriterThreads();
 
   evbAuxiliaryThread_.stop();
 }
 
 void McrouterInstance::stopAwriterThreads() noexcept {
-  asyncWriter_->stop();
+  for (auto& writer : asyncWriters_) {
+    writer->stop();
+  }
   statsLogWriter_->stop();
+  shadowValidationWriter_->stop();
 }
 
 bool McrouterInstance::reconfigure() {
@@ -538,9 +750,54 @@ bool McrouterInstance::reconfigure() {
   return success;
 }
 
+std::shared_ptr<AccessPoint> McrouterInstance::getAccessPoint(
+    folly::StringPiece apString,
+    mc_protocol_t protocol,
+    bool useSsl,
+    uint16_t portOverride,
+    bool compressed) {
+  auto key = folly::to<std::string>(
+    apString, '|', static_cast<int>(protocol), '|', useSsl, '|',
+    portOverride, '|', compressed);
+
+  std::lock_guard<std::mutex> lock(accessPointCacheLock_);
+  auto it = accessPointCache_.find(key);
+  if (it != accessPointCache_.end()) {
+    return it->second;
+  }
+  auto ap = AccessPoint::create(apString, protocol, useSsl, portOverride,
+                                compressed);
+  if (ap) {
+    accessPointCache_.emplace(key, ap);
+  }
+  return ap;
+}
+
+void McrouterInstance::pruneAccessPointCache() {
+  std::lock_guard<std::mutex> lock(accessPointCacheLock_);
+  for (auto it = accessPointCache_.begin();
+       it != accessPointCache_.end();) {
+    if (it->second.unique()) {
+      it = accessPointCache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 bool McrouterInstance::configure(folly::StringPiece input) {
   VLOG_IF(0, !opts_.constantly_reload_configs) << "started reconfiguring";
+
+  /* Proxies added while this runs are configured by addProxyThread()
+     itself (both paths hold configReconfigLock_). */
+  const auto numProxies = proxyCount();
+
+  // Configs dropped by earlier generations have been released by now;
+  // forget access points that no destination references anymore.
+  pruneAccessPointCache();
+
   std::vector<std::shared_ptr<ProxyConfig>> newConfigs;
+  std::string expandedDigest;
   try {
     // assume default_route, default_region and default_cluster are same for
     // each proxy
@@ -549,8 +806,62 @@ bool McrouterInstance::configure(folly::StringPiece input) {
       configApi(),
       input);
 
-    for (size_t i = 0; i < opts_.num_proxies; i++) {
-      newConfigs.push_back(builder.buildConfig(*getProxy(i)));
+    // Route trees are a function of the expanded config only, so a push
+    // whose expanded config is identical to the running one (changed
+    // comments, reordered macro definitions, a touched but unchanged
+    // import) doesn't need a rebuild.
+    folly::json::serialization_opts jsonOpts;
+    jsonOpts.sort_keys = true;
+    expandedDigest = Md5Hash(
+      folly::json::serialize(builder.preprocessedConfig(), jsonOpts));
+    bool sameConfig = (expandedDigest == lastExpandedConfigDigest_);
+    for (size_t i = 0; sameConfig && i < numProxies; ++i) {
+      sameConfig = (getProxy(i)->getConfig() != nullptr);
+    }
+    if (sameConfig) {
+      VLOG_IF(0, !opts_.constantly_reload_configs)
+        << "expanded config is unchanged, reusing current route trees";
+      return true;
+    }
+
+    newConfigs.resize(numProxies);
+
+    // Route trees of different proxies are built independently: the only
+    // state shared between builds is PoolFactory, which is thread-safe.
+    // Large configs take seconds to build per proxy, so spread the builds
+    // over several threads.
+    size_t numThreads = std::min<size_t>(
+      numProxies,
+      std::max<size_t>(1, std::thread::hardware_concurrency()));
+
+    if (numThreads <= 1) {
+      for (size_t i = 0; i < numProxies; i++) {
+        newConfigs[i] = builder.buildConfig(*getProxy(i));
+      }
+    } else {
+      std::atomic<size_t> nextProxy(0);
+      std::vector<std::exception_ptr> errors(numThreads);
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t] () {
+          try {
+            size_t i;
+            while ((i = nextProxy.fetch_add(1)) < numProxies) {
+              newConfigs[i] = builder.buildConfig(*getProxy(i));
+            }
+          } catch (...) {
+            errors[t] = std::current_exception();
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      for (const auto& error : errors) {
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      }
     }
   } catch (const std::exception& e) {
     MC_LOG_FAILURE(opts(), failure::Category::kInvalidConfig,
@@ -558,12 +869,22 @@ bool McrouterInstance::configure(folly::StringPiece input) {
     return false;
   }
 
-  for (size_t i = 0; i < opts_.num_proxies; i++) {
+  for (size_t i = 0; i < numProxies; i++) {
     proxy_config_swap(getProxy(i), newConfigs[i]);
   }
+  lastExpandedConfigDigest_ = std::move(expandedDigest);
+
+  if (opts_.dns_prefetch_deadline_ms > 0) {
+    /* Resolve hostnames of newly configured destinations in parallel so
+       the first connections don't each pay a blocking lookup on their
+       proxy's event loop. Laggards finish in the background; we never
+       block reconfiguration on a dead DNS server longer than this. */
+    HostResolver::instance().resolvePending(
+        std::chrono::milliseconds(opts_.dns_prefetch_deadline_ms));
+  }
 
   VLOG_IF(0, !opts_.constantly_reload_configs) <<
-      "reconfigured " << opts_.num_proxies << " proxies with " <<
+      "reconfigured " << numProxies << " proxies with " <<
       newConfigs[0]->getPools().size() << " pools, " <<
       newConfigs[0]->calcNumClients() << " clients " <<
       newConfigs[0]->getConfigMd5Digest() << ")";
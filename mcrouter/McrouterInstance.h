@@ -15,7 +15,9 @@
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/Range.h>
 
@@ -23,6 +25,8 @@
 #include "mcrouter/ConfigApi.h"
 #include "mcrouter/LeaseTokenMap.h"
 #include "mcrouter/lib/CompressionCodecManager.h"
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
+#include "mcrouter/lib/network/AccessPoint.h"
 #include "mcrouter/McrouterClient.h"
 #include "mcrouter/Observable.h"
 #include "mcrouter/options.h"
@@ -35,6 +39,7 @@ class AsyncWriter;
 class McrouterManager;
 class ProxyThread;
 class RuntimeVarsData;
+class StatsExporter;
 using ObservableRuntimeVars =
   Observable<std::shared_ptr<const RuntimeVarsData>>;
 
@@ -128,11 +133,39 @@ class McrouterInstance :
   void shutdown() noexcept;
 
   /**
-   * @return  nullptr if index is >= opts.num_proxies,
+   * @return  nullptr if index is >= proxyCount(),
    *   pointer to the proxy otherwise.
    */
   proxy_t* getProxy(size_t index) const;
 
+  /**
+   * @return  Current number of live proxies. Starts at opts().num_proxies
+   *   and only changes through addProxyThread()/removeProxyThread().
+   */
+  size_t proxyCount() const {
+    return proxyCount_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Spawns one more proxy thread at runtime: the proxy is created,
+   * configured from the current config and included in round-robin
+   * assignment of new clients. Only supported when mcrouter owns its
+   * proxy threads and up to the --max-proxies bound.
+   *
+   * @return  True if a thread was added.
+   */
+  bool addProxyThread();
+
+  /**
+   * Retires the highest-indexed proxy thread: it's excluded from new
+   * client assignment immediately and exits on its own once the clients
+   * still pinned to it disconnect and in-flight work drains. Its slot is
+   * reaped by a later addProxyThread() or at shutdown.
+   *
+   * @return  True if a thread was retired.
+   */
+  bool removeProxyThread();
+
   /**
    * Release ownership of a proxy
    */
@@ -165,6 +198,21 @@ class McrouterInstance :
     return tkoTrackerMap_;
   }
 
+  /**
+   * Returns the shared AccessPoint for the given server string and parse
+   * options, creating it on first use. AccessPoints are immutable, so all
+   * proxies (and successive config generations) share one instance per
+   * destination instead of holding per-proxy copies.
+   *
+   * @return shared AccessPoint, nullptr if apString is invalid.
+   */
+  std::shared_ptr<AccessPoint> getAccessPoint(
+    folly::StringPiece apString,
+    mc_protocol_t protocol,
+    bool useSsl,
+    uint16_t portOverride,
+    bool compressed);
+
   LeaseTokenMap& leaseTokenMap() {
     return *leaseTokenMap_;
   }
@@ -174,8 +222,21 @@ class McrouterInstance :
   }
 
   AsyncWriter& asyncWriter() {
-    assert(asyncWriter_.get() != nullptr);
-    return *asyncWriter_;
+    return asynclogWriter(0);
+  }
+
+  /**
+   * @return  Writer thread of the given asynclog lane (see
+   *          asynclog_lane()). Lane 0 doubles as the general-purpose
+   *          background writer returned by asyncWriter().
+   */
+  AsyncWriter& asynclogWriter(size_t lane) {
+    assert(lane < asyncWriters_.size());
+    return *asyncWriters_[lane];
+  }
+
+  size_t asynclogLaneCount() const {
+    return asyncWriters_.size();
   }
 
   AsyncWriter& statsLogWriter() {
@@ -183,6 +244,15 @@ class McrouterInstance :
     return *statsLogWriter_;
   }
 
+  /**
+   * @return  Writer thread that compares shadow replies with production
+   *          replies off the proxy threads (see ShadowRoute).
+   */
+  AsyncWriter& shadowValidationWriter() {
+    assert(shadowValidationWriter_.get() != nullptr);
+    return *shadowValidationWriter_;
+  }
+
   McrouterInstance(const McrouterInstance&) = delete;
   McrouterInstance& operator=(const McrouterInstance&) = delete;
   McrouterInstance(McrouterInstance&&) noexcept = delete;
@@ -215,6 +285,27 @@ class McrouterInstance :
     return compressionCodecManager_.get();
   }
 
+  /**
+   * Returns the online compression dictionary trainer, or nullptr if
+   * dictionary training is disabled
+   * (see --compression-dictionary-training-interval).
+   */
+  CompressionDictionaryTrainer* dictionaryTrainer() const {
+    return dictionaryTrainer_.get();
+  }
+
+  /**
+   * Sets the sink for freshly trained compression dictionaries. The
+   * callback is expected to feed the deployment's codec config
+   * pipeline, which assigns the next codec id and distributes the
+   * dictionary to both ends (see CompressionDictionaryTrainer).
+   * Must be called before spinning the router up.
+   */
+  void setDictionaryTrainedCallback(
+      CompressionDictionaryTrainer::OnDictionaryTrainedFn callback) {
+    onDictionaryTrained_ = std::move(callback);
+  }
+
  private:
   const McrouterOptions opts_;
 
@@ -223,6 +314,14 @@ class McrouterInstance :
   std::mutex nextProxyMutex_;
   unsigned int nextProxy_{0};
 
+  /**
+   * Number of live proxies, i.e. proxies eligible for client assignment.
+   * Retired proxy threads stay in proxyThreads_ past this count until
+   * their slot is reaped. Writes are serialized by proxyScalingMutex_.
+   */
+  std::atomic<size_t> proxyCount_{0};
+  std::mutex proxyScalingMutex_;
+
   std::unique_ptr<ConfigApi> configApi_;
   CallbackPool<> onReconfigureSuccess_;
 
@@ -234,10 +333,20 @@ class McrouterInstance :
   // Lock to get before regenerating config structure
   std::mutex configReconfigLock_;
 
+  /**
+   * Md5 digest of the last successfully applied config after macro
+   * expansion. Config pushes whose expanded config is identical to the
+   * running one (e.g. comment-only changes) skip the route tree rebuild.
+   */
+  std::string lastExpandedConfigDigest_;
+
   LogPostprocessCallbackFunc postprocessCallback_;
 
   std::unique_ptr<const CompressionCodecManager> compressionCodecManager_;
 
+  std::unique_ptr<CompressionDictionaryTrainer> dictionaryTrainer_;
+  CompressionDictionaryTrainer::OnDictionaryTrainedFn onDictionaryTrained_;
+
   // Stat updater thread updates rate stat windows for each proxy
   std::thread statUpdaterThread_;
 
@@ -246,6 +355,13 @@ class McrouterInstance :
 
   TkoTrackerMap tkoTrackerMap_;
 
+  // Access points shared across proxies and config generations, keyed
+  // by server string and parse options. Entries referenced only by the
+  // cache are pruned on reconfiguration.
+  std::mutex accessPointCacheLock_;
+  folly::StringKeyedUnorderedMap<std::shared_ptr<AccessPoint>>
+    accessPointCache_;
+
   // Stores data for runtime variables.
   ObservableRuntimeVars rtVarsData_;
 
@@ -255,13 +371,22 @@ class McrouterInstance :
    */
   std::unique_ptr<McrouterLogger> mcrouterLogger_;
 
+  /**
+   * Pushes delta-encoded stats to subscribers on
+   * opts->stats_export_socket_path
+   */
+  std::unique_ptr<StatsExporter> statsExporter_;
+
   /*
-   * Asynchronous writer.
+   * Asynchronous writers, one per asynclog lane (--asynclog-lanes).
+   * Sized in the constructor and never resized after.
    */
-  std::unique_ptr<AsyncWriter> asyncWriter_;
+  std::vector<std::unique_ptr<AsyncWriter>> asyncWriters_;
 
   std::unique_ptr<AsyncWriter> statsLogWriter_;
 
+  std::unique_ptr<AsyncWriter> shadowValidationWriter_;
+
   std::atomic<bool> shutdownStarted_{false};
 
   // Auxiliary EventBase thread.
@@ -272,17 +397,22 @@ class McrouterInstance :
 
   ConfigApi::CallbackHandle configUpdateHandle_;
 
+  /** Follows the 'num_proxies' runtime variable (see --max-proxies). */
+  ObservableRuntimeVars::CallbackHandle proxyScalingHandle_;
+
   std::unordered_map<std::string, std::string> additionalStartupOpts_;
 
   /**
-   * Exactly one of these vectors will contain opts.num_proxies elements,
-   * others will be empty.
+   * Exactly one of these vectors will be non-empty.
    *
    * Standalone/sync mode: we don't startup proxy threads, so Mcrouter
    * owns the proxies directly.
    *
    * Embedded mode: Mcrouter owns ProxyThreads, which managed the lifetime
-   * of proxies on their own threads.
+   * of proxies on their own threads. With runtime scaling enabled
+   * (--max-proxies) the vector may also hold retired threads at indices
+   * past proxyCount(); it never reallocates, the full capacity is
+   * reserved up front.
    */
   std::vector<proxy_t::Pointer> proxies_;
   std::vector<std::unique_ptr<ProxyThread>> proxyThreads_;
@@ -310,9 +440,13 @@ class McrouterInstance :
 
   void subscribeToConfigUpdate();
 
+  /** Drops cached access points that no destination references anymore. */
+  void pruneAccessPointCache();
+
   void statUpdaterThreadRun();
   void spawnStatLoggerThread();
   void startObservingRuntimeVarsFile();
+  void subscribeToProxyScalingVar();
 
   /** (re)configure the router. true on success, false on error.
       NB file-based configuration is synchronous
@@ -9,6 +9,7 @@
  */
 #include "McrouterLogger.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -19,9 +20,12 @@
 #include <boost/filesystem/path.hpp>
 
 #include <folly/DynamicConverter.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/json.h>
 #include <folly/ThreadName.h>
 
+#include "mcrouter/awriter.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/McrouterInstance.h"
@@ -34,6 +38,7 @@ namespace facebook { namespace memcache { namespace mcrouter {
 namespace {
 
 const char* kStatsSfx = "stats";
+const char* kStatsDeltaSfx = "stats_delta";
 const char* kStatsStartupOptionsSfx = "startup_options";
 const char* kConfigSourcesInfoFileName = "config_sources_info";
 
@@ -135,6 +140,7 @@ McrouterLogger::McrouterLogger(McrouterInstance& router,
   std::unique_ptr<AdditionalLoggerIf> additionalLogger)
     : router_(router),
       additionalLogger_(std::move(additionalLogger)),
+      statsDeltaWriter_(router.opts().logging_rtt_outlier_threshold_us != 0),
       pid_(getpid()) {
 }
 
@@ -233,7 +239,11 @@ void McrouterLogger::log() {
     }
   }
 
-  write_stats_to_disk(router_.opts(), stats);
+  if (router_.opts().stats_binary_delta_format) {
+    logStatsDelta(stats);
+  } else {
+    write_stats_to_disk(router_.opts(), stats);
+  }
   write_config_sources_info_to_disk(router_);
 
   for (const auto& filepath : touchStatsFilepaths_) {
@@ -245,4 +255,45 @@ void McrouterLogger::log() {
   }
 }
 
+void McrouterLogger::logStatsDelta(const std::vector<stat_t>& stats) {
+  const auto& opts = router_.opts();
+
+  if (!statsDeltaFile_) {
+    if (!ensureDirExistsAndWritable(opts.stats_root)) {
+      return;
+    }
+    auto path = stats_file_path(opts, kStatsDeltaSfx);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (fd < 0) {
+      VLOG(1) << "Failed to open stats delta spool " << path << ": "
+              << strerror(errno);
+      return;
+    }
+    statsDeltaFile_ = std::make_shared<folly::File>(fd, true);
+  }
+
+  struct timeval timestamp;
+  CHECK(gettimeofday(&timestamp, nullptr) == 0);
+  const auto timestampMs =
+    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
+
+  /* Unqueued bytes from an earlier tick go out first so that the spool
+     never skips a delta. */
+  auto record = std::make_shared<std::string>(std::move(pendingStatsDelta_));
+  pendingStatsDelta_.clear();
+  statsDeltaWriter_.appendTick(stats, timestampMs, *record);
+
+  auto file = statsDeltaFile_;
+  auto queued = router_.statsLogWriter().run([file, record]() {
+    auto written = folly::writeFull(file->fd(), record->data(),
+                                    record->size());
+    if (written == -1 || size_t(written) < record->size()) {
+      VLOG(1) << "Error writing stats delta spool";
+    }
+  });
+  if (!queued) {
+    pendingStatsDelta_ = std::move(*record);
+  }
+}
+
 }}}  // facebook::memcache::mcrouter
@@ -17,10 +17,15 @@
 #include <thread>
 #include <vector>
 
+#include "mcrouter/StatsDeltaFormat.h"
+
+namespace folly {
+class File;
+} // folly
+
 namespace facebook { namespace memcache { namespace mcrouter {
 
 class McrouterInstance;
-class stat_t;
 
 class AdditionalLoggerIf {
 public:
@@ -74,6 +79,16 @@ class McrouterLogger {
    */
   std::vector<std::string> touchStatsFilepaths_;
 
+  /**
+   * State of the binary delta stats spool (--stats-binary-delta-format):
+   * the delta writer, the spool file shared with the async writer thread,
+   * and any serialized bytes that couldn't be queued yet (retried with
+   * the next tick so the reader never misses a delta).
+   */
+  StatsDeltaWriter statsDeltaWriter_;
+  std::shared_ptr<folly::File> statsDeltaFile_;
+  std::string pendingStatsDelta_;
+
   pid_t pid_;
   std::thread loggerThread_;
   std::mutex loggerThreadMutex_;
@@ -87,6 +102,12 @@ class McrouterLogger {
    */
   void log();
 
+  /**
+   * Appends one binary delta record for this tick to the stats spool
+   * through the async stats writer (see StatsDeltaFormat.h).
+   */
+  void logStatsDelta(const std::vector<stat_t>& stats);
+
   /**
    * Writes startup options.
    */
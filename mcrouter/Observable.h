@@ -47,7 +47,8 @@ class Observable {
    * the data is updated. The callback is unsubscribed when returned
    * CallbackHandle is destroyed.
    * NOTE: callbacks can run in parallel. It is up to user to synchronize
-   * callbacks.
+   * callbacks. Destroying the handle doesn't wait for a set() that is
+   * already notifying on another thread (see CallbackPool).
    */
   inline CallbackHandle subscribe(OnUpdateOldNew callback);
 
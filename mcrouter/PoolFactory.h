@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <mutex>
+
 #include <folly/dynamic.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 
@@ -38,6 +40,8 @@ class PoolFactory {
 
   /**
    * Load pool from ConfigApi, expand `inherit`, etc.
+   * Thread-safe: may be called concurrently when route trees of several
+   * proxies are built in parallel.
    *
    * @param json pool json
    *
@@ -51,6 +55,10 @@ class PoolFactory {
     PARSING,
     PARSED
   };
+  // protects pools_. Parsed pool json is never mutated once in PARSED
+  // state and the map is node-based, so returned references stay valid
+  // without the lock.
+  std::mutex mutex_;
   folly::StringKeyedUnorderedMap<std::pair<folly::dynamic, PoolState>> pools_;
   ConfigApiIf& configApi_;
 
@@ -13,6 +13,7 @@
 #include <folly/dynamic.h>
 #include <folly/json.h>
 
+#include "mcrouter/KeyspaceStats.h"
 #include "mcrouter/lib/config/RouteHandleFactory.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/PoolFactory.h"
@@ -21,10 +22,14 @@
 #include "mcrouter/routes/PrefixSelectorRoute.h"
 #include "mcrouter/routes/ProxyRoute.h"
 #include "mcrouter/routes/RouteSelectorMap.h"
+#include "mcrouter/routes/SwappableRoute.h"
 #include "mcrouter/ServiceInfo.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+McrouterRouteHandlePtr makeErrorRoute(std::string valueToSet);
+McrouterRouteHandlePtr makeNullRoute();
+
 ProxyConfig::ProxyConfig(proxy_t& proxy,
                          const folly::dynamic& json,
                          std::string configMd5Digest,
@@ -51,6 +56,11 @@ ProxyConfig::ProxyConfig(proxy_t& proxy,
     }
   }
 
+  if (auto jKeyspaces = json.get_ptr("keyspaces")) {
+    keyspaceStats_ =
+        std::make_shared<KeyspaceStats>(*jKeyspaces, proxy.keyspaceCounters);
+  }
+
   RouteSelectorMap routeSelectors;
 
   auto jRoute = json.get_ptr("route");
@@ -92,7 +102,11 @@ ProxyConfig::ProxyConfig(proxy_t& proxy,
   asyncLogRoutes_ = provider.releaseAsyncLogRoutes();
   pools_ = provider.releasePools();
   accessPoints_ = provider.releaseAccessPoints();
+  swappableRoutes_ = provider.releaseSwappableRoutes();
+  rtVarsSubscriptions_ = provider.releaseRuntimeVarsSubscriptions();
   proxyRoute_ = std::make_shared<ProxyRoute>(&proxy, routeSelectors);
+  routeHandlesMayBlock_ = proxyRoute_->mayBlock();
+  routeHandlesMaxDepth_ = proxyRoute_->maxDepth();
   serviceInfo_ = std::make_shared<ServiceInfo>(&proxy, *this);
 }
 
@@ -101,6 +115,42 @@ ProxyConfig::getRouteHandleForAsyncLog(folly::StringPiece asyncLogName) const {
   return tryGet(asyncLogRoutes_, asyncLogName);
 }
 
+size_t ProxyConfig::swapPoolRoute(folly::StringPiece poolName,
+                                  folly::StringPiece target) {
+  auto it = swappableRoutes_.find(poolName);
+  checkLogic(it != swappableRoutes_.end(),
+             "pool_swap: unknown pool '{}' (is --enable-pool-route-swap on?)",
+             poolName);
+
+  if (target == "reset") {
+    for (auto& swapTarget : it->second) {
+      swapTarget->reset();
+    }
+    return it->second.size();
+  }
+
+  McrouterRouteHandlePtr rh;
+  if (target == "null") {
+    rh = makeNullRoute();
+  } else if (target == "error") {
+    rh = makeErrorRoute("swapped out by pool_swap");
+  } else if (target.startsWith("pool:")) {
+    auto otherPool = target.subpiece(sizeof("pool:") - 1);
+    auto otherIt = swappableRoutes_.find(otherPool);
+    checkLogic(otherIt != swappableRoutes_.end() && !otherIt->second.empty(),
+               "pool_swap: unknown target pool '{}'", otherPool);
+    rh = otherIt->second.front()->target();
+  } else {
+    throwLogic("pool_swap: invalid target '{}'; "
+               "expected null, error, reset or pool:<name>", target);
+  }
+
+  for (auto& swapTarget : it->second) {
+    swapTarget->swap(rh);
+  }
+  return it->second.size();
+}
+
 size_t ProxyConfig::calcNumClients() const {
   size_t result = 0;
   for (const auto& it : pools_) {
@@ -11,10 +11,12 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Range.h>
 
+#include "mcrouter/Observable.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace folly {
@@ -23,10 +25,15 @@ struct dynamic;
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+class KeyspaceStats;
 class PoolFactory;
 class ProxyRoute;
+class RuntimeVarsData;
 class ServiceInfo;
+class SwappableRouteTarget;
 struct proxy_t;
+using ObservableRuntimeVars =
+  Observable<std::shared_ptr<const RuntimeVarsData>>;
 
 /**
  * Topmost struct for mcrouter configs.
@@ -37,10 +44,36 @@ class ProxyConfig {
     return *proxyRoute_;
   }
 
+  /**
+   * True if routing through this config's route handle tree may suspend
+   * the calling fiber.  Computed once at config build time; when false,
+   * requests can be routed directly in the main context.
+   */
+  bool routeHandlesMayBlock() const {
+    return routeHandlesMayBlock_;
+  }
+
+  /**
+   * Upper bound on this config's route handle tree depth, or
+   * kUnknownRouteDepth if some route can't bound its subtree.  Used to
+   * run requests routed through shallow trees on small-stack fibers.
+   */
+  size_t routeHandlesMaxDepth() const {
+    return routeHandlesMaxDepth_;
+  }
+
   std::shared_ptr<ServiceInfo> serviceInfo() const {
     return serviceInfo_;
   }
 
+  /**
+   * Per-namespace hit/miss accounting for this config's "keyspaces"
+   * table, or nullptr if the config doesn't define one.
+   */
+  const KeyspaceStats* keyspaceStats() const {
+    return keyspaceStats_.get();
+  }
+
   std::string getConfigMd5Digest() const {
     return configMd5Digest_;
   }
@@ -61,15 +94,43 @@ class ProxyConfig {
 
   size_t calcNumClients() const;
 
+  const folly::StringKeyedUnorderedMap<
+    std::vector<std::shared_ptr<SwappableRouteTarget>>
+  >& getSwappableRoutes() const {
+    return swappableRoutes_;
+  }
+
+  /**
+   * Redirects poolName's traffic at runtime (see SwappableRoute).
+   * target is "null", "error", "reset" or "pool:<name>".  Only affects
+   * this config's tree, so it must run on the owning proxy thread.
+   *
+   * @return  Number of route handles swapped.
+   * @throws  std::logic_error on unknown pool or invalid target.
+   */
+  size_t swapPoolRoute(folly::StringPiece poolName, folly::StringPiece target);
+
  private:
   std::shared_ptr<ProxyRoute> proxyRoute_;
+  bool routeHandlesMayBlock_{true};
+  size_t routeHandlesMaxDepth_{kUnknownRouteDepth};
   std::shared_ptr<ServiceInfo> serviceInfo_;
+  std::shared_ptr<KeyspaceStats> keyspaceStats_;
   std::string configMd5Digest_;
   folly::StringKeyedUnorderedMap<McrouterRouteHandlePtr> asyncLogRoutes_;
   folly::StringKeyedUnorderedMap<std::vector<McrouterRouteHandlePtr>> pools_;
   folly::StringKeyedUnorderedMap<
     std::vector<std::shared_ptr<const AccessPoint>>
   > accessPoints_;
+  folly::StringKeyedUnorderedMap<
+    std::vector<std::shared_ptr<SwappableRouteTarget>>
+  > swappableRoutes_;
+
+  /**
+   * Runtime-vars subscriptions owned by this config (live pool weights);
+   * destroying the config unsubscribes them.
+   */
+  std::vector<ObservableRuntimeVars::CallbackHandle> rtVarsSubscriptions_;
 
   /**
    * Parses config and creates ProxyRoute
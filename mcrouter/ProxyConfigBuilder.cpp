@@ -9,10 +9,14 @@
  */
 #include "ProxyConfigBuilder.h"
 
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
 #include <folly/json.h>
 
 #include "mcrouter/config.h"
 #include "mcrouter/ConfigApi.h"
+#include "mcrouter/lib/config/CompiledConfigCache.h"
 #include "mcrouter/lib/config/ConfigPreprocessor.h"
 #include "mcrouter/lib/fbi/cpp/globals.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
@@ -45,14 +49,47 @@ ProxyConfigBuilder::ProxyConfigBuilder(const McrouterOptions& opts,
     globalParams.emplace(param.first, param.second);
   }
 
-  json_ = ConfigPreprocessor::getConfigWithoutMacros(
-    jsonC,
-    importResolver,
-    std::move(globalParams));
+  configMd5Digest_ = Md5Hash(jsonC);
 
-  poolFactory_ = folly::make_unique<PoolFactory>(json_, configApi);
+  // The expanded config is a function of the config source and global
+  // params; files pulled in via @import are validated separately against
+  // the digests recorded in the cache.
+  std::string sourceDigest;
+  if (!opts.compiled_config_path.empty()) {
+    folly::dynamic params = folly::dynamic::object();
+    for (const auto& param : globalParams) {
+      params.insert(param.first.str(), param.second);
+    }
+    folly::json::serialization_opts jsonOpts;
+    jsonOpts.sort_keys = true;
+    sourceDigest = Md5Hash(folly::to<std::string>(
+      configMd5Digest_, "|", folly::json::serialize(params, jsonOpts)));
 
-  configMd5Digest_ = Md5Hash(jsonC);
+    if (auto cached = loadCompiledConfig(opts.compiled_config_path,
+                                         sourceDigest,
+                                         importResolver)) {
+      json_ = std::move(*cached);
+    }
+  }
+
+  if (json_.isNull()) {
+    TrackingImportResolver trackingResolver(importResolver);
+    json_ = ConfigPreprocessor::getConfigWithoutMacros(
+      jsonC,
+      trackingResolver,
+      std::move(globalParams));
+
+    if (!opts.compiled_config_path.empty() &&
+        !storeCompiledConfig(opts.compiled_config_path,
+                             sourceDigest,
+                             trackingResolver.importDigests(),
+                             json_)) {
+      LOG(WARNING) << "Can not write compiled config to "
+                   << opts.compiled_config_path;
+    }
+  }
+
+  poolFactory_ = folly::make_unique<PoolFactory>(json_, configApi);
 }
 
 std::shared_ptr<ProxyConfig>
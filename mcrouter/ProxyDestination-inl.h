@@ -7,8 +7,12 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Optional.h>
+
 #include "mcrouter/config-impl.h"
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/McrouterFiberContext.h"
 #include "mcrouter/proxy.h"
 #include "mcrouter/ProxyDestinationMap.h"
 
@@ -18,10 +22,53 @@ template <class Request>
 ReplyT<Request> ProxyDestination::send(const Request& request,
                                        DestinationRequestCtx& req_ctx,
                                        std::chrono::milliseconds timeout) {
+  if (auto ownerProxy = sharedConnectionOwner()) {
+    return sendShared(*ownerProxy, request, req_ctx, timeout);
+  }
   proxy->destinationMap->markAsActive(*this);
-  auto reply = getAsyncMcClient().sendSync(request, timeout);
+  /* Offer the value to the dictionary trainer. The countdown gate keeps
+     this off the request path for all but one in ~1k requests. */
+  if (UNLIKELY(dictionaryTrainer_ && dictionaryTrainer_->shouldSample())) {
+    dictionaryTrainer_->sample(poolName_, request.valueRangeSlow());
+  }
+  /* Adjusted here, after the shared-connection hand-off, so the static
+     timeout still keys the owner's destination map lookup. */
+  auto reply = getAsyncMcClient().sendSync(
+      request, adjustedTimeout(timeout), fiber_local::getRequestAborter().get());
   onReply(reply.result(), req_ctx);
   return reply;
 }
 
+template <class Request>
+ReplyT<Request> ProxyDestination::sendShared(
+    proxy_t& ownerProxy,
+    const Request& request,
+    DestinationRequestCtx& req_ctx,
+    std::chrono::milliseconds timeout) {
+  folly::fibers::Baton baton;
+  folly::Optional<ReplyT<Request>> reply;
+  auto ap = accessPoint_;
+  const auto qosClass = qosClass_;
+  const auto qosPath = qosPath_;
+  ownerProxy.fiberManager.addTaskRemote(
+    [&baton, &reply, &request, &ownerProxy, ap, qosClass, qosPath,
+     timeout]() {
+      /* Resolve (and, the first time, create) the owner's destination
+         on the owner thread; its maps and stats are thread-local. */
+      auto dstn = ownerProxy.destinationMap->find(*ap, timeout);
+      if (!dstn) {
+        dstn = ownerProxy.destinationMap->emplace(
+            std::make_shared<AccessPoint>(*ap), timeout, qosClass, qosPath);
+      }
+      DestinationRequestCtx dctx(nowUs());
+      reply.emplace(dstn->send(request, dctx, timeout));
+      baton.post();
+    });
+  baton.wait();
+  /* The owner's send() already did the TKO and latency accounting;
+     only the request timeline is recorded here. */
+  req_ctx.endTime = nowUs();
+  return std::move(*reply);
+}
+
 }}}  // facebook::memcache::mcrouter
@@ -9,18 +9,23 @@
  */
 #include "ProxyDestination.h"
 
+#include <algorithm>
+
 #include <folly/fibers/Fiber.h>
+#include <folly/Hash.h>
 #include <folly/Memory.h>
 
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/McResUtil.h"
 #include "mcrouter/lib/network/AsyncMcClient.h"
+#include "mcrouter/lib/network/HostResolver.h"
 #include "mcrouter/lib/network/ThreadLocalSSLContextProvider.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/OptionsUtil.h"
 #include "mcrouter/routes/DestinationRoute.h"
 #include "mcrouter/stats.h"
+#include "mcrouter/TkoEventRing.h"
 #include "mcrouter/TkoTracker.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -35,6 +40,25 @@ constexpr double kProbeJitterDelta = kProbeJitterMax - kProbeJitterMin;
 static_assert(kProbeJitterMax >= kProbeJitterMin,
               "ProbeJitterMax should be greater or equal tham ProbeJitterMin");
 
+/* Replies per adaptive timeout window; the p99 estimate is re-derived
+   and restarted after this many samples. */
+constexpr uint64_t kAdaptiveTimeoutWindow = 1000;
+/* Margin of error for the latency quantile estimate. */
+constexpr double kAdaptiveTimeoutEps = 0.005;
+
+/* The send path's working set (the hot block up to stats_) should stay
+   within two cache lines. Member sizes rather than offsets are summed
+   here because offsetof is not usable on a polymorphic type; padding
+   between these small members is negligible. */
+static_assert(sizeof(std::unique_ptr<AsyncMcClient>) +
+                  sizeof(std::shared_ptr<const AccessPoint>) +
+                  sizeof(folly::SpinLock) +
+                  sizeof(std::chrono::milliseconds) +
+                  4 * sizeof(uint64_t) + /* magic_, hot window counters */
+                  sizeof(int64_t) /* lastUsedUs_ */
+              <= 2 * 64,
+              "ProxyDestination hot block should fit in two cache lines");
+
 stat_name_t getStatName(ProxyDestination::State st) {
   switch (st) {
     case ProxyDestination::State::kNew:
@@ -67,20 +91,18 @@ void ProxyDestination::schedule_next_probe() {
     probe_delay_next_ms = proxy->router().opts().probe_delay_max_ms;
   }
 
-  // Calculate random jitter
-  double r = (double)rand() / (double)RAND_MAX;
+  // Calculate random jitter (we run on proxy's thread, so its
+  // generator is safe to use here)
+  double r = proxy->randomGenerator.randomDouble01();
   double tmo_jitter_pct = r * kProbeJitterDelta + kProbeJitterMin;
   delay_ms = (double)delay_ms * (1.0 + tmo_jitter_pct);
   assert(delay_ms > 0);
 
-  if (!probeTimer_.scheduleTimeout(delay_ms)) {
-    MC_LOG_FAILURE(proxy->router().opts(),
-                   memcache::failure::Category::kSystemError,
-                   "failed to schedule probe timer for ProxyDestination");
-  }
+  proxy->destinationMap->scheduleProbe(*this,
+                                       std::chrono::milliseconds(delay_ms));
 }
 
-void ProxyDestination::timerCallback() {
+void ProxyDestination::timeoutExpired() noexcept {
   // Note that the previous probe might still be in flight
   if (!probe_req) {
     probe_req =
@@ -106,19 +128,42 @@ void ProxyDestination::timerCallback() {
 
 void ProxyDestination::start_sending_probes() {
   probe_delay_next_ms = proxy->router().opts().probe_delay_initial_ms;
-  probeTimer_.attachEventBase(std::addressof(proxy->eventBase()));
   schedule_next_probe();
 }
 
 void ProxyDestination::stop_sending_probes() {
   stats_.probesSent = 0;
+  cancelTimeout();
+}
 
-  // Cancel timeout before calling detachEventBase to prevent an assert failure.
-  probeTimer_.cancelTimeout();
+proxy_t* ProxyDestination::sharedConnectionOwner() {
+  const auto& opts = proxy->router().opts();
+  if (!opts.shared_connections || opts.num_proxies <= 1) {
+    return nullptr;
+  }
 
-  // Need to detach event base here. Otherwise attachEventBase on next call to
-  // start_sending_probes will assert(false).
-  probeTimer_.detachEventBase();
+  /* Hotness: count requests in one-second windows. If the current or
+     the previous window crossed the threshold, keep a dedicated
+     connection on this thread. */
+  const auto now = nowUs();
+  if (now - hotWindowStartUs_ >= 1000000) {
+    hotLastWindowRequests_ =
+        now - hotWindowStartUs_ < 2000000 ? hotWindowRequests_ : 0;
+    hotWindowRequests_ = 0;
+    hotWindowStartUs_ = now;
+  }
+  ++hotWindowRequests_;
+  if (hotWindowRequests_ >= opts.shared_connections_hot_rps ||
+      hotLastWindowRequests_ >= opts.shared_connections_hot_rps) {
+    return nullptr;
+  }
+
+  const auto ownerIdx =
+      folly::Hash()(accessPoint_->toHostPortString()) % opts.num_proxies;
+  if (ownerIdx == proxy->getId()) {
+    return nullptr;
+  }
+  return proxy->router().getProxy(ownerIdx);
 }
 
 void ProxyDestination::handle_tko(const mc_res_t result, bool is_probe_req) {
@@ -164,6 +209,38 @@ void ProxyDestination::onReply(const mc_res_t result,
 
   int64_t latency = destreqCtx.endTime - destreqCtx.startTime;
   stats_.avgLatency.insertSample(latency);
+  if (latency >= 0) {
+    stats_.latencyHistogram.insertSample(latency);
+    updateAdaptiveTimeout(latency);
+  }
+}
+
+void ProxyDestination::updateAdaptiveTimeout(int64_t latencyUs) {
+  const auto& opts = proxy->getRouterOptions();
+  if (opts.adaptive_timeout_factor <= 0.0) {
+    return;
+  }
+  if (!latencyQuantiles_) {
+    latencyQuantiles_ = folly::make_unique<
+        cycles::QuantilesCalculator<uint64_t>>(kAdaptiveTimeoutEps);
+  }
+  latencyQuantiles_->insert(latencyUs);
+  if (++samplesSinceTimeoutUpdate_ < kAdaptiveTimeoutWindow) {
+    return;
+  }
+  const auto p99Us = latencyQuantiles_->query(0.99);
+  const auto timeoutMs = std::max<int64_t>(
+      static_cast<int64_t>(p99Us * opts.adaptive_timeout_factor / 1000.0),
+      opts.adaptive_timeout_min_ms);
+  /* The static (config) timeout stays the ceiling; adjustedTimeout()
+     applies it per request since different routes may use different
+     static timeouts for this destination. */
+  adaptiveTimeout_ = std::chrono::milliseconds(timeoutMs);
+  /* Restart the estimate so the next window reflects current latency
+     only and the timeout can come back down after a spike. */
+  latencyQuantiles_ = folly::make_unique<
+      cycles::QuantilesCalculator<uint64_t>>(kAdaptiveTimeoutEps);
+  samplesSinceTimeoutUpdate_ = 0;
 }
 
 size_t ProxyDestination::getPendingRequestCount() const {
@@ -190,6 +267,13 @@ std::shared_ptr<ProxyDestination> ProxyDestination::create(
     qosClass,
     qosPath));
   ptr->selfPtr_ = ptr;
+  ptr->dictionaryTrainer_ = proxy.router().dictionaryTrainer();
+  if (proxy.router().opts().dns_prefetch_deadline_ms > 0) {
+    /* Queue the hostname for the parallel resolver stage that runs at
+       the end of reconfiguration (see McrouterInstance::configure()). */
+    HostResolver::instance().scheduleResolution(
+        ptr->accessPoint()->getHost(), ptr->accessPoint()->getPort());
+  }
   return ptr;
 }
 
@@ -223,8 +307,7 @@ ProxyDestination::ProxyDestination(
       accessPoint_(std::move(ap)),
       shortestTimeout_(timeout),
       qosClass_(qosClass),
-      qosPath_(qosPath),
-      probeTimer_(*this) {
+      qosPath_(qosPath) {
   static uint64_t next_magic = 0x12345678900000LL;
   magic_ = __sync_fetch_and_add(&next_magic, 1);
   stat_incr(proxy->stats, num_servers_new_stat, 1);
@@ -232,7 +315,10 @@ ProxyDestination::ProxyDestination(
 }
 
 bool ProxyDestination::may_send() const {
-  return !tracker->isTko();
+  /* A destination in a down failure domain is skipped like a TKO one,
+     but keeps its own (healthy) state, so it resumes as soon as enough
+     domain members are probed back up. */
+  return !tracker->isTko() && !tracker->isDomainTko();
 }
 
 void ProxyDestination::resetInactive() {
@@ -252,14 +338,28 @@ void ProxyDestination::initializeAsyncMcClient() {
 
   ConnectionOptions options(accessPoint_);
   auto& opts = proxy->router().opts();
+  if (opts.probe_protocol_upgrade &&
+      accessPoint_->getProtocol() == mc_umbrella_protocol &&
+      proxy->destinationMap->getPreferredProtocol(*accessPoint_) ==
+          mc_caret_protocol) {
+    // A protocol upgrade probe found that this destination speaks caret,
+    // connect with caret without waiting for the pool config to flip.
+    options.accessPoint = std::make_shared<AccessPoint>(
+        accessPoint_->getHost(), accessPoint_->getPort(), mc_caret_protocol,
+        accessPoint_->useSsl(), accessPoint_->compressed());
+  }
   options.noNetwork = opts.no_network;
   options.tcpKeepAliveCount = opts.keepalive_cnt;
   options.tcpKeepAliveIdle = opts.keepalive_idle_s;
   options.tcpKeepAliveInterval = opts.keepalive_interval_s;
   options.writeTimeout = shortestTimeout_;
+  options.flushDelay = flushDelay_;
+  options.enableTfo = opts.enable_tcp_fast_open;
+  options.enableUdpForGets = opts.udp_gets;
   options.sessionCachingEnabled = opts.ssl_connection_cache;
   if (!opts.debug_fifo_root.empty()) {
     options.debugFifoPath = getClientDebugFifoFullPath(opts);
+    options.debugFifoRingBytes = opts.debug_fifo_ring_size;
   }
   if (opts.enable_qos) {
     options.enableQoS = true;
@@ -267,9 +367,12 @@ void ProxyDestination::initializeAsyncMcClient() {
     options.qosPath = qosPath_;
   }
   options.useJemallocNodumpAllocator = opts.jemalloc_nodump_buffers;
+  options.useHugePageBuffers = opts.huge_page_buffers;
+  options.replyPassthrough = opts.reply_passthrough;
   if (accessPoint_->compressed()) {
     if (auto codecManager = proxy->router().getCodecManager()) {
       options.compressionCodecMap = codecManager->getCodecMap();
+      options.compressionPoolTag = poolName_;
     }
   }
 
@@ -357,6 +460,49 @@ void ProxyDestination::initializeAsyncMcClient() {
     client_->setThrottle(opts.target_max_inflight_requests,
                          opts.target_max_pending_requests);
   }
+
+  if (opts.probe_protocol_upgrade &&
+      accessPoint_->getProtocol() == mc_umbrella_protocol &&
+      proxy->destinationMap->getPreferredProtocol(*accessPoint_) ==
+          mc_unknown_protocol) {
+    // Mark the destination as probed before the probe completes, so that
+    // other ProxyDestinations sharing this host:port don't send their own.
+    proxy->destinationMap->setPreferredProtocol(*accessPoint_,
+                                                mc_umbrella_protocol);
+    probeProtocolUpgrade();
+  }
+}
+
+void ProxyDestination::probeProtocolUpgrade() {
+  auto selfPtr = selfPtr_;
+  proxy->fiberManager.addTask([selfPtr]() mutable {
+    auto pdstn = selfPtr.lock();
+    if (pdstn == nullptr) {
+      return;
+    }
+    const auto& ap = *pdstn->accessPoint_;
+    ConnectionOptions options(std::make_shared<AccessPoint>(
+        ap.getHost(), ap.getPort(), mc_caret_protocol, ap.useSsl(),
+        ap.compressed()));
+    options.writeTimeout = pdstn->shortestTimeout_;
+    if (ap.useSsl()) {
+      auto& opts = pdstn->proxy->router().opts();
+      options.sslContextProvider = [&opts] {
+        return getSSLContext(opts.pem_cert_path, opts.pem_key_path,
+                             opts.pem_ca_path);
+      };
+    }
+    AsyncMcClient client(pdstn->proxy->eventBase(), std::move(options));
+    TypedThriftRequest<cpp2::McVersionRequest> versionReq;
+    auto reply = client.sendSync(versionReq, pdstn->shortestTimeout_);
+    // A destination that doesn't understand caret fails to parse the probe
+    // and errors out the connection, only a clean reply counts as support.
+    if (reply.result() == mc_res_ok) {
+      pdstn->proxy->destinationMap->setPreferredProtocol(ap,
+                                                         mc_caret_protocol);
+    }
+    client.closeNow();
+  });
 }
 
 AsyncMcClient& ProxyDestination::getAsyncMcClient() {
@@ -399,6 +545,7 @@ void ProxyDestination::onTkoEvent(TkoLogEvent event, mc_res_t result) const {
   tkoLog.poolName = poolName_;
   tkoLog.result = result;
 
+  proxy->tkoEventRing->record(tkoLog);
   logTkoEvent(*proxy, tkoLog);
 }
 
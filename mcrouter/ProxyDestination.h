@@ -14,12 +14,14 @@
 #include <string>
 
 #include <folly/IntrusiveList.h>
+#include <folly/io/async/HHWheelTimer.h>
 #include <folly/SpinLock.h>
 
-#include "mcrouter/AsyncTimer.h"
 #include "mcrouter/ExponentialSmoothData.h"
+#include "mcrouter/LogScaleHistogram.h"
 #include "mcrouter/TkoLog.h"
 #include "mcrouter/config.h"
+#include "mcrouter/lib/cycles/QuantilesCalculator.h"
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/network/AccessPoint.h"
@@ -29,6 +31,8 @@
 
 namespace facebook { namespace memcache {
 
+class CompressionDictionaryTrainer;
+
 namespace mcrouter {
 
 class ProxyClientCommon;
@@ -45,7 +49,7 @@ struct DestinationRequestCtx {
   }
 };
 
-class ProxyDestination {
+class ProxyDestination : public folly::HHWheelTimer::Callback {
  public:
   enum class State {
     kNew,           // never connected
@@ -58,6 +62,7 @@ class ProxyDestination {
   struct Stats {
     State state{State::kNew};
     ExponentialSmoothData<16> avgLatency;
+    LogScaleHistogram<> latencyHistogram;
     std::unique_ptr<std::array<uint64_t, mc_nres>> results;
     size_t probesSent{0};
   };
@@ -94,6 +99,29 @@ class ProxyDestination {
 
   void updateShortestTimeout(std::chrono::milliseconds timeout);
 
+  /**
+   * The timeout to actually use for a request, given the static
+   * (config) timeout.  With --adaptive-timeout-factor, this is the
+   * latest latency-derived timeout, clamped from above by the static
+   * value; otherwise it is the static value itself.
+   */
+  std::chrono::milliseconds adjustedTimeout(
+      std::chrono::milliseconds timeout) const {
+    if (adaptiveTimeout_.count() == 0 || adaptiveTimeout_ >= timeout) {
+      return timeout;
+    }
+    return adaptiveTimeout_;
+  }
+
+  /**
+   * Sets the delayed-flush window for this destination (see
+   * ConnectionOptions::flushDelay).  Takes effect when the connection
+   * is (re)created.
+   */
+  void updateFlushDelay(std::chrono::microseconds delay) {
+    flushDelay_ = delay;
+  }
+
   void updatePoolName(std::string poolName) {
     poolName_ = std::move(poolName);
   }
@@ -101,25 +129,64 @@ class ProxyDestination {
  private:
   static const uint64_t kDeadBeef = 0xdeadbeefdeadbeefULL;
 
+  /* Hot block: everything the per-request send/reply path touches, kept
+     together at the front of the object so a couple of cache lines cover
+     it. Cold configuration and probe state follows stats_. */
+
   std::unique_ptr<AsyncMcClient> client_;
   std::shared_ptr<const AccessPoint> accessPoint_;
   mutable folly::SpinLock clientLock_; // AsyncMcClient lock for stats threads.
 
   // Shortest timeout among all DestinationRoutes using this destination
   std::chrono::milliseconds shortestTimeout_{0};
-  const uint64_t qosClass_{0};
-  const uint64_t qosPath_{0};
   uint64_t magic_{0}; ///< to allow asserts that pdstn is still alive
 
+  // --shared-connections hotness window; only the owning proxy thread
+  // touches these.
+  uint64_t hotWindowRequests_{0};
+  uint64_t hotLastWindowRequests_{0};
+  int64_t hotWindowStartUs_{0};
+  // Stamped by ProxyDestinationMap::markAsActive; drives idle reaping.
+  int64_t lastUsedUs_{0};
+
   Stats stats_;
 
+  // Online dictionary trainer of the owning router, or nullptr if
+  // training is disabled; values sent to this destination are sampled
+  // into it (see send()).
+  CompressionDictionaryTrainer* dictionaryTrainer_{nullptr};
+
+  /* Adaptive timeout state (--adaptive-timeout-factor); only the owning
+     proxy thread touches these.  The quantile estimate is restarted
+     every window so the timeout can move down again after a latency
+     spike passes. */
+  std::unique_ptr<cycles::QuantilesCalculator<uint64_t>> latencyQuantiles_;
+  uint64_t samplesSinceTimeoutUpdate_{0};
+  // Latest derived timeout; 0 until the first full window.
+  std::chrono::milliseconds adaptiveTimeout_{0};
+
+  /* Cold block: read at connection (re)creation, probing and state
+     changes only. */
+
+  // Delayed-flush window for write coalescing; 0 disables.
+  std::chrono::microseconds flushDelay_{0};
+  const uint64_t qosClass_{0};
+  const uint64_t qosPath_{0};
+
   int probe_delay_next_ms{0};
   std::unique_ptr<TypedThriftRequest<cpp2::McVersionRequest>> probe_req;
   std::string poolName_;
-  // The string is stored in ProxyDestinationMap::destinations_
-  folly::StringPiece pdstnKey_; ///< consists of ap, server_timeout
 
-  AsyncTimer<ProxyDestination> probeTimer_;
+  // ProxyDestinationMap::destinations_ keeps a view into this string.
+  std::string pdstnKey_; ///< consists of ap, server_timeout
+  // The server_timeout part of the key, kept so the map entry can be
+  // located again without regenerating/hashing the string.
+  std::chrono::milliseconds pdstnKeyTimeout_{0};
+
+  void* stateList_{nullptr};
+  folly::IntrusiveListHook stateListHook_;
+
+  std::weak_ptr<ProxyDestination> selfPtr_;
 
   static std::shared_ptr<ProxyDestination> create(
     proxy_t& proxy,
@@ -133,10 +200,43 @@ class ProxyDestination {
   void start_sending_probes();
   void stop_sending_probes();
 
+  /**
+   * Send a single version request over a temporary caret connection and,
+   * if it succeeds, record caret as the preferred protocol for this
+   * host:port in ProxyDestinationMap. New connections will pick it up.
+   */
+  void probeProtocolUpgrade();
+
   void schedule_next_probe();
 
+  /**
+   * With --shared-connections, the proxy that owns the shared
+   * connection to this destination, or nullptr if this thread should
+   * use its own connection (the feature is off, this is the owner
+   * thread, or the destination is hot on this thread). Also accounts
+   * the request toward the hotness window.
+   */
+  proxy_t* sharedConnectionOwner();
+
+  /**
+   * Hands the request off to the owner proxy's destination and blocks
+   * the calling fiber until the reply comes back.
+   */
+  template <class Request>
+  ReplyT<Request> sendShared(proxy_t& ownerProxy,
+                             const Request& request,
+                             DestinationRequestCtx& req_ctx,
+                             std::chrono::milliseconds timeout);
+
   void handle_tko(const mc_res_t result, bool is_probe_req);
 
+  /**
+   * Folds one latency observation (us) into the quantile estimate and,
+   * once a full window of samples is in, re-derives adaptiveTimeout_ as
+   * clamp(p99 * factor, --adaptive-timeout-min-ms, static timeout).
+   */
+  void updateAdaptiveTimeout(int64_t latencyUs);
+
   // Process tko, stats and duration timer.
   void onReply(const mc_res_t result, DestinationRequestCtx& destreqCtx);
 
@@ -151,15 +251,12 @@ class ProxyDestination {
 
   void onTkoEvent(TkoLogEvent event, mc_res_t result) const;
 
-  void timerCallback();
-
-  void* stateList_{nullptr};
-  folly::IntrusiveListHook stateListHook_;
-
-  std::weak_ptr<ProxyDestination> selfPtr_;
+  // folly::HHWheelTimer::Callback overrides; the probe timeout lives on
+  // the per-proxy wheel owned by ProxyDestinationMap.
+  void timeoutExpired() noexcept override final;
+  void callbackCanceled() noexcept override final {}
 
   friend class ProxyDestinationMap;
-  friend class AsyncTimer<ProxyDestination>;
 };
 }}}  // facebook::memcache::mcrouter
 
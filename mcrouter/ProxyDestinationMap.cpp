@@ -9,7 +9,9 @@
  */
 #include "ProxyDestinationMap.h"
 
+#include <folly/Bits.h>
 #include <folly/Format.h>
+#include <folly/Hash.h>
 #include <folly/Memory.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
@@ -37,6 +39,36 @@ std::string genProxyDestinationKey(const AccessPoint& ap,
   }
 }
 
+/* Upper bound on connections reset per timer tick; reaping is
+   incremental so a backlog of idle destinations can't stall the loop. */
+constexpr size_t kMaxResetsPerTick = 64;
+
+/* Tick used while overdue destinations remain after a bounded reap. */
+constexpr uint32_t kReapBacklogTickMs = 10;
+
+uint64_t destinationHash(const AccessPoint& ap,
+                         std::chrono::milliseconds timeout) {
+  /* Mirrors genProxyDestinationKey: the timeout is part of the identity
+     for ASCII only. AccessPoint's hash is precomputed, so no string is
+     built or hashed here. */
+  if (ap.getProtocol() == mc_ascii_protocol) {
+    return folly::hash::hash_combine(ap.hash(), timeout.count());
+  }
+  return ap.hash();
+}
+
+bool sameDestinationKey(const AccessPoint& ap,
+                        std::chrono::milliseconds timeout,
+                        const AccessPoint& otherAp,
+                        std::chrono::milliseconds otherTimeout) {
+  if (ap.getProtocol() == mc_ascii_protocol && timeout != otherTimeout) {
+    return false;
+  }
+  /* Interned access points (McrouterInstance::getAccessPoint) make the
+     pointer check the common exit; the field compare covers copies. */
+  return &ap == &otherAp || ap == otherAp;
+}
+
 } // anonymous
 
 struct ProxyDestinationMap::StateList {
@@ -45,12 +77,147 @@ struct ProxyDestinationMap::StateList {
   List list;
 };
 
+/**
+ * Open-addressing table with linear probing. Slots are contiguous and
+ * carry the precomputed key hash, so a probe usually compares a word;
+ * on a hash match the key is compared as access point + timeout, with
+ * interned access points making that a pointer compare. The key string
+ * is kept only for stats naming. Both the string view and the access
+ * point pointer refer into the owning ProxyDestination, which outlives
+ * the table entry (the destination erases itself before its members are
+ * destroyed).
+ */
+struct ProxyDestinationMap::DestinationTable {
+  struct Slot {
+    enum class State : uint8_t { Empty, Full, Tombstone };
+
+    uint64_t hash{0};
+    const AccessPoint* ap{nullptr};
+    std::chrono::milliseconds timeout{0};
+    folly::StringPiece key;
+    std::weak_ptr<ProxyDestination> dst;
+    State state{State::Empty};
+  };
+
+  static constexpr size_t kInitialSlots = 64;
+
+  std::vector<Slot> slots{kInitialSlots};
+  size_t size{0};  // Full slots
+  size_t used{0};  // Full + tombstone slots
+
+  Slot* findSlot(uint64_t hash,
+                 const AccessPoint& ap,
+                 std::chrono::milliseconds timeout) {
+    const size_t mask = slots.size() - 1;
+    for (size_t idx = hash & mask; ; idx = (idx + 1) & mask) {
+      auto& slot = slots[idx];
+      if (slot.state == Slot::State::Empty) {
+        return nullptr;
+      }
+      if (slot.state == Slot::State::Full && slot.hash == hash &&
+          sameDestinationKey(*slot.ap, slot.timeout, ap, timeout)) {
+        return &slot;
+      }
+    }
+  }
+
+  void insertOrAssign(uint64_t hash,
+                      const AccessPoint* ap,
+                      std::chrono::milliseconds timeout,
+                      folly::StringPiece key,
+                      const std::shared_ptr<ProxyDestination>& dst) {
+    maybeRehash();
+    const size_t mask = slots.size() - 1;
+    Slot* firstTombstone = nullptr;
+    for (size_t idx = hash & mask; ; idx = (idx + 1) & mask) {
+      auto& slot = slots[idx];
+      if (slot.state == Slot::State::Empty) {
+        auto& target = firstTombstone != nullptr ? *firstTombstone : slot;
+        if (firstTombstone == nullptr) {
+          ++used;
+        }
+        target.hash = hash;
+        target.ap = ap;
+        target.timeout = timeout;
+        target.key = key;
+        target.dst = dst;
+        target.state = Slot::State::Full;
+        ++size;
+        return;
+      }
+      if (slot.state == Slot::State::Tombstone) {
+        if (firstTombstone == nullptr) {
+          firstTombstone = &slot;
+        }
+      } else if (slot.hash == hash &&
+                 sameDestinationKey(*slot.ap, slot.timeout, *ap, timeout)) {
+        /* Re-registered key: repoint at the new owner's access point and
+           string so the views stay valid after the old destination dies. */
+        slot.ap = ap;
+        slot.timeout = timeout;
+        slot.key = key;
+        slot.dst = dst;
+        return;
+      }
+    }
+  }
+
+  void eraseSlot(Slot& slot) {
+    assert(slot.state == Slot::State::Full);
+    slot.ap = nullptr;
+    slot.key.clear();
+    slot.dst.reset();
+    slot.state = Slot::State::Tombstone;
+    --size;
+  }
+
+ private:
+  /* Keep load (including tombstones) below 3/4 so probes always hit an
+     empty slot; rehashing sweeps out tombstones and expired entries. */
+  void maybeRehash() {
+    if ((used + 1) * 4 < slots.size() * 3) {
+      return;
+    }
+    auto oldSlots = std::move(slots);
+    slots.assign(
+        std::max(kInitialSlots, folly::nextPowTwo(size * 2 + 1)), Slot());
+    size = 0;
+    used = 0;
+    for (auto& slot : oldSlots) {
+      if (slot.state == Slot::State::Full && !slot.dst.expired()) {
+        rawInsert(slot);
+      }
+    }
+  }
+
+  /* Insert into a table known to have no tombstones and no duplicate
+     of this key (only used by maybeRehash). */
+  void rawInsert(Slot& oldSlot) {
+    const size_t mask = slots.size() - 1;
+    for (size_t idx = oldSlot.hash & mask; ; idx = (idx + 1) & mask) {
+      auto& slot = slots[idx];
+      if (slot.state == Slot::State::Empty) {
+        slot.hash = oldSlot.hash;
+        slot.ap = oldSlot.ap;
+        slot.timeout = oldSlot.timeout;
+        slot.key = oldSlot.key;
+        slot.dst = std::move(oldSlot.dst);
+        slot.state = Slot::State::Full;
+        ++size;
+        ++used;
+        return;
+      }
+    }
+  }
+};
+
+constexpr size_t ProxyDestinationMap::DestinationTable::kInitialSlots;
+
 ProxyDestinationMap::ProxyDestinationMap(proxy_t* proxy)
     : proxy_(proxy),
-      active_(folly::make_unique<StateList>()),
-      inactive_(folly::make_unique<StateList>()),
-      inactivityTimeout_(0),
-      resetTimer_(nullptr) {}
+      destinations_(folly::make_unique<DestinationTable>()),
+      lru_(folly::make_unique<StateList>()),
+      inactivityTimeout_(0) {}
 
 std::shared_ptr<ProxyDestination>
 ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
@@ -60,10 +227,14 @@ ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
   auto key = genProxyDestinationKey(*ap, timeout);
   auto destination = ProxyDestination::create(*proxy_, std::move(ap),
       timeout, qosClass, qosPath);
+  destination->pdstnKey_ = std::move(key);
+  destination->pdstnKeyTimeout_ = timeout;
   {
-    std::lock_guard<std::mutex> lck(destinationsLock_);
-    auto destIt = destinations_.emplace(key, destination);
-    destination->pdstnKey_ = destIt.first->first;
+    const auto& dstAp = *destination->accessPoint();
+    const auto hash = destinationHash(dstAp, timeout);
+    folly::SharedMutex::WriteHolder lck(destinationsLock_);
+    destinations_->insertOrAssign(
+        hash, &dstAp, timeout, destination->pdstnKey_, destination);
   }
 
   // Update shared area of ProxyDestinations with same key from different
@@ -71,7 +242,9 @@ ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
   proxy_->router().tkoTrackerMap().updateTracker(
     *destination,
     proxy_->router().opts().failures_until_tko,
-    proxy_->router().opts().maximum_soft_tkos);
+    proxy_->router().opts().maximum_soft_tkos,
+    proxy_->router().opts().failure_domain_policy,
+    proxy_->router().opts().failure_domain_tko_threshold);
 
   return destination;
 }
@@ -82,82 +255,139 @@ ProxyDestinationMap::emplace(std::shared_ptr<AccessPoint> ap,
  */
 std::shared_ptr<ProxyDestination> ProxyDestinationMap::find(
     const AccessPoint& ap, std::chrono::milliseconds timeout) const {
-  auto key = genProxyDestinationKey(ap, timeout);
+  const auto hash = destinationHash(ap, timeout);
   {
-    std::lock_guard<std::mutex> lck(destinationsLock_);
-    return find(key);
+    folly::SharedMutex::ReadHolder lck(destinationsLock_);
+    auto* slot = destinations_->findSlot(hash, ap, timeout);
+    return slot != nullptr ? slot->dst.lock() : nullptr;
   }
 }
 
-// Note: caller must be holding destionationsLock_.
-std::shared_ptr<ProxyDestination>
-ProxyDestinationMap::find(const std::string& key) const {
-  auto it = destinations_.find(key);
-  if (it == destinations_.end()) {
-    return nullptr;
-  }
-  return it->second.lock();
-}
-
 void ProxyDestinationMap::removeDestination(ProxyDestination& destination) {
-  if (destination.stateList_ == active_.get()) {
-    active_->list.erase(StateList::List::s_iterator_to(destination));
-  } else if (destination.stateList_ == inactive_.get()) {
-    inactive_->list.erase(StateList::List::s_iterator_to(destination));
+  if (destination.stateList_ == lru_.get()) {
+    lru_->list.erase(StateList::List::s_iterator_to(destination));
   }
+  /* Release any still-live owner outside the lock: dropping the last
+     reference runs ~ProxyDestination, which re-enters this method. */
+  std::shared_ptr<ProxyDestination> current;
   {
-    std::lock_guard<std::mutex> lck(destinationsLock_);
-    destinations_.erase(destination.pdstnKey_);
+    const auto& ap = *destination.accessPoint();
+    const auto hash = destinationHash(ap, destination.pdstnKeyTimeout_);
+    folly::SharedMutex::WriteHolder lck(destinationsLock_);
+    auto* slot =
+        destinations_->findSlot(hash, ap, destination.pdstnKeyTimeout_);
+    if (slot != nullptr) {
+      current = slot->dst.lock();
+      /* Erase only if the entry still refers to this destination; the
+         key may have been re-registered by a newer one (lock() returns
+         nullptr for `destination` itself, which is being destroyed). */
+      if (current == nullptr) {
+        destinations_->eraseSlot(*slot);
+      }
+    }
   }
 }
 
 void ProxyDestinationMap::markAsActive(ProxyDestination& destination) {
-  if (destination.stateList_ == active_.get()) {
-    return;
-  }
-  if (destination.stateList_ == inactive_.get()) {
-    inactive_->list.erase(StateList::List::s_iterator_to(destination));
+  destination.lastUsedUs_ = nowUs();
+  if (destination.stateList_ == lru_.get()) {
+    lru_->list.erase(StateList::List::s_iterator_to(destination));
   }
-  active_->list.push_back(destination);
-  destination.stateList_ = active_.get();
+  lru_->list.push_back(destination);
+  destination.stateList_ = lru_.get();
 }
 
-void ProxyDestinationMap::resetAllInactive() {
-  for (auto& it : inactive_->list) {
-    it.resetInactive();
-    it.stateList_ = nullptr;
+void ProxyDestinationMap::setResetTimer(std::chrono::milliseconds interval) {
+  assert(interval.count() > 0);
+  inactivityTimeout_ = static_cast<uint32_t>(interval.count());
+  resetTaskPeriodMs_ = inactivityTimeout_;
+  resetTaskId_ = proxy_->taskScheduler().schedule(
+    resetTaskPeriodMs_, [this]() { timerCallback(); });
+}
+
+void ProxyDestinationMap::scheduleProbe(ProxyDestination& destination,
+                                        std::chrono::milliseconds delay) {
+  if (!probeTimer_) {
+    probeTimer_ = folly::HHWheelTimer::UniquePtr(
+        new folly::HHWheelTimer(std::addressof(proxy_->eventBase())));
   }
-  inactive_->list.clear();
-  active_.swap(inactive_);
+  probeTimer_->scheduleTimeout(&destination, delay);
 }
 
-void ProxyDestinationMap::setResetTimer(std::chrono::milliseconds interval) {
-  using TimerType = AsyncTimer<ProxyDestinationMap>;
+mc_protocol_t ProxyDestinationMap::getPreferredProtocol(
+    const AccessPoint& ap) const {
+  auto key = ap.toHostPortString();
+  folly::SharedMutex::ReadHolder lck(destinationsLock_);
+  auto it = preferredProtocols_.find(key);
+  if (it == preferredProtocols_.end()) {
+    return mc_unknown_protocol;
+  }
+  return it->second;
+}
 
-  assert(interval.count() > 0);
-  inactivityTimeout_ = static_cast<uint32_t>(interval.count());
-  resetTimer_ = folly::make_unique<TimerType>(*this);
+void ProxyDestinationMap::setPreferredProtocol(const AccessPoint& ap,
+                                               mc_protocol_t protocol) {
+  auto key = ap.toHostPortString();
+  folly::SharedMutex::WriteHolder lck(destinationsLock_);
+  auto it = preferredProtocols_.find(key);
+  if (it != preferredProtocols_.end()) {
+    it->second = protocol;
+  } else {
+    preferredProtocols_.emplace(key, protocol);
+  }
+}
 
-  resetTimer_->attachEventBase(std::addressof(proxy_->eventBase()));
-  if (!resetTimer_->scheduleTimeout(inactivityTimeout_)) {
-    MC_LOG_FAILURE(proxy_->router().opts(),
-                   memcache::failure::Category::kSystemError,
-                   "failed to schedule inactivity timer");
+void ProxyDestinationMap::foreachDestinationSynced(
+    const std::function<void(folly::StringPiece, const ProxyDestination&)>& f) {
+  /* Release the shared_ptrs outside the lock: we could be holding the
+     last reference, and the destructor calls removeDestination. */
+  std::vector<std::shared_ptr<const ProxyDestination>> toFree;
+  {
+    folly::SharedMutex::ReadHolder lck(destinationsLock_);
+    for (auto& slot : destinations_->slots) {
+      if (slot.state != DestinationTable::Slot::State::Full) {
+        continue;
+      }
+      if (auto dst = slot.dst.lock()) {
+        f(slot.key, *dst);
+        toFree.push_back(std::move(dst));
+      }
+    }
   }
 }
 
 void ProxyDestinationMap::timerCallback() {
-  resetAllInactive();
-
   assert(inactivityTimeout_ > 0);
-  if (!resetTimer_->scheduleTimeout(inactivityTimeout_)) {
-    MC_LOG_FAILURE(proxy_->router().opts(),
-                   memcache::failure::Category::kSystemError,
-                   "failed to re-schedule inactivity timer");
+
+  /* Reap from the LRU front: only entries idle for at least the
+     inactivity interval, and at most kMaxResetsPerTick of them. */
+  const auto cutoffUs =
+      nowUs() - static_cast<int64_t>(inactivityTimeout_) * 1000;
+  size_t numReset = 0;
+  while (!lru_->list.empty() && numReset < kMaxResetsPerTick) {
+    auto& dstn = lru_->list.front();
+    if (dstn.lastUsedUs_ > cutoffUs) {
+      break;
+    }
+    lru_->list.pop_front();
+    dstn.stateList_ = nullptr;
+    dstn.resetInactive();
+    ++numReset;
+  }
+
+  const bool backlog = !lru_->list.empty() &&
+      lru_->list.front().lastUsedUs_ <= cutoffUs;
+  const uint32_t period = backlog ? kReapBacklogTickMs : inactivityTimeout_;
+  if (period != resetTaskPeriodMs_) {
+    resetTaskPeriodMs_ = period;
+    proxy_->taskScheduler().updatePeriod(resetTaskId_, period);
   }
 }
 
 ProxyDestinationMap::~ProxyDestinationMap() {
+  if (resetTaskId_ != 0) {
+    proxy_->taskScheduler().cancel(resetTaskId_);
+  }
 }
 
 }}} // facebook::memcache::mcrouter
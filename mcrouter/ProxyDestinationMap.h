@@ -10,15 +10,18 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <memory>
-#include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/Range.h>
+#include <folly/SharedMutex.h>
 
-#include "mcrouter/AsyncTimer.h"
+#include "mcrouter/lib/mc/protocol.h"
+#include "mcrouter/lib/PeriodicTaskScheduler.h"
 
 namespace facebook { namespace memcache {
 
@@ -42,6 +45,9 @@ struct proxy_t;
  * opened connection to this destination and there were requests during last
  * reset_inactive_connection_interval ms routed to this destination.
  * 'Inactive' means there were no requests and connection may be closed.
+ * Destinations sit on an LRU list stamped on use; a periodic timer reaps
+ * a bounded number of idle entries from its front per tick, so reaping
+ * never walks busy destinations and never stalls the event loop.
  */
 class ProxyDestinationMap {
  public:
@@ -68,74 +74,92 @@ class ProxyDestinationMap {
   void removeDestination(ProxyDestination& destination);
 
   /**
-   * Mark destination as 'active', so it won't be closed on next
-   * resetAllInactive call
+   * Stamp destination's last-use time and move it to the tail of the
+   * LRU list, so it stays clear of the idle reaper.
    */
   void markAsActive(ProxyDestination& destination);
 
-  /**
-   * Close all 'inactive' destinations i.e. destinations which weren't marked
-   * 'active' after last removeAllInactive call.
-   */
-  void resetAllInactive();
-
   /**
    * Set timer which resets inactive connections.
    * @param interval timer interval, should be greater than zero.
    */
   void setResetTimer(std::chrono::milliseconds interval);
 
+  /**
+   * Schedules a TKO probe for the given destination after 'delay'.
+   *
+   * All probes of a proxy share a single hashed timer wheel, so a mass
+   * TKO arms one EventBase timeout instead of one per destination, and
+   * probes whose deadlines land in the same wheel tick are issued in
+   * one batch.
+   */
+  void scheduleProbe(ProxyDestination& destination,
+                     std::chrono::milliseconds delay);
+
+  /**
+   * Best protocol the destination is known to support, as determined by a
+   * protocol upgrade probe (see ProxyDestination::probeProtocolUpgrade).
+   *
+   * @return cached protocol for given host:port,
+   *         or mc_unknown_protocol if it was never probed.
+   */
+  mc_protocol_t getPreferredProtocol(const AccessPoint& ap) const;
+
+  /**
+   * Record the best protocol supported by given host:port. It will be used
+   * by all new connections to this destination.
+   */
+  void setPreferredProtocol(const AccessPoint& ap, mc_protocol_t protocol);
+
   /**
    * Calls f(Key, const ProxyDestination&) for each destination stored
-   * in ProxyDestinationMap. The whole map is locked during the call.
+   * in ProxyDestinationMap. The map is read-locked during the call.
    *
    * TODO: replace with getStats()
    */
-  template <typename Func>
-  void foreachDestinationSynced(Func&& f) {
-    // The toFree vector is used to delay destruction as we have the following
-    // race condition: ProxyDestination destructor will try to grab a lock
-    // on destionationsLock_, which is already locked here.
-    std::vector<std::shared_ptr<const ProxyDestination>> toFree;
-    {
-      std::lock_guard<std::mutex> lock(destinationsLock_);
-      for (auto& it : destinations_) {
-        if (std::shared_ptr<const ProxyDestination> d = it.second.lock()) {
-          f(it.first, *d);
-          toFree.push_back(std::move(d));
-        }
-      }
-    }
-  }
+  void foreachDestinationSynced(
+      const std::function<void(folly::StringPiece, const ProxyDestination&)>&
+          f);
 
   ~ProxyDestinationMap();
 
  private:
+  struct DestinationTable;
   struct StateList;
 
   proxy_t* proxy_;
-  folly::StringKeyedUnorderedMap<std::weak_ptr<ProxyDestination>> destinations_;
-  mutable std::mutex destinationsLock_;
+  /**
+   * Open-addressing flat table of destinations keyed by the
+   * precomputed hash of the destination key (see DestinationTable in
+   * the .cpp). Guarded by destinationsLock_: lookups take it shared,
+   * so reconfigs probing for reusable destinations don't serialize on
+   * the rare inserts and erases.
+   */
+  std::unique_ptr<DestinationTable> destinations_;
+  // Protocols destinations were upgraded to, keyed by host:port.
+  folly::StringKeyedUnorderedMap<mc_protocol_t> preferredProtocols_;
+  mutable folly::SharedMutex destinationsLock_;
 
-  std::unique_ptr<StateList> active_;
-  std::unique_ptr<StateList> inactive_;
+  // Destinations ordered by last use (front is the least recently
+  // used); does not own them.
+  std::unique_ptr<StateList> lru_;
 
   uint32_t inactivityTimeout_;
-  std::unique_ptr<AsyncTimer<ProxyDestinationMap>> resetTimer_;
+  // Reaper task registered with the proxy's shared task scheduler;
+  // 0 until setResetTimer() is called.
+  PeriodicTaskScheduler::TaskId resetTaskId_{0};
+  // Period the task currently runs at: inactivityTimeout_ normally,
+  // a short backlog tick while overdue entries remain.
+  uint32_t resetTaskPeriodMs_{0};
+  // Lazily created; all TKO probe timeouts of this proxy live here.
+  folly::HHWheelTimer::UniquePtr probeTimer_;
 
   /**
-   * If ProxyDestination is already stored in this object - returns it;
-   * otherwise, returns nullptr.
-   * Note: caller must be holding destionationsLock_.
-   */
-  std::shared_ptr<ProxyDestination> find(const std::string& key) const;
-
-  /**
-   * Time callback which clears inactive connections and reschedules the timer.
+   * Timer callback which reaps a bounded batch of idle connections from
+   * the LRU front and adjusts the task period (shorter while overdue
+   * entries remain).
    */
   void timerCallback();
-
-  friend class AsyncTimer<ProxyDestinationMap>;
 };
 
 }}} // facebook::memcache::mcrouter
@@ -7,6 +7,11 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <cassert>
+#include <type_traits>
+
+#include "mcrouter/lib/fbi/cpp/ObjectPool.h"
+#include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/McKey.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
@@ -18,6 +23,21 @@ namespace mcrouter {
 
 namespace detail {
 
+/**
+ * Pool of raw context storage, one per context type. Contexts are
+ * allocated on client threads and freed on proxy threads, which the
+ * tiered pool's shared depot recycles across; in steady state
+ * dispatching a request allocates no memory.
+ */
+template <class T>
+TieredObjectPool<
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type>&
+contextPool() {
+  static TieredObjectPool<
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type> pool;
+  return pool;
+}
+
 /**
  * Implementation class for storing the callback along with the context.
  */
@@ -32,6 +52,21 @@ class ProxyRequestContextTypedWithCallback
       : ProxyRequestContextTyped<Request>(pr, req, priority__),
         f_(std::forward<F>(f)) {}
 
+  static void* operator new(size_t bytes) {
+    assert(bytes == sizeof(ProxyRequestContextTypedWithCallback));
+    return contextPool<ProxyRequestContextTypedWithCallback>().alloc();
+  }
+
+  /* Also called through the base class pointer: the virtual destructor
+     dispatches deletion to the most derived class. */
+  static void operator delete(void* p) {
+    using Storage = typename std::aligned_storage<
+        sizeof(ProxyRequestContextTypedWithCallback),
+        alignof(ProxyRequestContextTypedWithCallback)>::type;
+    contextPool<ProxyRequestContextTypedWithCallback>().free(
+        static_cast<Storage*>(p));
+  }
+
  protected:
   void sendReplyImpl(ReplyT<Request>&& reply) override final {
     auto req = this->req_;
@@ -43,6 +78,42 @@ class ProxyRequestContextTypedWithCallback
   F f_;
 };
 
+/**
+ * Same as above, but owns the request. Used by the zero-copy send API:
+ * the caller moves the request (and the ref-counted IOBuf chain backing
+ * its value) into the context instead of guaranteeing its lifetime.
+ */
+template <class Request, class F>
+class ProxyRequestContextTypedOwning
+    : public ProxyRequestContextTypedWithCallback<Request, F> {
+ public:
+  ProxyRequestContextTypedOwning(proxy_t& pr,
+                                 Request&& req,
+                                 F&& f,
+                                 ProxyRequestPriority priority__)
+      /* Only the address of ownedReq_ is taken before it's constructed */
+      : ProxyRequestContextTypedWithCallback<Request, F>(
+            pr, ownedReq_, std::forward<F>(f), priority__),
+        ownedReq_(std::move(req)) {}
+
+  /* Shadow the base class pool: this class is larger */
+  static void* operator new(size_t bytes) {
+    assert(bytes == sizeof(ProxyRequestContextTypedOwning));
+    return contextPool<ProxyRequestContextTypedOwning>().alloc();
+  }
+
+  static void operator delete(void* p) {
+    using Storage = typename std::aligned_storage<
+        sizeof(ProxyRequestContextTypedOwning),
+        alignof(ProxyRequestContextTypedOwning)>::type;
+    contextPool<ProxyRequestContextTypedOwning>().free(
+        static_cast<Storage*>(p));
+  }
+
+ private:
+  Request ownedReq_;
+};
+
 constexpr const char* kCommandNotSupportedStr = "Command not supported";
 
 template <class Request>
@@ -78,6 +149,22 @@ inline bool precheckRequest(
   return true;
 }
 
+inline bool precheckRequest(
+    ProxyRequestContextTyped<
+      TypedThriftRequest<cpp2::McBulkDeleteRequest>>& preq,
+    const TypedThriftRequest<cpp2::McBulkDeleteRequest>& req) {
+  /* The routing key of each sub-delete is an entry of 'keys', not the
+     (unused) top-level key, so validate every entry up front. */
+  for (const auto& key : req->keys) {
+    auto err = isKeyValid(getRange(key));
+    if (err != mc_req_err_valid) {
+      preq.sendReply(mc_res_local_error, mc_req_err_to_string(err));
+      return false;
+    }
+  }
+  return true;
+}
+
 inline bool precheckRequest(
     ProxyRequestContextTyped<TypedThriftRequest<cpp2::McShutdownRequest>>& preq,
     const TypedThriftRequest<cpp2::McShutdownRequest>&) {
@@ -119,6 +206,12 @@ void ProxyRequestContextTyped<Request>::sendReply(ReplyT<Request>&& reply) {
   this->replied_ = true;
   auto result = reply.result();
 
+  if (this->sample_) {
+    const folly::IOBuf* replyValue = reply.valuePtrUnsafe();
+    this->finishSampling(
+        result, replyValue ? replyValue->computeChainDataLength() : 0);
+  }
+
   sendReplyImpl(std::move(reply));
   req_ = nullptr;
 
@@ -154,20 +247,16 @@ void ProxyRequestContextTyped<Request>::startProcessing() {
 }
 
 template <class Request>
-std::shared_ptr<ProxyRequestContextTyped<Request>>
+ProxyRequestContextTypedPtr<Request>
 ProxyRequestContextTyped<Request>::process(
     std::unique_ptr<Type> preq, std::shared_ptr<const ProxyConfig> config) {
 
   preq->config_ = std::move(config);
-  return std::shared_ptr<Type>(
-      preq.release(),
-      /* Note: we want to delete on main context here since the destructor
-         can do complicated things, like finalize stats entry and
-         destroy a stale config.  There might not be enough stack space
-         for these operations. */
-      [](ProxyRequestContext* ctx) {
-        folly::fibers::runInMainContext([ctx] { delete ctx; });
-      });
+  /* The context is constructed with its refcount already at 1, so the
+     unique_ptr's ownership simply becomes the first counted reference;
+     no control block is allocated. decRef() takes care of deleting on
+     the main context once the last reference is gone. */
+  return std::move(preq);
 }
 
 template <class Request, class F>
@@ -180,6 +269,17 @@ createProxyRequestContext(proxy_t& pr,
   return folly::make_unique<Type>(pr, req, std::forward<F>(f), priority);
 }
 
+template <class Request, class F>
+std::unique_ptr<ProxyRequestContextTyped<Request>>
+createOwnedProxyRequestContext(proxy_t& pr,
+                               Request&& req,
+                               F&& f,
+                               ProxyRequestPriority priority) {
+  using Type = detail::ProxyRequestContextTypedOwning<Request, F>;
+  return folly::make_unique<Type>(
+      pr, std::move(req), std::forward<F>(f), priority);
+}
+
 } // mcrouter
 } // memcache
 } // facebook
@@ -9,14 +9,32 @@
  */
 #include "ProxyRequestContext.h"
 
+#include <folly/Format.h>
 #include <folly/Memory.h>
 
 #include "mcrouter/config.h"
+#include "mcrouter/lib/cycles/Cycles.h"
+#include "mcrouter/lib/network/AccessPoint.h"
 #include "mcrouter/McrouterClient.h"
 #include "mcrouter/proxy.h"
+#include "mcrouter/RequestSampler.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+/* The request path's working set (the hot block up to reqComplete_)
+   should stay within two cache lines. Member sizes rather than offsets
+   are summed here because offsetof is not usable on a polymorphic type;
+   padding between these small members is negligible. */
+static_assert(sizeof(uint64_t) /* requestId_ */ +
+                  sizeof(void*) /* proxy_ */ +
+                  sizeof(std::atomic<uint32_t>) /* refcount_ */ +
+                  3 * sizeof(bool) + sizeof(ProxyRequestPriority) +
+                  sizeof(std::shared_ptr<McrouterClient>) +
+                  sizeof(void*) /* context_ union */ +
+                  sizeof(void (*)(ProxyRequestContext&)) /* reqComplete_ */
+              <= 2 * 64,
+              "ProxyRequestContext hot block should fit in two cache lines");
+
 ProxyRequestContext::ProxyRequestContext(proxy_t& pr,
                                          ProxyRequestPriority priority__)
     : requestId_(pr.nextRequestId()), proxy_(pr), priority_(priority__) {
@@ -53,6 +71,44 @@ ProxyRequestContext::~ProxyRequestContext() {
   stat_decr_safe(proxy_.stats, proxy_request_num_outstanding_stat);
 }
 
+void ProxyRequestContext::startSampling(const char* requestName,
+                                        folly::StringPiece routingKey,
+                                        std::string routePath) {
+  assert(!recording_);
+  sample_ = folly::make_unique<RequestSample>();
+  sample_->requestId = requestId_;
+  sample_->requestName = requestName;
+  sample_->routingKey = routingKey.str();
+  sample_->routePath = std::move(routePath);
+  sample_->startTimeUs = nowUs();
+}
+
+void ProxyRequestContext::recordSampledHop(const AccessPoint& ap,
+                                           mc_res_t result,
+                                           int64_t durationUs) {
+  folly::format("{}{} {} {}us",
+                sample_->destinations.empty() ? "" : ", ",
+                ap.toHostPortString(),
+                mc_res_to_string(result),
+                durationUs).appendTo(sample_->destinations);
+}
+
+void ProxyRequestContext::finishSampling(mc_res_t replyResult,
+                                         size_t replySize) {
+  sample_->replyResult = replyResult;
+  sample_->replySize = replySize;
+  sample_->durationUs = nowUs() - sample_->startTimeUs;
+  /* CyclesObserver labels intervals with (0, requestId); pick up whatever
+     has been attributed to this request so far. The interval of the fiber
+     that is sending the reply is still open, so its cycles are not
+     included. */
+  sample_->cycles = cycles::getAccumulatedCycles(0, requestId_);
+  if (proxy_.requestSampler) {
+    proxy_.requestSampler->add(std::move(*sample_));
+  }
+  sample_.reset();
+}
+
 uint64_t ProxyRequestContext::senderId() const {
   uint64_t id = 0;
   if (requester_) {
@@ -68,16 +124,33 @@ uint64_t ProxyRequestContext::requestId() const {
   return requestId_;
 }
 
+bool ProxyRequestContext::overCycleBudget() const {
+  if (overCycleBudget_) {
+    return true;
+  }
+  const auto& opts = proxy_.router().opts();
+  if (opts.request_cycle_budget == 0 || !opts.cpu_cycles) {
+    return false;
+  }
+  /* Only closed intervals count, so cycles burned by the currently
+     running fiber since its last suspension are not included yet. */
+  if (cycles::getAccumulatedCycles(0, requestId_) >
+      opts.request_cycle_budget) {
+    overCycleBudget_ = true;
+  }
+  return overCycleBudget_;
+}
+
 void ProxyRequestContext::setSenderIdForTest(uint64_t id) {
   senderIdForTest_ = id;
 }
 
-std::shared_ptr<ProxyRequestContext> ProxyRequestContext::createRecording(
+ProxyRequestContextPtr ProxyRequestContext::createRecording(
   proxy_t& proxy,
   ClientCallback clientCallback,
   ShardSplitCallback shardSplitCallback) {
 
-  return std::shared_ptr<ProxyRequestContext>(
+  return ProxyRequestContextPtr::moveRef(
     new ProxyRequestContext(Recording,
                             proxy,
                             std::move(clientCallback),
@@ -85,21 +158,16 @@ std::shared_ptr<ProxyRequestContext> ProxyRequestContext::createRecording(
   );
 }
 
-std::shared_ptr<ProxyRequestContext> ProxyRequestContext::createRecordingNotify(
+ProxyRequestContextPtr ProxyRequestContext::createRecordingNotify(
   proxy_t& proxy,
   folly::fibers::Baton& baton,
   ClientCallback clientCallback,
   ShardSplitCallback shardSplitCallback) {
 
-  return std::shared_ptr<ProxyRequestContext>(
-    new ProxyRequestContext(Recording,
-                            proxy,
-                            std::move(clientCallback),
-                            std::move(shardSplitCallback)),
-    [&baton] (ProxyRequestContext* ctx) {
-      delete ctx;
-      baton.post();
-    });
+  auto ctx = createRecording(
+    proxy, std::move(clientCallback), std::move(shardSplitCallback));
+  ctx->recordingState_->notifyBaton = &baton;
+  return ctx;
 }
 
 ProxyRequestContext::ProxyRequestContext(
@@ -116,4 +184,32 @@ ProxyRequestContext::ProxyRequestContext(
   recordingState_->shardSplitCallback = std::move(shardSplitCallback);
 }
 
+void ProxyRequestContext::decRef() noexcept {
+  if (refcount_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  auto* notifyBaton = recording_ ? recordingState_->notifyBaton : nullptr;
+  /* Delete on the main context: the destructor can do complicated
+     things, like finalize a stats entry and destroy a stale config,
+     and there might not be enough fiber stack for these. */
+  folly::fibers::runInMainContext([this]() { delete this; });
+  if (notifyBaton != nullptr) {
+    notifyBaton->post();
+  }
+}
+
+ProxyRequestContext* ProxyRequestContextRefPolicy::increfOrNull(
+    ProxyRequestContext* ctx) noexcept {
+  if (ctx != nullptr) {
+    ctx->incRef();
+  }
+  return ctx;
+}
+
+void ProxyRequestContextRefPolicy::decref(ProxyRequestContext* ctx) noexcept {
+  if (ctx != nullptr) {
+    ctx->decRef();
+  }
+}
+
 }}} // facebook::memcache::mcrouter
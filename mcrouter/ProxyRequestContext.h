@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -16,9 +17,11 @@
 
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
+#include "mcrouter/KeyspaceStats.h"
 #include "mcrouter/lib/McRequestList.h"
 #include "mcrouter/lib/RequestLoggerContext.h"
 #include "mcrouter/ProxyConfig.h"
+#include "mcrouter/ProxyRequestContextPtr.h"
 #include "mcrouter/ProxyRequestLogger.h"
 #include "mcrouter/ProxyRequestPriority.h"
 
@@ -31,6 +34,7 @@ namespace mcrouter {
 
 class McrouterClient;
 class ProxyRoute;
+struct RequestSample;
 class ShardSplitter;
 
 /**
@@ -39,8 +43,11 @@ class ShardSplitter;
  *
  * It starts it's life under a unique_ptr outside of proxy threads.
  * When handed off to a proxy thread and ready to execute,
- * we save the current configuration and convert it to shared
- * ownership.
+ * we save the current configuration and convert it to counted
+ * ProxyRequestContextPtr references. The count is embedded in the
+ * object itself, so fanning subrequests out over fibers allocates no
+ * control block and the unique_ptr's ownership simply becomes the
+ * first reference.
  *
  * Records collected stats on destruction.
  */
@@ -59,7 +66,7 @@ public:
    * @param shardSplitCallback  If non-nullptr, called by ShardSplitRoute
    *   in traverse() with itself as the argument.
    */
-  static std::shared_ptr<ProxyRequestContext> createRecording(
+  static ProxyRequestContextPtr createRecording(
     proxy_t& proxy,
     ClientCallback clientCallback,
     ShardSplitCallback shardSplitCallback = nullptr);
@@ -69,7 +76,7 @@ public:
    * when this context is destroyed (i.e. all requests referencing it
    * finish executing).
    */
-  static std::shared_ptr<ProxyRequestContext> createRecordingNotify(
+  static ProxyRequestContextPtr createRecordingNotify(
     proxy_t& proxy,
     folly::fibers::Baton& baton,
     ClientCallback clientCallback,
@@ -148,8 +155,28 @@ public:
     logger_->log<Request>(loggerContext);
     assert(additionalLogger_.hasValue());
     additionalLogger_->log(loggerContext);
+
+    if (const auto* keyspaceStats = config_->keyspaceStats()) {
+      if (loggerContext.requestClass.isNormal()) {
+        keyspaceStats->record(loggerContext.keyWithoutRoute,
+                              loggerContext.replyResult);
+      }
+    }
+
+    if (sample_) {
+      recordSampledHop(ap, reply.result(), endTimeUs - startTimeUs);
+    }
   }
 
+  /**
+   * Starts collecting a trace of this request. Called by the proxy for
+   * requests picked by its RequestSampler; the trace is completed and
+   * handed back to the sampler when the reply is sent.
+   */
+  void startSampling(const char* requestName,
+                     folly::StringPiece routingKey,
+                     std::string routePath);
+
   /**
    * Continues processing current request.
    * Should be called only from the attached proxy thread.
@@ -173,15 +200,44 @@ public:
    */
   uint64_t requestId() const;
 
+  /**
+   * True if this request has burned through the --request-cycle-budget
+   * of proxy CPU (as attributed by the cycles API). Once over, stays
+   * over. Always false unless both --cpu-cycles and
+   * --request-cycle-budget are set.
+   *
+   * Note: must be called from the attached proxy thread.
+   */
+  bool overCycleBudget() const;
+
  protected:
   bool replied_{false};
   std::shared_ptr<const ProxyConfig> config_;
 
+  /** Non-null iff this request was picked for sampling. */
+  std::unique_ptr<RequestSample> sample_;
+
   ProxyRequestContext(proxy_t& pr, ProxyRequestPriority priority__);
 
+  /**
+   * Completes the trace of a sampled request and stores it in the
+   * proxy's RequestSampler. May only be called if sample_ is non-null.
+   */
+  void finishSampling(mc_res_t replyResult, size_t replySize);
+
  private:
+  /* Hot block: fields the request/reply path reads, packed at the front;
+     the flags and priority share one word. Cold logging and test-only
+     state follows. */
+
   const uint64_t requestId_;
   proxy_t& proxy_;
+
+  /** Count of ProxyRequestContextPtr references; constructed at 1 so
+      that converting the initial unique_ptr to a counted reference is
+      free. Manipulated only through incRef()/decRef(). */
+  std::atomic<uint32_t> refcount_{1};
+
   bool failoverDisabled_{false};
 
   /** If true, this is currently being processed by a proxy and
@@ -190,11 +246,18 @@ public:
 
   bool recording_{false};
 
+  /** Set once overCycleBudget() first observes the budget exceeded */
+  mutable bool overCycleBudget_{false};
+
+  ProxyRequestPriority priority_{ProxyRequestPriority::kCritical};
+
   std::shared_ptr<McrouterClient> requester_;
 
   struct RecordingState {
     ClientCallback clientCallback;
     ShardSplitCallback shardSplitCallback;
+    /** Posted once the context is destroyed; see createRecordingNotify() */
+    folly::fibers::Baton* notifyBaton{nullptr};
   };
 
   union {
@@ -209,15 +272,32 @@ public:
    */
   void (*reqComplete_)(ProxyRequestContext& preq){nullptr};
 
+  /* Cold block: touched once per request at reply logging, or not at
+     all on the common path. */
+
   folly::Optional<ProxyRequestLogger> logger_;
   folly::Optional<AdditionalProxyRequestLogger> additionalLogger_;
 
   uint64_t senderIdForTest_{0};
 
-  ProxyRequestPriority priority_{ProxyRequestPriority::kCritical};
-
   std::string userIpAddr_;
 
+  void recordSampledHop(const AccessPoint& ap,
+                        mc_res_t result,
+                        int64_t durationUs);
+
+  void incRef() noexcept {
+    refcount_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Drops one reference. The last one destroys the context on the main
+   * context (the destructor can finalize stats and destroy a stale
+   * config, which needs more stack than a fiber has) and then posts
+   * the recording notify baton, if any.
+   */
+  void decRef() noexcept;
+
   enum RecordingT { Recording };
   ProxyRequestContext(
     RecordingT,
@@ -253,6 +333,9 @@ public:
 private:
   friend class McrouterClient;
   friend struct proxy_t;
+  friend struct ProxyRequestContextRefPolicy;
+  template <class T>
+  friend struct ProxyRequestContextTypedRefPolicy;
 };
 
 template <class Request>
@@ -286,11 +369,11 @@ class ProxyRequestContextTyped : public ProxyRequestContext {
 
   /**
    * Internally converts the context into one ready to route.
-   * Config pointer is saved to keep the config alive, and
-   * ownership is changed to shared so that all subrequests
-   * keep track of this context.
+   * Config pointer is saved to keep the config alive, and ownership
+   * is changed to counted references so that all subrequests keep
+   * track of this context.
    */
-  static std::shared_ptr<Type> process(
+  static ProxyRequestContextTypedPtr<Request> process(
       std::unique_ptr<Type> preq, std::shared_ptr<const ProxyConfig> config);
 
  protected:
@@ -317,6 +400,17 @@ createProxyRequestContext(
     F&& f,
     ProxyRequestPriority priority = ProxyRequestPriority::kCritical);
 
+/**
+ * Creates a new proxy request context that owns the request.
+ */
+template <class Request, class F>
+std::unique_ptr<ProxyRequestContextTyped<Request>>
+createOwnedProxyRequestContext(
+    proxy_t& pr,
+    Request&& req,
+    F&& f,
+    ProxyRequestPriority priority = ProxyRequestPriority::kCritical);
+
 }}}  // facebook::memcache::mcrouter
 
 #include "ProxyRequestContext-inl.h"
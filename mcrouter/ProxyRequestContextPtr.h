@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+
+#include "mcrouter/lib/Ref.h"
+
+namespace facebook {
+namespace memcache {
+namespace mcrouter {
+
+class ProxyRequestContext;
+
+template <class Request>
+class ProxyRequestContextTyped;
+
+/**
+ * Ref policy backed by the reference count embedded in
+ * ProxyRequestContext. Defined out of line (ProxyRequestContext.cpp)
+ * so that this header works where the context is an incomplete type,
+ * e.g. in McrouterFiberContext.h.
+ */
+struct ProxyRequestContextRefPolicy {
+  using Deleter = std::default_delete<ProxyRequestContext>;
+
+  static ProxyRequestContext* increfOrNull(ProxyRequestContext* ctx) noexcept;
+  static void decref(ProxyRequestContext* ctx) noexcept;
+};
+
+/**
+ * Same policy for the typed subclasses; the count is the one in the
+ * ProxyRequestContext base, shared with any ProxyRequestContextPtr
+ * referencing the same context. Only usable where
+ * ProxyRequestContext.h has been included.
+ */
+template <class T>
+struct ProxyRequestContextTypedRefPolicy {
+  using Deleter = std::default_delete<T>;
+
+  static T* increfOrNull(T* ctx) noexcept {
+    if (ctx != nullptr) {
+      ctx->incRef();
+    }
+    return ctx;
+  }
+
+  static void decref(T* ctx) noexcept {
+    if (ctx != nullptr) {
+      ctx->decRef();
+    }
+  }
+};
+
+/**
+ * Counted reference to a ProxyRequestContext. The count lives in the
+ * context itself, so cloning a reference touches no separate control
+ * block and dropping the last one destroys the context (on the main
+ * context) and fires its completion notification, if any.
+ */
+using ProxyRequestContextPtr =
+    Ref<ProxyRequestContext, ProxyRequestContextRefPolicy>;
+
+template <class Request>
+using ProxyRequestContextTypedPtr =
+    Ref<ProxyRequestContextTyped<Request>,
+        ProxyRequestContextTypedRefPolicy<ProxyRequestContextTyped<Request>>>;
+
+}}}  // facebook::memcache::mcrouter
@@ -20,7 +20,8 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 ProxyThread::ProxyThread(McrouterInstance& router, size_t id)
-    : evb_(/* enableTimeMeasurement */ false),
+    : router_(router),
+      evb_(/* enableTimeMeasurement */ false),
       proxy_(proxy_t::createProxy(router, evb_, id)) {
 }
 
@@ -29,30 +30,81 @@ void ProxyThread::spawn() {
   thread_ = std::thread([this] () { proxyThreadRun(); });
 }
 
+void ProxyThread::beginRetirement() noexcept {
+  CHECK(state_.exchange(State::RETIRING) == State::RUNNING);
+  proxy_->beingRetired = true;
+  /* wake the loop so it re-checks the drain condition */
+  evb_.runInEventBaseThread([] {});
+}
+
 void ProxyThread::stopAndJoin() noexcept {
-  if (thread_.joinable() && proxy_->router().pid() == getpid()) {
-    CHECK(state_.exchange(State::STOPPING) == State::RUNNING);
-    proxy_->sendMessage(ProxyMessage::Type::SHUTDOWN, nullptr);
-    CHECK(state_.exchange(State::STOPPED) == State::STOPPING);
-    evb_.terminateLoopSoon();
+  if (!thread_.joinable() || router_.pid() != getpid()) {
+    return;
+  }
+
+  auto prev = state_.exchange(State::STOPPING);
+  if (prev == State::STOPPED) {
+    /* a retired thread has already drained and left its loop */
+    state_ = State::STOPPED;
     thread_.join();
+    return;
   }
+
+  CHECK(prev == State::RUNNING || prev == State::RETIRING);
+  proxy_->sendMessage(ProxyMessage::Type::SHUTDOWN, nullptr);
+  CHECK(state_.exchange(State::STOPPED) == State::STOPPING);
+  evb_.terminateLoopSoon();
+  thread_.join();
 }
 
 void ProxyThread::proxyThreadRun() {
-  mcrouterSetThisThreadName(proxy_->router().opts(), "mcrpxy");
+  mcrouterSetThisThreadName(router_.opts(), "mcrpxy");
+  maybeBindToNumaNode();
 
-  while (state_ == State::RUNNING || proxy_->fiberManager.hasTasks()) {
+  while (state_ == State::RUNNING || proxy_->fiberManagersHaveTasks() ||
+         (state_ == State::RETIRING && proxy_->boundClients > 0)) {
     evb_.loopOnce();
     proxy_->drainMessageQueue();
   }
 
-  while (state_ != State::STOPPED) {
-    evb_.loopOnce();
+  /* A retiring thread exits on its own once drained. Shutdown may still
+     race in; in that case fall through to the normal stop handshake. */
+  auto expected = State::RETIRING;
+  if (!state_.compare_exchange_strong(expected, State::STOPPED)) {
+    while (state_ != State::STOPPED) {
+      evb_.loopOnce();
+    }
   }
 
   /* make sure proxy is deleted on the proxy thread */
   proxy_.reset();
 }
 
+void ProxyThread::maybeBindToNumaNode() {
+  const auto& opts = proxy_->router().opts();
+  if (opts.numa_policy.empty()) {
+    return;
+  }
+  if (opts.numa_policy != "interleave") {
+    LOG(ERROR) << "Unknown numa_policy '" << opts.numa_policy
+               << "', proxy threads will not be pinned";
+    return;
+  }
+
+  auto numNodes = mcrouterNumaNodeCount();
+  if (numNodes <= 1) {
+    return;
+  }
+
+  /* Bind before processing anything: fiber stacks, connection buffers
+     and most other hot memory are allocated lazily by this thread, so
+     first touch places them on the chosen node. (proxy_t itself and its
+     message queue were already allocated by the spawning thread.) */
+  auto node = proxy_->getId() % numNodes;
+  if (!mcrouterBindThisThreadToNumaNode(node)) {
+    LOG(WARNING) << "Failed to bind proxy thread " << proxy_->getId()
+                 << " to NUMA node " << node;
+  }
+}
+
 }}}  // facebook::memcache::mcrouter
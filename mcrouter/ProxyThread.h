@@ -41,16 +41,35 @@ class ProxyThread {
    */
   void spawn();
 
+  /**
+   * Starts graceful retirement of a running thread: the proxy is marked
+   * as retiring and the thread exits on its own once no clients are
+   * pinned to it and all in-flight work has drained. The caller must
+   * have already excluded the proxy from new client assignment.
+   */
+  void beginRetirement() noexcept;
+
+  /**
+   * @return  True once the thread has drained and left its loop (or was
+   *   never spawned), i.e. stopAndJoin() will return promptly and the
+   *   slot can be reused.
+   */
+  bool readyToReap() const noexcept {
+    return state_ == State::STOPPED;
+  }
+
   proxy_t& proxy() { return *proxy_; }
   folly::EventBase& eventBase() { return evb_; }
 
  private:
+  McrouterInstance& router_;
   folly::EventBase evb_;
   proxy_t::Pointer proxy_;
   std::thread thread_;
 
   enum class State {
     RUNNING,
+    RETIRING,
     STOPPING,
     STOPPED
   };
@@ -58,6 +77,12 @@ class ProxyThread {
 
   void stopAwriterThreads();
   void proxyThreadRun();
+
+  /**
+   * Applies the numa_policy option: with "interleave", pins this thread
+   * to a NUMA node chosen round-robin by proxy id.
+   */
+  void maybeBindToNumaNode();
 };
 
 
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "RequestSampler.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+folly::dynamic RequestSample::toDynamic() const {
+  return folly::dynamic::object
+      ("request_id", requestId)
+      ("request", requestName)
+      ("routing_key", routingKey)
+      ("route_path", routePath)
+      ("destinations", destinations)
+      ("result", mc_res_to_string(replyResult))
+      ("reply_size", replySize)
+      ("cycles", cycles)
+      ("start_time_us", startTimeUs)
+      ("duration_us", durationUs);
+}
+
+RequestSampler::RequestSampler(uint64_t sampleRate)
+    : sampleRate_(sampleRate) {
+  samples_.reserve(kMaxSamples);
+}
+
+void RequestSampler::add(RequestSample sample) {
+  folly::SpinLockGuard g(lock_);
+  if (samples_.size() < kMaxSamples) {
+    samples_.push_back(std::move(sample));
+  } else {
+    samples_[nextIdx_] = std::move(sample);
+  }
+  nextIdx_ = (nextIdx_ + 1) % kMaxSamples;
+}
+
+folly::dynamic RequestSampler::toDynamic() const {
+  folly::dynamic result = folly::dynamic::array;
+  folly::SpinLockGuard g(lock_);
+  const size_t numSamples = samples_.size();
+  // nextIdx_ points at the oldest sample once the buffer has wrapped.
+  const size_t start = numSamples < kMaxSamples ? 0 : nextIdx_;
+  for (size_t i = 0; i < numSamples; ++i) {
+    result.push_back(samples_[(start + i) % numSamples].toDynamic());
+  }
+  return result;
+}
+
+}}}  // facebook::memcache::mcrouter
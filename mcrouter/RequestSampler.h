@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <folly/dynamic.h>
+#include <folly/SpinLock.h>
+
+#include "mcrouter/lib/mc/msg.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Compact trace of a single sampled request.
+ */
+struct RequestSample {
+  uint64_t requestId{0};
+  const char* requestName{""};
+  std::string routingKey;
+
+  /// Route handle names the request's key descends through, one per tree
+  /// level (same format as the route_handles ServiceInfo command).
+  std::string routePath;
+
+  /// One entry per destination hop: "host:port result durationUs".
+  std::string destinations;
+
+  mc_res_t replyResult{mc_res_unknown};
+  size_t replySize{0};
+
+  /// CPU cycles attributed to this request by the cycles framework
+  /// (0 unless --cpu-cycles is enabled).
+  uint64_t cycles{0};
+
+  int64_t startTimeUs{0};
+  int64_t durationUs{0};
+
+  folly::dynamic toDynamic() const;
+};
+
+/**
+ * Keeps traces of 1 out of every N requests processed by one proxy thread
+ * in a fixed-size ring buffer (oldest samples are overwritten).
+ *
+ * shouldSample() and add() may only be called from the proxy thread that
+ * owns this sampler; snapshots can be taken from any thread.
+ */
+class RequestSampler {
+ public:
+  explicit RequestSampler(uint64_t sampleRate);
+
+  /**
+   * @return true for 1 out of every sampleRate requests.
+   */
+  bool shouldSample() {
+    return sampleRate_ != 0 && ++counter_ % sampleRate_ == 0;
+  }
+
+  /**
+   * Stores a completed sample, overwriting the oldest one if the buffer
+   * is full.
+   */
+  void add(RequestSample sample);
+
+  /**
+   * Snapshot of the currently buffered samples, oldest first.
+   */
+  folly::dynamic toDynamic() const;
+
+ private:
+  // Number of most recent samples to keep per proxy.
+  static constexpr size_t kMaxSamples = 256;
+
+  const uint64_t sampleRate_;
+  uint64_t counter_{0};
+
+  // Guards samples_/nextIdx_ against concurrent snapshots. Uncontended on
+  // the request path unless a snapshot is being taken.
+  mutable folly::SpinLock lock_;
+  std::vector<RequestSample> samples_;
+  size_t nextIdx_{0};
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,35 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "RouteHandleProfiler.h"
+
+#include <algorithm>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+void RouteHandleProfiler::record(const std::string& name, uint64_t cycles) {
+  folly::SpinLockGuard g(lock_);
+  auto& entry = entries_[name];
+  ++entry.calls;
+  entry.totalCycles += cycles;
+  entry.maxCycles = std::max(entry.maxCycles, cycles);
+}
+
+std::vector<std::pair<std::string, RouteHandleProfiler::Entry>>
+RouteHandleProfiler::entries() const {
+  std::vector<std::pair<std::string, Entry>> result;
+  folly::SpinLockGuard g(lock_);
+  result.reserve(entries_.size());
+  for (const auto& it : entries_) {
+    result.emplace_back(it.first.str(), it.second);
+  }
+  return result;
+}
+
+}}}  // facebook::memcache::mcrouter
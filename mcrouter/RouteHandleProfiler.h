@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/SpinLock.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Per-proxy aggregation of CPU cycles spent in route handles, fed by
+ * ProfilingRoute wrappers (see --route-handle-profiling).
+ *
+ * Entries are keyed by the wrapped handle's routeName(), which carries
+ * both the handle type and its config-given detail (e.g. "pool|cold"),
+ * so the same name aggregates one handle type per place in the config
+ * across config generations.
+ */
+class RouteHandleProfiler {
+ public:
+  struct Entry {
+    uint64_t calls{0};
+    uint64_t totalCycles{0};
+    uint64_t maxCycles{0};
+  };
+
+  /**
+   * Records one route() call through the named handle. May only be
+   * called from the proxy thread that owns this profiler.
+   */
+  void record(const std::string& name, uint64_t cycles);
+
+  /**
+   * Snapshot of all entries, in no particular order. Any thread.
+   */
+  std::vector<std::pair<std::string, Entry>> entries() const;
+
+ private:
+  // Guards entries_; uncontended on the request path unless a snapshot
+  // is being taken.
+  mutable folly::SpinLock lock_;
+  folly::StringKeyedUnorderedMap<Entry> entries_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -27,11 +27,20 @@ RuntimeVarsData::RuntimeVarsData(folly::StringPiece json) {
 
 folly::dynamic
 RuntimeVarsData::getVariableByName(const std::string& name) const {
+  const auto* value = getVariablePtrByName(name);
+  if (value == nullptr) {
+    return nullptr;
+  }
+  return *value;
+}
+
+const folly::dynamic*
+RuntimeVarsData::getVariablePtrByName(const std::string& name) const {
   auto value = configData_.find(name);
   if (value == configData_.end()) {
     return nullptr;
   }
-  return value->second;
+  return &value->second;
 }
 
 }}} // facebook::memcache::mcrouter
@@ -30,6 +30,16 @@ class RuntimeVarsData {
    */
   folly::dynamic getVariableByName(const std::string& name) const;
 
+  /**
+   * Like getVariableByName, but without copying the value: the returned
+   * pointer refers into this snapshot and is valid for as long as the
+   * caller holds it (consumers receive RuntimeVarsData as an immutable
+   * shared_ptr snapshot).
+   *
+   * @return Pointer to the variable value, or nullptr if key not found
+   */
+  const folly::dynamic* getVariablePtrByName(const std::string& name) const;
+
  private:
   std::unordered_map<std::string, folly::dynamic> configData_;
 };
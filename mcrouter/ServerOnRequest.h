@@ -0,0 +1,98 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "mcrouter/config.h"
+#include "mcrouter/lib/network/AsyncMcServer.h"
+#include "mcrouter/lib/network/AsyncMcServerWorker.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/McServerRequestContext.h"
+#include "mcrouter/lib/network/ThriftMessageList.h"
+#include "mcrouter/lib/network/ThriftMsgDispatcher.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/McrouterClient.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+class ServerOnRequest : public ThriftMsgDispatcher<TRequestList,
+                                                   ServerOnRequest,
+                                                   McServerRequestContext&&> {
+ public:
+  template <class Request>
+  using ReplyFunction = void (*)(McServerRequestContext&& ctx,
+                                 ReplyT<Request>&& reply);
+
+  ServerOnRequest(McrouterClient& client, bool retainSourceIp)
+    : client_(client),
+      retainSourceIp_(retainSourceIp) {}
+
+  template <class ThriftType>
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<ThriftType>&& req) {
+    using Reply = ReplyT<TypedThriftRequest<ThriftType>>;
+    send(std::move(ctx),
+         std::move(req),
+         &McServerRequestContext::reply<Reply>);
+  }
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<cpp2::McVersionRequest>&&) {
+    TypedThriftReply<cpp2::McVersionReply> reply(mc_res_ok);
+    reply.setValue(MCROUTER_PACKAGE_STRING);
+
+    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+  }
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<cpp2::McQuitRequest>&&) {
+    using Reply = TypedThriftReply<cpp2::McQuitReply>;
+    McServerRequestContext::reply(std::move(ctx), Reply(mc_res_ok));
+  }
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<cpp2::McShutdownRequest>&&) {
+    using Reply = TypedThriftReply<cpp2::McShutdownReply>;
+    McServerRequestContext::reply(std::move(ctx), Reply(mc_res_ok));
+  }
+
+  void requestBatchStarted() {
+    client_.startRequestBatch();
+  }
+
+  void requestBatchFinished() {
+    client_.finishRequestBatch();
+  }
+
+  template <class Request>
+  void send(McServerRequestContext&& ctx,
+            Request&& req,
+            ReplyFunction<Request> replyFn) {
+    /* The request moves into the proxy request context (the owning send
+       overload) and the server context into the reply callback, so no
+       separate wrapper allocation is needed to keep either alive. */
+    std::string peerIp;
+    if (retainSourceIp_) {
+      peerIp = ctx.session().getSocketAddress().getAddressStr();
+    }
+
+    auto cb = [ ctx = std::move(ctx), replyFn ](
+        const Request&, ReplyT<Request>&& reply) mutable {
+      replyFn(std::move(ctx), std::move(reply));
+    };
+
+    client_.send(std::move(req), std::move(cb), peerIp);
+  }
+
+ private:
+  McrouterClient& client_;
+  bool retainSourceIp_{false};
+};
+
+}}} // facebook::memcache::mcrouter
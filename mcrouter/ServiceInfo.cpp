@@ -9,6 +9,7 @@
  */
 #include "ServiceInfo.h"
 
+#include <algorithm>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -18,9 +19,11 @@
 #include <folly/json.h>
 #include <folly/Memory.h>
 #include <folly/Range.h>
+#include <folly/String.h>
 
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
+#include "mcrouter/ConfigCost.h"
 #include "mcrouter/lib/fbi/cpp/globals.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/McRequestList.h"
@@ -30,35 +33,69 @@
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/options.h"
 #include "mcrouter/proxy.h"
+#include "mcrouter/ProxyConfig.h"
 #include "mcrouter/ProxyConfigBuilder.h"
+#include "mcrouter/RequestSampler.h"
 #include "mcrouter/routes/ProxyRoute.h"
+#include "mcrouter/routes/SwappableRoute.h"
 #include "mcrouter/standalone_options.h"
+#include "mcrouter/TkoEventRing.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+
+/* Size of one page of a paginated service info reply (trailing "page=N"
+   argument). Clients fetch pages 0, 1, ... and stop on a short or empty
+   chunk. */
+constexpr size_t kResultPageSize = 64 * 1024;
+constexpr folly::StringPiece kPageArgPrefix{"page="};
+
+std::string resultPage(const std::string& result, size_t page) {
+  const size_t begin = page * kResultPageSize;
+  if (begin >= result.size()) {
+    return "";
+  }
+  return result.substr(begin, kResultPageSize);
+}
+
+} // anonymous namespace
+
 struct ServiceInfo::ServiceInfoImpl {
+  struct Command {
+    std::function<std::string(const std::vector<folly::StringPiece>& args)> fn;
+    /* Whether the result is fully determined by the current config and
+       the arguments, so it can be memoized. */
+    bool cacheable{false};
+  };
+
   proxy_t* proxy_;
   ProxyRoute& proxyRoute_;
-  std::unordered_map<
-    std::string,
-    std::function<std::string(const std::vector<folly::StringPiece>& args)>>
-  commands_;
+  std::unordered_map<std::string, Command> commands_;
+  /*
+   * Memoized results of cacheable commands, keyed by command and
+   * arguments. This ServiceInfo lives on its ProxyConfig and is only
+   * accessed from the owning proxy thread, so the cache needs no locking
+   * and is dropped wholesale on reconfig (each config generation builds
+   * a fresh ServiceInfo).
+   */
+  mutable std::unordered_map<std::string, std::string> resultCache_;
 
   ServiceInfoImpl(proxy_t* proxy, const ProxyConfig& config);
 
   template <class Request>
   void handleRequest(
       folly::StringPiece req,
-      const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx) const;
+      const ProxyRequestContextTypedPtr<Request>& ctx) const;
 
   template <class Request>
   void handleRouteCommand(
-      const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+      const ProxyRequestContextTypedPtr<Request>& ctx,
       const std::vector<folly::StringPiece>& args) const;
 
   template <class Request, class Operation>
   void handleRouteCommandForOp(
-      const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+      const ProxyRequestContextTypedPtr<Request>& ctx,
       std::string keyStr,
       Operation) const;
 
@@ -66,20 +103,20 @@ struct ServiceInfo::ServiceInfoImpl {
   void routeCommandHelper(
       folly::StringPiece op,
       folly::StringPiece key,
-      const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+      const ProxyRequestContextTypedPtr<Request>& ctx,
       McOpList::Item<0>) const;
 
   template <class Request, int op_id>
   void routeCommandHelper(
       folly::StringPiece op,
       folly::StringPiece key,
-      const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+      const ProxyRequestContextTypedPtr<Request>& ctx,
       McOpList::Item<op_id>) const;
 };
 
 template <class Request, class Operation>
 void ServiceInfo::ServiceInfoImpl::handleRouteCommandForOp(
-    const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+    const ProxyRequestContextTypedPtr<Request>& ctx,
     std::string keyStr,
     Operation) const {
   proxy_->fiberManager.addTaskFinally(
@@ -105,7 +142,8 @@ void ServiceInfo::ServiceInfoImpl::handleRouteCommandForOp(
       baton.wait();
       return destinations;
     },
-    [ctx](folly::Try<std::unique_ptr<std::vector<std::string>>>&& data) {
+    [ctx = ctx.clone()](
+        folly::Try<std::unique_ptr<std::vector<std::string>>>&& data) {
       std::string str;
       const auto& destinations = *data;
       for (const auto& d : *destinations) {
@@ -163,7 +201,7 @@ template <class Request>
 void ServiceInfo::ServiceInfoImpl::routeCommandHelper(
     folly::StringPiece op,
     folly::StringPiece,
-    const std::shared_ptr<ProxyRequestContextTyped<Request>>&,
+    const ProxyRequestContextTypedPtr<Request>&,
     McOpList::Item<0>) const {
 
   throw std::runtime_error("route: unknown op " + op.str());
@@ -173,7 +211,7 @@ template <class Request, int op_id>
 void ServiceInfo::ServiceInfoImpl::routeCommandHelper(
     folly::StringPiece op,
     folly::StringPiece key,
-    const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+    const ProxyRequestContextTypedPtr<Request>& ctx,
     McOpList::Item<op_id>) const {
 
   if (op == mc_op_to_string(McOpList::Item<op_id>::op::mc_op)) {
@@ -200,20 +238,20 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
     : proxy_(proxy),
       proxyRoute_(config.proxyRoute()) {
 
-  commands_.emplace("version",
+  commands_.emplace("version", Command{
     [] (const std::vector<folly::StringPiece>& args) {
       return MCROUTER_PACKAGE_STRING;
-    }
-  );
+    },
+    true});
 
-  commands_.emplace("config_age",
+  commands_.emplace("config_age", Command{
     [proxy] (const std::vector<folly::StringPiece>& args) {
       /* capturing this and accessing proxy_ crashes gcc-4.7 */
       return std::to_string(stat_get_config_age(proxy->stats, time(nullptr)));
-    }
-  );
+    },
+    false});
 
-  commands_.emplace("config_file",
+  commands_.emplace("config_file", Command{
     [this] (const std::vector<folly::StringPiece>& args) {
       folly::StringPiece configStr = proxy_->router().opts().config;
       if (configStr.startsWith(ConfigApi::kFilePrefix)) {
@@ -226,10 +264,10 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
       }
 
       return proxy_->router().opts().config_file;
-    }
-  );
+    },
+    true});
 
-  commands_.emplace("options",
+  commands_.emplace("options", Command{
     [this] (const std::vector<folly::StringPiece>& args) {
       if (args.size() > 1) {
         throw std::runtime_error("options: 0 or 1 args expected");
@@ -257,8 +295,8 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
         }
       }
       return str;
-    }
-  );
+    },
+    true});
 
   /*
     This is a special case and handled separately below
@@ -268,7 +306,7 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
 
   */
 
-  commands_.emplace("route_handles",
+  commands_.emplace("route_handles", Command{
     [this] (const std::vector<folly::StringPiece>& args) {
       if (args.size() != 2) {
         throw std::runtime_error("route_handles: 2 args expected");
@@ -278,26 +316,26 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
 
       return routeHandlesCommandHelper(op, key, proxyRoute_,
                                        McOpList::LastItem());
-    }
-  );
+    },
+    true});
 
-  commands_.emplace("config_md5_digest",
+  commands_.emplace("config_md5_digest", Command{
     [&config] (const std::vector<folly::StringPiece>& args) {
       if (config.getConfigMd5Digest().empty()) {
         throw std::runtime_error("no config md5 digest found!");
       }
       return config.getConfigMd5Digest();
-    }
-  );
+    },
+    true});
 
-  commands_.emplace("config_sources_info",
+  commands_.emplace("config_sources_info", Command{
     [this] (const std::vector<folly::StringPiece>& args) {
       auto configInfo = proxy_->router().configApi().getConfigSourcesInfo();
       return toPrettySortedJson(configInfo);
-    }
-  );
+    },
+    false});
 
-  commands_.emplace("preprocessed_config",
+  commands_.emplace("preprocessed_config", Command{
     [this] (const std::vector<folly::StringPiece>& args) {
       std::string confFile;
       std::string path;
@@ -308,16 +346,110 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
                                  proxy_->router().configApi(),
                                  confFile);
       return toPrettySortedJson(builder.preprocessedConfig());
-    }
-  );
+    },
+    true});
+
+  commands_.emplace("pool_swap", Command{
+    [this] (const std::vector<folly::StringPiece>& args) {
+      auto config = proxy_->getConfig();
+      if (args.empty()) {
+        std::string str;
+        for (const auto& pool : config->getSwappableRoutes()) {
+          if (!pool.second.empty()) {
+            str.append(folly::sformat("{} -> {}\n", pool.first,
+                                      pool.second.front()->targetName()));
+          }
+        }
+        return str;
+      }
+      if (args.size() != 2) {
+        throw std::runtime_error("pool_swap: 0 or 2 args expected");
+      }
+      auto swapped = config->swapPoolRoute(args[0], args[1]);
+
+      /* Other proxy threads run their own trees; ask each to apply the
+         same swap against its current config. */
+      auto& router = proxy_->router();
+      auto numProxies = router.proxyCount();
+      for (size_t i = 0; i < numProxies; ++i) {
+        auto otherProxy = router.getProxy(i);
+        if (otherProxy != proxy_) {
+          otherProxy->sendMessage(
+              ProxyMessage::Type::POOL_SWAP,
+              new pool_swap_req_t(args[0].str(), args[1].str()));
+        }
+      }
+      return folly::sformat(
+          "swapped {} route handle(s); broadcast to {} other proxy thread(s)",
+          swapped, numProxies - 1);
+    },
+    false});
+
+  commands_.emplace("config_cost", Command{
+    [this] (const std::vector<folly::StringPiece>& args) {
+      std::string confFile;
+      std::string path;
+      if (!proxy_->router().configApi().getConfigFile(confFile, path)) {
+        throw std::runtime_error("Can not load config from " + path);
+      }
+      ProxyConfigBuilder builder(proxy_->router().opts(),
+                                 proxy_->router().configApi(),
+                                 confFile);
+      /* Dry run: build the tree for the config currently on disk (which
+         may be newer than the running one) and throw it away. */
+      auto config = builder.buildConfig(*proxy_);
+      return toPrettySortedJson(configCostReport(*config));
+    },
+    false});
+
+  commands_.emplace("sampled_requests", Command{
+    [this] (const std::vector<folly::StringPiece>& args) {
+      auto& router = proxy_->router();
+      folly::dynamic samples = folly::dynamic::array;
+      for (size_t i = 0; i < router.proxyCount(); ++i) {
+        if (const auto& sampler = router.getProxy(i)->requestSampler) {
+          auto proxySamples = sampler->toDynamic();
+          for (auto& sample : proxySamples) {
+            samples.push_back(std::move(sample));
+          }
+        }
+      }
+      return toPrettySortedJson(samples);
+    },
+    false});
 
-  commands_.emplace("hostid",
+  commands_.emplace("tko_events", Command{
+    [this] (const std::vector<folly::StringPiece>& args) {
+      auto& router = proxy_->router();
+      std::vector<folly::dynamic> events;
+      for (size_t i = 0; i < router.proxyCount(); ++i) {
+        auto proxyEvents = router.getProxy(i)->tkoEventRing->toDynamic();
+        for (auto& event : proxyEvents) {
+          event["proxy"] = i;
+          events.push_back(std::move(event));
+        }
+      }
+      // Each ring is individually ordered; merge them into a single
+      // timeline (TscClock timestamps are comparable across threads).
+      std::sort(events.begin(), events.end(),
+                [](const folly::dynamic& a, const folly::dynamic& b) {
+                  return a.at("time_us") < b.at("time_us");
+                });
+      folly::dynamic merged = folly::dynamic::array;
+      for (auto& event : events) {
+        merged.push_back(std::move(event));
+      }
+      return toPrettySortedJson(merged);
+    },
+    false});
+
+  commands_.emplace("hostid", Command{
     [] (const std::vector<folly::StringPiece>& args) {
       return folly::to<std::string>(globals::hostid());
-    }
-  );
+    },
+    true});
 
-  commands_.emplace("verbosity",
+  commands_.emplace("verbosity", Command{
     [] (const std::vector<folly::StringPiece>& args) {
       if (args.size() == 1) {
         auto before = FLAGS_v;
@@ -328,14 +460,14 @@ ServiceInfo::ServiceInfoImpl::ServiceInfoImpl(proxy_t* proxy,
       }
       throw std::runtime_error("expected at most 1 argument, got "
             + folly::to<std::string>(args.size()));
-    }
-  );
+    },
+    false});
 }
 
 template <class Request>
 void ServiceInfo::ServiceInfoImpl::handleRequest(
     folly::StringPiece key,
-    const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx) const {
+    const ProxyRequestContextTypedPtr<Request>& ctx) const {
 
   auto p = key.find('(');
   auto cmd = key;
@@ -352,6 +484,18 @@ void ServiceInfo::ServiceInfoImpl::handleRequest(
     folly::split(',', argsStr, args);
   }
 
+  /* Any command accepts a trailing "page=N" argument selecting the Nth
+     kResultPageSize-byte chunk of the (possibly memoized) full result. */
+  bool paged = false;
+  size_t page = 0;
+  if (!args.empty() && args.back().startsWith(kPageArgPrefix)) {
+    auto pageStr = args.back();
+    pageStr.removePrefix(kPageArgPrefix);
+    page = folly::to<size_t>(pageStr);
+    paged = true;
+    args.pop_back();
+  }
+
   std::string replyStr;
   try {
     if (cmd == "route") {
@@ -364,9 +508,30 @@ void ServiceInfo::ServiceInfoImpl::handleRequest(
     if (it == commands_.end()) {
       throw std::runtime_error("unknown command: " + cmd.str());
     }
-    replyStr = it->second(args);
-    if (!replyStr.empty() && replyStr.back() == '\n') {
-      replyStr = replyStr.substr(0, replyStr.size() - 1);
+    const auto& command = it->second;
+    bool cached = false;
+    if (command.cacheable) {
+      auto cacheKey = cmd.str() + "|" + folly::join(',', args);
+      auto cacheIt = resultCache_.find(cacheKey);
+      if (cacheIt == resultCache_.end()) {
+        auto result = command.fn(args);
+        if (!result.empty() && result.back() == '\n') {
+          result = result.substr(0, result.size() - 1);
+        }
+        cacheIt = resultCache_.emplace(std::move(cacheKey),
+                                       std::move(result)).first;
+      }
+      replyStr = paged ? resultPage(cacheIt->second, page) : cacheIt->second;
+      cached = true;
+    }
+    if (!cached) {
+      replyStr = command.fn(args);
+      if (!replyStr.empty() && replyStr.back() == '\n') {
+        replyStr = replyStr.substr(0, replyStr.size() - 1);
+      }
+      if (paged) {
+        replyStr = resultPage(replyStr, page);
+      }
     }
   } catch (const std::exception& e) {
     replyStr = std::string("ERROR: ") + e.what();
@@ -378,7 +543,7 @@ void ServiceInfo::ServiceInfoImpl::handleRequest(
 
 template <class Request>
 void ServiceInfo::ServiceInfoImpl::handleRouteCommand(
-    const std::shared_ptr<ProxyRequestContextTyped<Request>>& ctx,
+    const ProxyRequestContextTypedPtr<Request>& ctx,
     const std::vector<folly::StringPiece>& args) const {
 
   if (args.size() != 2) {
@@ -392,8 +557,8 @@ void ServiceInfo::ServiceInfoImpl::handleRouteCommand(
 
 void ServiceInfo::handleRequest(
     folly::StringPiece key,
-    const std::shared_ptr<ProxyRequestContextTyped<
-        TypedThriftRequest<cpp2::McGetRequest>>>& ctx) const {
+    const ProxyRequestContextTypedPtr<
+        TypedThriftRequest<cpp2::McGetRequest>>& ctx) const {
   impl_->handleRequest(key, ctx);
 }
 
@@ -15,12 +15,11 @@
 
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/ProxyRequestContextPtr.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
 class ProxyConfig;
-template <class Request>
-class ProxyRequestContextTyped;
 struct proxy_t;
 
 /**
@@ -33,8 +32,8 @@ class ServiceInfo {
 
   void handleRequest(
       folly::StringPiece req,
-      const std::shared_ptr<ProxyRequestContextTyped<
-          TypedThriftRequest<cpp2::McGetRequest>>>& ctx) const;
+      const ProxyRequestContextTypedPtr<
+          TypedThriftRequest<cpp2::McGetRequest>>& ctx) const;
 
   ~ServiceInfo();
 
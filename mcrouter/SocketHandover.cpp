@@ -0,0 +1,252 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "SocketHandover.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include <glog/logging.h>
+
+#include <folly/String.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+constexpr size_t kMaxHandoverFds = 64;
+constexpr char kHandoverMagic = 'h';
+
+bool fillSockaddrUn(const std::string& path, sockaddr_un& addr) {
+  if (path.size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Handover socket path too long: " << path;
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.data(), path.size());
+  return true;
+}
+
+} // anonymous namespace
+
+std::vector<int> requestListeningSockets(const std::string& controlPath) {
+  std::vector<int> fds;
+
+  sockaddr_un addr;
+  if (!fillSockaddrUn(controlPath, addr)) {
+    return fds;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    LOG(ERROR) << "Failed to create handover socket: "
+               << folly::errnoStr(errno);
+    return fds;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    /* No running instance; this is the common cold-start case. */
+    ::close(fd);
+    return fds;
+  }
+
+  char buf[1];
+  union {
+    char data[CMSG_SPACE(sizeof(int) * kMaxHandoverFds)];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data;
+  msg.msg_controllen = sizeof(control.data);
+
+  ssize_t n;
+  do {
+    n = ::recvmsg(fd, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+
+  if (n > 0 && buf[0] == kHandoverMagic) {
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr;
+         c = CMSG_NXTHDR(&msg, c)) {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+        size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const int* received = reinterpret_cast<const int*>(CMSG_DATA(c));
+        fds.assign(received, received + count);
+      }
+    }
+  } else if (n < 0) {
+    LOG(ERROR) << "Failed to receive listening sockets: "
+               << folly::errnoStr(errno);
+  }
+  ::close(fd);
+  return fds;
+}
+
+SocketHandoverServer::SocketHandoverServer(
+  std::string controlPath,
+  std::vector<int> listeningFds,
+  size_t drainTimeoutMs,
+  std::function<void()> onPauseAccepting,
+  std::function<void()> onDrained)
+    : path_(std::move(controlPath)),
+      fds_(std::move(listeningFds)),
+      drainTimeoutMs_(drainTimeoutMs),
+      onPauseAccepting_(std::move(onPauseAccepting)),
+      onDrained_(std::move(onDrained)) {
+}
+
+SocketHandoverServer::~SocketHandoverServer() {
+  stop();
+}
+
+bool SocketHandoverServer::start() {
+  if (fds_.size() > kMaxHandoverFds) {
+    LOG(ERROR) << "Too many listening sockets for handover: " << fds_.size();
+    return false;
+  }
+
+  sockaddr_un addr;
+  if (!fillSockaddrUn(path_, addr)) {
+    return false;
+  }
+
+  listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd_ < 0) {
+    LOG(ERROR) << "Failed to create handover control socket: "
+               << folly::errnoStr(errno);
+    return false;
+  }
+
+  /* An old instance unlinks the path before sending us its fds, so any
+     file still present here is stale (e.g. after a crash). */
+  std::remove(path_.c_str());
+  if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr),
+             sizeof(addr)) != 0 ||
+      ::listen(listenFd_, 1) != 0) {
+    LOG(ERROR) << "Failed to listen on handover control socket " << path_
+               << ": " << folly::errnoStr(errno);
+    ::close(listenFd_);
+    listenFd_ = -1;
+    return false;
+  }
+
+  thread_ = std::thread([this]() { loop(); });
+  return true;
+}
+
+void SocketHandoverServer::stop() {
+  if (stopped_.exchange(true)) {
+    return;
+  }
+  if (listenFd_ >= 0) {
+    /* unblocks accept() in loop() */
+    ::shutdown(listenFd_, SHUT_RDWR);
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (listenFd_ >= 0) {
+    ::close(listenFd_);
+    listenFd_ = -1;
+    std::remove(path_.c_str());
+  }
+}
+
+void SocketHandoverServer::loop() {
+  int conn = -1;
+  while (!stopped_) {
+    conn = ::accept(listenFd_, nullptr, nullptr);
+    if (conn >= 0 || errno != EINTR) {
+      break;
+    }
+  }
+  if (conn < 0) {
+    return;
+  }
+  if (stopped_) {
+    ::close(conn);
+    return;
+  }
+
+  LOG(INFO) << "Handover requested; passing " << fds_.size()
+            << " listening socket(s) to the new instance";
+
+  /* Unlink the control path before sending, so the new instance can bind
+     it as soon as it has the fds.  Our listener stays open but orphaned;
+     stop() closes it. */
+  std::remove(path_.c_str());
+
+  if (!sendFds(conn)) {
+    ::close(conn);
+    return;
+  }
+  ::close(conn);
+
+  onPauseAccepting_();
+
+  LOG(INFO) << "Draining existing connections for up to "
+            << drainTimeoutMs_ << "ms before shutdown";
+  auto deadline =
+    std::chrono::steady_clock::now() +
+    std::chrono::milliseconds(drainTimeoutMs_);
+  while (!stopped_ && std::chrono::steady_clock::now() < deadline) {
+    /* sleep in slices so stop() doesn't block for the full drain */
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  onDrained_();
+}
+
+bool SocketHandoverServer::sendFds(int conn) {
+  char buf[1] = {kHandoverMagic};
+  union {
+    char data[CMSG_SPACE(sizeof(int) * kMaxHandoverFds)];
+    struct cmsghdr align;
+  } control;
+  memset(control.data, 0, sizeof(control.data));
+
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds_.size());
+
+  struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int) * fds_.size());
+  memcpy(CMSG_DATA(c), fds_.data(), sizeof(int) * fds_.size());
+
+  ssize_t n;
+  do {
+    n = ::sendmsg(conn, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    LOG(ERROR) << "Failed to send listening sockets: "
+               << folly::errnoStr(errno);
+    return false;
+  }
+  return true;
+}
+
+}}}  // facebook::memcache::mcrouter
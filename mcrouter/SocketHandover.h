@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Zero-downtime restart support for standalone mcrouter.
+ *
+ * A running instance listens on a unix domain control socket.  A newly
+ * started instance connects to that socket and receives the listening
+ * socket fds over SCM_RIGHTS, so it can serve new connections without
+ * rebinding.  The old instance then stops accepting, keeps serving its
+ * existing connections for a drain period and shuts down.
+ */
+
+/**
+ * New-instance side: ask a running instance (if any) for its listening
+ * sockets.
+ *
+ * @param controlPath  Path of the control socket of the running instance.
+ *
+ * @return  The received listening socket fds, or an empty vector if no
+ *          instance is listening on controlPath.
+ */
+std::vector<int> requestListeningSockets(const std::string& controlPath);
+
+/**
+ * Old-instance side: owns the control socket and performs at most one
+ * handover per process lifetime.
+ */
+class SocketHandoverServer {
+ public:
+  /**
+   * @param controlPath       Control socket path to listen on.
+   * @param listeningFds      Listening socket fds to pass on.
+   * @param drainTimeoutMs    How long to keep serving existing
+   *                          connections after the handover.
+   * @param onPauseAccepting  Called right after the fds were sent;
+   *                          should stop accepting new connections.
+   * @param onDrained         Called once the drain period is over (or we
+   *                          were stopped); should shut the server down.
+   *
+   * Both callbacks run on the handover thread.
+   */
+  SocketHandoverServer(std::string controlPath,
+                       std::vector<int> listeningFds,
+                       size_t drainTimeoutMs,
+                       std::function<void()> onPauseAccepting,
+                       std::function<void()> onDrained);
+  ~SocketHandoverServer();
+
+  /**
+   * Binds the control socket and starts the handover thread.
+   *
+   * @return  true on success; false (with a logged error) otherwise.
+   */
+  bool start();
+
+  /**
+   * Stops the handover thread and removes the control socket if no
+   * handover happened.  Called automatically by the destructor.
+   */
+  void stop();
+
+ private:
+  const std::string path_;
+  const std::vector<int> fds_;
+  const size_t drainTimeoutMs_;
+  const std::function<void()> onPauseAccepting_;
+  const std::function<void()> onDrained_;
+  int listenFd_{-1};
+  std::atomic<bool> stopped_{false};
+  std::thread thread_;
+
+  void loop();
+  bool sendFds(int conn);
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "StatsDeltaFormat.h"
+
+#include <cstring>
+
+#include <folly/Varint.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+template <class T>
+void appendInt(T value, std::string& out) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendVarint(uint64_t value, std::string& out) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  const auto len = folly::encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), len);
+}
+
+template <class T>
+bool readInt(folly::StringPiece& data, T& value) {
+  if (data.size() < sizeof(T)) {
+    return false;
+  }
+  memcpy(&value, data.data(), sizeof(T));
+  data.advance(sizeof(T));
+  return true;
+}
+
+bool readVarint(folly::StringPiece& data, uint64_t& value) {
+  folly::ByteRange range(data);
+  try {
+    value = folly::decodeVarint(range);
+  } catch (const std::exception&) {
+    return false;
+  }
+  data.advance(data.size() - range.size());
+  return true;
+}
+
+/** The stat's value as raw bits; all numeric union members are 8 bytes. */
+uint64_t rawValue(const stat_t& stat) {
+  uint64_t bits;
+  memcpy(&bits, &stat.data.uint64, sizeof(bits));
+  return bits;
+}
+
+} // anonymous namespace
+
+void StatsDeltaWriter::appendNameTable(const std::vector<stat_t>& stats,
+                                       std::string& out) {
+  for (size_t i = 0; i < stats.size(); ++i) {
+    if (!(stats[i].group & groupMask_)) {
+      continue;
+    }
+    if (!spoolOutlierStats_ && (stats[i].group & outlier_stats)) {
+      continue;
+    }
+    switch (stats[i].type) {
+      case stat_uint64:
+      case stat_int64:
+      case stat_double:
+        spooled_.push_back(i);
+        break;
+      default:
+        break;
+    }
+  }
+  prev_.assign(spooled_.size(), 0);
+
+  appendInt(kStatsDeltaTableMagic, out);
+  const auto sizePos = out.size();
+  appendInt<uint32_t>(0, out);  // payload size, patched below
+  const auto payloadPos = out.size();
+
+  appendVarint(spooled_.size(), out);
+  for (const auto idx : spooled_) {
+    const auto name = stats[idx].name;
+    appendVarint(name.size(), out);
+    out.append(name.data(), name.size());
+  }
+
+  const uint32_t payloadSize = out.size() - payloadPos;
+  memcpy(&out[sizePos], &payloadSize, sizeof(payloadSize));
+}
+
+void StatsDeltaWriter::appendTick(const std::vector<stat_t>& stats,
+                                  uint64_t timestampMs,
+                                  std::string& out) {
+  if (spooled_.empty()) {
+    appendNameTable(stats, out);
+  }
+
+  appendInt(kStatsDeltaTickMagic, out);
+  const auto sizePos = out.size();
+  appendInt<uint32_t>(0, out);  // payload size, patched below
+  const auto payloadPos = out.size();
+
+  appendInt(timestampMs, out);
+
+  size_t numChanged = 0;
+  for (size_t i = 0; i < spooled_.size(); ++i) {
+    if (rawValue(stats[spooled_[i]]) != prev_[i]) {
+      ++numChanged;
+    }
+  }
+  appendVarint(numChanged, out);
+
+  for (size_t i = 0; i < spooled_.size(); ++i) {
+    const auto& stat = stats[spooled_[i]];
+    const auto bits = rawValue(stat);
+    if (bits == prev_[i]) {
+      continue;
+    }
+    appendVarint(i, out);
+    out.push_back(static_cast<char>(stat.type));
+    if (stat.type == stat_double) {
+      appendInt(bits, out);
+    } else {
+      appendVarint(
+          folly::encodeZigZag(static_cast<int64_t>(bits - prev_[i])), out);
+    }
+    prev_[i] = bits;
+  }
+
+  const uint32_t payloadSize = out.size() - payloadPos;
+  memcpy(&out[sizePos], &payloadSize, sizeof(payloadSize));
+}
+
+StatsDeltaReader::StatsDeltaReader(const std::string& path)
+    : mapping_(path.c_str()),
+      data_(mapping_.data()) {
+  auto data = data_;
+  uint32_t magic;
+  uint32_t payloadSize;
+  if (!readInt(data, magic) || magic != kStatsDeltaTableMagic ||
+      !readInt(data, payloadSize) || data.size() < payloadSize) {
+    data_.clear();
+    return;
+  }
+
+  auto payload = data.subpiece(0, payloadSize);
+  uint64_t numStats;
+  if (!readVarint(payload, numStats)) {
+    data_.clear();
+    return;
+  }
+  for (uint64_t i = 0; i < numStats; ++i) {
+    uint64_t len;
+    if (!readVarint(payload, len) || payload.size() < len) {
+      names_.clear();
+      data_.clear();
+      return;
+    }
+    names_.emplace_back(payload.data(), len);
+    payload.advance(len);
+  }
+
+  values_.assign(names_.size(), 0);
+  types_.assign(names_.size(), static_cast<uint8_t>(stat_uint64));
+  data_.advance(2 * sizeof(uint32_t) + payloadSize);
+}
+
+bool StatsDeltaReader::nextTick(uint64_t& timestampMs) {
+  auto data = data_;
+  uint32_t magic;
+  uint32_t payloadSize;
+  if (!readInt(data, magic) || magic != kStatsDeltaTickMagic ||
+      !readInt(data, payloadSize) || data.size() < payloadSize) {
+    return false;
+  }
+
+  auto payload = data.subpiece(0, payloadSize);
+  uint64_t ts;
+  uint64_t numEntries;
+  if (!readInt(payload, ts) || !readVarint(payload, numEntries)) {
+    return false;
+  }
+  for (uint64_t n = 0; n < numEntries; ++n) {
+    uint64_t index;
+    if (!readVarint(payload, index) || index >= values_.size() ||
+        payload.empty()) {
+      return false;
+    }
+    const auto type = static_cast<uint8_t>(payload.front());
+    payload.advance(1);
+    if (type == static_cast<uint8_t>(stat_double)) {
+      uint64_t bits;
+      if (!readInt(payload, bits)) {
+        return false;
+      }
+      values_[index] = bits;
+    } else {
+      uint64_t zigzag;
+      if (!readVarint(payload, zigzag)) {
+        return false;
+      }
+      values_[index] += static_cast<uint64_t>(folly::decodeZigZag(zigzag));
+    }
+    types_[index] = type;
+  }
+
+  data_.advance(2 * sizeof(uint32_t) + payloadSize);
+  timestampMs = ts;
+  return true;
+}
+
+}}}  // facebook::memcache::mcrouter
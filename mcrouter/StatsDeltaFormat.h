@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <folly/MemoryMapping.h>
+#include <folly/Range.h>
+
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Binary delta stats spool format (--stats-binary-delta-format).
+ *
+ * Instead of rewriting the full stats file as JSON every interval, the
+ * logger appends one small record per tick carrying only the counters
+ * that changed since the previous tick.  The spool is truncated on
+ * startup and read on the host that wrote it, so fixed-width integers
+ * are in host byte order.  Read it back with the mcstats tool.
+ *
+ * The file is a name table followed by tick records:
+ *
+ *   Name table:
+ *     uint32_t magic;        // kStatsDeltaTableMagic
+ *     uint32_t payloadSize;  // bytes following the header
+ *     varint numStats;
+ *     numStats * { varint len; char name[len]; }
+ *
+ *   Tick:
+ *     uint32_t magic;        // kStatsDeltaTickMagic
+ *     uint32_t payloadSize;
+ *     uint64_t timestampMs;  // wall clock, milliseconds since epoch
+ *     varint numEntries;
+ *     numEntries * {
+ *       varint index;        // into the name table
+ *       uint8_t type;        // stat_type_t
+ *       stat_uint64/stat_int64: zigzag varint of (value - previous value)
+ *       stat_double:          8 raw bytes, absolute value
+ *     }
+ *
+ * The first tick deltas against zero, so it doubles as a full snapshot
+ * and the reader reconstructs absolute values by accumulation.
+ */
+constexpr uint32_t kStatsDeltaTableMagic = 0x31544453;  // "SDT1"
+constexpr uint32_t kStatsDeltaTickMagic = 0x314B4453;   // "SDK1"
+
+/**
+ * Serializes stats ticks, remembering the previous tick's values so that
+ * only changed counters are emitted.  Stateful: feed every tick of one
+ * spool to the same writer, in order.
+ */
+class StatsDeltaWriter {
+ public:
+  /**
+   * @param spoolOutlierStats  whether stats in the outlier_stats group
+   *                           are included (mirrors the JSON stats file,
+   *                           which drops them when outlier detection is
+   *                           disabled)
+   */
+  explicit StatsDeltaWriter(bool spoolOutlierStats)
+      : StatsDeltaWriter(ods_stats, spoolOutlierStats) {}
+
+  /**
+   * @param groupMask  stat_group_t bits selecting the spooled stats; a
+   *                   numeric stat is included if it is in any of the
+   *                   groups (the spool defaults to ods_stats).
+   */
+  StatsDeltaWriter(int groupMask, bool spoolOutlierStats)
+      : groupMask_(groupMask), spoolOutlierStats_(spoolOutlierStats) {}
+
+  /**
+   * Appends one tick record to 'out'.  The first call selects the
+   * spooled stats (numeric stats in the ods_stats group) and prepends
+   * the name table.
+   */
+  void appendTick(const std::vector<stat_t>& stats,
+                  uint64_t timestampMs,
+                  std::string& out);
+
+ private:
+  const int groupMask_;
+  const bool spoolOutlierStats_;
+  std::vector<size_t> spooled_;  // indices into the stats array
+  std::vector<uint64_t> prev_;   // raw 8-byte values, parallel to spooled_
+
+  void appendNameTable(const std::vector<stat_t>& stats, std::string& out);
+};
+
+/**
+ * Replays a binary delta stats spool via mmap, accumulating deltas back
+ * into absolute per-stat values.
+ */
+class StatsDeltaReader {
+ public:
+  /**
+   * @throws std::runtime_error  if the file can't be opened or mapped
+   */
+  explicit StatsDeltaReader(const std::string& path);
+
+  /**
+   * Spooled stat names, in index order.  Empty if the file doesn't start
+   * with a valid name table.
+   */
+  const std::vector<std::string>& statNames() const {
+    return names_;
+  }
+
+  /**
+   * Applies the next tick on top of the running values.
+   *
+   * @return false on end of spool or on a corrupt record; a torn record
+   *         at the tail is expected after a crash and ends the stream.
+   */
+  bool nextTick(uint64_t& timestampMs);
+
+  /**
+   * Raw 8-byte value of each stat after the ticks applied so far;
+   * interpret via types().
+   */
+  const std::vector<uint64_t>& values() const {
+    return values_;
+  }
+
+  /**
+   * stat_type_t of each stat's most recent update (stat_uint64 until the
+   * stat is first seen).
+   */
+  const std::vector<uint8_t>& types() const {
+    return types_;
+  }
+
+ private:
+  folly::MemoryMapping mapping_;
+  folly::StringPiece data_;
+  std::vector<std::string> names_;
+  std::vector<uint64_t> values_;
+  std::vector<uint8_t> types_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,330 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "StatsExporter.h"
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <folly/String.h>
+#include <folly/ThreadName.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/McrouterInstance.h"
+#include "mcrouter/McrouterLogFailure.h"
+#include "mcrouter/stats.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+folly::StringPiece trim(folly::StringPiece sp) {
+  sp = folly::ltrimWhitespace(sp);
+  while (!sp.empty() && isspace(sp.back())) {
+    sp.pop_back();
+  }
+  return sp;
+}
+
+int groupFromName(folly::StringPiece name) {
+  static const std::pair<folly::StringPiece, int> kGroups[] = {
+    {"mcproxy_stats", mcproxy_stats},
+    {"detailed_stats", detailed_stats},
+    {"cmd_all_stats", cmd_all_stats},
+    {"cmd_in_stats", cmd_in_stats},
+    {"cmd_out_stats", cmd_out_stats},
+    {"cmd_error_stats", cmd_error_stats},
+    {"ods_stats", ods_stats},
+    {"rate_stats", rate_stats},
+    {"count_stats", count_stats},
+    {"outlier_stats", outlier_stats},
+    {"max_stats", max_stats},
+    {"all_stats", all_stats},
+    {"server_stats", server_stats},
+    {"memory_stats", memory_stats},
+    {"suspect_server_stats", suspect_server_stats},
+    {"route_handle_stats", route_handle_stats},
+    {"keyspace_stats", keyspace_stats},
+  };
+  for (const auto& group : kGroups) {
+    if (name == group.first) {
+      return group.second;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Parses the subscription line ("groups=<g1>,<g2>,...").  Unknown group
+ * names are ignored; an empty result falls back to ods_stats, so a bare
+ * newline subscribes to the same stats the JSON stats file carries.
+ */
+int parseSubscription(folly::StringPiece line) {
+  int mask = 0;
+  constexpr folly::StringPiece kGroupsPrefix{"groups="};
+  if (line.startsWith(kGroupsPrefix)) {
+    line.advance(kGroupsPrefix.size());
+    std::vector<folly::StringPiece> names;
+    folly::split(',', line, names, true /* ignoreEmpty */);
+    for (auto name : names) {
+      const auto group = groupFromName(trim(name));
+      if (group == 0) {
+        VLOG(1) << "Unknown stat group in stats export subscription: "
+                << name;
+      }
+      mask |= group;
+    }
+  } else if (!line.empty()) {
+    VLOG(1) << "Malformed stats export subscription: " << line;
+  }
+  return mask != 0 ? mask : ods_stats;
+}
+
+} // anonymous namespace
+
+StatsExporter::StatsExporter(McrouterInstance& router)
+    : router_(router),
+      pid_(getpid()) {
+}
+
+StatsExporter::~StatsExporter() {
+  stop();
+}
+
+bool StatsExporter::openListenSocket() {
+  socketPath_ = router_.opts().stats_export_socket_path;
+
+  sockaddr_un addr;
+  if (socketPath_.size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Stats export socket path too long: " << socketPath_;
+    return false;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    PLOG(ERROR) << "Error creating stats export socket";
+    return false;
+  }
+
+  // A previous run may have left the socket file behind.
+  ::unlink(socketPath_.c_str());
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, socketPath_.data(), socketPath_.size());
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      ::listen(fd, SOMAXCONN) < 0) {
+    PLOG(ERROR) << "Error binding stats export socket " << socketPath_;
+    ::close(fd);
+    return false;
+  }
+
+  listenSocket_ = folly::File(fd, true /* ownsFd */);
+  return true;
+}
+
+bool StatsExporter::start() {
+  if (running_ || router_.opts().stats_export_socket_path.empty()) {
+    return false;
+  }
+
+  if (!openListenSocket()) {
+    return false;
+  }
+
+  running_ = true;
+  const std::string threadName = "mcrtr-stats-export";
+  try {
+    thread_ = std::thread(std::bind(&StatsExporter::threadRun, this));
+    folly::setThreadName(thread_.native_handle(), threadName);
+  } catch (const std::system_error& e) {
+    running_ = false;
+    MC_LOG_FAILURE(router_.opts(), memcache::failure::Category::kSystemError,
+                   "Can not start StatsExporter thread {}: {}",
+                   threadName, e.what());
+  }
+
+  return running_;
+}
+
+void StatsExporter::stop() noexcept {
+  if (!running_) {
+    return;
+  }
+
+  running_ = false;
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    if (getpid() == pid_) {
+      thread_.join();
+    } else {
+      thread_.detach();
+    }
+  }
+  if (!socketPath_.empty()) {
+    ::unlink(socketPath_.c_str());
+  }
+}
+
+bool StatsExporter::running() const {
+  return running_;
+}
+
+void StatsExporter::threadRun() {
+  while (running_) {
+    acceptSubscribers();
+    readSubscriptions();
+    pushTick();
+    threadSleep();
+  }
+  subscribers_.clear();
+}
+
+void StatsExporter::threadSleep() {
+  std::unique_lock<std::mutex> lock(threadMutex_);
+  cv_.wait_for(
+    lock,
+    std::chrono::milliseconds(router_.opts().stats_export_interval_ms),
+    [this]() { return !running_; });
+}
+
+void StatsExporter::acceptSubscribers() {
+  while (true) {
+    int fd = ::accept4(listenSocket_.fd(), nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        PLOG(WARNING) << "Error accepting stats export subscriber";
+      }
+      return;
+    }
+    Subscriber subscriber;
+    subscriber.socket = folly::File(fd, true /* ownsFd */);
+    subscribers_.push_back(std::move(subscriber));
+    VLOG(1) << "Stats export subscriber connected";
+  }
+}
+
+void StatsExporter::readSubscriptions() {
+  for (size_t i = 0; i < subscribers_.size();) {
+    auto& subscriber = subscribers_[i];
+    if (subscriber.writer) {
+      ++i;
+      continue;
+    }
+
+    bool drop = false;
+    char buf[256];
+    while (subscriber.request.find('\n') == std::string::npos) {
+      const auto bytes = ::read(subscriber.socket.fd(), buf, sizeof(buf));
+      if (bytes > 0) {
+        subscriber.request.append(buf, bytes);
+        if (subscriber.request.size() > kMaxRequestBytes) {
+          drop = true;
+          break;
+        }
+      } else if (bytes == 0 ||
+                 (errno != EAGAIN && errno != EWOULDBLOCK &&
+                  errno != EINTR)) {
+        // Disconnected before subscribing.
+        drop = true;
+        break;
+      } else {
+        break;
+      }
+    }
+
+    if (drop) {
+      subscribers_.erase(subscribers_.begin() + i);
+      continue;
+    }
+
+    const auto eol = subscriber.request.find('\n');
+    if (eol != std::string::npos) {
+      folly::StringPiece line(subscriber.request.data(),
+                              subscriber.request.data() + eol);
+      subscriber.writer = folly::make_unique<StatsDeltaWriter>(
+          parseSubscription(trim(line)),
+          router_.opts().logging_rtt_outlier_threshold_us != 0);
+      subscriber.request.clear();
+    }
+    ++i;
+  }
+}
+
+void StatsExporter::pushTick() {
+  bool anySubscribed = false;
+  for (const auto& subscriber : subscribers_) {
+    if (subscriber.writer) {
+      anySubscribed = true;
+      break;
+    }
+  }
+  if (!anySubscribed) {
+    return;
+  }
+
+  std::vector<stat_t> stats(num_stats);
+  prepare_stats(router_, stats.data());
+  for (int i = 0; i < num_stats; ++i) {
+    if (stats[i].group & rate_stats) {
+      stats[i].type = stat_double;
+      stats[i].data.dbl = stats_aggregate_rate_value(router_, i);
+    } else if (stats[i].group & max_stats) {
+      stats[i].type = stat_uint64;
+      stats[i].data.uint64 = stats_aggregate_max_value(router_, i);
+    }
+  }
+
+  struct timeval timestamp;
+  CHECK(gettimeofday(&timestamp, nullptr) == 0);
+  const auto timestampMs =
+    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
+
+  for (size_t i = 0; i < subscribers_.size();) {
+    auto& subscriber = subscribers_[i];
+    if (!subscriber.writer) {
+      ++i;
+      continue;
+    }
+    subscriber.writer->appendTick(stats, timestampMs, subscriber.pending);
+    if (!flushPending(subscriber) ||
+        subscriber.pending.size() > kMaxPendingBytes) {
+      VLOG(1) << "Dropping stats export subscriber";
+      subscribers_.erase(subscribers_.begin() + i);
+      continue;
+    }
+    ++i;
+  }
+}
+
+bool StatsExporter::flushPending(Subscriber& subscriber) {
+  while (!subscriber.pending.empty()) {
+    const auto written = ::send(subscriber.socket.fd(),
+                                subscriber.pending.data(),
+                                subscriber.pending.size(),
+                                MSG_NOSIGNAL);
+    if (written > 0) {
+      subscriber.pending.erase(0, written);
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+      // Socket buffer is full; retry with the next tick.
+      return true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/File.h>
+
+#include "mcrouter/StatsDeltaFormat.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+class McrouterInstance;
+
+/**
+ * Pushes delta-encoded stat batches to subscribers over a unix domain
+ * socket (--stats-export-socket-path), so collectors get sub-interval
+ * resolution without mcrouter materializing the full stat set per
+ * scrape.
+ *
+ * A subscriber connects and sends a single line
+ *
+ *   groups=<group>,<group>,...\n
+ *
+ * naming the stat_group_t categories it wants (e.g. "ods_stats",
+ * "rate_stats"; an empty or malformed line subscribes to ods_stats).
+ * It then receives the binary stream of StatsDeltaFormat.h: a name
+ * table for the subscribed stats followed by one tick record per
+ * --stats-export-interval-ms carrying only the counters that changed.
+ *
+ * Subscribers that stop reading are disconnected once kMaxPendingBytes
+ * of unsent data accumulate; the stream is push-only and never blocks
+ * the exporter.
+ */
+class StatsExporter {
+ public:
+  explicit StatsExporter(McrouterInstance& router);
+
+  ~StatsExporter();
+
+  /**
+   * Starts the exporter thread.
+   *
+   * @return True if the thread was successfully started.
+   */
+  bool start();
+
+  /**
+   * Tells whether the exporter thread is running.
+   */
+  bool running() const;
+
+  /**
+   * Stops the exporter thread and joins it.
+   * Note: this is a blocking call.
+   */
+  void stop() noexcept;
+
+ private:
+  struct Subscriber {
+    folly::File socket;
+    // The subscription line; once it is complete, writer is created.
+    std::string request;
+    // Per-subscriber delta state; null until subscribed.
+    std::unique_ptr<StatsDeltaWriter> writer;
+    // Serialized bytes not yet accepted by the socket.
+    std::string pending;
+  };
+
+  // A subscriber buffering more than this many unsent bytes is
+  // considered dead and disconnected.
+  static constexpr size_t kMaxPendingBytes = 1024 * 1024;
+  // Cap on the subscription line.
+  static constexpr size_t kMaxRequestBytes = 1024;
+
+  McrouterInstance& router_;
+  folly::File listenSocket_;
+  std::string socketPath_;
+  std::vector<Subscriber> subscribers_;
+
+  pid_t pid_;
+  std::thread thread_;
+  std::mutex threadMutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> running_{false};
+
+  void threadRun();
+  void threadSleep();
+
+  bool openListenSocket();
+  void acceptSubscribers();
+  void readSubscriptions();
+
+  /**
+   * Serializes one tick for every subscribed client and writes as much
+   * as each socket accepts.
+   */
+  void pushTick();
+
+  /**
+   * Attempts to drain the subscriber's pending bytes.
+   *
+   * @return false if the connection is gone and the subscriber should
+   *         be dropped.
+   */
+  static bool flushPending(Subscriber& subscriber);
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -9,7 +9,15 @@
  */
 #include "ThreadUtil.h"
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
+
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
+#include <folly/String.h>
 #include <folly/ThreadName.h>
 
 #include "mcrouter/options.h"
@@ -24,4 +32,81 @@ void mcrouterSetThisThreadName(const McrouterOptions& opts,
   }
 }
 
+bool mcrouterGetThisThreadCpuTimes(ThreadCpuTimes& out) {
+#if defined(__linux__) && defined(RUSAGE_THREAD)
+  struct rusage ru;
+  if (getrusage(RUSAGE_THREAD, &ru) != 0) {
+    return false;
+  }
+  out.userSec = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0;
+  out.systemSec = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t mcrouterNumaNodeCount() {
+#ifdef __linux__
+  size_t count = 0;
+  struct stat st;
+  while (stat(folly::format("/sys/devices/system/node/node{}", count)
+                .str().c_str(), &st) == 0) {
+    ++count;
+  }
+  return count > 0 ? count : 1;
+#else
+  return 1;
+#endif
+}
+
+bool mcrouterBindThisThreadToNumaNode(size_t node) {
+#ifdef __linux__
+  std::string cpulist;
+  auto path =
+    folly::format("/sys/devices/system/node/node{}/cpulist", node).str();
+  if (!folly::readFile(path.c_str(), cpulist)) {
+    return false;
+  }
+
+  // cpulist is a comma separated list of cpu ids and ranges,
+  // e.g. "0-7,16-23".
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  size_t numCpus = 0;
+  std::vector<folly::StringPiece> pieces;
+  folly::split(',', cpulist, pieces);
+  try {
+    for (auto piece : pieces) {
+      piece = folly::trimWhitespace(piece);
+      if (piece.empty()) {
+        continue;
+      }
+      auto dash = piece.find('-');
+      size_t first, last;
+      if (dash == std::string::npos) {
+        first = last = folly::to<size_t>(piece);
+      } else {
+        first = folly::to<size_t>(piece.subpiece(0, dash));
+        last = folly::to<size_t>(piece.subpiece(dash + 1));
+      }
+      for (auto cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+        CPU_SET(cpu, &cpus);
+        ++numCpus;
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Failed to parse " << path << ": " << e.what();
+    return false;
+  }
+
+  if (numCpus == 0) {
+    return false;
+  }
+  return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+  return false;
+#endif
+}
+
 }}} // facebook::memcache::mcrouter
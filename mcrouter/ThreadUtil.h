@@ -20,4 +20,33 @@ namespace mcrouter {
 void mcrouterSetThisThreadName(const McrouterOptions& opts,
                                folly::StringPiece prefix);
 
+/**
+ * Cumulative CPU time consumed by a thread.
+ */
+struct ThreadCpuTimes {
+  double userSec{0.0};
+  double systemSec{0.0};
+};
+
+/**
+ * Reads the calling thread's cumulative CPU time.
+ *
+ * @return true if the times were read; false where per-thread CPU
+ *         accounting is unavailable (e.g. not on Linux).
+ */
+bool mcrouterGetThisThreadCpuTimes(ThreadCpuTimes& out);
+
+/**
+ * Number of NUMA nodes on this host, read from sysfs.
+ * Returns 1 if the topology can't be determined (e.g. not on Linux).
+ */
+size_t mcrouterNumaNodeCount();
+
+/**
+ * Restricts the calling thread to the CPUs of given NUMA node.
+ *
+ * @return true if the affinity was applied.
+ */
+bool mcrouterBindThisThreadToNumaNode(size_t node);
+
 }}} // facebook::memcache::mcrouter
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "TkoEventRing.h"
+
+#include <folly/Format.h>
+
+#include "mcrouter/lib/network/AccessPoint.h"
+#include "mcrouter/TscClock.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+const char* eventToString(TkoLogEvent event) {
+  switch (event) {
+    case TkoLogEvent::MarkHardTko:
+      return "mark_hard_tko";
+    case TkoLogEvent::MarkSoftTko:
+      return "mark_soft_tko";
+    case TkoLogEvent::RemoveFromConfig:
+      return "remove_from_config";
+    case TkoLogEvent::UnMarkTko:
+      return "unmark_tko";
+    default:
+      return "unknown";
+  }
+}
+
+} // anonymous namespace
+
+TkoEventRing::TkoEventRing() {
+  events_.reserve(kMaxEvents);
+  destinations_.push_back("<unknown>");
+}
+
+uint32_t TkoEventRing::internDestination(const TkoLog& tkoLog) {
+  auto name = folly::sformat(
+      "{}|{}", tkoLog.accessPoint.toHostPortString(), tkoLog.poolName);
+  auto it = destinationIds_.find(name);
+  if (it != destinationIds_.end()) {
+    return it->second;
+  }
+  if (destinations_.size() >= kMaxDestinations) {
+    return 0;
+  }
+  const auto id = static_cast<uint32_t>(destinations_.size());
+  destinations_.push_back(name);
+  destinationIds_.emplace(std::move(name), id);
+  return id;
+}
+
+void TkoEventRing::record(const TkoLog& tkoLog) {
+  TkoEventRecord event;
+  event.timeUs = TscClock::nowUs();
+  event.event = tkoLog.event;
+  event.result = tkoLog.result;
+  event.globalHardTkos =
+      static_cast<uint32_t>(tkoLog.globalTkos.hardTkos.load());
+  event.globalSoftTkos =
+      static_cast<uint32_t>(tkoLog.globalTkos.softTkos.load());
+  event.probesSent = static_cast<uint32_t>(tkoLog.probesSent);
+  event.avgLatencyUs = tkoLog.avgLatency;
+
+  folly::SpinLockGuard g(lock_);
+  event.destinationId = internDestination(tkoLog);
+  if (events_.size() < kMaxEvents) {
+    events_.push_back(event);
+  } else {
+    events_[nextIdx_] = event;
+  }
+  nextIdx_ = (nextIdx_ + 1) % kMaxEvents;
+  ++totalEvents_;
+}
+
+folly::dynamic TkoEventRing::toDynamic() const {
+  folly::dynamic result = folly::dynamic::array;
+  folly::SpinLockGuard g(lock_);
+  const size_t numEvents = events_.size();
+  // nextIdx_ points at the oldest event once the ring has wrapped.
+  const size_t start = numEvents < kMaxEvents ? 0 : nextIdx_;
+  for (size_t i = 0; i < numEvents; ++i) {
+    const auto& event = events_[(start + i) % numEvents];
+    result.push_back(folly::dynamic::object
+        ("time_us", event.timeUs)
+        ("destination", destinations_[event.destinationId])
+        ("event", eventToString(event.event))
+        ("result", mc_res_to_string(event.result))
+        ("global_hard_tkos", event.globalHardTkos)
+        ("global_soft_tkos", event.globalSoftTkos)
+        ("probes_sent", event.probesSent)
+        ("avg_latency_us", event.avgLatencyUs));
+  }
+  return result;
+}
+
+}}}  // facebook::memcache::mcrouter
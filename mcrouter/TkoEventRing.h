@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/dynamic.h>
+#include <folly/SpinLock.h>
+
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/TkoLog.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Compact binary record of a single TKO transition.
+ */
+struct TkoEventRecord {
+  /// TscClock::nowUs() at the time of the transition.
+  int64_t timeUs{0};
+  /// Index into the ring's destination intern table.
+  uint32_t destinationId{0};
+  TkoLogEvent event{TkoLogEvent::MarkHardTko};
+  mc_res_t result{mc_res_unknown};
+  uint32_t globalHardTkos{0};
+  uint32_t globalSoftTkos{0};
+  uint32_t probesSent{0};
+  double avgLatencyUs{0.0};
+};
+
+/**
+ * Fixed-size ring of the most recent TKO transitions seen by one proxy
+ * thread (oldest events are overwritten). Always on: recording an event
+ * is a few stores into preallocated memory, so it stays cheap during
+ * mass TKO events, when the formatted logging is at its most expensive.
+ * Destination host:port strings are interned once per destination and
+ * referenced by id, keeping the per-event record small and fixed-size.
+ *
+ * record() may only be called from the proxy thread that owns this
+ * ring; snapshots can be taken from any thread (see the tko_events
+ * ServiceInfo command, which merges the rings of all proxies into a
+ * single timeline).
+ */
+class TkoEventRing {
+ public:
+  TkoEventRing();
+
+  /**
+   * Records one TKO transition, overwriting the oldest event if the
+   * ring is full.
+   */
+  void record(const TkoLog& tkoLog);
+
+  /**
+   * Snapshot of the currently buffered events, oldest first.
+   */
+  folly::dynamic toDynamic() const;
+
+ private:
+  // Number of most recent events to keep per proxy.
+  static constexpr size_t kMaxEvents = 1024;
+  // Cap on interned destinations; events past it fall back to id 0
+  // ("<unknown>"). Generously above any practical destination count.
+  static constexpr size_t kMaxDestinations = 64 * 1024;
+
+  // Guards all state against concurrent snapshots. Uncontended on the
+  // recording path unless a snapshot is being taken.
+  mutable folly::SpinLock lock_;
+  std::vector<TkoEventRecord> events_;
+  size_t nextIdx_{0};
+  // Total events ever recorded, so exports can tell how much history
+  // was overwritten.
+  uint64_t totalEvents_{0};
+
+  // Intern table: id -> "host:port|pool". Ids are never reused.
+  std::vector<std::string> destinations_;
+  std::unordered_map<std::string, uint32_t> destinationIds_;
+
+  uint32_t internDestination(const TkoLog& tkoLog);
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -14,12 +14,51 @@
 #include <glog/logging.h>
 
 #include <folly/MapUtil.h>
+#include <folly/Memory.h>
 
 #include "mcrouter/ProxyDestination.h"
 #include "mcrouter/TkoCounters.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+
+/* Maps a destination hostname to its failure domain key.
+   "host" uses the hostname as is; "rack" and "cluster" strip one or two
+   leading labels, relying on topology-encoding hostnames
+   (e.g. "web123.rack04.clusterA.example.com"). Numeric addresses carry
+   no topology, so each gets a domain of its own. Returns an empty string
+   for an unknown policy. */
+std::string failureDomainKey(folly::StringPiece host,
+                             folly::StringPiece policy) {
+  size_t strip = 0;
+  if (policy == "rack") {
+    strip = 1;
+  } else if (policy == "cluster") {
+    strip = 2;
+  } else if (policy != "host") {
+    return std::string();
+  }
+
+  /* IPv6 has ':', IPv4 only digits and dots */
+  if (host.find(':') != folly::StringPiece::npos ||
+      host.find_first_not_of("0123456789.") == folly::StringPiece::npos) {
+    return host.str();
+  }
+
+  for (size_t i = 0; i < strip; ++i) {
+    auto dot = host.find('.');
+    if (dot == folly::StringPiece::npos) {
+      /* too few labels, keep what's left */
+      break;
+    }
+    host.advance(dot + 1);
+  }
+  return host.str();
+}
+
+} // anonymous
+
 TkoTracker::TkoTracker(size_t tkoThreshold,
                        size_t maxSoftTkos,
                        TkoTrackerMap& trackerMap)
@@ -28,16 +67,39 @@ TkoTracker::TkoTracker(size_t tkoThreshold,
     trackerMap_(trackerMap) {
 }
 
+constexpr size_t TkoTracker::kFailureCountStripes;
+
 bool TkoTracker::isHardTko() const {
-  uintptr_t curSumFailures = sumFailures_;
+  uintptr_t curSumFailures = sumFailures_.load(std::memory_order_relaxed);
   return (curSumFailures > tkoThreshold_ && curSumFailures % 2 == 1);
 }
 
 bool TkoTracker::isSoftTko() const {
-  uintptr_t curSumFailures = sumFailures_;
+  uintptr_t curSumFailures = sumFailures_.load(std::memory_order_relaxed);
   return (curSumFailures > tkoThreshold_ && curSumFailures % 2 == 0);
 }
 
+void TkoTracker::incrementFailureCount() {
+  auto stripe =
+      folly::detail::AccessSpreader<>::current(kFailureCountStripes);
+  consecutiveFailureCounts_[stripe].count.fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+void TkoTracker::resetFailureCount() {
+  for (auto& stripe : consecutiveFailureCounts_) {
+    stripe.count.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t TkoTracker::consecutiveFailureCount() const {
+  size_t count = 0;
+  for (const auto& stripe : consecutiveFailureCounts_) {
+    count += stripe.count.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
 const TkoCounters& TkoTracker::globalTkos() const {
   return trackerMap_.globalTkos_;
 }
@@ -74,7 +136,7 @@ bool TkoTracker::setSumFailures(uintptr_t value) {
 }
 
 bool TkoTracker::recordSoftFailure(ProxyDestination* pdstn) {
-  ++consecutiveFailureCount_;
+  incrementFailureCount();
 
   /* We increment soft tko count first before actually taking responsibility
      for the TKO. This means we run the risk that multiple proxies
@@ -114,11 +176,14 @@ bool TkoTracker::recordSoftFailure(ProxyDestination* pdstn) {
       }
     }
   } while (!sumFailures_.compare_exchange_weak(curSumFailures, value));
+  if (value == pdstnAddr && failureDomain_ != nullptr) {
+    failureDomain_->memberMarkedTko();
+  }
   return value == pdstnAddr;
 }
 
 bool TkoTracker::recordHardFailure(ProxyDestination* pdstn) {
-  ++consecutiveFailureCount_;
+  incrementFailureCount();
 
   if (isHardTko()) {
     return false;
@@ -139,6 +204,9 @@ bool TkoTracker::recordHardFailure(ProxyDestination* pdstn) {
   bool success = setSumFailures(reinterpret_cast<uintptr_t>(pdstn) | 1);
   if (success) {
     ++trackerMap_.globalTkos_.hardTkos;
+    if (failureDomain_ != nullptr) {
+      failureDomain_->memberMarkedTko();
+    }
   }
   return success;
 }
@@ -158,8 +226,11 @@ bool TkoTracker::recordSuccess(ProxyDestination* pdstn) {
     if (isHardTko()) {
       --trackerMap_.globalTkos_.hardTkos;
     }
+    if (failureDomain_ != nullptr) {
+      failureDomain_->memberUnmarkedTko();
+    }
     sumFailures_ = 0;
-    consecutiveFailureCount_ = 0;
+    resetFailureCount();
     return true;
   }
   /* Skip resetting failures if the counter is at zero.
@@ -169,8 +240,9 @@ bool TkoTracker::recordSuccess(ProxyDestination* pdstn) {
 
      If we don't skip here we end up doing CAS on a shared state
      every single request. */
-  if (sumFailures_ != 0 && setSumFailures(0)) {
-    consecutiveFailureCount_ = 0;
+  if (sumFailures_.load(std::memory_order_relaxed) != 0 &&
+      setSumFailures(0)) {
+    resetFailureCount();
   }
   return false;
 }
@@ -184,13 +256,20 @@ bool TkoTracker::removeDestination(ProxyDestination* pdstn) {
 }
 
 TkoTracker::~TkoTracker() {
+  /* Normally unmarked via removeDestination() by the responsible
+     destination; be safe in case we're destroyed while still TKO. */
+  if (failureDomain_ != nullptr && isTko()) {
+    failureDomain_->memberUnmarkedTko();
+  }
   trackerMap_.removeTracker(key_);
 }
 
 void TkoTrackerMap::updateTracker(
   ProxyDestination& pdstn,
   const size_t tkoThreshold,
-  const size_t maxSoftTkos) {
+  const size_t maxSoftTkos,
+  folly::StringPiece failureDomainPolicy,
+  const size_t failureDomainTkoThreshold) {
   auto key = pdstn.accessPoint()->toHostPortString();
   {
     std::lock_guard<std::mutex> lock(mx_);
@@ -198,6 +277,24 @@ void TkoTrackerMap::updateTracker(
     std::shared_ptr<TkoTracker> tracker;
     if (it == trackers_.end() || (tracker = it->second.lock()) == nullptr) {
       tracker.reset(new TkoTracker(tkoThreshold, maxSoftTkos, *this));
+      if (!failureDomainPolicy.empty() && failureDomainTkoThreshold > 0) {
+        auto domainKey = failureDomainKey(pdstn.accessPoint()->getHost(),
+                                          failureDomainPolicy);
+        if (domainKey.empty()) {
+          LOG(ERROR) << "Unknown failure_domain_policy '"
+                     << failureDomainPolicy
+                     << "', destination will not be grouped";
+        } else {
+          auto domainIt = failureDomains_.find(domainKey);
+          if (domainIt == failureDomains_.end()) {
+            domainIt = failureDomains_.emplace(
+                domainKey,
+                folly::make_unique<FailureDomain>(
+                    failureDomainTkoThreshold)).first;
+          }
+          tracker->failureDomain_ = domainIt->second.get();
+        }
+      }
       auto trackerIt = trackers_.emplace(key, tracker);
       if (!trackerIt.second) {
         trackerIt.first->second = tracker;
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -16,6 +17,7 @@
 #include <unordered_map>
 #include <utility>
 
+#include <folly/detail/CacheLocality.h>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Range.h>
 
@@ -26,6 +28,42 @@ namespace facebook { namespace memcache { namespace mcrouter {
 class ProxyDestination;
 class TkoTrackerMap;
 
+/**
+ * Aggregated health of a group of destinations sharing a failure domain
+ * (e.g. all boxes in one rack). Once enough member destinations are marked
+ * TKO the whole domain is considered down, so routing can skip its
+ * remaining members right away instead of discovering each destination's
+ * failure serially. Owned by TkoTrackerMap; member trackers update the
+ * TKO count on their own state transitions.
+ */
+class FailureDomain {
+ public:
+  explicit FailureDomain(size_t tkoThreshold)
+      : tkoThreshold_(tkoThreshold) {
+  }
+
+  /**
+   * @return Is this whole domain considered down?
+   */
+  bool isTko() const {
+    return tkoCount_.load(std::memory_order_relaxed) >= tkoThreshold_;
+  }
+
+ private:
+  const size_t tkoThreshold_;
+  // Number of member destinations currently marked TKO.
+  std::atomic<size_t> tkoCount_{0};
+
+  void memberMarkedTko() {
+    tkoCount_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void memberUnmarkedTko() {
+    tkoCount_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  friend class TkoTracker;
+};
+
 /**
  * We record the number of consecutive failures for each destination.
  * Once it goes over a certain threshold, we mark the destination as TKO
@@ -65,7 +103,16 @@ class TkoTracker {
    * @return Is the destination currently marked TKO?
    */
   bool isTko() const {
-    return sumFailures_ > tkoThreshold_;
+    return sumFailures_.load(std::memory_order_relaxed) > tkoThreshold_;
+  }
+
+  /**
+   * @return Is the failure domain of this destination (if any) considered
+   *         down? Unlike isTko(), this may be true for a destination that
+   *         hasn't failed itself yet.
+   */
+  bool isDomainTko() const {
+    return failureDomain_ != nullptr && failureDomain_->isTko();
   }
 
   /**
@@ -73,9 +120,7 @@ class TkoTracker {
    *         This is basically a number of recordHardFailure/recordSoftFailure
    *         calls after last recordSuccess.
    */
-  size_t consecutiveFailureCount() const {
-    return consecutiveFailureCount_;
-  }
+  size_t consecutiveFailureCount() const;
 
   /**
    * @return number of TKO destinations for current router
@@ -140,6 +185,10 @@ class TkoTracker {
   const size_t maxSoftTkos_;
   TkoTrackerMap& trackerMap_;
 
+  // Failure domain this destination belongs to, if any.
+  // Owned by TkoTrackerMap, assigned under its lock at creation time.
+  FailureDomain* failureDomain_{nullptr};
+
   /* sumFailures_ is used for a few things depending on the state of the
      destination. For a destination that is not TKO, it tracks the number of
      consecutive soft failures to a destination.
@@ -152,7 +201,22 @@ class TkoTracker {
        address of any of the proxy threads for this destination. */
   std::atomic<uintptr_t> sumFailures_{0};
 
-  std::atomic<size_t> consecutiveFailureCount_{0};
+  /* The failure counter is striped by cpu so that all proxy threads
+     recording failures against a browned-out destination don't contend on
+     one cache line. Stripes are summed on read, which only happens on the
+     admin/debug path. Precise counts don't matter here (see above), so
+     reset is a plain store of zeroes. */
+  static constexpr size_t kFailureCountStripes = 8;
+  struct FailureCountStripe {
+    std::atomic<size_t> FOLLY_ALIGN_TO_AVOID_FALSE_SHARING count{0};
+  };
+  std::array<FailureCountStripe, kFailureCountStripes>
+      consecutiveFailureCounts_;
+
+  /* Record one failure on this thread's stripe. */
+  void incrementFailureCount();
+  /* Reset all stripes; called when coming out of TKO. */
+  void resetFailureCount();
 
   /* Decrement the global counter of current soft TKOs. */
   void decrementSoftTkoCount();
@@ -193,10 +257,16 @@ class TkoTrackerMap {
 
   /**
    * Creates/updates TkoTracker for `pdstn` and updates `pdstn->tko` pointer.
+   *
+   * If `failureDomainPolicy` is non-empty and `failureDomainTkoThreshold`
+   * is positive, the tracker is also assigned to a failure domain derived
+   * from the destination's hostname (see failure_domain_policy option).
    */
   void updateTracker(ProxyDestination& pdstn,
                      const size_t tkoThreshold,
-                     const size_t maxSoftTkos);
+                     const size_t maxSoftTkos,
+                     folly::StringPiece failureDomainPolicy = "",
+                     const size_t failureDomainTkoThreshold = 0);
 
   /**
    * @return  number of servers that recently returned error replies.
@@ -220,6 +290,10 @@ class TkoTrackerMap {
  private:
   std::mutex mx_;
   folly::StringKeyedUnorderedMap<std::weak_ptr<TkoTracker>> trackers_;
+  // Failure domains live as long as this map: trackers hold raw pointers
+  // into it and domains are few (one per rack/cluster at most).
+  folly::StringKeyedUnorderedMap<std::unique_ptr<FailureDomain>>
+      failureDomains_;
 
   // Total number of boxes marked as TKO.
   TkoCounters globalTkos_;
@@ -58,11 +58,7 @@ class TokenBucket {
    * @return True if the rate limit check passed, false otherwise.
    */
   bool consume(double toConsume, double nowInSeconds) {
-    if (nowInSeconds > lastUpdateTime_) {
-      const auto add = (nowInSeconds - lastUpdateTime_) * rate_;
-      lastUpdateTime_ = nowInSeconds;
-      tokens_ = std::min(burstSize_, tokens_ + add);
-    }
+    refill(nowInSeconds);
     if (tokens_ >= toConsume) {
       tokens_ -= toConsume;
       return true;
@@ -70,6 +66,24 @@ class TokenBucket {
     return false;
   }
 
+  /**
+   * Similar to consume, but always consumes some number of tokens.  If the
+   * bucket contains enough tokens, consumes toConsume tokens.  Otherwise the
+   * bucket is drained.
+   *
+   * @param toConsume The number of tokens to consume.
+   * @param nowInSeconds Current time in seconds. Should be monotonically
+   *                     increasing from the nowInSeconds specified in
+   *                     this token bucket's constructor.
+   * @return number of tokens that were consumed.
+   */
+  double consumeOrDrain(double toConsume, double nowInSeconds) {
+    refill(nowInSeconds);
+    const auto consumed = std::min(toConsume, tokens_);
+    tokens_ -= consumed;
+    return consumed;
+  }
+
   /**
    * Returns the number of tokens currently available.
    */
@@ -90,6 +104,14 @@ class TokenBucket {
   }
 
  private:
+  void refill(double nowInSeconds) {
+    if (nowInSeconds > lastUpdateTime_) {
+      const auto add = (nowInSeconds - lastUpdateTime_) * rate_;
+      lastUpdateTime_ = nowInSeconds;
+      tokens_ = std::min(burstSize_, tokens_ + add);
+    }
+  }
+
   double lastUpdateTime_;
   double tokens_;
   double rate_;
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "TscClock.h"
+
+#include <chrono>
+
+#include "mcrouter/lib/cycles/Clocks.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+namespace {
+
+// Minimum baseline over which the TSC frequency is estimated. Until this
+// much time has passed since the first calibration, nowUs() keeps using
+// the steady clock.
+constexpr int64_t kMinCalibrationWindowUs = 10000;
+
+struct Calibration {
+  // First calibration point; the frequency estimate uses the whole
+  // interval since then, so it keeps getting more accurate.
+  int64_t firstUs{0};
+  uint64_t firstTicks{0};
+
+  // Most recent calibration point, used as the conversion anchor.
+  int64_t anchorUs{0};
+  uint64_t anchorTicks{0};
+
+  // Microseconds per TSC tick; 0 while the fast path is disabled.
+  double usPerTick{0.0};
+
+  // Guards against the reading going backwards (e.g. after the thread
+  // migrates to a core with a slightly offset TSC).
+  int64_t lastUs{0};
+};
+thread_local Calibration calibration;
+
+int64_t steadyNowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // anonymous namespace
+
+void TscClock::calibrate() {
+  const auto us = steadyNowUs();
+  const auto ticks = cycles::getCpuCycles();
+  auto& cal = calibration;
+
+  if (cal.firstTicks == 0) {
+    cal.firstUs = us;
+    cal.firstTicks = ticks;
+  } else if (us - cal.firstUs >= kMinCalibrationWindowUs &&
+             ticks > cal.firstTicks) {
+    cal.usPerTick =
+        static_cast<double>(us - cal.firstUs) / (ticks - cal.firstTicks);
+  }
+
+  cal.anchorUs = us;
+  cal.anchorTicks = ticks;
+}
+
+int64_t TscClock::nowUs() {
+  const auto& cal = calibration;
+  if (cal.usPerTick == 0.0) {
+    return steadyNowUs();
+  }
+
+  auto us = cal.anchorUs + static_cast<int64_t>(
+      (cycles::getCpuCycles() - cal.anchorTicks) * cal.usPerTick);
+  if (us < calibration.lastUs) {
+    return calibration.lastUs;
+  }
+  calibration.lastUs = us;
+  return us;
+}
+
+}}}  // facebook::memcache::mcrouter
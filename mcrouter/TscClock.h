@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+#include <folly/io/async/EventBase.h>
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Coarse monotonic clock built on the CPU timestamp counter.
+ *
+ * Threads that call calibrate() periodically read time as a single rdtsc
+ * plus arithmetic, with no system call; the reading is re-anchored to the
+ * steady clock on every calibration, so its error is bounded by the drift
+ * accumulated over one calibration interval. Threads that never calibrate
+ * transparently fall back to the steady clock.
+ */
+class TscClock {
+ public:
+  /**
+   * (Re)calibrates the calling thread's clock against the steady clock
+   * and enables the TSC fast path for it. Cheap; intended to run once
+   * per event loop iteration (see TscClockCalibrator).
+   */
+  static void calibrate();
+
+  /**
+   * Current monotonic time in microseconds.
+   */
+  static int64_t nowUs();
+};
+
+/**
+ * Keeps the TscClock of an EventBase thread calibrated by re-running
+ * calibrate() before every event loop iteration.
+ */
+class TscClockCalibrator : public folly::EventBase::LoopCallback {
+ public:
+  /**
+   * Must be called from the event base thread.
+   */
+  void attach(folly::EventBase& evb) {
+    evb_ = &evb;
+    TscClock::calibrate();
+    evb.runBeforeLoop(this);
+  }
+
+  void runLoopCallback() noexcept override final {
+    TscClock::calibrate();
+    evb_->runBeforeLoop(this);
+  }
+
+ private:
+  folly::EventBase* evb_{nullptr};
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -21,15 +21,19 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <vector>
+
 #include <folly/Conv.h>
-#include <folly/fibers/EventBaseLoopController.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/Hash.h>
 #include <folly/json.h>
 #include <folly/ThreadName.h>
 
+#include "mcrouter/AsynclogBinaryFormat.h"
 #include "mcrouter/awriter.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/mcrouter_config.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/proxy.h"
@@ -40,22 +44,43 @@
 
 using folly::dynamic;
 
+namespace {
+
+/* Bounds for batching asynclog writes: buffered entries are written out
+   with a single writev() once the batch reaches this many bytes or this
+   much time has passed, whichever comes first. */
+constexpr size_t kAsynclogMaxBatchBytes = 64 * 1024;
+constexpr uint32_t kAsynclogBatchWindowMs = 10;
+
+/* Ring capacity for writers created without a queue size limit. Writes
+   block (instead of failing) on the rare occasion the writer thread falls
+   this far behind. */
+constexpr size_t kUnlimitedWriterRingSize = 4096;
+
+} // anonymous namespace
+
 namespace facebook { namespace memcache { namespace mcrouter {
 
 AsyncWriter::AsyncWriter(size_t maxQueueSize)
     : maxQueueSize_(maxQueueSize),
       pid_(getpid()),
-      fiberManager_(
-          folly::make_unique<folly::fibers::EventBaseLoopController>()),
       eventBase_(/* enableTimeMeasurement */ false) {
-  auto& c = fiberManager_.loopController();
-  dynamic_cast<folly::fibers::EventBaseLoopController&>(c)
-      .attachEventBase(eventBase_);
+  queue_ = folly::make_unique<MessageQueue<WriterTask>>(
+    maxQueueSize_ != 0 ? maxQueueSize_ : kUnlimitedWriterRingSize,
+    [this] (WriterTask&& task) {
+      task.func();
+      if (maxQueueSize_ != 0) {
+        --queueSize_;
+      }
+    },
+    /* noNotifyRate */ 0,
+    /* waitThreshold */ 0,
+    &nowUs,
+    /* notifyCallback */ nullptr);
 }
 
 AsyncWriter::~AsyncWriter() {
   stop();
-  assert(!fiberManager_.hasTasks());
 }
 
 void AsyncWriter::stop() noexcept {
@@ -76,9 +101,8 @@ void AsyncWriter::stop() noexcept {
       thread_.detach();
     }
   } else {
-    while (fiberManager_.hasTasks()) {
-      fiberManager_.loopUntilNoReady();
-    }
+    // the writer thread was never started, run the pending tasks inline
+    queue_->drain();
   }
 }
 
@@ -90,12 +114,13 @@ bool AsyncWriter::start(folly::StringPiece threadName) {
 
   try {
     thread_ = std::thread([this]() {
+      queue_->attachEventBase(eventBase_);
+
       // will return after terminateLoopSoon is called
       eventBase_.loopForever();
 
-      while (fiberManager_.hasTasks()) {
-        fiberManager_.loopUntilNoReady();
-      }
+      // run whatever was enqueued but not yet drained
+      queue_->drain();
     });
     folly::setThreadName(thread_.native_handle(), threadName);
   } catch (const std::system_error& e) {
@@ -123,12 +148,10 @@ bool AsyncWriter::run(std::function<void()> f) {
     } while (!queueSize_.compare_exchange_weak(size, size + 1));
   }
 
-  fiberManager_.addTaskRemote([this, f_ = std::move(f)]() {
-      fiberManager_.runInMainContext(std::move(f_));
-      if (maxQueueSize_ != 0) {
-        --queueSize_;
-      }
-  });
+  // When bounded, the admission counter above caps the ring occupancy at
+  // its capacity, so this never blocks. Unlimited writers may block here
+  // until the writer thread catches up.
+  queue_->blockingWrite(WriterTask(std::move(f)));
   return true;
 }
 
@@ -150,8 +173,9 @@ static std::shared_ptr<folly::File> countedfd_new(int fd) {
   return std::make_shared<folly::File>(fd, true);
 }
 
-/** Opens the asynchronous request store.  */
-static std::shared_ptr<folly::File> asynclog_open(proxy_t *proxy) {
+/** Opens a new spool file under the given spool root. */
+static std::shared_ptr<folly::File> asynclog_open_root(
+    proxy_t* proxy, const std::string& root) {
   char path[PATH_MAX + 1];
   time_t now = time(nullptr);
   pid_t tid = syscall(SYS_gettid);
@@ -159,21 +183,13 @@ static std::shared_ptr<folly::File> asynclog_open(proxy_t *proxy) {
   struct stat st;
   int success = 0;
   int fd = -1;
-
-  if (proxy->async_fd &&
-      now - proxy->async_spool_time <= DEFAULT_ASYNCLOG_LIFETIME) {
-    return proxy->async_fd;
-  }
-
-  if (proxy->async_fd) {
-    proxy->async_fd = nullptr;
-  }
+  std::shared_ptr<folly::File> result;
 
   localtime_r(&now, &date);
   char hour_path[PATH_MAX+1];
   time_t hour_time = now - (now % 3600);
   if (snprintf(hour_path, PATH_MAX, "%s/%04d%02d%02dT%02d-%lld",
-               proxy->router().opts().async_spool.c_str(),
+               root.c_str(),
                date.tm_year + 1900,
                date.tm_mon + 1,
                date.tm_mday,
@@ -249,17 +265,15 @@ static std::shared_ptr<folly::File> asynclog_open(proxy_t *proxy) {
     goto epilogue;
   }
 
-  proxy->async_fd = countedfd_new(fd);
-  if (!proxy->async_fd) {
+  result = countedfd_new(fd);
+  if (!result) {
     LOG(ERROR) << "Unable to allocate memory for async_fd: " << strerror(errno);
     goto epilogue;
   }
 
-  /* Ownership of the descriptor has been passed to prox->async_fd. */
+  /* Ownership of the descriptor has been passed to result. */
   fd = -1;
 
-  proxy->async_spool_time = now;
-
   success = 1;
 
   VLOG(1) << "Opened async store for " << path;
@@ -269,24 +283,111 @@ epilogue:
     if (fd != -1) {
       close(fd);
     }
-    if (proxy->async_fd) {
-      proxy->async_fd = nullptr;
+    result = nullptr;
+  }
+  return result;
+}
+
+/**
+ * Opens the asynchronous request store for the given lane, falling back
+ * to the failover spool root (--async-dir-failover) when the primary one
+ * is unusable. The lane's spool file path includes the tid of the lane's
+ * awriter thread, so lanes of one proxy never collide on a file name.
+ */
+static std::shared_ptr<folly::File> asynclog_open(proxy_t* proxy,
+                                                  size_t lane) {
+  auto& state = proxy->asynclogLanes[lane];
+  time_t now = time(nullptr);
+
+  if (state.spoolFd &&
+      now - state.spoolTime <= DEFAULT_ASYNCLOG_LIFETIME) {
+    return state.spoolFd;
+  }
+
+  const auto& opts = proxy->router().opts();
+  state.spoolFd = asynclog_open_root(proxy, opts.async_spool);
+  if (!state.spoolFd && !opts.async_spool_failover.empty()) {
+    state.spoolFd = asynclog_open_root(proxy, opts.async_spool_failover);
+    if (state.spoolFd) {
+      stat_incr(proxy->stats, asynclog_failover_spool_opens_stat, 1);
     }
   }
-  return proxy->async_fd;
+  if (state.spoolFd) {
+    state.spoolTime = now;
+  }
+  return state.spoolFd;
+}
+
+/** Buffers one spool record to be written with the lane's next batch. */
+static void asynclog_append(proxy_t* proxy, size_t lane,
+                            std::string record) {
+  auto& state = proxy->asynclogLanes[lane];
+  state.batchBytes += record.size();
+  state.batch.push_back(std::move(record));
+
+  if (state.batchBytes >= kAsynclogMaxBatchBytes) {
+    asynclog_flush(proxy, lane);
+  } else if (!state.flushPending) {
+    /* One timeout per batch window; entries that arrive before it fires
+       simply join the pending batch. */
+    state.flushPending = true;
+    proxy->router().asynclogWriter(lane).eventBase().runAfterDelay(
+      [proxy, lane]() {
+        proxy->asynclogLanes[lane].flushPending = false;
+        asynclog_flush(proxy, lane);
+      },
+      kAsynclogBatchWindowMs);
+  }
+}
+
+size_t asynclog_lane(proxy_t* proxy, folly::StringPiece poolName) {
+  auto lanes = proxy->asynclogLanes.size();
+  if (lanes == 1) {
+    return 0;
+  }
+  return folly::hash::fnv64_buf(poolName.data(), poolName.size()) % lanes;
 }
 
 /** Adds an asynchronous request to the event log. */
 void asynclog_delete(proxy_t* proxy,
+                     size_t lane,
                      const AccessPoint& ap,
                      folly::StringPiece key,
                      folly::StringPiece poolName) {
+  asynclog_append(proxy, lane,
+                  asynclog_delete_record(proxy, ap, key, poolName));
+}
+
+std::string asynclog_delete_record(proxy_t* proxy,
+                                   const AccessPoint& ap,
+                                   folly::StringPiece key,
+                                   folly::StringPiece poolName) {
   dynamic json = dynamic::array;
   const auto& host = ap.getHost();
   const auto& port = proxy->router().opts().asynclog_port_override == 0
     ? ap.getPort()
     : proxy->router().opts().asynclog_port_override;
 
+  struct timeval timestamp;
+  CHECK(gettimeofday(&timestamp, nullptr) == 0);
+
+  auto timestamp_ms =
+    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
+
+  if (proxy->router().opts().use_asynclog_binary_format) {
+    AsynclogBinaryEntry entry;
+    entry.timestampMs = timestamp_ms;
+    entry.port = port;
+    entry.flavor = proxy->router().opts().flavor_name;
+    entry.host = host;
+    entry.pool = poolName;
+    entry.key = key;
+
+    std::string record;
+    asynclogSerializeBinaryEntry(entry, record);
+    return record;
+  }
+
   if (proxy->router().opts().use_asynclog_version2) {
     json = dynamic::object;
     json["f"] = proxy->router().opts().flavor_name;
@@ -300,15 +401,6 @@ void asynclog_delete(proxy_t* proxy,
     json.push_back(folly::sformat("delete {}\r\n", key));
   }
 
-  auto fd = asynclog_open(proxy);
-  if (!fd) {
-    MC_LOG_FAILURE(proxy->router().opts(),
-                   memcache::failure::Category::kSystemError,
-                   "asynclog_open() failed (key {}, pool {})",
-                   key, poolName);
-    return;
-  }
-
   // ["AS1.0", 1289416829.836, "C", ["10.0.0.1", 11302, "delete foo\r\n"]]
   // OR ["AS2.0", 1289416829.836, "C", {"f":"flavor","h":"[10.0.0.1]:11302",
   //                                    "p":"pool_name","k":"foo\r\n"}]
@@ -319,25 +411,77 @@ void asynclog_delete(proxy_t* proxy,
     jsonOut.push_back(ASYNCLOG_MAGIC);
   }
 
-  struct timeval timestamp;
-  CHECK(gettimeofday(&timestamp, nullptr) == 0);
-
-  auto timestamp_ms =
-    facebook::memcache::to<std::chrono::milliseconds>(timestamp).count();
-
   jsonOut.push_back(1e-3 * timestamp_ms);
   jsonOut.push_back(std::string("C"));
 
   jsonOut.push_back(json);
 
-  auto jstr = folly::toJson(jsonOut) + "\n";
+  return folly::toJson(jsonOut) + "\n";
+}
+
+bool asynclog_ring_append(proxy_t* proxy, size_t lane, std::string record) {
+  auto& state = proxy->asynclogLanes[lane];
+  auto* ring = state.ring.get();
+  if (ring == nullptr) {
+    return false;
+  }
+  if (!ring->write(std::move(record))) {
+    stat_incr(proxy->stats, asynclog_spool_ring_full_stat, 1);
+    return false;
+  }
+  stat_incr(proxy->stats, asynclog_ring_spooled_stat, 1);
+
+  /* One drain job per lane at a time: clear the flag before draining, so
+     a record pushed while the drain is running schedules the next one. */
+  if (!state.drainPending.exchange(true)) {
+    auto res = proxy->router().asynclogWriter(lane).run([proxy, lane]() {
+      auto& st = proxy->asynclogLanes[lane];
+      st.drainPending = false;
+      std::string rec;
+      while (st.ring->read(rec)) {
+        asynclog_append(proxy, lane, std::move(rec));
+      }
+    });
+    if (!res) {
+      /* Leave the records in the ring; the next append will reschedule */
+      state.drainPending = false;
+    }
+  }
+  return true;
+}
+
+/** Writes out the lane's buffered asynclog entries with one writev(). */
+void asynclog_flush(proxy_t* proxy, size_t lane) {
+  auto& state = proxy->asynclogLanes[lane];
+  if (state.batch.empty()) {
+    return;
+  }
+  auto entries = std::move(state.batch);
+  state.batch.clear();
+  auto numBytes = state.batchBytes;
+  state.batchBytes = 0;
+
+  auto fd = asynclog_open(proxy, lane);
+  if (!fd) {
+    MC_LOG_FAILURE(proxy->router().opts(),
+                   memcache::failure::Category::kSystemError,
+                   "asynclog_open() failed ({} entries dropped)",
+                   entries.size());
+    return;
+  }
+
+  std::vector<struct iovec> iov(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    iov[i].iov_base = const_cast<char*>(entries[i].data());
+    iov[i].iov_len = entries[i].size();
+  }
 
-  ssize_t size = folly::writeFull(fd->fd(), jstr.data(), jstr.size());
-  if (size == -1 || size_t(size) < jstr.size()) {
+  ssize_t size = folly::writevFull(fd->fd(), iov.data(), iov.size());
+  if (size == -1 || size_t(size) < numBytes) {
     MC_LOG_FAILURE(proxy->router().opts(),
                    memcache::failure::Category::kSystemError,
-                   "Error fully writing asynclog request (key {}, pool {})",
-                   key, poolName);
+                   "Error fully writing asynclog batch ({} entries)",
+                   entries.size());
   }
 }
 
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include <folly/Range.h>
 
@@ -22,13 +23,50 @@ namespace mcrouter {
 struct proxy_t;
 
 /**
- * Appends a 'delete' request entry to the asynclog.
- * This call blocks until the entry is written to the file
- * or an error occurs.
+ * Picks the asynclog lane for a pool: a hash of the pool name modulo the
+ * configured lane count (--asynclog-lanes). Entries for the same pool
+ * always land in the same lane's spool file sequence. Safe to call from
+ * any thread.
+ */
+size_t asynclog_lane(proxy_t* proxy, folly::StringPiece poolName);
+
+/**
+ * Appends a 'delete' request entry to the given asynclog lane.
+ * The entry is buffered and written to the lane's spool file together
+ * with the rest of the current batch, once the batch byte bound or time
+ * window is hit. Must be called from the lane's awriter thread.
  */
 void asynclog_delete(proxy_t* proxy,
+                     size_t lane,
                      const AccessPoint& ap,
                      folly::StringPiece key,
                      folly::StringPiece poolName);
 
+/**
+ * Serializes a 'delete' asynclog entry to its spool record.
+ * Unlike the functions above, this is safe to call from any thread.
+ */
+std::string asynclog_delete_record(proxy_t* proxy,
+                                   const AccessPoint& ap,
+                                   folly::StringPiece key,
+                                   folly::StringPiece poolName);
+
+/**
+ * Pushes a serialized spool record into the given lane's in-memory spool
+ * ring and makes sure the lane's awriter will drain it to disk. Must be
+ * called from the proxy thread (the ring's single producer).
+ *
+ * @return false if the memory tier is disabled or the ring is full; the
+ *         caller should fall back to queueing the entry to the lane's
+ *         awriter directly.
+ */
+bool asynclog_ring_append(proxy_t* proxy, size_t lane, std::string record);
+
+/**
+ * Writes out any asynclog entries still buffered for a batched write in
+ * the given lane. Must be called from the lane's awriter thread, or
+ * after the awriters have been stopped.
+ */
+void asynclog_flush(proxy_t* proxy, size_t lane);
+
 }}} // facebook::memcache::mcrouter
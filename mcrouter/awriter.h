@@ -17,12 +17,11 @@
 #include <memory>
 #include <thread>
 
-#include <folly/fibers/FiberManager.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/Range.h>
 
 #include "mcrouter/lib/fbi/cpp/sfrlock.h"
-#include "mcrouter/lib/fbi/queue.h"
+#include "mcrouter/lib/MessageQueue.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -35,7 +34,6 @@ struct awriter_callbacks_t {
 };
 
 struct awriter_entry_t {
-  TAILQ_ENTRY(awriter_entry_t) links;
   void *context;
   const awriter_callbacks_t *callbacks;
 };
@@ -45,7 +43,7 @@ class AsyncWriter {
   /**
    * @param maxQueueSize: maximum number of run requests in a queue. "run" will
    *                      fail if there is already maxQueueSize requests in
-   *                      the queue. 0 means the queue is unlimited.
+   *                      the queue. 0 means "run" never fails (see run()).
    */
   explicit AsyncWriter(size_t maxQueueSize = 0);
 
@@ -74,16 +72,48 @@ class AsyncWriter {
   /**
    * Add a function to the queue to run asynchronously.
    *
+   * Submissions from different threads go through a bounded lock-free ring
+   * and don't serialize on a common lock. With maxQueueSize == 0 the call
+   * may block until the writer thread catches up if the ring is full;
+   * with a size limit it never blocks and fails instead.
+   *
    * @return true on success, false on failure (e.g. when we hit the queue
              size limit)
    */
   bool run(std::function<void()> f);
 
+  /**
+   * @return the EventBase the writer thread loops on. Timeouts scheduled
+   *         on it run on the writer thread.
+   */
+  folly::EventBase& eventBase() {
+    return eventBase_;
+  }
+
   /**
    * Waits for all the functions to complete
    */
   ~AsyncWriter();
  private:
+  /**
+   * Work item for the writer thread. Wraps std::function in a struct with
+   * a noexcept move constructor, which MPMCQueue requires (std::function's
+   * own move constructor is not declared noexcept in older standard
+   * libraries, even though it never throws).
+   */
+  struct WriterTask {
+    std::function<void()> func;
+
+    WriterTask() noexcept {}
+    explicit WriterTask(std::function<void()> f) noexcept
+        : func(std::move(f)) {}
+    WriterTask(WriterTask&& other) noexcept : func(std::move(other.func)) {}
+    WriterTask& operator=(WriterTask&& other) noexcept {
+      func = std::move(other.func);
+      return *this;
+    }
+  };
+
   const size_t maxQueueSize_;
   std::atomic<size_t> queueSize_{0};
   std::atomic<bool> stopped_{false};
@@ -91,7 +121,7 @@ class AsyncWriter {
   // process id of the parent thread (before fork)
   const pid_t pid_;
 
-  folly::fibers::FiberManager fiberManager_;
+  std::unique_ptr<MessageQueue<WriterTask>> queue_;
   folly::EventBase eventBase_;
   std::thread thread_;
 };
@@ -9,13 +9,17 @@
  */
 #include "flavor.h"
 
+#include <future>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include <folly/FileUtil.h>
+#include <folly/Hash.h>
 #include <folly/json.h>
 #include <folly/Range.h>
 
@@ -106,28 +110,93 @@ bool readStandaloneFlavor(
   }
 }
 
+/**
+ * Process-wide cache of parsed flavor files, keyed by flavor path and
+ * revalidated by a hash of the raw file bytes.  Repeat initializations
+ * from the same (unchanged) flavor skip json parsing entirely; a file
+ * that changed on disk is re-parsed.
+ */
+struct FlavorCacheEntry {
+  uint64_t contentsHash{0};
+  std::unordered_map<std::string, std::string> standaloneOpts;
+  std::unordered_map<std::string, std::string> libmcrouterOpts;
+};
+std::mutex gFlavorCacheLock;
+std::unordered_map<std::string, FlavorCacheEntry> gFlavorCache;
+
 } // anonymous namespace
 
 bool readFlavor(
     const std::string& flavor,
     std::unordered_map<std::string, std::string>& standalone_opts,
     std::unordered_map<std::string, std::string>& libmcrouter_opts) {
-  // Reads libmcrouter flavor.
+  // Read both flavor files in parallel: the standalone file on a helper
+  // thread while this thread reads the libmcrouter file.
+  std::string standaloneFlavor = getStandaloneFlavor(flavor);
+  auto standaloneFuture = std::async(
+    std::launch::async,
+    [&standaloneFlavor]() {
+      std::string json;
+      bool found = folly::readFile(standaloneFlavor.data(), json);
+      return std::make_pair(found, std::move(json));
+    });
+
   std::string libmcrouterFlavorJson;
-  if (folly::readFile(flavor.data(), libmcrouterFlavorJson)) {
-    if (!readLibmcrouterFlavor(libmcrouterFlavorJson, libmcrouter_opts)) {
-      return false;
+  bool haveLibmcrouterFlavor =
+    folly::readFile(flavor.data(), libmcrouterFlavorJson);
+  auto standaloneResult = standaloneFuture.get();
+
+  auto contentsHash = folly::hash::hash_combine(
+    folly::hash::fnv64(libmcrouterFlavorJson),
+    folly::hash::fnv64(standaloneResult.second));
+
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> lock(gFlavorCacheLock);
+    auto it = gFlavorCache.find(flavor);
+    if (it != gFlavorCache.end() && it->second.contentsHash == contentsHash) {
+      for (const auto& opt : it->second.standaloneOpts) {
+        standalone_opts[opt.first] = opt.second;
+      }
+      for (const auto& opt : it->second.libmcrouterOpts) {
+        libmcrouter_opts[opt.first] = opt.second;
+      }
+      cached = true;
     }
   }
 
-  // Reads standalone mcrouter flavor.
-  std::string standaloneFlavor = getStandaloneFlavor(flavor);
-  std::string standaloneFlavorJson;
-  if (folly::readFile(standaloneFlavor.data(), standaloneFlavorJson)) {
-    if (!readStandaloneFlavor(standaloneFlavorJson, standalone_opts,
-                              libmcrouter_opts)) {
+  if (!cached) {
+    // Parse into local dictionaries so the cache stores the merged result
+    // without the router_name/flavor_name entries filled in below.
+    std::unordered_map<std::string, std::string> parsedStandaloneOpts;
+    std::unordered_map<std::string, std::string> parsedLibmcrouterOpts;
+
+    // Parses libmcrouter flavor.
+    if (haveLibmcrouterFlavor &&
+        !readLibmcrouterFlavor(libmcrouterFlavorJson, parsedLibmcrouterOpts)) {
       return false;
     }
+
+    // Parses standalone mcrouter flavor; its libmcrouter_options take
+    // precedence over the libmcrouter flavor file.
+    if (standaloneResult.first &&
+        !readStandaloneFlavor(standaloneResult.second, parsedStandaloneOpts,
+                              parsedLibmcrouterOpts)) {
+      return false;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(gFlavorCacheLock);
+      gFlavorCache[flavor] =
+        FlavorCacheEntry{contentsHash, parsedStandaloneOpts,
+                         parsedLibmcrouterOpts};
+    }
+    for (const auto& opt : parsedStandaloneOpts) {
+      standalone_opts[opt.first] = opt.second;
+    }
+    for (const auto& opt : parsedLibmcrouterOpts) {
+      libmcrouter_opts[opt.first] = opt.second;
+    }
   }
 
   libmcrouter_opts["router_name"] = getRouterNameFromFlavor(flavor);
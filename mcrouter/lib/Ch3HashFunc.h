@@ -33,6 +33,15 @@ class Ch3HashFunc {
     return furc_hash(hashable.data(), hashable.size(), n_);
   }
 
+  /**
+   * Hashes by a precomputed seed (see furc_seed_hash()); equivalent to
+   * operator() on the key the seed was computed from, without re-reading
+   * the key bytes.
+   */
+  size_t operator() (uint64_t furcSeed) const {
+    return furc_hash_seeded(furcSeed, n_);
+  }
+
   static const char* type() {
     return "Ch3";
   }
@@ -12,12 +12,21 @@
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Portability.h>
+#include <folly/ScopeGuard.h>
 #include <folly/io/IOBuf.h>
 
 #if FOLLY_HAVE_LIBLZ4
 #include <lz4.h>
 #endif // FOLLY_HAVE_LIBLZ4
 
+#if FOLLY_HAVE_LIBZ
+#include <zlib.h>
+#endif // FOLLY_HAVE_LIBZ
+
+#if FOLLY_HAVE_LIBZSTD
+#include <zstd.h>
+#endif // FOLLY_HAVE_LIBZSTD
+
 #include "mcrouter/lib/IovecCursor.h"
 #include "mcrouter/lib/Lz4Immutable.h"
 
@@ -241,6 +250,221 @@ std::unique_ptr<folly::IOBuf> Lz4CompressionCodec::uncompress(
 }
 #endif // FOLLY_HAVE_LIBLZ4
 
+/**************************
+ * ZSTD Compression Codec *
+ **************************/
+#if FOLLY_HAVE_LIBZSTD
+class ZstdCompressionCodec : public CompressionCodec {
+ public:
+  ZstdCompressionCodec(
+      std::unique_ptr<folly::IOBuf> dictionary,
+      uint32_t id,
+      CompressionCodecOptions options);
+
+  std::unique_ptr<folly::IOBuf> compress(const struct iovec* iov, size_t iovcnt)
+      override final;
+  std::unique_ptr<folly::IOBuf> uncompress(
+      const struct iovec* iov,
+      size_t iovcnt,
+      size_t uncompressedLength = 0) override final;
+
+  ~ZstdCompressionCodec() {
+    ZSTD_freeCCtx(cctx_);
+    ZSTD_freeDCtx(dctx_);
+  }
+
+ private:
+  const std::unique_ptr<folly::IOBuf> dictionary_;
+  const int level_;
+  ZSTD_CCtx* cctx_{nullptr};
+  ZSTD_DCtx* dctx_{nullptr};
+};
+
+ZstdCompressionCodec::ZstdCompressionCodec(
+    std::unique_ptr<folly::IOBuf> dictionary,
+    uint32_t id,
+    CompressionCodecOptions options)
+    : CompressionCodec(CompressionCodecType::ZSTD, id, options),
+      dictionary_(std::move(dictionary)),
+      level_(options.compressionLevel),
+      cctx_(ZSTD_createCCtx()),
+      dctx_(ZSTD_createDCtx()) {
+  if (!cctx_ || !dctx_) {
+    ZSTD_freeCCtx(cctx_);
+    ZSTD_freeDCtx(dctx_);
+    cctx_ = nullptr;
+    dctx_ = nullptr;
+    throw std::runtime_error("ZSTD codec: Failed to allocate context");
+  }
+}
+
+std::unique_ptr<folly::IOBuf> ZstdCompressionCodec::compress(
+    const struct iovec* iov,
+    size_t iovcnt) {
+  assert(iov);
+
+  auto size = IovecCursor::computeTotalLength(iov, iovcnt);
+  auto data = coalesce(iov, iovcnt, size);
+
+  size_t compressBound = ZSTD_compressBound(data.length());
+  auto buffer = folly::IOBuf::create(compressBound);
+
+  size_t compressedSize = ZSTD_compress_usingDict(
+      cctx_,
+      buffer->writableTail(),
+      compressBound,
+      data.data(),
+      data.length(),
+      dictionary_->data(),
+      dictionary_->length(),
+      level_);
+  if (ZSTD_isError(compressedSize)) {
+    throw std::runtime_error(
+        folly::sformat(
+            "ZSTD codec: Failed to compress. Error: {}",
+            ZSTD_getErrorName(compressedSize)));
+  }
+
+  buffer->append(compressedSize);
+  return buffer;
+}
+
+std::unique_ptr<folly::IOBuf> ZstdCompressionCodec::uncompress(
+    const struct iovec* iov,
+    size_t iovcnt,
+    size_t uncompressedLength) {
+  if (uncompressedLength == 0) {
+    throw std::invalid_argument("ZSTD codec: uncompressed length required");
+  }
+
+  auto data =
+      coalesce(iov, iovcnt, IovecCursor::computeTotalLength(iov, iovcnt));
+  auto buffer = folly::IOBuf::create(uncompressedLength);
+
+  size_t bytesWritten = ZSTD_decompress_usingDict(
+      dctx_,
+      buffer->writableTail(),
+      uncompressedLength,
+      data.data(),
+      data.length(),
+      dictionary_->data(),
+      dictionary_->length());
+  if (ZSTD_isError(bytesWritten) || bytesWritten != uncompressedLength) {
+    throw std::runtime_error("ZSTD codec: decompression returned invalid value");
+  }
+
+  buffer->append(bytesWritten);
+  return buffer;
+}
+#endif // FOLLY_HAVE_LIBZSTD
+
+/*****************************
+ * Deflate Compression Codec *
+ *****************************/
+#if FOLLY_HAVE_LIBZ
+class DeflateCompressionCodec : public CompressionCodec {
+ public:
+  DeflateCompressionCodec(
+      std::unique_ptr<folly::IOBuf> dictionary,
+      uint32_t id,
+      CompressionCodecOptions options)
+      : CompressionCodec(CompressionCodecType::DEFLATE, id, options),
+        dictionary_(std::move(dictionary)),
+        level_(options.compressionLevel) {}
+
+  std::unique_ptr<folly::IOBuf> compress(const struct iovec* iov, size_t iovcnt)
+      override final;
+  std::unique_ptr<folly::IOBuf> uncompress(
+      const struct iovec* iov,
+      size_t iovcnt,
+      size_t uncompressedLength = 0) override final;
+
+ private:
+  const std::unique_ptr<folly::IOBuf> dictionary_;
+  const int level_;
+};
+
+std::unique_ptr<folly::IOBuf> DeflateCompressionCodec::compress(
+    const struct iovec* iov,
+    size_t iovcnt) {
+  assert(iov);
+
+  auto size = IovecCursor::computeTotalLength(iov, iovcnt);
+  auto data = coalesce(iov, iovcnt, size);
+
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (deflateInit(&stream, level_) != Z_OK) {
+    throw std::runtime_error("DEFLATE codec: Failed to initialize stream");
+  }
+  SCOPE_EXIT {
+    deflateEnd(&stream);
+  };
+
+  if (deflateSetDictionary(
+          &stream, dictionary_->data(), dictionary_->length()) != Z_OK) {
+    throw std::runtime_error("DEFLATE codec: Failed to load dictionary");
+  }
+
+  size_t compressBound = deflateBound(&stream, data.length());
+  auto buffer = folly::IOBuf::create(compressBound);
+
+  stream.next_in = const_cast<Bytef*>(data.data());
+  stream.avail_in = data.length();
+  stream.next_out = buffer->writableTail();
+  stream.avail_out = compressBound;
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+    throw std::runtime_error("DEFLATE codec: Failed to compress");
+  }
+
+  buffer->append(compressBound - stream.avail_out);
+  return buffer;
+}
+
+std::unique_ptr<folly::IOBuf> DeflateCompressionCodec::uncompress(
+    const struct iovec* iov,
+    size_t iovcnt,
+    size_t uncompressedLength) {
+  if (uncompressedLength == 0) {
+    throw std::invalid_argument("DEFLATE codec: uncompressed length required");
+  }
+
+  auto data =
+      coalesce(iov, iovcnt, IovecCursor::computeTotalLength(iov, iovcnt));
+  auto buffer = folly::IOBuf::create(uncompressedLength);
+
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK) {
+    throw std::runtime_error("DEFLATE codec: Failed to initialize stream");
+  }
+  SCOPE_EXIT {
+    inflateEnd(&stream);
+  };
+
+  stream.next_in = const_cast<Bytef*>(data.data());
+  stream.avail_in = data.length();
+  stream.next_out = buffer->writableTail();
+  stream.avail_out = uncompressedLength;
+
+  int ret = inflate(&stream, Z_FINISH);
+  if (ret == Z_NEED_DICT) {
+    if (inflateSetDictionary(
+            &stream, dictionary_->data(), dictionary_->length()) != Z_OK) {
+      throw std::runtime_error("DEFLATE codec: Failed to load dictionary");
+    }
+    ret = inflate(&stream, Z_FINISH);
+  }
+  if (ret != Z_STREAM_END || stream.avail_out != 0) {
+    throw std::runtime_error(
+        "DEFLATE codec: decompression returned invalid value");
+  }
+
+  buffer->append(uncompressedLength);
+  return buffer;
+}
+#endif // FOLLY_HAVE_LIBZ
+
 } // anonymous namespace
 
 /*****************************
@@ -263,6 +487,22 @@ std::unique_ptr<CompressionCodec> createCompressionCodec(
       LOG(ERROR) << "LZ4 is not available. Returning nullptr.";
       return nullptr;
 #endif // FOLLY_HAVE_LIBLZ4
+    case CompressionCodecType::ZSTD:
+#if FOLLY_HAVE_LIBZSTD
+      return folly::make_unique<ZstdCompressionCodec>(
+          std::move(dictionary), id, options);
+#else
+      LOG(ERROR) << "ZSTD is not available. Returning nullptr.";
+      return nullptr;
+#endif // FOLLY_HAVE_LIBZSTD
+    case CompressionCodecType::DEFLATE:
+#if FOLLY_HAVE_LIBZ
+      return folly::make_unique<DeflateCompressionCodec>(
+          std::move(dictionary), id, options);
+#else
+      LOG(ERROR) << "DEFLATE is not available. Returning nullptr.";
+      return nullptr;
+#endif // FOLLY_HAVE_LIBZ
   }
   return nullptr;
 }
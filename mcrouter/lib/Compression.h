@@ -31,7 +31,19 @@ enum class CompressionCodecType {
   // Use LZ4 compression.
   // Not thread-safe.
   // Requires uncompressed size.
-  LZ4 = 1
+  LZ4 = 1,
+
+  // Use ZSTD compression with dictionary.
+  // Not thread-safe.
+  // Requires uncompressed size.
+  ZSTD = 2,
+
+  // Use zlib deflate with a preset dictionary. The stream format is
+  // standard deflate, so data is interchangeable with hardware-accelerated
+  // deflate implementations (e.g. igzip).
+  // Not thread-safe.
+  // Requires uncompressed size.
+  DEFLATE = 3
 };
 
 /**
@@ -42,6 +54,12 @@ struct CompressionCodecOptions {
    * Minimum value that the codec will start compressing data.
    */
   uint32_t compressionThreshold{0};
+
+  /**
+   * Compression level, for codecs that support it (ZSTD, DEFLATE).
+   * Higher levels trade CPU for a better compression ratio.
+   */
+  uint32_t compressionLevel{1};
 };
 
 /**
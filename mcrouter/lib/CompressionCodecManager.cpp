@@ -61,6 +61,41 @@ CompressionCodecManager::CompressionCodecManager(
     size_ = largestId - smallestId_ + 1;
     LOG(INFO) << "Using " << size_ << " compression codecs (range: ["
               << smallestId_ << ", " << largestId << "])";
+
+    // Group per-pool dictionaries: a pool tag is only usable if its
+    // codec ids form a contiguous sub-range of the selected range.
+    std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> tagBounds;
+    for (uint32_t id = smallestId_; id < smallestId_ + size_; ++id) {
+      const auto& config = codecConfigs_.at(id);
+      if (config->poolTag.empty()) {
+        continue;
+      }
+      auto it = tagBounds.find(config->poolTag);
+      if (it == tagBounds.end()) {
+        tagBounds.emplace(config->poolTag, std::make_pair(id, id));
+      } else {
+        it->second.first = std::min(it->second.first, id);
+        it->second.second = std::max(it->second.second, id);
+      }
+    }
+    for (const auto& it : tagBounds) {
+      bool contiguous = true;
+      for (uint32_t id = it.second.first; id <= it.second.second; ++id) {
+        if (codecConfigs_.at(id)->poolTag != it.first) {
+          contiguous = false;
+          break;
+        }
+      }
+      if (contiguous) {
+        poolIdRanges_.emplace(
+            it.first,
+            CodecIdRange{it.second.first,
+                         it.second.second - it.second.first + 1});
+      } else {
+        LOG(ERROR) << "Codec ids of pool '" << it.first << "' are not"
+                   << " contiguous. The pool falls back to the full range.";
+      }
+    }
   } else {
     LOG(WARNING) << "No valid compression codec found. Compression disabled.";
   }
@@ -74,7 +109,8 @@ CompressionCodecMap* CompressionCodecManager::buildCodecMap() {
   if (size_ == 0) {
     return new CompressionCodecMap();
   }
-  return new CompressionCodecMap(codecConfigs_, smallestId_, size_);
+  return new CompressionCodecMap(codecConfigs_, poolIdRanges_,
+                                 smallestId_, size_);
 }
 
 
@@ -86,8 +122,10 @@ CompressionCodecMap::CompressionCodecMap() noexcept {
 
 CompressionCodecMap::CompressionCodecMap(
     const std::unordered_map<uint32_t, CodecConfigPtr>& codecConfigs,
+    std::unordered_map<std::string, CodecIdRange> poolIdRanges,
     uint32_t smallestId, uint32_t size) noexcept
-    : firstId_(smallestId) {
+    : firstId_(smallestId),
+      poolIdRanges_(std::move(poolIdRanges)) {
   assert(codecConfigs.size() >= size);
 
   codecs_.resize(size);
@@ -122,6 +160,17 @@ CompressionCodec* CompressionCodecMap::getBest(
   return nullptr;
 }
 
+const CodecIdRange CompressionCodecMap::getIdRange(
+    folly::StringPiece poolTag) const {
+  if (!poolTag.empty()) {
+    auto it = poolIdRanges_.find(poolTag.str());
+    if (it != poolIdRanges_.end()) {
+      return it->second;
+    }
+  }
+  return getIdRange();
+}
+
 uint32_t CompressionCodecMap::index(uint32_t id) const noexcept {
   return id - firstId_;
 }
@@ -12,9 +12,11 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <folly/Range.h>
 #include <folly/ThreadLocal.h>
 
 #include "mcrouter/lib/Compression.h"
@@ -32,20 +34,37 @@ struct CodecConfig {
   const CompressionCodecType codecType;
   const std::string dictionary;
   const CompressionCodecOptions options;
+  /**
+   * Name of the pool this dictionary was trained on. Empty means the
+   * codec is shared by all pools. Codecs of the same pool must occupy
+   * a contiguous range of ids.
+   */
+  const std::string poolTag;
 
   CodecConfig(
       uint32_t codecId,
       CompressionCodecType type,
       std::string dic,
-      CompressionCodecOptions opts = {})
+      CompressionCodecOptions opts = {},
+      std::string tag = "")
       : id(codecId),
         codecType(type),
         dictionary(std::move(dic)),
-        options(opts) {}
+        options(opts),
+        poolTag(std::move(tag)) {}
 };
 using CodecConfigPtr = std::unique_ptr<CodecConfig>;
 
 
+/**
+ * Represent a range of valid compression codecs ids
+ */
+struct CodecIdRange {
+  uint64_t firstId;
+  size_t size;
+};
+
+
 /**
  * Manager of compression codecs.
  */
@@ -68,20 +87,13 @@ class CompressionCodecManager {
   // Codec id range
   uint32_t smallestId_{0};
   uint32_t size_{0};
+  // Per-pool sub-ranges of codec ids (poolTag -> range).
+  std::unordered_map<std::string, CodecIdRange> poolIdRanges_;
 
   CompressionCodecMap* buildCodecMap();
 };
 
 
-/**
- * Represent a range of valid compression codecs ids
- */
-struct CodecIdRange {
-  uint64_t firstId;
-  size_t size;
-};
-
-
 /**
  * Map of codec compressors.
  * The ids of the codecs held by this map must be contiguous.
@@ -119,9 +131,17 @@ class CompressionCodecMap {
     return {firstId_, size()};
   }
 
+  /**
+   * Returns the range of codec ids a client talking to the given pool
+   * should advertise: the pool's own dictionary range if one is
+   * configured, the full range otherwise.
+   */
+  const CodecIdRange getIdRange(folly::StringPiece poolTag) const;
+
  private:
   std::vector<std::unique_ptr<CompressionCodec>> codecs_;
   const uint32_t firstId_{0};
+  const std::unordered_map<std::string, CodecIdRange> poolIdRanges_;
 
   /**
    * Builds an empty codec map.
@@ -135,11 +155,13 @@ class CompressionCodecMap {
    *
    * @param codecConfigs  Map of (codecId -> codecConfig). Must contain all
    *                      codecs in the given range.
+   * @param poolIdRanges  Per-pool sub-ranges of codec ids.
    * @param smallestId    First id of the range of codecs.
    * @param size          Size of the range.
    */
   CompressionCodecMap(
       const std::unordered_map<uint32_t, CodecConfigPtr>& codecConfigs,
+      std::unordered_map<std::string, CodecIdRange> poolIdRanges,
       uint32_t smallestId, uint32_t size) noexcept;
 
 
@@ -0,0 +1,224 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CompressionDictionaryTrainer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <glog/logging.h>
+
+#include <folly/Random.h>
+
+namespace facebook {
+namespace memcache {
+
+namespace {
+
+// Length of the substrings counted when scoring samples. Eight bytes
+// fit in a register and are long enough that shared occurrences are
+// meaningful matches for the compressors.
+constexpr size_t kShingleLength = sizeof(uint64_t);
+
+uint64_t shingleAt(const std::string& s, size_t pos) {
+  uint64_t shingle;
+  std::memcpy(&shingle, s.data() + pos, kShingleLength);
+  return shingle;
+}
+
+} // anonymous namespace
+
+CompressionDictionaryTrainer::~CompressionDictionaryTrainer() {
+  stop();
+}
+
+void CompressionDictionaryTrainer::sample(
+    folly::StringPiece poolTag, folly::StringPiece value) {
+  if (value.empty()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(reservoirsMutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // Dropping a sample is cheaper than stalling a proxy thread.
+    return;
+  }
+
+  auto it = reservoirs_.find(poolTag.str());
+  if (it == reservoirs_.end()) {
+    if (reservoirs_.size() >= kMaxPools) {
+      return;
+    }
+    it = reservoirs_.emplace(poolTag.str(), Reservoir()).first;
+  }
+
+  auto& reservoir = it->second;
+  ++reservoir.seen;
+  auto truncated = value.subpiece(0, kMaxSampleBytes);
+  if (reservoir.samples.size() < kReservoirSize) {
+    reservoir.samples.emplace_back(truncated.str());
+  } else {
+    // Classic reservoir sampling: every value seen so far had the same
+    // probability of being in the reservoir.
+    auto slot = folly::Random::rand64(reservoir.seen);
+    if (slot < kReservoirSize) {
+      reservoir.samples[slot] = truncated.str();
+    }
+  }
+}
+
+void CompressionDictionaryTrainer::start(
+    std::chrono::seconds interval, OnDictionaryTrainedFn onTrained) {
+  CHECK(!thread_.joinable()) << "Dictionary trainer started twice";
+  interval_ = interval;
+  onTrained_ = std::move(onTrained);
+  running_ = true;
+  thread_ = std::thread([this]() { trainingLoop(); });
+}
+
+void CompressionDictionaryTrainer::stop() noexcept {
+  {
+    std::unique_lock<std::mutex> lk(threadMutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+    cv_.notify_all();
+  }
+  thread_.join();
+}
+
+void CompressionDictionaryTrainer::trainingLoop() {
+#ifdef __linux__
+  // Training competes with request processing for CPU; make it yield to
+  // everything else.
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+#endif
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(threadMutex_);
+      cv_.wait_for(lk, interval_, [this]() { return !running_; });
+      if (!running_) {
+        return;
+      }
+    }
+
+    // Find pools worth retraining, copying their samples out so
+    // training runs without holding the reservoir lock.
+    std::vector<std::pair<std::string, std::vector<std::string>>> work;
+    {
+      std::lock_guard<std::mutex> lock(reservoirsMutex_);
+      for (auto& it : reservoirs_) {
+        auto& reservoir = it.second;
+        if (reservoir.samples.size() >= kMinSamplesToTrain &&
+            reservoir.seen > reservoir.seenAtLastTraining) {
+          reservoir.seenAtLastTraining = reservoir.seen;
+          work.emplace_back(it.first, reservoir.samples);
+        }
+      }
+    }
+
+    for (auto& it : work) {
+      auto dictionary = buildDictionary(it.second);
+      if (!dictionary.empty()) {
+        VLOG(1) << "Trained " << dictionary.size()
+                << " byte compression dictionary for pool '" << it.first
+                << "' from " << it.second.size() << " samples";
+        onTrained_(it.first, std::move(dictionary));
+      }
+    }
+  }
+}
+
+std::string CompressionDictionaryTrainer::train(folly::StringPiece poolTag) {
+  std::vector<std::string> samples;
+  {
+    std::lock_guard<std::mutex> lock(reservoirsMutex_);
+    auto it = reservoirs_.find(poolTag.str());
+    if (it == reservoirs_.end() ||
+        it->second.samples.size() < kMinSamplesToTrain) {
+      return std::string();
+    }
+    samples = it->second.samples;
+  }
+  return buildDictionary(samples);
+}
+
+std::string CompressionDictionaryTrainer::buildDictionary(
+    const std::vector<std::string>& samples) {
+  // Count how often each shingle occurs across distinct samples, then
+  // score every sample by the fraction of its content shared with other
+  // samples. Samples full of schema boilerplate score high; unique
+  // payloads (random ids, encrypted blobs) score low and are left out
+  // first when the size budget runs short.
+  std::unordered_map<uint64_t, uint32_t> shingleCount;
+  for (const auto& sample : samples) {
+    if (sample.size() < kShingleLength) {
+      continue;
+    }
+    for (size_t i = 0; i + kShingleLength <= sample.size(); ++i) {
+      ++shingleCount[shingleAt(sample, i)];
+    }
+  }
+
+  std::vector<std::pair<double, const std::string*>> scored;
+  scored.reserve(samples.size());
+  for (const auto& sample : samples) {
+    if (sample.size() < kShingleLength) {
+      continue;
+    }
+    size_t shared = 0;
+    const size_t numShingles = sample.size() - kShingleLength + 1;
+    for (size_t i = 0; i < numShingles; ++i) {
+      if (shingleCount[shingleAt(sample, i)] > 1) {
+        ++shared;
+      }
+    }
+    scored.emplace_back(static_cast<double>(shared) / numShingles, &sample);
+  }
+  if (scored.empty()) {
+    return std::string();
+  }
+
+  // Keep the best-scoring samples within the size budget; emit them in
+  // ascending score order so the most representative bytes are at the
+  // end of the dictionary.
+  std::sort(scored.begin(), scored.end(),
+            [](const std::pair<double, const std::string*>& lhs,
+               const std::pair<double, const std::string*>& rhs) {
+              return lhs.first > rhs.first;
+            });
+  size_t budget = 0;
+  size_t taken = 0;
+  while (taken < scored.size() &&
+         budget + scored[taken].second->size() <= kDictionarySize) {
+    budget += scored[taken].second->size();
+    ++taken;
+  }
+  if (taken == 0) {
+    return std::string();
+  }
+
+  std::string dictionary;
+  dictionary.reserve(budget);
+  for (size_t i = taken; i-- > 0;) {
+    dictionary.append(*scored[i].second);
+  }
+  return dictionary;
+}
+
+} // memcache
+} // facebook
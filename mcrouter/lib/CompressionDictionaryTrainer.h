@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Likely.h>
+#include <folly/Range.h>
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Trains compression dictionaries online, from values sampled off live
+ * traffic, so dictionaries keep up with evolving value schemas instead
+ * of slowly losing ratio until someone retrains them by hand.
+ *
+ * Values are sampled per pool into a bounded reservoir (a uniform
+ * random subset of everything offered, see sample()). A background
+ * thread, running at the lowest scheduling priority, periodically
+ * builds a dictionary for every pool whose reservoir has fresh data and
+ * hands it to the callback given to start().
+ *
+ * The trainer does not assign codec ids or swap codecs in the running
+ * process: a dictionary is only useful once both ends of a connection
+ * have it, so the callback is expected to feed the deployment's codec
+ * config pipeline, which assigns the next codec id and distributes it.
+ * The existing versioned-id negotiation keeps mismatched ends correct
+ * while a new dictionary rolls out.
+ *
+ * All public methods are thread-safe.
+ */
+class CompressionDictionaryTrainer {
+ public:
+  using OnDictionaryTrainedFn =
+      std::function<void(const std::string& poolTag, std::string dictionary)>;
+
+  CompressionDictionaryTrainer() = default;
+  ~CompressionDictionaryTrainer();
+
+  // non copyable
+  CompressionDictionaryTrainer(const CompressionDictionaryTrainer&) = delete;
+  CompressionDictionaryTrainer& operator=(
+      const CompressionDictionaryTrainer&) = delete;
+
+  /**
+   * Cheap per-thread gate for the request path: returns true once every
+   * kSampleEvery calls. Callers should only extract the value and call
+   * sample() when this returns true.
+   */
+  bool shouldSample() noexcept {
+    thread_local uint32_t countdown{kSampleEvery};
+    if (LIKELY(--countdown > 0)) {
+      return false;
+    }
+    countdown = kSampleEvery;
+    return true;
+  }
+
+  /**
+   * Offers a value to the reservoir of the given pool. Empty values and
+   * values for pools beyond the pool cap are ignored; if the reservoir
+   * lock is contended the sample is simply dropped, so the request path
+   * never blocks on the trainer.
+   *
+   * @param poolTag  Pool the value was sent to. Empty means the shared
+   *                 (poolless) dictionary.
+   * @param value    The value. Only the leading kMaxSampleBytes are kept.
+   */
+  void sample(folly::StringPiece poolTag, folly::StringPiece value);
+
+  /**
+   * Starts the background training thread. May be called at most once.
+   *
+   * @param interval   How often to look for pools with fresh samples.
+   * @param onTrained  Called from the training thread with each freshly
+   *                   trained dictionary.
+   */
+  void start(std::chrono::seconds interval, OnDictionaryTrainedFn onTrained);
+
+  /**
+   * Stops the background thread. Called automatically on destruction.
+   */
+  void stop() noexcept;
+
+  /**
+   * Trains a dictionary from the current reservoir of the given pool.
+   * Returns an empty string if the pool has fewer than
+   * kMinSamplesToTrain samples. Exposed mainly for testing; the
+   * background thread is the intended driver.
+   */
+  std::string train(folly::StringPiece poolTag);
+
+ private:
+  // One of every kSampleEvery requests per thread is offered to the
+  // reservoir.
+  static constexpr uint32_t kSampleEvery = 1024;
+  // Bounds on reservoir memory: at most kMaxPools pools, kReservoirSize
+  // samples each, every sample truncated to kMaxSampleBytes.
+  static constexpr size_t kMaxPools = 32;
+  static constexpr size_t kReservoirSize = 256;
+  static constexpr size_t kMaxSampleBytes = 4096;
+  // Minimum reservoir occupancy before a dictionary is trained.
+  static constexpr size_t kMinSamplesToTrain = 64;
+  // Size of the trained dictionaries.
+  static constexpr size_t kDictionarySize = 64 * 1024;
+
+  struct Reservoir {
+    std::vector<std::string> samples;
+    // Total number of values offered; drives reservoir replacement.
+    uint64_t seen{0};
+    // Value of 'seen' when the last dictionary was trained, so pools
+    // without fresh traffic are not retrained.
+    uint64_t seenAtLastTraining{0};
+  };
+
+  // Guards reservoirs_.
+  std::mutex reservoirsMutex_;
+  std::unordered_map<std::string, Reservoir> reservoirs_;
+
+  // Training thread state.
+  std::thread thread_;
+  std::mutex threadMutex_;
+  std::condition_variable cv_;
+  bool running_{false};
+  std::chrono::seconds interval_{0};
+  OnDictionaryTrainedFn onTrained_;
+
+  void trainingLoop();
+
+  /**
+   * Builds a dictionary of at most kDictionarySize bytes from the given
+   * samples, ordered so the most representative content sits at the end
+   * (where deflate preset dictionaries are cheapest to reference).
+   */
+  static std::string buildDictionary(const std::vector<std::string>& samples);
+};
+
+} // memcache
+} // facebook
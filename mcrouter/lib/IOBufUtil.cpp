@@ -63,4 +63,17 @@ void copyInto(char* raw, const folly::IOBuf& buf) {
   } while (cur != &buf);
 }
 
+folly::IOBuf concatPieces(std::initializer_list<folly::StringPiece> pieces) {
+  size_t len = 0;
+  for (auto piece : pieces) {
+    len += piece.size();
+  }
+  folly::IOBuf out(folly::IOBuf::CREATE, len);
+  for (auto piece : pieces) {
+    ::memcpy(out.writableTail(), piece.data(), piece.size());
+    out.append(piece.size());
+  }
+  return out;
+}
+
 }} // facebook::memcache
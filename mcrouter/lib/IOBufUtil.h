@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <initializer_list>
 #include <memory>
 #include <string>
 
@@ -35,6 +36,12 @@ bool hasSameMemoryRegion(const folly::IOBuf& a, const folly::IOBuf& b);
 
 void copyInto(char* raw, const folly::IOBuf& buf);
 
+/**
+ * Builds an unchained IOBuf holding the concatenation of the given
+ * pieces, copying each exactly once.
+ */
+folly::IOBuf concatPieces(std::initializer_list<folly::StringPiece> pieces);
+
 template <typename InputIterator>
 folly::IOBuf concatAll(InputIterator begin, InputIterator end) {
   folly::IOBuf out;
@@ -70,6 +77,29 @@ inline bool cloneInto(folly::IOBuf& out, const folly::IOBuf& source,
   return true;
 }
 
+/**
+ * Same as cloneInto(), except that small ranges are copied into a fresh
+ * buffer owned by out instead of sharing source's storage.  A clone pins
+ * all of source (typically a parser read buffer) until the message is
+ * destroyed, and a shared read buffer cannot be reused for the next read;
+ * for values of a few dozen bytes one small copy is cheaper than
+ * reallocating the read buffer.
+ * @return false If the range is invalid.
+ */
+inline bool copyOrCloneInto(folly::IOBuf& out, const folly::IOBuf& source,
+                            const uint8_t* begin, size_t size) {
+  constexpr size_t kMaxCopyLength = 64;
+  if (size <= kMaxCopyLength) {
+    if (!(begin >= source.data() &&
+          begin + size <= source.data() + source.length())) {
+      return false;
+    }
+    out = folly::IOBuf(folly::IOBuf::COPY_BUFFER, begin, size);
+    return true;
+  }
+  return cloneInto(out, source, begin, size);
+}
+
 /**
  * Given a coalesced IOBuf and a range of bytes [begin, begin + size) inside it,
  * copies range as a string str such that str[i] == *(char*)(begin+i)
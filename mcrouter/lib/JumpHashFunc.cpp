@@ -0,0 +1,100 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "JumpHashFunc.h"
+
+#include <folly/SpookyHashV2.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/fbi/hash.h"
+#include "mcrouter/lib/WeightedCh3HashFunc.h"
+
+namespace facebook { namespace memcache {
+
+namespace {
+/* Seed for hashing the key down to the uint64_t jump hash consumes. */
+const uint32_t kKeyHashSeed = 0x7a636d31;
+/* Must match WeightedCh3HashFunc for identical acceptance decisions. */
+const size_t kNumTries = 32;
+const uint32_t kHashSeed = 0xface2014;
+
+size_t jumpConsistentHash(uint64_t key, size_t n) {
+  int64_t b = -1;
+  int64_t j = 0;
+  while (j < static_cast<int64_t>(n)) {
+    b = j;
+    key = key * 2862933555777941757ULL + 1;
+    j = (b + 1) *
+        (static_cast<double>(1LL << 31) /
+         static_cast<double>((key >> 33) + 1));
+  }
+  return static_cast<size_t>(b);
+}
+
+size_t jumpHash(folly::StringPiece key, size_t n) {
+  return jumpConsistentHash(
+    murmur_hash_64A(key.data(), key.size(), kKeyHashSeed), n);
+}
+}  // anonymous namespace
+
+JumpHashFunc::JumpHashFunc(size_t n) : n_(n) {
+  checkLogic(n_ > 0, "JumpHashFunc: empty pool");
+}
+
+size_t JumpHashFunc::operator()(folly::StringPiece hashable) const {
+  return jumpHash(hashable, n_);
+}
+
+WeightedJumpHashFunc::WeightedJumpHashFunc(std::vector<double> weights)
+    : ring_(WeightedCh3Ring::get(std::move(weights))) {
+  checkLogic(ring_->size() > 0, "WeightedJumpHashFunc: empty pool");
+}
+
+WeightedJumpHashFunc::WeightedJumpHashFunc(const folly::dynamic& json,
+                                           size_t n)
+    : ring_(WeightedCh3Ring::fromJson(json, n, "WeightedJumpHashFunc")) {
+  checkLogic(ring_->size() > 0, "WeightedJumpHashFunc: empty pool");
+}
+
+const std::vector<double>& WeightedJumpHashFunc::weights() const {
+  return ring_->weights();
+}
+
+size_t WeightedJumpHashFunc::operator()(folly::StringPiece key) const {
+  /* Same rejection sampling and salting protocol as weightedCh3Hash,
+     with jump hash choosing the index on each try. */
+  size_t salt = 0;
+  size_t index = 0;
+  std::string saltedKey;
+  auto originalKey = key;
+  for (size_t i = 0; i < kNumTries; ++i) {
+    index = jumpHash(key, ring_->size());
+
+    uint64_t p = folly::hash::SpookyHashV2::Hash32(key.data(), key.size(),
+                                                   kHashSeed);
+    uint64_t w = ring_->threshold(index);
+
+    if (LIKELY(p < w)) {
+      return index;
+    }
+
+    auto s = salt++;
+    saltedKey = originalKey.str();
+    do {
+      saltedKey.push_back(char(s % 10) + '0');
+      s /= 10;
+    } while (s > 0);
+
+    key = saltedKey;
+  }
+
+  return index;
+}
+
+}}  // facebook::memcache
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace folly {
+struct dynamic;
+} // folly
+
+namespace facebook { namespace memcache {
+
+class WeightedCh3Ring;
+
+/**
+ * Jump consistent hash function object, after Lamping & Veach,
+ * "A Fast, Minimal Memory, Consistent Hash Algorithm".
+ *
+ * Needs no per-pool state and runs an expected ln(n) iterations of a
+ * 64-bit LCG step, which is several times cheaper per lookup than Ch3's
+ * furc_hash spins at typical pool sizes.
+ *
+ * Caveat: jump hash is only consistent when servers are added to or removed
+ * from the end of the pool; reordering or removing from the middle remaps
+ * keys of all later servers. Use it only for pools where both sides control
+ * the server ordering.
+ */
+class JumpHashFunc {
+ public:
+  explicit JumpHashFunc(size_t n);
+
+  size_t operator()(folly::StringPiece hashable) const;
+
+  static const char* type() {
+    return "Jump";
+  }
+
+ private:
+  size_t n_;
+};
+
+/**
+ * A weighted jump hash function.
+ *
+ * Weight handling is identical to WeightedCh3HashFunc (same "weights" json
+ * format, same acceptance and salting protocol), with jump hash replacing
+ * Ch3 for the index choice on each try. With all weights at 1.0 it returns
+ * the same indices as plain JumpHashFunc.
+ */
+class WeightedJumpHashFunc {
+ public:
+  /**
+   * @param weights  A list of server weights.
+   *                 Pool size is taken to be weights.size()
+   */
+  explicit WeightedJumpHashFunc(std::vector<double> weights);
+
+  WeightedJumpHashFunc(const folly::dynamic& json, size_t n);
+
+  size_t operator()(folly::StringPiece key) const;
+
+  /**
+   * @return Saved weights.
+   */
+  const std::vector<double>& weights() const;
+
+  static const char* type() {
+    return "WeightedJump";
+  }
+
+ private:
+  std::shared_ptr<const WeightedCh3Ring> ring_;
+};
+
+}}  // facebook::memcache
@@ -14,6 +14,7 @@
 #include <folly/Range.h>
 
 #include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/fbi/hash.h"
 
 namespace facebook { namespace memcache {
 
@@ -45,6 +46,7 @@ void Keys::update(folly::StringPiece key) {
     routingKey_.reset(keyWithoutRoute_.begin(), pos);
   }
   routingKeyHash_ = 0;
+  routingKeyFurcSeed_ = 0;
 }
 
 uint32_t Keys::routingKeyHash() const {
@@ -55,4 +57,12 @@ uint32_t Keys::routingKeyHash() const {
   return routingKeyHash_;
 }
 
+uint64_t Keys::routingKeyFurcSeed() const {
+  if (routingKeyFurcSeed_ == 0) {
+    const_cast<uint64_t&>(routingKeyFurcSeed_)
+      = furc_seed_hash(routingKey_.data(), routingKey_.size());
+  }
+  return routingKeyFurcSeed_;
+}
+
 }} // facebook::memcache
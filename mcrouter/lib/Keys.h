@@ -44,6 +44,13 @@ class Keys {
   void update(folly::StringPiece key);
   uint32_t routingKeyHash() const;
 
+  /**
+   * Seed hash of routingKey() for furc_hash_seeded(), lazily computed and
+   * cached like routingKeyHash().  Lets consistent-hash lookups against
+   * multiple pools read the key bytes only once per request.
+   */
+  uint64_t routingKeyFurcSeed() const;
+
   // Hack to save some CPU in stripRoutingPrefix. Avoid if possible.
   void clearRoutingPrefix() {
     routingPrefix_.clear();
@@ -53,6 +60,7 @@ class Keys {
   folly::StringPiece routingPrefix_;
   folly::StringPiece routingKey_;
   uint32_t routingKeyHash_{0};
+  uint64_t routingKeyFurcSeed_{0};
 };
 
 }} // facebook::memcache
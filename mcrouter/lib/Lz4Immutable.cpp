@@ -127,6 +127,76 @@ void safeCopy(uint8_t* dest, IovecCursor& source, size_t count) {
   } while (left > 0);
 }
 
+/**
+ * Decompression sink writing to a single contiguous buffer.
+ */
+class ContiguousSink {
+ public:
+  explicit ContiguousSink(size_t uncompressedSize)
+      : buffer_(folly::IOBuf::create(uncompressedSize)) {}
+
+  void copy(IovecCursor& source, size_t count) {
+    safeCopy(buffer_->writableTail(), source, count);
+    buffer_->append(count);
+  }
+
+  size_t written() const {
+    return buffer_->length();
+  }
+
+  std::unique_ptr<folly::IOBuf> finish() {
+    return std::move(buffer_);
+  }
+
+ private:
+  std::unique_ptr<folly::IOBuf> buffer_;
+};
+
+/**
+ * Decompression sink writing to a chain of IOBufs of at most
+ * chunkSize bytes each.
+ */
+class ChainedSink {
+ public:
+  ChainedSink(size_t uncompressedSize, size_t chunkSize)
+      : chunkSize_(std::max<size_t>(1, std::min(chunkSize, uncompressedSize))),
+        head_(folly::IOBuf::create(chunkSize_)),
+        current_(head_.get()) {}
+
+  void copy(IovecCursor& source, size_t count) {
+    while (count > 0) {
+      // IOBuf::create() may allocate more than requested, so limit each
+      // buffer to chunkSize_ bytes explicitly.
+      size_t room = chunkSize_ - current_->length();
+      if (room == 0) {
+        auto buf = folly::IOBuf::create(chunkSize_);
+        current_ = buf.get();
+        head_->prependChain(std::move(buf));
+        room = chunkSize_;
+      }
+      size_t toWrite = std::min(count, room);
+      safeCopy(current_->writableTail(), source, toWrite);
+      current_->append(toWrite);
+      written_ += toWrite;
+      count -= toWrite;
+    }
+  }
+
+  size_t written() const {
+    return written_;
+  }
+
+  std::unique_ptr<folly::IOBuf> finish() {
+    return std::move(head_);
+  }
+
+ private:
+  const size_t chunkSize_;
+  std::unique_ptr<folly::IOBuf> head_;
+  folly::IOBuf* current_;
+  size_t written_{0};
+};
+
 /**
  * A customized (faster) version of safeCopy that may overwrite
  * up to 7 bytes more than "count".
@@ -152,6 +222,68 @@ uint16_t peekLE(const IovecCursor& cursor) {
   return folly::Endian::little(cursor.peek<uint16_t>());
 }
 
+/**
+ * Decompresses source into the given sink.
+ *
+ * @return true on success, false if the compressed data is corrupt.
+ */
+template <class Sink>
+bool decompressToSink(
+    IovecCursor& source,
+    const IovecCursor& dicCursor,
+    size_t uncompressedSize,
+    Sink& sink) {
+  IovecCursor match = dicCursor;
+
+  // Main loop
+  while (true) {
+    // LZ4 token
+    size_t token = source.read<uint8_t>();
+
+    // Get literal length
+    size_t literalLength = token >> kMlBits;
+    if (literalLength == kRunMask) {
+      size_t s;
+      do {
+        s = source.read<uint8_t>();
+        literalLength += s;
+      } while (LIKELY(s == 255));
+    }
+
+    // Copy literals
+    if (sink.written() + literalLength + kCopyLength > uncompressedSize) {
+      if (sink.written() + literalLength != uncompressedSize) {
+        return false;
+      }
+      sink.copy(source, literalLength);
+      break; // Necessarily EOF, due to parsing restrictions
+    }
+    sink.copy(source, literalLength);
+
+    // Get match offset
+    uint16_t offset = peekLE(source);
+    size_t matchPos = dicCursor.totalLength() + sink.written() - offset;
+    source.advance(2);
+
+    // Get match length
+    size_t matchLength = token & kMlMask;
+    if (matchLength == kMlMask) {
+      size_t s;
+      do {
+        s = source.read<uint8_t>();
+        matchLength += s;
+      } while (s == 255);
+    }
+    matchLength += kMinMatch;
+
+    // Copy match
+    match.seek(matchPos);
+    sink.copy(match, matchLength);
+  }
+
+  return true;
+}
+
 /**
  * Given the difference between two number (i.e. num1 ^ num2), return the number
  * of leading bytes that are common in the two numbers.
@@ -453,70 +585,38 @@ std::unique_ptr<folly::IOBuf> Lz4Immutable::decompress(
   // found in the dictionary.
   struct iovec dicIov = getDictionaryIovec(state_);
   const IovecCursor dicCursor(&dicIov, 1);
-
-  // Destination (uncompressed) buffer.
-  auto destination = folly::IOBuf::create(uncompressedSize);
-  // Pointer to where the next uncompressed position should be written.
-  uint8_t* output = destination->writableTail();
-  // Lower and upper limit to where the output buffer can go.
-  const uint8_t* outputStart = output;
-  const uint8_t* outputLimit = output + uncompressedSize;
-
   IovecCursor source(iov, iovcnt);
-  IovecCursor match = dicCursor;
-
-  // Main loop
-  while (true) {
-    // LZ4 token
-    size_t token = source.read<uint8_t>();
 
-    // Get literal length
-    size_t literalLength = token >> kMlBits;
-    if (literalLength == kRunMask) {
-      size_t s;
-      do {
-        s = source.read<uint8_t>();
-        literalLength += s;
-      } while (LIKELY(s == 255));
-    }
-
-    // Copy literals
-    uint8_t* cpy = output + literalLength;
-    if (cpy > outputLimit - kCopyLength) {
-      if (cpy != outputLimit) {
-        return nullptr;
-      }
-      safeCopy(output, source, literalLength);
-      output += literalLength;
-      break; // Necessarily EOF, due to parsing restrictions
-    }
-    safeCopy(output, source, literalLength);
-    output = cpy;
+  ContiguousSink sink(uncompressedSize);
+  if (!decompressToSink(source, dicCursor, uncompressedSize, sink)) {
+    return nullptr;
+  }
+  return sink.finish();
+}
 
-    // Get match offset
-    uint16_t offset = peekLE(source);
-    size_t matchPos = dicCursor.totalLength() + (output - outputStart) - offset;
-    source.advance(2);
+std::unique_ptr<folly::IOBuf> Lz4Immutable::decompressIntoChain(
+    const folly::IOBuf& source,
+    size_t uncompressedSize,
+    size_t chunkSize) const noexcept {
+  auto iov = source.getIov();
+  return decompressIntoChain(
+      iov.data(), iov.size(), uncompressedSize, chunkSize);
+}
 
-    // Get match length
-    size_t matchLength = token & kMlMask;
-    if (matchLength == kMlMask) {
-      size_t s;
-      do {
-        s = source.read<uint8_t>();
-        matchLength += s;
-      } while (s == 255);
-    }
-    matchLength += kMinMatch;
+std::unique_ptr<folly::IOBuf> Lz4Immutable::decompressIntoChain(
+    const struct iovec* iov,
+    size_t iovcnt,
+    size_t uncompressedSize,
+    size_t chunkSize) const noexcept {
+  struct iovec dicIov = getDictionaryIovec(state_);
+  const IovecCursor dicCursor(&dicIov, 1);
+  IovecCursor source(iov, iovcnt);
 
-    // Copy match
-    match.seek(matchPos);
-    safeCopy(output, match, matchLength);
-    output += matchLength;
+  ChainedSink sink(uncompressedSize, chunkSize);
+  if (!decompressToSink(source, dicCursor, uncompressedSize, sink)) {
+    return nullptr;
   }
-
-  destination->append(output - outputStart);
-  return destination;
+  return sink.finish();
 }
 
 } // memcache
@@ -22,6 +22,9 @@ constexpr size_t kHashtableSize = 1 << kHashLog;
 
 using Hashtable = std::array<uint16_t, kHashtableSize>;
 
+// Default buffer size of decompressIntoChain().
+constexpr size_t kDecompressChunkSize = 16 * 1024;
+
 /**
  * Internal state of Lz4Immutable.
  */
@@ -82,6 +85,30 @@ class Lz4Immutable {
       size_t iovcnt,
       size_t uncompressedSize) const noexcept;
 
+  /**
+   * Like decompress(), but writes the uncompressed data into a chain of
+   * IOBufs of at most chunkSize bytes each instead of one contiguous
+   * buffer. Useful when the result is written out as iovecs anyway and
+   * a single large transient allocation is undesirable.
+   *
+   * @param source            Compressed data to uncompress.
+   * @param uncompressedSize  Original size (i.e. size of the data
+   *                          before compression).
+   * @param chunkSize         Maximum size of each IOBuf in the chain.
+   * @return                  A newly allocated IOBuf chain with the
+   *                          uncompressed data, or, in case of error,
+   *                          nullptr.
+   */
+  std::unique_ptr<folly::IOBuf> decompressIntoChain(
+      const folly::IOBuf& source,
+      size_t uncompressedSize,
+      size_t chunkSize = kDecompressChunkSize) const noexcept;
+  std::unique_ptr<folly::IOBuf> decompressIntoChain(
+      const struct iovec* iov,
+      size_t iovcnt,
+      size_t uncompressedSize,
+      size_t chunkSize = kDecompressChunkSize) const noexcept;
+
  private:
   const Lz4ImmutableState state_;
 };
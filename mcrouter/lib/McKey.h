@@ -9,12 +9,11 @@
  */
 #pragma once
 
-#include <ctype.h>
-
 #include <folly/Range.h>
 
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/mc/protocol.h"
+#include "mcrouter/lib/network/AsciiScan.h"
 
 namespace facebook { namespace memcache {
 
@@ -34,10 +33,10 @@ inline mc_req_err_t isKeyValid(folly::StringPiece key) {
     return mc_req_err_key_too_long;
   }
 
-  for (auto c : key) {
-    if (iscntrl(c) || isspace(c)) {
-      return mc_req_err_space_or_ctrl;
-    }
+  /* The invalid set (bytes <= 0x20 and DEL) is exactly the ascii protocol
+     token delimiter set, so reuse the parser's vectorized scan kernel. */
+  if (asciiScanDelimiter(key.begin(), key.end()) != key.end()) {
+    return mc_req_err_space_or_ctrl;
   }
 
   return mc_req_err_valid;
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Process-wide byte accounting for the memory categories that grow
+ * without bound under overload: parser read buffers, reply write
+ * buffers and queued (not yet processing) requests.
+ *
+ * The budget is advisory: nothing here fails an allocation.  Producers
+ * record what they hold with relaxed atomic adds (one uncontended RMW
+ * per allocation), and callers that can shed work - proxy queue
+ * admission, in particular - compare usage against a fraction of the
+ * cap.  Readers may see slightly stale totals, which is fine for
+ * shedding decisions.
+ */
+class MemoryBudget {
+ public:
+  enum Category {
+    kReadBuffers = 0,
+    kWriteBuffers,
+    kWaitingRequests,
+    kNumCategories
+  };
+
+  static MemoryBudget& instance();
+
+  /**
+   * Sets the cap, in bytes.  0 (the default) means no cap: accounting
+   * still happens, but overThreshold() is always false.
+   */
+  void setLimit(size_t bytes) {
+    limit_.store(bytes, std::memory_order_relaxed);
+  }
+
+  size_t limit() const {
+    return limit_.load(std::memory_order_relaxed);
+  }
+
+  void account(Category category, int64_t delta) {
+    used_[category].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  size_t used(Category category) const {
+    const auto value =
+        used_[category].value.load(std::memory_order_relaxed);
+    return value > 0 ? static_cast<size_t>(value) : 0;
+  }
+
+  size_t usedTotal() const {
+    int64_t total = 0;
+    for (size_t i = 0; i < kNumCategories; ++i) {
+      total += used_[i].value.load(std::memory_order_relaxed);
+    }
+    return total > 0 ? static_cast<size_t>(total) : 0;
+  }
+
+  /**
+   * True if total usage is at or above the given fraction of the cap.
+   */
+  bool overThreshold(double fraction) const {
+    const auto limit = limit_.load(std::memory_order_relaxed);
+    return limit != 0 && usedTotal() >= limit * fraction;
+  }
+
+ private:
+  /* One counter per cache line, so threads bumping different
+     categories don't bounce a shared line. */
+  struct PaddedCounter {
+    std::atomic<int64_t> value;
+    char pad[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  std::atomic<size_t> limit_{0};
+  PaddedCounter used_[kNumCategories];
+
+  MemoryBudget() {
+    for (auto& counter : used_) {
+      counter.value.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+}} // facebook::memcache
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <folly/FileUtil.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventFDWrapper.h>
@@ -16,6 +18,8 @@
 #include <folly/MPMCQueue.h>
 #include <folly/Random.h>
 
+#include "mcrouter/lib/PeriodicTaskScheduler.h"
+
 namespace facebook { namespace memcache {
 
 /**
@@ -128,23 +132,37 @@ class MessageQueue {
         notifier_(noNotifyRate, waitThreshold, nowFunc),
         handler_(*this),
         timeoutHandler_(*this),
+        drainCallback_(*this),
         notifyCallback_(std::move(notifyCallback)) {
 
+    batch_.reserve(capacity);
     efd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
     PCHECK(efd_ >= 0);
   }
 
   /**
    * Must be called from the event base thread.
+   *
+   * @param taskScheduler  If given, the periodic drain tick is registered
+   *   there instead of arming a private timer, sharing the event base's
+   *   coalesced timer with other housekeeping tasks.
    */
-  void attachEventBase(folly::EventBase& evb) {
+  void attachEventBase(folly::EventBase& evb,
+                       PeriodicTaskScheduler* taskScheduler = nullptr) {
+    eventBase_ = &evb;
     handler_.initHandler(&evb, efd_);
     handler_.registerHandler(
       folly::EventHandler::READ | folly::EventHandler::PERSIST);
 
     if (notifier_.noNotifyRate() > 0) {
-      timeoutHandler_.attachEventBase(&evb);
-      timeoutHandler_.scheduleTimeout(kWakeupEveryMs);
+      if (taskScheduler != nullptr) {
+        taskScheduler_ = taskScheduler;
+        tickTaskId_ = taskScheduler_->schedule(
+          kWakeupEveryMs, [this]() { onTick(); });
+      } else {
+        timeoutHandler_.attachEventBase(&evb);
+        timeoutHandler_.scheduleTimeout(kWakeupEveryMs);
+      }
     }
   }
 
@@ -164,7 +182,25 @@ class MessageQueue {
       });
   }
 
+  /**
+   * Must be called from the event base thread.
+   * Like drain(), but first pulls every available message into an
+   * internal batch and only then runs the callback on each of them, so
+   * writers blocked on a full queue get unblocked up front and message
+   * processing doesn't interleave with queue reads.
+   */
+  void drainBatch() {
+    lastDrainCount_ = 0;
+    notifier_.drainWhileNonEmpty(
+      [this] () {
+        drainBatchImpl();
+      });
+  }
+
   ~MessageQueue() {
+    if (taskScheduler_ != nullptr) {
+      taskScheduler_->cancel(tickTaskId_);
+    }
     handler_.unregisterHandler();
     if (efd_ >= 0) {
       PCHECK(folly::closeNoInt(efd_) == 0);
@@ -194,8 +230,33 @@ class MessageQueue {
     }
   }
 
+  /**
+   * Same as blockingWrite(), but does not post any notification event.
+   * The writer must eventually follow up with notifyRelaxed(), or the
+   * element may sit in the queue until some other write (or the drain
+   * timeout, if enabled) wakes the reader up.  Useful for batching: write
+   * several elements without notification, then notify once.
+   */
+  template <class... Args>
+  void blockingWriteNoNotify(Args&&... args) noexcept {
+    queue_.blockingWrite(std::forward<Args>(args)...);
+  }
+
+  /**
+   * Post a notification event for previously unnotified writes.
+   * Can be called from any thread; spurious calls are harmless.
+   */
+  void notifyRelaxed() noexcept {
+    if (notifier_.shouldNotifyRelaxed()) {
+      doNotify();
+    }
+  }
+
  private:
   static constexpr int64_t kWakeupEveryMs = 2;
+  // consecutive empty polls after which we stop polling the queue from
+  // the event loop and fall back to eventfd wakeups
+  static constexpr size_t kMaxEmptyPolls = 8;
   folly::MPMCQueue<T> queue_;
   std::function<void(T&&)> onMessage_;
   Notifier notifier_;
@@ -222,25 +283,75 @@ class MessageQueue {
     MessageQueue& parent_;
   };
 
+  class DrainCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit DrainCallback(MessageQueue& q) : parent_(q) {}
+    void runLoopCallback() noexcept override final {
+      parent_.onPoll();
+    }
+
+   private:
+    MessageQueue& parent_;
+  };
+
   EventHandler handler_;
   TimeoutHandler timeoutHandler_;
+  DrainCallback drainCallback_;
   std::function<void()> notifyCallback_;
+  PeriodicTaskScheduler* taskScheduler_{nullptr};
+  PeriodicTaskScheduler::TaskId tickTaskId_{0};
+  folly::EventBase* eventBase_{nullptr};
   int efd_{-1};
+  std::vector<T> batch_;
+  size_t lastDrainCount_{0};
+  size_t emptyPolls_{0};
 
   void onEvent() {
     uint64_t value;
     auto res = ::read(efd_, &value, sizeof(value));
     CHECK(res == sizeof(value));
 
-    drain();
+    drainBatch();
+    maybeSchedulePoll();
   }
 
-  void onTimeout() {
-    drain();
+  void onTick() {
+    drainBatch();
+    maybeSchedulePoll();
     notifier_.maybeUpdatePeriod();
+  }
+
+  void onTimeout() {
+    onTick();
     timeoutHandler_.scheduleTimeout(kWakeupEveryMs);
   }
 
+  void onPoll() {
+    drainBatch();
+    maybeSchedulePoll();
+  }
+
+  /**
+   * While the arrival rate is high enough that writers skip per-message
+   * notifications, keep draining the queue on every event loop iteration
+   * (a pending loop callback makes the loop poll instead of blocking).
+   * After kMaxEmptyPolls consecutive empty drains give up and fall back
+   * to eventfd wakeups and the periodic timeout.
+   */
+  void maybeSchedulePoll() {
+    if (eventBase_ == nullptr || notifier_.currentNotifyPeriod() <= 1) {
+      return;
+    }
+    if (lastDrainCount_ > 0) {
+      emptyPolls_ = 0;
+    } else if (++emptyPolls_ >= kMaxEmptyPolls) {
+      return;
+    }
+    if (!drainCallback_.isLoopCallbackScheduled()) {
+      eventBase_->runInLoop(&drainCallback_);
+    }
+  }
+
   void doNotify() {
     assert(efd_ >= 0);
     uint64_t n = 1;
@@ -257,6 +368,19 @@ class MessageQueue {
       notifier_.bumpMessages();
     }
   }
+
+  void drainBatchImpl() {
+    T message;
+    while (queue_.read(message)) {
+      batch_.push_back(std::move(message));
+    }
+    lastDrainCount_ += batch_.size();
+    for (auto& msg : batch_) {
+      onMessage_(std::move(msg));
+      notifier_.bumpMessages();
+    }
+    batch_.clear();
+  }
 };
 
 }}  // facebook::memcache
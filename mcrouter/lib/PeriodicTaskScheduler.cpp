@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "PeriodicTaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <glog/logging.h>
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+/* A task piggybacks on an earlier wakeup if it's within this many ms
+   of being due. */
+int64_t slackMs(uint32_t periodMs) {
+  return periodMs / 8;
+}
+
+}  // anonymous namespace
+
+PeriodicTaskScheduler::PeriodicTaskScheduler(folly::EventBase& evb)
+    : folly::AsyncTimeout(&evb) {
+}
+
+PeriodicTaskScheduler::TaskId PeriodicTaskScheduler::schedule(
+    uint32_t periodMs,
+    std::function<void()> func) {
+
+  auto id = nextId_++;
+  tasks_.push_back(
+    Task{id, periodMs, nowMs() + periodMs, /* cancelled= */ false,
+         std::move(func)});
+  if (!running_) {
+    rearm(nowMs());
+  }
+  return id;
+}
+
+void PeriodicTaskScheduler::updatePeriod(TaskId id, uint32_t periodMs) {
+  for (auto& task : tasks_) {
+    if (task.id == id && !task.cancelled) {
+      task.periodMs = periodMs;
+      task.dueMs = nowMs() + periodMs;
+      break;
+    }
+  }
+  if (!running_) {
+    rearm(nowMs());
+  }
+}
+
+void PeriodicTaskScheduler::cancel(TaskId id) {
+  for (auto& task : tasks_) {
+    if (task.id == id) {
+      task.cancelled = true;
+      break;
+    }
+  }
+  if (running_) {
+    /* timeoutExpired() is iterating tasks_; it will erase after the run. */
+    pendingCancel_ = true;
+  } else {
+    tasks_.erase(
+      std::remove_if(tasks_.begin(), tasks_.end(),
+                     [](const Task& task) { return task.cancelled; }),
+      tasks_.end());
+    rearm(nowMs());
+  }
+}
+
+void PeriodicTaskScheduler::timeoutExpired() noexcept {
+  auto now = nowMs();
+
+  running_ = true;
+  /* Callbacks may schedule() new tasks and reallocate tasks_,
+     so iterate by index. */
+  for (size_t i = 0; i < tasks_.size(); ++i) {
+    if (tasks_[i].cancelled ||
+        tasks_[i].dueMs > now + slackMs(tasks_[i].periodMs)) {
+      continue;
+    }
+    tasks_[i].func();
+    tasks_[i].dueMs = now + tasks_[i].periodMs;
+  }
+  running_ = false;
+
+  if (pendingCancel_) {
+    pendingCancel_ = false;
+    tasks_.erase(
+      std::remove_if(tasks_.begin(), tasks_.end(),
+                     [](const Task& task) { return task.cancelled; }),
+      tasks_.end());
+  }
+
+  rearm(now);
+}
+
+void PeriodicTaskScheduler::rearm(int64_t now) {
+  if (tasks_.empty()) {
+    cancelTimeout();
+    return;
+  }
+  auto nextDue = tasks_.front().dueMs;
+  for (const auto& task : tasks_) {
+    nextDue = std::min(nextDue, task.dueMs);
+  }
+  auto delayMs = std::max<int64_t>(nextDue - now, 1);
+  if (!scheduleTimeout(static_cast<uint32_t>(delayMs))) {
+    LOG(ERROR) << "Failed to schedule periodic task timer";
+  }
+}
+
+int64_t PeriodicTaskScheduler::nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}}  // facebook::memcache
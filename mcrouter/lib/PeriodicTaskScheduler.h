@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Runs small periodic housekeeping tasks off a single timer per event
+ * base.  Each subsystem arming its own folly::AsyncTimeout costs one
+ * kernel timer and its own wakeup stream per thread; registering the
+ * tasks here coalesces them instead: the one timer is armed for the
+ * nearest deadline, and when it fires every task within an eighth of its
+ * own period of being due runs too, so tasks settle into shared wakeups.
+ * On mostly-idle proxies the wakeup rate becomes that of the most
+ * frequent task rather than the sum over all of them.
+ *
+ * Periods are approximate - a task may run up to an eighth of its period
+ * early when piggybacking on another task's wakeup, and arbitrarily late
+ * if the event loop is busy.  Don't register anything that needs exact
+ * scheduling.
+ *
+ * Single-threaded: all methods must be called from the event base
+ * thread, and task callbacks run on it.  Callbacks may call schedule(),
+ * updatePeriod() and cancel(), including for themselves.
+ */
+class PeriodicTaskScheduler : private folly::AsyncTimeout {
+ public:
+  using TaskId = uint64_t;
+
+  explicit PeriodicTaskScheduler(folly::EventBase& evb);
+
+  /**
+   * Registers func to run roughly every periodMs milliseconds, starting
+   * one period from now.
+   *
+   * @return  Id to pass to updatePeriod()/cancel().  Never 0.
+   */
+  TaskId schedule(uint32_t periodMs, std::function<void()> func);
+
+  /**
+   * Changes the period of an existing task; its next run will be one new
+   * period from now.  No-op for unknown (e.g. already cancelled) ids.
+   */
+  void updatePeriod(TaskId id, uint32_t periodMs);
+
+  /**
+   * Unregisters a task.  No-op for unknown ids.  The task will not run
+   * after this returns (a task may cancel itself from its callback).
+   */
+  void cancel(TaskId id);
+
+ private:
+  struct Task {
+    TaskId id;
+    uint32_t periodMs;
+    int64_t dueMs;
+    bool cancelled;
+    std::function<void()> func;
+  };
+
+  void timeoutExpired() noexcept override final;
+  void rearm(int64_t now);
+  static int64_t nowMs();
+
+  std::vector<Task> tasks_;
+  TaskId nextId_{1};
+  // True while timeoutExpired() iterates tasks_; cancellations are
+  // deferred to flags so indexes stay stable under callbacks.
+  bool running_{false};
+  bool pendingCancel_{false};
+};
+
+}}  // facebook::memcache
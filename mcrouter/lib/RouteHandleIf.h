@@ -9,7 +9,10 @@
  */
 #pragma once
 
+#include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "mcrouter/lib/fbi/cpp/TypeList.h"
 #include "mcrouter/lib/Operation.h"
@@ -17,6 +20,96 @@
 
 namespace facebook { namespace memcache {
 
+/**
+ * Depth bound reported by route handles that can't bound the depth of
+ * their subtree.
+ */
+constexpr size_t kUnknownRouteDepth = std::numeric_limits<size_t>::max();
+
+namespace detail {
+
+template <class... Ts>
+struct VoidTImpl {
+  using type = void;
+};
+
+/**
+ * C++11 replacement for std::void_t.
+ */
+template <class... Ts>
+using VoidT = typename VoidTImpl<Ts...>::type;
+
+/**
+ * Forwards mayBlock() to the wrapped route if it provides one;
+ * assumes the route may block otherwise.
+ */
+template <class Route, class = void>
+struct RouteMayBlock {
+  static bool value(const Route&) {
+    return true;
+  }
+};
+
+template <class Route>
+struct RouteMayBlock<
+    Route,
+    VoidT<decltype(std::declval<const Route&>().mayBlock())>> {
+  static bool value(const Route& route) {
+    return route.mayBlock();
+  }
+};
+
+/**
+ * Forwards maxDepth() to the wrapped route if it provides one;
+ * reports an unknown (unbounded) depth otherwise.
+ */
+template <class Route, class = void>
+struct RouteMaxDepth {
+  static size_t value(const Route&) {
+    return kUnknownRouteDepth;
+  }
+};
+
+template <class Route>
+struct RouteMaxDepth<
+    Route,
+    VoidT<decltype(std::declval<const Route&>().maxDepth())>> {
+  static size_t value(const Route& route) {
+    return route.maxDepth();
+  }
+};
+
+/**
+ * Forwards routeBatch() to the wrapped route if it provides one;
+ * falls back to routing each request of the batch individually otherwise.
+ */
+template <class Route, class Request, class = void>
+struct RouteRouteBatch {
+  static std::vector<ReplyT<Request>> value(
+      Route& route, const std::vector<const Request*>& reqs) {
+    std::vector<ReplyT<Request>> replies;
+    replies.reserve(reqs.size());
+    for (const auto* req : reqs) {
+      replies.push_back(route.route(*req));
+    }
+    return replies;
+  }
+};
+
+template <class Route, class Request>
+struct RouteRouteBatch<
+    Route,
+    Request,
+    VoidT<decltype(std::declval<Route&>().routeBatch(
+        std::declval<const std::vector<const Request*>&>()))>> {
+  static std::vector<ReplyT<Request>> value(
+      Route& route, const std::vector<const Request*>& reqs) {
+    return route.routeBatch(reqs);
+  }
+};
+
+} // detail
+
 /**
  * We need the wrapper class below since we can't have templated
  * virtual methods.
@@ -39,6 +132,14 @@ class RouteHandle<Route, RouteHandleIf, List<>> : public RouteHandleIf {
     return route_.routeName();
   }
 
+  bool mayBlock() const {
+    return detail::RouteMayBlock<Route>::value(route_);
+  }
+
+  size_t maxDepth() const {
+    return detail::RouteMaxDepth<Route>::value(route_);
+  }
+
  protected:
   Route route_;
 };
@@ -59,6 +160,7 @@ class RouteHandle<Route, RouteHandleIf, List<Request, Requests...>> :
 
   using RouteHandle<Route, RouteHandleIf, List<Requests...>>::traverse;
   using RouteHandle<Route, RouteHandleIf, List<Requests...>>::route;
+  using RouteHandle<Route, RouteHandleIf, List<Requests...>>::routeBatch;
 
   void traverse(const Request& req,
                 const RouteHandleTraverser<RouteHandleIf>& t) const {
@@ -68,6 +170,11 @@ class RouteHandle<Route, RouteHandleIf, List<Request, Requests...>> :
   ReplyT<Request> route(const Request& req) {
     return this->route_.route(req);
   }
+
+  std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) {
+    return detail::RouteRouteBatch<Route, Request>::value(this->route_, reqs);
+  }
 };
 
 template <typename RouteHandleIf_, typename RequestList>
@@ -84,6 +191,26 @@ class RouteHandleIf<RouteHandleIf_, List<Request>> {
    */
   virtual std::string routeName() const = 0;
 
+  /**
+   * Returns true if routing a request through this subtree may suspend
+   * the calling fiber (e.g. on network I/O).  Conservatively true unless
+   * the wrapped route says otherwise; computed over a fully built tree,
+   * so the answer is fixed for the lifetime of a config.
+   */
+  virtual bool mayBlock() const {
+    return true;
+  }
+
+  /**
+   * Returns an upper bound on the number of route handles on any path
+   * from this subtree's root to a leaf, or kUnknownRouteDepth if the
+   * wrapped route can't bound it.  Like mayBlock(), fixed once the tree
+   * is built.
+   */
+  virtual size_t maxDepth() const {
+    return kUnknownRouteDepth;
+  }
+
   /**
    * Traverses over route handles this route handle could
    * send a request to
@@ -97,6 +224,16 @@ class RouteHandleIf<RouteHandleIf_, List<Request>> {
    */
   virtual ReplyT<Request> route(const Request& req) = 0;
 
+  /**
+   * Routes a batch of requests of the same type through this route handle.
+   * Routes that can hash or dispatch a whole batch at once (e.g. HashRoute)
+   * do so; others route each request individually.
+   *
+   * @return replies in the same order as the requests.
+   */
+  virtual std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) = 0;
+
   virtual ~RouteHandleIf() {}
 };
 
@@ -110,6 +247,7 @@ class RouteHandleIf<RouteHandleIf_, List<Request, Requests...>> :
 
   using RouteHandleIf<RouteHandleIf_, List<Requests...>>::traverse;
   using RouteHandleIf<RouteHandleIf_, List<Requests...>>::route;
+  using RouteHandleIf<RouteHandleIf_, List<Requests...>>::routeBatch;
 
   /**
    * Returns a string identifying this route handle instance (for debugging)
@@ -129,6 +267,14 @@ class RouteHandleIf<RouteHandleIf_, List<Request, Requests...>> :
    */
   virtual ReplyT<Request> route(const Request& req) = 0;
 
+  /**
+   * Routes a batch of requests of the same type through this route handle.
+   *
+   * @return replies in the same order as the requests.
+   */
+  virtual std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) = 0;
+
   virtual ~RouteHandleIf() {}
 };
 
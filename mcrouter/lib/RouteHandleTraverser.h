@@ -15,20 +15,37 @@
 
 namespace facebook { namespace memcache {
 
+class AccessPoint;
+
 /**
  * DFS over RouteHandle tree. Calls StartFunc before entering a node and
- * EndFunc after traversing over children of a node.
+ * EndFunc after traversing over children of a node. Leaf route handles
+ * that talk to a destination additionally report it (together with a
+ * cheap liveness bit read from TKO state) through DestinationFunc.
  */
 template <class RouteHandleIf>
 class RouteHandleTraverser {
  public:
   using StartFunc = std::function<void(const RouteHandleIf& r)>;
   using EndFunc = std::function<void()>;
+  using DestinationFunc =
+      std::function<void(const AccessPoint& dest, bool alive)>;
 
   explicit RouteHandleTraverser(StartFunc start = nullptr,
-                                EndFunc end = nullptr)
+                                EndFunc end = nullptr,
+                                DestinationFunc destination = nullptr)
     : start_(std::move(start)),
-      end_(std::move(end)) {
+      end_(std::move(end)),
+      destination_(std::move(destination)) {
+  }
+
+  /**
+   * Called by leaf route handles during traversal.
+   */
+  void visitDestination(const AccessPoint& dest, bool alive) const {
+    if (destination_) {
+      destination_(dest, alive);
+    }
   }
 
   template <class Request>
@@ -53,6 +70,7 @@ class RouteHandleTraverser {
  private:
   StartFunc start_;
   EndFunc end_;
+  DestinationFunc destination_;
 };
 
 }}  // facebook::memcache
@@ -9,7 +9,10 @@
  */
 #include "WeightedCh3HashFunc.h"
 
+#include <map>
+
 #include <folly/dynamic.h>
+#include <folly/SharedMutex.h>
 #include <folly/SpookyHashV2.h>
 
 #include "mcrouter/lib/fbi/cpp/util.h"
@@ -20,12 +23,10 @@ namespace facebook { namespace memcache {
 namespace {
 const size_t kNumTries = 32;
 const uint32_t kHashSeed = 0xface2014;
-}  // anonymous namespace
-
-size_t weightedCh3Hash(
-  folly::StringPiece key, const std::vector<double>& weights) {
 
-  auto n = weights.size();
+template <class ThresholdFunc>
+size_t weightedCh3HashImpl(folly::StringPiece key, size_t n,
+                           ThresholdFunc&& threshold) {
   checkLogic(n && n <= furc_maximum_pool_size(), "Invalid pool size: {}", n);
   size_t salt = 0;
   size_t index = 0;
@@ -38,8 +39,7 @@ size_t weightedCh3Hash(
        we don't have to deal with overflows */
     uint64_t p = folly::hash::SpookyHashV2::Hash32(key.data(), key.size(),
                                                    kHashSeed);
-    assert(0 <= weights[index] && weights[index] <= 1.0);
-    uint64_t w = weights[index] * std::numeric_limits<uint32_t>::max();
+    uint64_t w = threshold(index);
 
     /* Rehash only if p is out of range */
     if (LIKELY(p < w)) {
@@ -59,31 +59,142 @@ size_t weightedCh3Hash(
 
   return index;
 }
+}  // anonymous namespace
 
-WeightedCh3HashFunc::WeightedCh3HashFunc(std::vector<double> weights)
+size_t weightedCh3Hash(
+  folly::StringPiece key, const std::vector<double>& weights) {
+
+  return weightedCh3HashImpl(key, weights.size(), [&weights](size_t index) {
+    assert(0 <= weights[index] && weights[index] <= 1.0);
+    return uint64_t(weights[index] * std::numeric_limits<uint32_t>::max());
+  });
+}
+
+size_t weightedCh3Hash(folly::StringPiece key, const WeightedCh3Ring& ring) {
+  return weightedCh3HashImpl(key, ring.size(), [&ring](size_t index) {
+    return ring.threshold(index);
+  });
+}
+
+WeightedCh3Ring::WeightedCh3Ring(std::vector<double> weights)
     : weights_(std::move(weights)) {
+  thresholds_.reserve(weights_.size());
+  for (auto weight : weights_) {
+    assert(0 <= weight && weight <= 1.0);
+    thresholds_.push_back(weight * std::numeric_limits<uint32_t>::max());
+  }
+}
+
+std::shared_ptr<const WeightedCh3Ring> WeightedCh3Ring::get(
+    std::vector<double> weights) {
+  static folly::SharedMutex cacheLock;
+  static std::map<std::vector<double>,
+                  std::weak_ptr<const WeightedCh3Ring>> cache;
+
+  {
+    folly::SharedMutex::ReadHolder lock(cacheLock);
+    auto it = cache.find(weights);
+    if (it != cache.end()) {
+      if (auto ring = it->second.lock()) {
+        return ring;
+      }
+    }
+  }
+
+  std::shared_ptr<const WeightedCh3Ring> ring(
+    new WeightedCh3Ring(std::move(weights)));
+
+  folly::SharedMutex::WriteHolder lock(cacheLock);
+  auto& entry = cache[ring->weights()];
+  if (auto existing = entry.lock()) {
+    // Some other thread built the same snapshot while we were working.
+    return existing;
+  }
+  entry = ring;
+  // Drop entries whose snapshots were freed on previous config swaps.
+  for (auto it = cache.begin(); it != cache.end();) {
+    it = it->second.expired() ? cache.erase(it) : std::next(it);
+  }
+  return ring;
 }
 
-WeightedCh3HashFunc::WeightedCh3HashFunc(const folly::dynamic& json, size_t n) {
+std::shared_ptr<const WeightedCh3Ring> WeightedCh3Ring::fromJson(
+    const folly::dynamic& json, size_t n, folly::StringPiece funcName) {
   checkLogic(json.isObject() && json.count("weights"),
-             "WeightedCh3HashFunc: not an object or no weights");
+             "{}: not an object or no weights", funcName);
   checkLogic(json["weights"].isArray(),
-             "WeightedCh3HashFunc: weights is not array");
+             "{}: weights is not array", funcName);
   const auto& jWeights = json["weights"];
   LOG_IF(ERROR, jWeights.size() < n)
-    << "WeightedCh3HashFunc: CONFIG IS BROKEN!!! number of weights ("
+    << funcName << ": CONFIG IS BROKEN!!! number of weights ("
     << jWeights.size() << ") is smaller than number of servers (" << n
     << "). Missing weights are set to 0.5";
+  std::vector<double> weights;
   for (size_t i = 0; i < std::min(n, jWeights.size()); ++i) {
     const auto& weight = jWeights[i];
-    checkLogic(weight.isNumber(), "WeightedCh3HashFunc: weight is not number");
-    weights_.push_back(weight.asDouble());
+    checkLogic(weight.isNumber(), "{}: weight is not number", funcName);
+    weights.push_back(weight.asDouble());
+  }
+  weights.resize(n, 0.5);
+  return get(std::move(weights));
+}
+
+WeightedCh3RingSlot::WeightedCh3RingSlot(
+    std::shared_ptr<const WeightedCh3Ring> ring)
+    : ring_(std::move(ring)) {
+  assert(ring_);
+}
+
+std::shared_ptr<const WeightedCh3Ring> WeightedCh3RingSlot::ring() const {
+  folly::SharedMutex::ReadHolder lock(lock_);
+  return ring_;
+}
+
+void WeightedCh3RingSlot::setWeights(std::vector<double> weights) {
+  {
+    folly::SharedMutex::ReadHolder lock(lock_);
+    checkLogic(weights.size() == ring_->size(),
+               "WeightedCh3RingSlot: got {} weights for a pool of {}",
+               weights.size(), ring_->size());
   }
-  weights_.resize(n, 0.5);
+  for (auto weight : weights) {
+    checkLogic(0 <= weight && weight <= 1.0,
+               "WeightedCh3RingSlot: weight {} is out of [0.0, 1.0]", weight);
+  }
+  auto ring = WeightedCh3Ring::get(std::move(weights));
+  {
+    folly::SharedMutex::WriteHolder lock(lock_);
+    ring_ = std::move(ring);
+  }
+  /* Publish after the ring is in place so readers that see the new
+     version never load a stale ring twice. */
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+WeightedCh3HashFunc::WeightedCh3HashFunc(std::vector<double> weights)
+    : ring_(WeightedCh3Ring::get(std::move(weights))) {
+}
+
+WeightedCh3HashFunc::WeightedCh3HashFunc(const folly::dynamic& json, size_t n)
+    : ring_(WeightedCh3Ring::fromJson(json, n, "WeightedCh3HashFunc")) {
+}
+
+WeightedCh3HashFunc::WeightedCh3HashFunc(
+    std::shared_ptr<WeightedCh3RingSlot> slot)
+    : ring_(slot->ring()),
+      slot_(std::move(slot)),
+      seenVersion_(slot_->version()) {
 }
 
 size_t WeightedCh3HashFunc::operator()(folly::StringPiece key) const {
-  return weightedCh3Hash(key, weights_);
+  if (slot_) {
+    const auto version = slot_->version();
+    if (UNLIKELY(version != seenVersion_)) {
+      ring_ = slot_->ring();
+      seenVersion_ = version;
+    }
+  }
+  return weightedCh3Hash(key, *ring_);
 }
 
 }}  // facebook::memcache
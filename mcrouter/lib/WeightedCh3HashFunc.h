@@ -9,9 +9,12 @@
  */
 #pragma once
 
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include <folly/Range.h>
+#include <folly/SharedMutex.h>
 
 namespace folly {
 struct dynamic;
@@ -48,9 +51,109 @@ namespace facebook { namespace memcache {
  * at 1 being perfectly consistent
  */
 
+/**
+ * Read-only snapshot of a weighted Ch3 pool: the server weights together
+ * with precomputed acceptance thresholds (weight scaled to the 32-bit hash
+ * space), packed into a flat array so the per-try weight check is a single
+ * table probe.
+ *
+ * Snapshots are interned: route trees built from the same config by
+ * different proxy threads share one instance per distinct weight vector, so
+ * config memory doesn't scale with the number of proxy threads. A snapshot
+ * is freed when the last route handle referencing it goes away, i.e. with
+ * the usual config swap.
+ */
+class WeightedCh3Ring {
+ public:
+  /**
+   * Returns a shared snapshot for given weights, reusing a live one if some
+   * route tree already built it.
+   */
+  static std::shared_ptr<const WeightedCh3Ring> get(
+    std::vector<double> weights);
+
+  /**
+   * Parses the standard {"weights": [...]} json for a pool of n servers
+   * (missing weights are set to 0.5) and returns a shared snapshot.
+   *
+   * @param funcName name to report in parse errors,
+   *                 e.g. "WeightedCh3HashFunc".
+   */
+  static std::shared_ptr<const WeightedCh3Ring> fromJson(
+    const folly::dynamic& json, size_t n, folly::StringPiece funcName);
+
+  /**
+   * @return Original weights.
+   */
+  const std::vector<double>& weights() const {
+    return weights_;
+  }
+
+  /**
+   * Pool size.
+   */
+  size_t size() const {
+    return thresholds_.size();
+  }
+
+  /**
+   * Acceptance threshold for given index.
+   */
+  uint64_t threshold(size_t index) const {
+    return thresholds_[index];
+  }
+
+ private:
+  std::vector<double> weights_;
+  std::vector<uint64_t> thresholds_;
+
+  explicit WeightedCh3Ring(std::vector<double> weights);
+};
+
+/**
+ * Shared, swappable reference to a WeightedCh3Ring.
+ *
+ * A slot lets weights change at runtime (e.g. draining a destination via a
+ * runtime-vars push) without rebuilding the route trees: every
+ * WeightedCh3HashFunc built from the same slot picks up a new ring on its
+ * next call. Swaps publish a new version number, so the readers' fast path
+ * is a single relaxed load; the lock is only taken on an actual change.
+ */
+class WeightedCh3RingSlot {
+ public:
+  explicit WeightedCh3RingSlot(std::shared_ptr<const WeightedCh3Ring> ring);
+
+  /**
+   * Version of the current ring; bumped on every swap.
+   */
+  uint64_t version() const {
+    return version_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the current ring snapshot.
+   */
+  std::shared_ptr<const WeightedCh3Ring> ring() const;
+
+  /**
+   * Replaces the ring with one built from the given weights.
+   *
+   * @throws std::logic_error if the number of weights doesn't match the
+   *         pool size or any weight is outside [0.0, 1.0].
+   */
+  void setWeights(std::vector<double> weights);
+
+ private:
+  mutable folly::SharedMutex lock_;
+  std::shared_ptr<const WeightedCh3Ring> ring_;
+  std::atomic<uint64_t> version_{1};
+};
+
 size_t weightedCh3Hash(
   folly::StringPiece key, const std::vector<double>& weights);
 
+size_t weightedCh3Hash(folly::StringPiece key, const WeightedCh3Ring& ring);
+
 class WeightedCh3HashFunc {
  public:
   /**
@@ -61,13 +164,21 @@ class WeightedCh3HashFunc {
 
   WeightedCh3HashFunc(const folly::dynamic& json, size_t n);
 
+  /**
+   * Hash function with live weights, read through the given slot. Each
+   * copy of the func caches the slot's current ring and refreshes it when
+   * the slot's version changes, so a copy must only be used from one
+   * thread at a time (true for route handles, which are per proxy thread).
+   */
+  explicit WeightedCh3HashFunc(std::shared_ptr<WeightedCh3RingSlot> slot);
+
   size_t operator()(folly::StringPiece key) const;
 
   /**
    * @return Saved weights.
    */
   const std::vector<double>& weights() const {
-    return weights_;
+    return ring_->weights();
   }
 
   static const char* type() {
@@ -75,7 +186,9 @@ class WeightedCh3HashFunc {
   }
 
  private:
-  std::vector<double> weights_;
+  mutable std::shared_ptr<const WeightedCh3Ring> ring_;
+  std::shared_ptr<WeightedCh3RingSlot> slot_;
+  mutable uint64_t seenVersion_{0};
 };
 
 }}  // facebook::memcache
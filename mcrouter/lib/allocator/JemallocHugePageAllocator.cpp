@@ -0,0 +1,145 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "JemallocHugePageAllocator.h"
+
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+
+#include <algorithm>
+#include <array>
+#include <folly/Conv.h>
+#include <glog/logging.h>
+
+namespace facebook { namespace memcache {
+
+chunk_alloc_t* JemallocHugePageAllocator::original_chunk_alloc_ = {nullptr};
+chunk_dalloc_t* JemallocHugePageAllocator::original_chunk_dalloc_ = {nullptr};
+std::atomic<uint64_t> JemallocHugePageAllocator::advised_bytes_{0};
+
+constexpr size_t JemallocHugePageAllocator::kHugePageSize;
+
+JemallocHugePageAllocator::JemallocHugePageAllocator() {
+  extend_and_setup_arena();
+  LOG(INFO) << "Set up hugepage arena: " << arena_index_;
+}
+
+void JemallocHugePageAllocator::extend_and_setup_arena() {
+    size_t len = sizeof(arena_index_);
+    int retval = mallctl("arenas.extend", &arena_index_, &len, nullptr, 0);
+    if (retval != 0) {
+      std::array<char, 128> buf;
+      LOG(FATAL) << "Unable to extend arena: "
+                 << strerror_r(retval, buf.data(), buf.size());
+      return;
+    }
+    flags_ = MALLOCX_ARENA(arena_index_) | MALLOCX_TCACHE_NONE;
+
+    // Set the custom alloc hook
+    const auto str = folly::to<std::string>("arena.",
+                                            arena_index_,
+                                            ".chunk_hooks");
+    chunk_hooks_t hooks;
+    len = sizeof(hooks);
+    // Read the existing hooks
+    retval = mallctl(str.c_str(), &hooks, &len, nullptr, 0);
+    if (retval != 0) {
+      std::array<char, 128> buf;
+      LOG(FATAL) << "Unable to get the hooks: "
+                 << strerror_r(retval, buf.data(), buf.size());
+      return;
+    }
+    if (nullptr == original_chunk_alloc_) {
+      original_chunk_alloc_ = hooks.alloc;
+    } else {
+      DCHECK(original_chunk_alloc_ == hooks.alloc);
+    }
+    if (nullptr == original_chunk_dalloc_) {
+      original_chunk_dalloc_ = hooks.dalloc;
+    } else {
+      DCHECK(original_chunk_dalloc_ == hooks.dalloc);
+    }
+
+    // Set the custom hooks. dalloc is wrapped only so the advised-bytes
+    // accounting stays correct when chunks are returned to the OS.
+    hooks.alloc = &JemallocHugePageAllocator::chunk_alloc;
+    hooks.dalloc = &JemallocHugePageAllocator::chunk_dalloc;
+    retval = mallctl(str.c_str(), nullptr, nullptr, &hooks, sizeof(hooks));
+    if (retval != 0) {
+      std::array<char, 128> buf;
+      LOG(FATAL) << "Unable to set the hooks: "
+                 << strerror_r(retval, buf.data(), buf.size());
+      return;
+    }
+}
+
+JemallocHugePageAllocator::~JemallocHugePageAllocator() {
+}
+
+void* JemallocHugePageAllocator::allocate(const size_t size) {
+  return mallocx(size, flags_);
+}
+
+void* JemallocHugePageAllocator::reallocate(void* p, const size_t size) {
+  return rallocx(p, size, flags_);
+}
+
+void* JemallocHugePageAllocator::chunk_alloc(void* chunk,
+                                             size_t size,
+                                             size_t alignment,
+                                             bool* zero,
+                                             bool* commit,
+                                             unsigned arena_ind) {
+  // THP only promotes regions that cover whole aligned 2MB extents, so
+  // make sure the chunk starts on a hugepage boundary.
+  alignment = std::max(alignment, kHugePageSize);
+  void* retval = original_chunk_alloc_(chunk,
+                                       size,
+                                       alignment,
+                                       zero,
+                                       commit,
+                                       arena_ind);
+  if (retval != nullptr) {
+    const int rc = madvise(retval, size, MADV_HUGEPAGE);
+    if (rc) {
+      std::array<char, 128> buf;
+      LOG(WARNING) << "Unable to set MADV_HUGEPAGE on : " << retval << ", "
+                   << strerror_r(rc, buf.data(), buf.size());
+    } else {
+      advised_bytes_.fetch_add(size, std::memory_order_relaxed);
+    }
+  }
+
+  return retval;
+}
+
+void JemallocHugePageAllocator::deallocate(void* p) {
+  dallocx(p, flags_);
+}
+
+void JemallocHugePageAllocator::deallocate(void* p, void* userData) {
+  const uint64_t flags = reinterpret_cast<uint64_t> (userData);
+  dallocx(p, flags);
+}
+
+bool JemallocHugePageAllocator::chunk_dalloc(void* chunk,
+                                             size_t size,
+                                             bool committed,
+                                             unsigned arena_ind) {
+  const bool retval = original_chunk_dalloc_(chunk, size, committed, arena_ind);
+  if (!retval) {
+    /* false means the chunk was actually deallocated (jemalloc convention),
+       which drops the madvise along with the mapping. */
+    advised_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  }
+  return retval;
+}
+
+}}  // facebook::memcache
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(FOLLY_SANITIZE_ADDRESS) && \
+  (JEMALLOC_VERSION_MAJOR > 3) && \
+  defined(MADV_HUGEPAGE)
+  #define CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+#endif
+
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+
+#include <atomic>
+
+#include <jemalloc/jemalloc.h>
+#include <sys/mman.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * An allocator which uses Jemalloc to create a dedicated arena to allocate
+ * memory from, in the same spirit as JemallocNodumpAllocator. The custom
+ * chunk hook calls the original jemalloc hook with the alignment raised to
+ * 2MB and then sets MADV_HUGEPAGE on the chunk, asking the kernel to back
+ * it with transparent hugepages. Allocations served from this arena thus
+ * share 2MB TLB entries instead of 4KB ones. The advice applies per chunk,
+ * so even allocations smaller than a hugepage benefit as long as they are
+ * packed into the same chunk. As with the nodump arena, the advice is
+ * dropped when jemalloc `munmap`s the chunk, and the arena is not reachable
+ * via plain `malloc`.
+ */
+class JemallocHugePageAllocator {
+ public:
+  /// Transparent hugepage size on x86-64.
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  JemallocHugePageAllocator();
+  ~JemallocHugePageAllocator();
+
+  void* allocate(const size_t size);
+  void* reallocate(void* p, const size_t size);
+  void deallocate(void* p);
+
+  static void deallocate(void* p, void* userData);
+  unsigned getArenaIndex() const { return arena_index_; }
+  int getFlags() const { return flags_; }
+
+  static chunk_alloc_t* getOriginalChunkAlloc() {
+    return original_chunk_alloc_;
+  }
+
+  /**
+   * Total bytes of chunks currently carrying the MADV_HUGEPAGE advice,
+   * across all hugepage arenas in the process. This is the amount of
+   * address space eligible for hugepage backing; see the
+   * ps_anon_huge_pages stat for how much the kernel actually promoted.
+   */
+  static uint64_t advisedBytes() {
+    return advised_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static chunk_alloc_t* original_chunk_alloc_;
+  static chunk_dalloc_t* original_chunk_dalloc_;
+  static std::atomic<uint64_t> advised_bytes_;
+  static void* chunk_alloc(void* chunk,
+                           size_t size,
+                           size_t alignment,
+                           bool* zero,
+                           bool* commit,
+                           unsigned arena_ind);
+  static bool chunk_dalloc(void* chunk,
+                           size_t size,
+                           bool committed,
+                           unsigned arena_ind);
+
+  void extend_and_setup_arena();
+
+  unsigned arena_index_{0};
+  int flags_{0};
+};
+
+}}  // facebook::memcache
+
+#endif
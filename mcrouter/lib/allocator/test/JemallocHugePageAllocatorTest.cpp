@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "mcrouter/lib/allocator/JemallocHugePageAllocator.h"
+
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+
+#include <gtest/gtest.h>
+#include <folly/io/IOBuf.h>
+
+using namespace testing;
+
+using facebook::memcache::JemallocHugePageAllocator;
+
+class JemallocHugePageAllocatorTest : public Test {
+ protected:
+  JemallocHugePageAllocator jhpa;
+};
+
+TEST_F(JemallocHugePageAllocatorTest, basic) {
+  EXPECT_NE(nullptr, JemallocHugePageAllocator::getOriginalChunkAlloc());
+  void* ptr = jhpa.allocate(64 * 1024);
+  EXPECT_NE(nullptr, ptr);
+  /* The backing chunk was advised, whatever the kernel does with it. */
+  EXPECT_GE(JemallocHugePageAllocator::advisedBytes(),
+            JemallocHugePageAllocator::kHugePageSize);
+  jhpa.deallocate(ptr);
+}
+
+TEST_F(JemallocHugePageAllocatorTest, folly) {
+  const size_t size{64 * 1024};
+  void* ptr = jhpa.allocate(size);
+  EXPECT_NE(nullptr, ptr);
+  folly::IOBuf ioBuf(folly::IOBuf::TAKE_OWNERSHIP,
+                     ptr,
+                     size,
+                     0 /* length */,
+                     JemallocHugePageAllocator::deallocate,
+                     reinterpret_cast<void*>(jhpa.getFlags()));
+  EXPECT_EQ(size, ioBuf.capacity());
+  uint8_t* data = ioBuf.writableData();
+  EXPECT_EQ(ptr, data);
+  for (auto i = 0u; i < ioBuf.capacity(); ++i) {
+    data[i] = 'A';
+  }
+  uint8_t* p = static_cast<uint8_t*> (ptr);
+  for (auto i = 0u; i < size; ++i) {
+    EXPECT_EQ('A', p[i]);
+  }
+}
+#endif
@@ -0,0 +1,280 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CompiledConfigCache.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <folly/FileUtil.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+constexpr folly::StringPiece kMagic = "MCRC";
+constexpr uint32_t kVersion = 1;
+// digest recorded when @import of a path threw during expansion
+constexpr folly::StringPiece kImportFailedDigest = "<failed>";
+
+enum class Tag : uint8_t {
+  Null = 0,
+  BoolFalse = 1,
+  BoolTrue = 2,
+  Int = 3,
+  Double = 4,
+  String = 5,
+  Array = 6,
+  Object = 7
+};
+
+void appendRaw(const void* data, size_t size, std::string& out) {
+  out.append(reinterpret_cast<const char*>(data), size);
+}
+
+void appendUint32(uint32_t value, std::string& out) {
+  appendRaw(&value, sizeof(value), out);
+}
+
+void appendString(folly::StringPiece str, std::string& out) {
+  checkRuntime(str.size() <= std::numeric_limits<uint32_t>::max(),
+               "Compiled config string is too long");
+  appendUint32(str.size(), out);
+  appendRaw(str.data(), str.size(), out);
+}
+
+void encode(const folly::dynamic& json, std::string& out) {
+  if (json.isNull()) {
+    out.push_back(static_cast<char>(Tag::Null));
+  } else if (json.isBool()) {
+    out.push_back(static_cast<char>(
+      json.getBool() ? Tag::BoolTrue : Tag::BoolFalse));
+  } else if (json.isInt()) {
+    out.push_back(static_cast<char>(Tag::Int));
+    auto value = json.getInt();
+    appendRaw(&value, sizeof(value), out);
+  } else if (json.isDouble()) {
+    out.push_back(static_cast<char>(Tag::Double));
+    auto value = json.getDouble();
+    appendRaw(&value, sizeof(value), out);
+  } else if (json.isString()) {
+    out.push_back(static_cast<char>(Tag::String));
+    appendString(json.stringPiece(), out);
+  } else if (json.isArray()) {
+    out.push_back(static_cast<char>(Tag::Array));
+    appendUint32(json.size(), out);
+    for (const auto& item : json) {
+      encode(item, out);
+    }
+  } else { // object
+    out.push_back(static_cast<char>(Tag::Object));
+    appendUint32(json.size(), out);
+    for (const auto& item : json.items()) {
+      encode(item.first, out);
+      encode(item.second, out);
+    }
+  }
+}
+
+/**
+ * Cursor over the cache file contents. All reads are bounds checked and
+ * throw std::runtime_error on truncated input.
+ */
+class Reader {
+ public:
+  explicit Reader(folly::StringPiece buf)
+    : buf_(buf) {
+  }
+
+  uint8_t readByte() {
+    require(1);
+    uint8_t value = buf_[0];
+    buf_.advance(1);
+    return value;
+  }
+
+  uint32_t readUint32() {
+    uint32_t value;
+    readRaw(&value, sizeof(value));
+    return value;
+  }
+
+  folly::StringPiece readBytes(size_t size) {
+    require(size);
+    auto result = buf_.subpiece(0, size);
+    buf_.advance(size);
+    return result;
+  }
+
+  folly::StringPiece readString() {
+    return readBytes(readUint32());
+  }
+
+  void readRaw(void* data, size_t size) {
+    require(size);
+    memcpy(data, buf_.data(), size);
+    buf_.advance(size);
+  }
+
+  folly::StringPiece rest() const {
+    return buf_;
+  }
+
+  bool atEnd() const {
+    return buf_.empty();
+  }
+
+ private:
+  folly::StringPiece buf_;
+
+  void require(size_t size) {
+    if (buf_.size() < size) {
+      throw std::runtime_error("Compiled config is truncated");
+    }
+  }
+};
+
+folly::dynamic decode(Reader& in) {
+  switch (static_cast<Tag>(in.readByte())) {
+    case Tag::Null:
+      return nullptr;
+    case Tag::BoolFalse:
+      return false;
+    case Tag::BoolTrue:
+      return true;
+    case Tag::Int: {
+      int64_t value;
+      in.readRaw(&value, sizeof(value));
+      return value;
+    }
+    case Tag::Double: {
+      double value;
+      in.readRaw(&value, sizeof(value));
+      return value;
+    }
+    case Tag::String:
+      return in.readString();
+    case Tag::Array: {
+      auto size = in.readUint32();
+      folly::dynamic result = folly::dynamic::array;
+      for (uint32_t i = 0; i < size; ++i) {
+        result.push_back(decode(in));
+      }
+      return result;
+    }
+    case Tag::Object: {
+      auto size = in.readUint32();
+      folly::dynamic result = folly::dynamic::object();
+      for (uint32_t i = 0; i < size; ++i) {
+        auto key = decode(in);
+        result.insert(std::move(key), decode(in));
+      }
+      return result;
+    }
+  }
+  throw std::runtime_error("Compiled config has unknown type tag");
+}
+
+std::string importDigest(ImportResolverIf& importResolver,
+                         folly::StringPiece path) {
+  try {
+    return Md5Hash(importResolver.import(path));
+  } catch (const std::exception&) {
+    return kImportFailedDigest.str();
+  }
+}
+
+} // anonymous
+
+std::string TrackingImportResolver::import(folly::StringPiece path) {
+  try {
+    auto content = inner_.import(path);
+    importDigests_.emplace_back(path.str(), Md5Hash(content));
+    return content;
+  } catch (const std::exception&) {
+    importDigests_.emplace_back(path.str(), kImportFailedDigest.str());
+    throw;
+  }
+}
+
+folly::Optional<folly::dynamic> loadCompiledConfig(
+    const std::string& path,
+    folly::StringPiece sourceDigest,
+    ImportResolverIf& importResolver) {
+  std::string buf;
+  if (!folly::readFile(path.data(), buf)) {
+    return folly::none;
+  }
+
+  try {
+    Reader in(buf);
+    if (in.readBytes(kMagic.size()) != kMagic ||
+        in.readUint32() != kVersion ||
+        in.readString() != sourceDigest) {
+      return folly::none;
+    }
+
+    auto numImports = in.readUint32();
+    for (uint32_t i = 0; i < numImports; ++i) {
+      auto importPath = in.readString();
+      auto digest = in.readString();
+      if (importDigest(importResolver, importPath) != digest) {
+        return folly::none;
+      }
+    }
+
+    auto payloadDigest = in.readString();
+    auto payload = in.rest();
+    if (Md5Hash(payload) != payloadDigest) {
+      return folly::none;
+    }
+
+    Reader payloadIn(payload);
+    auto result = decode(payloadIn);
+    if (!payloadIn.atEnd()) {
+      return folly::none;
+    }
+    return result;
+  } catch (const std::exception&) {
+    // corrupted cache, fall back to the JSON path
+    return folly::none;
+  }
+}
+
+bool storeCompiledConfig(
+    const std::string& path,
+    folly::StringPiece sourceDigest,
+    const ImportDigests& importDigests,
+    const folly::dynamic& config) {
+  try {
+    std::string payload;
+    encode(config, payload);
+
+    std::string out;
+    appendRaw(kMagic.data(), kMagic.size(), out);
+    appendUint32(kVersion, out);
+    appendString(sourceDigest, out);
+    appendUint32(importDigests.size(), out);
+    for (const auto& it : importDigests) {
+      appendString(it.first, out);
+      appendString(it.second, out);
+    }
+    appendString(Md5Hash(payload), out);
+    out += payload;
+
+    return atomicallyWriteFileToDisk(out, path);
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+}} // facebook::memcache
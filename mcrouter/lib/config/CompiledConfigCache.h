@@ -0,0 +1,82 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/dynamic.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+
+#include "mcrouter/lib/config/ImportResolverIf.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * Digests of files loaded via @import while expanding a config:
+ * (path passed to @import, md5 of imported content) pairs.
+ */
+using ImportDigests = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * ImportResolverIf wrapper that records the digest of every imported
+ * file, so a compiled config cache can later detect stale imports.
+ */
+class TrackingImportResolver : public ImportResolverIf {
+ public:
+  explicit TrackingImportResolver(ImportResolverIf& inner)
+    : inner_(inner) {
+  }
+
+  std::string import(folly::StringPiece path) override final;
+
+  const ImportDigests& importDigests() const {
+    return importDigests_;
+  }
+
+ private:
+  ImportResolverIf& inner_;
+  ImportDigests importDigests_;
+};
+
+/**
+ * Loads a config stored by storeCompiledConfig, skipping JSON parsing
+ * and macro expansion. The cache is valid only if it was written by the
+ * same format version, from sources with the same digest, and every
+ * file it imported still has the same content. Imports are re-resolved
+ * through importResolver for validation, which also re-registers them
+ * with source tracking.
+ *
+ * @param path cache file path
+ * @param sourceDigest digest of config source and global params
+ * @param importResolver resolves @import paths recorded in the cache
+ *
+ * @return expanded config on cache hit, folly::none otherwise
+ */
+folly::Optional<folly::dynamic> loadCompiledConfig(
+    const std::string& path,
+    folly::StringPiece sourceDigest,
+    ImportResolverIf& importResolver);
+
+/**
+ * Atomically writes the expanded config to a versioned binary cache
+ * file, together with the digests needed to validate it on load.
+ *
+ * @return true on success, false otherwise
+ */
+bool storeCompiledConfig(
+    const std::string& path,
+    folly::StringPiece sourceDigest,
+    const ImportDigests& importDigests,
+    const folly::dynamic& config);
+
+}} // facebook::memcache
@@ -306,10 +306,12 @@ class ConfigPreprocessor::Macro {
         StringPiece name,
         const vector<dynamic>& params,
         Func f,
-        bool autoExpand = true)
+        bool autoExpand = true,
+        bool cacheResults = false)
     : prep_(prep),
       f_(std::move(f)),
       autoExpand_(autoExpand),
+      cacheResults_(cacheResults && autoExpand),
       name_(name) {
 
     initParams(params);
@@ -325,11 +327,16 @@ class ConfigPreprocessor::Macro {
                "Too many arguments for macro {}. Expected at most {} got {}",
                name_, maxParamCnt_, params.size());
 
+    dynamic argsKey = dynamic::object();
     Context result(Context::Extended, ctx, /* base */ true);
     for (size_t i = 0; i < params.size(); i++) {
       if (autoExpand_) {
-        result.addExpanded(std::get<0>(params_[i]),
-                           prep_.expandStringMacro(params[i], ctx));
+        const auto& value =
+          result.addExpanded(std::get<0>(params_[i]),
+                             prep_.expandStringMacro(params[i], ctx));
+        if (cacheResults_) {
+          argsKey[std::get<0>(params_[i])] = value;
+        }
       } else {
         result.addRaw(std::get<0>(params_[i]), params[i]);
       }
@@ -338,12 +345,16 @@ class ConfigPreprocessor::Macro {
     for (size_t i = params.size(); i < params_.size(); i++) {
       if (!std::get<1>(params_[i]).isNull()) {
         result.addExpanded(std::get<0>(params_[i]), std::get<1>(params_[i]));
+        if (cacheResults_) {
+          argsKey[std::get<0>(params_[i])] = std::get<1>(params_[i]);
+        }
       }
     }
-    return f_(std::move(result));
+    return callFunc(std::move(result), argsKey);
   }
 
   dynamic getResult(dynamic&& obj, const Context& ctx) const {
+    dynamic argsKey = dynamic::object();
     Context result(Context::Extended, ctx, /* base */ true);
     for (const auto& p : params_) {
       auto it = obj.get_ptr(std::get<0>(p));
@@ -353,29 +364,67 @@ class ConfigPreprocessor::Macro {
                    name_, std::get<0>(p));
         if (!std::get<1>(p).isNull()) {
           result.addExpanded(std::get<0>(p), std::get<1>(p));
+          if (cacheResults_) {
+            argsKey[std::get<0>(p)] = std::get<1>(p);
+          }
         }
       } else {
         if (autoExpand_) {
-          result.addExpanded(std::get<0>(p),
-                             prep_.expandMacros(std::move(*it), ctx));
+          const auto& value =
+            result.addExpanded(std::get<0>(p),
+                               prep_.expandMacros(std::move(*it), ctx));
+          if (cacheResults_) {
+            argsKey[std::get<0>(p)] = value;
+          }
         } else {
           result.addRaw(std::get<0>(p), std::move(*it));
         }
       }
     }
-    return f_(std::move(result));
+    return callFunc(std::move(result), argsKey);
   }
 
  private:
   const ConfigPreprocessor& prep_;
   Func f_;
   bool autoExpand_{true};
+  bool cacheResults_{false};
+  // expansion results of this macro keyed by serialized argument values
+  mutable folly::StringKeyedUnorderedMap<dynamic> resultCache_;
   // name, default, required?
   vector<std::tuple<string, dynamic, bool>> params_;
   size_t maxParamCnt_{0};
   size_t minParamCnt_{0};
   StringPiece name_;
 
+  /**
+   * Invokes the macro function. Identical calls of a user-defined macro are
+   * expanded once and memoized: the result depends only on argument values,
+   * unless a built-in that consults outside state (e.g. @shuffle, @defined)
+   * runs during expansion, in which case cacheableScope_ is cleared and the
+   * result is not cached.
+   */
+  dynamic callFunc(Context&& ctx, const dynamic& argsKey) const {
+    if (!cacheResults_) {
+      return f_(std::move(ctx));
+    }
+
+    auto key = folly::toJson(argsKey);
+    auto cacheIt = resultCache_.find(StringPiece(key));
+    if (cacheIt != resultCache_.end()) {
+      return cacheIt->second;
+    }
+
+    bool outerCacheable = prep_.cacheableScope_;
+    prep_.cacheableScope_ = true;
+    auto result = f_(std::move(ctx));
+    if (prep_.cacheableScope_) {
+      resultCache_.emplace(StringPiece(key), result);
+    }
+    prep_.cacheableScope_ = outerCacheable && prep_.cacheableScope_;
+    return result;
+  }
+
   void initParams(const vector<dynamic>& params) {
     maxParamCnt_ = minParamCnt_ = params.size();
     bool needOptional = false;
@@ -667,6 +716,8 @@ class ConfigPreprocessor::BuiltIns {
    * Returns list or object with randomly shuffled items.
    */
   static dynamic shuffleMacro(Context&& ctx) {
+    // random result, macros expanding it can not be memoized
+    ctx.prep().cacheableScope_ = false;
     auto dictionary = ctx.move("dictionary");
 
     checkLogic(dictionary.isObject() || dictionary.isArray(),
@@ -1133,6 +1184,8 @@ class ConfigPreprocessor::BuiltIns {
    * => true for mcrouter config
    */
   static dynamic definedMacro(Context&& ctx) {
+    // result depends on the calling context, not only on arguments
+    ctx.prep().cacheableScope_ = false;
     auto name = asStringPiece(ctx.at("name"), "Defined: name");
     auto& consts = ctx.prep().consts_;
     return (ctx.outer() && ctx.outer()->contains(name))
@@ -1626,10 +1679,12 @@ void ConfigPreprocessor::addConst(StringPiece name, folly::dynamic result) {
 void ConfigPreprocessor::addMacro(StringPiece name,
                                   const vector<dynamic>& params,
                                   Macro::Func func,
-                                  bool autoExpand) {
+                                  bool autoExpand,
+                                  bool cacheResults) {
   auto it = macros_.emplace(name, nullptr).first;
   it->second = folly::make_unique<Macro>(*this, it->first, params,
-                                         std::move(func), autoExpand);
+                                         std::move(func), autoExpand,
+                                         cacheResults);
 }
 
 dynamic ConfigPreprocessor::replaceParams(StringPiece str,
@@ -1866,7 +1921,10 @@ void ConfigPreprocessor::parseMacroDef(const dynamic& jkey,
     auto f = [res, this](Context&& ctx) {
       return expandMacros(res, std::move(ctx));
     };
-    addMacro(key, params, std::move(f));
+    // user-defined macros are often called many times with the same
+    // arguments, so memoize their expansion results
+    addMacro(key, params, std::move(f), /* autoExpand */ true,
+             /* cacheResults */ true);
   } else if (objType == "constDef") {
     checkLogic(obj.isObject(), "constDef is not an object");
     addConst(key, tryGet(obj, "result", "constDef"));
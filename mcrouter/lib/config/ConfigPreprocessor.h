@@ -75,6 +75,13 @@ class ConfigPreprocessor {
 
   mutable size_t nestedLimit_;
 
+  /**
+   * Macro expansion results are memoized while this flag is set. Built-in
+   * calls whose result depends on more than their arguments (e.g. @shuffle,
+   * @defined) clear it for all expansions currently in progress.
+   */
+  mutable bool cacheableScope_{true};
+
   /**
    * Create preprocessor with given macros
    *
@@ -124,7 +131,8 @@ class ConfigPreprocessor {
   void addMacro(folly::StringPiece name,
                 const std::vector<folly::dynamic>& params,
                 std::function<folly::dynamic(Context&&)> func,
-                bool autoExpand = true);
+                bool autoExpand = true,
+                bool cacheResults = false);
 
   void parseMacroDef(const folly::dynamic& key, const folly::dynamic& obj);
 
@@ -155,4 +155,84 @@ uint64_t RendezvousHash::computeHash(uint64_t i) const {
   return folly::hash::twang_mix64(i);
 }
 
+constexpr size_t RendezvousHashTree::kFanout;
+
+void RendezvousHashTree::buildTree() {
+  // Pad the leaf level to a full power of kFanout; padding leaves have
+  // weight 0.0 and are never descended into.
+  size_t paddedLeaves = 1;
+  while (paddedLeaves < leaves_.size()) {
+    paddedLeaves *= kFanout;
+  }
+  firstLeaf_ = (paddedLeaves - 1) / (kFanout - 1);
+
+  // Aggregate subtree weights bottom-up in implicit heap order.
+  internalWeights_.assign(firstLeaf_, 0.0);
+  for (size_t node = firstLeaf_; node-- > 0;) {
+    double sum = 0.0;
+    for (size_t c = kFanout * node + 1; c <= kFanout * node + kFanout; ++c) {
+      sum += subtreeWeight(c);
+    }
+    internalWeights_[node] = sum;
+  }
+}
+
+double RendezvousHashTree::subtreeWeight(size_t node) const {
+  if (node < firstLeaf_) {
+    return internalWeights_[node];
+  }
+  auto leaf = node - firstLeaf_;
+  return leaf < leaves_.size() ? leaves_[leaf].second : 0.0;
+}
+
+size_t RendezvousHashTree::get(uint64_t key) const {
+  size_t node = 0;
+  while (node < firstLeaf_) {
+    double maxWeight = -1.0;
+    size_t maxWeightChild = kFanout * node + 1;
+    for (size_t c = kFanout * node + 1; c <= kFanout * node + kFanout; ++c) {
+      auto weight = subtreeWeight(c);
+      if (weight <= std::numeric_limits<double>::epsilon()) {
+        // Empty subtree or padding leaf, nothing to route to.
+        continue;
+      }
+      // Internal children are identified by their fixed tree position, so
+      // the skeleton itself is unaffected by weight changes; leaf children
+      // by their name hash, as in RendezvousHash.
+      auto hash = c < firstLeaf_ ? computeHash(c)
+                                 : leaves_[c - firstLeaf_].first;
+      double combinedHash = computeHash(hash + key);
+      double scaledHash = combinedHash / std::numeric_limits<uint64_t>::max();
+      double scaledWeight = std::pow(scaledHash, 1.0 / weight);
+      if (scaledWeight > maxWeight) {
+        maxWeightChild = c;
+        maxWeight = scaledWeight;
+      }
+    }
+    node = maxWeightChild;
+  }
+  return node - firstLeaf_;
+}
+
+void RendezvousHashTree::normalizeWeights() {
+  double sum{0.0};
+  for (const auto& it : leaves_) {
+    sum += it.second;
+  }
+  if (sum < std::numeric_limits<double>::epsilon()) {
+    throw std::invalid_argument("Sum of weights is 0");
+  }
+  for (auto& it : leaves_) {
+    it.second /= sum;
+  }
+}
+
+uint64_t RendezvousHashTree::computeHash(folly::StringPiece key) const {
+  return folly::hash::fnv64_buf(key.data(), key.size());
+}
+
+uint64_t RendezvousHashTree::computeHash(uint64_t i) const {
+  return folly::hash::twang_mix64(i);
+}
+
 }}  // facebook::memcache
@@ -56,4 +56,79 @@ class RendezvousHash {
   void normalizeWeights();
 };
 
+/**
+ * Rendezvous hash over a fixed skeleton tree.
+ *
+ * RendezvousHash::get scores every node per key, which is too slow for
+ * large pools. This variant arranges the nodes as leaves of an implicit
+ * tree with fanout kFanout and descends from the root, running one
+ * rendezvous round per level over the children: internal children are
+ * scored with a hash of their (fixed) tree position and the total weight
+ * of their subtree, leaf children with their own name hash and weight.
+ * A lookup costs kFanout * ceil(log_kFanout(n)) hashes instead of n.
+ *
+ * For pools of at most kFanout nodes the tree is a single level and get()
+ * returns exactly the same ids as RendezvousHash.
+ *
+ * Consistency is weaker than plain rendezvous hashing: a weight change
+ * also perturbs the subtree weights on the path to the root, so some keys
+ * of sibling subtrees move as well, and growing the pool past a power of
+ * kFanout deepens the tree and remaps most keys. Intended for pools large
+ * enough that the O(n) scan is the bottleneck.
+ */
+class RendezvousHashTree {
+ public:
+  /**
+   * @param Iterator  input iterator that iterates over pairs
+   *                  { <string convertible to folly::StringPiece>, double }
+   * @throws invalid_argument if weight is less than zero or
+   *                          sum of all weights is zero.
+   */
+  template <class Iterator>
+  RendezvousHashTree(Iterator begin, Iterator end) {
+    for (auto it = begin; it != end; ++it) {
+      if (it->second < 0.0) {
+        throw std::invalid_argument("Weight should be greater than 0");
+      }
+      leaves_.emplace_back(computeHash(it->first), it->second);
+    }
+    normalizeWeights();
+    buildTree();
+  }
+
+  /**
+   * Get node id for given key.
+   * @return 0 <= id < number of nodes. If nodes are empty, returns 0.
+   */
+  size_t get(uint64_t key) const;
+
+ private:
+  static constexpr size_t kFanout = 16;
+
+  uint64_t computeHash(folly::StringPiece data) const;
+
+  uint64_t computeHash(uint64_t i) const;
+
+  /**
+   * Weight of the subtree below given tree node (0.0 for padding leaves
+   * beyond the pool size).
+   */
+  double subtreeWeight(size_t node) const;
+
+  // { node hash, node weight }, the leaves of the tree in pool order
+  std::vector<std::pair<uint64_t, double>> leaves_;
+  // total leaf weight under each internal node, in implicit heap order
+  // (children of node i are kFanout * i + 1 .. kFanout * i + kFanout)
+  std::vector<double> internalWeights_;
+  // heap index of the first leaf; leaf i lives at firstLeaf_ + i
+  size_t firstLeaf_{0};
+
+  /**
+   * @throws invalid_argument if sum of weights is too small (< eps)
+   */
+  void normalizeWeights();
+
+  void buildTree();
+};
+
 }} // facebook::memcache
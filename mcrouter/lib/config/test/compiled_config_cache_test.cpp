@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <folly/dynamic.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/FileUtil.h>
+
+#include "mcrouter/lib/config/CompiledConfigCache.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+using facebook::memcache::ImportDigests;
+using facebook::memcache::ImportResolverIf;
+using facebook::memcache::loadCompiledConfig;
+using facebook::memcache::Md5Hash;
+using facebook::memcache::storeCompiledConfig;
+using facebook::memcache::TrackingImportResolver;
+using folly::test::TemporaryFile;
+
+namespace {
+
+class MockImportResolver : public ImportResolverIf {
+ public:
+  std::string import(folly::StringPiece path) override final {
+    if (path == "missing") {
+      throw std::runtime_error("Can not import missing");
+    }
+    return imports_[path.str()];
+  }
+
+  std::string& operator[](const std::string& path) {
+    return imports_[path];
+  }
+
+ private:
+  std::map<std::string, std::string> imports_;
+};
+
+folly::dynamic sampleConfig() {
+  return folly::dynamic::object
+    ("pools", folly::dynamic::object
+      ("A", folly::dynamic::object
+        ("servers", folly::dynamic::array("host1:1234", "host2:1234"))))
+    ("route", "PoolRoute|A")
+    ("int", 42)
+    ("double", 1.5)
+    ("bool", true)
+    ("null", nullptr);
+}
+
+} // anonymous namespace
+
+TEST(CompiledConfigCache, roundTrip) {
+  TemporaryFile file("compiled_config_cache_test");
+  MockImportResolver resolver;
+  auto config = sampleConfig();
+
+  EXPECT_TRUE(
+    storeCompiledConfig(file.path().string(), "digest", {}, config));
+
+  auto loaded = loadCompiledConfig(file.path().string(), "digest", resolver);
+  ASSERT_TRUE(loaded.hasValue());
+  EXPECT_EQ(config, *loaded);
+}
+
+TEST(CompiledConfigCache, sourceDigestMismatch) {
+  TemporaryFile file("compiled_config_cache_test");
+  MockImportResolver resolver;
+
+  EXPECT_TRUE(
+    storeCompiledConfig(file.path().string(), "digest", {}, sampleConfig()));
+  EXPECT_FALSE(
+    loadCompiledConfig(file.path().string(), "other", resolver).hasValue());
+}
+
+TEST(CompiledConfigCache, importValidation) {
+  TemporaryFile file("compiled_config_cache_test");
+  MockImportResolver resolver;
+  resolver["pools"] = "{ \"imported\": 1 }";
+
+  TrackingImportResolver tracking(resolver);
+  tracking.import("pools");
+  EXPECT_THROW(tracking.import("missing"), std::runtime_error);
+  ASSERT_EQ(2, tracking.importDigests().size());
+  EXPECT_EQ(Md5Hash(resolver["pools"]), tracking.importDigests()[0].second);
+
+  EXPECT_TRUE(storeCompiledConfig(file.path().string(), "digest",
+                                  tracking.importDigests(), sampleConfig()));
+
+  // imports unchanged (including the still-failing one): cache hit
+  EXPECT_TRUE(
+    loadCompiledConfig(file.path().string(), "digest", resolver).hasValue());
+
+  // imported content changed: cache is stale
+  resolver["pools"] = "{ \"imported\": 2 }";
+  EXPECT_FALSE(
+    loadCompiledConfig(file.path().string(), "digest", resolver).hasValue());
+}
+
+TEST(CompiledConfigCache, corruptedFile) {
+  TemporaryFile file("compiled_config_cache_test");
+  MockImportResolver resolver;
+
+  EXPECT_TRUE(
+    storeCompiledConfig(file.path().string(), "digest", {}, sampleConfig()));
+
+  std::string buf;
+  ASSERT_TRUE(folly::readFile(file.path().string().data(), buf));
+  buf[buf.size() / 2] ^= 0x5a;
+  ASSERT_TRUE(folly::writeFile(buf, file.path().string().data()));
+
+  EXPECT_FALSE(
+    loadCompiledConfig(file.path().string(), "digest", resolver).hasValue());
+
+  buf.resize(buf.size() / 2);
+  ASSERT_TRUE(folly::writeFile(buf, file.path().string().data()));
+  EXPECT_FALSE(
+    loadCompiledConfig(file.path().string(), "digest", resolver).hasValue());
+}
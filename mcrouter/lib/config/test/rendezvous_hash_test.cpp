@@ -285,3 +285,95 @@ TEST(ConsistentHashRing, DistributionAccuracy) {
     EXPECT_LE(maxError, 1.0);
   }
 }
+
+TEST(RendezvousHashTree, MatchesFlatForSmallPools) {
+  // Up to one tree fanout of nodes there is a single rendezvous round
+  // over the real leaves, so both variants must agree exactly.
+  for (size_t numNodes = 1; numNodes <= 16; ++numNodes) {
+    std::vector<std::pair<std::string, double>> nodes;
+    for (size_t i = 0; i < numNodes; ++i) {
+      nodes.emplace_back(folly::to<std::string>("key", i), i % 4 + 1);
+    }
+    RendezvousHash flat(nodes.begin(), nodes.end());
+    RendezvousHashTree tree(nodes.begin(), nodes.end());
+
+    for (size_t i = 0; i < 1000; ++i) {
+      ASSERT_EQ(flat.get(i), tree.get(i));
+    }
+  }
+}
+
+TEST(RendezvousHashTree, Consistency) {
+  constexpr size_t kNumNodes = 100;
+  std::vector<std::pair<std::string, double>> nodes;
+  for (size_t i = 0; i < kNumNodes; ++i) {
+    nodes.emplace_back(folly::to<std::string>("key", i), 1);
+  }
+  RendezvousHashTree hashes(nodes.begin(), nodes.end());
+
+  constexpr size_t kNumKeys = 10000;
+  size_t mapping[kNumKeys];
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    mapping[i] = hashes.get(i);
+    ASSERT_LT(mapping[i], kNumNodes);
+  }
+
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(mapping[i], hashes.get(i));
+  }
+}
+
+TEST(RendezvousHashTree, DistributionAccuracy) {
+  constexpr size_t kNumNodes = 100;
+  constexpr size_t kNumRequests = 100000;
+  std::vector<std::pair<std::string, double>> nodes;
+  double totalWeight = 0;
+  for (size_t i = 0; i < kNumNodes; ++i) {
+    double weight = i % 4 + 1;
+    nodes.emplace_back(folly::to<std::string>("key", i), weight);
+    totalWeight += weight;
+  }
+  RendezvousHashTree hashes(nodes.begin(), nodes.end());
+
+  std::vector<size_t> distribution(kNumNodes);
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    distribution[hashes.get(i)]++;
+  }
+
+  double maxError = 0.0;
+  for (size_t i = 0; i < kNumNodes; ++i) {
+    double expected = 100.0 * nodes[i].second / totalWeight;
+    double actual = 100.0 * distribution[i] / kNumRequests;
+    maxError = std::max(maxError, std::fabs(expected - actual));
+  }
+  // make sure the error rate is less than 1.0%
+  EXPECT_LE(maxError, 1.0);
+}
+
+TEST(RendezvousHashTree, ConsistencyWithNewNode) {
+  constexpr size_t kNumNodes = 100;
+  std::vector<std::pair<std::string, double>> nodes;
+  for (size_t i = 0; i < kNumNodes; ++i) {
+    nodes.emplace_back(folly::to<std::string>("key", i), 1);
+  }
+  RendezvousHashTree hashes(nodes.begin(), nodes.end());
+
+  constexpr size_t kNumKeys = 10000;
+  size_t mapping[kNumKeys];
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    mapping[i] = hashes.get(i);
+  }
+
+  // Adding a node within the current tree capacity should only move a
+  // small fraction of keys (ideally ~1/(n + 1), some extra movement from
+  // subtree weight shifts is expected).
+  nodes.emplace_back(folly::to<std::string>("key", kNumNodes), 1);
+  hashes = RendezvousHashTree(nodes.begin(), nodes.end());
+  size_t moved = 0;
+  for (size_t i = 0; i < kNumKeys; ++i) {
+    if (mapping[i] != hashes.get(i)) {
+      ++moved;
+    }
+  }
+  EXPECT_LE(moved, kNumKeys / 10);
+}
@@ -9,6 +9,7 @@
  */
 #include "Accumulator.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <glog/logging.h>
@@ -27,7 +28,7 @@ constexpr size_t kAggregationIntervalMs = 1000;
 namespace {
 
 // Accumulated stats queue.
-folly::MPMCQueue<CycleStats> gStatsQueue{100};
+folly::MPMCQueue<AggregatedStats> gStatsQueue{100};
 
 } // anonymous namespace
 
@@ -38,6 +39,7 @@ void Accumulator::add(const Interval& interval) {
   if (inflightSamples_[idx].label == interval.label()) {
     // This interval is a part of an existing sample.
     inflightSamples_[idx].length += interval.length();
+    inflightSamples_[idx].perf += interval.perfCounters();
     inflightSamples_[idx].numIntervals++;
   } else {
     if (inflightSamples_[idx].numIntervals != 0 &&
@@ -57,6 +59,7 @@ void Accumulator::add(const Interval& interval) {
 
     inflightSamples_[idx].label = interval.label();
     inflightSamples_[idx].length = interval.length();
+    inflightSamples_[idx].perf = interval.perfCounters();
     inflightSamples_[idx].numIntervals = 1;
   }
 }
@@ -72,45 +75,27 @@ void Accumulator::attachEventBase(folly::EventBase& eventBase) {
   scheduleNextAggregation();
 }
 
-CycleStats Accumulator::aggregate() {
-  CycleStats stats;
-
-  if (numSamples_ == 0) {
-    return stats;
-  }
+uint64_t Accumulator::inflightCycles(const IntervalLabel& label) const {
+  const auto& sample = inflightSamples_[label.requestId() % kMaxInflightSamples];
+  return sample.label == label ? sample.length : 0;
+}
 
-  // Compute valid intervals and discard invalid.
-  int lo = 0;
-  int hi = kMaxSamples - 1;
-  while (lo <= hi) {
-    // Verify if sample is valid. We are using a heuristic where a valid
-    // sample is composed by 2 intervals. Will want to change it in next version
-    if (samples_[lo].numIntervals >= 2) {
-      stats.avg += samples_[lo].length;
-      ++lo;
-    } else {
-      std::swap(samples_[lo], samples_[hi]);
-      --hi;
+AggregatedStats Accumulator::aggregate() {
+  AggregatedStats stats;
+
+  // Verify if each sample is valid. We are using a heuristic where a valid
+  // sample is composed by 2 intervals. Will want to change it in next version
+  const size_t stored = std::min<uint64_t>(numSamples_, kMaxSamples);
+  for (size_t i = 0; i < stored; ++i) {
+    if (samples_[i].numIntervals >= 2) {
+      stats.latencies.insert(samples_[i].length);
+      stats.lengthSum += samples_[i].length;
+      stats.llcMisses += samples_[i].perf.llcMisses;
+      stats.stalledCycles += samples_[i].perf.stalledCycles;
+      stats.branchMisses += samples_[i].perf.branchMisses;
     }
   }
-  stats.numSamples = lo;
-
-  // Calculate percentils
-  if (stats.numSamples > 0) {
-    std::sort(samples_.begin(), samples_.begin() + stats.numSamples,
-              [](const Sample& lhr, const Sample& rhs) {
-                return lhr.length < rhs.length;
-              });
-    stats.min = samples_[0].length;
-    stats.p01 = samples_[stats.numSamples * 0.01].length;
-    stats.p05 = samples_[stats.numSamples * 0.05].length;
-    stats.p50 = samples_[stats.numSamples * 0.50].length;
-    stats.p95 = samples_[stats.numSamples * 0.95].length;
-    stats.p99 = samples_[stats.numSamples * 0.99].length;
-    stats.max = samples_[stats.numSamples - 1].length;
-
-    stats.avg /= stats.numSamples;
-  }
+  stats.numSamples = stats.latencies.size();
 
   // Reset and schedule next one.
   numSamples_ = 0;
@@ -120,9 +105,9 @@ CycleStats Accumulator::aggregate() {
 
 void Accumulator::scheduleNextAggregation() {
   this->eventBase_->runAfterDelay([&] {
-    CycleStats stats = this->aggregate();
+    AggregatedStats stats = this->aggregate();
     if (stats.numSamples > 0) {
-      gStatsQueue.write(stats);
+      gStatsQueue.write(std::move(stats));
     }
     this->scheduleNextAggregation();
   }, kAggregationIntervalMs);
@@ -134,31 +119,35 @@ Accumulator& currentAccumulator() {
 }
 
 CycleStats extract() {
-  CycleStats stats;
-  stats.min = std::numeric_limits<uint64_t>::max();
+  /* Merging the per-thread sketches costs a constant-size bucket-array
+     add per summary, and the percentiles then come from the one
+     combined distribution. */
+  AggregatedStats merged;
 
-  CycleStats tmp;
+  AggregatedStats tmp;
   while (gStatsQueue.read(tmp)) {
-    stats.min = std::min(stats.min, tmp.min);
-    stats.max = std::max(stats.max, tmp.max);
-    stats.avg += (tmp.avg * tmp.numSamples);
-    stats.p01 += (tmp.p01 * tmp.numSamples);
-    stats.p05 += (tmp.p05 * tmp.numSamples);
-    stats.p50 += (tmp.p50 * tmp.numSamples);
-    stats.p95 += (tmp.p95 * tmp.numSamples);
-    stats.p99 += (tmp.p99 * tmp.numSamples);
-    stats.numSamples += tmp.numSamples;
+    merged.latencies.merge(tmp.latencies);
+    merged.numSamples += tmp.numSamples;
+    merged.lengthSum += tmp.lengthSum;
+    merged.llcMisses += tmp.llcMisses;
+    merged.stalledCycles += tmp.stalledCycles;
+    merged.branchMisses += tmp.branchMisses;
   }
 
-  if (stats.numSamples > 0) {
-    stats.avg /= stats.numSamples;
-    stats.p01 /= stats.numSamples;
-    stats.p05 /= stats.numSamples;
-    stats.p50 /= stats.numSamples;
-    stats.p95 /= stats.numSamples;
-    stats.p99 /= stats.numSamples;
-  } else {
-    stats.min = 0;
+  CycleStats stats;
+  if (merged.numSamples > 0) {
+    stats.numSamples = merged.numSamples;
+    stats.min = merged.latencies.query(0.0);
+    stats.max = merged.latencies.query(1.0);
+    stats.p01 = merged.latencies.query(0.01);
+    stats.p05 = merged.latencies.query(0.05);
+    stats.p50 = merged.latencies.query(0.50);
+    stats.p95 = merged.latencies.query(0.95);
+    stats.p99 = merged.latencies.query(0.99);
+    stats.avg = merged.lengthSum / merged.numSamples;
+    stats.llcMisses = merged.llcMisses / merged.numSamples;
+    stats.stalledCycles = merged.stalledCycles / merged.numSamples;
+    stats.branchMisses = merged.branchMisses / merged.numSamples;
   }
 
   return stats;
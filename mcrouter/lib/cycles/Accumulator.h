@@ -11,8 +11,11 @@
 
 #include <array>
 
+#include <folly/detail/CacheLocality.h>
+
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/cycles/Interval.h"
+#include "mcrouter/lib/cycles/QuantilesCalculator.h"
 
 namespace folly {
 class EventBase;
@@ -28,9 +31,29 @@ struct Sample {
   IntervalLabel label{0, 0};
   uint64_t length{0};
   uint64_t contextSwitches{0};
+  PerfCounters perf;
   size_t numIntervals{0};
 };
 
+// Relative error of the per-thread latency sketches below.
+constexpr double kLatencySketchEps = 0.01;
+
+/**
+ * Per-aggregation summary handed from an accumulator's thread to
+ * extract().  Sample lengths travel as a mergeable sketch, so extract()
+ * combines any number of threads' summaries into one distribution and
+ * reads true fleet-wide percentiles off it, instead of averaging
+ * percentiles computed separately per thread.
+ */
+struct AggregatedStats {
+  QuantilesCalculator<uint64_t> latencies{kLatencySketchEps};
+  uint64_t numSamples{0};
+  uint64_t lengthSum{0};
+  uint64_t llcMisses{0};
+  uint64_t stalledCycles{0};
+  uint64_t branchMisses{0};
+};
+
 /**
  * Class responsible for aggregating together and computing statical
  * information about intervals.
@@ -50,6 +73,12 @@ class Accumulator {
    */
   void attachEventBase(folly::EventBase& eventBase);
 
+  /**
+   * Returns the length of the in-flight sample with the given label,
+   * or 0 if there is none.
+   */
+  uint64_t inflightCycles(const IntervalLabel& label) const;
+
  private:
   // Number of in-flight samples to keep.
   static constexpr size_t kMaxInflightSamples = 3000;
@@ -60,8 +89,12 @@ class Accumulator {
   // Informs whether the event base was attached.
   folly::EventBase* eventBase_{nullptr};
 
-  // Samples
-  std::array<Sample, kMaxInflightSamples> inflightSamples_;
+  // Samples. Each accumulator has a single writer (its thread), so
+  // this state needs no locks; aligning it keeps the hot interval path
+  // from sharing cache lines with whatever happens to neighbor this
+  // accumulator on the heap.
+  std::array<Sample, kMaxInflightSamples> inflightSamples_
+      FOLLY_ALIGN_TO_AVOID_FALSE_SHARING;
   std::array<Sample, kMaxSamples> samples_;
   size_t numSamples_{0};
 
@@ -69,7 +102,7 @@ class Accumulator {
   void scheduleNextAggregation();
 
   // Aggregates and extracts accumulated information from this accumulator.
-  CycleStats aggregate();
+  AggregatedStats aggregate();
 
   friend CycleStats extract();
 };
@@ -21,6 +21,7 @@
 
 #include "mcrouter/lib/cycles/Accumulator.h"
 #include "mcrouter/lib/cycles/ExtractorThread.h"
+#include "mcrouter/lib/cycles/PerfEvents.h"
 
 using namespace facebook::memcache::cycles::detail;
 
@@ -34,6 +35,15 @@ ExtractorThread extractor;
 // Clock
 std::unique_ptr<Clock> clock = folly::make_unique<CyclesClock>();
 
+// Whether to sample hardware performance counters at interval boundaries.
+std::atomic<bool> perfEventsEnabled{false};
+
+// Hardware counter group of current thread, opened on first use.
+PerfEventGroup& perfEventGroup() {
+  thread_local PerfEventGroup group;
+  return group;
+}
+
 class IntervalContext {
  public:
   bool started() const {
@@ -41,6 +51,8 @@ class IntervalContext {
   }
   void reset() {
     metering_ = Metering{0, 0};
+    perfStart_ = PerfCounters();
+    perfSampled_ = false;
     labeled_ = false;
     valid_ = true;
   }
@@ -60,6 +72,8 @@ class IntervalContext {
 
  private:
   Metering metering_{0, 0};
+  PerfCounters perfStart_;
+  bool perfSampled_{false};
   detail::IntervalLabel label_;
   bool labeled_{false};
   bool valid_{true};
@@ -91,6 +105,13 @@ bool start() noexcept {
   }
 
   intervalCtx.metering_ = clock->read();
+  if (perfEventsEnabled.load(std::memory_order_relaxed)) {
+    auto& group = perfEventGroup();
+    if (group.usable()) {
+      intervalCtx.perfStart_ = group.read();
+      intervalCtx.perfSampled_ = true;
+    }
+  }
   return true;
 }
 
@@ -101,7 +122,12 @@ void finish() noexcept {
 
   if (intervalCtx.started() && intervalCtx.valid_ && intervalCtx.labeled_) {
     auto metering = clock->read() - intervalCtx.metering_;
-    currentAccumulator().add(Interval(metering, std::move(intervalCtx.label_)));
+    PerfCounters perf;
+    if (intervalCtx.perfSampled_) {
+      perf = perfEventGroup().read() - intervalCtx.perfStart_;
+    }
+    currentAccumulator().add(
+        Interval(metering, perf, std::move(intervalCtx.label_)));
   }
   intervalCtx.reset();
 }
@@ -113,8 +139,22 @@ bool label(uint64_t requestType, uint64_t requestId) {
   return intervalCtx.setLabel(IntervalLabel(requestType, requestId));
 }
 
-void startExtracting(std::function<void(CycleStats)> func) {
-  extractor.start(std::move(func));
+uint64_t getAccumulatedCycles(uint64_t requestType, uint64_t requestId) {
+  return currentAccumulator().inflightCycles(
+      IntervalLabel(requestType, requestId));
+}
+
+void registerStatsSink(std::string name,
+                       std::function<void(const CycleStats&)> sink) {
+  extractor.registerSink(std::move(name), std::move(sink));
+}
+
+void unregisterStatsSink(const std::string& name) {
+  extractor.unregisterSink(name);
+}
+
+void startExtracting() {
+  extractor.start();
 }
 
 void stopExtracting() noexcept {
@@ -125,4 +165,8 @@ void setClock(std::unique_ptr<Clock> clk) {
   clock = std::move(clk);
 }
 
+void setPerfEventsEnabled(bool enabled) {
+  perfEventsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
 }}} // namespace facebook::memcache::cycles
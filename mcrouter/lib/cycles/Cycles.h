@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -35,7 +36,9 @@ class EventBase;
  *    // Attach all EventBases that are used to process requests.
  *    cycles::attachEventBase();
  *
- *    // Start the thread that reports the aggregated results.
+ *    // Register one or more consumers of the aggregated results and
+ *    // start the thread that reports them.
+ *    cycles::registerStatsSink("stats", ...);
  *    cycles::startExtracting();
  *
  *  2) Use the API
@@ -138,20 +141,49 @@ struct CycleStats {
   uint64_t p95{0};
   uint64_t p99{0};
 
+  // Average hardware counter values per request (all zero unless perf
+  // event sampling is enabled and supported - see setPerfEventsEnabled).
+  uint64_t llcMisses{0};
+  uint64_t stalledCycles{0};
+  uint64_t branchMisses{0};
+
   // Number of samples
   size_t numSamples{0};
 };
 
 /**
- * Starts extracting data.
+ * Returns the number of CPU cycles accumulated so far for the given label
+ * by the current thread, or 0 if no in-flight sample with that label
+ * exists (e.g. it was already extracted or evicted).
+ *
+ * Note: Must be called from the thread that processed the intervals.
+ */
+uint64_t getAccumulatedCycles(uint64_t requestType, uint64_t requestId);
+
+/**
+ * Registers a named consumer of extracted data. Every extraction
+ * delivers the same CycleStats snapshot to all registered sinks, so
+ * several independent consumers (exported stats, sampling, counter
+ * export) share a single extraction. Registering a name again replaces
+ * the previous sink; sinks may be registered before or after
+ * startExtracting().
+ */
+void registerStatsSink(std::string name,
+                       std::function<void(const CycleStats&)> sink);
+
+/**
+ * Unregisters the sink with the given name, if present.
+ */
+void unregisterStatsSink(const std::string& name);
+
+/**
+ * Starts extracting data, delivering it to all registered sinks.
  * This function does nothing if extraction is already running.
  *
  * Note: Before start extracting, it is necessary to have attached all relevant
  * EventBases through attachEventBase().
- *
- * @param func  Function that will receive the extracted data.
  */
-void startExtracting(std::function<void(CycleStats)> func);
+void startExtracting();
 
 /**
  * Stops extractor thread.
@@ -163,4 +195,14 @@ void stopExtracting() noexcept;
  */
 void setClock(std::unique_ptr<Clock> clk);
 
+/**
+ * Enables/disables sampling of hardware performance counters (LLC
+ * misses, stalled cycles, branch misses) at interval boundaries, via a
+ * per-thread perf_event_open(2) group (see PerfEvents.h).
+ * Adds one counter-group read syscall to each end of an interval, so it
+ * is disabled by default. Has no effect on hosts where the counters
+ * cannot be opened - the exported values simply stay zero there.
+ */
+void setPerfEventsEnabled(bool enabled);
+
 }}} // namespace facebook::memcache::cycles
@@ -21,14 +21,43 @@ bool ExtractorThread::running() const {
   return running_.load();
 }
 
-void ExtractorThread::start(std::function<void(CycleStats)> fn) {
+void ExtractorThread::registerSink(
+    std::string name,
+    std::function<void(const CycleStats&)> sink) {
+  std::lock_guard<std::mutex> lg(sinksMutex_);
+  for (auto& entry : sinks_) {
+    if (entry.first == name) {
+      entry.second = std::move(sink);
+      return;
+    }
+  }
+  sinks_.emplace_back(std::move(name), std::move(sink));
+}
+
+void ExtractorThread::unregisterSink(const std::string& name) {
+  std::lock_guard<std::mutex> lg(sinksMutex_);
+  for (auto it = sinks_.begin(); it != sinks_.end(); ++it) {
+    if (it->first == name) {
+      sinks_.erase(it);
+      return;
+    }
+  }
+}
+
+void ExtractorThread::start() {
   if (running_.exchange(true)) {
     return;
   }
 
-  thread_ = std::thread([this, func = std::move(fn)] {
+  thread_ = std::thread([this] {
     while (running_.load()) {
-      func(detail::extract());
+      const auto stats = detail::extract();
+      {
+        std::lock_guard<std::mutex> lg(sinksMutex_);
+        for (const auto& entry : sinks_) {
+          entry.second(stats);
+        }
+      }
 
       // Sleep
       {
@@ -13,7 +13,10 @@
 #include <condition_variable>
 #include <functional>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "mcrouter/lib/cycles/Cycles.h"
 
@@ -21,6 +24,11 @@ namespace facebook { namespace memcache { namespace cycles { namespace detail {
 
 /**
  * Thread that will do the extraction.
+ *
+ * Each extraction produces one CycleStats snapshot, which is handed to
+ * every registered sink; sinks are independent, so the same data can
+ * feed e.g. exported stats and a sampling pipeline at the cost of a
+ * single extraction.
  */
 class ExtractorThread {
  public:
@@ -35,12 +43,25 @@ class ExtractorThread {
   bool running() const;
 
   /**
-   * Start running the extractor thread.
+   * Registers a named sink for extracted data. If a sink with the same
+   * name already exists, it is replaced. May be called whether or not
+   * the thread is running.
+   */
+  void registerSink(std::string name,
+                    std::function<void(const CycleStats&)> sink);
+
+  /**
+   * Unregisters the sink with the given name, if present. The sink will
+   * not be called again after this returns.
+   */
+  void unregisterSink(const std::string& name);
+
+  /**
+   * Start running the extractor thread, delivering each extraction to
+   * all registered sinks.
    * Note: If the thread is already running, this method does nothing.
-   *
-   * @param func  Function that will receive the extracted data.
    */
-  void start(std::function<void(CycleStats)> func);
+  void start();
 
   /**
    * Stop running the extractor thread.
@@ -57,6 +78,13 @@ class ExtractorThread {
   // Mutex to wake up on shutdown.
   std::mutex mutex_;
 
+  // Registered sinks and the mutex guarding them. The lock is held
+  // while delivering (once a second) and while (un)registering - never
+  // on the interval measurement path.
+  std::mutex sinksMutex_;
+  std::vector<std::pair<std::string, std::function<void(const CycleStats&)>>>
+      sinks_;
+
   // Informs whether the extractor thread is running.
   std::atomic<bool> running_{false};
 
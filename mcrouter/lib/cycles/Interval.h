@@ -13,6 +13,7 @@
 #include <string>
 
 #include "mcrouter/lib/cycles/Clocks.h"
+#include "mcrouter/lib/cycles/PerfEvents.h"
 
 namespace facebook { namespace memcache { namespace cycles {
 
@@ -73,6 +74,20 @@ class Interval {
     : metering_(metering)
     , label_(std::move(lbl)) {}
 
+  /**
+   * Constructs a labeled interval that also carries hardware counter
+   * values (see PerfEvents.h).
+   *
+   * @param metering      Holds the duration and the number of context switches
+   *                      of the interval.
+   * @param perf          Hardware counter values of the interval.
+   * @param lbl           Label of this interval.
+   */
+  Interval(Metering metering, PerfCounters perf, IntervalLabel lbl)
+    : metering_(metering)
+    , perf_(perf)
+    , label_(std::move(lbl)) {}
+
   /**
    * Returns the duration of this interval
    */
@@ -87,6 +102,14 @@ class Interval {
     return metering_.contextSwitches;
   }
 
+  /**
+   * Hardware counter values of this interval (all zero unless perf
+   * event sampling is enabled and supported).
+   */
+  const PerfCounters& perfCounters() const {
+    return perf_;
+  }
+
   /**
    * Label of this interval.
    */
@@ -99,6 +122,9 @@ class Interval {
   // of this interval.
   Metering metering_{0, 0};
 
+  // Hardware counter values of this interval.
+  PerfCounters perf_;
+
   // Label (key) of this interval.
   IntervalLabel label_;
 };
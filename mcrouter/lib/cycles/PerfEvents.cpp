@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "PerfEvents.h"
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace facebook { namespace memcache { namespace cycles {
+
+#ifdef __linux__
+
+namespace {
+
+int perfEventOpen(struct perf_event_attr* attr, int groupFd) noexcept {
+  return syscall(__NR_perf_event_open, attr, 0 /* calling thread */,
+                 -1 /* any cpu */, groupFd, 0 /* flags */);
+}
+
+} // anonymous namespace
+
+PerfEventGroup::PerfEventGroup() noexcept {
+  // Order must match the layout of PerfCounters and the unpacking
+  // in read().
+  const uint64_t configs[kNumEvents] = {
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    int fd = perfEventOpen(&attr, fds_[0]);
+    if (fd < 0) {
+      static bool logged{false};
+      if (!logged) {
+        PLOG(WARNING) << "Error opening hardware performance counters"
+                         " (no PMU or restrictive perf_event_paranoid?);"
+                         " perf event sampling disabled";
+        logged = true;
+      }
+      closeAll();
+      return;
+    }
+    fds_[i] = fd;
+  }
+
+  ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters PerfEventGroup::read() const noexcept {
+  PerfCounters counters;
+  if (!usable()) {
+    return counters;
+  }
+
+  // Layout of read(2) on the group leader with PERF_FORMAT_GROUP.
+  struct {
+    uint64_t nr;
+    uint64_t values[kNumEvents];
+  } buf;
+
+  if (::read(fds_[0], &buf, sizeof(buf)) != sizeof(buf) ||
+      buf.nr != kNumEvents) {
+    return counters;
+  }
+
+  counters.llcMisses = buf.values[0];
+  counters.stalledCycles = buf.values[1];
+  counters.branchMisses = buf.values[2];
+  return counters;
+}
+
+void PerfEventGroup::closeAll() noexcept {
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+      fds_[i] = -1;
+    }
+  }
+}
+
+#else // !__linux__
+
+PerfEventGroup::PerfEventGroup() noexcept {}
+
+PerfCounters PerfEventGroup::read() const noexcept {
+  return PerfCounters();
+}
+
+void PerfEventGroup::closeAll() noexcept {}
+
+#endif
+
+PerfEventGroup::~PerfEventGroup() {
+  closeAll();
+}
+
+}}} // namespace facebook::memcache::cycles
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace facebook { namespace memcache { namespace cycles {
+
+/**
+ * Values of the hardware performance counters sampled at interval
+ * boundaries. All values are for user space only (kernel and hypervisor
+ * events are excluded).
+ */
+struct PerfCounters {
+  // Last-level cache misses.
+  uint64_t llcMisses{0};
+  // Cycles during which the backend of the pipeline was stalled.
+  uint64_t stalledCycles{0};
+  // Mispredicted branch instructions.
+  uint64_t branchMisses{0};
+};
+inline PerfCounters operator-(const PerfCounters& lhs,
+                              const PerfCounters& rhs) {
+  return PerfCounters{
+    lhs.llcMisses - rhs.llcMisses,
+    lhs.stalledCycles - rhs.stalledCycles,
+    lhs.branchMisses - rhs.branchMisses
+  };
+}
+inline PerfCounters& operator+=(PerfCounters& lhs, const PerfCounters& rhs) {
+  lhs.llcMisses += rhs.llcMisses;
+  lhs.stalledCycles += rhs.stalledCycles;
+  lhs.branchMisses += rhs.branchMisses;
+  return lhs;
+}
+
+/**
+ * A per-thread group of hardware performance counters, opened with
+ * perf_event_open(2) and read back with a single read(2) syscall
+ * (PERF_FORMAT_GROUP), so all counters of a snapshot are consistent
+ * with each other.
+ *
+ * If the counters cannot be opened (no hardware PMU, e.g. most virtual
+ * machines, or a restrictive perf_event_paranoid setting), the group is
+ * not usable and read() returns zeroed counters.
+ */
+class PerfEventGroup {
+ public:
+  // Number of events in the group. Must match PerfCounters.
+  static constexpr size_t kNumEvents = 3;
+
+  PerfEventGroup() noexcept;
+  ~PerfEventGroup();
+
+  // non copyable
+  PerfEventGroup(const PerfEventGroup&) = delete;
+  PerfEventGroup& operator=(const PerfEventGroup&) = delete;
+
+  /**
+   * Tells whether the counters were successfully opened.
+   */
+  bool usable() const noexcept {
+    return fds_[0] >= 0;
+  }
+
+  /**
+   * Reads the current value of all counters of the group.
+   * Returns zeroed counters if the group is not usable.
+   */
+  PerfCounters read() const noexcept;
+
+ private:
+  // File descriptors of the events; fds_[0] is the group leader.
+  int fds_[kNumEvents]{-1, -1, -1};
+
+  void closeAll() noexcept;
+};
+
+}}} // namespace facebook::memcache::cycles
@@ -7,104 +7,129 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
-#pragma once
-
+#include <algorithm>
+#include <cassert>
 #include <limits>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <folly/Bits.h>
+
 namespace facebook { namespace memcache { namespace cycles {
 
 template<class T>
 QuantilesCalculator<T>::QuantilesCalculator(double eps)
-    : eps_(eps) {
+    : min_(std::numeric_limits<T>::max()),
+      max_(0) {
   assert(eps > 0.0);
-  summary_.emplace(std::numeric_limits<T>::max(), detail::GkTuple{1, 0});
-}
 
-template<class T>
-void QuantilesCalculator<T>::insert(T v) {
-  ++n_;
+  /* Pick the smallest power-of-two sub-bucket count that keeps the
+     worst-case relative resolution (half a bucket width) within eps. */
+  const double target = 1.0 / (2 * eps);
+  constexpr uint32_t valueBits = 8 * sizeof(T);
+  subBucketHalfCountLog_ = 1;
+  while ((1ull << subBucketHalfCountLog_) < target &&
+         subBucketHalfCountLog_ < valueBits - 1) {
+    ++subBucketHalfCountLog_;
+  }
 
-  const uint64_t epsN = 2 * eps_ * n_;
+  const size_t h = size_t(1) << subBucketHalfCountLog_;
+  counts_.assign((valueBits - subBucketHalfCountLog_ + 1) * h, 0);
+}
 
-  // We need to insert this cell after the cells that share the same value.
-  // Getting the cell just after the new one to use as a hint for the insert.
-  auto ub = summary_.upper_bound(v);
+/**
+ * Values below twice the sub-bucket count index linearly (and so count
+ * exactly); beyond that, each power of two is split into h linear
+ * sub-buckets of width 2^shift, which works out to the closed form
+ * "shift * h + (v >> shift)" with no gaps between ranges.
+ */
+template<class T>
+size_t QuantilesCalculator<T>::slotOf(T v) const {
+  const size_t h = size_t(1) << subBucketHalfCountLog_;
+  if (v < 2 * h) {
+    return v;
+  }
+  const uint32_t shift =
+      folly::findLastSet(uint64_t(v)) - 1 - subBucketHalfCountLog_;
+  return shift * h + (uint64_t(v) >> shift);
+}
 
-  // if the next cell (upper bound) is not full, just increment it's g.
-  // (This is an optimization - it's not described in the paper.
-  // In the compress phase it would happen anyway).
-  if ((ub->second.g + ub->second.delta) < epsN) {
-    ub->second.g++;
-    return;
+/**
+ * Inverse of slotOf(): the midpoint of the value range the slot covers
+ * (the exact value for slots in the linear range).
+ */
+template<class T>
+T QuantilesCalculator<T>::valueOf(size_t slot) const {
+  const size_t h = size_t(1) << subBucketHalfCountLog_;
+  const size_t bucket = slot >> subBucketHalfCountLog_;
+  if (bucket <= 1) {
+    return static_cast<T>(slot);
   }
+  const uint32_t shift = bucket - 1;
+  const uint64_t base = (slot & (h - 1)) | h;
+  return static_cast<T>((base << shift) | (uint64_t(1) << (shift - 1)));
+}
 
-  // We keep track of number of inserts to know when it's time to compress().
-  ++inserts_;
+template<class T>
+void QuantilesCalculator<T>::insert(T v) {
+  ++counts_[slotOf(v)];
+  ++n_;
+  min_ = std::min(min_, v);
+  max_ = std::max(max_, v);
+}
 
-  // Using upper_bound as a hint to where to insert it.
-  auto cur = summary_.insert(ub, std::make_pair(v, detail::GkTuple{1, epsN}));
-  if (cur == summary_.begin()) {
-    cur->second.delta = 0;
+template<class T>
+void QuantilesCalculator<T>::merge(const QuantilesCalculator<T>& other) {
+  assert(counts_.size() == other.counts_.size());
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 2 <= counts_.size(); i += 2) {
+    const auto sum = _mm_add_epi64(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&counts_[i])),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&other.counts_[i])));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&counts_[i]), sum);
   }
-
-  // We need to compress once every 1/(2*eps_) to keep our memory usage goals.
-  assert(uint64_t(1 / (2 * eps_)) != 0);
-  if ((inserts_ % static_cast<uint64_t>(1 / (2 * eps_))) == 0) {
-    compress();
+#endif
+  for (; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
   }
+
+  n_ += other.n_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
 }
 
 template<class T>
 T QuantilesCalculator<T>::query(double q) const {
   assert(q >= 0.0 && q <= 1.0);
 
-  // r represents the rank of the element we want (i.e. if we were
-  // storing the entire data stream in a sorted array, the answer would be
-  // as simple as: return array[r]).
-  const uint64_t r = n_ * q + 0.5;
-
-  // epsN represents the error margin in rank (i.e. if we were storing the
-  // entire data stream in a sorted array and the right answer was array[r],
-  // anything in the range "array[r +- epsN]" would be a valid answer).
-  const uint64_t epsN = eps_ * n_;
-
-  // rMin represents the minimum rank represented by current element.
-  // rMin + delta = rMax, which is the maximum rank represented by
-  // current element.
-  uint64_t rMin = 0;
-
-  // We find a solution as soon as we find an element where
-  // rMin <= r <= rMax.
-  auto cur = summary_.begin();
-  auto next = cur;
-  while (++next != summary_.end()) {
-    rMin += cur->second.g;
-    if ((r + epsN) < (rMin + next->second.g)) {
-      break;
-    }
-    cur = next;
+  if (n_ == 0) {
+    return std::numeric_limits<T>::max();
   }
 
-  return cur->first;
-}
-
-/**
- * We might have overlapping rMin/rMax pairs. This method simply
- * gets rid of these useless elements.
- */
-template<class T>
-void QuantilesCalculator<T>::compress() {
-  uint64_t epsN = 2 * eps_ * n_;
-
-  auto cur = summary_.begin();
-  auto next = cur;
-  while (++next != summary_.end()) {
-    if ((cur->second.g + next->second.g + next->second.delta) < epsN) {
-      next->second.g += cur->second.g;
-      summary_.erase(cur);
+  // r is the (0-based) rank of the element we want: if we were storing
+  // the entire data stream in a sorted array, the answer would be as
+  // simple as: return array[r].  Ranks are exact here - only values
+  // are quantized, which is what bounds the error relative to the
+  // value rather than to the rank.
+  const uint64_t r = (n_ - 1) * q;
+
+  uint64_t cum = 0;
+  size_t slot = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    cum += counts_[i];
+    if (cum > r) {
+      slot = i;
+      break;
     }
-    cur = next;
   }
+
+  /* The tracked extremes are exact, so clamping keeps query(0.0) and
+     query(1.0) exact and never reports beyond the observed range. */
+  return std::max(min_, std::min(max_, valueOf(slot)));
 }
 
 }}} // facebook::memcache::cycles
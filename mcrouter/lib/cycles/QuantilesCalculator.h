@@ -9,49 +9,43 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <map>
+#include <type_traits>
+#include <vector>
 
 namespace facebook { namespace memcache { namespace cycles {
 
-namespace detail {
-
-/**
- * An instance of GkTuple is stored together with each value
- * inserted in QuantilesCalculator.
- */
-struct GkTuple {
-  // The sum (g0 + g1 + ... + gi) gives the minimum rank (starting at 1) that
-  // element i represents (this sum is called rMin).
-  uint64_t g;
-
-  // (rMin + delta) gives the max rank that an element represents
-  // (this is called rMax).
-  uint64_t delta;
-};
-
-} // detail
-
 /**
- * Space and time efficient quantile calculator for data streams.
- * This is an implementation of Greenwald-Khanna (GK) algorithm
- * (paper: http://dl.acm.org/citation.cfm?id=375670).
+ * Space and time efficient quantile sketch for data streams.
+ *
+ * The sketch is a log-linear histogram (in the spirit of DDSketch and
+ * HdrHistogram): values are counted in buckets whose width grows with
+ * the value, so any reported quantile is within a relative error of
+ * "eps" of the true quantile value.  Values smaller than the linear
+ * range (roughly 1/eps) are counted exactly.
+ *
+ * Bucket counts live in one flat array whose size depends only on eps,
+ * so the memory usage is constant, inserts are O(1) with integer-only
+ * arithmetic, and two sketches built with the same eps merge by adding
+ * their bucket arrays - cost independent of how many samples either
+ * side has seen.  This is what makes per-thread sketches combinable
+ * into one distribution without resorting to averaging percentiles.
  */
 template<class T>
 class QuantilesCalculator {
  public:
-  static_assert(std::is_arithmetic<T>::value, "T must be a numeric type.");
+  static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value,
+                "T must be an unsigned integral type.");
 
   /**
    * Creates a new instance of quantiles calculator.
    *
-   * @param eps   Margin of error allowed. The smaller the margin is, the
-   *              larger is the space used by the data structure.
-   *              The maximum amount of memory used by this data structure, can
-   *              be roughly calculated by the formula:
-   *              "(1 / eps) * log2(n * eps)",
-   *              where "eps" is the margin of error and "n" is number of
-   *              elements inserted into the data structure.
+   * @param eps   Maximum relative error of reported quantile values
+   *              (e.g. 0.01 means a reported p99 is within 1% of the
+   *              real one).  The smaller the error, the larger the
+   *              bucket array: its size is roughly
+   *              "(bits(T) / 2) * (1 / eps)" counters.
    *              Note: eps > 0.0
    */
   explicit QuantilesCalculator(double eps = 0.001);
@@ -64,8 +58,17 @@ class QuantilesCalculator {
   void insert(T v);
 
   /**
-   * Returns the value of the "q" quantile, with maximum error of "eps" (i.e.
-   * return the value of a quantile in [q-eps, q+eps] range).
+   * Merges another sketch into this one, as if every sample inserted
+   * into "other" had been inserted here.  Both sketches must have been
+   * created with the same eps.  Cost is proportional to the (constant)
+   * bucket array size, not to the number of samples.
+   */
+  void merge(const QuantilesCalculator<T>& other);
+
+  /**
+   * Returns the value of the "q" quantile, with maximum relative error
+   * of "eps".  Returns std::numeric_limits<T>::max() if the sketch is
+   * empty.
    *
    * @param q   Quantile (0 <= q <= 1) desired.
    */
@@ -79,20 +82,25 @@ class QuantilesCalculator {
   }
 
   /**
-   * Returns the size being actually used by the data structure.
-   * Useful for debugging.
+   * Returns the size being actually used by the data structure
+   * (constant for a given eps).  Useful for debugging.
    */
   uint64_t internalSize() const {
-    return summary_.size();
+    return counts_.size();
   }
 
  private:
-  std::multimap<T, detail::GkTuple> summary_;
+  // Log2 of the number of linear sub-buckets per power of two; buckets
+  // are 2^shift wide once values outgrow the linear range, giving a
+  // relative resolution of 2^-subBucketHalfCountLog_.
+  uint32_t subBucketHalfCountLog_;
+  std::vector<uint64_t> counts_;
   uint64_t n_{0};
-  uint64_t inserts_{0};
-  const double eps_;
+  T min_;
+  T max_;
 
-  void compress();
+  size_t slotOf(T v) const;
+  T valueOf(size_t slot) const;
 };
 
 }}} // namespace facebook::memcache::cycles
@@ -21,7 +21,7 @@ using namespace facebook::memcache;
 class CyclesTest : public ::testing::Test {
  protected:
   virtual void SetUp() {
-    cycles::startExtracting([](cycles::CycleStats){});
+    cycles::startExtracting();
   }
 
   virtual void TearDown() {
@@ -67,3 +67,31 @@ TEST_F(CyclesTest, already_labeled) {
   EXPECT_TRUE(cycles::label(1, 2));
   EXPECT_FALSE(cycles::label(5, 6));
 }
+
+TEST_F(CyclesTest, multiple_sinks) {
+  // Both sinks see every extraction; unregistered sinks stop being
+  // called.
+  cycles::stopExtracting();
+
+  size_t a = 0;
+  size_t b = 0;
+  cycles::registerStatsSink("a", [&a](const cycles::CycleStats&) { ++a; });
+  cycles::registerStatsSink("b", [&b](const cycles::CycleStats&) { ++b; });
+
+  cycles::startExtracting();
+  {
+    cycles::IntervalGuard ig;
+    cycles::label(1, 2);
+  }
+
+  cycles::stopExtracting();
+  EXPECT_EQ(a, b);
+
+  cycles::unregisterStatsSink("a");
+  const auto aBefore = a;
+  cycles::startExtracting();
+  cycles::stopExtracting();
+  EXPECT_EQ(aBefore, a);
+
+  cycles::unregisterStatsSink("b");
+}
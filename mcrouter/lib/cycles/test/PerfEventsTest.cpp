@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/cycles/PerfEvents.h"
+
+using namespace facebook::memcache::cycles;
+
+TEST(PerfCounters, arithmetic) {
+  PerfCounters a;
+  a.llcMisses = 100;
+  a.stalledCycles = 2000;
+  a.branchMisses = 30;
+
+  PerfCounters b;
+  b.llcMisses = 40;
+  b.stalledCycles = 500;
+  b.branchMisses = 10;
+
+  auto diff = a - b;
+  EXPECT_EQ(60, diff.llcMisses);
+  EXPECT_EQ(1500, diff.stalledCycles);
+  EXPECT_EQ(20, diff.branchMisses);
+
+  diff += b;
+  EXPECT_EQ(100, diff.llcMisses);
+  EXPECT_EQ(2000, diff.stalledCycles);
+  EXPECT_EQ(30, diff.branchMisses);
+}
+
+TEST(PerfEventGroup, read) {
+  PerfEventGroup group;
+  if (!group.usable()) {
+    // No PMU available (e.g. virtual machine) or perf_event_paranoid
+    // is too restrictive. Unusable groups must read as zeros.
+    auto counters = group.read();
+    EXPECT_EQ(0, counters.llcMisses);
+    EXPECT_EQ(0, counters.stalledCycles);
+    EXPECT_EQ(0, counters.branchMisses);
+    return;
+  }
+
+  auto before = group.read();
+  // Touch some memory to make the counters move.
+  std::vector<size_t> v(1 << 20);
+  for (size_t i = 0; i < v.size(); ++i) {
+    v[i] = i;
+  }
+  auto after = group.read();
+
+  EXPECT_GE(after.llcMisses, before.llcMisses);
+  EXPECT_GE(after.stalledCycles, before.stalledCycles);
+  EXPECT_GE(after.branchMisses, before.branchMisses);
+}
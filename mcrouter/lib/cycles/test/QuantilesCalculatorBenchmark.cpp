@@ -40,7 +40,7 @@ BENCHMARK_RELATIVE(Boost, n) {
   folly::doNotOptimizeAway(res);
 }
 
-BENCHMARK_RELATIVE(Gk, n) {
+BENCHMARK_RELATIVE(Sketch, n) {
   QuantilesCalculator<uint64_t> qc(0.01);
   for (size_t i = 0; i < n; ++i) {
     qc.insert(folly::Random::rand32());
@@ -49,17 +49,22 @@ BENCHMARK_RELATIVE(Gk, n) {
   folly::doNotOptimizeAway(res);
 }
 
-/**
- * -bm_min_iters=1000000
- *
- * ============================================================================
- * QuantilesCalculatorBenchmark.cpp                relative  time/iter  iters/s
- * ============================================================================
- * Exact                                                       87.04ns   11.49M
- * Boost                                            180.22%    48.30ns   20.71M
- * Gk                                               223.97%    38.86ns   25.73M
- * ============================================================================
- */
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(SketchMerge, n) {
+  QuantilesCalculator<uint64_t> a(0.01);
+  QuantilesCalculator<uint64_t> b(0.01);
+  BENCHMARK_SUSPEND {
+    for (size_t i = 0; i < 1000; ++i) {
+      a.insert(folly::Random::rand32());
+      b.insert(folly::Random::rand32());
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    a.merge(b);
+  }
+  folly::doNotOptimizeAway(a.query(0.5));
+}
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
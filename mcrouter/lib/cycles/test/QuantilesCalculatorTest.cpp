@@ -21,6 +21,17 @@
 using namespace facebook::memcache::cycles;
 using namespace facebook::memcache::cycles::test;
 
+namespace {
+
+// The sketch promises a value within eps relative error of the true
+// quantile value.
+void expectClose(uint64_t expected, uint64_t actual, double eps) {
+  EXPECT_GE(actual, expected - expected * eps);
+  EXPECT_LE(actual, expected + expected * eps);
+}
+
+} // anonymous namespace
+
 TEST(QuantilesCalculator, empty) {
   QuantilesCalculator<uint64_t> qc(0.001);
   EXPECT_EQ(std::numeric_limits<uint64_t>::max(), qc.query(0.5));
@@ -31,18 +42,22 @@ TEST(QuantilesCalculator, basic) {
   for (int i = 1; i <= 10; ++i) {
     qc.insert(i);
   }
+  // Small values are counted exactly.
   EXPECT_EQ(5, qc.query(0.5));
+  EXPECT_EQ(1, qc.query(0.0));
+  EXPECT_EQ(10, qc.query(1.0));
   EXPECT_EQ(10, qc.size());
 }
 
 TEST(QuantilesCalculator, basicRandom) {
-  QuantilesCalculator<uint64_t> qc(0.001);
+  const double eps = 0.001;
+  QuantilesCalculator<uint64_t> qc(eps);
   ExactCalculator e;
   for (int i = 0; i < 30; ++i) {
     uint64_t num = folly::Random::rand64();
     qc.insert(num);
     e.insert(num);
-    EXPECT_EQ(e.query(0.5), qc.query(0.5));
+    expectClose(e.query(0.5), qc.query(0.5), eps);
   }
 }
 
@@ -57,8 +72,8 @@ TEST(QuantilesCalculator, repeatedPrecision) {
     }
   }
 
-  EXPECT_GE(qc.query(0.5), e.query(0.5 - eps));
-  EXPECT_LE(qc.query(0.5), e.query(0.5 + eps));
+  expectClose(e.query(0.5), qc.query(0.5), eps);
+  expectClose(e.query(0.99), qc.query(0.99), eps);
 }
 
 TEST(QuantilesCalculator, randomPrecision) {
@@ -71,8 +86,8 @@ TEST(QuantilesCalculator, randomPrecision) {
     e.insert(num);
   }
 
-  EXPECT_GE(qc.query(0.5), e.query(0.5 - eps));
-  EXPECT_LE(qc.query(0.5), e.query(0.5 + eps));
+  expectClose(e.query(0.5), qc.query(0.5), eps);
+  expectClose(e.query(0.99), qc.query(0.99), eps);
 }
 
 TEST(QuantilesCalculator, normalDistributionPrecision) {
@@ -85,18 +100,57 @@ TEST(QuantilesCalculator, normalDistributionPrecision) {
     e.insert(num);
   }
 
-  EXPECT_GE(qc.query(0.5), e.query(0.5 - eps));
-  EXPECT_LE(qc.query(0.5), e.query(0.5 + eps));
+  expectClose(e.query(0.5), qc.query(0.5), eps);
+  expectClose(e.query(0.99), qc.query(0.99), eps);
+}
+
+TEST(QuantilesCalculator, merge) {
+  const double eps = 0.005;
+  QuantilesCalculator<uint64_t> a(eps);
+  QuantilesCalculator<uint64_t> b(eps);
+  ExactCalculator e;
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t num = normalRnd();
+    a.insert(num);
+    e.insert(num);
+  }
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t num = folly::Random::rand32();
+    b.insert(num);
+    e.insert(num);
+  }
+
+  a.merge(b);
+  EXPECT_EQ(200000, a.size());
+  expectClose(e.query(0.5), a.query(0.5), eps);
+  expectClose(e.query(0.99), a.query(0.99), eps);
+}
+
+TEST(QuantilesCalculator, mergeEmpty) {
+  QuantilesCalculator<uint64_t> a(0.005);
+  QuantilesCalculator<uint64_t> b(0.005);
+  for (int i = 1; i <= 10; ++i) {
+    a.insert(i);
+  }
+
+  a.merge(b);
+  EXPECT_EQ(10, a.size());
+  EXPECT_EQ(5, a.query(0.5));
+
+  b.merge(a);
+  EXPECT_EQ(10, b.size());
+  EXPECT_EQ(5, b.query(0.5));
 }
 
 TEST(QuantilesCalculator, size) {
   const double eps = 0.001;
   const size_t iters = 100000;
   QuantilesCalculator<uint64_t> qc(eps);
+  const uint64_t maxSize = qc.internalSize();
   for (size_t i = 1; i <= iters; ++i) {
     qc.insert(normalRnd());
-    uint64_t maxSize = (1 / eps) * std::log2(iters * eps);
-    EXPECT_LE(qc.internalSize(), maxSize);
+    // The bucket array is sized by eps alone and never grows.
+    EXPECT_EQ(maxSize, qc.internalSize());
   }
   EXPECT_EQ(iters, qc.size());
 }
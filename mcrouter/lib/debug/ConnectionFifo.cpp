@@ -151,14 +151,36 @@ bool ConnectionFifo::isConnected() const noexcept {
 bool ConnectionFifo::startMessage(
     MessageDirection direction,
     uint32_t typeId) noexcept {
+  return startMessage(direction,
+                      typeId,
+                      mc_unknown_protocol,
+                      0 /* reqId */,
+                      0 /* keyOffset */,
+                      0 /* keySize */);
+}
+
+bool ConnectionFifo::startMessage(
+    MessageDirection direction,
+    uint32_t typeId,
+    mc_protocol_t protocol,
+    uint64_t reqId,
+    uint32_t keyOffset,
+    uint16_t keySize) noexcept {
   if (!isConnected()) {
     return false;
   }
   currentMessageHeader_.setDirection(direction);
   currentMessageHeader_.setTypeId(typeId);
   currentMessageHeader_.setTimeUs(timeSinceEpoch());
+  currentMessageHeader_.setRouterProtocol(protocol);
+  currentMessageHeader_.setReqId(reqId);
+  currentMessageHeader_.setKeyOffset(keyOffset);
+  currentMessageHeader_.setKeySize(keySize);
   nextPacketId_ = 0;
-  return true;
+  currentFilter_ = debugFifo_->debugFilter();
+  dropCurrentMessage_ =
+      currentFilter_ && !currentFilter_->matchesTypeId(typeId);
+  return !dropCurrentMessage_;
 }
 
 bool ConnectionFifo::writeData(const void* buf, size_t len) noexcept {
@@ -214,10 +236,26 @@ bool ConnectionFifo::writeData(
   // | PACKET HEADER | PACKET BODY |
   // -------------------------------
 
-  if (!isConnected()) {
+  if (!isConnected() || dropCurrentMessage_) {
     return false;
   }
 
+  // Data and size predicates are evaluated against the first write of
+  // the message - callers hand the whole serialized message to the first
+  // writeData() call, except for streamed ascii replies, which are
+  // judged by their leading chunk.
+  if (currentFilter_ && nextPacketId_ == 0) {
+    size_t messageSize = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+      messageSize += iov[i].iov_len;
+    }
+    if (!currentFilter_->matchesSize(messageSize) ||
+        !currentFilter_->matchesData(iov, iovcnt)) {
+      dropCurrentMessage_ = true;
+      return false;
+    }
+  }
+
   PipeIov pipeIov;
   IovecIterator iovIter(iov, iovcnt);
 
@@ -48,11 +48,32 @@ class ConnectionFifo {
   /**
    * Starts a new message.
    *
+   * If the reader pushed a capture filter down to the underlying FIFO,
+   * messages failing it are dropped here and in writeData(), before any
+   * data is copied to the pipe.
+   *
    * @param direction   Whether the data was received or sent by connection.
    * @param typeId      Id of the type of the message.
    */
   bool startMessage(MessageDirection direction, uint32_t typeId) noexcept;
 
+  /**
+   * Starts a new message, additionally carrying parse metadata the
+   * writer already knows at capture time (see MessageHeader), so
+   * readers can index and filter messages without parsing their bodies.
+   *
+   * @param protocol    Protocol of the captured stream.
+   * @param reqId       Id of the request; 0 if unknown (e.g. ascii).
+   * @param keyOffset   Offset of the key within the message data.
+   * @param keySize     Size of the key; 0 if its position is unknown.
+   */
+  bool startMessage(MessageDirection direction,
+                    uint32_t typeId,
+                    mc_protocol_t protocol,
+                    uint64_t reqId,
+                    uint32_t keyOffset,
+                    uint16_t keySize) noexcept;
+
   /**
    * Writes data to the FIFO, but only if there is reader (i.e. mcpiper)
    * connected to it.
@@ -67,6 +88,11 @@ class ConnectionFifo {
   std::shared_ptr<Fifo> debugFifo_;
   MessageHeader currentMessageHeader_;
   uint32_t nextPacketId_{0};
+
+  // Capture filter snapshot taken at startMessage(), so all chunks of a
+  // message are judged by the same filter.
+  std::shared_ptr<const FifoDebugFilter> currentFilter_;
+  bool dropCurrentMessage_{false};
 };
 
 } // memcache
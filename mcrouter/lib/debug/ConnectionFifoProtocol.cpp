@@ -48,10 +48,16 @@ folly::SocketAddress MessageHeader::getPeerAddress() {
   switch (v) {
     case 1:
       return sizeof(MessageHeader) - sizeof(localPort_) - sizeof(direction_) -
-          sizeof(typeId_) - sizeof(timeUs_);
+          sizeof(typeId_) - sizeof(timeUs_) - sizeof(routerProtocol_) -
+          sizeof(reqId_) - sizeof(keyOffset_) - sizeof(keySize_);
     case 2:
-      return sizeof(MessageHeader) - sizeof(typeId_) - sizeof(timeUs_);
+      return sizeof(MessageHeader) - sizeof(typeId_) - sizeof(timeUs_) -
+          sizeof(routerProtocol_) - sizeof(reqId_) - sizeof(keyOffset_) -
+          sizeof(keySize_);
     case 3:
+      return sizeof(MessageHeader) - sizeof(routerProtocol_) -
+          sizeof(reqId_) - sizeof(keyOffset_) - sizeof(keySize_);
+    case 4:
       return sizeof(MessageHeader);
     default:
       throw std::logic_error(folly::sformat("Invalid version {}", v));
@@ -15,6 +15,8 @@
 #include <folly/Portability.h>
 #include <folly/SocketAddress.h>
 
+#include "mcrouter/lib/mc/protocol.h"
+
 namespace facebook {
 namespace memcache {
 
@@ -60,6 +62,18 @@ struct FOLLY_PACK_ATTR MessageHeader {
   uint64_t timeUs() const {
     return folly::Endian::little(timeUs_);
   }
+  mc_protocol_t routerProtocol() const {
+    return static_cast<mc_protocol_t>(routerProtocol_);
+  }
+  uint64_t reqId() const {
+    return folly::Endian::little(reqId_);
+  }
+  uint32_t keyOffset() const {
+    return folly::Endian::little(keyOffset_);
+  }
+  uint16_t keySize() const {
+    return folly::Endian::little(keySize_);
+  }
 
   char* peerIpAddressModifiable() {
     return peerIpAddress_;
@@ -82,6 +96,18 @@ struct FOLLY_PACK_ATTR MessageHeader {
   void setTimeUs(uint64_t val) {
     timeUs_ = folly::Endian::little(val);
   }
+  void setRouterProtocol(mc_protocol_t val) {
+    routerProtocol_ = static_cast<uint8_t>(val);
+  }
+  void setReqId(uint64_t val) {
+    reqId_ = folly::Endian::little(val);
+  }
+  void setKeyOffset(uint32_t val) {
+    keyOffset_ = folly::Endian::little(val);
+  }
+  void setKeySize(uint16_t val) {
+    keySize_ = folly::Endian::little(val);
+  }
 
   folly::SocketAddress getLocalAddress();
   folly::SocketAddress getPeerAddress();
@@ -91,7 +117,7 @@ struct FOLLY_PACK_ATTR MessageHeader {
  private:
   // Control fields
   uint32_t magic_ = folly::Endian::little<uint32_t>(0xfaceb00c);
-  uint8_t version_{3};
+  uint8_t version_{4};
 
   // Peer address fields
   char peerIpAddress_[kIpAddressMaxSize]{'\0'}; // 0-terminated string of ip
@@ -111,6 +137,19 @@ struct FOLLY_PACK_ATTR MessageHeader {
 
   // Number of micro-seconds elapsed sience epoch.
   uint64_t timeUs_{0};
+
+  /* Parse metadata known at capture time (version 4+), so readers can
+     index and filter messages without parsing their bodies. All fields
+     are best effort; 0 means unknown. */
+
+  // Protocol of the captured stream (mc_protocol_t).
+  uint8_t routerProtocol_{mc_unknown_protocol};
+  // Id of the request (umbrella/caret); 0 for ascii.
+  uint64_t reqId_{0};
+  // Position of the key within the message data; only set by writers
+  // that know it without re-parsing (keySize_ == 0 means not set).
+  uint32_t keyOffset_{0};
+  uint16_t keySize_{0};
 };
 
 /**
@@ -65,6 +65,23 @@ Fifo::~Fifo() {
       PLOG(ERROR) << "Error removing debug fifo file";
     }
   }
+  auto filterPath = path_ + ".filter";
+  if (exists(filterPath.c_str())) {
+    removeFile(filterPath.c_str());
+  }
+}
+
+std::shared_ptr<const FifoDebugFilter> Fifo::debugFilter() const noexcept {
+  return std::atomic_load_explicit(&debugFilter_, std::memory_order_acquire);
+}
+
+void Fifo::loadDebugFilter() noexcept {
+  auto filter = FifoDebugFilter::fromFile(path_ + ".filter");
+  if (filter) {
+    VLOG(1) << "Capture filter active for debug fifo \"" << path_ << "\"";
+  }
+  std::atomic_store_explicit(
+      &debugFilter_, std::move(filter), std::memory_order_release);
 }
 
 bool Fifo::isConnected() const noexcept {
@@ -12,8 +12,11 @@
 #include <sys/uio.h>
 
 #include <atomic>
+#include <memory>
 #include <string>
 
+#include "mcrouter/lib/debug/FifoDebugFilter.h"
+
 namespace facebook {
 namespace memcache {
 
@@ -27,7 +30,7 @@ namespace memcache {
  */
 class Fifo {
  public:
-  ~Fifo();
+  virtual ~Fifo();
 
   // non copyable
   Fifo(const Fifo& other) = delete;
@@ -44,12 +47,12 @@ class Fifo {
    * @return  True if the pipe is already connected or connection
    *          was established successfully. False otherwise.
    */
-  bool tryConnect() noexcept;
+  virtual bool tryConnect() noexcept;
 
   /**
    * Tells whether this fifo is connectted.
    */
-  bool isConnected() const noexcept;
+  virtual bool isConnected() const noexcept;
 
   /**
    * Writes data to the FIFO.
@@ -62,17 +65,37 @@ class Fifo {
    *
    * @return            True if the data was written. False otherwise.
    */
-  bool write(const struct iovec* iov, size_t iovcnt) noexcept;
+  virtual bool write(const struct iovec* iov, size_t iovcnt) noexcept;
   bool write(void* buf, size_t len) noexcept;
 
- private:
+  /**
+   * Capture filter pushed down by the attached reader, or nullptr to
+   * capture everything. Loaded from "<path>.filter" by the FifoManager
+   * thread when a reader connects and dropped when it goes away.
+   */
+  std::shared_ptr<const FifoDebugFilter> debugFilter() const noexcept;
+
+  /**
+   * (Re)loads the filter spec file. Called by the FifoManager thread on
+   * a not-connected -> connected transition; an absent or empty spec
+   * file resets the fifo to unfiltered capture.
+   */
+  void loadDebugFilter() noexcept;
+
+ protected:
   explicit Fifo(std::string path);
 
   // Path of the fifo
   const std::string path_;
+
+ private:
   // Fifo file descriptor.
   std::atomic<int> fd_{-1};
 
+  // Accessed with std::atomic_load/std::atomic_store: written by the
+  // FifoManager thread, read by the connection thread per message.
+  std::shared_ptr<const FifoDebugFilter> debugFilter_;
+
   /**
    * Disconnects the pipe.
    */
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "FifoDebugFilter.h"
+
+#include <limits.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+
+namespace facebook {
+namespace memcache {
+
+namespace {
+
+/* Keys sit near the front of the serialized message in every protocol;
+   one pipe packet is more than enough to find them. */
+constexpr size_t kDataScanLimit = PIPE_BUF;
+
+} // anonymous namespace
+
+bool FifoDebugFilter::matchesTypeId(uint32_t typeId) const noexcept {
+  if (typeIds.empty() || typeId == 0) {
+    return true;
+  }
+  return std::find(typeIds.begin(), typeIds.end(), typeId) != typeIds.end();
+}
+
+bool FifoDebugFilter::matchesData(
+    const struct iovec* iov, size_t iovcnt) const noexcept {
+  if (keyPrefix.empty()) {
+    return true;
+  }
+
+  char buf[kDataScanLimit];
+  size_t len = 0;
+  for (size_t i = 0; i < iovcnt && len < sizeof(buf); ++i) {
+    const size_t toCopy = std::min(iov[i].iov_len, sizeof(buf) - len);
+    std::memcpy(buf + len, iov[i].iov_base, toCopy);
+    len += toCopy;
+  }
+  return memmem(buf, len, keyPrefix.data(), keyPrefix.size()) != nullptr;
+}
+
+std::shared_ptr<const FifoDebugFilter> FifoDebugFilter::fromSpec(
+    folly::StringPiece spec) noexcept {
+  auto filter = std::make_shared<FifoDebugFilter>();
+  bool hasPredicate = false;
+
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', spec, lines);
+  for (auto line : lines) {
+    line = folly::trimWhitespace(line);
+    if (line.empty() || line.startsWith('#')) {
+      continue;
+    }
+    auto eq = line.find('=');
+    if (eq == std::string::npos) {
+      LOG(WARNING) << "Malformed debug filter line: \"" << line << "\"";
+      return nullptr;
+    }
+    const auto name = line.subpiece(0, eq);
+    const auto value = line.subpiece(eq + 1);
+    try {
+      if (name == "key_prefix") {
+        filter->keyPrefix = value.str();
+        hasPredicate |= !filter->keyPrefix.empty();
+      } else if (name == "type_ids") {
+        std::vector<folly::StringPiece> ids;
+        folly::split(',', value, ids, /* ignoreEmpty */ true);
+        for (const auto& id : ids) {
+          filter->typeIds.push_back(folly::to<uint32_t>(id));
+        }
+        hasPredicate |= !filter->typeIds.empty();
+      } else if (name == "min_size") {
+        filter->minSize = folly::to<uint64_t>(value);
+        hasPredicate = true;
+      } else if (name == "max_size") {
+        filter->maxSize = folly::to<uint64_t>(value);
+        hasPredicate = true;
+      } else {
+        /* Unknown predicates are fatal rather than ignored: silently
+           capturing more than a newer reader asked for is fine, the
+           other way around is not, so be conservative and capture all. */
+        LOG(WARNING) << "Unknown debug filter predicate: \"" << name << "\"";
+        return nullptr;
+      }
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "Bad debug filter value for \"" << name
+                   << "\": " << e.what();
+      return nullptr;
+    }
+  }
+
+  return hasPredicate ? std::move(filter) : nullptr;
+}
+
+std::shared_ptr<const FifoDebugFilter> FifoDebugFilter::fromFile(
+    const std::string& path) noexcept {
+  std::string spec;
+  if (!folly::readFile(path.c_str(), spec)) {
+    return nullptr;
+  }
+  return fromSpec(spec);
+}
+
+} // memcache
+} // facebook
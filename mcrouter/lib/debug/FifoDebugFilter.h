@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Capture filter evaluated on the writer side of a debug fifo, before
+ * any traffic is copied into it. A reader (mcpiper) that only cares
+ * about a narrow slice of traffic pushes its predicates down by placing
+ * a spec file at "<fifoPath>.filter" before attaching; the FifoManager
+ * thread loads it when the reader connects, and messages failing the
+ * filter are dropped in ConnectionFifo without a single pipe write.
+ *
+ * The spec is line-based "name=value" (lines starting with '#' are
+ * ignored):
+ *   key_prefix=<bytes>     drop messages not containing these bytes
+ *   type_ids=<id,id,...>   keep only these message type ids
+ *   min_size=<bytes>       drop messages smaller than this
+ *   max_size=<bytes>       drop messages larger than this
+ *
+ * The filter is best effort in the keep direction: ascii messages carry
+ * type id 0 and always pass the type predicate, and the key prefix is
+ * matched as a byte substring of the serialized message, so the reader
+ * must still apply its own exact filtering. It never drops less than
+ * requested traffic classes promise, which is what makes the capture
+ * cost proportional to matched traffic.
+ */
+struct FifoDebugFilter {
+  std::string keyPrefix;
+  std::vector<uint32_t> typeIds;
+  uint64_t minSize{0};
+  uint64_t maxSize{std::numeric_limits<uint64_t>::max()};
+
+  /**
+   * Type predicate; type id 0 (ascii, unknown) always passes.
+   */
+  bool matchesTypeId(uint32_t typeId) const noexcept;
+
+  bool matchesSize(size_t messageSize) const noexcept {
+    return messageSize >= minSize && messageSize <= maxSize;
+  }
+
+  /**
+   * Substring search for keyPrefix over the leading bytes of the
+   * message (at most one pipe packet worth). Always true if no prefix
+   * is configured.
+   */
+  bool matchesData(const struct iovec* iov, size_t iovcnt) const noexcept;
+
+  /**
+   * Parses a spec (see above). Returns nullptr if the spec holds no
+   * predicates or can't be parsed - i.e. everything should be captured.
+   */
+  static std::shared_ptr<const FifoDebugFilter> fromSpec(
+      folly::StringPiece spec) noexcept;
+
+  /**
+   * Loads and parses "<path>". Returns nullptr if the file does not
+   * exist or holds no predicates.
+   */
+  static std::shared_ptr<const FifoDebugFilter> fromFile(
+      const std::string& path) noexcept;
+};
+
+} // memcache
+} // facebook
@@ -16,6 +16,8 @@
 
 #include <folly/Format.h>
 
+#include "mcrouter/lib/debug/RingFifo.h"
+
 namespace facebook { namespace memcache {
 
 namespace {
@@ -37,7 +39,14 @@ FifoManager::FifoManager() {
       {
         folly::SharedMutex::ReadHolder lockGuard(fifosMutex_);
         for (auto& it : fifos_) {
-          it.second->tryConnect();
+          auto& fifo = it.second;
+          bool wasConnected = fifo->isConnected();
+          if (fifo->tryConnect() && !wasConnected) {
+            // Pick up the capture filter the reader may have pushed down
+            // (a "<path>.filter" spec file) before attaching. Readers
+            // without a spec file reset the fifo to unfiltered capture.
+            fifo->loadDebugFilter();
+          }
         }
       }
 
@@ -62,18 +71,23 @@ FifoManager::~FifoManager() {
   thread_.join();
 }
 
-std::shared_ptr<Fifo> FifoManager::fetch(const std::string& fifoPath) {
+std::shared_ptr<Fifo> FifoManager::fetch(const std::string& fifoPath,
+                                         size_t ringBytes) {
   if (auto debugFifo = find(fifoPath)) {
     return debugFifo;
   }
-  return createAndStore(fifoPath);
+  return createAndStore(fifoPath, ringBytes);
 }
 
 std::shared_ptr<Fifo> FifoManager::fetchThreadLocal(
-    const std::string& fifoBasePath) {
+    const std::string& fifoBasePath, size_t ringBytes) {
   CHECK(!fifoBasePath.empty()) << "Fifo base path must not be empty";
 
-  return fetch(folly::sformat("{0}.{1}", fifoBasePath, gettid()));
+  if (ringBytes > 0) {
+    return fetch(folly::sformat("{0}.{1}.ring", fifoBasePath, gettid()),
+                 ringBytes);
+  }
+  return fetch(folly::sformat("{0}.{1}", fifoBasePath, gettid()), 0);
 }
 
 std::shared_ptr<Fifo> FifoManager::find(const std::string& fifoPath) {
@@ -85,9 +99,13 @@ std::shared_ptr<Fifo> FifoManager::find(const std::string& fifoPath) {
   return nullptr;
 }
 
-std::shared_ptr<Fifo> FifoManager::createAndStore(const std::string& fifoPath) {
+std::shared_ptr<Fifo> FifoManager::createAndStore(const std::string& fifoPath,
+                                                  size_t ringBytes) {
   folly::SharedMutex::WriteHolder lockGuard(fifosMutex_);
-  auto it = fifos_.emplace(fifoPath, std::shared_ptr<Fifo>(new Fifo(fifoPath)));
+  auto fifo = ringBytes > 0
+      ? std::shared_ptr<Fifo>(new RingFifo(fifoPath, ringBytes))
+      : std::shared_ptr<Fifo>(new Fifo(fifoPath));
+  auto it = fifos_.emplace(fifoPath, std::move(fifo));
   return it.first->second;
 }
 
@@ -33,14 +33,19 @@ class FifoManager {
   /**
    * Fetches (creates if not found) a fifo by its full base path + threadId.
    * The final path of the returned fifo will have the following format:
-   * "{fifoBasePath}.{threadId}".
+   * "{fifoBasePath}.{threadId}" for pipes, "{fifoBasePath}.{threadId}.ring"
+   * for shared-memory rings.
    * At any given point in time, this instance manages at most one fifo per
    * basePath/threadId pair.
    *
    * @param fifoBasePath  Base path of the fifo.
+   * @param ringBytes     If nonzero, back the fifo with a shared-memory
+   *                      ring of this many bytes (see RingFifo) instead
+   *                      of a named pipe.
    * @return              The "thread_local" fifo.
    */
-  std::shared_ptr<Fifo> fetchThreadLocal(const std::string& fifoBasePath);
+  std::shared_ptr<Fifo> fetchThreadLocal(const std::string& fifoBasePath,
+                                         size_t ringBytes = 0);
 
   /**
    * Removes all elements from the fifo manager.
@@ -69,10 +74,11 @@ class FifoManager {
    * Fetches a fifo by its full path. If the fifo does not
    * exist yet, creates it and returns it to the caller.
    *
-   * @param fifoPath  Full path of the fifo.
-   * @return          The fifo.
+   * @param fifoPath   Full path of the fifo.
+   * @param ringBytes  Ring capacity, or 0 for a named pipe.
+   * @return           The fifo.
    */
-  std::shared_ptr<Fifo> fetch(const std::string& fifoPath);
+  std::shared_ptr<Fifo> fetch(const std::string& fifoPath, size_t ringBytes);
 
   /**
    * Finds a fifo by its full path. If not found, returns null.
@@ -85,10 +91,12 @@ class FifoManager {
   /**
    * Creates a fifo and stores it into the map.
    *
-   * @param fifoPath  Full path of the fifo.
-   * @return          The newly created fifo.
+   * @param fifoPath   Full path of the fifo.
+   * @param ringBytes  Ring capacity, or 0 for a named pipe.
+   * @return           The newly created fifo.
    */
-  std::shared_ptr<Fifo> createAndStore(const std::string& fifoPath);
+  std::shared_ptr<Fifo> createAndStore(const std::string& fifoPath,
+                                       size_t ringBytes);
 
   friend class folly::Singleton<FifoManager>;
 };
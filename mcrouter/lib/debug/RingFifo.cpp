@@ -0,0 +1,162 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "RingFifo.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include <folly/Bits.h>
+#include <folly/FileUtil.h>
+
+namespace facebook {
+namespace memcache {
+
+namespace {
+
+// How long a reader heartbeat stays valid. mcpiper refreshes it every
+// few milliseconds, so a couple of seconds of slack is plenty.
+constexpr uint64_t kReaderLeaseUs = 2 * 1000 * 1000;
+
+uint64_t wallTimeUs() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // anonymous namespace
+
+RingFifo::RingFifo(std::string path, size_t capacityBytes)
+    : Fifo(std::move(path)),
+      capacity_(folly::nextPowTwo(std::max(capacityBytes, kMinCapacity))) {}
+
+RingFifo::~RingFifo() {
+  if (auto* header = header_.exchange(nullptr)) {
+    munmap(header, sizeof(RingFileHeader) + capacity_);
+    data_ = nullptr;
+  }
+  if (mapFd_ >= 0) {
+    close(mapFd_);
+    mapFd_ = -1;
+  }
+  // ~Fifo() removes the ring file.
+}
+
+bool RingFifo::tryConnect() noexcept {
+  if (header_.load(std::memory_order_relaxed) != nullptr) {
+    return true;
+  }
+
+  int fd = folly::openNoInt(path_.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    static bool logged{false};
+    if (!logged) {
+      VLOG(1) << "Error creating debug ring at \"" << path_ << "\": "
+              << strerror(errno) << " [" << errno << "]";
+      logged = true;
+    }
+    return false;
+  }
+
+  const size_t fileSize = sizeof(RingFileHeader) + capacity_;
+  if (ftruncate(fd, fileSize) != 0) {
+    PLOG(WARNING) << "Error sizing debug ring \"" << path_ << "\"";
+    close(fd);
+    return false;
+  }
+
+  void* mem =
+      mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED) {
+    PLOG(WARNING) << "Error mapping debug ring \"" << path_ << "\"";
+    close(fd);
+    return false;
+  }
+
+  // The writer owns the file: (re)initialize the header so a stale file
+  // from a previous run starts a fresh stream.
+  auto header = reinterpret_cast<RingFileHeader*>(mem);
+  header->magic = kRingFileMagic;
+  header->version = 1;
+  header->capacity = capacity_;
+  header->writePos.store(0, std::memory_order_relaxed);
+  header->droppedRecords.store(0, std::memory_order_relaxed);
+  header->readPos.store(0, std::memory_order_relaxed);
+  header->readerHeartbeatUs.store(0, std::memory_order_release);
+
+  mapFd_ = fd;
+  data_ = reinterpret_cast<char*>(mem) + sizeof(RingFileHeader);
+  header_.store(header, std::memory_order_release);
+  return true;
+}
+
+bool RingFifo::isConnected() const noexcept {
+  auto* header = header_.load(std::memory_order_acquire);
+  if (header == nullptr) {
+    return false;
+  }
+  auto heartbeat = header->readerHeartbeatUs.load(std::memory_order_relaxed);
+  return heartbeat != 0 && wallTimeUs() - heartbeat < kReaderLeaseUs;
+}
+
+void RingFifo::copyIn(uint64_t offset, const void* buf, size_t len) noexcept {
+  const size_t pos = offset & (capacity_ - 1);
+  const size_t firstChunk = std::min(len, capacity_ - pos);
+  std::memcpy(data_ + pos, buf, firstChunk);
+  if (len > firstChunk) {
+    std::memcpy(data_,
+                reinterpret_cast<const char*>(buf) + firstChunk,
+                len - firstChunk);
+  }
+}
+
+bool RingFifo::write(const struct iovec* iov, size_t iovcnt) noexcept {
+  if (!isConnected()) {
+    return false;
+  }
+  auto* header = header_.load(std::memory_order_acquire);
+
+  size_t payloadSize = 0;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    payloadSize += iov[i].iov_len;
+  }
+
+  RingRecordHeader record;
+  record.size = payloadSize;
+  record.seqId = nextSeqId_++;
+  record.timeUs = wallTimeUs();
+
+  const size_t recordSize = sizeof(RingRecordHeader) + payloadSize;
+  const auto writePos = header->writePos.load(std::memory_order_relaxed);
+  const auto readPos = header->readPos.load(std::memory_order_acquire);
+  if (recordSize > capacity_ || writePos - readPos + recordSize > capacity_) {
+    header->droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  copyIn(writePos, &record, sizeof(RingRecordHeader));
+  uint64_t offset = writePos + sizeof(RingRecordHeader);
+  for (size_t i = 0; i < iovcnt; ++i) {
+    copyIn(offset, iov[i].iov_base, iov[i].iov_len);
+    offset += iov[i].iov_len;
+  }
+  header->writePos.store(writePos + recordSize, std::memory_order_release);
+
+  return true;
+}
+
+} // memcache
+} // facebook
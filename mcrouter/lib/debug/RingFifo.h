@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "mcrouter/lib/debug/Fifo.h"
+#include "mcrouter/lib/debug/RingFifoProtocol.h"
+
+namespace facebook {
+namespace memcache {
+
+/**
+ * Shared-memory ring variant of Fifo, for always-on capture.
+ *
+ * Instead of block-writing packets into a named pipe, writes are
+ * memcpy'd into a memory-mapped file laid out as RingFileHeader plus a
+ * power-of-two data area.  The ring is lock-free single-writer (the
+ * proxy thread owning this fifo) single-reader (mcpiper): the writer
+ * publishes writePos with a release store, the reader publishes
+ * readPos, and a write that doesn't fit between the two is dropped and
+ * counted instead of blocking.  A write is at most two memcpys and
+ * never a syscall, so enabling capture on a loaded box doesn't perturb
+ * request latency the way pipe writes do.
+ *
+ * The fifo counts as connected only while a reader keeps the heartbeat
+ * in the header fresh, mirroring the open-for-read semantics of pipes.
+ */
+class RingFifo : public Fifo {
+ public:
+  ~RingFifo() override;
+
+  /**
+   * Creates and maps the ring file (if not already mapped).
+   * Note: This method is not thread-safe.
+   */
+  bool tryConnect() noexcept override final;
+
+  /**
+   * Tells whether the ring is mapped and a reader is attached.
+   */
+  bool isConnected() const noexcept override final;
+
+  /**
+   * Copies one timestamped record into the ring, or drops it if the
+   * ring is full (returns false).  May only be called by the thread
+   * owning this fifo.
+   */
+  bool write(const struct iovec* iov, size_t iovcnt) noexcept override final;
+
+ private:
+  RingFifo(std::string path, size_t capacityBytes);
+
+  // Minimum data area size; requested capacities are rounded up to a
+  // power of two.
+  static constexpr size_t kMinCapacity = 4096;
+
+  // tryConnect() runs on the FifoManager thread, so the mapping is
+  // published through an atomic (like Fifo's fd_): data_ and mapFd_ are
+  // set before the release store of header_.
+  std::atomic<RingFileHeader*> header_{nullptr};
+  char* data_{nullptr};
+  const size_t capacity_;
+  int mapFd_{-1};
+  uint64_t nextSeqId_{0};
+
+  void copyIn(uint64_t offset, const void* buf, size_t len) noexcept;
+
+  friend class FifoManager;
+};
+
+} // memcache
+} // facebook
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <folly/Portability.h>
+
+namespace facebook {
+namespace memcache {
+
+constexpr uint32_t kRingFileMagic = 0xfaceb0b0;
+constexpr uint32_t kRingRecordMagic = 0xfaceb0b1;
+
+/**
+ * Header page of a shared-memory ring fifo file (see RingFifo).
+ *
+ * The file is mapped by exactly one writer (the proxy thread owning the
+ * fifo) and at most one reader (mcpiper).  All positions are
+ * monotonically increasing byte offsets into the logical stream; the
+ * location in the data area that follows this header is
+ * offset & (capacity - 1).  Both sides run on the same host, so fields
+ * are stored in native byte order, unlike the pipe protocol.
+ *
+ * Writer- and reader-owned fields live on separate cache lines so the
+ * two processes don't false-share.
+ */
+struct RingFileHeader {
+  uint32_t magic{kRingFileMagic};
+  uint32_t version{1};
+  /** Size of the data area in bytes; always a power of two. */
+  uint64_t capacity{0};
+
+  /**
+   * Total bytes ever written.  Advanced with a release store after the
+   * record bytes are in place, so a reader that acquires it sees
+   * complete records only.
+   */
+  std::atomic<uint64_t> writePos{0};
+  /** Records dropped because the ring was full. */
+  std::atomic<uint64_t> droppedRecords{0};
+  char writerPad[64 - 2 * sizeof(uint32_t) - sizeof(uint64_t) -
+                 2 * sizeof(std::atomic<uint64_t>)];
+
+  /** Total bytes ever consumed by the reader. */
+  std::atomic<uint64_t> readPos{0};
+  /**
+   * Wall clock of the reader's last poll, in microseconds since epoch;
+   * 0 when no reader is attached.  The writer treats a stale value as
+   * "no reader" and skips capture work entirely, so an idle ring costs
+   * one clock read per message.
+   */
+  std::atomic<uint64_t> readerHeartbeatUs{0};
+  char readerPad[64 - 2 * sizeof(std::atomic<uint64_t>)];
+};
+static_assert(sizeof(RingFileHeader) == 128,
+              "RingFileHeader must be exactly two cache lines");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "RingFileHeader atomics must be plain words");
+
+/**
+ * Every Fifo::write() call becomes one timestamped record:
+ * RingRecordHeader immediately followed by size payload bytes (the
+ * same packet byte stream ConnectionFifo produces for pipes, so the
+ * reader parses both transports identically).  Records may wrap around
+ * the end of the data area.
+ */
+struct FOLLY_PACK_ATTR RingRecordHeader {
+  uint32_t magic{kRingRecordMagic};
+  /** Payload bytes following this header. */
+  uint32_t size{0};
+  /**
+   * Assigned to every record the writer attempts, including dropped
+   * ones, so a gap in consecutive ids tells the reader how many
+   * records were lost to a full ring.
+   */
+  uint64_t seqId{0};
+  /** Capture time, microseconds since epoch (wall clock). */
+  uint64_t timeUs{0};
+};
+static_assert(sizeof(RingRecordHeader) == 24,
+              "RingRecordHeader layout is part of the dump format");
+
+} // memcache
+} // facebook
@@ -29,8 +29,21 @@
 #define MIN(a, b) ((a) <= (b) ? (a) : (b))
 #define MAX(a, b) ((a) >= (b) ? (a) : (b))
 
+/* Bounds for the adaptive spin budget (iterations). */
+#define SEM_SPIN_MIN 32
+#define SEM_SPIN_MAX 4096
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 void counting_sem_init(counting_sem_t* sem, int32_t val) {
   sem->cnt = MAX(val, 0);
+  sem->spins = SEM_SPIN_MIN;
 }
 
 int32_t counting_sem_value(counting_sem_t* sem) {
@@ -64,6 +77,36 @@ static int32_t counting_sem_lazy_helper(counting_sem_t* sem, int32_t n,
     return 0;
   }
 
+  /*
+   * Contended case: poll the value for a while before sleeping. Most
+   * posts arrive within microseconds, and sleeping costs a futex
+   * syscall on both sides (the waiter's FUTEX_WAIT plus the poster's
+   * FUTEX_WAKE once the count goes negative). The budget adapts so
+   * that consistently slow posters don't make waiters burn CPU.
+   */
+  {
+    uint32_t budget = ACCESS_ONCE(sem->spins);
+    uint32_t i;
+    for (i = 0; i < budget && latest <= 0; i++) {
+      cpu_relax();
+      latest = ACCESS_ONCE(sem->cnt);
+    }
+    if (latest > 0) {
+      sem->spins = MIN(budget * 2, SEM_SPIN_MAX);
+      while (latest > 0) {
+        prev = latest;
+        attempt = MIN(n, prev);
+        latest = __sync_val_compare_and_swap(&sem->cnt, prev, prev - attempt);
+        if (latest == prev) {
+          return attempt;
+        }
+      }
+      /* Lost the race; fall through to the futex path. */
+    } else {
+      sem->spins = MAX(budget / 2, SEM_SPIN_MIN);
+    }
+  }
+
   /*
    * Otherwise we have to wait and try again.
    */
@@ -51,6 +51,12 @@ typedef struct counting_sem_s {
    * -1 means "the value is 0 and there's a thread waiting".
    */
   int32_t cnt;
+  /**
+   * Adaptive spin budget: how long a waiter polls the value before
+   * falling back to a futex sleep. Grows when spinning pays off and
+   * shrinks when it doesn't; updated racily, it's only a heuristic.
+   */
+  uint32_t spins;
 } counting_sem_t;
 
 /**
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cassert>
+#include <cstring>
+
+namespace facebook { namespace memcache {
+
+template <class Value>
+CompactTrie<Value>::CompactTrie(const Trie<Value>& trie) {
+  // Trie iteration is in lexicographic order of keys, which the
+  // recursive builder relies on.
+  for (const auto& it : trie) {
+    values_.emplace_back(it.first, it.second);
+  }
+  if (values_.empty()) {
+    return;
+  }
+
+  std::vector<const value_type*> items;
+  items.reserve(values_.size());
+  for (const auto& value : values_) {
+    items.push_back(&value);
+  }
+  buildNode(items.begin(), items.end(), 0);
+}
+
+template <class Value>
+uint32_t CompactTrie<Value>::buildNode(
+    typename std::vector<const value_type*>::const_iterator begin,
+    typename std::vector<const value_type*>::const_iterator end,
+    size_t depth) {
+
+  auto id = static_cast<uint32_t>(nodes_.size());
+  nodes_.emplace_back();
+
+  // All keys in [begin, end) share the first depth characters; the
+  // shortest one comes first and, if it ends here, its value belongs to
+  // this node.
+  if ((*begin)->first.size() == depth) {
+    nodes_[id].valueIndex = static_cast<int32_t>(*begin - values_.data());
+    ++begin;
+  }
+
+  // Group the remaining keys by their character at depth; keys are
+  // sorted, so each group is a contiguous subrange.
+  std::vector<std::pair<char, uint32_t>> children;
+  auto groupBegin = begin;
+  while (groupBegin != end) {
+    char edgeChar = (*groupBegin)->first[depth];
+    auto groupEnd = groupBegin;
+    while (groupEnd != end && (*groupEnd)->first[depth] == edgeChar) {
+      ++groupEnd;
+    }
+
+    // Collapse the single-child chain below this edge: the common prefix
+    // of a sorted group is the common prefix of its first and last keys.
+    folly::StringPiece first((*groupBegin)->first);
+    folly::StringPiece last((*std::prev(groupEnd))->first);
+    first.advance(depth + 1);
+    last.advance(depth + 1);
+    size_t labelLen = 0;
+    while (labelLen < first.size() && labelLen < last.size() &&
+           first[labelLen] == last[labelLen]) {
+      ++labelLen;
+    }
+
+    auto labelOffset = static_cast<uint32_t>(labels_.size());
+    labels_.append(first.data(), labelLen);
+
+    auto child = buildNode(groupBegin, groupEnd, depth + 1 + labelLen);
+    nodes_[child].labelOffset = labelOffset;
+    nodes_[child].labelLen = static_cast<uint32_t>(labelLen);
+    children.emplace_back(edgeChar, child);
+
+    groupBegin = groupEnd;
+  }
+
+  nodes_[id].childrenOffset = static_cast<uint32_t>(childChars_.size());
+  nodes_[id].numChildren = static_cast<uint32_t>(children.size());
+  for (const auto& child : children) {
+    childChars_.push_back(child.first);
+    childIndexes_.push_back(child.second);
+  }
+  return id;
+}
+
+template <class Value>
+template <class Visitor>
+void CompactTrie<Value>::walk(folly::StringPiece key, Visitor&& visit) const {
+  if (nodes_.empty()) {
+    return;
+  }
+
+  uint32_t node = 0;
+  size_t matched = 0;
+  for (;;) {
+    const auto& cur = nodes_[node];
+    visit(cur, matched);
+    if (matched == key.size()) {
+      return;
+    }
+
+    // One pass over the node's edge characters; they are contiguous, and
+    // memchr scans them a word or vector register at a time.
+    auto edges = childChars_.data() + cur.childrenOffset;
+    auto hit = static_cast<const char*>(
+      memchr(edges, key[matched], cur.numChildren));
+    if (hit == nullptr) {
+      return;
+    }
+    node = childIndexes_[cur.childrenOffset + (hit - edges)];
+    ++matched;
+
+    const auto& child = nodes_[node];
+    if (child.labelLen != 0) {
+      if (key.size() - matched < child.labelLen ||
+          memcmp(key.data() + matched, labels_.data() + child.labelOffset,
+                 child.labelLen) != 0) {
+        // Fell off in the middle of a collapsed edge, no more prefixes.
+        return;
+      }
+      matched += child.labelLen;
+    }
+  }
+}
+
+template <class Value>
+const typename CompactTrie<Value>::value_type*
+CompactTrie<Value>::find(folly::StringPiece key) const {
+  const value_type* result = nullptr;
+  walk(key, [this, &result, key](const Node& node, size_t matched) {
+    if (matched == key.size() && node.valueIndex >= 0) {
+      result = &values_[node.valueIndex];
+    }
+  });
+  return result;
+}
+
+template <class Value>
+const typename CompactTrie<Value>::value_type*
+CompactTrie<Value>::findPrefix(folly::StringPiece key) const {
+  const value_type* result = nullptr;
+  walk(key, [this, &result](const Node& node, size_t /* matched */) {
+    if (node.valueIndex >= 0) {
+      result = &values_[node.valueIndex];
+    }
+  });
+  return result;
+}
+
+}} // facebook::memcache
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+
+#include "mcrouter/lib/fbi/cpp/Trie.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * Read-only trie compiled from a Trie.
+ *
+ * Trie allocates a node per half-byte of key, so a lookup chases two
+ * pointers per character through heap-scattered nodes. CompactTrie packs
+ * the same keys into a radix tree stored in a few flat arrays: edges are
+ * full characters, single-child chains are collapsed into one edge with a
+ * multi-character label, and the outgoing edge characters of a node are
+ * contiguous in memory, so finding the next edge is one memchr over at
+ * most a cache line or two.
+ *
+ * Use it for structures that are built once at config time and then only
+ * queried, e.g. prefix routing tables. There is no mutation interface:
+ * rebuild from a Trie to change the key set.
+ *
+ * @param Value type of stored value.
+ */
+template <class Value>
+class CompactTrie {
+  static_assert(sizeof(folly::StringPiece::value_type) == 1,
+                "CompactTrie works only with 8 bit character types");
+ public:
+  typedef std::pair<const std::string, Value> value_type;
+  typedef Value mapped_type;
+
+  CompactTrie() = default;
+
+  /**
+   * Compiles all key/value pairs of given trie. Values are copied.
+   */
+  explicit CompactTrie(const Trie<Value>& trie);
+
+  /**
+   * Return value stored for given key.
+   *
+   * @return nullptr if no key found, pointer to key/value pair otherwise
+   */
+  const value_type* find(folly::StringPiece key) const;
+
+  /**
+   * Get value of longest prefix stored in trie
+   *
+   * @param key string with any characters
+   * @return nullptr if no prefix found, pointer to key/value pair of the
+   *         longest prefix otherwise
+   */
+  const value_type* findPrefix(folly::StringPiece key) const;
+
+ private:
+  struct Node {
+    // edge label from the parent, excluding the leading character
+    // (which lives in childChars_ of the parent)
+    uint32_t labelOffset{0};
+    uint32_t labelLen{0};
+    // this node's slice of childChars_/childIndexes_
+    uint32_t childrenOffset{0};
+    uint32_t numChildren{0};
+    // index into values_, or -1 if no value is stored at this node
+    int32_t valueIndex{-1};
+  };
+
+  // nodes_[0] is the root (when values_ is non-empty)
+  std::vector<Node> nodes_;
+  // collapsed edge labels, one slice per node
+  std::string labels_;
+  // leading characters of outgoing edges, one contiguous slice per node
+  std::string childChars_;
+  // node index of the edge's target, parallel to childChars_
+  std::vector<uint32_t> childIndexes_;
+  // key/value pairs in lexicographic order of keys
+  std::vector<value_type> values_;
+
+  uint32_t buildNode(
+    typename std::vector<const value_type*>::const_iterator begin,
+    typename std::vector<const value_type*>::const_iterator end,
+    size_t depth);
+
+  /**
+   * Walks the trie along key. Calls visit(node) for each node whose key is
+   * a prefix of key, including, if present, the node for key itself.
+   */
+  template <class Visitor>
+  void walk(folly::StringPiece key, Visitor&& visit) const;
+};
+
+}} // facebook::memcache
+
+#include "CompactTrie-inl.h"
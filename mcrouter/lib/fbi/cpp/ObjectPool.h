@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <exception>
 #include <limits>
@@ -21,6 +22,8 @@
 
 #include <glog/logging.h>
 
+#include <folly/ThreadLocal.h>
+
 namespace facebook { namespace memcache {
 
 const size_t kInfinity = std::numeric_limits<size_t>::max();
@@ -202,4 +205,157 @@ class ThreadSafeObjectPool {
   std::mutex mtx;                       // Mutex for mutual exclusion
 };
 
+/// TieredObjectPool is a thread-safe variant of ObjectPool for objects
+/// allocated and freed at very high rates, possibly on different threads
+/// (e.g. allocated by a client thread and freed by a proxy thread).
+/// It is modeled on magazine allocators: each thread owns a small
+/// magazine of free objects that is accessed without any
+/// synchronization, and magazines exchange batches of objects with a
+/// mutex-protected shared depot. In steady state the depot mutex is
+/// taken once per half magazine of operations and the Allocator is not
+/// called at all.
+///
+/// The Allocator must be safe to call concurrently from multiple
+/// threads (std::allocator is). When a thread exits, its magazine
+/// returns its objects to the depot, so the pool must outlive every
+/// thread that used it.
+template<typename T, typename Allocator = std::allocator<T>>
+class TieredObjectPool : boost::noncopyable {
+ public:
+  /// @param magazineCapacity  per-thread free list size; the batch
+  ///                          exchanged with the depot is half of it
+  /// @param maxDepotCapacity  max objects cached in the shared depot;
+  ///                          overflow goes back to the Allocator
+  explicit TieredObjectPool(size_t magazineCapacity = 64,
+                            size_t maxDepotCapacity = kInfinity)
+      : magazineCapacity_(std::max<size_t>(magazineCapacity, 2)),
+        maxDepotCapacity_(maxDepotCapacity),
+        magazine_([this]() { return new Magazine(*this); }) {}
+
+  /// Allocate an object
+  /// @param    args        Arguments to forward to T's constructor
+  /// @return               Pointer to object on success.
+  ///
+  /// @throws               any exception thrown while constructing T,
+  ///                       any exception thrown by the allocator while
+  ///                       allocating the object
+  template<typename... Args>
+  T* alloc(Args&&... args) {
+    auto* obj = allocateRaw();
+    try {
+      std::allocator_traits<Allocator>::construct(
+          depot_.allocator, obj, std::forward<Args>(args)...);
+      return obj;
+    } catch (...) {
+      // If we failed while constructing just recycle the memory
+      releaseRaw(obj);
+      throw; // re-throw
+    }
+  }
+
+  /// Frees the object previously allocated by alloc, after
+  /// invoking the destructor. If obj == nullptr it's a NOOP.
+  /// May be called from a different thread than the alloc.
+  void free(T* obj) {
+    if (obj == nullptr) {
+      // nothing to do
+      return;
+    }
+    std::allocator_traits<Allocator>::destroy(depot_.allocator, obj);
+    releaseRaw(obj);
+  }
+
+ private:
+  // Members are destroyed in reverse declaration order: magazine_ goes
+  // first, flushing every thread's magazine into the depot, and only
+  // then the depot hands everything back to the allocator.
+  struct Depot {
+    ~Depot() {
+      for (auto* p : objects) {
+        std::allocator_traits<Allocator>::deallocate(allocator, p, 1);
+      }
+    }
+    Allocator allocator;                // Allocator used to allocate objects
+    std::mutex mutex;                   // Guards objects
+    std::vector<T*> objects;            // Free objects shared by all threads
+  };
+
+  struct Magazine {
+    explicit Magazine(TieredObjectPool& pool) : pool_(pool) {
+      objects.reserve(pool_.magazineCapacity_);
+    }
+    ~Magazine() {
+      pool_.moveToDepot(objects, objects.size());
+    }
+    TieredObjectPool& pool_;
+    std::vector<T*> objects;
+  };
+
+  // Return memory for one object, from the magazine if possible,
+  // refilling the magazine from the depot if it ran dry. The caller
+  // must invoke the constructor.
+  T* allocateRaw() {
+    auto& mag = *magazine_;
+    if (mag.objects.empty()) {
+      refillFromDepot(mag);
+    }
+    if (!mag.objects.empty()) {
+      auto* obj = mag.objects.back();
+      mag.objects.pop_back();
+      return obj;
+    }
+    auto* obj =
+      std::allocator_traits<Allocator>::allocate(depot_.allocator, 1);
+    if (obj == nullptr) {
+      throw std::bad_alloc();
+    }
+    return obj;
+  }
+
+  // Adds the given memory to the magazine, spilling a batch to the
+  // depot if the magazine is full. It is the caller's responsibility to
+  // destruct the object *before* calling releaseRaw.
+  void releaseRaw(T* obj) {
+    auto& mag = *magazine_;
+    if (mag.objects.size() >= magazineCapacity_) {
+      // Keep the hot half here; hand the rest to other threads.
+      moveToDepot(mag.objects, magazineCapacity_ / 2);
+    }
+    mag.objects.push_back(obj);
+  }
+
+  void refillFromDepot(Magazine& mag) {
+    std::lock_guard<std::mutex> lg(depot_.mutex);
+    auto batch = std::min(depot_.objects.size(), magazineCapacity_ / 2);
+    while (batch-- > 0) {
+      mag.objects.push_back(depot_.objects.back());
+      depot_.objects.pop_back();
+    }
+  }
+
+  // Moves the last `count` pointers of `objects` into the depot;
+  // whatever would exceed maxDepotCapacity_ goes back to the Allocator.
+  void moveToDepot(std::vector<T*>& objects, size_t count) {
+    {
+      std::lock_guard<std::mutex> lg(depot_.mutex);
+      while (count > 0 && depot_.objects.size() < maxDepotCapacity_) {
+        depot_.objects.push_back(objects.back());
+        objects.pop_back();
+        --count;
+      }
+    }
+    while (count-- > 0) {
+      std::allocator_traits<Allocator>::deallocate(
+          depot_.allocator, objects.back(), 1);
+      objects.pop_back();
+    }
+  }
+
+  const size_t magazineCapacity_;       // Per-thread free list capacity
+  const size_t maxDepotCapacity_;       // Maximum number of objects that can
+                                        // be cached in the shared depot
+  Depot depot_;
+  folly::ThreadLocal<Magazine> magazine_;
+};
+
 }} // facebook::memcache
@@ -110,6 +110,12 @@ struct ExpandImpl<Start, List<>> {
   using type = List<>;
 };
 
+/* RemoveT test */
+static_assert(
+    std::is_same<RemoveT<List<int, double, char, double>, double, char>,
+                 List<int>>::value,
+    "RemoveT is broken");
+
 /* PairListFirst test */
 static_assert(
     std::is_same<PairListFirstT<List<Pair<int, double>, Pair<float, char>>>,
@@ -262,6 +262,30 @@ struct ListContainsImpl<List<X, Xs...>, T> {
 template <class L, class T>
 using ListContains = typename detail::ListContainsImpl<L, T>;
 
+/**
+ * Removes all occurrences of the given types from a List.
+ */
+namespace detail {
+template <class L, class... Ys>
+struct RemoveTImpl;
+
+template <class... Ys>
+struct RemoveTImpl<List<>, Ys...> {
+  using type = List<>;
+};
+
+template <class X, class... Xs, class... Ys>
+struct RemoveTImpl<List<X, Xs...>, Ys...> {
+  using Rest = typename RemoveTImpl<List<Xs...>, Ys...>::type;
+  using type = typename std::conditional<Has<X, Ys...>::value,
+                                         Rest,
+                                         PrependT<X, Rest>>::type;
+};
+} // detail
+
+template <class L, class... Ys>
+using RemoveT = typename detail::RemoveTImpl<L, Ys...>::type;
+
 /**
  * Map a template template over a List of types.
  */
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace facebook { namespace memcache {
+
+/**
+ * xoshiro256+ pseudo random number generator.
+ *
+ * Satisfies the UniformRandomBitGenerator requirements, so it drops in
+ * wherever std::mt19937 or the std distributions are used, at a fraction
+ * of the per-draw cost and state size (32 bytes vs ~2.5KB).
+ *
+ * Not cryptographically secure; intended for load balancing, jitter and
+ * sampling decisions.  Not thread safe; use one instance per thread.
+ */
+class Xoshiro256Plus {
+ public:
+  using result_type = uint64_t;
+
+  /* Default state is deterministic; call seed() for a random stream. */
+  Xoshiro256Plus() noexcept {
+    seed(0);
+  }
+
+  explicit Xoshiro256Plus(uint64_t s) noexcept {
+    seed(s);
+  }
+
+  /**
+   * Expands the 64-bit seed into the full 256-bit state with splitmix64,
+   * as recommended by the xoshiro authors.  Every seed (including 0)
+   * yields a well-mixed nonzero state.
+   */
+  void seed(uint64_t s) noexcept {
+    for (auto& word : state_) {
+      s += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = s;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  result_type operator()() noexcept {
+    const uint64_t result = state_[0] + state_[3];
+    const uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+  }
+
+  /**
+   * Uniform double in [0, 1), built from the top 53 bits of one draw.
+   */
+  double randomDouble01() noexcept {
+    return ((*this)() >> 11) * (1.0 / (1ULL << 53));
+  }
+
+  static constexpr result_type min() {
+    return 0;
+  }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) noexcept {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t state_[4];
+};
+
+}} // facebook::memcache
@@ -15,9 +15,11 @@
 
 #include <gtest/gtest.h>
 
+#include "mcrouter/lib/fbi/cpp/CompactTrie.h"
 #include "mcrouter/lib/fbi/cpp/Trie.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 
+using facebook::memcache::CompactTrie;
 using facebook::memcache::Trie;
 
 namespace {
@@ -317,6 +319,80 @@ TEST(Trie, Const) {
   EXPECT_TRUE(trie.cbegin()->second == 1);
 }
 
+TEST(CompactTrie, SanityTest) {
+  Trie<int> trie;
+
+  std::string k[] = {
+    "a",
+    "ab",
+    "abc",
+    "abd",
+    ""
+  };
+  int nk = sizeof(k) / sizeof(k[0]);
+
+  for (auto i = 0; i < nk; ++i) {
+    trie.emplace(k[i], i);
+  }
+  CompactTrie<int> compact(trie);
+
+  // Get Hits
+  for (auto i = 0; i < nk; ++i) {
+    ASSERT_TRUE(compact.find(k[i]) != nullptr);
+    EXPECT_EQ(compact.find(k[i])->first, k[i]);
+    EXPECT_EQ(compact.find(k[i])->second, i);
+  }
+
+  // Get Misses
+  EXPECT_TRUE(compact.find("b") == nullptr);
+  EXPECT_TRUE(compact.find("abcd") == nullptr);
+
+  // Longest prefix
+  EXPECT_EQ(compact.findPrefix("abc111")->second, 2);
+  EXPECT_EQ(compact.findPrefix("ab111")->second, 1);
+  EXPECT_EQ(compact.findPrefix("b")->second, 4);
+}
+
+TEST(CompactTrie, Empty) {
+  Trie<int> trie;
+  CompactTrie<int> compact(trie);
+
+  EXPECT_TRUE(compact.find("") == nullptr);
+  EXPECT_TRUE(compact.findPrefix("abc") == nullptr);
+}
+
+TEST(CompactTrie, RandTestGet) {
+  CompactTrie<int> compact(randTrie);
+
+  for (int i = 0; i < (1<<16); ++i) {
+    auto s = facebook::memcache::randomString(1, 20);
+    auto it = randTrie.find(s);
+    auto compactIt = compact.find(s);
+    if (it == randTrie.end()) {
+      ASSERT_TRUE(compactIt == nullptr);
+    } else {
+      ASSERT_TRUE(compactIt != nullptr);
+      ASSERT_TRUE(*it == *compactIt);
+    }
+  }
+}
+
+TEST(CompactTrie, RandTestGetPrefix) {
+  CompactTrie<int> compact(randTrie);
+
+  for (int i = 0; i < (1<<16); ++i) {
+    auto s = facebook::memcache::randomString(1, 20);
+    auto it = randTrie.findPrefix(s);
+    auto compactIt = compact.findPrefix(s);
+    if (it == randTrie.end()) {
+      ASSERT_TRUE(compactIt == nullptr);
+    } else {
+      ASSERT_TRUE(compactIt != nullptr);
+      ASSERT_TRUE(*it == *compactIt);
+    }
+  }
+}
+
 int main(int argc, char **argv){
   prepareRand();
   testing::InitGoogleTest(&argc, argv);
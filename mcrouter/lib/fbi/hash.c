@@ -119,27 +119,25 @@ static uint64_t murmur_rehash_64A(uint64_t k) {
     return h;
 }
 
+uint64_t furc_seed_hash(const char* const key, const size_t len) {
+    return murmur_hash_64A(key, len, SEED);
+}
+
 /**
  * furc_get_bit -- the bitstream generator
  *
- * Given a key and an index, provides a pseudorandom bit dependent on both.
- * Caches hash values; a NULL key clears the cache.
+ * Given the seed hash of a key and an index, provides a pseudorandom bit
+ * dependent on both.  Caches hash values.
  */
-static uint32_t furc_get_bit(const char* const key, const size_t len,
-                             const uint32_t idx, uint64_t* hash,
-                             int32_t* old_ord_p) {
+static uint32_t furc_get_bit(const uint64_t seed_hash, const uint32_t idx,
+                             uint64_t* hash, int32_t* old_ord_p) {
     int32_t ord = (idx >> 6);
     int n;
 
-    if (key == NULL) {
-        *old_ord_p = -1;
-        return 0;
-    }
-
     if (*old_ord_p < ord) {
         for (n = *old_ord_p + 1; n <= ord; n++) {
             hash[n] = ((n == 0)
-                       ? murmur_hash_64A(key, len, SEED)
+                       ? seed_hash
                        : murmur_rehash_64A(hash[n-1]));
         }
         *old_ord_p = ord;
@@ -148,14 +146,14 @@ static uint32_t furc_get_bit(const char* const key, const size_t len,
     return (hash[ord] >> (idx&0x3f)) & 0x1;
 }
 
-uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
+uint32_t furc_hash_seeded(const uint64_t seed_hash, const uint32_t m) {
     uint32_t try;
     uint32_t d;
     uint32_t num;
     uint32_t i;
     uint32_t a;
     uint64_t hash[FURC_CACHE_SIZE];
-    int32_t old_ord;
+    int32_t old_ord = -1;
 
     assert(m <= furc_maximum_pool_size());
 
@@ -163,13 +161,12 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
         return 0;
     }
 
-    furc_get_bit(NULL, 0, 0, hash, &old_ord);
     for (d = 0; m > (1ul << d); d++)
         ;
 
     a = d;
     for (try = 0; try < MAX_TRIES; try++) {
-        while (!furc_get_bit(key, len, a, hash, &old_ord)) {
+        while (!furc_get_bit(seed_hash, a, hash, &old_ord)) {
             if (--d == 0) {
                 return 0;
             }
@@ -178,7 +175,7 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
         a += FURC_SHIFT;
         num = 1;
         for (i = 0; i < d-1; i++) {
-            num = (num << 1) | furc_get_bit(key, len, a, hash, &old_ord);
+            num = (num << 1) | furc_get_bit(seed_hash, a, hash, &old_ord);
             a += FURC_SHIFT;
         }
         if (num < m) {
@@ -190,6 +187,16 @@ uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
     return 0;
 }
 
+uint32_t furc_hash(const char* const key, const size_t len, const uint32_t m) {
+    assert(m <= furc_maximum_pool_size());
+
+    if (m <= 1) {
+        return 0;
+    }
+
+    return furc_hash_seeded(furc_seed_hash(key, len), m);
+}
+
 inline uint32_t furc_maximum_pool_size(void) {
     return (1 << FURC_SHIFT);
 }
@@ -273,7 +280,7 @@ static const unsigned int crc32tab[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
 };
 
-uint32_t crc32_hash(const char* const key, const size_t len) {
+static uint32_t crc32_hash_scalar(const char* const key, const size_t len) {
 	uint32_t crc;
 	unsigned int i;
 
@@ -286,3 +293,91 @@ uint32_t crc32_hash(const char* const key, const size_t len) {
 	//crc = (~crc >> 16) & 0x7fff;
     return (~crc);
 }
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+
+#include <x86intrin.h>
+
+/**
+ * Hardware-accelerated CRC32 using carry-less multiplication (PCLMULQDQ).
+ *
+ * Note that the SSE4.2 crc32 instruction implements CRC-32C (Castagnoli
+ * polynomial) and would change every hash value, so it cannot be used here.
+ * Carry-less multiplication folds the message over the same polynomial as
+ * the table above (0xEDB88320, reflected) and produces bit-identical
+ * results.
+ *
+ * The folding constants are x^(128+64-1) mod P and x^(128-1) mod P in the
+ * reflected domain, as derived in the Intel white paper "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ" (also used by the
+ * Linux kernel crc32-pclmul implementation).
+ *
+ * The 128-bit accumulator maintains the invariant that the raw (zero-seeded)
+ * table CRC of its 16 bytes followed by the unprocessed tail equals the CRC
+ * of the consumed prefix, so the final reduction is just a 16-byte pass over
+ * the table. That keeps the tail handling trivial and is cheap for the short
+ * keys we hash.
+ */
+__attribute__((target("pclmul,sse2")))
+static uint32_t crc32_hash_pclmul(const char* const key, const size_t len) {
+    const __m128i k = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+    const uint8_t* p = (const uint8_t*)key;
+    const uint8_t* const end = p + (len & ~(size_t)15);
+    uint8_t folded[16];
+    uint32_t crc;
+    unsigned int i;
+
+    /* Absorb the ~0 seed into the first 16 bytes. */
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p),
+                              _mm_cvtsi32_si128((int)~0u));
+    p += 16;
+
+    while (p != end) {
+        __m128i d = _mm_loadu_si128((const __m128i*)p);
+        p += 16;
+        x = _mm_xor_si128(d,
+                          _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                                        _mm_clmulepi64_si128(x, k, 0x11)));
+    }
+
+    _mm_storeu_si128((__m128i*)folded, x);
+
+    crc = 0;
+    for (i = 0; i < 16; i++) {
+        crc = (crc >> 8) ^ crc32tab[(crc ^ folded[i]) & 0xff];
+    }
+    for (i = 0; i < (len & 15); i++) {
+        crc = (crc >> 8) ^ crc32tab[(crc ^ p[i]) & 0xff];
+    }
+
+    return (~crc);
+}
+
+static uint32_t crc32_hash_choose(const char* const key, const size_t len);
+
+/* Resolved to the best implementation for this CPU on first use. */
+static uint32_t (*crc32_hash_impl)(const char* const, const size_t) =
+    crc32_hash_choose;
+
+static uint32_t crc32_hash_choose(const char* const key, const size_t len) {
+    crc32_hash_impl = __builtin_cpu_supports("pclmul")
+                      ? crc32_hash_pclmul
+                      : crc32_hash_scalar;
+    return crc32_hash_impl(key, len);
+}
+
+uint32_t crc32_hash(const char* const key, const size_t len) {
+    /* Folding needs at least one full 16-byte block. */
+    if (len < 16) {
+        return crc32_hash_scalar(key, len);
+    }
+    return crc32_hash_impl(key, len);
+}
+
+#else /* !__x86_64__ */
+
+uint32_t crc32_hash(const char* const key, const size_t len) {
+    return crc32_hash_scalar(key, len);
+}
+
+#endif
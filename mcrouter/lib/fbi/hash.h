@@ -47,6 +47,20 @@ __BEGIN_DECLS
 uint32_t furc_hash(const char* const key, const size_t len,
                    const uint32_t m);
 
+/**
+ * The seed hash of |key| is the only value furc_hash() derives from the key
+ * bytes; everything else comes from rehashing it.  Callers that evaluate
+ * several pools for the same key can compute the seed once and use
+ * furc_hash_seeded() for each pool.
+ */
+uint64_t furc_seed_hash(const char* const key, const size_t len);
+
+/**
+ * Same as furc_hash(), but starts from a precomputed seed hash:
+ * furc_hash_seeded(furc_seed_hash(key, len), m) == furc_hash(key, len, m).
+ */
+uint32_t furc_hash_seeded(const uint64_t seed_hash, const uint32_t m);
+
 uint32_t furc_maximum_pool_size(void);
 
 /**
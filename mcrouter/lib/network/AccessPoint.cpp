@@ -10,6 +10,7 @@
 #include "AccessPoint.h"
 
 #include <folly/Conv.h>
+#include <folly/Hash.h>
 #include <folly/IPAddress.h>
 
 #include "mcrouter/lib/fbi/cpp/util.h"
@@ -90,6 +91,13 @@ AccessPoint::AccessPoint(folly::StringPiece host, uint16_t port,
     host_ = host.str();
     isV6_ = false;
   }
+
+  hash_ = folly::hash::hash_combine(
+      folly::Hash()(host_),
+      port_,
+      static_cast<int>(protocol_),
+      useSsl_,
+      compressed_);
 }
 
 std::shared_ptr<AccessPoint>
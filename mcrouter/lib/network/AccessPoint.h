@@ -64,6 +64,24 @@ struct AccessPoint {
     return compressed_;
   }
 
+  /**
+   * Hash of all fields, precomputed at construction, so hot lookups
+   * (e.g. ProxyDestinationMap) don't have to build and hash a string key.
+   */
+  uint64_t hash() const {
+    return hash_;
+  }
+
+  bool operator==(const AccessPoint& other) const {
+    return port_ == other.port_ && protocol_ == other.protocol_ &&
+           useSsl_ == other.useSsl_ && compressed_ == other.compressed_ &&
+           host_ == other.host_;
+  }
+
+  bool operator!=(const AccessPoint& other) const {
+    return !(*this == other);
+  }
+
   /**
    * @return [host]:port if address is IPv6, host:port otherwise
    */
@@ -76,6 +94,7 @@ struct AccessPoint {
 
  private:
   std::string host_;
+  uint64_t hash_{0};
   uint16_t port_;
   mc_protocol_t protocol_;
   bool useSsl_{false};
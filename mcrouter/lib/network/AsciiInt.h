@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Branch-minimal ascii integer kernels shared by the ascii parser
+ * (flags, exptime, value lengths) and the ascii serializers (reply and
+ * request headers). Decoding folds eight digits per multiply chain
+ * instead of one per loop iteration; encoding computes the digit count
+ * up front and fills the buffer backward two digits at a time, so a
+ * header line can be emitted in a single pass with no snprintf.
+ */
+
+namespace detail {
+
+/* "00", "01", ... "99" back to back. */
+constexpr char kAsciiDigitPairs[201] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+/**
+ * Converts 8 ascii digits loaded little-endian (first digit in the low
+ * byte) to their numeric value with three multiply-shift rounds.
+ */
+inline uint64_t asciiDecodeEightDigits(const char* buf) {
+  uint64_t chunk;
+  std::memcpy(&chunk, buf, sizeof(chunk));
+  chunk = (chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+  chunk = (chunk & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+  return (chunk & 0x0000FFFF0000FFFFULL) * 42949672960001 >> 32;
+}
+
+} // detail
+
+/**
+ * Returns a pointer to the first byte in [begin, end) that is not an
+ * ascii digit, or end if all bytes are digits. Checks 8 bytes per
+ * iteration (SWAR) on little-endian targets.
+ */
+inline const char* asciiScanDigits(const char* begin, const char* end) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (begin + 8 <= end) {
+    uint64_t chunk;
+    std::memcpy(&chunk, begin, sizeof(chunk));
+    /* Digit bytes map to 0x00..0x09; anything else sets the high bit
+       either directly or through the + 0x76 carry. */
+    chunk ^= 0x3030303030303030ULL;
+    const uint64_t mask =
+        ((chunk + 0x7676767676767676ULL) | chunk) & 0x8080808080808080ULL;
+    if (mask != 0) {
+      return begin + (__builtin_ctzll(mask) >> 3);
+    }
+    begin += 8;
+  }
+#endif
+  while (begin != end &&
+         static_cast<uint8_t>(*begin - '0') < 10) {
+    ++begin;
+  }
+  return begin;
+}
+
+/**
+ * Decodes the ascii digits in [begin, end) to an integer. The caller
+ * guarantees every byte in the range is a digit; like the classic
+ * one-digit-at-a-time loop, values wider than 64 bits wrap silently.
+ */
+inline uint64_t asciiDecodeUint64(const char* begin, const char* end) {
+  uint64_t value = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (begin + 8 <= end) {
+    value = value * 100000000ULL + detail::asciiDecodeEightDigits(begin);
+    begin += 8;
+  }
+#endif
+  while (begin != end) {
+    value = value * 10 + static_cast<uint64_t>(*begin++ - '0');
+  }
+  return value;
+}
+
+/**
+ * Number of ascii digits needed to represent value (1 for 0).
+ */
+inline size_t asciiUint64Length(uint64_t value) {
+  size_t length = 1;
+  for (;;) {
+    if (value < 10) {
+      return length;
+    }
+    if (value < 100) {
+      return length + 1;
+    }
+    if (value < 1000) {
+      return length + 2;
+    }
+    if (value < 10000) {
+      return length + 3;
+    }
+    value /= 10000;
+    length += 4;
+  }
+}
+
+/**
+ * Writes value in ascii to buffer (no terminator) and returns the number
+ * of bytes written, at most 20. The length is computed first and digits
+ * are filled backward in pairs, so the caller can append further fields
+ * right after the returned length.
+ */
+inline size_t asciiEncodeUint64(char* buffer, uint64_t value) {
+  const size_t length = asciiUint64Length(value);
+  char* pos = buffer + length;
+  while (value >= 100) {
+    const uint64_t pair = value % 100;
+    value /= 100;
+    pos -= 2;
+    std::memcpy(pos, &detail::kAsciiDigitPairs[2 * pair], 2);
+  }
+  if (value >= 10) {
+    std::memcpy(pos - 2, &detail::kAsciiDigitPairs[2 * value], 2);
+  } else {
+    *(pos - 1) = static_cast<char>('0' + value);
+  }
+  return length;
+}
+
+/**
+ * Signed counterpart of asciiEncodeUint64 (at most 21 bytes including
+ * the '-').
+ */
+inline size_t asciiEncodeInt64(char* buffer, int64_t value) {
+  if (value < 0) {
+    *buffer = '-';
+    return 1 + asciiEncodeUint64(
+        buffer + 1, ~static_cast<uint64_t>(value) + 1);
+  }
+  return asciiEncodeUint64(buffer, static_cast<uint64_t>(value));
+}
+
+}} // facebook::memcache
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace facebook { namespace memcache {
+
+/**
+ * Returns a pointer to the first byte in [begin, end) that would terminate
+ * an ascii protocol token, i.e. any byte <= 0x20 (space and control
+ * characters, including '\r' and '\n') or 0x7f (DEL). Returns end if no such
+ * byte exists.
+ *
+ * This is the vectorized counterpart of the byte-at-a-time token loop in the
+ * ragel-generated ascii parser: keys average tens of bytes, so scanning for
+ * the delimiter 16 bytes at a time and letting the state machine handle only
+ * the boundary byte removes the bulk of per-byte dispatch from parsing.
+ */
+inline const char* asciiScanDelimiter(const char* begin, const char* end) {
+#if defined(__SSE2__)
+  const __m128i kSpace = _mm_set1_epi8(0x20);
+  const __m128i kDel = _mm_set1_epi8(0x7f);
+  while (begin + 16 <= end) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    // (min(chunk, 0x20) == chunk) <=> unsigned chunk <= 0x20.
+    const __m128i isCtlOrSpace =
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, kSpace), chunk);
+    const __m128i isDel = _mm_cmpeq_epi8(chunk, kDel);
+    const uint32_t mask =
+        _mm_movemask_epi8(_mm_or_si128(isCtlOrSpace, isDel));
+    if (mask != 0) {
+      return begin + __builtin_ctz(mask);
+    }
+    begin += 16;
+  }
+#endif
+  while (begin != end) {
+    const uint8_t c = static_cast<uint8_t>(*begin);
+    if (c <= 0x20 || c == 0x7f) {
+      break;
+    }
+    ++begin;
+  }
+  return begin;
+}
+
+}} // facebook::memcache
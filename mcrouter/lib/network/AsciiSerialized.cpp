@@ -9,6 +9,8 @@
  */
 #include "AsciiSerialized.h"
 
+#include "mcrouter/lib/network/AsciiInt.h"
+
 namespace facebook { namespace memcache {
 
 void AsciiSerializedRequest::addString(folly::ByteRange range) {
@@ -27,11 +29,17 @@ template <class Request>
 void AsciiSerializedRequest::keyValueRequestCommon(folly::StringPiece prefix,
                                                    const Request& request) {
   auto value = request.valueRangeSlow();
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %d %zd\r\n",
-                      request.flags(), request.exptime(), value.size());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* pos = printBuffer_;
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request.flags());
+  *pos++ = ' ';
+  pos += asciiEncodeInt64(pos, request.exptime());
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, value.size());
+  *pos++ = '\r';
+  *pos++ = '\n';
   addStrings(prefix, request.fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)),
+             folly::StringPiece(printBuffer_, pos - printBuffer_),
              value, "\r\n");
 }
 
@@ -85,44 +93,62 @@ void AsciiSerializedRequest::prepareImpl(
 void AsciiSerializedRequest::prepareImpl(
     const TypedThriftRequest<cpp2::McCasRequest>& request) {
   auto value = request.valueRangeSlow();
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %d %zd %lu\r\n",
-                      request.flags(), request.exptime(), value.size(),
-                      request->get_casToken());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* pos = printBuffer_;
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request.flags());
+  *pos++ = ' ';
+  pos += asciiEncodeInt64(pos, request.exptime());
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, value.size());
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request->get_casToken());
+  *pos++ = '\r';
+  *pos++ = '\n';
   addStrings("cas ", request.fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)), value,
+             folly::StringPiece(printBuffer_, pos - printBuffer_), value,
              "\r\n");
 }
 
 void AsciiSerializedRequest::prepareImpl(
     const TypedThriftRequest<cpp2::McLeaseSetRequest>& request) {
   auto value = request.valueRangeSlow();
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %lu %d %zd\r\n",
-                      request->get_leaseToken(), request.flags(),
-                      request.exptime(), value.size());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* pos = printBuffer_;
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request->get_leaseToken());
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request.flags());
+  *pos++ = ' ';
+  pos += asciiEncodeInt64(pos, request.exptime());
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, value.size());
+  *pos++ = '\r';
+  *pos++ = '\n';
   addStrings("lease-set ", request.fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)), value,
+             folly::StringPiece(printBuffer_, pos - printBuffer_), value,
              "\r\n");
 }
 
 // Arithmetic ops.
 void AsciiSerializedRequest::prepareImpl(
     const TypedThriftRequest<cpp2::McIncrRequest>& request) {
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu\r\n",
-                      request->get_delta());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* pos = printBuffer_;
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request->get_delta());
+  *pos++ = '\r';
+  *pos++ = '\n';
   addStrings("incr ", request.fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+             folly::StringPiece(printBuffer_, pos - printBuffer_));
 }
 
 void AsciiSerializedRequest::prepareImpl(
     const TypedThriftRequest<cpp2::McDecrRequest>& request) {
-  auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu\r\n",
-                      request->get_delta());
-  assert(len > 0 && static_cast<size_t>(len) < kMaxBufferLength);
+  char* pos = printBuffer_;
+  *pos++ = ' ';
+  pos += asciiEncodeUint64(pos, request->get_delta());
+  *pos++ = '\r';
+  *pos++ = '\n';
   addStrings("decr ", request.fullKey(),
-             folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+             folly::StringPiece(printBuffer_, pos - printBuffer_));
 }
 
 // Delete op.
@@ -42,8 +42,9 @@ inline void AsyncMcClient::setCompressionCallback(
 
 template <class Request>
 ReplyT<Request> AsyncMcClient::sendSync(const Request& request,
-                                        std::chrono::milliseconds timeout) {
-  return base_->sendSync(request, timeout);
+                                        std::chrono::milliseconds timeout,
+                                        RequestAborter* aborter) {
+  return base_->sendSync(request, timeout, aborter);
 }
 
 inline void AsyncMcClient::setThrottle(size_t maxInflight, size_t maxPending) {
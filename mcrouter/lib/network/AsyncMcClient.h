@@ -23,6 +23,7 @@ class EventBase;
 namespace facebook { namespace memcache {
 
 class AsyncMcClientImpl;
+class RequestAborter;
 
 /**
  * A class for network communication with memcache protocol.
@@ -93,10 +94,16 @@ class AsyncMcClient {
    * Send request synchronously (i.e. blocking call).
    * Note: it must be called only from fiber context. It will block the current
    *       stack and will send request only when we loop EventBase.
+   *
+   * @param aborter  if not nullptr, the request is registered with the
+   *                 aborter while it's waiting, so that it can be torn down
+   *                 before it's written to the wire (e.g. when a sibling
+   *                 fanout request already won).
    */
   template <class Request>
   ReplyT<Request> sendSync(const Request& request,
-                           std::chrono::milliseconds timeout);
+                           std::chrono::milliseconds timeout,
+                           RequestAborter* aborter = nullptr);
 
   /**
    * Set throttling options.
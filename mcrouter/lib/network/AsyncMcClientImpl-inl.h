@@ -11,18 +11,24 @@
 
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/network/FBTrace.h"
+#include "mcrouter/lib/network/ThriftMessageTraits.h"
 
 namespace facebook { namespace memcache {
 
 template <class Request>
 ReplyT<Request> AsyncMcClientImpl::sendSync(
     const Request& request,
-    std::chrono::milliseconds timeout) {
+    std::chrono::milliseconds timeout,
+    RequestAborter* aborter) {
   auto selfPtr = selfPtr_.lock();
   // shouldn't happen.
   assert(selfPtr);
   assert(folly::fibers::onFiber());
 
+  if (aborter && aborter->aborted()) {
+    return ReplyT<Request>(mc_res_aborted);
+  }
+
   if (maxPending_ != 0 && getPendingRequestCount() >= maxPending_) {
     return ReplyT<Request>(mc_res_local_error);
   }
@@ -31,6 +37,13 @@ ReplyT<Request> AsyncMcClientImpl::sendSync(
   // miss fbtrace id.
   fbTraceOnSend(request, *connectionOptions_.accessPoint);
 
+  if (udpTransport_ && GetLike<Request>::value) {
+    if (auto reply = udpTransport_->sendSync(request, timeout)) {
+      return std::move(*reply);
+    }
+    // Truncated, lost or oversized; retry over TCP below.
+  }
+
   McClientRequestContext<Request> ctx(
       request,
       nextMsgId_,
@@ -40,10 +53,17 @@ ReplyT<Request> AsyncMcClientImpl::sendSync(
       [](ParserT& parser) { parser.expectNext<Request>(); },
       requestStatusCallbacks_.onStateChange,
       supportedCompressionCodecs_);
+  if (aborter) {
+    aborter->add(ctx);
+  }
   sendCommon(ctx);
 
   // Wait for the reply.
-  return ctx.waitForReply(timeout);
+  auto reply = ctx.waitForReply(timeout);
+  if (aborter) {
+    aborter->remove(ctx);
+  }
+  return reply;
 }
 
 template <class Reply>
@@ -9,13 +9,17 @@
  */
 #include "AsyncMcClientImpl.h"
 
+#include <limits.h>
+
 #include <folly/EvictingCacheMap.h>
 #include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/Memory.h>
 
 #include "mcrouter/lib/debug/FifoManager.h"
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
+#include "mcrouter/lib/network/HostResolver.h"
 #include "mcrouter/lib/network/MockMcClientTransport.h"
 
 namespace facebook { namespace memcache {
@@ -65,6 +69,22 @@ class AsyncMcClientImpl::WriterLoop : public folly::EventBase::LoopCallback {
   AsyncMcClientImpl& client_;
 };
 
+/**
+ * Timeout ending a flush delay window (see ConnectionOptions::flushDelay):
+ * once it fires, whatever is pending gets written even though the byte cap
+ * was never reached.
+ */
+class AsyncMcClientImpl::FlushTimer : public folly::AsyncTimeout {
+ public:
+  explicit FlushTimer(AsyncMcClientImpl& client)
+      : folly::AsyncTimeout(&client.eventBase_), client_(client) {}
+  void timeoutExpired() noexcept override final {
+    client_.flushTimerExpired();
+  }
+ private:
+  AsyncMcClientImpl& client_;
+};
+
 AsyncMcClientImpl::AsyncMcClientImpl(
     folly::EventBase& eventBase,
     ConnectionOptions options)
@@ -73,13 +93,26 @@ AsyncMcClientImpl::AsyncMcClientImpl(
       outOfOrder_(connectionOptions_.accessPoint->getProtocol() !=
                   mc_ascii_protocol),
       queue_(outOfOrder_),
+      timeoutWheel_(new folly::HHWheelTimer(&eventBase_)),
       writer_(folly::make_unique<WriterLoop>(*this)),
       eventBaseDestructionCallback_(
         folly::make_unique<detail::OnEventBaseDestructionCallback>(*this)) {
   eventBase_.runOnDestruction(eventBaseDestructionCallback_.get());
+  if (connectionOptions_.enableUdpForGets &&
+      connectionOptions_.accessPoint->getProtocol() == mc_ascii_protocol) {
+    udpTransport_ = folly::make_unique<McUdpTransport>(
+        eventBase_,
+        folly::SocketAddress(connectionOptions_.accessPoint->getHost().str(),
+                             connectionOptions_.accessPoint->getPort(),
+                             /* allowNameLookup */ true));
+  }
   if (connectionOptions_.compressionCodecMap) {
     supportedCompressionCodecs_ =
-        connectionOptions_.compressionCodecMap->getIdRange();
+        connectionOptions_.compressionCodecMap->getIdRange(
+            connectionOptions_.compressionPoolTag);
+  }
+  if (connectionOptions_.flushDelay.count() > 0) {
+    flushTimer_ = folly::make_unique<FlushTimer>(*this);
   }
 }
 
@@ -170,6 +203,13 @@ void AsyncMcClientImpl::sendCommon(McClientRequestContextBase& req) {
       incMsgId(nextMsgId_);
 
       queue_.markAsPending(req);
+      if (flushTimer_) {
+        auto iov = req.reqContext.getIovs();
+        auto iovcnt = req.reqContext.getIovsCount();
+        for (size_t i = 0; i < iovcnt; ++i) {
+          pendingFlushBytes_ += iov[i].iov_len;
+        }
+      }
       scheduleNextWriterLoop();
       if (connectionState_ == ConnectionState::DOWN) {
         attemptConnection();
@@ -185,22 +225,66 @@ void AsyncMcClientImpl::sendCommon(McClientRequestContextBase& req) {
 }
 
 void AsyncMcClientImpl::scheduleNextWriterLoop() {
-  if (connectionState_ == ConnectionState::UP && !writeScheduled_ &&
-      getPendingRequestCount() != 0) {
+  if ((connectionState_ == ConnectionState::UP ||
+       (connectionState_ == ConnectionState::CONNECTING &&
+        canOptimisticallyWrite())) &&
+      !writeScheduled_ && getPendingRequestCount() != 0) {
+    if (flushTimer_ &&
+        pendingFlushBytes_ < connectionOptions_.flushDelayMaxBytes) {
+      // Hold the write back so requests arriving within the delay window
+      // coalesce into one large writev. EventBase timeouts have
+      // millisecond granularity, so sub-millisecond delays round up to
+      // one tick; the byte cap keeps a burst from sitting out the full
+      // delay.
+      if (!flushTimer_->isScheduled()) {
+        flushTimer_->scheduleTimeout(std::max(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                connectionOptions_.flushDelay),
+            std::chrono::milliseconds(1)));
+      }
+      return;
+    }
+    if (flushTimer_) {
+      flushTimer_->cancelTimeout();
+    }
     writeScheduled_ = true;
     eventBase_.runInLoop(writer_.get());
   }
 }
 
+void AsyncMcClientImpl::flushTimerExpired() {
+  if ((connectionState_ == ConnectionState::UP ||
+       (connectionState_ == ConnectionState::CONNECTING &&
+        canOptimisticallyWrite())) &&
+      !writeScheduled_ && getPendingRequestCount() != 0) {
+    writeScheduled_ = true;
+    eventBase_.runInLoop(writer_.get());
+  }
+}
+
+bool AsyncMcClientImpl::canOptimisticallyWrite() const {
+  /* Restricted to out-of-order protocols: in-order (ascii) bookkeeping
+     assumes nothing is written before the connection is up. */
+  return connectionOptions_.enableTfo && outOfOrder_ &&
+         !connectionOptions_.sslContextProvider && !connectionOptions_.noNetwork;
+}
+
 void AsyncMcClientImpl::cancelWriterCallback() {
   writeScheduled_ = false;
   writer_->cancelLoopCallback();
+  if (flushTimer_) {
+    flushTimer_->cancelTimeout();
+  }
 }
 
 void AsyncMcClientImpl::pushMessages() {
   DestructorGuard dg(this);
 
-  assert(connectionState_ == ConnectionState::UP);
+  pendingFlushBytes_ = 0;
+
+  assert(connectionState_ == ConnectionState::UP ||
+         (connectionState_ == ConnectionState::CONNECTING &&
+          canOptimisticallyWrite()));
   size_t numToSend = queue_.getPendingRequestCount();
   if (maxInflight_ != 0) {
     if (maxInflight_ <= getInflightRequestCount()) {
@@ -215,26 +299,58 @@ void AsyncMcClientImpl::pushMessages() {
     requestStatusCallbacks_.onWrite(numToSend);
   }
 
+  // Gather the iovecs of all requests we're about to send into as few
+  // writev calls as possible. Serialized data is kept alive by the requests
+  // themselves, which stay in the queue until their batch completes.
+  WriteIovecVector batchIovs;
+  size_t batchedRequests = 0;
+
   while (getPendingRequestCount() != 0 && numToSend > 0 &&
-         /* we might be already not UP, because of failed writev */
-         connectionState_ == ConnectionState::UP) {
+         /* we might be already not UP/CONNECTING, because of failed writev */
+         (connectionState_ == ConnectionState::UP ||
+          connectionState_ == ConnectionState::CONNECTING)) {
     auto& req = queue_.markNextAsSending();
 
     auto iov = req.reqContext.getIovs();
     auto iovcnt = req.reqContext.getIovsCount();
     if (debugFifo_.isConnected()) {
-      debugFifo_.startMessage(MessageDirection::Sent, req.reqContext.typeId());
+      debugFifo_.startMessage(MessageDirection::Sent,
+                              req.reqContext.typeId(),
+                              req.reqContext.protocol(),
+                              req.id,
+                              0 /* keyOffset */,
+                              0 /* keySize */);
       debugFifo_.writeData(iov, iovcnt);
     }
-    socket_->writev(this, iov, iovcnt,
-                    numToSend == 1 ? folly::WriteFlags::NONE
-                    : folly::WriteFlags::CORK);
+    batchIovs.insert(batchIovs.end(), iov, iov + iovcnt);
+    ++batchedRequests;
     --numToSend;
+    // Flush early enough that the next request (at most kMaxIovs iovecs)
+    // always fits, so every request marked as sending is part of exactly
+    // one issued writev even if a flush fails synchronously.
+    if (batchIovs.size() + McSerializedRequest::kMaxIovs >
+        static_cast<size_t>(IOV_MAX)) {
+      flushWriteBatch(batchIovs, batchedRequests, /* more */ numToSend > 0);
+      batchedRequests = 0;
+    }
+  }
+  if (batchedRequests > 0) {
+    flushWriteBatch(batchIovs, batchedRequests, /* more */ false);
   }
   writeScheduled_ = false;
   scheduleNextWriterLoop();
 }
 
+void AsyncMcClientImpl::flushWriteBatch(WriteIovecVector& iovs,
+                                        size_t numRequests,
+                                        bool more) {
+  assert(numRequests > 0);
+  pendingWriteBatches_.push_back(numRequests);
+  socket_->writev(this, iovs.data(), iovs.size(),
+                  more ? folly::WriteFlags::CORK : folly::WriteFlags::NONE);
+  iovs.clear();
+}
+
 namespace {
 
 void createTCPKeepAliveOptions(
@@ -447,10 +563,12 @@ void AsyncMcClientImpl::attemptConnection() {
 
     folly::SocketAddress address;
     try {
-      address = folly::SocketAddress(
+      /* HostResolver caches hostname lookups process-wide and falls back
+         to the previously-known address when DNS is unresponsive, so a
+         dead DNS server can't stall the event loop on every reconnect. */
+      address = HostResolver::instance().resolve(
         connectionOptions_.accessPoint->getHost(),
-        connectionOptions_.accessPoint->getPort(),
-        /* allowNameLookup */ true);
+        connectionOptions_.accessPoint->getPort());
     } catch (const std::system_error& e) {
       LOG_FAILURE("AsyncMcClient", failure::Category::kBadEnvironment,
                   "{}", e.what());
@@ -462,6 +580,9 @@ void AsyncMcClientImpl::attemptConnection() {
     auto socketOptions = createSocketOptions(address, connectionOptions_);
 
     socket.setSendTimeout(connectionOptions_.writeTimeout.count());
+    if (canOptimisticallyWrite()) {
+      socket.enableTFO();
+    }
     socket.connect(this, address, connectionOptions_.writeTimeout.count(),
                    socketOptions);
 
@@ -469,6 +590,14 @@ void AsyncMcClientImpl::attemptConnection() {
     if (socket_ && connectionOptions_.enableQoS) {
       checkWhetherQoSIsApplied(address, socket.getFd(), connectionOptions_);
     }
+
+    if (socket_ && connectionState_ == ConnectionState::CONNECTING &&
+        canOptimisticallyWrite()) {
+      /* Write pending requests right away: with TFO the kernel carries
+         them in the SYN payload, so the first request after a reconnect
+         doesn't wait for the handshake to complete. */
+      scheduleNextWriterLoop();
+    }
   });
 }
 
@@ -484,7 +613,8 @@ void AsyncMcClientImpl::connectSuccess() noexcept {
   if (!connectionOptions_.debugFifoPath.empty()) {
     if (auto fifoManager = FifoManager::getInstance()) {
       auto fifo =
-          fifoManager->fetchThreadLocal(connectionOptions_.debugFifoPath);
+          fifoManager->fetchThreadLocal(connectionOptions_.debugFifoPath,
+                                        connectionOptions_.debugFifoRingBytes);
       debugFifo_ = ConnectionFifo(std::move(fifo), socket_.get());
     }
   }
@@ -500,8 +630,10 @@ void AsyncMcClientImpl::connectSuccess() noexcept {
     }
   }
 
-  assert(getInflightRequestCount() == 0);
-  assert(queue_.getParserInitializer() == nullptr);
+  /* With optimistic pre-connect writes some requests may already be
+     inflight by the time the handshake completes. */
+  assert(canOptimisticallyWrite() || getInflightRequestCount() == 0);
+  assert(canOptimisticallyWrite() || queue_.getParserInitializer() == nullptr);
 
   scheduleNextWriterLoop();
   parser_ = folly::make_unique<ParserT>(
@@ -509,8 +641,10 @@ void AsyncMcClientImpl::connectSuccess() noexcept {
       kReadBufferSizeMin,
       kReadBufferSizeMax,
       connectionOptions_.useJemallocNodumpAllocator,
+      connectionOptions_.useHugePageBuffers,
       connectionOptions_.compressionCodecMap,
-      &debugFifo_);
+      &debugFifo_,
+      connectionOptions_.replyPassthrough);
   socket_->setReadCB(this);
 }
 
@@ -541,11 +675,18 @@ void AsyncMcClientImpl::connectErr(
     error = mc_res_connect_error;
   }
 
-  assert(getInflightRequestCount() == 0);
+  assert(canOptimisticallyWrite() || getInflightRequestCount() == 0);
+  /* Optimistically written requests whose writes already failed sit in the
+     sent queue; fail them along with everything pending. */
+  queue_.failAllSent(error);
   queue_.failAllPending(error);
   connectionState_ = ConnectionState::DOWN;
   // We don't need it anymore, so let it perform complete cleanup.
   socket_.reset();
+  /* Resetting the socket fails any writevs still outstanding; their
+     writeErr callbacks move the affected requests to the sent queue. */
+  queue_.failAllSent(error);
+  pendingWriteBatches_.clear();
 
   if (statusCallbacks_.onDown) {
     statusCallbacks_.onDown(isAborting_);
@@ -586,6 +727,8 @@ void AsyncMcClientImpl::processShutdown() {
         connectionState_ = ConnectionState::DOWN;
         // We don't need it anymore, so let it perform complete cleanup.
         socket_.reset();
+        // All outstanding writevs were failed by the socket by now.
+        pendingWriteBatches_.clear();
 
         // In case we still have some pending requests, then try reconnecting
         // immediately.
@@ -630,14 +773,20 @@ void AsyncMcClientImpl::readErr(
 
 void AsyncMcClientImpl::writeSuccess() noexcept {
   assert(connectionState_ == ConnectionState::UP ||
-         connectionState_ == ConnectionState::ERROR);
+         connectionState_ == ConnectionState::ERROR ||
+         connectionState_ == ConnectionState::CONNECTING);
   DestructorGuard dg(this);
-  auto& req = queue_.markNextAsSent();
-  req.scheduleTimeout();
-
-  // In case of no-network we need to provide fake reply.
-  if (connectionOptions_.noNetwork) {
-    sendFakeReply(req);
+  assert(!pendingWriteBatches_.empty());
+  auto batchSize = pendingWriteBatches_.front();
+  pendingWriteBatches_.pop_front();
+  while (batchSize-- > 0) {
+    auto& req = queue_.markNextAsSent();
+    req.scheduleTimeout(*timeoutWheel_);
+
+    // In case of no-network we need to provide fake reply.
+    if (connectionOptions_.noNetwork) {
+      sendFakeReply(req);
+    }
   }
 
   // It is possible that we're already processing error, but still have a
@@ -651,7 +800,9 @@ void AsyncMcClientImpl::writeErr(
     size_t bytesWritten, const folly::AsyncSocketException& ex) noexcept {
 
   assert(connectionState_ == ConnectionState::UP ||
-         connectionState_ == ConnectionState::ERROR);
+         connectionState_ == ConnectionState::ERROR ||
+         connectionState_ == ConnectionState::CONNECTING ||
+         connectionState_ == ConnectionState::DOWN);
 
   VLOG(1) << "Failed to write into socket with remote endpoint \""
           << connectionOptions_.accessPoint->toString()
@@ -660,8 +811,18 @@ void AsyncMcClientImpl::writeErr(
 
   // We're already in an error state, so all requests in pendingReplyQueue_ will
   // be replied with an error.
-  queue_.markNextAsSent();
-  processShutdown();
+  assert(!pendingWriteBatches_.empty());
+  auto batchSize = pendingWriteBatches_.front();
+  pendingWriteBatches_.pop_front();
+  while (batchSize-- > 0) {
+    queue_.markNextAsSent();
+  }
+  if (connectionState_ == ConnectionState::UP ||
+      connectionState_ == ConnectionState::ERROR) {
+    processShutdown();
+  }
+  /* Optimistic writes failing while CONNECTING (or during the socket
+     teardown in connectErr) are failed by connectErr itself. */
 }
 
 folly::StringPiece AsyncMcClientImpl::clientStateToStr() const {
@@ -10,12 +10,15 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <string>
 
 #include <folly/fibers/Baton.h>
 #include <folly/io/async/AsyncTransport.h>
 #include <folly/io/async/DelayedDestruction.h>
+#include <folly/io/async/HHWheelTimer.h>
 #include <folly/io/IOBufQueue.h>
+#include <folly/small_vector.h>
 
 #include "mcrouter/lib/CompressionCodecManager.h"
 #include "mcrouter/lib/Operation.h"
@@ -24,6 +27,7 @@
 #include "mcrouter/lib/network/ClientMcParser.h"
 #include "mcrouter/lib/network/ConnectionOptions.h"
 #include "mcrouter/lib/network/McClientRequestContext.h"
+#include "mcrouter/lib/network/McUdpTransport.h"
 
 namespace facebook { namespace memcache {
 
@@ -66,7 +70,8 @@ class AsyncMcClientImpl :
 
   template <class Request>
   ReplyT<Request> sendSync(const Request& request,
-                           std::chrono::milliseconds timeout);
+                           std::chrono::milliseconds timeout,
+                           RequestAborter* aborter = nullptr);
 
   void setThrottle(size_t maxInflight, size_t maxPending);
 
@@ -128,6 +133,15 @@ class AsyncMcClientImpl :
   bool outOfOrder_{false};
   McClientRequestContextQueue queue_;
 
+  // UDP fast path for get-like requests; nullptr unless
+  // ConnectionOptions::enableUdpForGets is set for an ascii destination.
+  std::unique_ptr<McUdpTransport> udpTransport_;
+
+  // Hashed wheel timer shared by all requests of this client. Each request
+  // is an intrusive timer callback, so scheduling a reply timeout is O(1)
+  // and doesn't allocate.
+  folly::HHWheelTimer::UniquePtr timeoutWheel_;
+
   // Id for the next message that will be used by the next sendMsg() call.
   uint64_t nextMsgId_{1};
 
@@ -140,6 +154,22 @@ class AsyncMcClientImpl :
   bool writeScheduled_{false};
   std::unique_ptr<WriterLoop> writer_;
 
+  // Delayed-flush (application-level Nagle) state; see
+  // ConnectionOptions::flushDelay. flushTimer_ is non-null iff enabled.
+  class FlushTimer;
+  std::unique_ptr<FlushTimer> flushTimer_;
+  // Serialized bytes queued since the last writer run; once this reaches
+  // ConnectionOptions::flushDelayMaxBytes the delay is cut short.
+  size_t pendingFlushBytes_{0};
+
+  // Number of iovecs we keep on the stack while gathering a write batch.
+  static constexpr size_t kStackIovecs = 64;
+  using WriteIovecVector = folly::small_vector<struct iovec, kStackIovecs>;
+  // Number of requests gathered into each outstanding writev, in issue
+  // order. writeSuccess()/writeErr() are invoked once per writev, so this
+  // tells them how many requests to mark as sent.
+  std::deque<size_t> pendingWriteBatches_;
+
   bool isAborting_{false};
   std::unique_ptr<detail::OnEventBaseDestructionCallback>
     eventBaseDestructionCallback_;
@@ -155,9 +185,19 @@ class AsyncMcClientImpl :
   // Write some requests from sendQueue_ to the socket, until max inflight limit
   // is reached or queue is empty.
   void pushMessages();
+  // Issue a single writev for a batch of numRequests gathered requests.
+  // more is true iff further batches will follow in the same loop iteration.
+  void flushWriteBatch(WriteIovecVector& iovs, size_t numRequests, bool more);
   // Schedule next writer loop if it's not scheduled.
   void scheduleNextWriterLoop();
   void cancelWriterCallback();
+  // Ends a flush delay window: schedules the writer for whatever is
+  // pending, regardless of how few bytes accumulated.
+  void flushTimerExpired();
+
+  // True if requests may be written while the connection is still being
+  // established (TCP Fast Open enabled, plain socket, out-of-order protocol).
+  bool canOptimisticallyWrite() const;
 
   void attemptConnection();
 
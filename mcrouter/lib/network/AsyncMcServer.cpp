@@ -9,6 +9,7 @@
  */
 #include "AsyncMcServer.h"
 
+#include <netinet/tcp.h>
 #include <signal.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -31,8 +32,26 @@
 namespace facebook { namespace memcache {
 
 namespace {
+
 /* Global pointer to the server for signal handlers */
 facebook::memcache::AsyncMcServer* gServer;
+
+void applyDeferAccept(folly::AsyncServerSocket& socket, uint32_t seconds) {
+#ifdef TCP_DEFER_ACCEPT
+  int secs = seconds;
+  for (auto fd : socket.getSockets()) {
+    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                   &secs, sizeof(secs)) != 0) {
+      LOG(WARNING) << "Failed to set TCP_DEFER_ACCEPT: "
+                   << folly::errnoStr(errno);
+    }
+  }
+#else
+  LOG(WARNING) << "TCP_DEFER_ACCEPT requested, "
+               << "but it is not supported by the system";
+#endif
+}
+
 } // anonymous
 
 
@@ -70,7 +89,8 @@ class McServerThread {
         evb_(/* enableTimeMeasurement */ false),
         worker_(server.opts_.worker, evb_),
         acceptCallback_(this, false),
-        sslAcceptCallback_(this, true) {
+        sslAcceptCallback_(this, true),
+        accepting_(server.opts_.reusePort) {
   }
 
   enum AcceptorT { Acceptor };
@@ -151,6 +171,25 @@ class McServerThread {
     }
   }
 
+  /** Valid after waitForAcceptor(); empty on non-accepting threads. */
+  const std::vector<int>& listeningSocketFds() const {
+    return listeningFds_;
+  }
+
+  /* Safe to call from other threads */
+  void pauseAccepting() {
+    auto result = evb_.runInEventBaseThread(
+      [this] () {
+        if (socket_) {
+          socket_->pauseAccepting();
+        }
+        if (sslSocket_) {
+          sslSocket_->pauseAccepting();
+        }
+      });
+    CHECK(result) << "error calling runInEventBaseThread";
+  }
+
   void join() {
     if (thread_.joinable()) {
       thread_.join();
@@ -206,6 +245,7 @@ class McServerThread {
 
   folly::AsyncServerSocket::UniquePtr socket_;
   folly::AsyncServerSocket::UniquePtr sslSocket_;
+  std::vector<int> listeningFds_;
   std::unique_ptr<ShutdownPipe> shutdownPipe_;
 
   void startAccepting() {
@@ -213,7 +253,18 @@ class McServerThread {
     try {
       auto& opts = server_.opts_;
 
+      std::vector<int> existingFds = opts.existingSocketFds;
       if (opts.existingSocketFd != -1) {
+        existingFds.push_back(opts.existingSocketFd);
+      }
+
+      if (opts.reusePort) {
+        checkLogic(existingFds.empty() &&
+                   opts.unixDomainSockPath.empty(),
+                   "reusePort requires listening on TCP ports");
+      }
+
+      if (!existingFds.empty()) {
         checkLogic(opts.ports.empty() && opts.sslPorts.empty(),
                    "Can't use ports if using existing socket");
         if (!opts.pemCertPath.empty() || !opts.pemKeyPath.empty() ||
@@ -225,10 +276,10 @@ class McServerThread {
             "if at least one of them set");
 
           sslSocket_.reset(new folly::AsyncServerSocket());
-          sslSocket_->useExistingSocket(opts.existingSocketFd);
+          sslSocket_->useExistingSockets(existingFds);
         } else {
           socket_.reset(new folly::AsyncServerSocket());
-          socket_->useExistingSocket(opts.existingSocketFd);
+          socket_->useExistingSockets(existingFds);
         }
       } else if (!opts.unixDomainSockPath.empty()) {
         checkLogic(opts.ports.empty() && opts.sslPorts.empty() &&
@@ -245,6 +296,7 @@ class McServerThread {
                    "At least one port (plain or SSL) must be speicified");
         if (!server_.opts_.ports.empty()) {
           socket_.reset(new folly::AsyncServerSocket());
+          socket_->setReusePortEnabled(opts.reusePort);
           for (auto port : server_.opts_.ports) {
             socket_->bind(port);
           }
@@ -257,6 +309,7 @@ class McServerThread {
                      " with sslPorts");
 
           sslSocket_.reset(new folly::AsyncServerSocket());
+          sslSocket_->setReusePortEnabled(opts.reusePort);
           for (auto sslPort : server_.opts_.sslPorts) {
             sslSocket_->bind(sslPort);
           }
@@ -274,12 +327,43 @@ class McServerThread {
         sslSocket_->attachEventBase(&evb_);
       }
 
-      for (auto& t : server_.threads_) {
+      if (socket_) {
+        for (auto fd : socket_->getSockets()) {
+          listeningFds_.push_back(fd);
+        }
+      }
+      if (sslSocket_) {
+        for (auto fd : sslSocket_->getSockets()) {
+          listeningFds_.push_back(fd);
+        }
+      }
+
+      if (opts.tcpDeferAcceptSecs != 0 && opts.unixDomainSockPath.empty()) {
+        if (socket_) {
+          applyDeferAccept(*socket_, opts.tcpDeferAcceptSecs);
+        }
+        if (sslSocket_) {
+          applyDeferAccept(*sslSocket_, opts.tcpDeferAcceptSecs);
+        }
+      }
+
+      if (opts.reusePort) {
+        /* Every thread owns its own socket; accept locally and let
+           the kernel spread connections across the listeners. */
         if (socket_ != nullptr) {
-          socket_->addAcceptCallback(&t->acceptCallback_, &t->evb_);
+          socket_->addAcceptCallback(&acceptCallback_, &evb_);
         }
         if (sslSocket_ != nullptr) {
-          sslSocket_->addAcceptCallback(&t->sslAcceptCallback_, &t->evb_);
+          sslSocket_->addAcceptCallback(&sslAcceptCallback_, &evb_);
+        }
+      } else {
+        for (auto& t : server_.threads_) {
+          if (socket_ != nullptr) {
+            socket_->addAcceptCallback(&t->acceptCallback_, &t->evb_);
+          }
+          if (sslSocket_ != nullptr) {
+            sslSocket_->addAcceptCallback(&t->sslAcceptCallback_, &t->evb_);
+          }
         }
       }
     } catch (...) {
@@ -349,13 +433,24 @@ void AsyncMcServer::spawn(LoopFn fn, std::function<void()> onShutdown) {
   CHECK(threads_.size() == opts_.numThreads);
   onShutdown_ = std::move(onShutdown);
 
-  /* We need to make sure we register all acceptor callbacks before
-     running spawn() on other threads. This is so that eventBase.loop()
-     never exits immediately on non-acceptor threads. */
-  threads_[0]->spawn(fn, 0);
-  threads_[0]->waitForAcceptor();
-  for (size_t id = 1; id < threads_.size(); ++id) {
-    threads_[id]->spawn(fn, id);
+  if (opts_.reusePort) {
+    /* Each thread binds its own listening socket; wait for all of them
+       so that bind/listen failures surface from spawn(). */
+    for (size_t id = 0; id < threads_.size(); ++id) {
+      threads_[id]->spawn(fn, id);
+    }
+    for (auto& thread : threads_) {
+      thread->waitForAcceptor();
+    }
+  } else {
+    /* We need to make sure we register all acceptor callbacks before
+       running spawn() on other threads. This is so that eventBase.loop()
+       never exits immediately on non-acceptor threads. */
+    threads_[0]->spawn(fn, 0);
+    threads_[0]->waitForAcceptor();
+    for (size_t id = 1; id < threads_.size(); ++id) {
+      threads_[id]->spawn(fn, id);
+    }
   }
 
   /* We atomically attempt to change the state STARTUP -> SPAWNED.
@@ -373,6 +468,21 @@ void AsyncMcServer::spawn(LoopFn fn, std::function<void()> onShutdown) {
              SignalShutdownState::SPAWNED));
 }
 
+std::vector<int> AsyncMcServer::listeningSocketFds() const {
+  std::vector<int> out;
+  for (auto& thread : threads_) {
+    const auto& fds = thread->listeningSocketFds();
+    out.insert(out.end(), fds.begin(), fds.end());
+  }
+  return out;
+}
+
+void AsyncMcServer::pauseAccepting() {
+  for (auto& thread : threads_) {
+    thread->pauseAccepting();
+  }
+}
+
 void AsyncMcServer::shutdown() {
   if (!alive_.exchange(false)) {
     return;
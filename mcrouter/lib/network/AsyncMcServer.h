@@ -46,6 +46,14 @@ class AsyncMcServer {
      */
     int existingSocketFd{-1};
 
+    /**
+     * Take over multiple externally created sockets (e.g. received from
+     * an old instance during a zero-downtime restart).  Same semantics
+     * as existingSocketFd.  May be combined with it, but not with ports
+     * or unixDomainSockPath.
+     */
+    std::vector<int> existingSocketFds;
+
     /**
      * Create Unix Domain Socket to listen on.
      * If this is used (not empty), port must be empty,
@@ -58,6 +66,19 @@ class AsyncMcServer {
      */
     int tcpListenBacklog{SOMAXCONN};
 
+    /**
+     * If nonzero, sets TCP_DEFER_ACCEPT with this timeout (in seconds)
+     * on the listening sockets: the kernel completes the handshake but
+     * only wakes the acceptor once the client's first request bytes have
+     * arrived, so a new connection costs one accept-path wakeup instead
+     * of two (accept, then first read).  Clients that connect without
+     * sending (health checkers doing bare connect/close) are still
+     * accepted when the timeout expires.
+     * Ignored for unix domain sockets.  If 0, accept fires on handshake
+     * completion as usual.
+     */
+    uint32_t tcpDeferAcceptSecs{0};
+
     /**
      * The list of ports to listen on.
      * If this is used, existingSocketFd must be unset (-1).
@@ -83,6 +104,16 @@ class AsyncMcServer {
      */
     size_t numThreads{1};
 
+    /**
+     * If true, every worker thread opens its own listening socket with
+     * SO_REUSEPORT set and the kernel load-balances incoming connections
+     * across them.  This removes the single accept thread and the
+     * cross-thread session handoff it implies.
+     * Requires ports and/or sslPorts; incompatible with existingSocketFd
+     * and unixDomainSockPath.
+     */
+    bool reusePort{false};
+
     /**
      * Worker-specific options
      */
@@ -141,6 +172,20 @@ class AsyncMcServer {
    */
   void shutdown();
 
+  /**
+   * @return  Raw fds of all listening sockets.  Only valid between the
+   *          return of spawn() and shutdown.
+   */
+  std::vector<int> listeningSocketFds() const;
+
+  /**
+   * Stop accepting new connections while keeping the listening fds open
+   * and existing sessions running.  Used during zero-downtime restarts
+   * once the fds have been handed to the new process.
+   * Can be called from any thread; can only be called after spawn().
+   */
+  void pauseAccepting();
+
   /**
    * Installs a new handler for the given signals that would shutdown
    * this server when delivered.
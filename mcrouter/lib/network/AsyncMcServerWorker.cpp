@@ -23,7 +23,7 @@ AsyncMcServerWorker::AsyncMcServerWorker(AsyncMcServerWorkerOptions opts,
                                          folly::EventBase& eventBase)
     : opts_(std::move(opts)),
       eventBase_(eventBase),
-      tracker_(opts_.maxConns) {
+      tracker_(opts_.maxConns, opts_.maxConnsPerPeer) {
 }
 
 bool AsyncMcServerWorker::addSecureClientSocket(
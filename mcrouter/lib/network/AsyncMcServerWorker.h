@@ -162,6 +162,15 @@ class AsyncMcServerWorker {
    */
   bool writesPending() const;
 
+  /**
+   * Compression benefit curve of this worker's sessions, bucketed by
+   * reply size, for auditing what the compression filter learned.
+   * See CompressionFilter.
+   */
+  std::vector<CompressionFilter::SizeBucketStats> getCompressionStats() const {
+    return tracker_.getCompressionStats();
+  }
+
  private:
   bool addClientSocket(
       folly::AsyncSocket::UniquePtr&& socket,
@@ -41,6 +41,40 @@ struct AsyncMcServerWorkerOptions {
    */
   uint16_t maxReadsPerEvent{0};
 
+  /**
+   * If greater than 1, requests parsed from a single read event are
+   * dispatched to the application in batches of up to this many requests:
+   * the onRequest callback is told when a batch starts and finishes, so it
+   * can defer per-request cross-thread notifications (e.g. proxy queue
+   * wakeups) until the batch is complete.
+   * If 0 or 1, every request is dispatched individually.
+   */
+  size_t requestBatchSize{0};
+
+  /**
+   * If nonzero, multi-op (ascii multiget) replies are streamed: once at
+   * least this many bytes of completed sub-replies have accumulated, the
+   * contiguous completed prefix is released to the socket instead of
+   * being held until the batch's END, bounding per-request reply memory.
+   * Note that once part of a reply has been streamed, an error in a
+   * later sub-request is appended after the already-written values
+   * instead of replacing the whole reply with a single error line.
+   * If 0, sub-replies buffer until the entire batch completes.
+   */
+  size_t multiOpStreamBytes{0};
+
+  /**
+   * If nonzero, replies at least this many bytes long on out-of-order
+   * protocols (umbrella/caret, where the client matches replies by id) are
+   * deferred to their own write, at most one per event loop iteration, so
+   * small replies completing in the meantime are written ahead of the
+   * remaining large ones. This bounds the queueing delay a multi-megabyte
+   * value can impose on tiny replies sharing the connection. In-order
+   * protocols are never reordered.
+   * If 0, replies are written strictly in completion order.
+   */
+  size_t largeReplyDeferBytes{0};
+
   /**
    * Timeout for writes (i.e. replies to the clients).
    * If 0, no timeout.
@@ -59,6 +93,50 @@ struct AsyncMcServerWorkerOptions {
    */
   size_t maxConns{0};
 
+  /**
+   * Max connections a single client IP may keep open on this worker.
+   * An IP above the cap has its own least recently active connection
+   * closed, and under maxConns pressure over-quota IPs are evicted
+   * before well-behaved ones.
+   * If 0, connections are not accounted per client IP.
+   */
+  size_t maxConnsPerPeer{0};
+
+  /**
+   * If nonzero, sets TCP_NOTSENT_LOWAT to this many bytes on accepted
+   * connections and stops reading new requests from a session while the
+   * kernel still holds unsent reply bytes above that mark. This bounds
+   * per-connection reply memory when clients consume slowly.
+   * If 0, replies are pushed without regard to kernel buffer occupancy.
+   */
+  size_t tcpNotsentLowat{0};
+
+  /**
+   * If nonzero, sets SO_BUSY_POLL to this many microseconds on accepted
+   * connections, so blocking receive paths busy-poll the device queue
+   * instead of waiting for an interrupt. The event loop driving the
+   * worker may use the same value as a userspace spin window (see
+   * mcrouter/server.cpp). Saves a wakeup per event on hot sockets at
+   * the cost of burning idle CPU; leave at 0 for mixed-use hosts.
+   */
+  uint32_t busyPollUs{0};
+
+  /**
+   * If true, umbrella/caret read buffers are allocated from a jemalloc
+   * arena whose chunks are marked MADV_DONTDUMP, keeping request
+   * payloads (and reply values sharing those buffers) out of core
+   * dumps. No effect if jemalloc 4+ is not in use.
+   */
+  bool useJemallocNodumpAllocator{false};
+
+  /**
+   * If true, large read buffers are allocated from a jemalloc arena
+   * whose chunks are advised MADV_HUGEPAGE, so hot sessions get 2MB
+   * TLB entries instead of 4KB ones. No effect if jemalloc 4+ is not
+   * in use or the kernel lacks transparent hugepage support.
+   */
+  bool useHugePageBuffers{false};
+
   /**
    * Smallest allowed buffer size.
    */
@@ -79,6 +157,13 @@ struct AsyncMcServerWorkerOptions {
    * If empty, debug fifo is disabled.
    */
   std::string debugFifoPath;
+
+  /**
+   * If nonzero, the debug fifo is backed by a shared-memory ring of
+   * this many bytes per thread (drop-on-full, see RingFifo) instead of
+   * a named pipe, making always-on capture cheap enough for production.
+   */
+  size_t debugFifoRingBytes{0};
 };
 
 }}  // facebook::memcache
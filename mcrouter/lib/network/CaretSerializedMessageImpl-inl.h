@@ -7,13 +7,98 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <array>
+#include <string>
+
+#include <folly/io/IOBufQueue.h>
+
 #include "mcrouter/lib/Compression.h"
 #include "mcrouter/lib/CompressionCodecManager.h"
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/lib/network/CompressionFilter.h"
 #include "mcrouter/lib/network/ThriftMsgDispatcher.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
 
 namespace facebook { namespace memcache {
 
+namespace detail {
+
+template <class... Ts>
+struct VoidTImpl {
+  using type = void;
+};
+template <class... Ts>
+using VoidT = typename VoidTImpl<Ts...>::type;
+
+/**
+ * Matches reply types with the standard optional field set
+ * (value/flags/message/appSpecificErrorCode), i.e. all the hot data path
+ * replies. Other reply types always take the generic serialization path.
+ */
+template <class ThriftType, class = void>
+struct HasSimpleReplyFields : std::false_type {};
+
+template <class ThriftType>
+struct HasSimpleReplyFields<
+    ThriftType,
+    VoidT<decltype(std::declval<ThriftType>().__isset.value),
+          decltype(std::declval<ThriftType>().__isset.flags),
+          decltype(std::declval<ThriftType>().__isset.message),
+          decltype(std::declval<ThriftType>().__isset.appSpecificErrorCode)>>
+    : std::true_type {};
+
+template <class ThriftType>
+typename std::enable_if<HasSimpleReplyFields<ThriftType>::value, bool>::type
+isResultOnlyReply(const TypedThriftReply<ThriftType>& reply) {
+  const auto& isset = reply->__isset;
+  return !isset.value && !isset.flags && !isset.message &&
+         !isset.appSpecificErrorCode;
+}
+
+template <class ThriftType>
+typename std::enable_if<!HasSimpleReplyFields<ThriftType>::value, bool>::type
+isResultOnlyReply(const TypedThriftReply<ThriftType>&) {
+  return false;
+}
+
+/**
+ * Replies that carry nothing but a result code (misses, STORED, DELETED)
+ * serialize to a few-byte compact-protocol body that depends only on the
+ * reply type and the result. Cache one body per result so the hot reply
+ * path appends the bytes directly instead of running the thrift writer.
+ */
+template <class ThriftType>
+class ResultOnlyReplyBodyCache {
+ public:
+  static folly::StringPiece body(mc_res_t result) {
+    static const ResultOnlyReplyBodyCache<ThriftType> cache;
+    assert(result >= 0 && result < mc_nres);
+    return folly::StringPiece(cache.bodies_[result]);
+  }
+
+ private:
+  ResultOnlyReplyBodyCache() {
+    for (int res = 0; res < mc_nres; ++res) {
+      TypedThriftReply<ThriftType> reply;
+      reply.setResult(static_cast<mc_res_t>(res));
+      apache::thrift::CompactProtocolWriter writer;
+      folly::IOBufQueue queue;
+      writer.setOutput(&queue);
+      reply->write(&writer);
+      auto buf = queue.move();
+      if (buf) {
+        buf->coalesce();
+        bodies_[res].assign(reinterpret_cast<const char*>(buf->data()),
+                            buf->length());
+      }
+    }
+  }
+
+  std::array<std::string, mc_nres> bodies_;
+};
+
+} // detail
+
 template <class ThriftType>
 bool CaretSerializedMessage::prepare(const TypedThriftRequest<ThriftType>& req,
                                      size_t reqId,
@@ -37,10 +122,14 @@ template <class ThriftType>
 bool CaretSerializedMessage::prepare(TypedThriftReply<ThriftType>&& reply,
                                      size_t reqId,
                                      CompressionCodec* codec,
+                                     CompressionFilter* filter,
+                                     uint32_t bucket,
                                      const struct iovec*& iovOut,
                                      size_t& niovOut) noexcept {
   constexpr size_t typeId = IdFromType<ThriftType, TReplyList>::value;
-  return fill(reply, reqId, typeId, 0 /* traceId */, codec, iovOut, niovOut);
+  return fill(
+      reply, reqId, typeId, 0 /* traceId */, codec, filter, bucket, iovOut,
+      niovOut);
 }
 
 template <class ThriftType>
@@ -52,11 +141,29 @@ bool CaretSerializedMessage::fill(const TypedThriftRequest<ThriftType>& tmsg,
                                   const struct iovec*& iovOut,
                                   size_t& niovOut) {
   // Serialize body into storage_. Note we must defer serialization of header.
-  serializeThriftStruct(tmsg, storage_);
+  // The body depends only on the struct, not on the destination, so fanned
+  // out requests (shadow, all-sync, failover retries) serialize it at most
+  // twice: the second destination builds a refcounted copy of the bytes and
+  // every destination after that just appends it.
+  if (const auto* cachedBody = tmsg.serializedBodyCache()) {
+    storage_.append(*cachedBody);
+  } else if (tmsg.noteSerialization() > 1) {
+    apache::thrift::CompactProtocolWriter writer(
+        apache::thrift::SHARE_EXTERNAL_BUFFER);
+    folly::IOBufQueue queue;
+    writer.setOutput(&queue);
+    tmsg->write(&writer);
+    auto body = queue.move();
+    storage_.append(*body);
+    tmsg.setSerializedBodyCache(std::move(body));
+  } else {
+    serializeThriftStruct(tmsg, storage_);
+  }
 
   UmbrellaMessageInfo info;
   info.supportedCodecsFirstId = supportedCodecs.firstId;
   info.supportedCodecsSize = supportedCodecs.size;
+  info.deadlineMs = tmsg.deadlineMs();
   fillImpl(info, reqId, typeId, traceId, iovOut, niovOut);
   return true;
 }
@@ -67,17 +174,35 @@ bool CaretSerializedMessage::fill(const TypedThriftReply<ThriftType>& tmsg,
                                   size_t typeId,
                                   uint64_t traceId,
                                   CompressionCodec* codec,
+                                  CompressionFilter* filter,
+                                  uint32_t bucket,
                                   const struct iovec*& iovOut,
                                   size_t& niovOut) {
 
-  // Serialize and (maybe) compress body of message.
-  serializeThriftStruct(tmsg, storage_);
+  // Serialize and (maybe) compress body of message. A reply that still
+  // carries the body bytes of the caret frame it was parsed from is
+  // forwarded verbatim: only the header (which holds this client's reqid)
+  // is rebuilt. Result-only replies reuse a pre-serialized body; they are
+  // too small to ever compress.
+  if (const auto* wireBody = tmsg.wireBody()) {
+    storage_.append(*wireBody);
+  } else if (detail::isResultOnlyReply(tmsg)) {
+    const auto body =
+        detail::ResultOnlyReplyBodyCache<ThriftType>::body(tmsg.result());
+    storage_.push(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+
+    UmbrellaMessageInfo info;
+    fillImpl(info, reqId, typeId, traceId, iovOut, niovOut);
+    return true;
+  } else {
+    serializeThriftStruct(tmsg, storage_);
+  }
 
   UmbrellaMessageInfo info;
 
   // Maybe compress.
   auto uncompressedSize = storage_.computeBodySize();
-  if (maybeCompress(codec, uncompressedSize)) {
+  if (maybeCompress(codec, uncompressedSize, filter, bucket)) {
     info.usedCodecId = codec->id();
     info.uncompressedBodySize = uncompressedSize;
   }
@@ -87,7 +212,9 @@ bool CaretSerializedMessage::fill(const TypedThriftReply<ThriftType>& tmsg,
 }
 
 inline bool CaretSerializedMessage::maybeCompress(CompressionCodec* codec,
-                                                  size_t uncompressedSize) {
+                                                  size_t uncompressedSize,
+                                                  CompressionFilter* filter,
+                                                  uint32_t bucket) {
   if (!codec) {
     return false;
   }
@@ -97,13 +224,28 @@ inline bool CaretSerializedMessage::maybeCompress(CompressionCodec* codec,
     return false;
   }
 
+  // Values whose key prefix or size class historically did not benefit
+  // from compression are not worth the attempt.
+  if (filter && !filter->shouldCompress(bucket, uncompressedSize)) {
+    return false;
+  }
+
   static constexpr size_t kCompressionOverhead = 4;
   try {
     const auto iovs = storage_.getIovecs();
     // The first iovec is the header - we need to compress just the data.
     auto compressedBuf = codec->compress(iovs.first + 1, iovs.second - 1);
     auto compressedSize = compressedBuf->computeChainDataLength();
-    if ((compressedSize + kCompressionOverhead) < uncompressedSize) {
+    const bool worthIt =
+        (compressedSize + kCompressionOverhead) < uncompressedSize;
+    if (filter) {
+      filter->recordOutcome(
+          bucket,
+          uncompressedSize,
+          worthIt ? compressedSize + kCompressionOverhead : uncompressedSize,
+          worthIt);
+    }
+    if (worthIt) {
       storage_.reset();
       storage_.append(*compressedBuf);
       return true;
@@ -20,6 +20,7 @@ namespace memcache {
 
 struct CodecIdRange;
 class CompressionCodec;
+class CompressionFilter;
 template <class T>
 class TypedThriftMessage;
 template <class T>
@@ -65,6 +66,10 @@ class CaretSerializedMessage {
    * @param  reply    TypedReply
    * @param  codec    Codec to use to compress the reply. If nullptr, reply
    *                  won't be compressed.
+   * @param  filter   Per-session compression filter consulted before
+   *                  attempting compression. May be nullptr.
+   * @param  bucket   Compression filter bucket of the request key, or
+   *                  CompressionFilter::kNoBucket if unknown.
    * @param  iovOut   will be set to the beginning of array of ivecs
    * @param  niovOut  number of valid iovecs referenced by iovOut.
    * @return true iff message was successfully prepared.
@@ -73,6 +78,8 @@ class CaretSerializedMessage {
   bool prepare(TypedThriftReply<ThriftType>&& reply,
                size_t reqId,
                CompressionCodec* codec,
+               CompressionFilter* filter,
+               uint32_t bucket,
                const struct iovec*& iovOut,
                size_t& niovOut) noexcept;
 
@@ -94,6 +101,8 @@ class CaretSerializedMessage {
             size_t typeId,
             uint64_t traceId,
             CompressionCodec* codec,
+            CompressionFilter* filter,
+            uint32_t bucket,
             const struct iovec*& iovOut,
             size_t& niovOut);
 
@@ -110,9 +119,15 @@ class CaretSerializedMessage {
    * @param codec             Compression codec to use in compression.
    * @param uncompressedSize  Original (uncompressed) size of the body of the
    *                          message.
+   * @param filter            If non-null, consulted before attempting
+   *                          compression and updated with the outcome.
+   * @param bucket            Compression filter bucket of the request key.
    * @return                  True if compression succeeds. Otherwise, false.
    */
-  bool maybeCompress(CompressionCodec* codec, size_t uncompressedSize);
+  bool maybeCompress(CompressionCodec* codec,
+                     size_t uncompressedSize,
+                     CompressionFilter* filter,
+                     uint32_t bucket);
 };
 
 } // memcache
@@ -7,6 +7,8 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <cstring>
+
 #include <folly/io/Cursor.h>
 #include <thrift/lib/cpp2/protocol/CompactProtocol.h>
 
@@ -21,17 +23,21 @@ ClientMcParser<Callback>::ClientMcParser(
     size_t minBufferSize,
     size_t maxBufferSize,
     const bool useJemallocNodumpAllocator,
+    const bool useHugePageBuffers,
     const CompressionCodecMap* compressionCodecMap,
-    ConnectionFifo* debugFifo)
+    ConnectionFifo* debugFifo,
+    const bool captureWireBodies)
     : parser_(
           *this,
           minBufferSize,
           maxBufferSize,
           useJemallocNodumpAllocator,
+          useHugePageBuffers,
           debugFifo),
       callback_(cb),
       debugFifo_(debugFifo),
-      compressionCodecMap_(compressionCodecMap) {}
+      compressionCodecMap_(compressionCodecMap),
+      captureWireBodies_(captureWireBodies) {}
 
 template <class Callback>
 std::pair<void*, size_t> ClientMcParser<Callback>::getReadBuffer() {
@@ -65,7 +71,11 @@ void ClientMcParser<Callback>::expectNext() {
     if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
       debugFifo_->startMessage(
           MessageDirection::Received,
-          IdFromType<typename ReplyT<Request>::rawType, TReplyList>::value);
+          IdFromType<typename ReplyT<Request>::rawType, TReplyList>::value,
+          mc_ascii_protocol,
+          0 /* reqId */,
+          0 /* keyOffset */,
+          0 /* keySize */);
     }
   } else if (parser_.protocol() == mc_umbrella_protocol) {
     umbrellaOrCaretForwarder_ =
@@ -97,6 +107,7 @@ void ClientMcParser<Callback>::forwardUmbrellaReply(
       buffer.data() + info.headerSize,
       info.bodySize);
 
+  unpinSmallValue(reply);
   callback_.replyReady(std::move(reply), reqId);
 }
 
@@ -126,9 +137,35 @@ void ClientMcParser<Callback>::forwardCaretReply(
   reader.setInput(cur);
   reply.read(&reader);
 
+  if (captureWireBodies_ && headerInfo.usedCodecId == 0) {
+    /* Keep the body bytes so that a reply forwarded to a caret client
+       unchanged can reuse them (see TypedThriftReply::wireBody()). The
+       capture pins the read buffer for the life of the reply anyway, so
+       there is no point unpinning a small value out of it. */
+    auto wireBody = buffer.cloneOne();
+    wireBody->trimStart(headerInfo.headerSize);
+    wireBody->trimEnd(wireBody->length() - headerInfo.bodySize);
+    reply.setWireBody(std::move(wireBody));
+  } else {
+    unpinSmallValue(reply);
+  }
   callback_.replyReady(std::move(reply), reqId);
 }
 
+template <class Callback>
+template <class Reply>
+void ClientMcParser<Callback>::unpinSmallValue(Reply& reply) {
+  auto* value = reply.valuePtrUnsafe();
+  if (value == nullptr || value->empty() || !value->isShared() ||
+      value->isChained() || value->length() > kMaxPooledValueSize) {
+    return;
+  }
+  auto copy = allocateValueBuffer(value->length());
+  std::memcpy(copy.writableTail(), value->data(), value->length());
+  copy.append(value->length());
+  *value = std::move(copy);
+}
+
 template <class Callback>
 std::unique_ptr<folly::IOBuf> ClientMcParser<Callback>::decompress(
     const UmbrellaMessageInfo& headerInfo,
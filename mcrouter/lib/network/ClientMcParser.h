@@ -21,6 +21,7 @@
 #include "mcrouter/lib/network/McParser.h"
 #include "mcrouter/lib/network/ThriftMessageTraits.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
+#include "mcrouter/lib/network/ValueBufferPool.h"
 
 namespace facebook { namespace memcache {
 
@@ -31,8 +32,10 @@ class ClientMcParser : private McParser::ParserCallback {
                  size_t minBufferSize,
                  size_t maxBufferSize,
                  const bool useJemallocNodumpAllocator = false,
+                 const bool useHugePageBuffers = false,
                  const CompressionCodecMap* compressionCodecMap = nullptr,
-                 ConnectionFifo* debugFifo = nullptr);
+                 ConnectionFifo* debugFifo = nullptr,
+                 const bool captureWireBodies = false);
 
   /**
    * TAsyncTransport-style getReadBuffer().
@@ -78,6 +81,13 @@ class ClientMcParser : private McParser::ParserCallback {
 
   const CompressionCodecMap* compressionCodecMap_{nullptr};
 
+  /**
+   * If true, attach the body of each uncompressed caret reply frame to the
+   * parsed reply (TypedThriftReply::wireBody()), so a reply forwarded
+   * upstream unchanged can be re-framed without re-serialization.
+   */
+  const bool captureWireBodies_{false};
+
   template <class Request>
   void forwardAsciiReply();
 
@@ -95,6 +105,15 @@ class ClientMcParser : private McParser::ParserCallback {
       const UmbrellaMessageInfo& headerInfo,
       const folly::IOBuf& buffer);
 
+  /**
+   * If the parsed reply carries a small value that still shares the
+   * connection read buffer, copies it into a pooled slab so the value
+   * doesn't pin the whole read buffer for its lifetime. Values above
+   * kMaxPooledValueSize stay zero-copy.
+   */
+  template <class Reply>
+  void unpinSmallValue(Reply& reply);
+
   /* McParser callbacks */
   bool umMessageReady(const UmbrellaMessageInfo& info,
                       const folly::IOBuf& buffer) override final;
@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "CompressionFilter.h"
+
+#include <algorithm>
+
+#include <folly/SpookyHashV2.h>
+
+namespace facebook { namespace memcache {
+
+constexpr uint32_t CompressionFilter::kNoBucket;
+
+uint32_t CompressionFilter::bucketOf(folly::StringPiece key) noexcept {
+  auto prefix = key.subpiece(0, kPrefixLength);
+  return folly::hash::SpookyHashV2::Hash32(prefix.data(), prefix.size(), 0) %
+         kNumBuckets;
+}
+
+size_t CompressionFilter::sizeBucketOf(size_t uncompressedSize) noexcept {
+  size_t log = 0;
+  while ((uncompressedSize >> (log + 1)) != 0) {
+    ++log;
+  }
+  if (log <= kSizeBucketMinLog) {
+    return 0;
+  }
+  return std::min(log - kSizeBucketMinLog, kNumSizeBuckets - 1);
+}
+
+bool CompressionFilter::shouldCompress(
+    uint32_t bucket, size_t uncompressedSize) noexcept {
+  auto& sb = sizeBuckets_[sizeBucketOf(uncompressedSize)];
+  if (sb.attempts >= kMinAttempts &&
+      sb.uncompressedBytes > 0 &&
+      (sb.uncompressedBytes - sb.compressedBytes) * 100 <
+          sb.uncompressedBytes * kMinSavingsPercent) {
+    // Measured benefit for this value size is too small to pay for the
+    // compression attempt; probe occasionally so the curve stays fresh.
+    if (++sb.skips < kProbePeriod) {
+      ++sb.skipped;
+      return false;
+    }
+    sb.skips = 0;
+  }
+
+  if (bucket == kNoBucket) {
+    return true;
+  }
+  auto& b = buckets_[bucket];
+  if (b.attempts < kMinAttempts ||
+      b.wasted * 100 < b.attempts * kSkipPercent) {
+    return true;
+  }
+  // Probe occasionally so the bucket can recover if its values change.
+  if (++b.skips >= kProbePeriod) {
+    b.skips = 0;
+    return true;
+  }
+  return false;
+}
+
+void CompressionFilter::recordOutcome(
+    uint32_t bucket,
+    size_t uncompressedSize,
+    size_t sentSize,
+    bool compressed) noexcept {
+  auto& sb = sizeBuckets_[sizeBucketOf(uncompressedSize)];
+  ++sb.attempts;
+  if (!compressed) {
+    ++sb.wasted;
+  }
+  sb.uncompressedBytes += uncompressedSize;
+  sb.compressedBytes += sentSize;
+  if (sb.attempts >= kMaxHistory) {
+    // Age out old history so shifts in value compressibility show up.
+    sb.attempts /= 2;
+    sb.wasted /= 2;
+    sb.uncompressedBytes /= 2;
+    sb.compressedBytes /= 2;
+  }
+
+  if (bucket == kNoBucket) {
+    return;
+  }
+  auto& b = buckets_[bucket];
+  ++b.attempts;
+  if (!compressed) {
+    ++b.wasted;
+  }
+  if (b.attempts >= kMaxHistory) {
+    b.attempts /= 2;
+    b.wasted /= 2;
+  }
+}
+
+std::vector<CompressionFilter::SizeBucketStats>
+CompressionFilter::getSizeBucketStats() const {
+  std::vector<SizeBucketStats> stats(kNumSizeBuckets);
+  for (size_t i = 0; i < kNumSizeBuckets; ++i) {
+    const auto& sb = sizeBuckets_[i];
+    auto& out = stats[i];
+    out.minSize = i == 0 ? 0 : (1ull << (kSizeBucketMinLog + i));
+    out.attempts = sb.attempts;
+    out.wasted = sb.wasted;
+    out.skipped = sb.skipped;
+    out.uncompressedBytes = sb.uncompressedBytes;
+    out.compressedBytes = sb.compressedBytes;
+  }
+  return stats;
+}
+
+}} // facebook::memcache
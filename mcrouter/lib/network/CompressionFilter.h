@@ -0,0 +1,141 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Decides, per reply, whether attempting compression is worth the CPU,
+ * based on what compression achieved for similar replies in the past.
+ * Two independent signals are learned online:
+ *
+ *  - Key prefix: a key is mapped to one of kNumBuckets buckets by
+ *    hashing its first kPrefixLength bytes. Buckets whose values
+ *    historically did not compress (already-compressed images,
+ *    encrypted blobs) are skipped.
+ *
+ *  - Value size: replies are grouped into power-of-two size buckets and
+ *    the achieved benefit (bytes actually saved on the wire, including
+ *    wasted attempts) is accumulated per bucket. Size buckets whose
+ *    measured benefit falls below kMinSavingsPercent are skipped; this
+ *    replaces hand-tuning a single compression threshold that is never
+ *    right for every value mix.
+ *
+ * Both dimensions start out optimistic and require kMinAttempts of
+ * history before they veto anything. Skipped buckets are still probed
+ * every kProbePeriod-th request and history is halved once it reaches
+ * kMaxHistory, so buckets recover if their values change.
+ *
+ * Not thread-safe. Each McServerSession owns its own filter and is bound
+ * to a single event base thread.
+ */
+class CompressionFilter {
+ public:
+  /**
+   * Bucket id meaning "no key was associated with the request".
+   * The key-prefix signal is not consulted or updated for it.
+   */
+  static constexpr uint32_t kNoBucket = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * Counters of one value-size bucket, for stats export. The counters
+   * used for decisions decay over time (see kMaxHistory); skipped is a
+   * lifetime total.
+   */
+  struct SizeBucketStats {
+    size_t minSize{0};
+    uint64_t attempts{0};
+    uint64_t wasted{0};
+    uint64_t skipped{0};
+    uint64_t uncompressedBytes{0};
+    uint64_t compressedBytes{0};
+  };
+
+  /**
+   * Maps a key to its bucket id by hashing the key prefix.
+   */
+  static uint32_t bucketOf(folly::StringPiece key) noexcept;
+
+  /**
+   * @param bucket            Key-prefix bucket of the request key.
+   * @param uncompressedSize  Size of the serialized reply body.
+   * @return true if compression should be attempted. Advances the probe
+   *         counters of skipped buckets, so the result may change
+   *         between calls with the same arguments.
+   */
+  bool shouldCompress(uint32_t bucket, size_t uncompressedSize) noexcept;
+
+  /**
+   * Records the outcome of a compression attempt.
+   *
+   * @param bucket            Key-prefix bucket of the request key.
+   * @param uncompressedSize  Size of the reply body before compression.
+   * @param sentSize          Size actually sent on the wire: the
+   *                          compressed size (plus framing overhead) if
+   *                          the attempt paid off, the uncompressed size
+   *                          otherwise.
+   * @param compressed        True if the compressed value was small
+   *                          enough to be worth sending.
+   */
+  void recordOutcome(
+      uint32_t bucket,
+      size_t uncompressedSize,
+      size_t sentSize,
+      bool compressed) noexcept;
+
+  /**
+   * Returns a snapshot of the per-size-bucket benefit curve, ordered by
+   * bucket lower bound. Buckets with no history are included so curves
+   * from different sessions can be merged index-by-index.
+   */
+  std::vector<SizeBucketStats> getSizeBucketStats() const;
+
+ private:
+  static constexpr size_t kNumBuckets = 64;
+  static constexpr size_t kPrefixLength = 16;
+  // Size buckets cover [2^kSizeBucketMinLog, 2^(kSizeBucketMinLog +
+  // kNumSizeBuckets - 1)); smaller and larger values fall into the first
+  // and last bucket, respectively.
+  static constexpr size_t kNumSizeBuckets = 16;
+  static constexpr size_t kSizeBucketMinLog = 6;
+  static constexpr uint32_t kMinAttempts = 32;
+  static constexpr uint32_t kSkipPercent = 90;
+  static constexpr uint32_t kMinSavingsPercent = 5;
+  static constexpr uint32_t kMaxHistory = 256;
+  static constexpr uint32_t kProbePeriod = 64;
+
+  struct Bucket {
+    uint16_t attempts{0};
+    uint16_t wasted{0};
+    uint16_t skips{0};
+  };
+  struct SizeBucket {
+    uint32_t attempts{0};
+    uint32_t wasted{0};
+    uint32_t skips{0};
+    uint64_t skipped{0};
+    uint64_t uncompressedBytes{0};
+    uint64_t compressedBytes{0};
+  };
+
+  std::array<Bucket, kNumBuckets> buckets_;
+  std::array<SizeBucket, kNumSizeBuckets> sizeBuckets_;
+
+  static size_t sizeBucketOf(size_t uncompressedSize) noexcept;
+};
+
+}} // facebook::memcache
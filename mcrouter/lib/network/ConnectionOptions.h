@@ -11,6 +11,7 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 
 #include <folly/io/async/AsyncSocket.h>
 
@@ -54,6 +55,13 @@ struct ConnectionOptions {
    */
   std::shared_ptr<const AccessPoint> accessPoint;
 
+  /**
+   * Send get-like requests that fit a single datagram over UDP with the
+   * classic memcached UDP frame header, falling back to TCP on
+   * truncation, loss or any error. Ascii protocol only.
+   */
+  bool enableUdpForGets{false};
+
   /**
    * Number of TCP KeepAlive probes to send before considering connection dead.
    *
@@ -77,6 +85,22 @@ struct ConnectionOptions {
    */
   std::chrono::milliseconds writeTimeout{0};
 
+  /**
+   * If nonzero, pending requests may be held back by up to this long so
+   * that several of them coalesce into one large write (application-level
+   * Nagle).  A write is issued earlier once flushDelayMaxBytes of
+   * serialized data is pending.  Meant for high-RTT (e.g. cross-region)
+   * destinations, where the added latency is noise but the reduction in
+   * packet rate is not.
+   */
+  std::chrono::microseconds flushDelay{0};
+
+  /**
+   * Once this many bytes of serialized request data are pending, a
+   * delayed write (see flushDelay) is issued immediately.
+   */
+  size_t flushDelayMaxBytes{64 * 1024};
+
   /**
    * Informs whether QoS is enabled.
    */
@@ -92,6 +116,15 @@ struct ConnectionOptions {
    */
   unsigned int qosPath{0};
 
+  /**
+   * If true, enable TCP Fast Open on the socket and optimistically write
+   * pending out-of-order protocol requests while the connection is still
+   * being established, so the first request after a reconnect rides along
+   * with the handshake instead of paying an extra round trip.
+   * Ignored for SSL and noNetwork connections.
+   */
+  bool enableTfo{false};
+
   /**
    * SSLContext provider callback. If null, then unsecured connections will be
    * established, else it will be called for each attempt to establish
@@ -106,6 +139,13 @@ struct ConnectionOptions {
    */
   std::string debugFifoPath;
 
+  /**
+   * If nonzero, the debug fifo is backed by a shared-memory ring of
+   * this many bytes per thread (drop-on-full, see RingFifo) instead of
+   * a named pipe.
+   */
+  size_t debugFifoRingBytes{0};
+
 
   /**
    * enable ssl session caching
@@ -117,11 +157,29 @@ struct ConnectionOptions {
    */
   bool useJemallocNodumpAllocator{false};
 
+  /**
+   * Use JemallocHugePageAllocator for large read buffers
+   */
+  bool useHugePageBuffers{false};
+
+  /**
+   * Capture the body bytes of uncompressed caret reply frames, so replies
+   * forwarded to caret clients unchanged are re-framed instead of
+   * re-serialized. See TypedThriftReply::wireBody().
+   */
+  bool replyPassthrough{false};
+
   /**
    * Map of codecs to use for compression.
    * If nullptr, compression will be disabled.
    */
   const CompressionCodecMap* compressionCodecMap{nullptr};
+
+  /**
+   * Name of the pool the destination belongs to. If the codec map has a
+   * dictionary range for this pool, only that range is advertised.
+   */
+  std::string compressionPoolTag;
 };
 
 }} // facebook::memcache
@@ -12,8 +12,9 @@
 namespace facebook {
 namespace memcache {
 
-ConnectionTracker::ConnectionTracker(size_t maxConns)
-  : maxConns_(maxConns) {
+ConnectionTracker::ConnectionTracker(size_t maxConns, size_t maxConnsPerPeer)
+  : maxConns_(maxConns),
+    maxConnsPerPeer_(maxConnsPerPeer) {
 }
 
 void ConnectionTracker::add(
@@ -35,6 +36,9 @@ void ConnectionTracker::add(
       compressionCodecMap);
 
   sessions_.push_front(session);
+  if (maxConnsPerPeer_ != 0) {
+    trackPeer(session);
+  }
 }
 
 void ConnectionTracker::closeAll() {
@@ -57,6 +61,27 @@ bool ConnectionTracker::writesPending() const {
   return false;
 }
 
+std::vector<CompressionFilter::SizeBucketStats>
+ConnectionTracker::getCompressionStats() const {
+  std::vector<CompressionFilter::SizeBucketStats> total;
+  for (const auto& session : sessions_) {
+    auto stats = session.getCompressionStats();
+    if (total.empty()) {
+      total = std::move(stats);
+      continue;
+    }
+    assert(total.size() == stats.size());
+    for (size_t i = 0; i < total.size(); ++i) {
+      total[i].attempts += stats[i].attempts;
+      total[i].wasted += stats[i].wasted;
+      total[i].skipped += stats[i].skipped;
+      total[i].uncompressedBytes += stats[i].uncompressedBytes;
+      total[i].compressedBytes += stats[i].compressedBytes;
+    }
+  }
+  return total;
+}
+
 void ConnectionTracker::touch(McServerSession& session) {
   static uint64_t numCalls = 0;
   // Find the connection and bring it to the front of the LRU.
@@ -66,9 +91,21 @@ void ConnectionTracker::touch(McServerSession& session) {
   }
   sessions_.erase(sessions_.iterator_to(session));
   sessions_.push_front(session);
+  if (maxConnsPerPeer_ != 0) {
+    touchPeer(session);
+  }
 }
 
 void ConnectionTracker::evict() {
+  // Prefer the least recently active connection of a peer that is over
+  // its quota, so a storm from one client IP can't push out everyone
+  // else's connections.
+  if (!overQuotaPeers_.empty()) {
+    auto& peer = *overQuotaPeers_.front();
+    assert(!peer.sessions.empty());
+    peer.sessions.back()->close();
+    return;
+  }
   if (sessions_.empty()) {
     return;
   }
@@ -76,6 +113,62 @@ void ConnectionTracker::evict() {
   session.close();
 }
 
+void ConnectionTracker::trackPeer(McServerSession& session) {
+  const auto& address = session.getSocketAddress();
+  if (address.getFamily() != AF_INET && address.getFamily() != AF_INET6) {
+    // No peer IP to account against (e.g. unix domain sockets).
+    return;
+  }
+
+  auto peerIt = peers_.emplace(address.getIPAddress(), Peer()).first;
+  auto& peer = peerIt->second;
+  ++peer.count;
+  peer.sessions.push_front(&session);
+  sessionPeers_[&session] = PeerEntry{peerIt, peer.sessions.begin()};
+
+  if (peer.count > maxConnsPerPeer_) {
+    if (!peer.overQuota) {
+      peer.overQuota = true;
+      overQuotaPeers_.push_front(&peer);
+      peer.overQuotaIt = overQuotaPeers_.begin();
+    }
+    // The peer pays for its own storm: close its least recently active
+    // connection (never the one just added; count > cap implies at
+    // least two).
+    peer.sessions.back()->close();
+  }
+}
+
+void ConnectionTracker::untrackPeer(McServerSession& session) {
+  auto it = sessionPeers_.find(&session);
+  if (it == sessionPeers_.end()) {
+    return;
+  }
+  auto peerIt = it->second.peerIt;
+  auto& peer = peerIt->second;
+  peer.sessions.erase(it->second.sessionIt);
+  --peer.count;
+  if (peer.overQuota && peer.count <= maxConnsPerPeer_) {
+    overQuotaPeers_.erase(peer.overQuotaIt);
+    peer.overQuota = false;
+  }
+  sessionPeers_.erase(it);
+  if (peer.count == 0) {
+    peers_.erase(peerIt);
+  }
+}
+
+void ConnectionTracker::touchPeer(McServerSession& session) {
+  auto it = sessionPeers_.find(&session);
+  if (it == sessionPeers_.end()) {
+    return;
+  }
+  auto& peer = it->second.peerIt->second;
+  peer.sessions.erase(it->second.sessionIt);
+  peer.sessions.push_front(&session);
+  it->second.sessionIt = peer.sessions.begin();
+}
+
 void ConnectionTracker::onWriteQuiescence(McServerSession& session) {
   touch(session);
   if (onWriteQuiescence_) {
@@ -96,6 +189,7 @@ void ConnectionTracker::onCloseFinish(McServerSession& session) {
   if (session.isLinked()) {
     sessions_.erase(sessions_.iterator_to(session));
   }
+  untrackPeer(session);
 }
 
 void ConnectionTracker::onShutdown() {
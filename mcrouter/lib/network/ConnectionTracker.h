@@ -10,7 +10,11 @@
 #pragma once
 
 #include <functional>
+#include <list>
 #include <memory>
+#include <unordered_map>
+
+#include <folly/IPAddress.h>
 
 #include "mcrouter/lib/network/McServerSession.h"
 
@@ -25,8 +29,14 @@ class ConnectionTracker : public McServerSession::StateCallback {
    * Creates a new tracker with `maxConns` connections. Once there are
    * more than `maxConns` connections (sessions), ConnectionTracker will close
    * the oldest one. If `maxConns` is 0, it will not close connections.
+   *
+   * If `maxConnsPerPeer` is nonzero, connections are also accounted per
+   * client IP: an IP exceeding the cap has its own least recently active
+   * connection closed, and under `maxConns` pressure over-quota IPs are
+   * evicted before anyone else. This keeps a connection storm from a
+   * single client from pushing out well-behaved ones.
    */
-  explicit ConnectionTracker(size_t maxConns = 0);
+  explicit ConnectionTracker(size_t maxConns = 0, size_t maxConnsPerPeer = 0);
 
   // See AsyncMcServerWorker.h for details about the callbacks
   void setOnWriteQuiescence(std::function<void(McServerSession&)> cb) {
@@ -65,18 +75,54 @@ class ConnectionTracker : public McServerSession::StateCallback {
    * Check if we have pending writes on any connection (session)
    */
   bool writesPending() const;
+
+  /**
+   * Compression benefit curve aggregated over all tracked sessions,
+   * bucketed by reply size. See CompressionFilter.
+   */
+  std::vector<CompressionFilter::SizeBucketStats> getCompressionStats() const;
  private:
+  /**
+   * Accounting for one client IP. Sessions are kept most recently
+   * active first, so the eviction victim is always the back. Stored by
+   * value in peers_; unordered_map never moves its elements, so Peer
+   * pointers stay valid.
+   */
+  struct Peer {
+    size_t count{0};
+    std::list<McServerSession*> sessions;
+    bool overQuota{false};
+    std::list<Peer*>::iterator overQuotaIt;
+  };
+  using PeerMap = std::unordered_map<folly::IPAddress, Peer>;
+
+  struct PeerEntry {
+    PeerMap::iterator peerIt;
+    std::list<McServerSession*>::iterator sessionIt;
+  };
+
   McServerSession::Queue sessions_;
   std::function<void(McServerSession&)> onWriteQuiescence_;
   std::function<void(McServerSession&)> onCloseStart_;
   std::function<void(McServerSession&)> onCloseFinish_;
   std::function<void()> onShutdown_;
   size_t maxConns_{0};
+  size_t maxConnsPerPeer_{0};
+
+  PeerMap peers_;
+  // Peers currently above maxConnsPerPeer_; pressure eviction takes its
+  // victims from here first. All operations on it are O(1).
+  std::list<Peer*> overQuotaPeers_;
+  std::unordered_map<McServerSession*, PeerEntry> sessionPeers_;
 
   void touch(McServerSession& session);
 
   void evict();
 
+  void trackPeer(McServerSession& session);
+  void untrackPeer(McServerSession& session);
+  void touchPeer(McServerSession& session);
+
   // McServerSession::StateCallback API
   void onWriteQuiescence(McServerSession& session) override final;
   void onCloseStart(McServerSession& session) override final;
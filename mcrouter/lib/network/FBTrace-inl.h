@@ -9,6 +9,7 @@
  */
 #ifndef LIBMC_FBTRACE_DISABLE
 #include <folly/fibers/FiberManager.h>
+#include <folly/Likely.h>
 
 #include "fbtrace/libfbtrace/c/fbtrace.h"
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
@@ -48,16 +49,13 @@ inline void fbtraceAddItem(fbtrace_item_t* info, size_t& idx,
 
 } // anonymous
 
+/* Out of line so the heavy tracing body stays off the untraced fast path. */
 template <class Request>
-bool fbTraceOnSend(const Request& request, const AccessPoint& ap) {
+FOLLY_NOINLINE bool fbTraceOnSendImpl(const Request& request,
+                                      const AccessPoint& ap,
+                                      mc_fbtrace_info_s* fbtraceInfo) {
   constexpr mc_op_t McOp = Request::OpType::mc_op;
 
-  mc_fbtrace_info_s* fbtraceInfo = request.fbtraceInfo();
-
-  if (fbtraceInfo == nullptr) {
-    return false;
-  }
-
   assert(fbtraceInfo->fbtrace);
 
   fbtrace_item_t info[4];
@@ -99,9 +97,26 @@ bool fbTraceOnSend(const Request& request, const AccessPoint& ap) {
     });
 }
 
+template <class Request>
+bool fbTraceOnSend(const Request& request, const AccessPoint& ap) {
+  mc_fbtrace_info_s* fbtraceInfo = request.fbtraceInfo();
+
+  // The untraced path is one predicted branch; the global flag is only
+  // consulted for requests that actually carry trace state.
+  if (LIKELY(fbtraceInfo == nullptr) || !fbTraceEnabled()) {
+    return false;
+  }
+
+  if (!fbTraceConsumeBudget()) {
+    return false;
+  }
+
+  return fbTraceOnSendImpl(request, ap, fbtraceInfo);
+}
+
 inline void fbTraceOnReceive(const mc_fbtrace_info_s* fbtraceInfo,
                              const mc_res_t result) {
-  if (fbtraceInfo == nullptr) {
+  if (LIKELY(fbtraceInfo == nullptr) || !fbTraceEnabled()) {
     return;
   }
 
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "FBTrace.h"
+
+#include <atomic>
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+std::atomic<bool> gFbTraceEnabled{true};
+std::atomic<bool (*)()> gFbTraceBudgetHook{nullptr};
+
+} // anonymous
+
+bool fbTraceEnabled() noexcept {
+  return gFbTraceEnabled.load(std::memory_order_relaxed);
+}
+
+void setFbTraceEnabled(bool enabled) noexcept {
+  gFbTraceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setFbTraceBudgetHook(bool (*hook)()) noexcept {
+  gFbTraceBudgetHook.store(hook, std::memory_order_relaxed);
+}
+
+bool fbTraceConsumeBudget() noexcept {
+  auto hook = gFbTraceBudgetHook.load(std::memory_order_relaxed);
+  return hook == nullptr || hook();
+}
+
+}}  // facebook::memcache
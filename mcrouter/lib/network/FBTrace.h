@@ -31,6 +31,32 @@ class RequestHasFbTraceInfo {
   static constexpr bool value = sizeof(check<Request>(0)) == sizeof(char);
 };
 
+/**
+ * Process-wide fbtrace controls. Meant to be set once during startup,
+ * before traffic; request-path reads are single relaxed atomic loads.
+ */
+
+/**
+ * @return whether fbtrace is globally enabled (the default). When turned
+ *         off, fbTraceOnSend reduces to one predicted branch.
+ */
+bool fbTraceEnabled() noexcept;
+
+void setFbTraceEnabled(bool enabled) noexcept;
+
+/**
+ * Installs a budget check consulted once per traced request, never on the
+ * untraced path. The hook returns false to forward the request untraced
+ * (e.g. a token bucket ran dry); nullptr removes any budget.
+ */
+void setFbTraceBudgetHook(bool (*hook)()) noexcept;
+
+/**
+ * @return true if the request may be traced (no budget hook installed,
+ *         or the hook granted a token).
+ */
+bool fbTraceConsumeBudget() noexcept;
+
 template <class Request>
 bool fbTraceOnSend(const Request& request, const AccessPoint& ap);
 
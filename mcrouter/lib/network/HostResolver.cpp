@@ -0,0 +1,202 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "HostResolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+#include <folly/Conv.h>
+#include <glog/logging.h>
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+/* Cached addresses older than this are re-resolved before use. */
+constexpr std::chrono::seconds kCacheTtl{60};
+
+/* Upper bound on concurrent getaddrinfo calls during a prefetch. */
+constexpr size_t kMaxParallelResolutions = 8;
+
+std::string cacheKey(const std::string& host, uint16_t port) {
+  return folly::to<std::string>(host, ':', port);
+}
+
+/**
+ * Numeric fast path: converts an IP literal without any lookup.
+ * Returns none for hostnames.
+ */
+folly::Optional<folly::SocketAddress> tryNumeric(const std::string& host,
+                                                 uint16_t port) {
+  try {
+    return folly::SocketAddress(host, port, /* allowNameLookup */ false);
+  } catch (const std::exception&) {
+    return folly::none;
+  }
+}
+
+}  // anonymous namespace
+
+HostResolver& HostResolver::instance() {
+  /* Intentionally leaked: detached refresh and prefetch workers may
+     outlive main() (laggards are allowed to finish past the prefetch
+     deadline), so the cache and its mutex must never be destroyed. */
+  static HostResolver* resolver = new HostResolver();
+  return *resolver;
+}
+
+folly::SocketAddress HostResolver::resolve(const std::string& host,
+                                           uint16_t port) {
+  if (auto numeric = tryNumeric(host, port)) {
+    return *numeric;
+  }
+
+  const auto key = cacheKey(host, port);
+  if (auto cached = getCached(key, /* allowStale */ false)) {
+    return *cached;
+  }
+
+  try {
+    folly::SocketAddress address(host, port, /* allowNameLookup */ true);
+    store(key, address);
+    return address;
+  } catch (const std::system_error&) {
+    auto stale = getCached(key, /* allowStale */ true);
+    if (!stale) {
+      throw;
+    }
+    LOG(WARNING) << "DNS lookup for " << host << " failed, using"
+                 << " previously known address " << stale->describe();
+    bool shouldRefresh = false;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = cache_.find(key);
+      if (it != cache_.end() && !it->second.refreshing) {
+        it->second.refreshing = true;
+        shouldRefresh = true;
+      }
+    }
+    if (shouldRefresh) {
+      std::thread([this, host, port]() { refreshNow(host, port); }).detach();
+    }
+    return *stale;
+  }
+}
+
+void HostResolver::scheduleResolution(const std::string& host,
+                                      uint16_t port) {
+  if (tryNumeric(host, port)) {
+    return;
+  }
+  const auto key = cacheKey(host, port);
+  if (getCached(key, /* allowStale */ false)) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  pending_.emplace_back(host, port);
+}
+
+void HostResolver::resolvePending(std::chrono::milliseconds deadline) {
+  std::vector<std::pair<std::string, uint16_t>> endpoints;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    endpoints.swap(pending_);
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  endpoints.erase(std::unique(endpoints.begin(), endpoints.end()),
+                  endpoints.end());
+  if (endpoints.empty()) {
+    return;
+  }
+
+  /* Shared with the worker threads, which may outlive this call:
+     laggards finish after the deadline and just update the cache. */
+  struct Batch {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t activeWorkers{0};
+    std::atomic<size_t> nextIndex{0};
+    std::vector<std::pair<std::string, uint16_t>> endpoints;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->endpoints = std::move(endpoints);
+
+  const size_t numWorkers =
+      std::min(batch->endpoints.size(), kMaxParallelResolutions);
+  batch->activeWorkers = numWorkers;
+  for (size_t i = 0; i < numWorkers; ++i) {
+    std::thread([this, batch]() {
+      for (;;) {
+        const auto idx = batch->nextIndex.fetch_add(1);
+        if (idx >= batch->endpoints.size()) {
+          break;
+        }
+        refreshNow(batch->endpoints[idx].first, batch->endpoints[idx].second);
+      }
+      {
+        std::lock_guard<std::mutex> guard(batch->mutex);
+        --batch->activeWorkers;
+      }
+      batch->cv.notify_all();
+    }).detach();
+  }
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  if (!batch->cv.wait_for(lock, deadline,
+                          [&]() { return batch->activeWorkers == 0; })) {
+    VLOG(1) << "DNS prefetch deadline passed with "
+            << batch->activeWorkers << " resolver(s) still running;"
+            << " continuing with previously known addresses";
+  }
+}
+
+folly::Optional<folly::SocketAddress> HostResolver::getCached(
+    const std::string& key, bool allowStale) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = cache_.find(key);
+  if (it == cache_.end()) {
+    return folly::none;
+  }
+  if (!allowStale &&
+      std::chrono::steady_clock::now() - it->second.resolvedAt > kCacheTtl) {
+    return folly::none;
+  }
+  return it->second.address;
+}
+
+void HostResolver::store(const std::string& key,
+                         const folly::SocketAddress& address) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto& entry = cache_[key];
+  entry.address = address;
+  entry.resolvedAt = std::chrono::steady_clock::now();
+}
+
+void HostResolver::refreshNow(const std::string& host,
+                              uint16_t port) noexcept {
+  const auto key = cacheKey(host, port);
+  try {
+    folly::SocketAddress address(host, port, /* allowNameLookup */ true);
+    store(key, address);
+  } catch (const std::exception& e) {
+    VLOG(1) << "Background DNS refresh for " << host << " failed: "
+            << e.what();
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    it->second.refreshing = false;
+  }
+}
+
+}}  // facebook::memcache
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Process-wide DNS cache with a parallel prefetch stage.
+ *
+ * Hostname lookups otherwise happen inline on the proxy event loop when a
+ * connection is attempted, so a single dead DNS server can stall a proxy
+ * thread for the full resolver timeout on every reconnect. This class
+ * keeps the last known address per host:port and lets reconfiguration
+ * resolve all newly configured hostnames on parallel background threads
+ * with a bounded deadline; connect-time lookups hit the cache, and fall
+ * back to the previously-known address if a fresh lookup fails.
+ *
+ * Numeric hosts (the common case in generated configs) are converted
+ * inline and never enter the cache.
+ */
+class HostResolver {
+ public:
+  static HostResolver& instance();
+
+  /**
+   * Address for host:port. Numeric hosts are converted without a lookup.
+   * For hostnames, a fresh cache entry is returned directly; otherwise a
+   * blocking getaddrinfo runs and its result is cached. If the lookup
+   * fails but a previously-known address exists, the stale address is
+   * returned and a single background refresh is kicked off, so a dead
+   * DNS server never takes down a destination that resolved before.
+   *
+   * @throws std::system_error  if the host can't be resolved and no
+   *                            previously-known address exists.
+   */
+  folly::SocketAddress resolve(const std::string& host, uint16_t port);
+
+  /**
+   * Queue host:port for the next resolvePending() call. Numeric hosts
+   * and endpoints with a fresh cache entry are ignored.
+   */
+  void scheduleResolution(const std::string& host, uint16_t port);
+
+  /**
+   * Resolve everything queued by scheduleResolution() on parallel
+   * background threads, waiting at most deadline. Laggards keep
+   * resolving past the deadline and update the cache when they finish;
+   * until then connections use previously-known addresses or resolve
+   * inline as before.
+   */
+  void resolvePending(std::chrono::milliseconds deadline);
+
+ private:
+  struct CacheEntry {
+    folly::SocketAddress address;
+    std::chrono::steady_clock::time_point resolvedAt;
+    /* True while a background refresh for this entry is in flight,
+       so repeated failing connects don't pile up refresher threads. */
+    bool refreshing{false};
+  };
+
+  HostResolver() = default;
+
+  folly::Optional<folly::SocketAddress> getCached(const std::string& key,
+                                                  bool allowStale);
+  void store(const std::string& key, const folly::SocketAddress& address);
+
+  /**
+   * Unconditional blocking lookup; updates the cache on success and
+   * swallows (logs) failures. Clears the entry's refreshing flag.
+   */
+  void refreshNow(const std::string& host, uint16_t port) noexcept;
+
+  std::mutex mutex_;
+  /// Keyed by "host:port"
+  std::unordered_map<std::string, CacheEntry> cache_;
+  std::vector<std::pair<std::string, uint16_t>> pending_;
+};
+
+}}  // facebook::memcache
@@ -12,6 +12,7 @@
 #include <folly/String.h>
 
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
+#include "mcrouter/lib/IOBufUtil.h"
 
 namespace facebook { namespace memcache {
 
@@ -79,6 +80,15 @@ bool McAsciiParserBase::readValue(folly::IOBuf& buffer, folly::IOBuf& to) {
     // Copy IOBuf for part of (or whole) value.
     size_t offset = p_ - reinterpret_cast<const char*>(buffer.data()) + 1;
     size_t toUse = std::min(buffer.length() - offset, remainingIOBufLength_);
+    if (toUse == remainingIOBufLength_) {
+      // The entire value is in the buffer; small values are copied out
+      // instead of cloned so they don't pin the read buffer
+      // (see copyOrCloneInto()).
+      copyOrCloneInto(to, buffer, buffer.data() + offset, toUse);
+      remainingIOBufLength_ = 0;
+      p_ += toUse;
+      return true;
+    }
     buffer.cloneOneInto(to);
     // Adjust buffer pointers.
     to.trimStart(offset);
@@ -7,6 +7,8 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include "mcrouter/lib/network/AsciiInt.h"
+#include "mcrouter/lib/network/AsciiScan.h"
 #include "mcrouter/lib/network/McAsciiParser.h"
 
 #include "mcrouter/lib/mc/msg.h"
@@ -91,6 +93,11 @@ skip_key = (any+ -- (cntrl | space));
 action key_start {
   currentKey_.clear();
   keyPieceStart_ = p_;
+  // The key machines self-loop over every plain token byte, so bulk-skip to
+  // the next candidate delimiter with a vectorized scan and let the state
+  // machine handle only the boundary byte. Every byte skipped here is a
+  // valid interior byte for both 'key' and 'multi_token'.
+  p_ = asciiScanDelimiter(p_ + 1, pe_) - 1;
 }
 
 action key_end {
@@ -115,8 +122,18 @@ multi_token = (print+ -- ( '\r' | '\n' )) >key_start %key_end %{
   message.setKey(std::move(currentKey_));
 };
 
+action uint_start {
+  // Same trick as key_start: every byte in [p_, digitsEnd) is a digit, so
+  // fold all but the last one with the SWAR decoder and let the
+  // per-character action handle the boundary byte. A run that continues
+  // into the next read buffer keeps accumulating through that action.
+  const char* digitsEnd = asciiScanDigits(p_ + 1, pe_);
+  currentUInt_ = asciiDecodeUint64(p_, digitsEnd - 1);
+  p_ = digitsEnd - 1;
+}
+
 # Unsigned integer value.
-uint = digit+ > { currentUInt_ = 0; } ${
+uint = digit+ > uint_start ${
   currentUInt_ = currentUInt_ * 10 + (fc - '0');
 };
 
@@ -93,7 +93,7 @@ McClientRequestContext<Request>::waitForReply(
     std::chrono::milliseconds timeout) {
 
   batonWaitTimeout_ = timeout;
-  baton_.wait(batonTimeoutHandler_);
+  baton_.wait();
 
   switch (state()) {
     case ReqState::REPLIED_QUEUE:
@@ -116,9 +116,10 @@ McClientRequestContext<Request>::waitForReply(
       }
       return Reply(mc_res_timeout);
     case ReqState::PENDING_QUEUE:
-      // Request wasn't sent to the network yet, reply with timeout.
+      // Request wasn't sent to the network yet: either the baton wait
+      // timed out or the request was aborted.
       queue_.removePending(*this);
-      return Reply(mc_res_timeout);
+      return Reply(aborted_ ? mc_res_aborted : mc_res_timeout);
     case ReqState::PENDING_REPLY_QUEUE:
       // Request was sent to the network, but wasn't replied yet,
       // reply with timeout.
@@ -175,12 +176,10 @@ void McClientRequestContextQueue::reply(uint64_t id, Reply&& r) {
   // Get the context and erase it from the queue and map.
   McClientRequestContextBase* ctx{nullptr};
   if (outOfOrder_) {
-    auto iter = getContextById(id);
-    if (iter != set_.end()) {
-      ctx = &(*iter);
-      assert(iter->state() == State::PENDING_REPLY_QUEUE);
-      pendingReplyQueue_.erase(pendingReplyQueue_.iterator_to(*iter));
-      set_.erase(iter);
+    if ((ctx = getContextById(id)) != nullptr) {
+      assert(ctx->state() == State::PENDING_REPLY_QUEUE);
+      pendingReplyQueue_.erase(pendingReplyQueue_.iterator_to(*ctx));
+      removeFromTable(*ctx);
     }
   } else {
     // First we're going to receive replies for timed out requests.
@@ -204,6 +203,7 @@ void McClientRequestContextQueue::reply(uint64_t id, Reply&& r) {
     ctx->reply(std::move(r));
     if (ctx->state() == State::PENDING_REPLY_QUEUE) {
       ctx->setState(State::COMPLETE);
+      ctx->cancelTimeout();
       ctx->baton_.post();
     } else {
       // Move the request to the replied queue.
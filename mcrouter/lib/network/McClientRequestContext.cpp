@@ -17,11 +17,13 @@ void McClientRequestContextBase::replyError(mc_res_t result) {
   assert(state() == ReqState::NONE);
   replyErrorImpl(result);
   setState(ReqState::COMPLETE);
+  cancelTimeout();
   baton_.post();
 }
 
 void McClientRequestContextBase::canceled() {
   setState(ReqState::NONE);
+  cancelTimeout();
   baton_.post();
 }
 
@@ -66,8 +68,29 @@ void McClientRequestContextBase::fireStateChangeCallbacks(
   }
 }
 
-void McClientRequestContextBase::scheduleTimeout() {
-  batonTimeoutHandler_.scheduleTimeout(batonWaitTimeout_);
+void McClientRequestContextBase::scheduleTimeout(folly::HHWheelTimer& timer) {
+  // markNextAsSent() may also return requests that were already replied or
+  // canceled, only requests that are waiting for a reply need a timeout.
+  if (state() == ReqState::PENDING_REPLY_QUEUE) {
+    timer.scheduleTimeout(this, batonWaitTimeout_);
+  }
+}
+
+void McClientRequestContextBase::abortRequest() {
+  /* Only a request that is still waiting to be written can be aborted
+     safely: no timeout is armed and no reply can arrive for it, so
+     nothing else may post the baton. */
+  if (state() != ReqState::PENDING_QUEUE) {
+    return;
+  }
+  aborted_ = true;
+  baton_.post();
+}
+
+void McClientRequestContextBase::timeoutExpired() noexcept {
+  // Wake up the owning fiber with the state unchanged, waitForReply() will
+  // treat such a wakeup as a timeout.
+  baton_.post();
 }
 
 McClientRequestContextBase::~McClientRequestContextBase() {
@@ -77,19 +100,23 @@ McClientRequestContextBase::~McClientRequestContextBase() {
 McClientRequestContextQueue::McClientRequestContextQueue(
   bool outOfOrder) noexcept
   : outOfOrder_(outOfOrder),
-    buckets_(kDefaultNumBuckets),
-    set_(McClientRequestContextBase::UnorderedSet::bucket_traits(
-      buckets_.data(), buckets_.size())) {
+    table_(kInitialTableSize, nullptr) {
 }
 
-void McClientRequestContextQueue::growBucketsArray() {
-  // Allocate buckets array that is twice bigger than the current one.
-  std::vector<McClientRequestContextBase::UnorderedSet::bucket_type>
-  tmp(buckets_.size() * 2);
-  set_.rehash(McClientRequestContextBase::UnorderedSet::bucket_traits(
-    tmp.data(), tmp.size()));
-  // Use swap here, since it has better defined behaviour regarding iterators.
-  buckets_.swap(tmp);
+void McClientRequestContextQueue::growTable() {
+  // Allocate a table that is twice bigger and reinsert all entries.
+  std::vector<McClientRequestContextBase*> old(table_.size() * 2, nullptr);
+  old.swap(table_);
+  const size_t mask = table_.size() - 1;
+  for (auto* ctx : old) {
+    if (ctx != nullptr) {
+      size_t i = ctx->id & mask;
+      while (table_[i] != nullptr) {
+        i = (i + 1) & mask;
+      }
+      table_[i] = ctx;
+    }
+  }
 }
 
 size_t McClientRequestContextQueue::getPendingRequestCount() const noexcept {
@@ -130,11 +157,7 @@ void McClientRequestContextQueue::markAsPending(
   pendingQueue_.push_back(req);
 
   if (outOfOrder_) {
-    // We hit the number of allocated buckets, grow the array.
-    if (set_.size() >= buckets_.size()) {
-      growBucketsArray();
-    }
-    set_.insert(req);
+    insertIntoTable(req);
   }
 }
 
@@ -159,7 +182,7 @@ McClientRequestContextBase& McClientRequestContextQueue::markNextAsSent() {
   auto& req = writeQueue_.front();
   writeQueue_.pop_front();
   if (req.state() == State::WRITE_QUEUE_CANCELED) {
-    removeFromSet(req);
+    removeFromTable(req);
     // We already sent this request, so we're going to get a reply in future.
     if (!outOfOrder_) {
       timedOutInitializers_.push(req.initializer_);
@@ -178,34 +201,68 @@ void McClientRequestContextQueue::failQueue(
   while (!queue.empty()) {
     auto& req = queue.front();
     queue.pop_front();
-    removeFromSet(req);
+    removeFromTable(req);
     req.setState(State::NONE);
     req.replyError(error);
   }
 }
 
-McClientRequestContextBase::UnorderedSet::iterator
+McClientRequestContextBase*
 McClientRequestContextQueue::getContextById(uint64_t id) {
-  return
-    set_.find(
-      id,
-      std::hash<uint64_t>(),
-      [] (uint64_t id, const McClientRequestContextBase& ctx) {
-        return id == ctx.id;
-      });
+  const size_t mask = table_.size() - 1;
+  for (size_t i = id & mask; table_[i] != nullptr; i = (i + 1) & mask) {
+    if (table_[i]->id == id) {
+      return table_[i];
+    }
+  }
+  return nullptr;
 }
 
-void McClientRequestContextQueue::removeFromSet(
+void McClientRequestContextQueue::insertIntoTable(
     McClientRequestContextBase& req) {
-  if (outOfOrder_) {
-    set_.erase(req);
+  // Keep the table at most half full so probe chains stay short.
+  if ((tableSize_ + 1) * 2 > table_.size()) {
+    growTable();
+  }
+  const size_t mask = table_.size() - 1;
+  size_t i = req.id & mask;
+  while (table_[i] != nullptr) {
+    i = (i + 1) & mask;
+  }
+  table_[i] = &req;
+  ++tableSize_;
+}
+
+void McClientRequestContextQueue::removeFromTable(
+    McClientRequestContextBase& req) {
+  if (!outOfOrder_) {
+    return;
+  }
+  const size_t mask = table_.size() - 1;
+  size_t i = req.id & mask;
+  while (table_[i] != &req) {
+    assert(table_[i] != nullptr);
+    i = (i + 1) & mask;
+  }
+  table_[i] = nullptr;
+  --tableSize_;
+  /* Shift any displaced entries back over the hole so that lookups never
+     need tombstones. An entry at j may fill the hole at i iff its home
+     slot is cyclically outside (i, j]. */
+  for (size_t j = (i + 1) & mask; table_[j] != nullptr; j = (j + 1) & mask) {
+    const size_t home = table_[j]->id & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      table_[i] = table_[j];
+      table_[j] = nullptr;
+      i = j;
+    }
   }
 }
 
 void McClientRequestContextQueue::removePending(
     McClientRequestContextBase& req) {
   assert(req.state() == State::PENDING_QUEUE);
-  removeFromSet(req);
+  removeFromTable(req);
   pendingQueue_.erase(pendingQueue_.iterator_to(req));
   req.setState(State::NONE);
 }
@@ -214,7 +271,7 @@ void McClientRequestContextQueue::removePendingReply(
     McClientRequestContextBase& req) {
   assert(req.state() == State::PENDING_REPLY_QUEUE);
   assert(&req == &pendingReplyQueue_.front() || outOfOrder_);
-  removeFromSet(req);
+  removeFromTable(req);
   pendingReplyQueue_.erase(pendingReplyQueue_.iterator_to(req));
   req.setState(State::NONE);
   // We need timedOutInitializers_ only for in order protocol.
@@ -226,9 +283,8 @@ void McClientRequestContextQueue::removePendingReply(
 McClientRequestContextBase::InitializerFuncPtr
 McClientRequestContextQueue::getParserInitializer(uint64_t reqId) {
   if (outOfOrder_) {
-    auto it = getContextById(reqId);
-    if (it != set_.end()) {
-      return it->initializer_;
+    if (auto* ctx = getContextById(reqId)) {
+      return ctx->initializer_;
     }
   } else {
     // In inorder protocol we expect to receive timedout requests first.
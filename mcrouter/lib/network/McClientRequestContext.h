@@ -12,15 +12,15 @@
 #include <chrono>
 #include <typeindex>
 
-#include <boost/intrusive/unordered_set.hpp>
-
 #include <folly/fibers/Baton.h>
 #include <folly/IntrusiveList.h>
+#include <folly/io/async/HHWheelTimer.h>
 
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/network/ClientMcParser.h"
 #include "mcrouter/lib/network/FBTrace.h"
 #include "mcrouter/lib/network/McSerializedRequest.h"
+#include "mcrouter/lib/network/RequestAborter.h"
 
 namespace facebook { namespace memcache {
 
@@ -33,7 +33,8 @@ class McClientRequestContextQueue;
  * processing inside of AsyncMcClient.
  */
 class McClientRequestContextBase
-  : public boost::intrusive::unordered_set_base_hook<> {
+  : public folly::HHWheelTimer::Callback,
+    public RequestAborter::Waiter {
  public:
   using InitializerFuncPtr =
     void (*)(ClientMcParser<AsyncMcClientImpl>&);
@@ -68,10 +69,23 @@ class McClientRequestContextBase
   void replyError(mc_res_t result);
 
   /**
-   * Schedule a timeout so that the request does not wait
-   * indefinitely for a reply.
+   * Schedule a timeout on the given timer so that the request does not wait
+   * indefinitely for a reply. The request itself is the timer callback, so
+   * scheduling doesn't allocate.
+   *
+   * No-op for requests that are not waiting for a reply (e.g. they were
+   * replied or canceled before the write completed).
    */
-  void scheduleTimeout();
+  void scheduleTimeout(folly::HHWheelTimer& timer);
+
+  /**
+   * Abort this request if it hasn't been written to the network yet.
+   * The owning fiber wakes up and replies with mc_res_aborted. Requests
+   * that already hit the wire are left to complete normally: the server
+   * will process them anyway and cancelling the wait would only race
+   * with the armed timeout.
+   */
+  void abortRequest() override final;
 
  protected:
   enum class ReqState {
@@ -115,9 +129,12 @@ class McClientRequestContextBase
   folly::fibers::Baton baton_;
   McClientRequestContextQueue& queue_;
 
-  folly::fibers::Baton::TimeoutHandler batonTimeoutHandler_;
   std::chrono::milliseconds batonWaitTimeout_{0};
 
+  /* Set by abortRequest(); waitForReply() replies with mc_res_aborted
+     instead of mc_res_timeout when it finds this set. */
+  bool aborted_{false};
+
  private:
   friend class McClientRequestContextQueue;
 
@@ -141,6 +158,10 @@ class McClientRequestContextBase
    */
   void canceled();
 
+  // folly::HHWheelTimer::Callback overrides.
+  void timeoutExpired() noexcept override final;
+  void callbackCanceled() noexcept override final {}
+
   /**
    * Entry point for propagating reply to the user.
    *
@@ -152,25 +173,8 @@ class McClientRequestContextBase
   void reply(Reply&& r);
 
  public:
-  struct Equal {
-    bool operator()(const McClientRequestContextBase& a,
-                    const McClientRequestContextBase& b) const {
-      return a.id == b.id;
-    }
-  };
-
-  struct Hash {
-    size_t operator()(const McClientRequestContextBase& ctx) const {
-      return std::hash<uint64_t>()(ctx.id);
-    }
-  };
-
   using Queue = folly::CountedIntrusiveList<McClientRequestContextBase,
                                             &McClientRequestContextBase::hook_>;
-  using UnorderedSet =
-    boost::intrusive::unordered_set<McClientRequestContextBase,
-                                    boost::intrusive::equal<Equal>,
-                                    boost::intrusive::hash<Hash>>;
 };
 
 template <class Request>
@@ -288,7 +292,7 @@ class McClientRequestContextQueue {
   std::string debugInfo() const;
 
  private:
-  static constexpr size_t kDefaultNumBuckets = 128;
+  static constexpr size_t kInitialTableSize = 128;
 
   // Friend to allow access to remove* mothods.
   template <class Request>
@@ -306,10 +310,16 @@ class McClientRequestContextQueue {
   // A special internal queue for request that were replied before it's been
   // completely written.
   McClientRequestContextBase::Queue repliedQueue_;
-  // Unordered set of requests. Used only in case of out-of-order protocol
-  // for fast request lookup.
-  std::vector<McClientRequestContextBase::UnorderedSet::bucket_type> buckets_;
-  McClientRequestContextBase::UnorderedSet set_;
+  /**
+   * Open-addressed table of requests keyed by id. Used only in case of
+   * out-of-order protocol for fast request lookup. Ids are assigned
+   * sequentially, so id & (size - 1) spreads entries evenly and linear
+   * probe chains stay short; the table is kept at most half full and
+   * doubles on demand, so inflight windows in the thousands still
+   * complete in O(1).
+   */
+  std::vector<McClientRequestContextBase*> table_;
+  size_t tableSize_{0};
 
   // Storage for parser initializers for timed out requests.
   std::queue<McClientRequestContextBase::InitializerFuncPtr>
@@ -317,9 +327,9 @@ class McClientRequestContextQueue {
 
   void failQueue(McClientRequestContextBase::Queue& queue, mc_res_t error);
 
-  McClientRequestContextBase::UnorderedSet::iterator
-  getContextById(uint64_t id);
-  void removeFromSet(McClientRequestContextBase& req);
+  McClientRequestContextBase* getContextById(uint64_t id);
+  void insertIntoTable(McClientRequestContextBase& req);
+  void removeFromTable(McClientRequestContextBase& req);
 
   /**
    * Removes given request from pending queue and id map.
@@ -339,7 +349,7 @@ class McClientRequestContextQueue {
    */
   void clearStoredInitializers();
 
-  void growBucketsArray();
+  void growTable();
 
   std::string getFirstAliveRequestInfo() const;
 };
@@ -10,15 +10,17 @@
 #include "McParser.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include <folly/Bits.h>
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/ThreadLocal.h>
-#include <folly/io/Cursor.h>
 
+#include "mcrouter/lib/allocator/JemallocHugePageAllocator.h"
 #include "mcrouter/lib/allocator/JemallocNodumpAllocator.h"
 #include "mcrouter/lib/cycles/Clocks.h"
+#include "mcrouter/lib/MemoryBudget.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
 
 namespace facebook { namespace memcache {
@@ -47,27 +49,15 @@ size_t mcOpToRequestTypeId(mc_op_t mc_op) {
 
 folly::ThreadLocal<JemallocNodumpAllocator> allocator;
 
-folly::IOBuf copyToNodumpBuffer(
-    const UmbrellaMessageInfo& umMsgInfo,
-    const folly::IOBuf& readBuffer) {
-  // Allocate buffer
-  const size_t bufSize = umMsgInfo.headerSize + umMsgInfo.bodySize;
-  void* p = allocator->allocate(bufSize);
-  if (!p) {
-    LOG(WARNING) << "Not enough memory to create a nodump buffer";
-    throw std::bad_alloc();
-  }
-  // Copy data
-  folly::io::Cursor c(&readBuffer);
-  c.pull(p, readBuffer.length());
-  // Transfer ownership to a new IOBuf
-  return folly::IOBuf(folly::IOBuf::TAKE_OWNERSHIP,
-                      p,
-                      bufSize,
-                      readBuffer.length(),
-                      JemallocNodumpAllocator::deallocate,
-                      reinterpret_cast<void*> (allocator->getFlags()));
-}
+#endif
+
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+
+// Buffers below this size share 4KB pages with unrelated allocations
+// anyway, so only the larger size classes go to the hugepage arena.
+constexpr size_t kHugePageBufferMinSize = 32 * 1024;
+
+folly::ThreadLocal<JemallocHugePageAllocator> hugePageAllocator;
 
 #endif
 
@@ -77,16 +67,86 @@ McParser::McParser(ParserCallback& callback,
                    size_t minBufferSize,
                    size_t maxBufferSize,
                    const bool useJemallocNodumpAllocator,
+                   const bool useHugePageBuffers,
                    ConnectionFifo* debugFifo)
     : callback_(callback),
       bufferSize_(minBufferSize),
+      minBufferSize_(minBufferSize),
       maxBufferSize_(maxBufferSize),
+      msgSizeEstimate_(minBufferSize),
       debugFifo_(debugFifo),
-      readBuffer_(folly::IOBuf::CREATE, bufferSize_),
-      useJemallocNodumpAllocator_(useJemallocNodumpAllocator) {
+      useJemallocNodumpAllocator_(useJemallocNodumpAllocator),
+      useHugePageBuffers_(useHugePageBuffers) {
 #ifndef CAN_USE_JEMALLOC_NODUMP_ALLOCATOR
   useJemallocNodumpAllocator_ = false;
 #endif
+#ifndef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+  useHugePageBuffers_ = false;
+#endif
+  readBuffer_ = allocateReadBuffer(bufferSize_);
+  accountReadBuffer();
+}
+
+McParser::~McParser() {
+  MemoryBudget::instance().account(
+      MemoryBudget::kReadBuffers,
+      -static_cast<int64_t>(accountedReadBufferBytes_));
+}
+
+void McParser::accountReadBuffer() {
+  const auto capacity = readBuffer_.capacity();
+  MemoryBudget::instance().account(
+      MemoryBudget::kReadBuffers,
+      static_cast<int64_t>(capacity) -
+          static_cast<int64_t>(accountedReadBufferBytes_));
+  accountedReadBufferBytes_ = capacity;
+}
+
+folly::IOBuf McParser::allocateReadBuffer(size_t size) const {
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+  if (useHugePageBuffers_ && size >= kHugePageBufferMinSize) {
+    if (void* p = hugePageAllocator->allocate(size)) {
+      return folly::IOBuf(folly::IOBuf::TAKE_OWNERSHIP,
+                          p,
+                          size,
+                          0 /* length */,
+                          JemallocHugePageAllocator::deallocate,
+                          reinterpret_cast<void*>(
+                              hugePageAllocator->getFlags()));
+    }
+    LOG(WARNING) << "Not enough memory to create a hugepage buffer";
+  }
+#endif
+#ifdef CAN_USE_JEMALLOC_NODUMP_ALLOCATOR
+  if (useJemallocNodumpAllocator_) {
+    if (void* p = allocator->allocate(size)) {
+      return folly::IOBuf(folly::IOBuf::TAKE_OWNERSHIP,
+                          p,
+                          size,
+                          0 /* length */,
+                          JemallocNodumpAllocator::deallocate,
+                          reinterpret_cast<void*>(allocator->getFlags()));
+    }
+    LOG(WARNING) << "Not enough memory to create a nodump buffer";
+  }
+#endif
+  return folly::IOBuf(folly::IOBuf::CREATE, size);
+}
+
+void McParser::growReadBuffer(size_t minTailroom) {
+  if (!useJemallocNodumpAllocator_ && !useHugePageBuffers_) {
+    readBuffer_.reserve(0 /* minHeadroom */, minTailroom);
+    accountReadBuffer();
+    return;
+  }
+  /* IOBuf::reserve() would reallocate with ordinary malloc and silently
+     move the buffer out of its custom arena, so grow by hand. */
+  auto newBuffer = allocateReadBuffer(readBuffer_.length() + minTailroom);
+  std::memcpy(
+      newBuffer.writableTail(), readBuffer_.data(), readBuffer_.length());
+  newBuffer.append(readBuffer_.length());
+  readBuffer_ = std::move(newBuffer);
+  accountReadBuffer();
 }
 
 void McParser::reset() {
@@ -105,7 +165,7 @@ std::pair<void*, size_t> McParser::getReadBuffer() {
     readBuffer_.retreat(readBuffer_.headroom());
   } else {
     /* Reallocate more space if necessary */
-    readBuffer_.reserve(0, bufferSize_);
+    growReadBuffer(bufferSize_);
   }
   return std::make_pair(readBuffer_.writableTail(), readBuffer_.tailroom());
 }
@@ -140,6 +200,7 @@ bool McParser::readUmbrellaOrCaretData() {
     // Case 1: Entire message (and possibly part of next) is in the buffer
     if (readBuffer_.length() >= messageSize) {
       if (UNLIKELY(debugFifo_ && debugFifo_->isConnected())) {
+        uint64_t reqId = umMsgInfo_.reqId;
         if (protocol_ == mc_umbrella_protocol) {
           const auto mc_op = umbrellaDetermineOperation(
               readBuffer_.data(), umMsgInfo_.headerSize);
@@ -150,8 +211,15 @@ bool McParser::readUmbrellaOrCaretData() {
             // request's typeId. We rely on this in ClientServerMcParser.h.
             ++umMsgInfo_.typeId;
           }
+          reqId = umbrellaDetermineReqId(
+              readBuffer_.data(), umMsgInfo_.headerSize);
         }
-        debugFifo_->startMessage(MessageDirection::Received, umMsgInfo_.typeId);
+        debugFifo_->startMessage(MessageDirection::Received,
+                                 umMsgInfo_.typeId,
+                                 protocol_,
+                                 reqId,
+                                 0 /* keyOffset */,
+                                 0 /* keySize */);
         debugFifo_->writeData(readBuffer_.writableData(), messageSize);
       }
 
@@ -167,6 +235,7 @@ bool McParser::readUmbrellaOrCaretData() {
         return false;
       }
       readBuffer_.trimStart(messageSize);
+      updateMessageSizeEstimate(messageSize);
       continue;
     }
 
@@ -182,31 +251,45 @@ bool McParser::readUmbrellaOrCaretData() {
       assert(!readBuffer_.isChained());
       readBuffer_.unshareOne();
       bufferSize_ = std::max<size_t>(bufferSize_, messageSize);
-      readBuffer_.reserve(
-          0 /* minHeadroom */,
-          bufferSize_ - readBuffer_.length() /* minTailroom */);
-    }
-#ifdef CAN_USE_JEMALLOC_NODUMP_ALLOCATOR
-    if (useJemallocNodumpAllocator_) {
-      readBuffer_ = copyToNodumpBuffer(umMsgInfo_, readBuffer_);
+      growReadBuffer(bufferSize_ - readBuffer_.length() /* minTailroom */);
     }
-#endif
     return true;
   }
 
   // We parsed everything, read buffer is empty.
-  // Try to shrink it to reduce memory footprint
-  if (bufferSize_ > maxBufferSize_) {
-    auto curCycles = cycles::getCpuCycles();
-    if (curCycles > lastShrinkCycles_ + kAdjustBufferSizeCpuCycles) {
-      lastShrinkCycles_ = curCycles;
-      bufferSize_ = maxBufferSize_;
-      readBuffer_ = folly::IOBuf(folly::IOBuf::CREATE, bufferSize_);
-    }
-  }
+  // Try to rightsize it for the traffic this session actually sees.
+  adjustBufferSize();
   return true;
 }
 
+void McParser::updateMessageSizeEstimate(size_t msgSize) {
+  if (msgSize > msgSizeEstimate_) {
+    msgSizeEstimate_ = msgSize;
+  } else {
+    // Decay slowly towards smaller observations, so a burst of small
+    // requests doesn't immediately give up a buffer the next large
+    // multiget will need again.
+    msgSizeEstimate_ -= (msgSizeEstimate_ - msgSize) / 8;
+  }
+}
+
+void McParser::adjustBufferSize() {
+  assert(readBuffer_.length() == 0);
+  const auto curCycles = cycles::getCpuCycles();
+  if (curCycles < lastShrinkCycles_ + kAdjustBufferSizeCpuCycles) {
+    return;
+  }
+  lastShrinkCycles_ = curCycles;
+  const size_t target = std::min(
+      std::max(folly::nextPowTwo(msgSizeEstimate_), minBufferSize_),
+      maxBufferSize_);
+  if (target != bufferSize_) {
+    bufferSize_ = target;
+    readBuffer_ = allocateReadBuffer(bufferSize_);
+    accountReadBuffer();
+  }
+}
+
 bool McParser::readDataAvailable(size_t len) {
   // Caller is responsible for ensuring the read buffer has enough tailroom
   readBuffer_.append(len);
@@ -228,6 +311,11 @@ bool McParser::readDataAvailable(size_t len) {
 
   if (protocol_ == mc_ascii_protocol) {
     callback_.handleAscii(readBuffer_);
+    // Ascii has no framing to measure; use the read size as a proxy.
+    updateMessageSizeEstimate(len);
+    if (readBuffer_.length() == 0) {
+      adjustBufferSize();
+    }
     return true;
   }
   return readUmbrellaOrCaretData();
@@ -79,9 +79,10 @@ class McParser {
            size_t minBufferSize,
            size_t maxBufferSize,
            const bool useJemallocNodumpAllocator = false,
+           const bool useHugePageBuffers = false,
            ConnectionFifo* debugFifo = nullptr);
 
-  ~McParser() = default;
+  ~McParser();
 
   mc_protocol_t protocol() const {
     return protocol_;
@@ -121,12 +122,26 @@ class McParser {
 
   ParserCallback& callback_;
   size_t bufferSize_{256};
+  size_t minBufferSize_{256};
   size_t maxBufferSize_{4096};
 
+  /**
+   * Exponentially decayed maximum of observed message sizes, used to
+   * periodically resize readBuffer_ to what this session actually needs
+   * instead of thrashing between the two configured extremes.
+   */
+  size_t msgSizeEstimate_{256};
+
   ConnectionFifo* debugFifo_{nullptr};
 
   uint64_t lastShrinkCycles_{0};
 
+  /**
+   * Bytes of readBuffer_ capacity currently charged against
+   * MemoryBudget::kReadBuffers.
+   */
+  size_t accountedReadBufferBytes_{0};
+
   folly::IOBuf readBuffer_;
 
   /**
@@ -139,7 +154,48 @@ class McParser {
    */
   bool useJemallocNodumpAllocator_{false};
 
+  /**
+   * If set, read buffers at or above the large-buffer threshold are
+   * allocated from the MADV_HUGEPAGE jemalloc arena (see
+   * JemallocHugePageAllocator).
+   */
+  bool useHugePageBuffers_{false};
+
   bool readUmbrellaOrCaretData();
+
+  /**
+   * Allocates a fresh read buffer of the given capacity, from the
+   * jemalloc hugepage or nodump arena if enabled (falling back to
+   * ordinary allocation if the arena is out of memory).
+   */
+  folly::IOBuf allocateReadBuffer(size_t size) const;
+
+  /**
+   * Ensures readBuffer_ has at least minTailroom bytes of tailroom,
+   * reallocating through allocateReadBuffer() so that a grown buffer
+   * stays in its custom arena.
+   */
+  void growReadBuffer(size_t minTailroom);
+
+  /**
+   * Folds an observed message (or read) size into msgSizeEstimate_.
+   * The estimate tracks recent peaks: it jumps to a larger observation
+   * immediately and decays towards smaller ones slowly.
+   */
+  void updateMessageSizeEstimate(size_t msgSize);
+
+  /**
+   * Periodically rightsizes readBuffer_/bufferSize_ to the current
+   * estimate, bounded by [minBufferSize_, maxBufferSize_].
+   * Must only be called when readBuffer_ is empty.
+   */
+  void adjustBufferSize();
+
+  /**
+   * Re-charges readBuffer_'s current capacity against the global memory
+   * budget.  Call after any (re)allocation of readBuffer_.
+   */
+  void accountReadBuffer();
 };
 
 inline McParser::ParserCallback::~ParserCallback() {}
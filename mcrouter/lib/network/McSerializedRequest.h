@@ -57,10 +57,13 @@ class McSerializedRequest {
   size_t getIovsCount() const { return iovsCount_; }
   const struct iovec* getIovs() const { return iovsBegin_; }
   uint32_t typeId() const { return typeId_; }
+  mc_protocol_t protocol() const { return protocol_; }
 
- private:
+  // Upper bound on the number of iovecs a single serialized request may
+  // reference, for any protocol.
   static const size_t kMaxIovs = 20;
 
+ private:
   union {
     AsciiSerializedRequest asciiRequest_;
     UmbrellaSerializedMessage umbrellaMessage_;
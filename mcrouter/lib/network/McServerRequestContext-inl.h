@@ -9,6 +9,7 @@
  */
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/network/McServerSession.h"
+#include "mcrouter/lib/network/MultiOpParent.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
 #include "mcrouter/lib/network/WriteBuffer.h"
 
@@ -20,8 +21,12 @@ void McServerRequestContext::reply(
     Reply&& reply) {
   ctx.replied_ = true;
 
-  // On error, multi-op parent may assume responsiblity of replying
-  if (ctx.moveReplyToParent(
+  // On error, multi-op parent may assume responsiblity of replying.
+  // Parents only exist for ascii multi-op; checking here keeps the raw
+  // message access (which would drop a carried wire body) off the
+  // parentless path.
+  if (ctx.hasParent() &&
+      ctx.moveReplyToParent(
         reply.result(), reply.appSpecificErrorCode(),
         std::move(reply->message))) {
     replyImpl(std::move(ctx), Reply());
@@ -38,8 +43,10 @@ void McServerRequestContext::reply(
     void* toDestruct) {
   ctx.replied_ = true;
 
-  // On error, multi-op parent may assume responsiblity of replying
-  if (ctx.moveReplyToParent(
+  // On error, multi-op parent may assume responsiblity of replying.
+  // See above for why the parent check comes first.
+  if (ctx.hasParent() &&
+      ctx.moveReplyToParent(
         reply.result(), reply.appSpecificErrorCode(),
         std::move(reply->message))) {
     replyImpl(std::move(ctx), Reply(), destructor, toDestruct);
@@ -70,6 +77,7 @@ void McServerRequestContext::replyImpl(
   session->ensureWriteBufs();
 
   uint64_t reqid = ctx.reqid_;
+  auto* parent = ctx.hasParent() ? &ctx.parent() : nullptr;
   auto wb = session->writeBufs_->get();
   if (!wb->prepareTyped(
           std::move(ctx),
@@ -78,6 +86,15 @@ void McServerRequestContext::replyImpl(
     session->transport_->close();
     return;
   }
+  if (parent != nullptr) {
+    /* The write buffer keeps the parent alive via the moved-in context. */
+    size_t replyBytes = 0;
+    const struct iovec* iovs = wb->getIovsBegin();
+    for (size_t i = 0, n = wb->getIovsCount(); i < n; ++i) {
+      replyBytes += iovs[i].iov_len;
+    }
+    parent->recordReplyBytes(replyBytes);
+  }
   session->reply(std::move(wb), reqid);
 }
 
@@ -110,4 +127,31 @@ void McServerOnRequestWrapper<OnRequest, List<Request>>::caretRequestReady(
     HasDispatchTypedRequest<OnRequest>::value);
 }
 
+template <class T, class Enable = void>
+struct HasRequestBatchHooks {
+  static constexpr std::false_type value{};
+};
+
+template <class T>
+struct HasRequestBatchHooks<
+  T,
+  typename std::enable_if<
+    std::is_same<
+      decltype(std::declval<T>().requestBatchStarted()),
+      void>::value>::type> {
+  static constexpr std::true_type value{};
+};
+
+template <class OnRequest, class Request>
+void McServerOnRequestWrapper<OnRequest, List<Request>>::
+requestBatchStarted() {
+  requestBatchStartedIfDefined(HasRequestBatchHooks<OnRequest>::value);
+}
+
+template <class OnRequest, class Request>
+void McServerOnRequestWrapper<OnRequest, List<Request>>::
+requestBatchFinished() {
+  requestBatchFinishedIfDefined(HasRequestBatchHooks<OnRequest>::value);
+}
+
 }}  // facebook::memcache
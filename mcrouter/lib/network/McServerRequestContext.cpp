@@ -43,8 +43,14 @@ McServerRequestContext::McServerRequestContext(
     uint64_t r,
     bool nr,
     std::shared_ptr<MultiOpParent> parent,
-    CompressionCodec* codec)
-    : session_(&s), operation_(op), noReply_(nr), reqid_(r), codec_(codec) {
+    CompressionCodec* codec,
+    CompressionFilter* compressionFilter)
+    : session_(&s),
+      operation_(op),
+      noReply_(nr),
+      reqid_(r),
+      codec_(codec),
+      compressionFilter_(compressionFilter) {
   if (parent) {
     asciiState_ = folly::make_unique<AsciiState>();
     asciiState_->parent_ = std::move(parent);
@@ -62,7 +68,9 @@ McServerRequestContext::McServerRequestContext(
       replied_(other.replied_),
       reqid_(other.reqid_),
       asciiState_(std::move(other.asciiState_)),
-      codec_(other.codec_) {
+      codec_(other.codec_),
+      compressionFilter_(other.compressionFilter_),
+      compressionBucket_(other.compressionBucket_) {
   other.session_ = nullptr;
 }
 
@@ -76,12 +84,24 @@ McServerRequestContext& McServerRequestContext::operator=(
   replied_ = other.replied_;
   asciiState_ = std::move(other.asciiState_);
   codec_ = other.codec_;
+  compressionFilter_ = other.compressionFilter_;
+  compressionBucket_ = other.compressionBucket_;
 
   other.session_ = nullptr;
 
   return *this;
 }
 
+void McServerRequestContext::setCompressionKey(folly::StringPiece key) {
+  if (codec_ != nullptr && compressionFilter_ != nullptr) {
+    compressionBucket_ = CompressionFilter::bucketOf(key);
+  }
+}
+
+void setCompressionKey(McServerRequestContext& ctx, folly::StringPiece key) {
+  ctx.setCompressionKey(key);
+}
+
 McServerRequestContext::~McServerRequestContext() {
   if (session_) {
     /* Check that a reply was returned */
@@ -16,6 +16,7 @@
 #include <folly/Optional.h>
 
 #include "mcrouter/lib/McRequestList.h"
+#include "mcrouter/lib/network/CompressionFilter.h"
 #include "mcrouter/lib/network/ThriftMessageList.h"
 #include "mcrouter/lib/network/UmbrellaProtocol.h"
 
@@ -59,6 +60,14 @@ class McServerRequestContext {
    */
   McServerSession& session();
 
+  /**
+   * Remembers which compression-filter bucket the request key falls in,
+   * so that the reply path can skip compressing values under keys that
+   * historically did not compress. No-op unless the session negotiated
+   * a compression codec for this request.
+   */
+  void setCompressionKey(folly::StringPiece key);
+
  private:
   McServerSession* session_;
 
@@ -75,6 +84,8 @@ class McServerRequestContext {
   std::unique_ptr<AsciiState> asciiState_;
 
   CompressionCodec* codec_{nullptr};
+  CompressionFilter* compressionFilter_{nullptr};
+  uint32_t compressionBucket_{CompressionFilter::kNoBucket};
 
   bool noReply(mc_res_t result) const;
 
@@ -120,9 +131,17 @@ class McServerRequestContext {
   McServerRequestContext(McServerSession& s, mc_op_t op, uint64_t r,
                          bool nr = false,
                          std::shared_ptr<MultiOpParent> parent = nullptr,
-                         CompressionCodec* codec = nullptr);
+                         CompressionCodec* codec = nullptr,
+                         CompressionFilter* compressionFilter = nullptr);
 };
 
+/**
+ * Free-function version of McServerRequestContext::setCompressionKey(),
+ * for callers that only see a forward declaration of the context (e.g.
+ * ThriftMsgDispatcher.h). Defined in McServerRequestContext.cpp.
+ */
+void setCompressionKey(McServerRequestContext& ctx, folly::StringPiece key);
+
 /**
  * McServerOnRequest is a polymorphic base class used as a callback
  * by AsyncMcServerWorker and McAsciiParser to hand off a request
@@ -163,6 +182,15 @@ class McServerOnRequestIf<List<Request, Requests...>> :
 };
 
 class McServerOnRequest : public McServerOnRequestIf<ThriftRequestList> {
+ public:
+  /**
+   * Called by McServerSession around a run of requests parsed from a single
+   * read event when AsyncMcServerWorkerOptions::requestBatchSize is set.
+   * Implementations may defer per-request cross-thread notifications until
+   * requestBatchFinished().  Defaults are no-ops.
+   */
+  virtual void requestBatchStarted() {}
+  virtual void requestBatchFinished() {}
 };
 
 /**
@@ -191,6 +219,21 @@ class McServerOnRequestWrapper<OnRequest, List<Request>>
                          const folly::IOBuf& reqBody,
                          McServerRequestContext&& ctx) override final;
 
+  void requestBatchStarted() override final;
+  void requestBatchFinished() override final;
+
+  void requestBatchStartedIfDefined(std::true_type) {
+    onRequest_.requestBatchStarted();
+  }
+
+  void requestBatchStartedIfDefined(std::false_type) {}
+
+  void requestBatchFinishedIfDefined(std::true_type) {
+    onRequest_.requestBatchFinished();
+  }
+
+  void requestBatchFinishedIfDefined(std::false_type) {}
+
   void dispatchTypedRequestIfDefined(const UmbrellaMessageInfo& headerInfo,
                                      const folly::IOBuf& reqBody,
                                      McServerRequestContext&& ctx,
@@ -33,7 +33,12 @@ void McServerSession::asciiRequestReady(TypedThriftRequest<ThriftType>&& req,
   }
 
   if (GetLike<TypedThriftRequest<ThriftType>>::value && !currentMultiop_) {
-    currentMultiop_ = std::make_shared<MultiOpParent>(*this, tailReqid_++);
+    // Carve the parent out of the session-local pool; the deleter returns
+    // the block to the pool for the next multi-op batch. All references to
+    // the parent are owned by this session, so capturing 'this' is safe.
+    currentMultiop_ = std::shared_ptr<MultiOpParent>(
+        multiOpPool_.alloc(*this, tailReqid_++),
+        [this](MultiOpParent* parent) { multiOpPool_.free(parent); });
   }
   uint64_t reqid;
   reqid = tailReqid_++;
@@ -49,6 +54,7 @@ void McServerSession::asciiRequestReady(TypedThriftRequest<ThriftType>&& req,
     McServerRequestContext::reply(std::move(ctx), Reply(mc_res_bad_key));
   } else {
     onRequest_->requestReady(std::move(ctx), std::move(req));
+    requestDispatched();
   }
 }
 
@@ -85,6 +91,7 @@ void McServerSession::umbrellaRequestReady(TypedThriftRequest<ThriftType>&& req,
     stateCb_.onShutdown();
   } else {
     onRequest_->requestReady(std::move(ctx), std::move(req));
+    requestDispatched();
   }
 }
 
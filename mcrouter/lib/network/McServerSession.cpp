@@ -9,10 +9,14 @@
  */
 #include "McServerSession.h"
 
+#include <netinet/tcp.h>
+
 #include <memory>
 
+#include <folly/io/async/AsyncSocket.h>
 #include <folly/Memory.h>
 #include <folly/small_vector.h>
+#include <folly/String.h>
 
 #include "mcrouter/lib/debug/FifoManager.h"
 #include "mcrouter/lib/network/McServerRequestContext.h"
@@ -25,10 +29,11 @@ namespace {
 
 ConnectionFifo getDebugFifo(
     const std::string& path,
+    size_t ringBytes,
     const folly::AsyncTransportWrapper* transport) {
   if (!path.empty()) {
     if (auto fifoManager = FifoManager::getInstance()) {
-      auto fifo = fifoManager->fetchThreadLocal(path);
+      auto fifo = fifoManager->fetchThreadLocal(path, ringBytes);
       return ConnectionFifo(std::move(fifo), transport);
     }
   }
@@ -78,13 +83,18 @@ McServerSession::McServerSession(
       onRequest_(std::move(cb)),
       stateCb_(stateCb),
       options_(std::move(options)),
-      debugFifo_(getDebugFifo(options_.debugFifoPath, transport_.get())),
+      debugFifo_(getDebugFifo(options_.debugFifoPath,
+                              options_.debugFifoRingBytes,
+                              transport_.get())),
       pendingWrites_(folly::make_unique<WriteBufferIntrusiveList>()),
+      largePendingWrites_(folly::make_unique<WriteBufferIntrusiveList>()),
       sendWritesCallback_(*this),
       compressionCodecMap_(codecMap),
       parser_(*this,
               options_.minBufferSize,
               options_.maxBufferSize,
+              options_.useJemallocNodumpAllocator,
+              options_.useHugePageBuffers,
               &debugFifo_),
       userCtxt_(userCtxt) {
 
@@ -99,6 +109,38 @@ McServerSession::McServerSession(
   if (socket != nullptr) {
     socket->sslAccept(this, /* timeout = */ 0);
   }
+
+  if (options_.tcpNotsentLowat > 0) {
+#ifdef TCP_NOTSENT_LOWAT
+    auto asyncSock = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+    if (asyncSock != nullptr) {
+      const uint32_t lowat = options_.tcpNotsentLowat;
+      if (asyncSock->setSockOpt(IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat) != 0) {
+        LOG(WARNING) << "Failed to set TCP_NOTSENT_LOWAT: "
+                     << folly::errnoStr(errno);
+      }
+    }
+#else
+    LOG(WARNING) << "TCP_NOTSENT_LOWAT requested, "
+                    "but not supported on this platform";
+#endif
+  }
+
+  if (options_.busyPollUs > 0) {
+#ifdef SO_BUSY_POLL
+    auto asyncSock = transport_->getUnderlyingTransport<folly::AsyncSocket>();
+    if (asyncSock != nullptr) {
+      const uint32_t busyPollUs = options_.busyPollUs;
+      if (asyncSock->setSockOpt(SOL_SOCKET, SO_BUSY_POLL, &busyPollUs) != 0) {
+        LOG(WARNING) << "Failed to set SO_BUSY_POLL: "
+                     << folly::errnoStr(errno);
+      }
+    }
+#else
+    LOG(WARNING) << "SO_BUSY_POLL requested, "
+                    "but not supported on this platform";
+#endif
+  }
 }
 
 void McServerSession::pause(PauseReason reason) {
@@ -132,6 +174,7 @@ void McServerSession::onTransactionStarted(bool isSubRequest) {
 void McServerSession::checkClosed() {
   if (!inFlight_) {
     assert(pendingWrites_->empty());
+    assert(largePendingWrites_->empty());
 
     if (state_ == CLOSING) {
       /* It's possible to call close() more than once from the same stack.
@@ -172,15 +215,20 @@ void McServerSession::reply(std::unique_ptr<WriteBuffer> wb, uint64_t reqid) {
     if (reqid == headReqid_) {
       /* head of line reply, write it and all contiguous blocked replies */
       queueWrite(std::move(wb));
-      auto it = blockedReplies_.find(++headReqid_);
-      while (it != blockedReplies_.end()) {
-        queueWrite(std::move(it->second));
-        blockedReplies_.erase(it);
-        it = blockedReplies_.find(++headReqid_);
+      ++headReqid_;
+      while (!blockedReplies_.empty() && blockedReplies_.front().hasValue()) {
+        queueWrite(std::move(blockedReplies_.front().value()));
+        blockedReplies_.pop_front();
+        ++headReqid_;
       }
     } else {
       /* can't write this reply now, save for later */
-      blockedReplies_.emplace(reqid, std::move(wb));
+      assert(reqid > headReqid_);
+      const size_t idx = reqid - headReqid_ - 1;
+      if (idx >= blockedReplies_.size()) {
+        blockedReplies_.resize(idx + 1);
+      }
+      blockedReplies_[idx] = std::move(wb);
     }
   }
 }
@@ -215,11 +263,34 @@ void McServerSession::getReadBuffer(void** bufReturn, size_t* lenReturn) {
 
 void McServerSession::readDataAvailable(size_t len) noexcept {
   DestructorGuard dg(this);
-  if (!parser_.readDataAvailable(len)) {
+  if (options_.requestBatchSize > 1) {
+    inRequestBatch_ = true;
+    batchDispatched_ = 0;
+    onRequest_->requestBatchStarted();
+  }
+  bool ok = parser_.readDataAvailable(len);
+  if (inRequestBatch_) {
+    inRequestBatch_ = false;
+    onRequest_->requestBatchFinished();
+  }
+  if (!ok) {
     close();
   }
 }
 
+void McServerSession::requestDispatched() {
+  if (!inRequestBatch_) {
+    return;
+  }
+  if (++batchDispatched_ >= options_.requestBatchSize) {
+    /* Cap the batch size: flush any deferred notifications and
+       open a fresh batch for the rest of the read buffer. */
+    batchDispatched_ = 0;
+    onRequest_->requestBatchFinished();
+    onRequest_->requestBatchStarted();
+  }
+}
+
 void McServerSession::readEOF() noexcept {
   close();
 }
@@ -257,6 +328,7 @@ void McServerSession::onRequest(
   }
 
   onRequest_->requestReady(std::move(ctx), std::move(req));
+  requestDispatched();
 }
 
 void McServerSession::onRequest(TypedThriftRequest<cpp2::McShutdownRequest>&&,
@@ -300,7 +372,8 @@ void McServerSession::caretRequestReady(const UmbrellaMessageInfo& headerInfo,
       headerInfo.reqId,
       false,
       nullptr,
-      getCodec(headerInfo));
+      getCodec(headerInfo),
+      &compressionFilter_);
 
   if (IdFromType<cpp2::McVersionRequest, TRequestList>::value ==
           headerInfo.typeId &&
@@ -310,6 +383,7 @@ void McServerSession::caretRequestReady(const UmbrellaMessageInfo& headerInfo,
     McServerRequestContext::reply(std::move(ctx), std::move(versionReply));
   } else {
     onRequest_->caretRequestReady(headerInfo, reqBody, std::move(ctx));
+    requestDispatched();
   }
 }
 
@@ -370,7 +444,16 @@ void McServerSession::queueWrite(std::unique_ptr<WriteBuffer> wb) {
       pause(PAUSE_WRITE);
     }
   } else {
-    pendingWrites_->pushBack(std::move(wb));
+    if (options_.largeReplyDeferBytes > 0 && parser_.outOfOrder() &&
+        !wb->noReply() &&
+        wb->totalSize() >= options_.largeReplyDeferBytes) {
+      /* The client matches replies by id, so a large reply doesn't have to
+         ride the shared batch: holding it for its own write lets small
+         replies from this and later loop iterations go out first. */
+      largePendingWrites_->pushBack(std::move(wb));
+    } else {
+      pendingWrites_->pushBack(std::move(wb));
+    }
 
     if (!writeScheduled_) {
       eventBase_.runInLoop(&sendWritesCallback_, /* thisIteration= */ true);
@@ -384,34 +467,71 @@ void McServerSession::sendWrites() {
 
   writeScheduled_ = false;
 
-  folly::small_vector<struct iovec, kIovecVectorSize> iovs;
-  while (!pendingWrites_->empty()) {
-    auto wb = pendingWrites_->popFront();
-    if (!wb->noReply()) {
-      if (UNLIKELY(debugFifo_.isConnected())) {
-        writeToDebugFifo(wb.get());
+  if (!pendingWrites_->empty()) {
+    folly::small_vector<struct iovec, kIovecVectorSize> iovs;
+    while (!pendingWrites_->empty()) {
+      auto wb = pendingWrites_->popFront();
+      if (!wb->noReply()) {
+        if (UNLIKELY(debugFifo_.isConnected())) {
+          writeToDebugFifo(wb.get());
+        }
+        iovs.insert(iovs.end(),
+                    wb->getIovsBegin(),
+                    wb->getIovsBegin() + wb->getIovsCount());
       }
-      iovs.insert(iovs.end(),
-                  wb->getIovsBegin(),
-                  wb->getIovsBegin() + wb->getIovsCount());
+      if (pendingWrites_->empty()) {
+        wb->markEndOfBatch();
+      }
+      writeBufs_->push(std::move(wb));
     }
-    if (pendingWrites_->empty()) {
-      wb->markEndOfBatch();
+    transport_->writev(this, iovs.data(), iovs.size());
+  }
+
+  if (!largePendingWrites_->empty()) {
+    /* Emit deferred large replies one per loop iteration, each as its own
+       write batch, so small replies completing in the meantime are queued
+       ahead of the remaining large ones. */
+    auto wb = largePendingWrites_->popFront();
+    if (UNLIKELY(debugFifo_.isConnected())) {
+      writeToDebugFifo(wb.get());
     }
+    const struct iovec* wbIovs = wb->getIovsBegin();
+    const size_t wbIovsCount = wb->getIovsCount();
+    wb->markEndOfBatch();
     writeBufs_->push(std::move(wb));
+    transport_->writev(this, wbIovs, wbIovsCount);
+    if (!largePendingWrites_->empty()) {
+      eventBase_.runInLoop(&sendWritesCallback_);
+      writeScheduled_ = true;
+    }
+  }
+  if (options_.tcpNotsentLowat > 0 && !writeBufs_->empty()) {
+    /* With TCP_NOTSENT_LOWAT set, the socket only becomes writable again
+       once the kernel's unsent bytes drop below the mark, so writeSuccess()
+       is deferred until the client catches up.  Stop reading new requests
+       until then to bound the reply memory we accumulate. */
+    pause(PAUSE_WRITE);
   }
-
-  transport_->writev(this, iovs.data(), iovs.size());
 }
 
 void McServerSession::writeToDebugFifo(const WriteBuffer* wb) noexcept {
   if (!wb->isSubRequest()) {
-    debugFifo_.startMessage(MessageDirection::Sent, wb->typeId());
+    debugFifo_.startMessage(MessageDirection::Sent,
+                            wb->typeId(),
+                            parser_.protocol(),
+                            0 /* reqId */,
+                            0 /* keyOffset */,
+                            0 /* keySize */);
     hasPendingMultiOp_ = false;
   } else {
     // Handle multi-op
     if (!hasPendingMultiOp_) {
-      debugFifo_.startMessage(MessageDirection::Sent, wb->typeId());
+      debugFifo_.startMessage(MessageDirection::Sent,
+                              wb->typeId(),
+                              parser_.protocol(),
+                              0 /* reqId */,
+                              0 /* keyOffset */,
+                              0 /* keySize */);
       hasPendingMultiOp_ = true;
     }
     if (wb->operation() == mc_op_end) {
@@ -9,16 +9,22 @@
  */
 #pragma once
 
+#include <deque>
+#include <vector>
+
 #include <folly/IntrusiveList.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/AsyncTransport.h>
 #include <folly/io/async/DelayedDestruction.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/Optional.h>
 
 #include "mcrouter/lib/CompressionCodecManager.h"
 #include "mcrouter/lib/debug/ConnectionFifo.h"
+#include "mcrouter/lib/fbi/cpp/ObjectPool.h"
 #include "mcrouter/lib/network/AsyncMcServerWorkerOptions.h"
+#include "mcrouter/lib/network/CompressionFilter.h"
 #include "mcrouter/lib/network/ServerMcParser.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
@@ -133,6 +139,14 @@ class McServerSession :
     return userCtxt_;
   }
 
+  /**
+   * Snapshot of the per-size-bucket compression benefit curve learned by
+   * this session. See CompressionFilter.
+   */
+  std::vector<CompressionFilter::SizeBucketStats> getCompressionStats() const {
+    return compressionFilter_.getSizeBucketStats();
+  }
+
   /**
    * Get the peer's socket address
    */
@@ -173,9 +187,25 @@ class McServerSession :
   // Pointer to current buffer. Updated by getReadBuffer()
   std::pair<void*, size_t> curBuffer_;
 
+  /**
+   * Per-session pool of MultiOpParent blocks, so multi-op pipelines reuse
+   * the same allocations instead of hitting the global heap once per batch.
+   * The session is event base-bound, so the non-thread-safe pool is fine.
+   * Must be declared before any member that can hold references to parents
+   * (write buffer queues, currentMultiop_), so it is destroyed after them.
+   */
+  ObjectPool<MultiOpParent> multiOpPool_;
+
   // All writes to be written at the end of the loop in a single batch.
   std::unique_ptr<WriteBufferIntrusiveList> pendingWrites_;
 
+  /**
+   * Replies over options_.largeReplyDeferBytes on out-of-order protocols.
+   * They skip the shared batch and go out one per loop iteration so that
+   * small replies completing in the meantime are written first.
+   */
+  std::unique_ptr<WriteBufferIntrusiveList> largePendingWrites_;
+
   /**
    * Queue of write buffers.
    * Only initialized after we know the protocol (see ensureWriteBufs())
@@ -220,10 +250,20 @@ class McServerSession :
   /* Reads are enabled iff pauseState_ == 0 */
   uint64_t pauseState_{0};
 
+  /**
+   * Request batching state (see AsyncMcServerWorkerOptions::requestBatchSize).
+   * inRequestBatch_ is true while requests parsed from the current read
+   * event are being dispatched; batchDispatched_ counts dispatches in the
+   * current batch so oversized read buffers are split into multiple batches.
+   */
+  bool inRequestBatch_{false};
+  size_t batchDispatched_{0};
+
   // Compression
   const CompressionCodecMap* compressionCodecMap_{nullptr};
   CodecIdRange lastSupportedCodecsRange_{0, 0};
   CompressionCodec* lastCodec_{nullptr};
+  CompressionFilter compressionFilter_;
 
   ServerMcParser<McServerSession> parser_;
 
@@ -234,7 +274,13 @@ class McServerSession :
      Out of order replies are stalled in the blockedReplies_ queue. */
   uint64_t headReqid_{0}; /**< Id of next unblocked reply */
   uint64_t tailReqid_{0}; /**< Id to assign to next request */
-  std::unordered_map<uint64_t, std::unique_ptr<WriteBuffer>> blockedReplies_;
+  /* Request ids are dense, so stalled replies live in a deque indexed by
+     distance from the head: slot i holds the reply for headReqid_ + 1 + i.
+     An unset Optional means the reply hasn't arrived yet; a set Optional
+     holding nullptr is a completed noreply transaction (e.g. a multi-op
+     miss) that produces no output. Draining a blocked multi-op batch is
+     then a single sequential pass instead of a hash lookup per sub-reply. */
+  std::deque<folly::Optional<std::unique_ptr<WriteBuffer>>> blockedReplies_;
 
   /* If non-null, a multi-op operation is being parsed.*/
   std::shared_ptr<MultiOpParent> currentMultiop_;
@@ -272,6 +318,12 @@ class McServerSession :
 
   void reply(std::unique_ptr<WriteBuffer> wb, uint64_t reqid);
 
+  /**
+   * Called after each request is handed to onRequest_; closes out the
+   * current dispatch batch once it reaches the configured size.
+   */
+  void requestDispatched();
+
   /**
    * Called on mc_op_end or connection close to close out an in flight
    * multop request.
@@ -370,6 +422,7 @@ class McServerSession :
   McServerSession& operator=(const McServerSession&) = delete;
 
   friend class McServerRequestContext;
+  friend class MultiOpParent;
   friend class ServerMcParser<McServerSession>;
 };
 
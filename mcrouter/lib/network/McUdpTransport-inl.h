@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+namespace facebook { namespace memcache {
+
+template <class Request>
+folly::Optional<ReplyT<Request>> McUdpTransport::sendSync(
+    const Request& request, std::chrono::milliseconds timeout) {
+  if (!ensureSocket()) {
+    return folly::none;
+  }
+
+  AsciiSerializedRequest serializedRequest;
+  const struct iovec* iovs;
+  size_t niovs;
+  if (!serializedRequest.prepare(request, iovs, niovs)) {
+    return folly::none;
+  }
+  size_t requestSize = 0;
+  for (size_t i = 0; i < niovs; ++i) {
+    requestSize += iovs[i].iov_len;
+  }
+  if (requestSize > kMaxDatagramSize) {
+    return folly::none;
+  }
+
+  const uint16_t requestId = nextRequestId_++;
+  if (nextRequestId_ == 0) {
+    nextRequestId_ = 1;
+  }
+
+  PendingReply pending;
+  pendingReplies_.emplace(requestId, &pending);
+  if (!sendFrame(requestId, iovs, niovs, requestSize)) {
+    pendingReplies_.erase(requestId);
+    return folly::none;
+  }
+
+  const bool replied = pending.baton.timed_wait(timeout);
+  pendingReplies_.erase(requestId);
+  if (!replied || !pending.payload) {
+    return folly::none;
+  }
+
+  McClientAsciiParser parser;
+  parser.initializeReplyParser<Request>();
+  if (parser.consume(*pending.payload) !=
+      McClientAsciiParser::State::COMPLETE) {
+    return folly::none;
+  }
+  return parser.getReply<ReplyT<Request>>();
+}
+
+}}  // facebook::memcache
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "McUdpTransport.h"
+
+#include <cstring>
+
+#include <folly/Bits.h>
+#include <folly/Memory.h>
+
+namespace facebook { namespace memcache {
+
+McUdpTransport::McUdpTransport(folly::EventBase& eventBase,
+                               folly::SocketAddress destination)
+    : eventBase_(eventBase),
+      destination_(std::move(destination)) {
+}
+
+McUdpTransport::~McUdpTransport() {
+  if (socket_) {
+    socket_->pauseRead();
+    socket_->close();
+  }
+  // Unblock any fiber still waiting; it will fall back to TCP.
+  for (auto& it : pendingReplies_) {
+    it.second->baton.post();
+  }
+}
+
+bool McUdpTransport::ensureSocket() {
+  if (socket_) {
+    return true;
+  }
+  try {
+    auto socket = folly::make_unique<folly::AsyncUDPSocket>(&eventBase_);
+    socket->bind(folly::SocketAddress("0.0.0.0", 0));
+    socket->resumeRead(this);
+    socket_ = std::move(socket);
+    return true;
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Failed to create UDP socket for "
+               << destination_.describe() << ": " << e.what();
+    return false;
+  }
+}
+
+bool McUdpTransport::sendFrame(uint16_t requestId,
+                               const struct iovec* iov,
+                               size_t niov,
+                               size_t payloadSize) {
+  auto buf = folly::IOBuf::create(kFrameHeaderSize + payloadSize);
+  auto* data = buf->writableTail();
+  const uint16_t header[4] = {
+    folly::Endian::big<uint16_t>(requestId),
+    0,
+    folly::Endian::big<uint16_t>(1),
+    0
+  };
+  memcpy(data, header, sizeof(header));
+  size_t offset = sizeof(header);
+  for (size_t i = 0; i < niov; ++i) {
+    memcpy(data + offset, iov[i].iov_base, iov[i].iov_len);
+    offset += iov[i].iov_len;
+  }
+  buf->append(offset);
+
+  return socket_->write(destination_, buf) == static_cast<ssize_t>(offset);
+}
+
+void McUdpTransport::getReadBuffer(void** buf, size_t* len) noexcept {
+  *buf = readBuffer_;
+  *len = sizeof(readBuffer_);
+}
+
+void McUdpTransport::onDataAvailable(const folly::SocketAddress& /* addr */,
+                                     size_t len,
+                                     bool truncated) noexcept {
+  if (len < kFrameHeaderSize) {
+    return;
+  }
+  uint16_t requestId;
+  uint16_t totalDatagrams;
+  memcpy(&requestId, readBuffer_, sizeof(requestId));
+  memcpy(&totalDatagrams, readBuffer_ + 4, sizeof(totalDatagrams));
+  requestId = folly::Endian::big(requestId);
+  totalDatagrams = folly::Endian::big(totalDatagrams);
+
+  auto it = pendingReplies_.find(requestId);
+  if (it == pendingReplies_.end()) {
+    // Reply for a request that already timed out and fell back to TCP.
+    return;
+  }
+  auto* pending = it->second;
+  // Multi-datagram replies are not reassembled; leaving the payload
+  // null makes the waiting fiber retry over TCP.
+  if (!truncated && totalDatagrams == 1) {
+    pending->payload = folly::IOBuf::copyBuffer(
+        readBuffer_ + kFrameHeaderSize, len - kFrameHeaderSize);
+  }
+  pending->baton.post();
+}
+
+void McUdpTransport::onReadError(
+    const folly::AsyncSocketException& /* ex */) noexcept {
+}
+
+void McUdpTransport::onReadClosed() noexcept {
+}
+
+}}  // facebook::memcache
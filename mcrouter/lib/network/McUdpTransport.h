@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+
+#include <folly/fibers/Baton.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/network/AsciiSerialized.h"
+#include "mcrouter/lib/network/McAsciiParser.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * UDP fast path for small idempotent requests in ascii protocol
+ * (see ConnectionOptions::enableUdpForGets).
+ *
+ * Requests are framed with the classic memcached UDP header:
+ *
+ *   uint16_t requestId;        // big-endian; matches reply to request
+ *   uint16_t sequence;         // datagram index within the message
+ *   uint16_t totalDatagrams;
+ *   uint16_t reserved;         // always 0
+ *
+ * A request must fit a single datagram and multi-datagram replies are
+ * not reassembled: sendSync() returns none and the caller retries the
+ * request over TCP, which is also the answer to every other failure
+ * (lost datagram, socket error, oversized request).
+ *
+ * All methods must be called from the transport's EventBase thread;
+ * sendSync() blocks the calling fiber, and the read callback only runs
+ * while that fiber is suspended, so no synchronization is needed.
+ */
+class McUdpTransport : private folly::AsyncUDPSocket::ReadCallback {
+ public:
+  McUdpTransport(folly::EventBase& eventBase,
+                 folly::SocketAddress destination);
+  ~McUdpTransport() override;
+
+  /**
+   * Sends the request over UDP and waits for the reply on the calling
+   * fiber.
+   *
+   * @return the parsed reply, or none if the caller should retry the
+   *         request over TCP.
+   */
+  template <class Request>
+  folly::Optional<ReplyT<Request>> sendSync(
+      const Request& request, std::chrono::milliseconds timeout);
+
+ private:
+  struct PendingReply {
+    folly::fibers::Baton baton;
+    // Reply datagram without the frame header; nullptr on failure.
+    std::unique_ptr<folly::IOBuf> payload;
+  };
+
+  static constexpr size_t kFrameHeaderSize = 8;
+  // Conservative bound that keeps a frame within an ethernet MTU.
+  static constexpr size_t kMaxDatagramSize = 1400;
+
+  bool ensureSocket();
+  bool sendFrame(uint16_t requestId,
+                 const struct iovec* iov,
+                 size_t niov,
+                 size_t payloadSize);
+
+  // folly::AsyncUDPSocket::ReadCallback overrides.
+  void getReadBuffer(void** buf, size_t* len) noexcept override final;
+  void onDataAvailable(const folly::SocketAddress& addr,
+                       size_t len,
+                       bool truncated) noexcept override final;
+  void onReadError(const folly::AsyncSocketException& ex)
+      noexcept override final;
+  void onReadClosed() noexcept override final;
+
+  folly::EventBase& eventBase_;
+  const folly::SocketAddress destination_;
+  std::unique_ptr<folly::AsyncUDPSocket> socket_;
+  uint16_t nextRequestId_{1};
+  std::unordered_map<uint16_t, PendingReply*> pendingReplies_;
+  char readBuffer_[kMaxDatagramSize + kFrameHeaderSize];
+};
+
+}}  // facebook::memcache
+
+#include "McUdpTransport-inl.h"
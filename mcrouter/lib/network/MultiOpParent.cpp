@@ -9,6 +9,8 @@
  */
 #include "MultiOpParent.h"
 
+#include "mcrouter/lib/network/McServerSession.h"
+
 namespace facebook { namespace memcache {
 
 MultiOpParent::MultiOpParent(McServerSession& session, uint64_t blockReqid)
@@ -41,6 +43,25 @@ bool MultiOpParent::reply(mc_res_t result,
   return stolen;
 }
 
+void MultiOpParent::recordReplyBytes(size_t replyBytes) {
+  const size_t threshold = session_.options_.multiOpStreamBytes;
+  if (threshold == 0 || blockReleased_ || error_) {
+    return;
+  }
+  bufferedReplyBytes_ += replyBytes;
+  if (bufferedReplyBytes_ < threshold) {
+    return;
+  }
+  /* Unblock the head of line so the contiguous prefix of completed
+     sub-replies streams out now; later sub-replies keep flushing in
+     arrival order as they become contiguous. From this point on an
+     error can no longer collapse the whole reply into a single error
+     line; the end context appends it after the streamed values. */
+  blockReleased_ = true;
+  McServerRequestContext::reply(
+      std::move(block_), TypedThriftReply<cpp2::McGetReply>());
+}
+
 void MultiOpParent::recordEnd(uint64_t reqid) {
   end_ = McServerRequestContext(session_, mc_op_end, reqid);
   if (!waiting_) {
@@ -53,10 +74,12 @@ void MultiOpParent::release() {
     reply_.emplace(mc_res_found);
   }
   McServerRequestContext::reply(std::move(*end_), std::move(*reply_));
-  // It doesn't really matter what reply type we use for the multi-op
-  // blocking context
-  McServerRequestContext::reply(
-      std::move(block_), TypedThriftReply<cpp2::McGetReply>());
+  if (!blockReleased_) {
+    // It doesn't really matter what reply type we use for the multi-op
+    // blocking context
+    McServerRequestContext::reply(
+        std::move(block_), TypedThriftReply<cpp2::McGetReply>());
+  }
 }
 
 }}  // facebook::memcache
@@ -74,6 +74,15 @@ class MultiOpParent {
    */
   void recordEnd(uint64_t reqid);
 
+  /**
+   * Notify that a sub-reply of the given serialized size is about to be
+   * handed to the session. With multiOpStreamBytes set, once enough
+   * bytes have accumulated the parent releases its block context early,
+   * so the contiguous completed prefix streams to the socket instead of
+   * buffering until END (see AsyncMcServerWorkerOptions).
+   */
+  void recordReplyBytes(size_t replyBytes);
+
   /**
    * @return true if an error was observed
    */
@@ -83,6 +92,8 @@ class MultiOpParent {
 
  private:
   size_t waiting_{0};
+  size_t bufferedReplyBytes_{0};
+  bool blockReleased_{false};
   folly::Optional<TypedThriftReply<cpp2::McGetReply>> reply_;
   bool error_{false};
 
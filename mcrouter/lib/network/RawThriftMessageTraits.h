@@ -244,6 +244,15 @@ struct RequestTraits<cpp2::McFlushAllRequest> {
   static constexpr bool hasFlags = false;
 };
 
+template <>
+struct RequestTraits<cpp2::McBulkDeleteRequest> {
+  static constexpr const char* name = "bulk-delete";
+  static constexpr bool hasKey = true;
+  static constexpr bool hasExptime = false;
+  static constexpr bool hasValue = false;
+  static constexpr bool hasFlags = false;
+};
+
 /**
  * Reply traits
  */
@@ -379,4 +388,10 @@ struct ReplyTraits<cpp2::McFlushAllReply> {
   static constexpr bool hasFlags = false;
 };
 
+template <>
+struct ReplyTraits<cpp2::McBulkDeleteReply> {
+  static constexpr bool hasValue = false;
+  static constexpr bool hasFlags = false;
+};
+
 }} // facebook::memcache
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IntrusiveList.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Collects requests that are blocked waiting for network replies so that
+ * they can all be aborted together, e.g. when a sibling fanout request
+ * has already produced the winning reply.
+ *
+ * Strictly single-threaded: all operations must happen on the thread that
+ * owns the waiting fibers. Waiters unlink themselves automatically on
+ * destruction, so it's safe for the aborter to outlive them (and vice
+ * versa, as long as abortAll()/remove() aren't called afterwards).
+ */
+class RequestAborter {
+ public:
+  class Waiter {
+   public:
+    /**
+     * Tear the request down if it can still be aborted safely
+     * (see McClientRequestContextBase::abortRequest).
+     */
+    virtual void abortRequest() = 0;
+
+   protected:
+    virtual ~Waiter() = default;
+
+   private:
+    folly::SafeIntrusiveListHook aborterHook_;
+
+    friend class RequestAborter;
+  };
+
+  /**
+   * Abort every currently registered waiter. Requests registered after
+   * this call won't be sent at all: callers should check aborted() first.
+   */
+  void abortAll() {
+    aborted_ = true;
+    while (!waiters_.empty()) {
+      auto& waiter = waiters_.front();
+      waiters_.pop_front();
+      waiter.abortRequest();
+    }
+  }
+
+  bool aborted() const {
+    return aborted_;
+  }
+
+  void add(Waiter& waiter) {
+    waiters_.push_back(waiter);
+  }
+
+  void remove(Waiter& waiter) {
+    if (waiter.aborterHook_.is_linked()) {
+      waiter.aborterHook_.unlink();
+    }
+  }
+
+ private:
+  folly::IntrusiveList<Waiter, &Waiter::aborterHook_> waiters_;
+  bool aborted_{false};
+};
+
+}}  // facebook::memcache
@@ -19,12 +19,15 @@ ServerMcParser<Callback>::ServerMcParser(
     Callback& cb,
     size_t minBufferSize,
     size_t maxBufferSize,
+    const bool useJemallocNodumpAllocator,
+    const bool useHugePageBuffers,
     ConnectionFifo* debugFifo)
     : parser_(
           *this,
           minBufferSize,
           maxBufferSize,
-          /* useJemallocNodumpAllocator */ false,
+          useJemallocNodumpAllocator,
+          useHugePageBuffers,
           debugFifo),
       asciiParser_(*this),
       callback_(cb),
@@ -173,9 +176,29 @@ void ServerMcParser<Callback>::writeToPipe(const Request& req) {
   const struct iovec* iov;
   size_t iovLen;
   debugSerializedRequest.prepare(req, iov, iovLen);
+  // The serializer references the request's key directly, so the key's
+  // position within the captured data is known without re-parsing it.
+  uint32_t keyOffset = 0;
+  uint16_t keySize = 0;
+  const auto key = req.fullKey();
+  if (!key.empty()) {
+    size_t offset = 0;
+    for (size_t i = 0; i < iovLen; ++i) {
+      if (iov[i].iov_base == key.begin() && iov[i].iov_len == key.size()) {
+        keyOffset = static_cast<uint32_t>(offset);
+        keySize = static_cast<uint16_t>(key.size());
+        break;
+      }
+      offset += iov[i].iov_len;
+    }
+  }
   debugFifo_->startMessage(
       MessageDirection::Received,
-      IdFromType<typename Request::rawType, TRequestList>::value);
+      IdFromType<typename Request::rawType, TRequestList>::value,
+      mc_ascii_protocol,
+      0 /* reqId */,
+      keyOffset,
+      keySize);
   debugFifo_->writeData(iov, iovLen);
 }
 
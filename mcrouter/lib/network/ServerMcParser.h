@@ -24,6 +24,8 @@ class ServerMcParser : private McParser::ParserCallback {
       Callback& cb,
       size_t minBufferSize,
       size_t maxBufferSize,
+      const bool useJemallocNodumpAllocator = false,
+      const bool useHugePageBuffers = false,
       ConnectionFifo* debugFifo = nullptr);
 
   ~ServerMcParser();
@@ -9,9 +9,14 @@
  */
 #include "ThreadLocalSSLContextProvider.h"
 
+#include <chrono>
+#include <string>
 #include <unordered_map>
 
+#include <openssl/ssl.h>
+
 #include <folly/io/async/SSLContext.h>
+#include <folly/SharedMutex.h>
 #include <wangle/ssl/TLSTicketKeyManager.h>
 
 #include "mcrouter/lib/fbi/cpp/LogFailure.h"
@@ -25,6 +30,111 @@ namespace {
 /* Sessions are valid for upto 30 mins */
 constexpr size_t kSessionLifeTime = 1800;
 
+/* Bound on the process-wide session cache size */
+constexpr size_t kMaxSessions = 65536;
+
+/**
+ * Process-wide cache of DER-serialized TLS sessions, shared by the
+ * thread-local server contexts.  OpenSSL's internal session cache is per
+ * SSL_CTX (i.e. per thread here), so a client that reconnects to a
+ * different worker thread would always pay a full handshake; routing all
+ * contexts through this external cache makes session-id resumption work
+ * regardless of which thread accepts the reconnect.  (Ticket resumption
+ * already works cross-thread, since every thread's TLSTicketKeyManager is
+ * seeded identically.)
+ *
+ * Sessions are stored serialized and deserialized on lookup, so no
+ * SSL_SESSION object is ever shared between threads.  Reads take a shared
+ * lock; writes happen once per full handshake, which is exactly the
+ * expensive path this cache exists to avoid.
+ */
+class SharedSessionCache {
+ public:
+  void store(SSL_SESSION* session) {
+    unsigned int idLen;
+    const unsigned char* id = SSL_SESSION_get_id(session, &idLen);
+    int len = i2d_SSL_SESSION(session, nullptr);
+    if (idLen == 0 || len <= 0) {
+      return;
+    }
+    std::string data(len, '\0');
+    auto ptr = reinterpret_cast<unsigned char*>(&data[0]);
+    i2d_SSL_SESSION(session, &ptr);
+
+    Entry entry;
+    entry.serialized = std::move(data);
+    entry.addedTime = std::chrono::steady_clock::now();
+
+    folly::SharedMutex::WriteHolder guard(mutex_);
+    if (sessions_.size() >= kMaxSessions) {
+      /* Hash order is effectively random, so this evicts an arbitrary
+         entry; good enough to bound memory without an LRU list. */
+      sessions_.erase(sessions_.begin());
+    }
+    sessions_[std::string(reinterpret_cast<const char*>(id), idLen)] =
+        std::move(entry);
+  }
+
+  SSL_SESSION* lookup(const unsigned char* id, int idLen) {
+    std::string serialized;
+    {
+      folly::SharedMutex::ReadHolder guard(mutex_);
+      auto it = sessions_.find(
+          std::string(reinterpret_cast<const char*>(id), idLen));
+      if (it == sessions_.end()) {
+        return nullptr;
+      }
+      auto age = std::chrono::steady_clock::now() - it->second.addedTime;
+      if (age > std::chrono::seconds(kSessionLifeTime)) {
+        return nullptr;
+      }
+      serialized = it->second.serialized;
+    }
+    auto ptr = reinterpret_cast<const unsigned char*>(serialized.data());
+    return d2i_SSL_SESSION(nullptr, &ptr, serialized.size());
+  }
+
+  void remove(SSL_SESSION* session) {
+    unsigned int idLen;
+    const unsigned char* id = SSL_SESSION_get_id(session, &idLen);
+    folly::SharedMutex::WriteHolder guard(mutex_);
+    sessions_.erase(std::string(reinterpret_cast<const char*>(id), idLen));
+  }
+
+ private:
+  struct Entry {
+    std::string serialized;
+    std::chrono::time_point<std::chrono::steady_clock> addedTime;
+  };
+
+  folly::SharedMutex mutex_;
+  std::unordered_map<std::string, Entry> sessions_;
+};
+
+SharedSessionCache& sharedSessionCache() {
+  static SharedSessionCache cache;
+  return cache;
+}
+
+int sharedSessionNewCallback(SSL* ssl, SSL_SESSION* session) {
+  sharedSessionCache().store(session);
+  /* We did not take ownership of the session */
+  return 0;
+}
+
+SSL_SESSION* sharedSessionGetCallback(SSL* ssl,
+                                      unsigned char* id,
+                                      int idLen,
+                                      int* copy) {
+  /* The deserialized session is handed over to OpenSSL, no copy needed */
+  *copy = 0;
+  return sharedSessionCache().lookup(id, idLen);
+}
+
+void sharedSessionRemoveCallback(SSL_CTX* ctx, SSL_SESSION* session) {
+  sharedSessionCache().remove(session);
+}
+
 struct CertPaths {
   folly::StringPiece pemCertPath;
   folly::StringPiece pemKeyPath;
@@ -180,6 +290,15 @@ std::shared_ptr<SSLContext> getSSLContext(folly::StringPiece pemCertPath,
       contextInfo.context->setSessionCacheContext("async-server");
       SSL_CTX_set_timeout(contextInfo.context->getSSLCtx(), kSessionLifeTime);
 
+      /* Bypass the per-SSL_CTX internal cache in favor of the process-wide
+         one, so resumption survives reconnects landing on other threads. */
+      auto sslCtx = contextInfo.context->getSSLCtx();
+      SSL_CTX_set_session_cache_mode(
+          sslCtx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+      SSL_CTX_sess_set_new_cb(sslCtx, sharedSessionNewCallback);
+      SSL_CTX_sess_set_get_cb(sslCtx, sharedSessionGetCallback);
+      SSL_CTX_sess_set_remove_cb(sslCtx, sharedSessionRemoveCallback);
+
       #ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB
       auto mgr = folly::make_unique<wangle::TLSTicketKeyManager>(
           contextInfo.context.get(), nullptr);
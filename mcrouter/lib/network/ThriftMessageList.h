@@ -48,7 +48,11 @@ using RequestReplyPairs = List<
     Pair<TypedMsg<41, cpp2::McFlushReRequest>,
          TypedMsg<42, cpp2::McFlushReReply>>,
     Pair<TypedMsg<43, cpp2::McFlushAllRequest>,
-         TypedMsg<44, cpp2::McFlushAllReply>>>;
+         TypedMsg<44, cpp2::McFlushAllReply>>,
+    /* Caret-only (no mc_op mapping): the proxy splits a bulk delete into
+       per-key deletes before routing, so route handles never see it. */
+    Pair<TypedMsg<45, cpp2::McBulkDeleteRequest>,
+         TypedMsg<46, cpp2::McBulkDeleteReply>>>;
 
 using TRequestList = PairListFirstT<RequestReplyPairs>;
 using TReplyList = PairListSecondT<RequestReplyPairs>;
@@ -147,4 +151,25 @@ using ThriftRequestList = MapT<TypedThriftRequest, Values<TRequestList>>;
 template <class T>
 using TRequestListContains = ListContains<ThriftRequestList, T>;
 
+/**
+ * Requests the server or proxy fully answers before routing: admin and
+ * connection-level commands (handled by the server session or rejected
+ * in precheckRequest) and bulk delete, which the proxy splits into
+ * per-key deletes.  Route handles are instantiated against this list
+ * only, which keeps every handle's virtual dispatch chain (route /
+ * traverse / routeBatch per request type) to the requests that can
+ * actually reach it; a pruned request sent through route handles gets
+ * mc_res_local_error instead.
+ */
+using RoutedRequestList = RemoveT<
+    ThriftRequestList,
+    TypedThriftRequest<cpp2::McShutdownRequest>,
+    TypedThriftRequest<cpp2::McQuitRequest>,
+    TypedThriftRequest<cpp2::McExecRequest>,
+    TypedThriftRequest<cpp2::McFlushReRequest>,
+    TypedThriftRequest<cpp2::McBulkDeleteRequest>>;
+
+template <class T>
+using RoutedRequestListContains = ListContains<RoutedRequestList, T>;
+
 }} // facebook::memcache
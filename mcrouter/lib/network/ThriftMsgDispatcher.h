@@ -11,6 +11,7 @@
 
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/Range.h>
 #include <thrift/lib/cpp2/protocol/CompactProtocol.h>
 
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
@@ -31,6 +32,13 @@ class TypedThriftReply;
 template <class ThriftStruct>
 class TypedThriftRequest;
 
+/**
+ * Records the compression-filter bucket of the request key on the given
+ * context. Defined in McServerRequestContext.cpp; declared here because
+ * this header only sees a forward declaration of the context.
+ */
+void setCompressionKey(McServerRequestContext& ctx, folly::StringPiece key);
+
 /*
  * Takes a Thrift struct and serializes it to an IOBuf
  * @param thriftStruct: The Typed Thrift Struct
@@ -86,6 +94,7 @@ class ThriftMsgDispatcher {
   template <class M>
   void onTypedMessage(TypedThriftRequest<M>&& req,
                       McServerRequestContext&& ctx) {
+    setCompressionKey(ctx, req.fullKey());
     static_cast<Proc&>(*this).onRequest(std::move(ctx), std::move(req));
   }
 
@@ -100,6 +109,7 @@ class ThriftMsgDispatcher {
     reader.setInput(cur);
     TypedThriftRequest<M> req;
     req.setTraceId(headerInfo.traceId);
+    req.setDeadlineMs(headerInfo.deadlineMs);
     req.read(&reader);
     static_cast<Proc&>(me)
         .onTypedMessage(std::move(req), std::forward<Args>(args)...);
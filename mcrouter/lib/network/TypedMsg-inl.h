@@ -33,8 +33,9 @@ struct CallDispatcherImplExpanded;
 /* Contains a single array that maps Ids to processMsg calls */
 template <int... Ids, class... Ms, class Proc, class... Args>
 struct CallDispatcherImplExpanded<List<TypedMsg<Ids, Ms>...>, Proc, Args...> {
+  static constexpr size_t size_ = Max<Ids...>::value + 1;
   static constexpr
-  DispatchFunc<Proc, Args...> array_[Max<Ids...>::value + 1] = {
+  DispatchFunc<Proc, Args...> array_[size_] = {
     DispatchImpl<Ms, Proc, Args...>::func...
   };
 };
@@ -43,7 +44,8 @@ struct CallDispatcherImplExpanded<List<TypedMsg<Ids, Ms>...>, Proc, Args...> {
 template <int... Ids, class... Ms, class Proc, class... Args>
 constexpr DispatchFunc<Proc, Args...>
 CallDispatcherImplExpanded<List<TypedMsg<Ids, Ms>...>, Proc, Args...>
-::array_[Max<Ids...>::value + 1];
+::array_[CallDispatcherImplExpanded<
+    List<TypedMsg<Ids, Ms>...>, Proc, Args...>::size_];
 
 /* Input: unique Ids >= 0.
    Sort KVList, expand to fill 0s, call ImplExpanded */
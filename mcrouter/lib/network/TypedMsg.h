@@ -12,6 +12,8 @@
 #include <cstddef>
 #include <utility>
 
+#include <folly/Likely.h>
+
 #include "mcrouter/lib/fbi/cpp/TypeList.h"
 
 namespace facebook { namespace memcache {
@@ -119,8 +121,15 @@ class CallDispatcher {
  public:
   /**
    * @return true iff id is present in TMList
+   *
+   * Constant time: a single bounds check against the compile-time table
+   * size followed by an indexed call. The id typically comes straight off
+   * the wire, so the bounds check is load-bearing, not just defensive.
    */
   bool dispatch(size_t id, Proc& proc, Args... args) {
+    if (UNLIKELY(id >= impl_.size_)) {
+      return false;
+    }
     auto& f = impl_.array_[id];
     if (f == nullptr) {
       return false;
@@ -132,11 +132,33 @@ class TypedThriftReply : public TypedThriftMessage<M> {
   template <typename InputIterator>
   static InputIterator reduce(InputIterator begin, InputIterator end);
 
+  /* Mutable access to the raw struct invalidates the captured wire body
+     (see wireBody() below); the const accessors stay cheap. */
+  using TypedThriftMessage<M>::operator*;
+  using TypedThriftMessage<M>::operator->;
+  using TypedThriftMessage<M>::get;
+
+  M& operator*() {
+    invalidateWireBody();
+    return this->raw_;
+  }
+
+  M* operator->() {
+    invalidateWireBody();
+    return &this->raw_;
+  }
+
+  M* get() {
+    invalidateWireBody();
+    return &this->raw_;
+  }
+
   mc_res_t result() const noexcept {
     return static_cast<mc_res_t>(this->raw_.get_result());
   }
 
   void setResult(mc_res_t res) noexcept {
+    invalidateWireBody();
     this->raw_.set_result(res);
   }
 
@@ -190,6 +212,7 @@ class TypedThriftReply : public TypedThriftMessage<M> {
   }
 
   void setAppSpecificErrorCode(uint16_t c) {
+    invalidateWireBody();
     this->raw_.set_appSpecificErrorCode(c);
   }
 
@@ -253,13 +276,38 @@ class TypedThriftReply : public TypedThriftMessage<M> {
     return isStoredResult(result());
   }
 
+  /**
+   * Body of the caret frame this reply was parsed from, exactly as it
+   * arrived from the destination, sharing the connection read buffer.
+   * Captured by the client parser only when reply passthrough is enabled
+   * (see the reply-passthrough option) and the frame was not compressed.
+   * If still present when the reply reaches a caret client session, the
+   * server serializer appends these bytes and rebuilds only the frame
+   * header (which carries the client's reqid) instead of re-running the
+   * thrift writer.  Any mutable access to the underlying struct drops it,
+   * so a stale body can never be sent.
+   */
+  const folly::IOBuf* wireBody() const noexcept {
+    return wireBody_.get();
+  }
+
+  void setWireBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+    wireBody_ = std::move(body);
+  }
+
   template <class Protocol>
   uint32_t read(Protocol* iprot) {
+    invalidateWireBody();
     return this->raw_.read(iprot);
   }
 
  private:
   std::shared_ptr<const AccessPoint> destination_;
+  std::unique_ptr<folly::IOBuf> wireBody_;
+
+  void invalidateWireBody() noexcept {
+    wireBody_.reset();
+  }
 
   template <class TMList, class Derived, class... Args>
   friend class ThriftMsgDispatcher;
@@ -278,6 +326,35 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
     return *this;
   }
 
+  /**
+   * Like clone(), but never deep-copies payloads: the copy shares the
+   * underlying key/value buffers with the original (IOBuf copies are
+   * refcounted) and drops fbtrace state instead of deep-copying it.
+   * Use for auxiliary copies, e.g. shadow traffic, where the copy's key
+   * and value are treated as immutable.
+   */
+  TypedThriftRequest cloneShared() const {
+    TypedThriftRequest copy;
+    copy.raw_ = this->raw_;
+    static_cast<Keys&>(copy) = static_cast<const Keys&>(*this);
+    copy.traceId_ = traceId_;
+    copy.deadlineMs_ = deadlineMs_;
+    return copy;
+  }
+
+  /**
+   * Clone overlaying a new key, for key-rewriting routes (ModifyKeyRoute,
+   * ShardSplitRoute &c).  Same as clone() followed by setKey(), except
+   * the new key buffer is adopted directly instead of being copied a
+   * second time.  Payload buffers are shared with the original as usual
+   * (IOBuf copies are refcounted).
+   */
+  TypedThriftRequest cloneWithKey(folly::IOBuf k) const {
+    TypedThriftRequest copy(*this);
+    copy.setKey(std::move(k));
+    return copy;
+  }
+
   TypedThriftRequest& operator=(const TypedThriftRequest& other) = delete;
 
   TypedThriftRequest(TypedThriftRequest&& other) noexcept = default;
@@ -307,17 +384,20 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
   void setKey(folly::StringPiece k) {
     this->raw_.set_key(folly::IOBuf(folly::IOBuf::COPY_BUFFER, k));
     Keys::update(getRange(this->raw_.key));
+    invalidateSerializedBodyCache();
   }
 
   void setKey(folly::IOBuf k) {
     this->raw_.set_key(std::move(k));
     this->raw_.key.coalesce();
     Keys::update(getRange(this->raw_.key));
+    invalidateSerializedBodyCache();
   }
 
   void stripRoutingPrefix() {
     this->raw_.key.trimStart(routingPrefix().size());
     Keys::clearRoutingPrefix();
+    invalidateSerializedBodyCache();
   }
 
   folly::StringPiece keyWithoutRoute() const {
@@ -336,6 +416,10 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
     return Keys::routingKeyHash();
   }
 
+  uint64_t routingKeyFurcSeed() const {
+    return Keys::routingKeyFurcSeed();
+  }
+
   bool hasHashStop() const {
     return Keys::routingKey().size() != Keys::keyWithoutRoute().size();
   }
@@ -346,6 +430,7 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
 
   void setFlags(uint64_t f) {
     detail::setFlags(*this, f);
+    invalidateSerializedBodyCache();
   }
 
   int32_t exptime() const {
@@ -354,6 +439,7 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
 
   void setExptime(int32_t expt) {
     detail::setExptime(*this, expt);
+    invalidateSerializedBodyCache();
   }
 
   folly::IOBuf* valuePtrUnsafe() {
@@ -367,10 +453,12 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
 
   void setValue(folly::IOBuf valueData) {
     detail::setValue(*this, std::move(valueData));
+    invalidateSerializedBodyCache();
   }
 
   void setValue(folly::StringPiece str) {
     detail::setValue(*this, folly::IOBuf(folly::IOBuf::COPY_BUFFER, str));
+    invalidateSerializedBodyCache();
   }
 
   // Treat 'value' IOBuf as mutable.
@@ -401,10 +489,49 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
     traceId_ = id;
   }
 
+  /**
+   * Remaining time budget (ms) the sender has for this request, carried
+   * on the wire by caret; 0 means no deadline was propagated.
+   */
+  uint64_t deadlineMs() const {
+    return deadlineMs_;
+  }
+
+  void setDeadlineMs(uint64_t ms) {
+    deadlineMs_ = ms;
+  }
+
+  /**
+   * Memoized caret body for requests sent to several destinations (shadow,
+   * all-sync, failover retries).  The serialized body is
+   * destination-independent - only the header carries reqid, trace and
+   * deadline - so once the same object is serialized for a second
+   * destination, the serializer keeps one refcounted copy of the bytes
+   * here and every later destination appends it instead of re-running the
+   * thrift writer.  Null until then; any mutation of the struct drops it.
+   */
+  const folly::IOBuf* serializedBodyCache() const {
+    return serializedBodyCache_.get();
+  }
+
+  void setSerializedBodyCache(std::unique_ptr<folly::IOBuf> body) const {
+    serializedBodyCache_ = std::move(body);
+  }
+
+  /**
+   * Counts serializations of this object, so the serializer can build the
+   * body cache only from the second destination on and single-shot
+   * requests never pay for it.
+   */
+  uint32_t noteSerialization() const {
+    return ++serializationCount_;
+  }
+
   template <class Protocol>
   uint32_t read(Protocol* iprot) {
     const auto nread = this->raw_.read(iprot);
     Keys::update(getRange(this->raw_.key));
+    invalidateSerializedBodyCache();
     return nread;
   }
 
@@ -430,6 +557,17 @@ class TypedThriftRequest : public TypedThriftMessage<M>,
   McFbtraceRef fbtraceInfo_;
 #endif
   uint64_t traceId_{0};
+  uint64_t deadlineMs_{0};
+
+  // Mutable: a memoization detail of serialization, which only sees
+  // const references.  Intentionally not copied by the copy constructor.
+  mutable std::unique_ptr<folly::IOBuf> serializedBodyCache_;
+  mutable uint32_t serializationCount_{0};
+
+  void invalidateSerializedBodyCache() {
+    serializedBodyCache_.reset();
+    serializationCount_ = 0;
+  }
 
   TypedThriftRequest(const TypedThriftRequest& other)
     : TypedThriftMessage<M>(other),
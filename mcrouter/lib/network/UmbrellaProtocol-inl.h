@@ -9,6 +9,8 @@
  */
 #include <arpa/inet.h>
 
+#include <array>
+
 #include <folly/Bits.h>
 
 #include "mcrouter/lib/fbi/cpp/TypeList.h"
@@ -317,30 +319,6 @@ uint32_t const kUmbrellaOpToMc[UM_NOPS] = {
 #include "mcrouter/lib/mc/umbrella_conv.h" /* nolint */
 };
 
-template <class Tags>
-struct FieldPolicyHandler;
-
-template <class... Tags>
-struct FieldPolicyHandler<List<Tags...>> {
-  template <class Op, class Message, class Tag>
-  static typename std::enable_if<Has<Tag, Tags...>::value, void>::type
-  parseField(Op, Tag, Message& message, const folly::IOBuf& source,
-             const uint8_t* body, const um_elist_entry_t& entry) {
-    parseFieldImpl(Op(), Tag(), message, source, body, entry);
-  }
-
-  template <class Op, class Message, class Tag>
-  static typename std::enable_if<!Has<Tag, Tags...>::value, void>::type
-  parseField(Op, Tag, Message& message, const folly::IOBuf& source,
-             const uint8_t* body, const um_elist_entry_t& entry) {
-    // If we're parsing a field that's not in the tags list, something is wrong
-    LOG(ERROR)
-      << "Parsing unexpected field with tag type " << typeid(Tag).name()
-      << " for operation " << typeid(Op).name()
-      << " and message " << typeid(Message).name();
-  }
-};
-
 template <class Op, class Message>
 void parseFieldImpl(Op, CasTag, Message& message, const folly::IOBuf& source,
                     const uint8_t* body, const um_elist_entry_t& entry) {
@@ -418,9 +396,12 @@ void parseValueFieldImpl(Op, Message& message, const folly::IOBuf& source,
   // TODO(jmswen) Consider migrating error messages from 'value' field to
   // 'message' field for TypedThriftReply
   folly::IOBuf tmp;
-  if (!cloneInto(tmp, source,
-                 body + folly::Endian::big((uint32_t)entry.data.str.offset),
-                 folly::Endian::big((uint32_t)entry.data.str.len) - 1)) {
+  /* Copy small values out of the read buffer rather than pinning it;
+     the common reply value is a few dozen bytes, and a shared read buffer
+     would have to be reallocated for the next read. */
+  if (!copyOrCloneInto(tmp, source,
+                       body + folly::Endian::big((uint32_t)entry.data.str.offset),
+                       folly::Endian::big((uint32_t)entry.data.str.len) - 1)) {
     throw std::runtime_error("Value: invalid offset/length");
   }
   message.setValue(std::move(tmp));
@@ -473,6 +454,83 @@ inline void parseFieldImpl(McOperation<mc_op_metaget>, ValueTag,
   }
 }
 
+/**
+ * A parse kernel consumes one wire entry into the message being built.
+ */
+template <class Message>
+using ParseKernel = void (*)(Message& message, const folly::IOBuf& source,
+                             const uint8_t* body,
+                             const um_elist_entry_t& entry);
+
+/* Umbrella tags are single bits and must fit in a uint16_t, so every
+   known tag has a bit position below this. */
+constexpr size_t kNumTagBits = 15;
+
+template <class Op, class Message, class Tag>
+void parseFieldKernel(Message& message, const folly::IOBuf& source,
+                      const uint8_t* body, const um_elist_entry_t& entry) {
+  parseFieldImpl(Op(), Tag(), message, source, body, entry);
+}
+
+template <class Op, class Message, class Tag>
+void unexpectedFieldKernel(Message&, const folly::IOBuf&, const uint8_t*,
+                           const um_elist_entry_t&) {
+  // If we're parsing a field that's not in the tags list, something is wrong
+  LOG(ERROR)
+    << "Parsing unexpected field with tag type " << typeid(Tag).name()
+    << " for operation " << typeid(Op).name()
+    << " and message " << typeid(Message).name();
+}
+
+/**
+ * Per-(operation, message) table of parse kernels, indexed by tag bit
+ * position and built at compile time from the operation's TagSet.  Tags
+ * handled before field dispatch (op, reqid, fbtrace) and tags we never
+ * expect get a null kernel and are skipped; known field tags missing
+ * from the TagSet get a logging kernel, matching the old switch.
+ */
+template <class Tags>
+struct ParseTable;
+
+template <class... Tags>
+struct ParseTable<List<Tags...>> {
+  template <class Op, class Message, class Tag>
+  static constexpr
+  typename std::enable_if<Has<Tag, Tags...>::value,
+                          ParseKernel<Message>>::type kernel() {
+    return &parseFieldKernel<Op, Message, Tag>;
+  }
+
+  template <class Op, class Message, class Tag>
+  static constexpr
+  typename std::enable_if<!Has<Tag, Tags...>::value,
+                          ParseKernel<Message>>::type kernel() {
+    return &unexpectedFieldKernel<Op, Message, Tag>;
+  }
+
+  template <class Op, class Message>
+  static const std::array<ParseKernel<Message>, kNumTagBits>& kernels() {
+    static constexpr std::array<ParseKernel<Message>, kNumTagBits> kTable{{
+      /* msg_op       0x0001 */ nullptr,  // parsed before field dispatch
+      /* msg_result   0x0002 */ kernel<Op, Message, ResultTag>(),
+      /* msg_reqid    0x0004 */ nullptr,  // parsed before field dispatch
+      /* msg_err_code 0x0008 */ kernel<Op, Message, ErrCodeTag>(),
+      /* msg_flags    0x0010 */ kernel<Op, Message, FlagsTag>(),
+      /* msg_exptime  0x0020 */ kernel<Op, Message, ExptimeTag>(),
+      /* msg_number   0x0040 */ kernel<Op, Message, NumberTag>(),
+      /*              0x0080 */ nullptr,  // unassigned
+      /* msg_delta    0x0100 */ kernel<Op, Message, DeltaTag>(),
+      /* msg_lease_id 0x0200 */ kernel<Op, Message, LeaseTokenTag>(),
+      /* msg_cas      0x0400 */ kernel<Op, Message, CasTag>(),
+      /* msg_fbtrace  0x0800 */ nullptr,  // parsed before field dispatch
+      /* msg_stats    0x1000 */ nullptr,  // we never expect stats
+      /* msg_key      0x2000 */ kernel<Op, Message, KeyTag>(),
+      /* msg_value    0x4000 */ kernel<Op, Message, ValueTag>(),
+    }};
+    return kTable;
+  }
+};
+
 template <class Message, class Op>
 void umbrellaParseMessage(Message& message, Op, const folly::IOBuf& source,
                           const uint8_t* header, size_t nheader,
@@ -483,61 +541,19 @@ void umbrellaParseMessage(Message& message, Op, const folly::IOBuf& source,
       != header + nheader) {
     throw std::runtime_error("Invalid number of entries");
   }
-  using Handler = FieldPolicyHandler<typename TagSet<Op, Message>::Tags>;
+  using Table = ParseTable<typename TagSet<Op, Message>::Tags>;
+  const auto& kernels = Table::template kernels<Op, Message>();
   for (size_t i = 0; i < nentries; ++i) {
     // Process entries in the reverse order, since it's easier to handle
     // double fields that way.
     auto& entry = msg->entries[nentries - i - 1];
-    size_t tag = folly::Endian::big((uint16_t)entry.tag);
-    switch (tag) {
-      case msg_cas:
-        Handler::parseField(Op(), CasTag(), message, source, body, entry);
-        break;
-      case msg_delta:
-        Handler::parseField(Op(), DeltaTag(), message, source, body, entry);
-        break;
-      case msg_err_code:
-        Handler::parseField(Op(), ErrCodeTag(), message, source, body, entry);
-        break;
-      case msg_exptime:
-        Handler::parseField(Op(), ExptimeTag(), message, source, body, entry);
-        break;
-      case msg_flags:
-        Handler::parseField(Op(), FlagsTag(), message, source, body, entry);
-        break;
-      case msg_lease_id:
-        Handler::parseField(Op(), LeaseTokenTag(), message, source, body,
-                            entry);
-        break;
-      case msg_number:
-        Handler::parseField(Op(), NumberTag(), message, source, body, entry);
-        break;
-      case msg_result:
-        Handler::parseField(Op(), ResultTag(), message, source, body, entry);
-        break;
-      case msg_value:
-        Handler::parseField(Op(), ValueTag(), message, source, body, entry);
-        break;
-#ifndef LIBMC_FBTRACE_DISABLE
-      case msg_fbtrace:
-        // For requests, we should have previously parsed fbtrace.
-        break;
-#endif
-      case msg_key:
-        Handler::parseField(Op(), KeyTag(), message, source, body, entry);
-        break;
-      case msg_op:
-        // For requests, we should have previously parsed operation.
-        break;
-      case msg_reqid:
-        // ReqId is parsed prior to calling this function.
-        break;
-      case msg_stats:
-        // We never expect stats.
-        break;
-      default:;
-        // Silently ignore all other fields.
-        break;
+    const uint32_t tag = folly::Endian::big((uint16_t)entry.tag);
+    // Valid tags are single bits; silently ignore everything else.
+    if (tag == 0 || (tag & (tag - 1)) != 0 || tag >= (1u << kNumTagBits)) {
+      continue;
+    }
+    if (auto kernel = kernels[folly::findFirstSet(tag) - 1]) {
+      kernel(message, source, body, entry);
     }
   }
 }
@@ -582,11 +598,17 @@ bool UmbrellaSerializedMessage::prepareRequestImpl(const Request& request,
                  key.size());
   }
 
-  auto valueRange = request.valueRangeSlow();
-  if (valueRange.begin() != nullptr) {
-    appendString(msg_value,
-                 reinterpret_cast<const uint8_t*>(valueRange.begin()),
-                 valueRange.size());
+  if (const auto* valuePtr = request.valuePtrUnsafe()) {
+    // Reference the value chain in place; the request outlives the
+    // serialized message. Coalesce only if there are too many segments.
+    if (!appendValueIOBuf(msg_value, *valuePtr)) {
+      auto valueRange = request.valueRangeSlow();
+      if (valueRange.begin() != nullptr) {
+        appendString(msg_value,
+                     reinterpret_cast<const uint8_t*>(valueRange.begin()),
+                     valueRange.size());
+      }
+    }
   }
 
 #ifndef LIBMC_FBTRACE_DISABLE
@@ -633,16 +655,16 @@ bool UmbrellaSerializedMessage::prepareReplyImpl(Reply&& reply,
 
   // Serialize type-specific fields, e.g., cas token for gets reply
   prepareHelper(reply);
-  /* TODO: if we intend to pass chained IOBufs as values,
-     we can optimize this to write multiple iovs directly */
   if (reply.hasValue()) {
     // TODO(jmswen) Use 'message' field for error messages instead of 'value'?
     assert(!iobuf_.hasValue());
     iobuf_.emplace(std::move(*reply.valuePtrUnsafe()));
-    auto valueRange = coalesceAndGetRange(*iobuf_);
-    appendString(msg_value,
-                 reinterpret_cast<const uint8_t*>(valueRange.begin()),
-                 valueRange.size());
+    if (!appendValueIOBuf(msg_value, *iobuf_)) {
+      auto valueRange = coalesceAndGetRange(*iobuf_);
+      appendString(msg_value,
+                   reinterpret_cast<const uint8_t*>(valueRange.begin()),
+                   valueRange.size());
+    }
   }
 
   // It is important that we write msg_result after msg_value. Parsing
@@ -70,6 +70,7 @@ void resetAdditionalFields(UmbrellaMessageInfo& info) {
   info.supportedCodecsSize = 0;
   info.usedCodecId = 0;
   info.uncompressedBodySize = 0;
+  info.deadlineMs = 0;
 }
 
 size_t getNumAdditionalFields(const UmbrellaMessageInfo& info) {
@@ -89,6 +90,9 @@ size_t getNumAdditionalFields(const UmbrellaMessageInfo& info) {
   if (info.uncompressedBodySize != 0) {
     ++nAdditionalFields;
   }
+  if (info.deadlineMs != 0) {
+    ++nAdditionalFields;
+  }
   return nAdditionalFields;
 }
 
@@ -133,6 +137,10 @@ size_t serializeAdditionalFields(
       buf,
       CaretAdditionalFieldType::UNCOMPRESSED_BODY_SIZE,
       info.uncompressedBodySize);
+  buf += serializeAdditionalFieldIfNonZero(
+      buf,
+      CaretAdditionalFieldType::DEADLINE_MS,
+      info.deadlineMs);
 
   return buf - destination;
 }
@@ -217,7 +225,7 @@ UmbrellaParseStatus caretParseHeader(const uint8_t* buff,
       uint64_t fieldValue = folly::decodeVarint(range);
 
       if (fieldType > static_cast<uint64_t>(
-                          CaretAdditionalFieldType::UNCOMPRESSED_BODY_SIZE)) {
+                          CaretAdditionalFieldType::DEADLINE_MS)) {
         // Additional Field Type not recognized, ignore.
         continue;
       }
@@ -238,6 +246,9 @@ UmbrellaParseStatus caretParseHeader(const uint8_t* buff,
         case CaretAdditionalFieldType::UNCOMPRESSED_BODY_SIZE:
           headerInfo.uncompressedBodySize = fieldValue;
           break;
+        case CaretAdditionalFieldType::DEADLINE_MS:
+          headerInfo.deadlineMs = fieldValue;
+          break;
       }
     } catch (const std::invalid_argument& e) {
       // buffer was not sufficient for additional fields
@@ -353,6 +364,7 @@ void UmbrellaSerializedMessage::appendString(
     return;
   }
 
+  stringTerminated_[nStrings_] = true;
   strings_[nStrings_++] = folly::StringPiece((const char*)data, len);
 
   um_elist_entry_t& entry = entries_[nEntries_++];
@@ -363,6 +375,52 @@ void UmbrellaSerializedMessage::appendString(
   offset_ += len + 1;
 }
 
+bool UmbrellaSerializedMessage::appendValueIOBuf(int32_t tag,
+                                                 const folly::IOBuf& value) {
+  size_t pieces = 0;
+  size_t len = 0;
+  const folly::IOBuf* buf = &value;
+  do {
+    if (buf->length() > 0) {
+      ++pieces;
+      len += buf->length();
+    }
+    buf = buf->next();
+  } while (buf != &value);
+
+  if (pieces == 0 || pieces > kMaxValuePieces ||
+      nStrings_ + pieces > kInlineStrings) {
+    return false;
+  }
+
+  if (nEntries_ >= kInlineEntries) {
+    error_ = true;
+    return true;
+  }
+
+  // One BSTRING entry spans the whole chain; each segment gets its own
+  // iovec and only the last one is nul-terminated.
+  um_elist_entry_t& entry = entries_[nEntries_++];
+  entry.type = folly::Endian::big((uint16_t)BSTRING);
+  entry.tag = folly::Endian::big((uint16_t)tag);
+  entry.data.str.offset = folly::Endian::big((uint32_t)offset_);
+  entry.data.str.len = folly::Endian::big((uint32_t)(len + 1));
+  offset_ += len + 1;
+
+  buf = &value;
+  do {
+    if (buf->length() > 0) {
+      stringTerminated_[nStrings_] = false;
+      strings_[nStrings_++] =
+          folly::StringPiece((const char*)buf->data(), buf->length());
+    }
+    buf = buf->next();
+  } while (buf != &value);
+  stringTerminated_[nStrings_ - 1] = true;
+
+  return true;
+}
+
 size_t UmbrellaSerializedMessage::finalizeMessage() {
   static char nul = '\0';
 
@@ -381,9 +439,11 @@ size_t UmbrellaSerializedMessage::finalizeMessage() {
     iovs_[niovOut].iov_len = strings_[i].size();
     niovOut++;
 
-    iovs_[niovOut].iov_base = &nul;
-    iovs_[niovOut].iov_len = 1;
-    niovOut++;
+    if (stringTerminated_[i]) {
+      iovs_[niovOut].iov_base = &nul;
+      iovs_[niovOut].iov_len = 1;
+      niovOut++;
+    }
   }
   return niovOut;
 }
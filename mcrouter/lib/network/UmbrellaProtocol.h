@@ -30,7 +30,7 @@ namespace facebook { namespace memcache {
 
 
 constexpr char kCaretMagicByte = '^';
-constexpr size_t kMaxAdditionalFields = 3;
+constexpr size_t kMaxAdditionalFields = 4;
 constexpr size_t kMaxHeaderLength = 1 /* magic byte */ +
     1 /* GroupVarint header (lengths of 4 ints) */ +
     4 * sizeof(uint32_t) /* body size, typeId, reqId, num additional fields */ +
@@ -55,6 +55,8 @@ struct UmbrellaMessageInfo {
   uint64_t supportedCodecsSize{0};
   uint64_t usedCodecId{0};
   uint64_t uncompressedBodySize{0};
+  // Time budget (ms) the sender has left for this request; 0 if unknown.
+  uint64_t deadlineMs{0};
 };
 
 enum class UmbrellaParseStatus {
@@ -75,6 +77,11 @@ enum class CaretAdditionalFieldType {
 
   // Size of body after decompression.
   UNCOMPRESSED_BODY_SIZE = 4,
+
+  // Remaining time budget (in ms) the sender has for this request.
+  // Relative rather than absolute so it doesn't depend on clocks being
+  // synchronized across hosts; network transit time is not accounted.
+  DEADLINE_MS = 5,
 };
 
 UmbrellaParseStatus umbrellaParseHeader(const uint8_t* buf, size_t nbuf,
@@ -187,8 +194,15 @@ class UmbrellaSerializedMessage {
   um_elist_entry_t entries_[kInlineEntries];
 
   static constexpr size_t kInlineStrings = 16;
+  // Cap on chain segments a single value may contribute, so the resulting
+  // iovecs (plus nul terminators for the other strings) still fit in iovs_.
+  static constexpr size_t kMaxValuePieces = 8;
   size_t nStrings_{0};
   folly::StringPiece strings_[kInlineStrings];
+  // True iff finalizeMessage() should emit a nul terminator after the
+  // corresponding string. Only the last piece of a multi-piece value is
+  // terminated.
+  bool stringTerminated_[kInlineStrings];
 
   folly::Optional<folly::IOBuf> iobuf_;
   folly::Optional<std::string> auxString_;
@@ -201,6 +215,17 @@ class UmbrellaSerializedMessage {
   void appendString(int32_t tag, const uint8_t* data, size_t len,
                     entry_type_t type = BSTRING);
 
+  /**
+   * Appends a value IOBuf chain as a single BSTRING entry whose data is
+   * referenced segment by segment, i.e. without coalescing. The chain must
+   * stay alive until the serialized message is written out.
+   *
+   * @return false if the chain is empty or has too many segments to
+   *         reference in place; the caller should fall back to the
+   *         coalescing appendString() path.
+   */
+  bool appendValueIOBuf(int32_t tag, const folly::IOBuf& value);
+
   template <class Request>
   bool prepareRequestImpl(const Request& request, mc_op_t op, uint64_t reqid,
                           const struct iovec*& iovOut, size_t& niovOut);
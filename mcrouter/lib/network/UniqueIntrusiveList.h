@@ -73,6 +73,16 @@ class UniqueIntrusiveList {
     return t;
   }
 
+  /**
+   * Transfers ownership of the back element out of the list.
+   */
+  std::unique_ptr<T, TDeleter> popBack() {
+    assert(!list_.empty());
+    std::unique_ptr<T, TDeleter> t(&list_.back(), TDeleter());
+    list_.pop_back();
+    return t;
+  }
+
   /**
    * Remove the element pointed to by `it` from the list,
    * and return the unique_ptr to it.
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ValueBufferPool.h"
+
+#include <type_traits>
+
+#include "mcrouter/lib/fbi/cpp/ObjectPool.h"
+
+namespace facebook { namespace memcache {
+
+namespace {
+
+template <size_t kSize>
+struct Slab {
+  typename std::aligned_storage<kSize, alignof(std::max_align_t)>::type bytes;
+};
+
+template <size_t kSize>
+TieredObjectPool<Slab<kSize>>& slabPool() {
+  static TieredObjectPool<Slab<kSize>> pool;
+  return pool;
+}
+
+template <size_t kSize>
+void freeSlab(void* buf, void* /* userData */) {
+  slabPool<kSize>().free(reinterpret_cast<Slab<kSize>*>(buf));
+}
+
+template <size_t kSize>
+folly::IOBuf allocateSlab() {
+  return folly::IOBuf(folly::IOBuf::TAKE_OWNERSHIP,
+                      slabPool<kSize>().alloc(),
+                      kSize,
+                      0 /* length */,
+                      freeSlab<kSize>,
+                      nullptr /* userData */);
+}
+
+} // anonymous
+
+folly::IOBuf allocateValueBuffer(size_t size) {
+  if (size <= 256) {
+    return allocateSlab<256>();
+  }
+  if (size <= 1024) {
+    return allocateSlab<1024>();
+  }
+  if (size <= 4096) {
+    return allocateSlab<4096>();
+  }
+  if (size <= kMaxPooledValueSize) {
+    return allocateSlab<kMaxPooledValueSize>();
+  }
+  return folly::IOBuf(folly::IOBuf::CREATE, size);
+}
+
+}}  // facebook::memcache
@@ -0,0 +1,39 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/io/IOBuf.h>
+
+namespace facebook { namespace memcache {
+
+/**
+ * Largest value size served from a pooled size class by
+ * allocateValueBuffer(). Above this, copying costs more than the
+ * pinning it would save, so callers should keep sharing the original
+ * buffer.
+ */
+constexpr size_t kMaxPooledValueSize = 16384;
+
+/**
+ * Returns a buffer with at least `size` bytes of tailroom for holding a
+ * reply value, served from a size-classed recycling pool of slabs
+ * (sizes up to kMaxPooledValueSize; larger requests get an ordinary
+ * unpooled buffer).
+ *
+ * Parsed reply values are zero-copy clones into a connection read
+ * buffer, which pins the entire (possibly 16KB+) buffer for as long as
+ * the value lives. Copying a small value into a pooled slab unpins the
+ * read buffer and takes the allocation off the reply path: slabs
+ * recycle through a TieredObjectPool, so they may be freed on a
+ * different thread than they were allocated on.
+ */
+folly::IOBuf allocateValueBuffer(size_t size);
+
+}}  // facebook::memcache
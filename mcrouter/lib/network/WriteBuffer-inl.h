@@ -52,7 +52,13 @@ bool WriteBuffer::prepareTyped(
 
     case mc_caret_protocol:
       return caretReply_.prepare(
-          std::move(reply), ctx_->reqid_, ctx_->codec_, iovsBegin_, iovsCount_);
+          std::move(reply),
+          ctx_->reqid_,
+          ctx_->codec_,
+          ctx_->compressionFilter_,
+          ctx_->compressionBucket_,
+          iovsBegin_,
+          iovsCount_);
       break;
 
     default:
@@ -14,6 +14,8 @@
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/mc/protocol.h"
 #include "mcrouter/lib/McResUtil.h"
+#include "mcrouter/lib/MemoryBudget.h"
+#include "mcrouter/lib/network/AsciiInt.h"
 #include "mcrouter/lib/network/McServerRequestContext.h"
 #include "mcrouter/lib/network/MultiOpParent.h"
 
@@ -37,6 +39,8 @@ WriteBuffer::WriteBuffer(mc_protocol_t protocol)
     default:
       CHECK(false) << "Unknown protocol";
   }
+  MemoryBudget::instance().account(
+      MemoryBudget::kWriteBuffers, sizeof(WriteBuffer));
 }
 
 WriteBuffer::~WriteBuffer() {
@@ -56,6 +60,9 @@ WriteBuffer::~WriteBuffer() {
     default:
       CHECK(false);
   }
+  MemoryBudget::instance().account(
+      MemoryBudget::kWriteBuffers,
+      -static_cast<int64_t>(sizeof(WriteBuffer)));
 }
 
 void WriteBuffer::clear() {
@@ -113,6 +120,24 @@ void AsciiSerializedReply::addString(folly::StringPiece str) {
   addString(folly::ByteRange(str));
 }
 
+void AsciiSerializedReply::addValue(folly::IOBuf& value) {
+  // The value may be a chain cloned straight out of the client-side parser.
+  // Emit one iovec per chain segment so the data is never memcpy'd on the
+  // reply path. Only coalesce as a last resort, if the chain wouldn't fit
+  // into iovs_ (leaving room for the trailing "\r\n").
+  if (value.countChainElements() > kMaxIovs - iovsCount_ - 1) {
+    addString(coalesceAndGetRange(value));
+    return;
+  }
+  const folly::IOBuf* buf = &value;
+  do {
+    if (buf->length() > 0) {
+      addString(folly::ByteRange(buf->data(), buf->length()));
+    }
+    buf = buf->next();
+  } while (buf != &value);
+}
+
 void AsciiSerializedReply::handleError(mc_res_t result,
                                        uint16_t errorCode,
                                        std::string&& message) {
@@ -166,19 +191,22 @@ void AsciiSerializedReply::prepareImpl(
       }
       addString("END\r\n");
     } else {
-      const auto valueStr = reply.valueRangeSlow();
+      const auto valueLen = reply->value.computeChainDataLength();
 
-      const auto len = snprintf(printBuffer_, kMaxBufferLength, " %lu %zu\r\n",
-                                reply.flags(), valueStr.size());
-      assert(len > 0);
-      assert(static_cast<size_t>(len) < kMaxBufferLength);
+      char* pos = printBuffer_;
+      *pos++ = ' ';
+      pos += asciiEncodeUint64(pos, reply.flags());
+      *pos++ = ' ';
+      pos += asciiEncodeUint64(pos, valueLen);
+      *pos++ = '\r';
+      *pos++ = '\n';
 
       addStrings("VALUE ", key,
-                 folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+                 folly::StringPiece(printBuffer_, pos - printBuffer_));
       assert(!iobuf_.hasValue());
-      // value was coalesced in valueRangeSlow()
       iobuf_ = std::move(reply->value);
-      addStrings(valueStr, "\r\n");
+      addValue(*iobuf_);
+      addString("\r\n");
     }
   } else if (reply.isError()) {
     handleError(reply.result(), reply.appSpecificErrorCode(),
@@ -193,22 +221,26 @@ void AsciiSerializedReply::prepareImpl(
     folly::StringPiece key) {
 
   if (reply.isHit()) {
-    const auto valueStr = reply.valueRangeSlow();
+    const auto valueLen = reply->value.computeChainDataLength();
     const uint64_t casToken = reply->get_casToken() ? *reply->get_casToken()
                                                     : 0;
 
-    const auto len = snprintf(printBuffer_, kMaxBufferLength,
-                              " %lu %zu %lu\r\n",
-                              reply.flags(), valueStr.size(), casToken);
-    assert(len > 0);
-    assert(static_cast<size_t>(len) < kMaxBufferLength);
+    char* pos = printBuffer_;
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, reply.flags());
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, valueLen);
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, casToken);
+    *pos++ = '\r';
+    *pos++ = '\n';
 
     addStrings("VALUE ", key,
-               folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+               folly::StringPiece(printBuffer_, pos - printBuffer_));
     assert(!iobuf_.hasValue());
-    // value was coalesced in valueRangeSlow()
     iobuf_ = std::move(reply->value);
-    addStrings(valueStr, "\r\n");
+    addValue(*iobuf_);
+    addString("\r\n");
   } else if (reply.isError()) {
     handleError(reply.result(), reply.appSpecificErrorCode(),
                 std::move(reply->message));
@@ -265,32 +297,41 @@ void AsciiSerializedReply::prepareImpl(
     TypedThriftReply<cpp2::McLeaseGetReply>&& reply,
     folly::StringPiece key) {
 
-  const auto valueStr = reply.valueRangeSlow();
+  const auto valueLen = reply->value.computeChainDataLength();
 
   if (reply.result() == mc_res_found) {
-    const auto len = snprintf(printBuffer_, kMaxBufferLength,
-                              " %lu %zu\r\n",
-                              reply.flags(), valueStr.size());
-    assert(len > 0);
-    assert(static_cast<size_t>(len) < kMaxBufferLength);
+    char* pos = printBuffer_;
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, reply.flags());
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, valueLen);
+    *pos++ = '\r';
+    *pos++ = '\n';
 
     addStrings("VALUE ", key,
-               folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+               folly::StringPiece(printBuffer_, pos - printBuffer_));
     assert(!iobuf_.hasValue());
-    // value was coalesced in valueRangeSlow()
     iobuf_ = std::move(reply->value);
-    addStrings(valueStr, "\r\n");
+    addValue(*iobuf_);
+    addString("\r\n");
   } else if (reply.result() == mc_res_notfound) {
     const uint64_t leaseToken =
       reply->get_leaseToken() ? *reply->get_leaseToken() : 0;
 
-    const auto len = snprintf(printBuffer_, kMaxBufferLength,
-                              " %lu %lu %zu\r\n",
-                              leaseToken, reply.flags(), valueStr.size());
+    char* pos = printBuffer_;
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, leaseToken);
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, reply.flags());
+    *pos++ = ' ';
+    pos += asciiEncodeUint64(pos, valueLen);
+    *pos++ = '\r';
+    *pos++ = '\n';
     addStrings("LVALUE ", key,
-               folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+               folly::StringPiece(printBuffer_, pos - printBuffer_));
     iobuf_ = std::move(reply->value);
-    addStrings(valueStr, "\r\n");
+    addValue(*iobuf_);
+    addString("\r\n");
   } else if (reply.result() == mc_res_notfoundhot) {
     addString("NOT_FOUND_HOT\r\n");
   } else if (reply.isError()) {
@@ -389,11 +430,11 @@ void AsciiSerializedReply::prepareArithmeticLike(mc_res_t result,
                                                  std::string&& message,
                                                  const char* requestName) {
   if (isStoredResult(result)) {
-    const auto len = snprintf(printBuffer_, kMaxBufferLength, "%lu\r\n",
-                              delta);
-    assert(len > 0);
-    assert(static_cast<size_t>(len) < kMaxBufferLength);
-    addString(folly::StringPiece(printBuffer_, static_cast<size_t>(len)));
+    char* pos = printBuffer_;
+    pos += asciiEncodeUint64(pos, delta);
+    *pos++ = '\r';
+    *pos++ = '\n';
+    addString(folly::StringPiece(printBuffer_, pos - printBuffer_));
   } else if (isMissResult(result)) {
     addString("NOT_FOUND\r\n");
   } else if (isErrorResult(result)) {
@@ -457,11 +498,9 @@ void AsciiSerializedReply::prepareImpl(
     // TODO(jmswen) Do something sane when version is empty
     addString("VERSION ");
     if (reply->get_value()) {
-      const auto valueStr = reply.valueRangeSlow();
       assert(!iobuf_.hasValue());
-      // value was coalesced in valueRangeSlow()
       iobuf_ = std::move(reply->value);
-      addString(valueStr);
+      addValue(*iobuf_);
     }
     addString("\r\n");
   } else if (reply.isError()) {
@@ -529,6 +568,21 @@ void AsciiSerializedReply::prepareImpl(
   }
 }
 
+// BulkDelete
+// Caret-only operation: an ascii session can't produce the request, so
+// this path is reachable only through a serialization bug upstream.
+void AsciiSerializedReply::prepareImpl(
+    TypedThriftReply<cpp2::McBulkDeleteReply>&& reply) {
+  if (reply.result() == mc_res_deleted) {
+    addString("DELETED\r\n");
+  } else if (reply.isError()) {
+    handleError(reply.result(), reply.appSpecificErrorCode(),
+                std::move(reply->message));
+  } else {
+    handleUnexpected(reply.result(), "bulk-delete");
+  }
+}
+
 // Shutdown
 void AsciiSerializedReply::prepareImpl(
     TypedThriftReply<cpp2::McShutdownReply>&& reply) {
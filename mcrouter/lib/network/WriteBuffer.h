@@ -103,6 +103,10 @@ class AsciiSerializedReply {
   template <class Arg, class... Args>
   void addStrings(Arg&& arg, Args&&... args);
 
+  // Adds a reply value to iovs_ without copying the data. The IOBuf must
+  // stay alive for the lifetime of this reply, i.e. be owned by iobuf_.
+  void addValue(folly::IOBuf& value);
+
   // Get-like ops
   void prepareImpl(TypedThriftReply<cpp2::McGetReply>&& reply,
                    folly::StringPiece key);
@@ -142,6 +146,7 @@ class AsciiSerializedReply {
   void prepareImpl(TypedThriftReply<cpp2::McExecReply>&&);
   void prepareImpl(TypedThriftReply<cpp2::McFlushReReply>&&);
   void prepareImpl(TypedThriftReply<cpp2::McFlushAllReply>&&);
+  void prepareImpl(TypedThriftReply<cpp2::McBulkDeleteReply>&& reply);
   // Server and client error helper
   void handleError(mc_res_t result, uint16_t errorCode, std::string&& message);
   void handleUnexpected(mc_res_t result, const char* requestName);
@@ -188,6 +193,17 @@ class WriteBuffer {
   }
   size_t getIovsCount() const { return iovsCount_; }
 
+  /**
+   * Total number of bytes this reply occupies on the wire.
+   */
+  size_t totalSize() const {
+    size_t n = 0;
+    for (size_t i = 0; i < iovsCount_; ++i) {
+      n += iovsBegin_[i].iov_len;
+    }
+    return n;
+  }
+
   /**
    * Checks if we should send a reply for this request.
    *
@@ -252,7 +268,11 @@ class WriteBufferQueue {
     if (tlFreeQueue_.empty()) {
       return folly::make_unique<WriteBuffer>(protocol_);
     } else {
-      return tlFreeQueue_.popFront();
+      // LIFO: the most recently freed buffer is the most likely to still
+      // be in cache. The free queue is shared by all sessions of this
+      // worker thread, so mostly idle sessions hold no buffers of their
+      // own.
+      return tlFreeQueue_.popBack();
     }
   }
 
@@ -276,3 +276,14 @@ struct McFlushAllReply {
   2: optional string message;
   3: optional i16 appSpecificErrorCode;
 }
+
+struct McBulkDeleteRequest {
+  1: IOBuf key; // unused
+  2: list<IOBuf> keys;
+}
+
+struct McBulkDeleteReply {
+  1: i16 result;
+  2: optional string message;
+  3: optional i16 appSpecificErrorCode;
+}
@@ -137,4 +137,28 @@ TEST(AccessPoint, port_override) {
   EXPECT_TRUE(ap->useSsl());
 }
 
+TEST(AccessPoint, equality_and_hash) {
+  auto ap1 = AccessPoint::create("127.0.0.1:12345:caret", mc_unknown_protocol);
+  auto ap2 = AccessPoint::create("127.0.0.1:12345", mc_caret_protocol);
+  ASSERT_TRUE(ap1 != nullptr);
+  ASSERT_TRUE(ap2 != nullptr);
+  // Equal value implies equal precomputed hash, even for distinct objects
+  // parsed from different spellings.
+  EXPECT_TRUE(*ap1 == *ap2);
+  EXPECT_EQ(ap1->hash(), ap2->hash());
+
+  auto otherPort = AccessPoint::create("127.0.0.1:12346:caret",
+                                       mc_unknown_protocol);
+  auto otherProto = AccessPoint::create("127.0.0.1:12345:ascii",
+                                        mc_unknown_protocol);
+  auto withSsl = AccessPoint::create("127.0.0.1:12345:caret:ssl",
+                                     mc_unknown_protocol);
+  EXPECT_TRUE(*ap1 != *otherPort);
+  EXPECT_TRUE(*ap1 != *otherProto);
+  EXPECT_TRUE(*ap1 != *withSsl);
+  EXPECT_NE(ap1->hash(), otherPort->hash());
+  EXPECT_NE(ap1->hash(), otherProto->hash());
+  EXPECT_NE(ap1->hash(), withSsl->hash());
+}
+
 } // anonymous
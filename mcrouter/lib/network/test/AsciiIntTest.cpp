@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <limits>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <folly/Conv.h>
+
+#include "mcrouter/lib/network/AsciiInt.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+TEST(AsciiInt, encodeUint64) {
+  const uint64_t values[] = {
+    0, 1, 9, 10, 11, 99, 100, 101, 999, 1000, 9999, 10000,
+    12345678, 99999999, 100000000, 123456789012345ULL,
+    std::numeric_limits<uint64_t>::max()
+  };
+  char buf[32];
+  for (const auto value : values) {
+    const auto expected = folly::to<std::string>(value);
+    EXPECT_EQ(expected.size(), asciiUint64Length(value));
+    const auto len = asciiEncodeUint64(buf, value);
+    EXPECT_EQ(expected, std::string(buf, len));
+  }
+}
+
+TEST(AsciiInt, encodeInt64) {
+  const int64_t values[] = {
+    0, 1, -1, 42, -42,
+    std::numeric_limits<int32_t>::min(),
+    std::numeric_limits<int32_t>::max(),
+    std::numeric_limits<int64_t>::min(),
+    std::numeric_limits<int64_t>::max()
+  };
+  char buf[32];
+  for (const auto value : values) {
+    const auto len = asciiEncodeInt64(buf, value);
+    EXPECT_EQ(folly::to<std::string>(value), std::string(buf, len));
+  }
+}
+
+TEST(AsciiInt, decodeUint64) {
+  // Cover every digit count, including the 8-at-a-time SWAR path and
+  // its scalar tail.
+  uint64_t value = 0;
+  for (size_t digits = 1; digits <= 20; ++digits) {
+    value = value * 10 + digits % 10;
+    const auto str = folly::to<std::string>(value);
+    EXPECT_EQ(value, asciiDecodeUint64(str.data(), str.data() + str.size()));
+  }
+  EXPECT_EQ(0, asciiDecodeUint64(nullptr, nullptr));
+  const std::string max("18446744073709551615");
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(),
+            asciiDecodeUint64(max.data(), max.data() + max.size()));
+}
+
+TEST(AsciiInt, scanDigits) {
+  const std::string run("1234567890123 abc");
+  EXPECT_EQ(run.data() + 13,
+            asciiScanDigits(run.data(), run.data() + run.size()));
+  const std::string none("abc");
+  EXPECT_EQ(none.data(), asciiScanDigits(none.data(), none.data() + 3));
+  const std::string all("12345678901234567890");
+  EXPECT_EQ(all.data() + all.size(),
+            asciiScanDigits(all.data(), all.data() + all.size()));
+  // Bytes just outside '0'..'9' must terminate the scan.
+  const std::string tricky("123/56:8");
+  EXPECT_EQ(tricky.data() + 3,
+            asciiScanDigits(tricky.data(), tricky.data() + tricky.size()));
+}
+
+} // anonymous
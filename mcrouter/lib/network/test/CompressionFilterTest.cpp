@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/network/CompressionFilter.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+// Reply size whose size bucket is left untrained in the key-prefix tests.
+constexpr size_t kSize = 4 * 1024;
+
+} // anonymous namespace
+
+TEST(CompressionFilter, noBucket) {
+  CompressionFilter filter;
+
+  // The sentinel bucket never learns and never blocks compression.
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(filter.shouldCompress(CompressionFilter::kNoBucket, kSize));
+    filter.recordOutcome(
+        CompressionFilter::kNoBucket, kSize, kSize / 2, true);
+  }
+  EXPECT_TRUE(filter.shouldCompress(CompressionFilter::kNoBucket, kSize));
+}
+
+TEST(CompressionFilter, learnsIncompressiblePrefix) {
+  CompressionFilter filter;
+  auto bucket = CompressionFilter::bucketOf("img:12345");
+  EXPECT_EQ(bucket, CompressionFilter::bucketOf("img:12345:suffix"));
+
+  // Before any history, the filter is optimistic.
+  EXPECT_TRUE(filter.shouldCompress(bucket, kSize));
+
+  // Report a long run of wasted compression attempts, spread over sizes
+  // so no single size bucket trips the size veto.
+  for (size_t i = 0; i < 64; ++i) {
+    filter.recordOutcome(bucket, kSize << (i % 4), kSize << (i % 4), false);
+  }
+  EXPECT_FALSE(filter.shouldCompress(bucket, kSize));
+
+  // The filter still probes occasionally instead of skipping forever.
+  size_t attempted = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    if (filter.shouldCompress(bucket, kSize)) {
+      ++attempted;
+      filter.recordOutcome(bucket, kSize << (i % 4), kSize << (i % 4), false);
+    }
+  }
+  EXPECT_GE(attempted, 10);
+  EXPECT_LE(attempted, 100);
+}
+
+TEST(CompressionFilter, compressiblePrefixUnaffected) {
+  CompressionFilter filter;
+  auto good = CompressionFilter::bucketOf("html:page1");
+
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(filter.shouldCompress(good, kSize));
+    filter.recordOutcome(good, kSize, kSize / 2, true);
+  }
+}
+
+TEST(CompressionFilter, recoversWhenValuesChange) {
+  CompressionFilter filter;
+  auto bucket = CompressionFilter::bucketOf("blob:42");
+
+  for (size_t i = 0; i < 256; ++i) {
+    filter.recordOutcome(bucket, kSize << (i % 4), kSize << (i % 4), false);
+  }
+  EXPECT_FALSE(filter.shouldCompress(bucket, kSize));
+
+  // Values under this prefix become compressible; probes should
+  // eventually flip the bucket back.
+  bool recovered = false;
+  for (size_t i = 0; i < 100000 && !recovered; ++i) {
+    if (filter.shouldCompress(bucket, kSize)) {
+      filter.recordOutcome(bucket, kSize, kSize / 2, true);
+    }
+    // Consider it recovered once two consecutive calls attempt.
+    recovered = filter.shouldCompress(bucket, kSize);
+    if (recovered) {
+      filter.recordOutcome(bucket, kSize, kSize / 2, true);
+    }
+  }
+  EXPECT_TRUE(recovered);
+}
+
+TEST(CompressionFilter, sizeCurveVetoesUnprofitableSizes) {
+  CompressionFilter filter;
+
+  // Small replies barely shrink; large replies compress well. Use the
+  // sentinel key bucket so only the size curve is learned.
+  for (size_t i = 0; i < 64; ++i) {
+    filter.recordOutcome(CompressionFilter::kNoBucket, 100, 100, false);
+    filter.recordOutcome(
+        CompressionFilter::kNoBucket, 64 * 1024, 16 * 1024, true);
+  }
+
+  size_t smallAttempts = 0;
+  size_t largeAttempts = 0;
+  for (size_t i = 0; i < 256; ++i) {
+    if (filter.shouldCompress(CompressionFilter::kNoBucket, 100)) {
+      ++smallAttempts;
+      filter.recordOutcome(CompressionFilter::kNoBucket, 100, 100, false);
+    }
+    if (filter.shouldCompress(CompressionFilter::kNoBucket, 64 * 1024)) {
+      ++largeAttempts;
+      filter.recordOutcome(
+          CompressionFilter::kNoBucket, 64 * 1024, 16 * 1024, true);
+    }
+  }
+  // Small size bucket is vetoed except for periodic probes.
+  EXPECT_LE(smallAttempts, 8);
+  EXPECT_EQ(256, largeAttempts);
+}
+
+TEST(CompressionFilter, sizeBucketStats) {
+  CompressionFilter filter;
+
+  for (size_t i = 0; i < 10; ++i) {
+    filter.recordOutcome(CompressionFilter::kNoBucket, 1000, 400, true);
+  }
+  filter.recordOutcome(CompressionFilter::kNoBucket, 1000, 1000, false);
+
+  auto stats = filter.getSizeBucketStats();
+  ASSERT_FALSE(stats.empty());
+
+  // All history must land in the bucket covering size 1000.
+  size_t bucketsWithHistory = 0;
+  for (const auto& bucket : stats) {
+    if (bucket.attempts == 0) {
+      continue;
+    }
+    ++bucketsWithHistory;
+    EXPECT_LE(bucket.minSize, 1000);
+    EXPECT_EQ(11, bucket.attempts);
+    EXPECT_EQ(1, bucket.wasted);
+    EXPECT_EQ(11 * 1000, bucket.uncompressedBytes);
+    EXPECT_EQ(10 * 400 + 1000, bucket.compressedBytes);
+  }
+  EXPECT_EQ(1, bucketsWithHistory);
+}
@@ -0,0 +1,42 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/network/HostResolver.h"
+
+using facebook::memcache::HostResolver;
+
+TEST(HostResolver, numeric) {
+  auto addr = HostResolver::instance().resolve("127.0.0.1", 11211);
+  EXPECT_EQ("127.0.0.1", addr.getAddressStr());
+  EXPECT_EQ(11211, addr.getPort());
+
+  addr = HostResolver::instance().resolve("::1", 5000);
+  EXPECT_EQ(5000, addr.getPort());
+}
+
+TEST(HostResolver, unresolvable) {
+  EXPECT_THROW(
+      HostResolver::instance().resolve("invalid.mcrouter.test.", 11211),
+      std::system_error);
+}
+
+TEST(HostResolver, prefetchIsBounded) {
+  auto& resolver = HostResolver::instance();
+  /* Numeric endpoints are dropped at scheduling time. */
+  resolver.scheduleResolution("10.0.0.1", 11211);
+  /* An unresolvable host must not hold resolvePending past the deadline
+     by more than scheduling noise. */
+  resolver.scheduleResolution("invalid.mcrouter.test.", 11211);
+  auto start = std::chrono::steady_clock::now();
+  resolver.resolvePending(std::chrono::milliseconds(100));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LE(elapsed, std::chrono::seconds(5));
+}
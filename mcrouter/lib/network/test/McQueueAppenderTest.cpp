@@ -11,13 +11,16 @@
 
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <folly/io/IOBuf.h>
 #include <thrift/lib/cpp2/protocol/CompactProtocol.h>
 
+#include "mcrouter/lib/CompressionCodecManager.h"
 #include "mcrouter/lib/network/McQueueAppender.h"
+#include "mcrouter/lib/network/McSerializedRequest.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types_custom_protocol.h"
 #include "mcrouter/lib/network/gen-cpp2/caret_test_types.h"
@@ -47,6 +50,7 @@ TEST(McQueueAppenderTest, longString) {
   info.typeId = 123;
   info.reqId = 456;
   info.traceId = 17;
+  info.deadlineMs = 250;
 
   size_t headerSize = caretPrepareHeader(
       info, reinterpret_cast<char*>(storage.getHeaderBuf()));
@@ -66,6 +70,7 @@ TEST(McQueueAppenderTest, longString) {
   EXPECT_EQ(123, inputHeader.typeId);
   EXPECT_EQ(456, inputHeader.reqId);
   EXPECT_EQ(17, inputHeader.traceId);
+  EXPECT_EQ(250, inputHeader.deadlineMs);
 
   TypedThriftReply<cpp2::McGetReply> inputReply;
   apache::thrift::CompactProtocolReader reader;
@@ -149,6 +154,7 @@ TEST(McQueueAppender, manyFields) {
   info.typeId = 123;
   info.reqId = 456;
   info.traceId = 17;
+  info.deadlineMs = 250;
 
   size_t headerSize = caretPrepareHeader(
       info, reinterpret_cast<char*>(storage.getHeaderBuf()));
@@ -168,6 +174,7 @@ TEST(McQueueAppender, manyFields) {
   EXPECT_EQ(123, inputHeader.typeId);
   EXPECT_EQ(456, inputHeader.reqId);
   EXPECT_EQ(17, inputHeader.traceId);
+  EXPECT_EQ(250, inputHeader.deadlineMs);
 
   cpp2::ManyFields tstruct2;
   apache::thrift::CompactProtocolReader reader;
@@ -217,3 +224,62 @@ TEST(McQueueAppender, manyFields) {
   EXPECT_STREQ(str1, reinterpret_cast<const char*>(tstruct2.buf39.data()));
   EXPECT_STREQ(str2, reinterpret_cast<const char*>(tstruct2.buf40.data()));
 }
+
+TEST(McSerializedRequest, caretBodyCacheSharedAcrossDestinations) {
+  TypedThriftRequest<cpp2::McSetRequest> req("test:serialize:once");
+  req.setValue("some value");
+  req.setExptime(300);
+
+  const CodecIdRange noCodecs{0, 0};
+
+  // Serializing the same request object for several destinations, as
+  // shadow/all-sync/failover fanout does, must produce byte-identical
+  // bodies while each header carries its own reqId.
+  std::vector<std::string> bodies;
+  for (size_t reqId = 1; reqId <= 3; ++reqId) {
+    McSerializedRequest serialized(
+        req, reqId, mc_caret_protocol, noCodecs);
+    EXPECT_EQ(McSerializedRequest::Result::OK,
+              serialized.serializationResult());
+
+    std::string flat;
+    for (size_t i = 0; i < serialized.getIovsCount(); ++i) {
+      const struct iovec* iov = serialized.getIovs() + i;
+      flat.append(reinterpret_cast<const char*>(iov->iov_base), iov->iov_len);
+    }
+
+    UmbrellaMessageInfo header;
+    caretParseHeader(
+        reinterpret_cast<const uint8_t*>(flat.data()), flat.size(), header);
+    EXPECT_EQ(reqId, header.reqId);
+    bodies.push_back(flat.substr(header.headerSize));
+  }
+
+  EXPECT_EQ(bodies[0], bodies[1]);
+  EXPECT_EQ(bodies[0], bodies[2]);
+  // The second serialization should have built the shared body.
+  EXPECT_TRUE(req.serializedBodyCache() != nullptr);
+
+  // Mutating the request must drop the cached body and be visible in the
+  // next serialization.
+  req.setValue("another value");
+  EXPECT_TRUE(req.serializedBodyCache() == nullptr);
+
+  McSerializedRequest serialized(req, 4, mc_caret_protocol, noCodecs);
+  std::string flat;
+  for (size_t i = 0; i < serialized.getIovsCount(); ++i) {
+    const struct iovec* iov = serialized.getIovs() + i;
+    flat.append(reinterpret_cast<const char*>(iov->iov_base), iov->iov_len);
+  }
+
+  UmbrellaMessageInfo header;
+  caretParseHeader(
+      reinterpret_cast<const uint8_t*>(flat.data()), flat.size(), header);
+  TypedThriftRequest<cpp2::McSetRequest> parsed;
+  apache::thrift::CompactProtocolReader reader;
+  auto body = folly::IOBuf::wrapBuffer(
+      flat.data() + header.headerSize, header.bodySize);
+  reader.setInput(body.get());
+  parsed.read(&reader);
+  EXPECT_EQ("another value", parsed.valueRangeSlow().str());
+}
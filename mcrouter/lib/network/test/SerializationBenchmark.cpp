@@ -0,0 +1,218 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <sys/uio.h>
+
+#include <cstring>
+#include <string>
+
+#include <gflags/gflags.h>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <thrift/lib/cpp2/protocol/CompactProtocol.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types_custom_protocol.h"
+#include "mcrouter/lib/network/McAsciiParser.h"
+#include "mcrouter/lib/network/McQueueAppender.h"
+#include "mcrouter/lib/network/McSerializedRequest.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/network/UmbrellaProtocol.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+const CodecIdRange kNoCodecs{0, 0};
+
+TypedThriftRequest<cpp2::McGetRequest> makeGetRequest(size_t keySize) {
+  TypedThriftRequest<cpp2::McGetRequest> req;
+  req.setKey(std::string(keySize, 'k'));
+  return req;
+}
+
+TypedThriftRequest<cpp2::McSetRequest> makeSetRequest(size_t keySize,
+                                                      size_t valueSize) {
+  TypedThriftRequest<cpp2::McSetRequest> req;
+  req.setKey(std::string(keySize, 'k'));
+  req.setValue(folly::IOBuf(folly::IOBuf::COPY_BUFFER,
+                            std::string(valueSize, 'v')));
+  req.setExptime(0);
+  return req;
+}
+
+/**
+ * Serialize one request per iteration through McSerializedRequest, the
+ * same entry point AsyncMcClient uses, so each protocol's serializer
+ * (AsciiSerializedRequest, UmbrellaSerializedMessage,
+ * CaretSerializedMessage) is measured with its production setup cost.
+ */
+template <class Request>
+void requestSerialize(unsigned n, const Request& req, mc_protocol_t protocol) {
+  while (n--) {
+    McSerializedRequest serialized(req, 1, protocol, kNoCodecs);
+    folly::doNotOptimizeAway(serialized.getIovsCount());
+  }
+}
+
+void asciiGetSerialize(unsigned n, size_t keySize) {
+  folly::BenchmarkSuspender susp;
+  auto req = makeGetRequest(keySize);
+  susp.dismiss();
+  requestSerialize(n, req, mc_ascii_protocol);
+}
+
+void setSerialize(unsigned n,
+                  mc_protocol_t protocol,
+                  size_t keySize,
+                  size_t valueSize) {
+  folly::BenchmarkSuspender susp;
+  auto req = makeSetRequest(keySize, valueSize);
+  susp.dismiss();
+  requestSerialize(n, req, protocol);
+}
+
+/**
+ * Full umbrella round trip: serialize a set request, flatten the iovecs
+ * the way a socket write would see them, then parse the wire image back
+ * into a typed request.
+ */
+void umbrellaSetRoundTrip(unsigned n, size_t keySize, size_t valueSize) {
+  folly::BenchmarkSuspender susp;
+  auto req = makeSetRequest(keySize, valueSize);
+  folly::IOBuf wire(folly::IOBuf::CREATE, valueSize + keySize + 1024);
+  susp.dismiss();
+
+  while (n--) {
+    McSerializedRequest serialized(req, 1, mc_umbrella_protocol, kNoCodecs);
+    wire.clear();
+    for (size_t i = 0; i < serialized.getIovsCount(); ++i) {
+      const struct iovec* iov = serialized.getIovs() + i;
+      std::memcpy(wire.writableTail(), iov->iov_base, iov->iov_len);
+      wire.append(iov->iov_len);
+    }
+
+    UmbrellaMessageInfo info;
+    auto status = umbrellaParseHeader(wire.data(), wire.length(), info);
+    folly::doNotOptimizeAway(status == UmbrellaParseStatus::OK);
+    uint64_t reqid = 0;
+    auto parsed = umbrellaParseRequest<TypedThriftRequest<cpp2::McSetRequest>>(
+        wire,
+        wire.data(),
+        info.headerSize,
+        wire.data() + info.headerSize,
+        info.bodySize,
+        reqid);
+    folly::doNotOptimizeAway(parsed.fullKey().size());
+  }
+}
+
+/**
+ * Parse an ascii get reply from its wire form, including the per-reply
+ * parser initialization AsyncMcClient performs.
+ */
+void asciiGetReplyParse(unsigned n, size_t valueSize) {
+  folly::BenchmarkSuspender susp;
+  const std::string value(valueSize, 'v');
+  auto wire = folly::IOBuf::copyBuffer(
+      folly::to<std::string>("VALUE key 0 ", valueSize, "\r\n", value,
+                             "\r\nEND\r\n"));
+  susp.dismiss();
+
+  while (n--) {
+    auto buf = wire->clone();
+    McClientAsciiParser parser;
+    parser.initializeReplyParser<TypedThriftRequest<cpp2::McGetRequest>>();
+    auto state = parser.consume(*buf);
+    folly::doNotOptimizeAway(state == McClientAsciiParser::State::COMPLETE);
+    folly::doNotOptimizeAway(
+        parser.getReply<TypedThriftReply<cpp2::McGetReply>>().result());
+  }
+}
+
+/**
+ * Serialize a caret get reply the way WriteBuffer does on the server:
+ * compact thrift through McQueueAppender plus the caret header.
+ */
+void caretGetReplySerialize(unsigned n, size_t valueSize) {
+  folly::BenchmarkSuspender susp;
+  TypedThriftReply<cpp2::McGetReply> reply(mc_res_found);
+  reply.setValue(folly::IOBuf(folly::IOBuf::COPY_BUFFER,
+                              std::string(valueSize, 'v')));
+  susp.dismiss();
+
+  while (n--) {
+    McQueueAppenderStorage storage;
+    apache::thrift::CompactProtocolWriterImpl<
+        McQueueAppender, McQueueAppenderStorage> writer(
+            apache::thrift::SHARE_EXTERNAL_BUFFER);
+    writer.setOutput(&storage);
+    reply->write(&writer);
+
+    UmbrellaMessageInfo info;
+    info.bodySize = storage.computeBodySize();
+    info.typeId = 123;
+    info.reqId = 1;
+    info.traceId = 0;
+    size_t headerSize = caretPrepareHeader(
+        info, reinterpret_cast<char*>(storage.getHeaderBuf()));
+    storage.reportHeaderSize(headerSize);
+    folly::doNotOptimizeAway(storage.getIovecs().second);
+  }
+}
+
+} // anonymous
+
+BENCHMARK_PARAM(asciiGetSerialize, 8)
+BENCHMARK_PARAM(asciiGetSerialize, 64)
+BENCHMARK_PARAM(asciiGetSerialize, 250)
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK_NAMED_PARAM(setSerialize, ascii_64B, mc_ascii_protocol, 32, 64)
+BENCHMARK_NAMED_PARAM(setSerialize, ascii_4KB, mc_ascii_protocol, 32, 4096)
+BENCHMARK_NAMED_PARAM(setSerialize, ascii_64KB, mc_ascii_protocol, 32, 65536)
+BENCHMARK_NAMED_PARAM(setSerialize, umbrella_64B, mc_umbrella_protocol, 32, 64)
+BENCHMARK_NAMED_PARAM(setSerialize, umbrella_4KB, mc_umbrella_protocol, 32,
+                      4096)
+BENCHMARK_NAMED_PARAM(setSerialize, umbrella_64KB, mc_umbrella_protocol, 32,
+                      65536)
+BENCHMARK_NAMED_PARAM(setSerialize, caret_64B, mc_caret_protocol, 32, 64)
+BENCHMARK_NAMED_PARAM(setSerialize, caret_4KB, mc_caret_protocol, 32, 4096)
+BENCHMARK_NAMED_PARAM(setSerialize, caret_64KB, mc_caret_protocol, 32, 65536)
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK_NAMED_PARAM(umbrellaSetRoundTrip, 64B, 32, 64)
+BENCHMARK_NAMED_PARAM(umbrellaSetRoundTrip, 4KB, 32, 4096)
+BENCHMARK_NAMED_PARAM(umbrellaSetRoundTrip, 64KB, 32, 65536)
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK_PARAM(asciiGetReplyParse, 64)
+BENCHMARK_PARAM(asciiGetReplyParse, 4096)
+BENCHMARK_PARAM(asciiGetReplyParse, 65536)
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK_PARAM(caretGetReplySerialize, 64)
+BENCHMARK_PARAM(caretGetReplySerialize, 4096)
+BENCHMARK_PARAM(caretGetReplySerialize, 65536)
+
+// for backward compatibility with gflags
+namespace gflags { } // gflags
+namespace google { using namespace gflags; } // google
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -113,4 +113,11 @@ TEST(ThriftMsg, basic) {
   ret = cb.dispatchTypedRequest(headerInfo1, requestBuf1);
   EXPECT_TRUE(ret);
   EXPECT_TRUE(getCalled);
+
+  /* a type id past the end of the dispatch table must be rejected, not
+     read out of bounds */
+  UmbrellaMessageInfo headerInfo3 = headerInfo1;
+  headerInfo3.typeId = 1000000;
+  ret = cb.dispatchTypedRequest(headerInfo3, requestBuf1);
+  EXPECT_FALSE(ret);
 }
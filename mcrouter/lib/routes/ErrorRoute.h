@@ -28,6 +28,14 @@ struct ErrorRoute {
     return "error" + (valueToSet_.empty() ? "" : "|" + valueToSet_);
   }
 
+  static bool mayBlock() {
+    return false;
+  }
+
+  static size_t maxDepth() {
+    return 1;
+  }
+
   template <class Request>
   void traverse(const Request& req,
                 const RouteHandleTraverser<RouteHandleIf>& t) const { }
@@ -9,14 +9,19 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <folly/Conv.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/fibers/WhenN.h>
+#include <folly/Optional.h>
 #include <folly/Range.h>
 
+#include "mcrouter/lib/Ch3HashFunc.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/Operation.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
@@ -43,6 +48,27 @@ class HashRoute {
     assert(!rh_.empty());
   }
 
+  bool mayBlock() const {
+    for (const auto& rh : rh_) {
+      if (rh->mayBlock()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t maxDepth() const {
+    size_t childDepth = 0;
+    for (const auto& rh : rh_) {
+      auto depth = rh->maxDepth();
+      if (depth == kUnknownRouteDepth) {
+        return kUnknownRouteDepth;
+      }
+      childDepth = std::max(childDepth, depth);
+    }
+    return 1 + childDepth;
+  }
+
   template <class Request>
   void traverse(const Request& req,
                 const RouteHandleTraverser<RouteHandleIf>& t) const {
@@ -54,17 +80,94 @@ class HashRoute {
     return rh_[pickInMainContext(req)]->route(req);
   }
 
+  /**
+   * Routes a whole batch of requests (e.g. a multiget fan-out): hashes all
+   * keys in a single jump to the main context, groups the requests by
+   * destination and hands each group to its child in one routeBatch call.
+   * Groups are routed concurrently, each on its own fiber.
+   *
+   * @return replies in the same order as the requests.
+   */
+  template <class Request>
+  std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) const {
+    /* Hash all keys with one context switch instead of one per request. */
+    auto picks = folly::fibers::runInMainContext([this, &reqs] {
+      std::vector<size_t> result;
+      result.reserve(reqs.size());
+      for (const auto* req : reqs) {
+        result.push_back(this->pick(*req));
+      }
+      return result;
+    });
+
+    /* Group requests by destination, preserving order within each group. */
+    std::unordered_map<size_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < picks.size(); ++i) {
+      groups[picks[i]].push_back(i);
+    }
+
+    std::vector<folly::Optional<ReplyT<Request>>> replies(reqs.size());
+    auto routeGroup =
+        [this, &reqs, &replies](const std::pair<const size_t,
+                                                std::vector<size_t>>& group) {
+      std::vector<const Request*> groupReqs;
+      groupReqs.reserve(group.second.size());
+      for (auto i : group.second) {
+        groupReqs.push_back(reqs[i]);
+      }
+      auto groupReplies = rh_[group.first]->routeBatch(groupReqs);
+      assert(groupReplies.size() == group.second.size());
+      for (size_t j = 0; j < group.second.size(); ++j) {
+        replies[group.second[j]].emplace(std::move(groupReplies[j]));
+      }
+    };
+
+    if (groups.size() == 1) {
+      routeGroup(*groups.begin());
+    } else {
+      /* Route the groups concurrently, each on its own fiber. */
+      std::vector<std::function<void()>> tasks;
+      tasks.reserve(groups.size());
+      for (const auto& group : groups) {
+        tasks.emplace_back(
+          [&routeGroup, groupPtr = &group] { routeGroup(*groupPtr); });
+      }
+      folly::fibers::collectAll(tasks.begin(), tasks.end());
+    }
+
+    std::vector<ReplyT<Request>> result;
+    result.reserve(reqs.size());
+    for (auto& reply : replies) {
+      result.push_back(std::move(reply.value()));
+    }
+    return result;
+  }
+
  private:
   static const size_t kMaxKeySaltSize = 512;
   const std::vector<std::shared_ptr<RouteHandleIf>> rh_;
   const std::string salt_;
   const HashFunc hashFunc_;
 
+  /* Ch3 derives everything from a single seed hash of the key (see
+     furc_seed_hash()), so the salt-less path can consume the seed cached
+     on the request instead of re-walking the key bytes on every pick. */
+  template <class Request>
+  size_t hash(const Request& req, const Ch3HashFunc& hashFunc) const {
+    return hashFunc(req.routingKeyFurcSeed());
+  }
+
+  template <class Request, class Func>
+  size_t hash(const Request& req, const Func& hashFunc) const {
+    return hashFunc(req.routingKey());
+  }
+
   template <class Request>
   size_t pick(const Request& req) const {
     size_t n = 0;
     if (salt_.empty()) {
-      n = hashFunc_(req.routingKey());
+      n = hash(req, hashFunc_);
     } else {
       // fast string concatenation
       char c[kMaxKeySaltSize];
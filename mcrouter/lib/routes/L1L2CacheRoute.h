@@ -9,11 +9,16 @@
  */
 #pragma once
 
+#include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include <folly/fibers/Baton.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/io/IOBuf.h>
+#include <folly/ScopeGuard.h>
 
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/mc/msg.h"
@@ -31,6 +36,9 @@ namespace facebook { namespace memcache {
  * This route handle is intended to be used for two level caching.
  * For 'get' tries to find value in L1 cache, in case of a miss fetches value
  * from L2 cache and asynchronous 'add' request updates value in L1.
+ * Concurrent misses for the same key coalesce onto a single L2 fetch and
+ * L1 fills are batched onto one background fiber, so a thundering herd on
+ * a hot key costs one L2 request instead of one per client.
  *
  * Supports negative caching. If ncacheUpdatePeriod > 0, every miss from L2
  * will be stored in L1 as a special "ncache" value with "NEGATIVE_CACHE" flag
@@ -93,21 +101,39 @@ class L1L2CacheRoute {
       return l1Reply;
     }
 
-    /* else */
+    /* else: L1 miss. Coalesce concurrent misses for the same hot key onto
+       a single L2 fetch instead of letting every fiber hit L2 on its own. */
+    auto key = req.fullKey().str();
+    auto inflight = inflightFills_.find(key);
+    if (inflight != inflightFills_.end()) {
+      auto fill = inflight->second;
+      folly::fibers::Baton baton;
+      fill->waiters.push_back(&baton);
+      baton.wait();
+      return replyFromFill<ReplyT<Request>>(*fill);
+    }
+
+    auto fill = std::make_shared<InflightFill>();
+    inflightFills_.emplace(key, fill);
+    SCOPE_EXIT {
+      inflightFills_.erase(key);
+      for (auto waiter : fill->waiters) {
+        waiter->post();
+      }
+    };
+
     auto l2Reply = l2_->route(req);
-    if (l2Reply.isHit()) {
-      folly::fibers::addTask(
-        [l1 = l1_,
-         addReq = l1UpdateFromL2<AddRequest>(
-           req, l2Reply, upgradingL1Exptime_)]() {
+    fill->result = l2Reply.result();
+    if (l2Reply.isHit() && l2Reply.valuePtrUnsafe() != nullptr) {
+      l2Reply.valuePtrUnsafe()->cloneInto(fill->value);
+      fill->flags = l2Reply.flags();
+    }
 
-          l1->route(addReq);
-        });
+    if (l2Reply.isHit()) {
+      enqueueL1Add(
+        l1UpdateFromL2<AddRequest>(req, l2Reply, upgradingL1Exptime_));
     } else if (l2Reply.isMiss() && ncacheUpdatePeriod_) {
-      folly::fibers::addTask(
-        [l1 = l1_, addReq = l1Ncache<AddRequest>(req, ncacheExptime_)]() {
-          l1->route(addReq);
-        });
+      enqueueL1Add(l1Ncache<AddRequest>(req, ncacheExptime_));
     }
     return l2Reply;
   }
@@ -120,12 +146,38 @@ class L1L2CacheRoute {
   }
 
  private:
+  /**
+   * Result of an L2 fetch that concurrent misses for the same key are
+   * waiting on. Waiters are fibers blocked in route(); the leader fills in
+   * the fields below, posts each baton once and the waiters build their
+   * replies from the stored value.
+   */
+  struct InflightFill {
+    std::vector<folly::fibers::Baton*> waiters;
+    mc_res_t result{mc_res_unknown};
+    folly::IOBuf value;
+    uint64_t flags{0};
+  };
+
+  /**
+   * Queue of fire-and-forget L1 fill requests, drained by a single fiber.
+   * Shared with the drainer so that it stays valid even if the route handle
+   * goes away on reconfiguration.
+   */
+  struct L1AddQueue {
+    std::deque<TypedThriftRequest<cpp2::McAddRequest>> requests;
+    bool drainerScheduled{false};
+  };
+
   const std::shared_ptr<RouteHandleIf> l1_;
   const std::shared_ptr<RouteHandleIf> l2_;
   const uint32_t upgradingL1Exptime_{0};
   size_t ncacheExptime_{0};
   size_t ncacheUpdatePeriod_{0};
   size_t ncacheUpdateCounter_{0};
+  std::unordered_map<std::string, std::shared_ptr<InflightFill>>
+  inflightFills_;
+  const std::shared_ptr<L1AddQueue> l1AddQueue_{std::make_shared<L1AddQueue>()};
 
   template <class Request>
   struct AddImpl {};
@@ -175,6 +227,35 @@ class L1L2CacheRoute {
     return std::move(req);
   }
 
+  template <class Reply>
+  static Reply replyFromFill(const InflightFill& fill) {
+    Reply reply(fill.result);
+    if (reply.isHit()) {
+      folly::IOBuf value;
+      fill.value.cloneInto(value);
+      reply.setValue(std::move(value));
+      reply.setFlags(fill.flags);
+    }
+    return reply;
+  }
+
+  void enqueueL1Add(TypedThriftRequest<cpp2::McAddRequest> addReq) {
+    l1AddQueue_->requests.push_back(std::move(addReq));
+    if (l1AddQueue_->drainerScheduled) {
+      return;
+    }
+    l1AddQueue_->drainerScheduled = true;
+    folly::fibers::addTask(
+      [l1 = l1_, queue = l1AddQueue_]() {
+        while (!queue->requests.empty()) {
+          auto addReq = std::move(queue->requests.front());
+          queue->requests.pop_front();
+          l1->route(addReq);
+        }
+        queue->drainerScheduled = false;
+      });
+  }
+
   template <class Request>
   void updateL1Ncache(const Request& req) {
     using SetRequest = SetT<Request>;
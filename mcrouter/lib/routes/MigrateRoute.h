@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,6 +18,8 @@
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/WhenN.h>
 #include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/SpookyHashV2.h>
 
 #include "mcrouter/lib/config/RouteHandleFactory.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
@@ -39,6 +42,15 @@ namespace facebook { namespace memcache {
  * to both from_ and to_ route handle. For delete requests, returns
  * reply from worst among two replies.
  * 4. After (start_time + 2*interval), sends all requests to to_ route handle.
+ *
+ * In ramp mode the binary cutover of non-delete requests at
+ * (start_time + interval) is replaced with a gradual ramp: each key is
+ * deterministically assigned to a hash bucket, and the fraction of buckets
+ * routed to to_ grows over the whole migration window, so the target pool
+ * warms up instead of taking 100% of the traffic at the phase edge. The
+ * ramp follows a linear curve by default; a custom percentage curve can be
+ * supplied as points sampled evenly across the window, interpolated
+ * linearly. Deletes still go to both pools for the whole window.
  */
 template <class RouteHandleIf, typename TimeProvider>
 class MigrateRoute {
@@ -61,12 +73,16 @@ class MigrateRoute {
                std::shared_ptr<RouteHandleIf> th,
                time_t start_time_sec,
                time_t interval_sec,
-               TimeProvider tp)
+               TimeProvider tp,
+               bool ramp = false,
+               std::vector<double> rampCurve = std::vector<double>())
       : from_(std::move(fh)),
         to_(std::move(th)),
         startTimeSec_(start_time_sec),
         intervalSec_(interval_sec),
-        tp_(tp) {
+        tp_(tp),
+        ramp_(ramp),
+        rampCurve_(std::move(rampCurve)) {
 
     assert(from_ != nullptr);
     assert(to_ != nullptr);
@@ -108,11 +124,17 @@ class MigrateRoute {
   static constexpr int kFromMask = 1;
   static constexpr int kToMask = 2;
 
+  static constexpr uint32_t kRampBuckets = 100;
+
   const std::shared_ptr<RouteHandleIf> from_;
   const std::shared_ptr<RouteHandleIf> to_;
   time_t startTimeSec_;
   time_t intervalSec_;
   const TimeProvider tp_;
+  const bool ramp_{false};
+  /* Percentage points in [0, 100] sampled evenly across the migration
+     window; empty means a linear 0 -> 100 ramp. */
+  const std::vector<double> rampCurve_;
 
   template <class Request>
   int routeMask(const Request& req, DeleteLikeT<Request> = 0) const {
@@ -136,11 +158,43 @@ class MigrateRoute {
 
     time_t curr = tp_();
 
-    if (curr < (startTimeSec_ + intervalSec_)) {
+    if (!ramp_) {
+      if (curr < (startTimeSec_ + intervalSec_)) {
+        return kFromMask;
+      } else {
+        return kToMask;
+      }
+    }
+
+    if (curr < startTimeSec_) {
       return kFromMask;
-    } else {
+    }
+    if (curr >= startTimeSec_ + 2 * intervalSec_) {
       return kToMask;
     }
+    return keyBucket(req.fullKey()) < rampPercent(curr) ? kToMask : kFromMask;
+  }
+
+  static uint32_t keyBucket(folly::StringPiece key) {
+    return folly::hash::SpookyHashV2::Hash32(key.data(), key.size(),
+                                             /* seed= */ 0) % kRampBuckets;
+  }
+
+  /**
+   * Percentage of key buckets routed to to_ at the given time,
+   * monotonically interpolated along rampCurve_ (linear if no curve).
+   */
+  double rampPercent(time_t curr) const {
+    const double fraction = static_cast<double>(curr - startTimeSec_) /
+                            (2 * intervalSec_);
+    if (rampCurve_.size() < 2) {
+      return fraction * 100.0;
+    }
+    const double pos = fraction * (rampCurve_.size() - 1);
+    const size_t left = std::min(static_cast<size_t>(pos),
+                                 rampCurve_.size() - 2);
+    return rampCurve_[left] +
+           (rampCurve_[left + 1] - rampCurve_[left]) * (pos - left);
   }
 };
 
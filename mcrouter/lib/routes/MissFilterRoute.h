@@ -0,0 +1,169 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/SpookyHashV2.h>
+
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/Reply.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * Bloom filter that forgets its contents over time. Two equally sized
+ * filters are kept: inserts go into the current one and lookups check both.
+ * Every ttl the previous filter is dropped and the current one takes its
+ * place, so an entry stays visible for at least ttl and at most 2*ttl.
+ *
+ * Not thread safe; intended to be used from a single proxy thread.
+ */
+class AgingBloomFilter {
+ public:
+  AgingBloomFilter(size_t sizeBytes, std::chrono::seconds ttl)
+    : ttl_(ttl),
+      numBits_(std::max<size_t>(sizeBytes * 8 / 2, 64)),
+      current_((numBits_ + 63) / 64, 0),
+      previous_((numBits_ + 63) / 64, 0),
+      rotateAt_(std::chrono::steady_clock::now() + ttl_) {
+  }
+
+  void insert(folly::StringPiece key) {
+    maybeRotate();
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    hash(key, h1, h2);
+    for (size_t i = 0; i < kNumProbes; ++i) {
+      const auto bit = (h1 + i * h2) % numBits_;
+      current_[bit / 64] |= 1ULL << (bit % 64);
+    }
+  }
+
+  bool mayContain(folly::StringPiece key) {
+    maybeRotate();
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    hash(key, h1, h2);
+    bool inCurrent = true;
+    bool inPrevious = true;
+    for (size_t i = 0; i < kNumProbes; ++i) {
+      const auto bit = (h1 + i * h2) % numBits_;
+      const auto mask = 1ULL << (bit % 64);
+      inCurrent = inCurrent && (current_[bit / 64] & mask);
+      inPrevious = inPrevious && (previous_[bit / 64] & mask);
+    }
+    return inCurrent || inPrevious;
+  }
+
+ private:
+  static constexpr size_t kNumProbes = 4;
+
+  static void hash(folly::StringPiece key, uint64_t& h1, uint64_t& h2) {
+    h1 = 0;
+    h2 = 0;
+    folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+    /* Double hashing needs an odd step to cycle through all bits. */
+    h2 |= 1;
+  }
+
+  void maybeRotate() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now < rotateAt_) {
+      return;
+    }
+    if (now >= rotateAt_ + ttl_) {
+      /* Idle for over a ttl: everything has expired. */
+      std::fill(previous_.begin(), previous_.end(), 0);
+    } else {
+      previous_.swap(current_);
+    }
+    std::fill(current_.begin(), current_.end(), 0);
+    rotateAt_ = now + ttl_;
+  }
+
+  const std::chrono::seconds ttl_;
+  const size_t numBits_;
+  std::vector<uint64_t> current_;
+  std::vector<uint64_t> previous_;
+  std::chrono::steady_clock::time_point rotateAt_;
+};
+
+/**
+ * Remembers keys that recently missed and answers repeat gets for them
+ * locally, without bothering the backend. Misses are recorded in an aging
+ * bloom filter, so the memory cost is fixed (a few MB) regardless of key
+ * volume and entries expire after at most twice the configured ttl.
+ *
+ * Mutations pass through to the child and are recorded in a second filter
+ * of the same size and ttl; a key seen there is never answered locally,
+ * so a set or delete makes the next get consult the backend again.
+ *
+ * A bloom filter false positive turns into one spurious locally-answered
+ * miss, which is semantically safe for a cache: clients treat it like any
+ * other miss and refill.
+ */
+template <class RouteHandleIf>
+class MissFilterRoute {
+ public:
+  static std::string routeName() { return "miss-filter"; }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<RouteHandleIf>& t) const {
+    t(*child_, req);
+  }
+
+  MissFilterRoute(std::shared_ptr<RouteHandleIf> child,
+                  size_t filterSizeBytes,
+                  std::chrono::seconds missTtl)
+    : child_(std::move(child)),
+      misses_(filterSizeBytes, missTtl),
+      writes_(filterSizeBytes, missTtl) {
+
+    assert(child_ != nullptr);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req, GetLikeT<Request> = 0) {
+    auto key = req.fullKey();
+    if (misses_.mayContain(key) && !writes_.mayContain(key)) {
+      /* Recent miss with no write since: answer the miss locally. */
+      return ReplyT<Request>(DefaultReply, req);
+    }
+
+    auto reply = child_->route(req);
+    if (reply.isMiss()) {
+      misses_.insert(key);
+    }
+    return reply;
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req,
+                        OtherThanT<Request, GetLike<>> = 0) {
+    writes_.insert(req.fullKey());
+    return child_->route(req);
+  }
+
+ private:
+  const std::shared_ptr<RouteHandleIf> child_;
+  AgingBloomFilter misses_;
+  AgingBloomFilter writes_;
+};
+
+}} // facebook::memcache
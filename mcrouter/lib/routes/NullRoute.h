@@ -28,6 +28,14 @@ struct NullRoute {
     return "null";
   }
 
+  static bool mayBlock() {
+    return false;
+  }
+
+  static size_t maxDepth() {
+    return 1;
+  }
+
   template <class Request>
   void traverse(const Request& req,
                 const RouteHandleTraverser<RouteHandleIf>& t) const { }
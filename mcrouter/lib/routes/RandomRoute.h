@@ -11,10 +11,10 @@
 
 #include <chrono>
 #include <memory>
-#include <random>
 #include <string>
 #include <vector>
 
+#include "mcrouter/lib/fbi/cpp/Xoshiro256Plus.h"
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
 
@@ -36,8 +36,7 @@ class RandomRoute {
 
   explicit RandomRoute(std::vector<std::shared_ptr<RouteHandleIf>> children)
       : children_(std::move(children)),
-        gen_(std::ranlux24_base(
-              std::chrono::system_clock::now().time_since_epoch().count())) {
+        gen_(std::chrono::system_clock::now().time_since_epoch().count()) {
     assert(!children_.empty());
   }
 
@@ -48,7 +47,7 @@ class RandomRoute {
 
  private:
   const std::vector<std::shared_ptr<RouteHandleIf>> children_;
-  std::ranlux24_base gen_;
+  Xoshiro256Plus gen_;
 };
 
 }} // facebook::memcache
@@ -48,6 +48,23 @@ TEST(Ch3Func, basic) {
   EXPECT_TRUE(67101 == func_99999(test_max_key));
 }
 
+TEST(Ch3Func, seeded) {
+  //furc_hash_seeded must agree with furc_hash for any key and pool size
+  for (auto m : std::vector<uint32_t>{2, 3, 100, 99999,
+                                      furc_maximum_pool_size()}) {
+    for (size_t i = 0; i < 1000; ++i) {
+      auto key = folly::to<std::string>(i);
+      auto seed = furc_seed_hash(key.data(), key.size());
+      EXPECT_EQ(furc_hash(key.data(), key.size(), m),
+                furc_hash_seeded(seed, m));
+    }
+  }
+
+  Ch3HashFunc func_100(100);
+  EXPECT_EQ(func_100("sample"),
+            func_100(furc_seed_hash("sample", 6)));
+}
+
 TEST(Ch3Func, ch3_3) {
   Ch3HashFunc ch3_func_3(3);
   std::vector<size_t> ch3_counts(3, 0);
@@ -172,4 +172,62 @@ TEST(CompressionCodecManager, invalidDictionary) {
   validateCodec(codecMap->get(3));
 }
 
+TEST(CompressionCodecManager, poolRanges) {
+  std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs;
+  for (uint32_t i = 1; i <= 32; ++i) {
+    std::string poolTag;
+    if (i >= 17 && i <= 24) {
+      poolTag = "poolA";
+    } else if (i >= 25) {
+      poolTag = "poolB";
+    }
+    codecConfigs.emplace(
+        i,
+        folly::make_unique<CodecConfig>(
+            i, CompressionCodecType::LZ4, createBinaryData(i * 1024),
+            CompressionCodecOptions{}, poolTag));
+  }
+
+  CompressionCodecManager codecManager(std::move(codecConfigs));
+  auto codecMap = codecManager.getCodecMap();
+
+  EXPECT_TRUE(codecMap);
+  EXPECT_EQ(1, codecMap->getIdRange().firstId);
+  EXPECT_EQ(32, codecMap->getIdRange().size);
+
+  auto poolA = codecMap->getIdRange("poolA");
+  EXPECT_EQ(17, poolA.firstId);
+  EXPECT_EQ(8, poolA.size);
+
+  auto poolB = codecMap->getIdRange("poolB");
+  EXPECT_EQ(25, poolB.firstId);
+  EXPECT_EQ(8, poolB.size);
+
+  // unknown pools fall back to the full range
+  auto other = codecMap->getIdRange("poolC");
+  EXPECT_EQ(1, other.firstId);
+  EXPECT_EQ(32, other.size);
+}
+
+TEST(CompressionCodecManager, poolRangesNotContiguous) {
+  std::unordered_map<uint32_t, CodecConfigPtr> codecConfigs;
+  for (uint32_t i = 1; i <= 8; ++i) {
+    // "poolA" codecs interleaved with untagged ones
+    std::string poolTag = (i % 2 == 0) ? "poolA" : "";
+    codecConfigs.emplace(
+        i,
+        folly::make_unique<CodecConfig>(
+            i, CompressionCodecType::LZ4, createBinaryData(i * 1024),
+            CompressionCodecOptions{}, poolTag));
+  }
+
+  CompressionCodecManager codecManager(std::move(codecConfigs));
+  auto codecMap = codecManager.getCodecMap();
+
+  // a non-contiguous pool tag is dropped, the pool uses the full range
+  auto poolA = codecMap->getIdRange("poolA");
+  EXPECT_EQ(1, poolA.firstId);
+  EXPECT_EQ(8, poolA.size);
+}
+
 }}}  // facebook::memcache::test
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <folly/Format.h>
+
+#include "mcrouter/lib/CompressionDictionaryTrainer.h"
+
+using namespace facebook::memcache;
+
+namespace {
+
+// A value with a common schema-like prefix and a varying payload, the
+// kind of redundancy a preset dictionary should capture.
+std::string makeValue(size_t i) {
+  return folly::sformat(
+      "{{\"type\":\"user_profile\",\"version\":3,\"payload\":\"{}\"}}",
+      i * 2654435761ULL);
+}
+
+} // anonymous namespace
+
+TEST(CompressionDictionaryTrainer, tooFewSamples) {
+  CompressionDictionaryTrainer trainer;
+  for (size_t i = 0; i < 10; ++i) {
+    trainer.sample("pool1", makeValue(i));
+  }
+  EXPECT_TRUE(trainer.train("pool1").empty());
+  EXPECT_TRUE(trainer.train("no_such_pool").empty());
+}
+
+TEST(CompressionDictionaryTrainer, trainsSharedContent) {
+  CompressionDictionaryTrainer trainer;
+  for (size_t i = 0; i < 200; ++i) {
+    trainer.sample("pool1", makeValue(i));
+  }
+
+  auto dictionary = trainer.train("pool1");
+  EXPECT_FALSE(dictionary.empty());
+  EXPECT_LE(dictionary.size(), 64 * 1024);
+  // The shared schema bytes must make it into the dictionary.
+  EXPECT_NE(dictionary.find("\"type\":\"user_profile\""), std::string::npos);
+
+  // Pools are independent.
+  EXPECT_TRUE(trainer.train("pool2").empty());
+}
+
+TEST(CompressionDictionaryTrainer, ignoresEmptyValues) {
+  CompressionDictionaryTrainer trainer;
+  for (size_t i = 0; i < 200; ++i) {
+    trainer.sample("pool1", "");
+  }
+  EXPECT_TRUE(trainer.train("pool1").empty());
+}
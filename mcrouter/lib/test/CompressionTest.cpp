@@ -215,4 +215,74 @@ TEST(Lz4CompressionCodec, uncompressChained) {
 }
 #endif // FOLLY_HAVE_LIBLZ4
 
+#if FOLLY_HAVE_LIBZSTD
+TEST(ZstdCompressionCodec, compressAndUncompress) {
+  auto compressor = createCompressionCodec(CompressionCodecType::ZSTD,
+                                           getAsciiDictionary(), 1);
+  testCompressAndUncompress(compressor.get(), *getAsciiReply());
+}
+
+TEST(ZstdCompressionCodec, compressAndUncompress_largeValues) {
+  auto compressor = createCompressionCodec(CompressionCodecType::ZSTD,
+                                           getAsciiDictionary(), 1);
+  testCompressAndUncompress(compressor.get(), *getRandomLargeReply());
+}
+
+TEST(ZstdCompressionCodec, compressTwice) {
+  auto compressor = createCompressionCodec(CompressionCodecType::ZSTD,
+                                           getAsciiDictionary(), 1);
+  testCompressTwice(compressor.get(), *getAsciiReply());
+}
+
+TEST(ZstdCompressionCodec, compressChained) {
+  auto compressor = createCompressionCodec(CompressionCodecType::ZSTD,
+                                           getAsciiDictionary(), 1);
+  auto data = getAsciiReply();
+  for (size_t i = 2; i < data->length(); ++i) {
+    testCompressChained(compressor.get(), *data, i);
+  }
+}
+
+TEST(ZstdCompressionCodec, uncompressChained) {
+  auto compressor = createCompressionCodec(CompressionCodecType::ZSTD,
+                                           getAsciiDictionary(), 1);
+  testUncompressChained(compressor.get(), *getAsciiReply(), 3);
+}
+#endif // FOLLY_HAVE_LIBZSTD
+
+#if FOLLY_HAVE_LIBZ
+TEST(DeflateCompressionCodec, compressAndUncompress) {
+  auto compressor = createCompressionCodec(CompressionCodecType::DEFLATE,
+                                           getAsciiDictionary(), 1);
+  testCompressAndUncompress(compressor.get(), *getAsciiReply());
+}
+
+TEST(DeflateCompressionCodec, compressAndUncompress_largeValues) {
+  auto compressor = createCompressionCodec(CompressionCodecType::DEFLATE,
+                                           getAsciiDictionary(), 1);
+  testCompressAndUncompress(compressor.get(), *getRandomLargeReply());
+}
+
+TEST(DeflateCompressionCodec, compressTwice) {
+  auto compressor = createCompressionCodec(CompressionCodecType::DEFLATE,
+                                           getAsciiDictionary(), 1);
+  testCompressTwice(compressor.get(), *getAsciiReply());
+}
+
+TEST(DeflateCompressionCodec, compressChained) {
+  auto compressor = createCompressionCodec(CompressionCodecType::DEFLATE,
+                                           getAsciiDictionary(), 1);
+  auto data = getAsciiReply();
+  for (size_t i = 2; i < data->length(); ++i) {
+    testCompressChained(compressor.get(), *data, i);
+  }
+}
+
+TEST(DeflateCompressionCodec, uncompressChained) {
+  auto compressor = createCompressionCodec(CompressionCodecType::DEFLATE,
+                                           getAsciiDictionary(), 1);
+  testUncompressChained(compressor.get(), *getAsciiReply(), 3);
+}
+#endif // FOLLY_HAVE_LIBZ
+
 }}} // facebook::memcache::test
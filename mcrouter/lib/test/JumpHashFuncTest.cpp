@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <folly/Conv.h>
+
+#include "mcrouter/lib/JumpHashFunc.h"
+
+using namespace facebook::memcache;
+
+TEST(JumpHashFunc, basic) {
+  JumpHashFunc func_1(1);
+  JumpHashFunc func_100(100);
+
+  EXPECT_EQ(0, func_1("sample"));
+  EXPECT_EQ(0, func_1(""));
+  EXPECT_LT(func_100("sample"), 100);
+  EXPECT_LT(func_100(""), 100);
+}
+
+TEST(JumpHashFunc, distribution) {
+  JumpHashFunc func_10(10);
+  std::vector<size_t> counts(10, 0);
+
+  for (size_t i = 0; i < 10000; ++i) {
+    auto key = folly::to<std::string>(i);
+    ++counts[func_10(key)];
+  }
+
+  for (auto count : counts) {
+    EXPECT_GT(count, 900);
+    EXPECT_LT(count, 1100);
+  }
+}
+
+TEST(JumpHashFunc, consistent) {
+  /* Growing the pool at the end only moves keys onto the new servers. */
+  JumpHashFunc func_10(10);
+  JumpHashFunc func_11(11);
+
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>(i);
+    auto idx_10 = func_10(key);
+    auto idx_11 = func_11(key);
+    EXPECT_TRUE(idx_10 == idx_11 || idx_11 == 10);
+  }
+}
+
+TEST(WeightedJumpHashFunc, allWeightsOne) {
+  /* With all weights at 1.0 every first try is accepted, so the result
+     matches plain jump hash. */
+  JumpHashFunc func(10);
+  WeightedJumpHashFunc weightedFunc(std::vector<double>(10, 1.0));
+
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>(i);
+    EXPECT_EQ(func(key), weightedFunc(key));
+  }
+}
+
+TEST(WeightedJumpHashFunc, lowWeight) {
+  std::vector<double> weights(10, 1.0);
+  weights[3] = 0.1;
+  WeightedJumpHashFunc func(weights);
+  std::vector<size_t> counts(10, 0);
+
+  for (size_t i = 0; i < 10000; ++i) {
+    auto key = folly::to<std::string>(i);
+    ++counts[func(key)];
+  }
+
+  /* Server 3 should see roughly a tenth of its unweighted share. */
+  EXPECT_LT(counts[3], 300);
+  for (size_t i = 0; i < counts.size(); ++i) {
+    if (i != 3) {
+      EXPECT_GT(counts[i], 900);
+    }
+  }
+}
@@ -320,3 +320,47 @@ TEST(Lz4Immutable, chained_binary) {
   auto decompressedStr = decompressed->moveToFbString();
   EXPECT_EQ(sourceStr, decompressedStr);
 }
+
+TEST(Lz4Immutable, chainedOutput_ascii) {
+  auto dictionary = getAsciiDictionary();
+  Lz4Immutable compressor(dictionary->clone());
+
+  auto source = getRandomAsciiData(8 * 1024, 64 * 1024);
+  auto sourceSize = source->computeChainDataLength();
+
+  // Compress
+  auto compressed = compressor.compress(*source);
+
+  // Uncompress into a chain of small buffers
+  const size_t chunkSize = 1024;
+  auto decompressed =
+      compressor.decompressIntoChain(*compressed, sourceSize, chunkSize);
+
+  EXPECT_TRUE(decompressed);
+  EXPECT_EQ(sourceSize, decompressed->computeChainDataLength());
+  EXPECT_EQ((sourceSize + chunkSize - 1) / chunkSize,
+            decompressed->countChainElements());
+  auto sourceStr = source->moveToFbString();
+  auto decompressedStr = decompressed->moveToFbString();
+  EXPECT_EQ(sourceStr, decompressedStr);
+}
+TEST(Lz4Immutable, chainedOutput_binary) {
+  auto dictionary = getRandomBinaryData(64 * 1024);
+  Lz4Immutable compressor(dictionary->clone());
+
+  auto source = getRandomBinaryCompressibleData(*dictionary);
+  auto sourceSize = source->computeChainDataLength();
+
+  // Compress
+  auto compressed = compressor.compress(*source);
+
+  // Uncompress into a chain of small buffers
+  auto decompressed =
+      compressor.decompressIntoChain(*compressed, sourceSize, 1024);
+
+  EXPECT_TRUE(decompressed);
+  EXPECT_EQ(sourceSize, decompressed->computeChainDataLength());
+  auto sourceStr = source->moveToFbString();
+  auto decompressedStr = decompressed->moveToFbString();
+  EXPECT_EQ(sourceStr, decompressedStr);
+}
@@ -10,6 +10,7 @@
 #include <ctime>
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -192,3 +193,78 @@ TEST(migrateRouteTest, migrate) {
     }
   });
 }
+
+TEST(migrateRouteTest, ramp) {
+  time_t mock_time = 1000000;
+  auto interval = 50;
+
+  auto tp_func = [&mock_time]() {
+    return mock_time;
+  };
+  typedef decltype(tp_func) TimeProviderFunc;
+
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"),
+                            UpdateRouteTestData(),
+                            DeleteRouteTestData(mc_res_deleted)),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b"),
+                            UpdateRouteTestData(),
+                            DeleteRouteTestData(mc_res_notfound)),
+  };
+  auto route_handles = get_route_handles(test_handles);
+
+  TestFiberManager fm;
+
+  fm.run([&]() {
+    TestRouteHandle<MigrateRoute<TestRouteHandleIf, TimeProviderFunc>> rh(
+      route_handles[0], route_handles[1], mock_time, interval, tp_func,
+      /* ramp */ true);
+
+    auto routeKeys = [&rh]() {
+      for (int i = 0; i < 100; ++i) {
+        rh.route(TypedThriftRequest<cpp2::McGetRequest>(
+            "key" + std::to_string(i)));
+      }
+    };
+    auto clearSeen = [&test_handles]() {
+      (test_handles[0]->saw_keys).clear();
+      (test_handles[1]->saw_keys).clear();
+    };
+
+    // At the very start of the window everything still goes to from_.
+    routeKeys();
+    EXPECT_EQ(100, test_handles[0]->saw_keys.size());
+    EXPECT_EQ(0, test_handles[1]->saw_keys.size());
+    clearSeen();
+
+    // Halfway through, roughly half of the key buckets moved over.
+    mock_time += interval;
+    routeKeys();
+    EXPECT_LT(20, test_handles[0]->saw_keys.size());
+    EXPECT_LT(20, test_handles[1]->saw_keys.size());
+
+    // The assignment is deterministic: replaying the keys changes nothing
+    // but the counts doubling.
+    auto fromSeen = test_handles[0]->saw_keys;
+    auto toSeen = test_handles[1]->saw_keys;
+    routeKeys();
+    EXPECT_EQ(2 * fromSeen.size(), test_handles[0]->saw_keys.size());
+    EXPECT_EQ(2 * toSeen.size(), test_handles[1]->saw_keys.size());
+    clearSeen();
+
+    // Past the end of the window everything goes to to_.
+    mock_time += interval;
+    routeKeys();
+    EXPECT_EQ(0, test_handles[0]->saw_keys.size());
+    EXPECT_EQ(100, test_handles[1]->saw_keys.size());
+
+    // Deletes keep fanning out to both pools inside the window.
+    mock_time -= interval;
+    clearSeen();
+    auto reply_del = rh.route(TypedThriftRequest<cpp2::McDeleteRequest>(
+        "key_del"));
+    EXPECT_EQ(mc_res_notfound, reply_del.result());
+    EXPECT_EQ(1, test_handles[0]->saw_keys.size());
+    EXPECT_EQ(1, test_handles[1]->saw_keys.size());
+  });
+}
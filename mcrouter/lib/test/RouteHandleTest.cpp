@@ -368,6 +368,46 @@ TEST(routeHandleTest, hashNoSalt) {
     });
 }
 
+TEST(routeHandleTest, hashBatch) {
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c")),
+  };
+
+  TestFiberManager fm;
+
+  TestRouteHandle<HashRoute<TestRouteHandleIf, HashFunc>> rh(
+    get_route_handles(test_handles),
+    /* salt= */ "",
+    HashFunc(test_handles.size()));
+
+  fm.run([&]() {
+      std::vector<TypedThriftRequest<cpp2::McGetRequest>> reqs;
+      for (auto key : {"0", "4", "2", "3"}) {
+        reqs.emplace_back(key);
+      }
+      std::vector<const TypedThriftRequest<cpp2::McGetRequest>*> reqPtrs;
+      for (const auto& req : reqs) {
+        reqPtrs.push_back(&req);
+      }
+
+      auto replies = rh.routeBatch(reqPtrs);
+
+      /* Replies come back in request order */
+      EXPECT_EQ(4, replies.size());
+      EXPECT_EQ("a", replies[0].valueRangeSlow().str());
+      EXPECT_EQ("b", replies[1].valueRangeSlow().str());
+      EXPECT_EQ("c", replies[2].valueRangeSlow().str());
+      EXPECT_EQ("a", replies[3].valueRangeSlow().str());
+
+      /* Each destination saw its group in one call, in order */
+      EXPECT_EQ((vector<string>{"0", "3"}), test_handles[0]->saw_keys);
+      EXPECT_EQ(vector<string>{"4"}, test_handles[1]->saw_keys);
+      EXPECT_EQ(vector<string>{"2"}, test_handles[2]->saw_keys);
+    });
+}
+
 TEST(routeHandleTest, hashSalt) {
   vector<std::shared_ptr<TestHandle>> test_handles{
     make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
@@ -49,6 +49,18 @@ TEST(WeightedCh3HashFunc, basic) {
   EXPECT_TRUE(67101 == func_99999(test_max_key));
 }
 
+/* Hash funcs with the same weights share one ring snapshot */
+TEST(WeightedCh3HashFunc, sharedRing) {
+  std::vector<double> weights{0.5, 1.0, 0.25};
+  WeightedCh3HashFunc func_a(weights);
+  WeightedCh3HashFunc func_b(weights);
+  WeightedCh3HashFunc func_c({0.5, 1.0});
+
+  EXPECT_TRUE(&func_a.weights() == &func_b.weights());
+  EXPECT_FALSE(&func_a.weights() == &func_c.weights());
+  EXPECT_TRUE(weights == func_a.weights());
+}
+
 /* Zero weight -> will give up and return a valid index */
 TEST(WeightedCh3HashFunc, zeroWeight) {
   WeightedCh3HashFunc func_1({0.0});
@@ -114,3 +126,34 @@ TEST(WeightedCh3HashFunc, randomWeights) {
     {1016, 1252, 288, 2354, 661, 195, 247, 122, 1668, 2197}) ==
     wch3_counts);
 }
+
+/* Weight updates through a slot take effect without rebuilding the func */
+TEST(WeightedCh3HashFunc, liveWeights) {
+  auto slot = std::make_shared<WeightedCh3RingSlot>(
+    WeightedCh3Ring::get({1.0, 1.0, 1.0}));
+  WeightedCh3HashFunc live(slot);
+  WeightedCh3HashFunc before({1.0, 1.0, 1.0});
+  WeightedCh3HashFunc after({1.0, 1.0, 0.0});
+
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>(i);
+    EXPECT_TRUE(before(key) == live(key));
+  }
+
+  /* Drain the 3rd box */
+  auto version = slot->version();
+  slot->setWeights({1.0, 1.0, 0.0});
+  EXPECT_TRUE(slot->version() != version);
+
+  for (size_t i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>(i);
+    EXPECT_TRUE(after(key) == live(key));
+  }
+
+  /* Funcs built from the slot later see the current weights */
+  WeightedCh3HashFunc fresh(slot);
+  EXPECT_TRUE(after("sample") == fresh("sample"));
+
+  EXPECT_THROW(slot->setWeights({1.0, 1.0}), std::logic_error);
+  EXPECT_THROW(slot->setWeights({1.0, 1.0, 1.5}), std::logic_error);
+}
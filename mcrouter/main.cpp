@@ -39,11 +39,14 @@
 
 #include "mcrouter/async.h"
 #include "mcrouter/config.h"
+#include "mcrouter/ConfigCost.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/flavor.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
 #include "mcrouter/options.h"
 #include "mcrouter/proxy.h"
+#include "mcrouter/ProxyConfig.h"
 #include "mcrouter/server.h"
 #include "mcrouter/standalone_options.h"
 #include "mcrouter/stats.h"
@@ -62,7 +65,9 @@ constexpr int kExitStatusUnrecoverableError = 3;
 enum class ValidateConfigMode {
   NONE = 0,
   EXIT = 1,
-  RUN = 2
+  RUN = 2,
+  /* Like EXIT, but also print a resource-cost report for the config. */
+  COST = 3
 };
 
 static McrouterOptions opts;
@@ -110,9 +115,12 @@ static void print_usage_and_die(char* progname, int errorCode) {
   print_usage("-h, --help", "help");
   print_usage("-V, --version", "version");
   print_usage("-v, --verbosity", "Set verbosity of VLOG");
-  print_usage("    --validate-config=exit|run",
+  print_usage("    --validate-config=exit|run|cost",
               "Enable strict config checking. If 'exit' or no argument "
               "is provided, exit immediately with good or error status. "
+              "If 'cost' is provided, also print a resource-cost report "
+              "(route handles, destinations, estimated per-proxy memory) "
+              "for the config before exiting. "
               "Otherwise keep running if config is valid.");
 
   fprintf(stderr, "\nRETURN VALUE\n");
@@ -264,6 +272,8 @@ static void parse_options(int argc,
           *validate_configs = ValidateConfigMode::EXIT;
         } else if (strcmp(optarg, "run") == 0) {
           *validate_configs = ValidateConfigMode::RUN;
+        } else if (strcmp(optarg, "cost") == 0) {
+          *validate_configs = ValidateConfigMode::COST;
         } else {
           LOG(ERROR) << "Invalid argument for --validate-config: '"
                      << optarg << "'. Ignoring the option.";
@@ -432,12 +442,17 @@ int main(int argc, char **argv) {
   if (validate_configs != ValidateConfigMode::NONE) {
     failure::addHandler(failure::handlers::throwLogicError());
 
-    if (validate_configs == ValidateConfigMode::EXIT) {
+    if (validate_configs == ValidateConfigMode::EXIT ||
+        validate_configs == ValidateConfigMode::COST) {
       try {
         auto router = McrouterInstance::init("standalone-validate", opts);
         if (router == nullptr) {
           throw std::runtime_error("Couldn't create mcrouter");
         }
+        if (validate_configs == ValidateConfigMode::COST) {
+          auto config = router->getProxy(0)->getConfig();
+          printf("%s\n", toPrettySortedJson(configCostReport(*config)).c_str());
+        }
       } catch (const std::exception& e) {
         LOG(ERROR) << "CRITICAL: Failed to initialize mcrouter: " << e.what();
         exit(kExitStatusUnrecoverableError);
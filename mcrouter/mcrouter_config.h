@@ -27,6 +27,8 @@ static_assert(false, "mcrouter: invalid build");
 #include <folly/Range.h>
 #include <folly/io/async/EventBase.h>
 
+#include "mcrouter/TscClock.h"
+
 #define MCROUTER_RUNTIME_VARS_DEFAULT ""
 #define MCROUTER_STATS_ROOT_DEFAULT "/var/mcrouter/stats"
 #define DEBUG_FIFO_ROOT_DEFAULT "/var/mcrouter/fifos"
@@ -81,10 +83,13 @@ struct AdditionalProxyRequestLogger {
 
 /**
  * @return monotonic time suitable for measuring intervals in microseconds.
+ *
+ * Proxy threads get a syscall-free TSC-based reading (their TscClock is
+ * kept calibrated by the event loop); other threads read the steady
+ * clock.
  */
 inline int64_t nowUs() {
-  return std::chrono::duration_cast<std::chrono::microseconds>(
-    std::chrono::steady_clock::now().time_since_epoch()).count();
+  return TscClock::nowUs();
 }
 
 /**
@@ -61,16 +61,112 @@ mcrouter_option_string(
   "async-dir", 'a',
   "container directory for async storage spools")
 
+mcrouter_option_string(
+  async_spool_failover, "",
+  "async-dir-failover", no_short,
+  "Secondary spool root tried when opening a spool file under async-dir "
+  "fails; point it at a different disk (or a remote mount) so a full or "
+  "broken primary disk doesn't drop asynclog entries. Empty disables the "
+  "failover tier.")
+
+mcrouter_option_integer(
+  size_t, asynclog_spool_ring_size, 1024,
+  "asynclog-spool-ring-size", no_short,
+  "Capacity (in entries) of the lock-free in-memory tier of the asynclog "
+  "spool. Records are acknowledged once buffered in the ring and drained "
+  "to disk by the awriter thread, so delete storms are absorbed in memory "
+  "instead of stalling on one disk. When the ring is full, spooling falls "
+  "back to the blocking awriter path. Values below 2 disable the memory "
+  "tier.")
+
+mcrouter_option_integer(
+  size_t, asynclog_lanes, 1,
+  "asynclog-lanes", no_short,
+  "Number of asynclog writer lanes. Entries are partitioned across lanes "
+  "by a hash of the pool name; each lane has its own awriter thread and "
+  "spool file sequence (with the usual naming and hourly rotation), so "
+  "replay of one backed-up pool isn't serialized behind the others. "
+  "1 keeps the single-spool behavior.")
+
 mcrouter_option_toggle(
   use_asynclog_version2, false,
   "use-asynclog-version2", no_short,
   "Enable using the asynclog version 2.0")
 
+mcrouter_option_toggle(
+  use_asynclog_binary_format, false,
+  "use-asynclog-binary-format", no_short,
+  "Spool asynclog entries as length-prefixed binary records instead of "
+  "JSON text (see AsynclogBinaryFormat.h)")
+
+mcrouter_option_integer(
+  size_t, asynclog_retry_count, 0,
+  "asynclog-retry-count", no_short,
+  "Number of times to retry a failed delete in memory before spilling "
+  "it to the asynclog. 0 sends failed deletes straight to the spool.")
+
+mcrouter_option_integer(
+  uint32_t, asynclog_retry_interval_ms, 200,
+  "asynclog-retry-interval-ms", no_short,
+  "Delay between in-memory retries of a failed delete.")
+
+mcrouter_option_integer(
+  size_t, asynclog_retry_queue_size, 1024,
+  "asynclog-retry-queue-size", no_short,
+  "Maximum number of failed deletes queued for in-memory retry per "
+  "proxy; overflow spills straight to the asynclog.")
+
+mcrouter_option_toggle(
+  shared_connections, false,
+  "shared-connections", no_short,
+  "Share one connection per destination across all proxy threads for "
+  "low-traffic destinations: a hashed owner thread holds the connection "
+  "and the other proxies hand their requests off to it. Busy "
+  "destinations keep a dedicated connection per thread (see "
+  "--shared-connections-hot-rps).")
+
+mcrouter_option_integer(
+  size_t, shared_connections_hot_rps, 100,
+  "shared-connections-hot-rps", no_short,
+  "With --shared-connections, a destination receiving at least this "
+  "many requests per second on a proxy thread gets a dedicated "
+  "connection on that thread.")
+
 mcrouter_option_integer(
   size_t, num_proxies, DEFAULT_NUM_PROXIES,
   "num-proxies", no_short,
   "adjust how many proxy threads to run")
 
+mcrouter_option_integer(
+  size_t, max_proxies, 0,
+  "max-proxies", no_short,
+  "Upper bound on the number of proxy threads when scaling at runtime "
+  "(see McrouterInstance::addProxyThread()). With a runtime vars file, "
+  "the 'num_proxies' variable moves the live thread count between 1 and "
+  "this bound; new sessions round-robin over the current set and retired "
+  "threads drain before exiting. 0 disables runtime scaling. Only "
+  "supported when mcrouter owns its proxy threads (embedded mode without "
+  "external event bases), and incompatible with --shared-connections.")
+
+mcrouter_option_string(
+  compiled_config_path, "",
+  "compiled-config-path", no_short,
+  "If non-empty, cache the macro-expanded config in a versioned binary"
+  " file at this path after every successful configuration. On the next"
+  " start the cache is validated against the digests of the config"
+  " sources and loaded instead of parsing and expanding JSON; on any"
+  " mismatch mcrouter silently falls back to the JSON path and rewrites"
+  " the cache.")
+
+mcrouter_option_string(
+  numa_policy, "",
+  "numa-policy", no_short,
+  "NUMA placement policy for proxy threads. \"interleave\" pins proxy"
+  " threads round-robin across NUMA nodes, so memory the proxy allocates"
+  " after startup (fiber stacks, request buffers) is placed node-locally"
+  " by first touch. Empty (default) leaves placement to the scheduler."
+  " Ignored on hosts with a single NUMA node.")
+
 mcrouter_option_integer(
   size_t, client_queue_size, 1024,
   no_long, no_short,
@@ -90,6 +186,14 @@ mcrouter_option_integer(
   "Force client queue notification if last drain was at least this long ago."
   "  If 0, this logic is disabled.")
 
+mcrouter_option_toggle(
+  work_stealing, false, "work-stealing", no_short,
+  "Bind each request to the least loaded proxy thread at send time"
+  " instead of the client's pinned proxy thread when the pinned one is"
+  " significantly busier. Evens out per-thread load under skewed"
+  " clients, but replies for one client may then be delivered"
+  " concurrently from several proxy threads.")
+
 mcrouter_option_integer(
   size_t, big_value_split_threshold, 0,
   "big-value-split-threshold", no_short,
@@ -99,8 +203,38 @@ mcrouter_option_integer(
 mcrouter_option_integer(
   size_t, big_value_batch_size, 10,
   "big-value-batch-size", no_short,
-  "If nonzero, big value chunks are written/read in batches of at most"
-  " this size.  Used to prevent queue build up with really large values")
+  "If nonzero, at most this many big value chunks are in flight at a"
+  " time.  Used to prevent queue build up with really large values")
+
+mcrouter_option_toggle(
+  big_value_dedup_chunks, false,
+  "big-value-dedup-chunks", no_short,
+  "Address big value chunks by content hash and skip rewriting chunks"
+  " that did not change since the previous write of the same key."
+  " Only safe for big values stored without expiration times")
+
+mcrouter_option_integer(
+  size_t, hot_key_cache_size, 0,
+  "hot-key-cache-size", no_short,
+  "If nonzero, keep an in-process LRU cache of up to this many hot keys"
+  " per proxy thread and serve plain gets for them locally. Keys are"
+  " considered hot based on a count-min sketch of recent get traffic.")
+
+mcrouter_option_integer(
+  size_t, hot_key_cache_ttl_ms, 1000,
+  "hot-key-cache-ttl-ms", no_short,
+  "TTL of hot key cache entries in milliseconds. Local writes invalidate"
+  " eagerly; this bounds staleness from writes that go through other"
+  " mcrouter instances.")
+
+mcrouter_option_integer(
+  size_t, hot_key_cache_snapshot_interval_ms, 0,
+  "hot-key-cache-snapshot-interval-ms", no_short,
+  "If nonzero, periodically persist each proxy's current hot key set to a"
+  " snapshot file under --async-dir and seed the hot key sketch from it on"
+  " startup, so keys that were hot before a restart are cached again after"
+  " their first hit instead of re-qualifying from scratch. Values are"
+  " never persisted. 0 (default) disables snapshots.")
 
 mcrouter_option_integer(
   size_t, fibers_max_pool_size, 1000,
@@ -113,6 +247,19 @@ mcrouter_option_integer(
   "Size of stack in bytes to allocate per fiber."
   " 0 means use fibers library default.")
 
+mcrouter_option_integer(
+  size_t, fibers_small_stack_size, 8 * 1024,
+  "fibers-small-stack-size", no_short,
+  "Stack size in bytes for fibers serving shallow route trees."
+  " 0 disables the small-stack fiber pool and runs everything on"
+  " fibers-stack-size stacks.")
+
+mcrouter_option_integer(
+  size_t, fibers_small_stack_max_depth, 4,
+  "fibers-small-stack-max-depth", no_short,
+  "Route trees at most this many route handles deep run on"
+  " small-stack fibers (see fibers-small-stack-size).")
+
 mcrouter_option_integer(
   size_t, fibers_record_stack_size_every, 100000,
   "fibers-record-stack-size-every", no_short,
@@ -165,6 +312,17 @@ mcrouter_option_integer(
   "keepalive-idle", 'I',
   "set TCP KEEPALIVE idle parameter in seconds")
 
+mcrouter_option_integer(
+  unsigned int, dns_prefetch_deadline_ms, 1000,
+  "dns-prefetch-deadline-ms", no_short,
+  "After each (re)configuration, resolve the hostnames of newly configured"
+  " destinations on parallel background threads, waiting at most this many"
+  " ms. Resolutions still running at the deadline finish in the background;"
+  " until they do, connections use previously-known addresses or resolve"
+  " inline as before. 0 disables the prefetch stage (connect-time lookups"
+  " still go through the shared DNS cache). Has no effect on destinations"
+  " configured with numeric addresses.")
+
 mcrouter_option_integer(
   unsigned int, reset_inactive_connection_interval, 60000,
   "reset-inactive-connection-interval", no_short,
@@ -176,6 +334,32 @@ mcrouter_option_integer(
   "tcp-rto-min", no_short,
   "adjust the minimum TCP retransmit timeout (ms) to memcached")
 
+mcrouter_option_toggle(
+  enable_tcp_fast_open, false, "enable-tcp-fast-open", no_short,
+  "Enable TCP Fast Open on destination connections and optimistically"
+  " send pending requests along with the connection handshake"
+  " (non-SSL, out-of-order protocols only).")
+
+mcrouter_option_toggle(
+  udp_gets, false, "udp-gets", no_short,
+  "Send get-like requests that fit a single datagram over UDP to ascii"
+  " destinations, falling back to TCP on truncation or loss.")
+
+mcrouter_option_toggle(
+  probe_protocol_upgrade, false, "probe-protocol-upgrade", no_short,
+  "Probe umbrella destinations for caret support once per host:port"
+  " and upgrade new connections to caret where available, without"
+  " waiting for the pool configuration to change.")
+
+mcrouter_option_toggle(
+  reply_passthrough, false, "reply-passthrough", no_short,
+  "Keep the raw body of uncompressed caret replies alongside the parsed"
+  " reply, so replies forwarded to caret clients unchanged are re-framed"
+  " (with the client's request id) instead of re-serialized. Any route"
+  " handle that modifies a reply falls back to normal serialization for"
+  " that reply. Costs pinning the destination read buffer for the"
+  " lifetime of each reply.")
+
 mcrouter_option_integer(
   uint64_t, target_max_inflight_requests, 0,
   "target-max-inflight-requests", no_short,
@@ -265,6 +449,16 @@ mcrouter_option_toggle(
   "compression algorithms/dictionaries supported by the client. Only "
   "compresses caret protocol replies.")
 
+mcrouter_option_integer(
+  unsigned int, compression_dictionary_training_interval_s, 0,
+  "compression-dictionary-training-interval", no_short,
+  "If positive, sample values off live traffic and train a compression "
+  "dictionary per pool every <interval> seconds, in a low-priority "
+  "background thread. Trained dictionaries are handed to the callback "
+  "registered via setDictionaryTrainedCallback(), which is responsible "
+  "for assigning codec ids and distributing them. 0 (default) disables "
+  "training. Requires --enable-compression.")
+
 mcrouter_option_group("Routing configuration")
 
 mcrouter_option_toggle(
@@ -327,6 +521,29 @@ mcrouter_option_integer(
   "reconfiguration-delay-ms", no_short,
   "Delay between config files change and mcrouter reconfiguration.")
 
+mcrouter_option_integer(
+  uint64_t, config_canary_rate, 0,
+  "config-canary-rate", no_short,
+  "If positive, a newly pushed config is first installed as a canary: "
+  "requests whose routing key hashes into 1 out of every N route through "
+  "it, everything else stays on the running config.  After "
+  "--config-canary-duration-ms the canary is promoted if its error rate "
+  "and mean latency are within --config-canary-slack-percent of the "
+  "running config's over the same window, and discarded otherwise. "
+  "0 swaps configs atomically (default).")
+
+mcrouter_option_integer(
+  int, config_canary_duration_ms, 60000,
+  "config-canary-duration-ms", no_short,
+  "How long a canary config (see --config-canary-rate) serves its slice "
+  "of traffic before mcrouter decides between promotion and rollback.")
+
+mcrouter_option_integer(
+  int, config_canary_slack_percent, 20,
+  "config-canary-slack-percent", no_short,
+  "Relative headroom the canary config's error rate and mean latency are "
+  "allowed over the running config's before the push is rolled back.")
+
 mcrouter_option_string_map(
   config_params, "config-params", no_short,
   "Params for config preprocessor in format 'name1:value1,name2:value2'. "
@@ -362,6 +579,45 @@ mcrouter_option_integer(
   "The maximum number of machines we can mark TKO if they don't have a hard"
   " failure.")
 
+mcrouter_option_string(
+  failure_domain_policy, "",
+  "failure-domain-policy", no_short,
+  "Groups destinations into failure domains for aggregated health checks."
+  " \"host\" groups by hostname; \"rack\" and \"cluster\" strip one or two"
+  " leading hostname labels respectively (numeric addresses are left"
+  " ungrouped). Empty (default) disables failure domains.")
+
+mcrouter_option_integer(
+  size_t, failure_domain_tko_threshold, 0,
+  "failure-domain-tko-threshold", no_short,
+  "Treat a whole failure domain as down once this many of its destinations"
+  " are marked TKO, so remaining members are skipped without waiting for"
+  " their own failures. 0 (default) disables the aggregated check."
+  " Requires --failure-domain-policy.")
+
+mcrouter_option_integer(
+  size_t, hedging_delay_ms, 0,
+  "hedging-delay-ms", no_short,
+  "Speculatively send get-like requests to the first failover target if the"
+  " normal destination hasn't replied within this many ms, taking whichever"
+  " reply comes back first. 0 (default) disables hedging.")
+
+mcrouter_option_integer(
+  size_t, hedging_latency_factor, 4,
+  "hedging-latency-factor", no_short,
+  "When hedging is enabled, also scale the hedging delay to this multiple"
+  " of the smoothed average request latency, whichever is larger than"
+  " --hedging-delay-ms. 0 disables the latency-based delay.")
+
+mcrouter_option_toggle(
+  failover_tko_precheck, false,
+  "failover-tko-precheck", no_short,
+  "Before sending to the normal failover target, walk its route handle"
+  " subtree and check the TKO state of every destination it can reach"
+  " (cheap atomic reads, no network). If all of them are marked down, go"
+  " straight to the failover targets instead of discovering the failure"
+  " per request.")
+
 mcrouter_option_toggle(
   allow_only_gets, false,
   "allow-only-gets", no_short,
@@ -377,12 +633,43 @@ mcrouter_option_integer(
   "Timeout for talking to destination servers (e.g. memcached), "
   "in milliseconds. Must be greater than 0.")
 
+mcrouter_option_double(
+  double, adaptive_timeout_factor, 0.0,
+  "adaptive-timeout-factor", no_short,
+  "If positive, each destination derives its request timeout from its "
+  "own observed latency: p99 latency times this factor, re-evaluated "
+  "every 1000 replies and clamped between adaptive-timeout-min-ms and "
+  "the static (config) timeout. 0 disables adaptive timeouts.")
+
+mcrouter_option_integer(
+  unsigned int, adaptive_timeout_min_ms, 5,
+  "adaptive-timeout-min-ms", no_short,
+  "Lower clamp, in milliseconds, for adaptive timeouts "
+  "(see adaptive-timeout-factor).")
+
+mcrouter_option_integer(
+  unsigned int, client_request_deadline_ms, 0,
+  "client-request-deadline-ms", no_short,
+  "Assumed time in ms after which the client gives up on a request. "
+  "When nonzero, routes that queue requests (e.g. OutstandingLimitRoute) "
+  "fast-fail queued entries whose remaining budget is smaller than the "
+  "expected downstream latency instead of doing wasted backend work. "
+  "0 disables deadline tracking.")
+
 mcrouter_option_integer(
   unsigned int, cross_region_timeout_ms, 0,
   "cross-region-timeout-ms", no_short,
   "Timeouts for talking to cross region pool. "
   "If specified (non 0) takes precedence over every other timeout.")
 
+mcrouter_option_integer(
+  unsigned int, cross_region_flush_delay_us, 0,
+  "cross-region-flush-delay-us", no_short,
+  "If nonzero, writes to cross-region destinations may be held back by up "
+  "to this many microseconds so several requests coalesce into fewer, "
+  "larger writes, trading a little latency for inter-region packet rate. "
+  "Pools can override this with their 'flush_delay_us' field.")
+
 mcrouter_option_integer(
   unsigned int, cross_cluster_timeout_ms, 0,
   "cross-cluster-timeout-ms", no_short,
@@ -402,6 +689,34 @@ mcrouter_option_integer(
   " discarded. Enabled only if value is non-zero and"
   " if proxy-max-throttled-requests is enabled.")
 
+mcrouter_option_string(
+  proxy_queue_weights, "",
+  "proxy-queue-weights", no_short,
+  "Comma separated per-priority drain weights for throttled requests,"
+  " one per priority level (highest priority first). When set, the waiting"
+  " request queues are drained weighted round-robin instead of in strict"
+  " priority order, with requests close to waiting-request-timeout-ms"
+  " served first. Example: \"8,1\" drains up to 8 high priority requests"
+  " per low priority one.")
+
+mcrouter_option_integer(
+  size_t, memory_budget_mb, 0,
+  "memory-budget-mb", no_short,
+  "Advisory process-wide cap, in MiB, on memory tracked by the global"
+  " memory budget (parser read buffers, reply write buffers and queued"
+  " requests). When usage nears the cap, new requests are rejected with"
+  " busy according to memory-shed-thresholds. 0 to disable.")
+
+mcrouter_option_string(
+  memory_shed_thresholds, "",
+  "memory-shed-thresholds", no_short,
+  "Comma separated per-priority shed thresholds as fractions of"
+  " memory-budget-mb, one per priority level (highest priority first)."
+  " A priority's requests are rejected with busy once tracked usage is at"
+  " or above its fraction of the budget. Default \"1.0,0.9\": low priority"
+  " requests shed at 90% of the budget, high priority only at 100%."
+  " Ignored unless memory-budget-mb is set.")
+
 mcrouter_option_group("Custom Memory Allocation")
 
 mcrouter_option_toggle(
@@ -412,6 +727,16 @@ mcrouter_option_toggle(
   " part of any core dump. This is achieved by setting MADV_DONTDUMP on"
   " explicitly created jemalloc arenas. The default value is false.")
 
+mcrouter_option_toggle(
+  huge_page_buffers, false,
+  "huge-page-buffers", no_short,
+  "Allocate large network read buffers from a dedicated jemalloc arena"
+  " whose chunks are advised MADV_HUGEPAGE, so the kernel backs them with"
+  " 2MB transparent hugepages instead of 4KB pages and buffer-heavy proxy"
+  " threads take fewer TLB misses. See the huge_page_arena_bytes and"
+  " ps_anon_huge_pages stats for advised and actually-promoted bytes."
+  " No effect without jemalloc 4+ or kernel THP support.")
+
 
 mcrouter_option_group("Logging")
 
@@ -425,11 +750,41 @@ mcrouter_option_string(
   "debug-fifo-root", no_short,
   "Root directory for debug fifos. If empty, debug fifos are disabled.")
 
+mcrouter_option_integer(
+  size_t, debug_fifo_ring_size, 0,
+  "debug-fifo-ring-size", no_short,
+  "If nonzero, debug fifos are shared-memory rings of this many bytes "
+  "per thread (drop-on-full) instead of named pipes, cheap enough for "
+  "always-on capture.")
+
 mcrouter_option_integer(
   unsigned int, stats_logging_interval, 10000,
   "stats-logging-interval", no_short,
   "Time in ms between stats reports, or 0 for no logging")
 
+mcrouter_option_toggle(
+  stats_binary_delta_format, false,
+  "stats-binary-delta-format", no_short,
+  "Append stats as binary delta records (only the counters that changed "
+  "since the last interval) to a per-run spool file through the async "
+  "stats writer, instead of rewriting the full JSON stats file "
+  "synchronously every interval. Read the spool back with the mcstats "
+  "tool (see StatsDeltaFormat.h)")
+
+mcrouter_option_string(
+  stats_export_socket_path, "",
+  "stats-export-socket-path", no_short,
+  "Unix domain socket on which the stats exporter listens. Subscribers "
+  "send one line 'groups=<group>,...' naming stat_group_t categories "
+  "and receive binary delta stat records (see StatsDeltaFormat.h) "
+  "pushed every stats-export-interval-ms. If empty, the exporter is "
+  "disabled.")
+
+mcrouter_option_integer(
+  unsigned int, stats_export_interval_ms, 1000,
+  "stats-export-interval-ms", no_short,
+  "Time in ms between pushed stats export ticks.")
+
 mcrouter_option_integer(
   unsigned int, logging_rtt_outlier_threshold_us, 0,
   "logging-rtt-outlier-threshold-us", no_short,
@@ -446,11 +801,59 @@ mcrouter_option_toggle(
   "disable-failure-logging", no_short,
   "Disable failure logging.")
 
+mcrouter_option_toggle(
+  enable_fbtrace, true,
+  "disable-fbtrace", no_short,
+  "Disable fbtrace request tracing entirely; requests carrying trace "
+  "state are forwarded untraced.")
+
+mcrouter_option_double(
+  double, fbtrace_rate, 0.0,
+  "fbtrace-rate", no_short,
+  "If positive, process-wide cap on traced requests per second (with a "
+  "burst of the same size); requests over the budget are forwarded "
+  "untraced. 0 means no cap.")
+
 mcrouter_option_toggle(
   cpu_cycles, false,
   "cpu-cycles", no_short,
   "Enables CPU cycles counting for performance measurement.")
 
+mcrouter_option_toggle(
+  cycles_perf_events, false,
+  "cycles-perf-events", no_short,
+  "Additionally samples hardware performance counters (LLC misses, "
+  "stalled cycles, branch misses) per request. Requires --cpu-cycles, a "
+  "hardware PMU and a permissive perf_event_paranoid setting; silently "
+  "exports zeros where counters cannot be opened.")
+
+mcrouter_option_integer(
+  uint64_t, request_cycle_budget, 0,
+  "request-cycle-budget", no_short,
+  "If positive, the maximum number of proxy CPU cycles a single request "
+  "may consume. Once a request is over budget, its remaining fanout "
+  "children are aborted with an error instead of being sent. "
+  "Requires --cpu-cycles. 0 to disable.")
+
+mcrouter_option_integer(
+  uint64_t, request_sampling_rate, 0,
+  "request-sampling-rate", no_short,
+  "If positive, collect a compact trace of 1 out of every N requests "
+  "per proxy thread, queryable through the sampled_requests ServiceInfo "
+  "command. 0 to disable.")
+
+mcrouter_option_toggle(
+  route_handle_profiling, false,
+  "route-handle-profiling", no_short,
+  "Wrap every route handle with a CPU cycle counter; the aggregated "
+  "per-handle costs are reported by \"stats route_handles\".")
+
+mcrouter_option_toggle(
+  enable_pool_route_swap, false,
+  "enable-pool-route-swap", no_short,
+  "Wrap every PoolRoute so the \"pool_swap\" ServiceInfo command can "
+  "redirect a pool's traffic at runtime without a full reconfig.")
+
 mcrouter_option_toggle(
   test_mode, false,
   "test-mode", no_short,
@@ -11,8 +11,10 @@
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/ThriftMessageTraits.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
 #include "mcrouter/McrouterFiberContext.h"
 #include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/RequestSampler.h"
 #include "mcrouter/routes/ProxyRoute.h"
 #include "mcrouter/ServiceInfo.h"
 #include "mcrouter/stats.h"
@@ -25,13 +27,13 @@ namespace detail {
 
 bool processGetServiceInfoRequest(
     const TypedThriftRequest<cpp2::McGetRequest>& req,
-    std::shared_ptr<ProxyRequestContextTyped<
-        TypedThriftRequest<cpp2::McGetRequest>>>& ctx);
+    ProxyRequestContextTypedPtr<
+        TypedThriftRequest<cpp2::McGetRequest>>& ctx);
 
 template <class Request>
 bool processGetServiceInfoRequest(
     const Request&,
-    std::shared_ptr<ProxyRequestContextTyped<Request>>&) {
+    ProxyRequestContextTypedPtr<Request>&) {
 
   return false;
 }
@@ -39,7 +41,7 @@ bool processGetServiceInfoRequest(
 template <class GetRequest>
 bool processGetServiceInfoRequestImpl(
     const GetRequest& req,
-    std::shared_ptr<ProxyRequestContextTyped<GetRequest>>& ctx,
+    ProxyRequestContextTypedPtr<GetRequest>& ctx,
     GetLikeT<GetRequest> = 0);
 
 } // detail
@@ -69,25 +71,92 @@ void proxy_t::WaitingRequest<Request>::process(proxy_t* proxy) {
 }
 
 template <class Request>
-typename std::enable_if<TRequestListContains<Request>::value, void>::type
+typename std::enable_if<RoutedRequestListContains<Request>::value, void>::type
 proxy_t::routeHandlesProcessRequest(
     const Request& req,
     std::unique_ptr<ProxyRequestContextTyped<Request>> uctx) {
 
+  auto picked = pickConfigForRequest(req.routingKey());
+  auto config = std::move(picked.first);
+  const CanarySlice canarySlice = picked.second;
+  const int64_t canaryStartUs =
+      canarySlice == CanarySlice::kNone ? 0 : nowUs();
+  const bool mayBlock = config->routeHandlesMayBlock();
+  const size_t routeTreeDepth = config->routeHandlesMaxDepth();
+  int64_t deadlineUs = getRouterOptions().client_request_deadline_ms > 0
+      ? nowUs() +
+          1000LL * getRouterOptions().client_request_deadline_ms
+      : 0;
+  if (req.deadlineMs() > 0) {
+    /* Deadline propagated by an upstream mcrouter; honor the tighter of
+       the two budgets. */
+    const int64_t propagatedUs = nowUs() + 1000LL * req.deadlineMs();
+    if (deadlineUs == 0 || propagatedUs < deadlineUs) {
+      deadlineUs = propagatedUs;
+    }
+  }
+
   auto sharedCtx = ProxyRequestContextTyped<Request>::process(
-      std::move(uctx), getConfig());
+      std::move(uctx), std::move(config));
 
   if (detail::processGetServiceInfoRequest(req, sharedCtx)) {
     return;
   }
 
-  auto funcCtx = sharedCtx;
+  if (requestSampler && requestSampler->shouldSample()) {
+    /* Record the route handle path up front: the subtree the key descends
+       through is fixed once the config is picked. */
+    std::string routePath;
+    int level = 0;
+    RouteHandleTraverser<McrouterRouteHandleIf> t(
+        [&routePath, &level](const McrouterRouteHandleIf& rh) {
+          routePath.append(level, ' ');
+          routePath.append(rh.routeName());
+          routePath.push_back('\n');
+          ++level;
+        },
+        [&level]() {
+          --level;
+        });
+    sharedCtx->proxyRoute().traverse(req, t);
+    sharedCtx->startSampling(Request::name, req.routingKey(),
+                             std::move(routePath));
+  }
+
+  if (!mayBlock) {
+    /* The route tree has no suspension points (no destinations, delays,
+       etc.), so route directly in the main context and skip fiber
+       allocation and teardown entirely. */
+    auto reply = fiber_local::runWithoutLocals(
+        [&req, &sharedCtx, deadlineUs]() {
+          try {
+            auto& proute = sharedCtx->proxyRoute();
+            fiber_local::setSharedCtx(
+                ProxyRequestContextPtr::cloneRef(sharedCtx.get()));
+            fiber_local::setRequestDeadlineUs(deadlineUs);
+            return proute.route(req);
+          } catch (const std::exception& e) {
+            auto err = folly::sformat(
+                "Error routing request of type {}!"
+                " Exception: {}",
+                typeid(Request).name(), e.what());
+            return ReplyT<Request>(mc_res_local_error, std::move(err));
+          }
+        });
+    canaryObserveReply(canarySlice, reply.result(), nowUs() - canaryStartUs);
+    sharedCtx->sendReply(std::move(reply));
+    return;
+  }
+
+  auto funcCtx = sharedCtx.clone();
 
-  fiberManager.addTaskFinally(
-      [&req, ctx = std::move(funcCtx)]() mutable {
+  routeFiberManager(routeTreeDepth).addTaskFinally(
+      [&req, ctx = std::move(funcCtx), deadlineUs]() mutable {
         try {
           auto& proute = ctx->proxyRoute();
-          fiber_local::setSharedCtx(std::move(ctx));
+          fiber_local::setSharedCtx(
+              ProxyRequestContextPtr::moveRef(ctx.release()));
+          fiber_local::setRequestDeadlineUs(deadlineUs);
           return proute.route(req);
         } catch (const std::exception& e) {
           auto err = folly::sformat(
@@ -97,14 +166,16 @@ proxy_t::routeHandlesProcessRequest(
           return ReplyT<Request>(mc_res_local_error, std::move(err));
         }
       },
-      [ctx = std::move(sharedCtx)](
+      [this, ctx = std::move(sharedCtx), canarySlice, canaryStartUs](
           folly::Try<ReplyT<Request>>&& reply) {
+        canaryObserveReply(
+            canarySlice, reply->result(), nowUs() - canaryStartUs);
         ctx->sendReply(std::move(*reply));
       });
 }
 
 template <class Request>
-typename std::enable_if<!TRequestListContains<Request>::value, void>::type
+typename std::enable_if<!RoutedRequestListContains<Request>::value, void>::type
 proxy_t::routeHandlesProcessRequest(
     const Request&,
     std::unique_ptr<ProxyRequestContextTyped<Request>> uctx) {
@@ -139,6 +210,12 @@ void proxy_t::dispatchRequest(
     const Request& req,
     std::unique_ptr<ProxyRequestContextTyped<Request>> ctx) {
 
+  if (memoryShed(ctx->priority(), req)) {
+    stat_incr(stats, proxy_reqs_memory_shed_stat, 1);
+    ctx->sendReply(mc_res_busy);
+    return;
+  }
+
   if (rateLimited(ctx->priority(), req)) {
     if (getRouterOptions().proxy_max_throttled_requests > 0 &&
         numRequestsWaiting_ >=
@@ -149,13 +226,16 @@ void proxy_t::dispatchRequest(
     auto& queue = waitingRequests_[static_cast<int>(ctx->priority())];
     auto w = folly::make_unique<WaitingRequest<Request>>(
         req, std::move(ctx));
-    // Only enable timeout on waitingRequests_ queue when queue throttling is
-    // enabled
-    if (getRouterOptions().proxy_max_inflight_requests > 0 &&
-        getRouterOptions().proxy_max_throttled_requests > 0 &&
-        getRouterOptions().waiting_request_timeout_ms > 0) {
+    // Only enable timeout on waitingRequests_ queue when queue throttling
+    // is enabled, or when the weighted scheduler needs the timestamp for
+    // its deadline-aware pick
+    if (getRouterOptions().waiting_request_timeout_ms > 0 &&
+        ((getRouterOptions().proxy_max_inflight_requests > 0 &&
+          getRouterOptions().proxy_max_throttled_requests > 0) ||
+         !drainWeights_.empty())) {
       w->setTimePushedOnQueue(nowUs());
     }
+    w->setAccountedBytes(sizeof(WaitingRequest<Request>) + req.fullKey().size());
     queue.pushBack(std::move(w));
     ++numRequestsWaiting_;
     stat_incr(stats, proxy_reqs_waiting_stat, 1);
@@ -288,6 +368,32 @@ inline bool proxy_t::rateLimited(ProxyRequestPriority priority,
 
   return true;
 }
+
+/* Never shed stats/version probes: they're the tools an operator needs
+   most while diagnosing the very overload that triggered shedding. */
+template <>
+inline bool proxy_t::memoryShed(
+    ProxyRequestPriority priority,
+    const TypedThriftRequest<cpp2::McStatsRequest>&) const {
+  return false;
+}
+
+template <>
+inline bool proxy_t::memoryShed(
+    ProxyRequestPriority priority,
+    const TypedThriftRequest<cpp2::McVersionRequest>&) const {
+  return false;
+}
+
+template <class Request>
+inline bool proxy_t::memoryShed(ProxyRequestPriority priority,
+                                const Request&) const {
+  if (shedThresholds_.empty()) {
+    return false;
+  }
+  return MemoryBudget::instance().overThreshold(
+      shedThresholds_[static_cast<int>(priority)]);
+}
 } // mcrouter
 } // memcache
 } // facebook
@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <limits>
 
 #include <boost/regex.hpp>
 
@@ -27,15 +28,22 @@
 #include <folly/Memory.h>
 #include <folly/Random.h>
 #include <folly/Range.h>
+#include <folly/SpookyHashV2.h>
+#include <folly/String.h>
 #include <folly/ThreadName.h>
 
 #include "mcrouter/async.h"
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
+#include "mcrouter/DeleteRetryQueue.h"
 #include "mcrouter/lib/cycles/Cycles.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/fbi/queue.h"
+#include "mcrouter/lib/IOBufUtil.h"
+#include "mcrouter/lib/McResUtil.h"
 #include "mcrouter/lib/MessageQueue.h"
+#include "mcrouter/lib/PeriodicTaskScheduler.h"
+#include "mcrouter/lib/network/FBTrace.h"
 #include "mcrouter/lib/WeightedCh3HashFunc.h"
 #include "mcrouter/McrouterInstance.h"
 #include "mcrouter/McrouterLogFailure.h"
@@ -45,20 +53,29 @@
 #include "mcrouter/ProxyDestinationMap.h"
 #include "mcrouter/ProxyRequestContext.h"
 #include "mcrouter/ProxyThread.h"
+#include "mcrouter/RequestSampler.h"
 #include "mcrouter/route.h"
+#include "mcrouter/RouteHandleProfiler.h"
 #include "mcrouter/routes/RateLimiter.h"
 #include "mcrouter/routes/ShardSplitter.h"
 #include "mcrouter/RuntimeVarsData.h"
 #include "mcrouter/stats.h"
+#include "mcrouter/ThreadUtil.h"
+#include "mcrouter/TkoEventRing.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
 namespace {
 
+// Interval between thread-CPU samples in milliseconds.
+constexpr uint32_t kCpuSampleIntervalMs = 1000;
+
 folly::fibers::FiberManager::Options getFiberManagerOptions(
-    const McrouterOptions& opts) {
+    const McrouterOptions& opts, bool smallStack) {
   folly::fibers::FiberManager::Options fmOpts;
-  fmOpts.stackSize = opts.fibers_stack_size;
+  fmOpts.stackSize = smallStack && opts.fibers_small_stack_size > 0
+      ? opts.fibers_small_stack_size
+      : opts.fibers_stack_size;
   fmOpts.recordStackEvery = opts.fibers_record_stack_size_every;
   fmOpts.maxFibersPoolSize = opts.fibers_max_pool_size;
   fmOpts.useGuardPages = opts.fibers_use_guard_pages;
@@ -66,14 +83,85 @@ folly::fibers::FiberManager::Options getFiberManagerOptions(
   return fmOpts;
 }
 
+#ifndef LIBMC_FBTRACE_DISABLE
+
+/* Process-wide budget of traced requests (see --fbtrace-rate). */
+double gFbTraceRate{0.0};
+DynamicAtomicTokenBucket gFbTraceBudget;
+
+bool consumeFbTraceBudget() {
+  return gFbTraceBudget.consume(1.0, gFbTraceRate, gFbTraceRate);
+}
+
+#endif
+
+std::vector<uint64_t> parseDrainWeights(const McrouterOptions& opts) {
+  std::vector<uint64_t> weights;
+  if (opts.proxy_queue_weights.empty()) {
+    return weights;
+  }
+  std::vector<folly::StringPiece> pieces;
+  folly::split(',', opts.proxy_queue_weights, pieces);
+  try {
+    for (auto piece : pieces) {
+      auto w = folly::to<uint64_t>(folly::trimWhitespace(piece));
+      /* a zero weight would never drain; treat it as the minimum */
+      weights.push_back(w > 0 ? w : 1);
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Invalid proxy_queue_weights '" << opts.proxy_queue_weights
+               << "': " << e.what()
+               << "; falling back to strict priority draining";
+    weights.clear();
+    return weights;
+  }
+  /* missing trailing weights default to 1 */
+  weights.resize(
+      static_cast<size_t>(ProxyRequestPriority::kNumPriorities), 1);
+  return weights;
+}
+
+std::vector<double> parseShedThresholds(const McrouterOptions& opts) {
+  /* shed at 100% of the budget for high priority, 90% for low */
+  std::vector<double> defaults{1.0, 0.9};
+  defaults.resize(
+      static_cast<size_t>(ProxyRequestPriority::kNumPriorities), 1.0);
+  if (opts.memory_budget_mb == 0) {
+    /* no budget, no shedding */
+    return std::vector<double>();
+  }
+  if (opts.memory_shed_thresholds.empty()) {
+    return defaults;
+  }
+  std::vector<double> thresholds;
+  std::vector<folly::StringPiece> pieces;
+  folly::split(',', opts.memory_shed_thresholds, pieces);
+  try {
+    for (auto piece : pieces) {
+      auto t = folly::to<double>(folly::trimWhitespace(piece));
+      checkLogic(t > 0.0, "threshold must be positive");
+      thresholds.push_back(t);
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Invalid memory_shed_thresholds '"
+               << opts.memory_shed_thresholds << "': " << e.what()
+               << "; falling back to defaults";
+    return defaults;
+  }
+  /* missing trailing thresholds never shed below a full budget */
+  thresholds.resize(
+      static_cast<size_t>(ProxyRequestPriority::kNumPriorities), 1.0);
+  return thresholds;
+}
+
 } // anonymous
 
 namespace detail {
 
 bool processGetServiceInfoRequest(
     const TypedThriftRequest<cpp2::McGetRequest>& req,
-    std::shared_ptr<ProxyRequestContextTyped<
-      TypedThriftRequest<cpp2::McGetRequest>>>& ctx) {
+    ProxyRequestContextTypedPtr<
+      TypedThriftRequest<cpp2::McGetRequest>>& ctx) {
 
   return processGetServiceInfoRequestImpl(req, ctx);
 }
@@ -81,7 +169,7 @@ bool processGetServiceInfoRequest(
 template <class GetRequest>
 bool processGetServiceInfoRequestImpl(
     const GetRequest& req,
-    std::shared_ptr<ProxyRequestContextTyped<GetRequest>>& ctx,
+    ProxyRequestContextTypedPtr<GetRequest>& ctx,
     GetLikeT<GetRequest>) {
 
   static const char* const kInternalGetPrefix = "__mcrouter__.";
@@ -101,24 +189,48 @@ bool processGetServiceInfoRequestImpl(
 proxy_t::proxy_t(McrouterInstance& rtr, size_t id)
     : router_(rtr),
       destinationMap(folly::make_unique<ProxyDestinationMap>(this)),
+      asynclogLanes(rtr.asynclogLaneCount()),
       fiberManager(
         fiber_local::ContextTypeTag(),
         folly::make_unique<folly::fibers::EventBaseLoopController>(),
-        getFiberManagerOptions(router_.opts())),
+        getFiberManagerOptions(router_.opts(), false /* smallStack */)),
+      smallStackFiberManager(
+        fiber_local::ContextTypeTag(),
+        folly::make_unique<folly::fibers::EventBaseLoopController>(),
+        getFiberManagerOptions(router_.opts(), true /* smallStack */)),
       id_(id) {
 
   memset(stats, 0, sizeof(stats));
   memset(stats_bin, 0, sizeof(stats_bin));
   memset(stats_num_within_window, 0, sizeof(stats_num_within_window));
+  memset(stats_prev_rate_value, 0, sizeof(stats_prev_rate_value));
 
-  // Setup a full random seed sequence
-  folly::Random::seed(randomGenerator);
+  // Seed once per proxy; draws after this are a few cycles each
+  randomGenerator.seed(folly::Random::rand64());
   static uint64_t next_magic = 0x12345678900000LL;
 
   magic = __sync_fetch_and_add(&next_magic, 1);
 
   init_stats(stats);
 
+  drainWeights_ = parseDrainWeights(router_.opts());
+  if (!drainWeights_.empty()) {
+    drainCredits_ = drainWeights_[0];
+  }
+
+  shedThresholds_ = parseShedThresholds(router_.opts());
+  /* idempotent across proxies; all share one process-wide budget */
+  MemoryBudget::instance().setLimit(
+      router_.opts().memory_budget_mb * 1024 * 1024);
+
+#ifndef LIBMC_FBTRACE_DISABLE
+  /* also idempotent: fbtrace controls are process-wide */
+  setFbTraceEnabled(router_.opts().enable_fbtrace);
+  gFbTraceRate = router_.opts().fbtrace_rate;
+  setFbTraceBudgetHook(
+      gFbTraceRate > 0 ? &consumeFbTraceBudget : nullptr);
+#endif
+
   messageQueue_ = folly::make_unique<MessageQueue<ProxyMessage>>(
     router_.opts().client_queue_size,
     [this] (ProxyMessage&& message) {
@@ -133,6 +245,33 @@ proxy_t::proxy_t(McrouterInstance& rtr, size_t id)
   );
 
   statsContainer = folly::make_unique<ProxyStatsContainer>(*this);
+
+  tkoEventRing = folly::make_unique<TkoEventRing>();
+
+  if (router_.opts().request_sampling_rate > 0) {
+    requestSampler = folly::make_unique<RequestSampler>(
+        router_.opts().request_sampling_rate);
+  }
+
+  if (router_.opts().route_handle_profiling) {
+    routeHandleProfiler = folly::make_unique<RouteHandleProfiler>();
+  }
+
+  if (router_.opts().asynclog_spool_ring_size >= 2) {
+    for (auto& lane : asynclogLanes) {
+      lane.ring =
+          folly::make_unique<folly::ProducerConsumerQueue<std::string>>(
+              router_.opts().asynclog_spool_ring_size);
+    }
+  }
+
+  if (router_.opts().asynclog_retry_count > 0) {
+    deleteRetryQueue = folly::make_unique<DeleteRetryQueue>(
+        *this,
+        router_.opts().asynclog_retry_queue_size,
+        router_.opts().asynclog_retry_count,
+        router_.opts().asynclog_retry_interval_ms);
+  }
 }
 
 proxy_t::Pointer proxy_t::createProxy(McrouterInstance& router,
@@ -146,10 +285,22 @@ proxy_t::Pointer proxy_t::createProxy(McrouterInstance& router,
   eventBase.runInEventBaseThread(
     [proxy, &eventBase] () {
       proxy->eventBase_ = &eventBase;
-      proxy->messageQueue_->attachEventBase(eventBase);
+      proxy->taskScheduler_ =
+        folly::make_unique<PeriodicTaskScheduler>(eventBase);
+      proxy->tscClockCalibrator.attach(eventBase);
+      proxy->messageQueue_->attachEventBase(
+        eventBase, proxy->taskScheduler_.get());
+      /* Raw pointer on purpose: the scheduler is owned by the proxy,
+         so a shared_ptr capture would keep the proxy alive forever. */
+      proxy->taskScheduler_->schedule(
+        kCpuSampleIntervalMs,
+        [rawProxy = proxy.get()]() { rawProxy->sampleThreadCpu(); });
 
       dynamic_cast<folly::fibers::EventBaseLoopController&>(
         proxy->fiberManager.loopController()).attachEventBase(eventBase);
+      dynamic_cast<folly::fibers::EventBaseLoopController&>(
+        proxy->smallStackFiberManager.loopController())
+          .attachEventBase(eventBase);
 
       std::chrono::milliseconds connectionResetInterval{
         proxy->router_.opts().reset_inactive_connection_interval
@@ -162,12 +313,40 @@ proxy_t::Pointer proxy_t::createProxy(McrouterInstance& router,
       if (proxy->router_.opts().cpu_cycles) {
         cycles::attachEventBase(eventBase);
         proxy->fiberManager.setObserver(&proxy->cyclesObserver);
+        proxy->smallStackFiberManager.setObserver(&proxy->cyclesObserver);
       }
     });
 
   return Pointer(proxy.get());
 }
 
+void proxy_t::sampleThreadCpu() {
+  ThreadCpuTimes t;
+  if (!mcrouterGetThisThreadCpuTimes(t)) {
+    return;
+  }
+
+  threadCpuUserUs.store(
+    static_cast<uint64_t>(t.userSec * 1000000.0), std::memory_order_relaxed);
+  threadCpuSystemUs.store(
+    static_cast<uint64_t>(t.systemSec * 1000000.0), std::memory_order_relaxed);
+
+  const double cpuSec = t.userSec + t.systemSec;
+  const int64_t sampleUs = nowUs();
+  if (lastThreadCpuSampleUs_ != 0 && sampleUs > lastThreadCpuSampleUs_) {
+    const double busy =
+      (cpuSec - lastThreadCpuSec_) * 1000000.0 /
+      (sampleUs - lastThreadCpuSampleUs_);
+    /* Clock skew between the CPU and wall clocks can push the ratio
+       slightly past 1. */
+    threadCpuBusyPermille.store(
+      std::min<uint64_t>(1000, std::max(0.0, busy) * 1000),
+      std::memory_order_relaxed);
+  }
+  lastThreadCpuSec_ = cpuSec;
+  lastThreadCpuSampleUs_ = sampleUs;
+}
+
 std::shared_ptr<ProxyConfig> proxy_t::getConfig() const {
   std::lock_guard<SFRReadLock> lg(
     const_cast<SFRLock&>(configLock_).readLock());
@@ -192,8 +371,153 @@ std::shared_ptr<ProxyConfig> proxy_t::swapConfig(
   return old;
 }
 
+std::pair<std::shared_ptr<ProxyConfig>, proxy_t::CanarySlice>
+proxy_t::pickConfigForRequest(folly::StringPiece routingKey) {
+  std::lock_guard<SFRReadLock> lg(configLock_.readLock());
+  if (LIKELY(canaryConfig_ == nullptr)) {
+    return {config_, CanarySlice::kNone};
+  }
+  const auto hash = folly::hash::SpookyHashV2::Hash64(
+    routingKey.data(), routingKey.size(), /* seed= */ 0);
+  if (hash % getRouterOptions().config_canary_rate == 0) {
+    return {canaryConfig_, CanarySlice::kCanary};
+  }
+  return {config_, CanarySlice::kStable};
+}
+
+void proxy_t::canaryObserveReply(CanarySlice slice,
+                                 mc_res_t result,
+                                 int64_t latencyUs) {
+  if (LIKELY(slice == CanarySlice::kNone)) {
+    return;
+  }
+
+  /* Replies for requests routed under a superseded canary land in the
+     current window's counters; over a multi-second window the noise is
+     negligible and not worth tagging every request with a generation. */
+  if (slice == CanarySlice::kCanary) {
+    canaryRequests_.fetch_add(1, std::memory_order_relaxed);
+    canaryLatencySumUs_.fetch_add(latencyUs, std::memory_order_relaxed);
+    if (mc_res_is_err(result)) {
+      canaryErrors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  } else {
+    stableRequests_.fetch_add(1, std::memory_order_relaxed);
+    stableLatencySumUs_.fetch_add(latencyUs, std::memory_order_relaxed);
+    if (mc_res_is_err(result)) {
+      stableErrors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  const int64_t windowUs =
+    1000LL * getRouterOptions().config_canary_duration_ms;
+  if (nowUs() - canaryStartUs_.load(std::memory_order_relaxed) >= windowUs) {
+    finishConfigCanary();
+  }
+}
+
+void proxy_t::beginConfigCanary(std::shared_ptr<ProxyConfig> config) {
+  std::shared_ptr<ProxyConfig> supersededCanary;
+  {
+    std::lock_guard<SFRWriteLock> lg(configLock_.writeLock());
+    assert(config_ != nullptr);
+    supersededCanary = std::move(canaryConfig_);
+    canaryConfig_ = std::move(config);
+    canaryRequests_ = 0;
+    canaryErrors_ = 0;
+    canaryLatencySumUs_ = 0;
+    stableRequests_ = 0;
+    stableErrors_ = 0;
+    stableLatencySumUs_ = 0;
+    canaryStartUs_ = nowUs();
+  }
+  stat_incr(stats, config_canary_started_stat, 1);
+  if (supersededCanary) {
+    auto configReq = new old_config_req_t(std::move(supersededCanary));
+    sendMessage(ProxyMessage::Type::OLD_CONFIG, configReq);
+  }
+}
+
+void proxy_t::finishConfigCanary() {
+  const uint64_t canaryReqs = canaryRequests_.load(std::memory_order_relaxed);
+  const uint64_t stableReqs = stableRequests_.load(std::memory_order_relaxed);
+  const double slack =
+    1.0 + getRouterOptions().config_canary_slack_percent / 100.0;
+
+  /* Rates over the same window; an empty slice counts as no evidence of
+     regression (we'd rather promote an unexercised config than pin the
+     proxy to a stale one forever). */
+  const double canaryErrorRate = canaryReqs > 0
+    ? static_cast<double>(canaryErrors_.load(std::memory_order_relaxed)) /
+      canaryReqs
+    : 0.0;
+  const double stableErrorRate = stableReqs > 0
+    ? static_cast<double>(stableErrors_.load(std::memory_order_relaxed)) /
+      stableReqs
+    : 0.0;
+  /* Absolute floor so a single canary error against a clean baseline
+     doesn't condemn the push. */
+  bool healthy = canaryErrorRate <= stableErrorRate * slack + 0.01;
+
+  if (healthy && canaryReqs > 0 && stableReqs > 0) {
+    const double canaryMeanUs =
+      static_cast<double>(
+        canaryLatencySumUs_.load(std::memory_order_relaxed)) / canaryReqs;
+    const double stableMeanUs =
+      static_cast<double>(
+        stableLatencySumUs_.load(std::memory_order_relaxed)) / stableReqs;
+    healthy = canaryMeanUs <= stableMeanUs * slack;
+  }
+
+  std::shared_ptr<ProxyConfig> retired;
+  {
+    std::lock_guard<SFRWriteLock> lg(configLock_.writeLock());
+    if (canaryConfig_ == nullptr) {
+      return;
+    }
+    if (healthy) {
+      retired = std::move(config_);
+      config_ = std::move(canaryConfig_);
+    } else {
+      retired = std::move(canaryConfig_);
+    }
+  }
+
+  if (healthy) {
+    stat_incr(stats, config_canary_promoted_stat, 1);
+    stat_set_uint64(stats, config_last_success_stat, time(nullptr));
+  } else {
+    stat_incr(stats, config_canary_rolled_back_stat, 1);
+    /* Note: an identical re-push of the rejected config will be skipped
+       by the reconfiguration digest check until the config changes. */
+    MC_LOG_FAILURE(getRouterOptions(), failure::Category::kInvalidConfig,
+                   "Rolled back canary config {}: error rate {:.4f} vs {:.4f},"
+                   " {} canary / {} stable requests",
+                   retired->getConfigMd5Digest(),
+                   canaryErrorRate, stableErrorRate,
+                   canaryReqs, stableReqs);
+  }
+
+  auto configReq = new old_config_req_t(std::move(retired));
+  sendMessage(ProxyMessage::Type::OLD_CONFIG, configReq);
+}
+
 /** drain and delete proxy object */
 proxy_t::~proxy_t() {
+  /* The awriters are stopped by now; write out anything still sitting in
+     the memory tier or batched for the disk tier. */
+  for (size_t lane = 0; lane < asynclogLanes.size(); ++lane) {
+    auto& state = asynclogLanes[lane];
+    if (state.ring) {
+      std::string record;
+      while (state.ring->read(record)) {
+        state.batchBytes += record.size();
+        state.batch.push_back(std::move(record));
+      }
+    }
+    asynclog_flush(this, lane);
+  }
+
   destinationMap.reset();
 
   being_destroyed = true;
@@ -212,7 +536,7 @@ void proxy_t::sendMessage(ProxyMessage::Type t, void* data) noexcept {
 
 void proxy_t::drainMessageQueue() {
   CHECK(messageQueue_.get());
-  messageQueue_->drain();
+  messageQueue_->drainBatch();
 }
 
 size_t proxy_t::queueNotifyPeriod() const {
@@ -238,6 +562,18 @@ void proxy_t::messageReady(ProxyMessage::Type t, void* data) {
     }
     break;
 
+    case ProxyMessage::Type::POOL_SWAP:
+    {
+      auto req = reinterpret_cast<pool_swap_req_t*>(data);
+      try {
+        getConfig()->swapPoolRoute(req->poolName(), req->target());
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "pool_swap failed: " << e.what();
+      }
+      delete req;
+    }
+    break;
+
     case ProxyMessage::Type::SHUTDOWN:
       /*
        * No-op. We just wanted to wake this event base up so that
@@ -265,18 +601,163 @@ void proxy_t::routeHandlesProcessRequest(
   ctx->sendReply(std::move(reply));
 }
 
+void proxy_t::routeHandlesProcessRequest(
+    const TypedThriftRequest<cpp2::McBulkDeleteRequest>& req,
+    std::unique_ptr<ProxyRequestContextTyped<
+      TypedThriftRequest<cpp2::McBulkDeleteRequest>>> uctx) {
+
+  using BulkReply = TypedThriftReply<cpp2::McBulkDeleteReply>;
+  using DeleteRequest = TypedThriftRequest<cpp2::McDeleteRequest>;
+
+  if (req->keys.empty()) {
+    uctx->sendReply(BulkReply(mc_res_deleted));
+    return;
+  }
+
+  auto picked = pickConfigForRequest(getRange(req->keys.front()));
+  auto config = std::move(picked.first);
+  const CanarySlice canarySlice = picked.second;
+  const int64_t canaryStartUs =
+      canarySlice == CanarySlice::kNone ? 0 : nowUs();
+  const size_t routeTreeDepth = config->routeHandlesMaxDepth();
+  int64_t deadlineUs = getRouterOptions().client_request_deadline_ms > 0
+      ? nowUs() +
+          1000LL * getRouterOptions().client_request_deadline_ms
+      : 0;
+  if (req.deadlineMs() > 0) {
+    const int64_t propagatedUs = nowUs() + 1000LL * req.deadlineMs();
+    if (deadlineUs == 0 || propagatedUs < deadlineUs) {
+      deadlineUs = propagatedUs;
+    }
+  }
+
+  auto sharedCtx = ProxyRequestContextTyped<
+      TypedThriftRequest<cpp2::McBulkDeleteRequest>>::process(
+          std::move(uctx), std::move(config));
+
+  /* Always route on a fiber, even if the tree itself can't block:
+     routeBatch() suspends while per-destination groups are in flight. */
+  auto funcCtx = sharedCtx.clone();
+
+  routeFiberManager(routeTreeDepth).addTaskFinally(
+      [&req, ctx = std::move(funcCtx), deadlineUs]() mutable {
+        try {
+          auto& proute = ctx->proxyRoute();
+          fiber_local::setSharedCtx(
+              ProxyRequestContextPtr::moveRef(ctx.release()));
+          fiber_local::setRequestDeadlineUs(deadlineUs);
+
+          /* Expand into per-key deletes; the batch API hashes all keys
+             in one pass and routes per-destination groups concurrently,
+             so the sub-requests still leave as coalesced writes. */
+          std::vector<DeleteRequest> deletes;
+          deletes.reserve(req->keys.size());
+          for (const auto& key : req->keys) {
+            deletes.emplace_back(getRange(key));
+          }
+          std::vector<const DeleteRequest*> deletePtrs;
+          deletePtrs.reserve(deletes.size());
+          for (const auto& del : deletes) {
+            deletePtrs.push_back(&del);
+          }
+
+          auto replies = proute.routeBatch(deletePtrs);
+
+          /* Reduce to the worst per-key outcome, so mc_res_deleted
+             guarantees every key is gone (or spooled to asynclog). */
+          BulkReply reply(mc_res_deleted);
+          for (auto& subReply : replies) {
+            if (resultSeverity(subReply.result()) >
+                resultSeverity(reply.result())) {
+              reply = BulkReply(subReply.result());
+              if (subReply->get_message() != nullptr) {
+                reply->set_message(std::move(subReply->message));
+              }
+            }
+          }
+          return reply;
+        } catch (const std::exception& e) {
+          auto err = folly::sformat(
+              "Error routing bulk delete! Exception: {}", e.what());
+          return BulkReply(mc_res_local_error, std::move(err));
+        }
+      },
+      [this, ctx = std::move(sharedCtx), canarySlice, canaryStartUs](
+          folly::Try<BulkReply>&& reply) {
+        canaryObserveReply(
+            canarySlice, reply->result(), nowUs() - canaryStartUs);
+        ctx->sendReply(std::move(*reply));
+      });
+}
+
 void proxy_t::pump() {
   auto numPriorities = static_cast<int>(ProxyRequestPriority::kNumPriorities);
-  for (int i = 0; i < numPriorities; ++i) {
-    auto& queue = waitingRequests_[i];
-    while (numRequestsProcessing_ < router_.opts().proxy_max_inflight_requests
-           && !queue.empty()) {
-      --numRequestsWaiting_;
-      auto w = queue.popFront();
-      stat_decr(stats, proxy_reqs_waiting_stat, 1);
-
-      w->process(this);
+
+  if (drainWeights_.empty()) {
+    /* Strict priority: drain each queue fully before touching the next */
+    for (int i = 0; i < numPriorities; ++i) {
+      auto& queue = waitingRequests_[i];
+      while (numRequestsProcessing_ <
+                 router_.opts().proxy_max_inflight_requests &&
+             !queue.empty()) {
+        --numRequestsWaiting_;
+        auto w = queue.popFront();
+        stat_decr(stats, proxy_reqs_waiting_stat, 1);
+
+        w->process(this);
+      }
     }
+    return;
+  }
+
+  const int64_t timeoutUs =
+      1000LL * router_.opts().waiting_request_timeout_ms;
+  while (numRequestsProcessing_ <
+         router_.opts().proxy_max_inflight_requests) {
+    int pick = -1;
+
+    /* Deadline-aware pick: a request that has burned most of its waiting
+       budget is served next regardless of weights, so that a low-weight
+       queue can't be timed out wholesale by load on the other queues. */
+    if (timeoutUs > 0) {
+      int64_t oldest = std::numeric_limits<int64_t>::max();
+      const auto now = nowUs();
+      for (int i = 0; i < numPriorities; ++i) {
+        if (waitingRequests_[i].empty()) {
+          continue;
+        }
+        auto pushed = waitingRequests_[i].front().timePushedOnQueue();
+        if (pushed >= 0 && (now - pushed) * 4 >= timeoutUs * 3 &&
+            pushed < oldest) {
+          oldest = pushed;
+          pick = i;
+        }
+      }
+    }
+
+    /* Otherwise weighted round-robin over the non-empty queues: each
+       queue drains up to its weight before we rotate to the next one. */
+    if (pick < 0) {
+      for (int scanned = 0; scanned <= numPriorities; ++scanned) {
+        if (!waitingRequests_[drainQueue_].empty() && drainCredits_ > 0) {
+          pick = drainQueue_;
+          break;
+        }
+        drainQueue_ = (drainQueue_ + 1) % numPriorities;
+        drainCredits_ = drainWeights_[drainQueue_];
+      }
+      if (pick < 0) {
+        /* all queues empty */
+        return;
+      }
+      --drainCredits_;
+    }
+
+    --numRequestsWaiting_;
+    auto w = waitingRequests_[pick].popFront();
+    stat_decr(stats, proxy_reqs_waiting_stat, 1);
+
+    w->process(this);
   }
 }
 
@@ -288,6 +769,17 @@ const McrouterOptions& proxy_t::getRouterOptions() const {
   return router_.opts();
 }
 
+folly::fibers::FiberManager& proxy_t::routeFiberManager(
+    size_t routeTreeDepth) {
+  const auto& opts = router_.opts();
+  if (opts.fibers_small_stack_size > 0 &&
+      opts.fibers_small_stack_size < opts.fibers_stack_size &&
+      routeTreeDepth <= opts.fibers_small_stack_max_depth) {
+    return smallStackFiberManager;
+  }
+  return fiberManager;
+}
+
 std::shared_ptr<ShadowSettings>
 ShadowSettings::create(const folly::dynamic& json, McrouterInstance& router) {
   auto result = std::shared_ptr<ShadowSettings>(new ShadowSettings());
@@ -318,6 +810,23 @@ ShadowSettings::create(const folly::dynamic& json, McrouterInstance& router) {
                  "validate_replies is not a bool");
       result->validateReplies_ = jValidateReplies->getBool();
     }
+    if (auto jMaxShadowRate = json.get_ptr("max_shadow_rate")) {
+      checkLogic(jMaxShadowRate->isNumber(),
+                 "max_shadow_rate is not a number");
+      auto rate = jMaxShadowRate->asDouble();
+      checkLogic(rate >= 0, "max_shadow_rate is negative");
+      result->maxShadowRate_ = rate;
+      result->maxShadowBurst_ = rate;
+    }
+    if (auto jMaxShadowBurst = json.get_ptr("max_shadow_burst")) {
+      checkLogic(jMaxShadowBurst->isNumber(),
+                 "max_shadow_burst is not a number");
+      checkLogic(result->maxShadowRate_ > 0,
+                 "max_shadow_burst requires max_shadow_rate");
+      auto burst = jMaxShadowBurst->asDouble();
+      checkLogic(burst > 0, "max_shadow_burst is not positive");
+      result->maxShadowBurst_ = burst;
+    }
   } catch (const std::logic_error& e) {
     MC_LOG_FAILURE(router.opts(), failure::Category::kInvalidConfig,
                    "ShadowSettings: {}", e.what());
@@ -335,6 +844,9 @@ void ShadowSettings::setKeyRange(double start, double end) {
   uint64_t keyStart = start * std::numeric_limits<uint32_t>::max();
   uint64_t keyEnd = end * std::numeric_limits<uint32_t>::max();
   keyRange_ = (keyStart << 32UL) | keyEnd;
+  /* An empty [0, 0] range shadows nothing; let ShadowRoute skip it with
+     a single branch instead of hashing the key every time. */
+  enabled_.store(keyEnd != 0, std::memory_order_relaxed);
 }
 
 void ShadowSettings::setValidateReplies(bool validateReplies) {
@@ -354,22 +866,33 @@ void ShadowSettings::registerOnUpdateCallback(McrouterInstance& router) {
       if (!newVars || keyFractionRangeRv_.empty()) {
         return;
       }
-      auto val = newVars->getVariableByName(keyFractionRangeRv_);
+      const auto* val = newVars->getVariablePtrByName(keyFractionRangeRv_);
       if (val != nullptr) {
-        checkLogic(val.isArray(),
+        checkLogic(val->isArray(),
                    "runtime vars: {} is not an array", keyFractionRangeRv_);
-        checkLogic(val.size() == 2,
+        checkLogic(val->size() == 2,
                    "runtime vars: size of {} is not 2", keyFractionRangeRv_);
-        checkLogic(val[0].isNumber(),
+        checkLogic((*val)[0].isNumber(),
                    "runtime vars: {}#0 is not a number", keyFractionRangeRv_);
-        checkLogic(val[1].isNumber(),
+        checkLogic((*val)[1].isNumber(),
                    "runtime vars: {}#1 is not a number", keyFractionRangeRv_);
-        setKeyRange(val[0].asDouble(), val[1].asDouble());
+        setKeyRange((*val)[0].asDouble(), (*val)[1].asDouble());
       }
     });
 }
 
 void proxy_config_swap(proxy_t* proxy, std::shared_ptr<ProxyConfig> config) {
+  /* Only this thread installs configs, so the emptiness check can't race
+     with another writer; the very first config is always swapped in
+     directly since there is nothing to compare a canary against. */
+  if (proxy->getRouterOptions().config_canary_rate > 0 &&
+      proxy->getConfig() != nullptr) {
+    /* The push takes effect for all traffic only once the canary window
+       ends; config_last_success is bumped at promotion. */
+    proxy->beginConfigCanary(std::move(config));
+    return;
+  }
+
   auto oldConfig = proxy->swapConfig(std::move(config));
   stat_set_uint64(proxy->stats, config_last_success_stat, time(nullptr));
 
@@ -18,24 +18,30 @@
 
 #include <atomic>
 #include <memory>
-#include <random>
 #include <string>
+#include <vector>
 
 #include <folly/detail/CacheLocality.h>
 #include <folly/fibers/FiberManager.h>
+#include <folly/ProducerConsumerQueue.h>
 #include <folly/Range.h>
 
+#include "mcrouter/AtomicTokenBucket.h"
 #include "mcrouter/config.h"
 #include "mcrouter/CyclesObserver.h"
 #include "mcrouter/ExponentialSmoothData.h"
+#include "mcrouter/KeyspaceStats.h"
+#include "mcrouter/lib/fbi/cpp/Xoshiro256Plus.h"
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/mc/protocol.h"
+#include "mcrouter/lib/MemoryBudget.h"
 #include "mcrouter/lib/network/ThriftMessageList.h"
 #include "mcrouter/lib/network/UniqueIntrusiveList.h"
 #include "mcrouter/Observable.h"
 #include "mcrouter/options.h"
 #include "mcrouter/ProxyRequestPriority.h"
 #include "mcrouter/stats.h"
+#include "mcrouter/TscClock.h"
 
 // make sure MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND can be exactly divided by
 // MOVING_AVERAGE_BIN_SIZE_IN_SECOND
@@ -56,9 +62,11 @@ template <int op_id>
 struct McOperation;
 template <class T>
 class MessageQueue;
+class PeriodicTaskScheduler;
 
 namespace mcrouter {
 // forward declaration
+class DeleteRetryQueue;
 class McrouterClient;
 class McrouterInstance;
 class ProxyConfig;
@@ -67,8 +75,11 @@ class ProxyDestinationMap;
 class ProxyRequestContext;
 template <class Request>
 class ProxyRequestContextTyped;
+class RequestSampler;
+class RouteHandleProfiler;
 class RuntimeVarsData;
 class ShardSplitter;
+class TkoEventRing;
 
 typedef Observable<std::shared_ptr<const RuntimeVarsData>>
   ObservableRuntimeVars;
@@ -104,6 +115,29 @@ struct ShadowSettings {
     return { fraction >> 32, fraction & ((1UL << 32) - 1) };
   }
 
+  /**
+   * Whether this shadow can see any traffic at all. A zero key fraction
+   * counts as disabled, so callers can gate each request on this single
+   * branch before doing any per-request work.
+   */
+  bool enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Consumes one token from the shadow sampling budget. Always succeeds
+   * when no budget ("max_shadow_rate") is configured.
+   *
+   * @return  false iff the budget is exhausted and this request
+   *          should not be shadowed.
+   */
+  bool consumeShadowBudget() {
+    if (maxShadowRate_ == 0.0) {
+      return true;
+    }
+    return shadowBudget_.consume(1.0, maxShadowRate_, maxShadowBurst_);
+  }
+
   /**
    * @throws std::logic_error if !(0 <= start <= end <= 1)
    */
@@ -120,6 +154,13 @@ struct ShadowSettings {
   size_t endIndex_{0};
 
   std::atomic<uint64_t> keyRange_{0};
+  std::atomic<bool> enabled_{false};
+
+  /* Tokens per second / burst for the shadow sampling budget;
+     a zero rate means "no budget configured". */
+  double maxShadowRate_{0.0};
+  double maxShadowBurst_{0.0};
+  DynamicAtomicTokenBucket shadowBudget_;
 
   bool validateReplies_{false};
 
@@ -130,6 +171,7 @@ struct ProxyMessage {
   enum class Type {
     REQUEST,
     OLD_CONFIG,
+    POOL_SWAP,
     SHUTDOWN
   };
 
@@ -152,10 +194,51 @@ struct proxy_t {
 
   std::unique_ptr<ProxyDestinationMap> destinationMap;
 
-  // async spool related
-  std::shared_ptr<folly::File> async_fd{nullptr};
-  time_t async_spool_time{0};
+  /*
+   * Number of McrouterClients currently pinned to this proxy, and a flag
+   * set once the owning ProxyThread starts retiring (see
+   * McrouterInstance::removeProxyThread()). A retiring proxy thread
+   * exits its loop when the last pinned client goes away and all
+   * in-flight work has drained.
+   */
+  std::atomic<size_t> boundClients{0};
+  std::atomic<bool> beingRetired{false};
 
+  /*
+   * Per-lane asynclog spool state (--asynclog-lanes). Entries are
+   * partitioned across lanes by a hash of the pool name (see
+   * asynclog_lane()); each lane has its own awriter thread and its own
+   * spool file sequence, so replay of one backed-up pool isn't
+   * serialized behind the others.
+   */
+  struct AsynclogLane {
+    std::shared_ptr<folly::File> spoolFd{nullptr};
+    time_t spoolTime{0};
+    /*
+     * Entries waiting for the next batched write. Only touched from the
+     * lane's awriter thread (and from the proxy destructor, which runs
+     * after the awriters have been stopped).
+     */
+    std::vector<std::string> batch;
+    size_t batchBytes{0};
+    bool flushPending{false};
+    /*
+     * Memory tier of the asynclog spool (--asynclog-spool-ring-size):
+     * a lock-free single-producer (proxy thread) single-consumer (the
+     * lane's awriter thread) ring of serialized records, drained into
+     * batch by the awriter. nullptr if the memory tier is disabled.
+     */
+    std::unique_ptr<folly::ProducerConsumerQueue<std::string>> ring;
+    std::atomic<bool> drainPending{false};
+  };
+  /* Sized once in the constructor and never resized after. */
+  std::vector<AsynclogLane> asynclogLanes;
+
+  // Protects stats_bin[], stats_num_within_window[] and num_bins_used,
+  // which are shared between the stat updater thread and stats queries.
+  // The stats[] counters themselves are accessed with relaxed atomics
+  // and are never written outside the owning proxy thread (except the
+  // per-bin reset of max stats), so the request path takes no lock.
   std::mutex stats_lock;
   stat_t stats[num_stats];
 
@@ -173,11 +256,21 @@ struct proxy_t {
    * where each element (stats_bin[stat_name][idx]) is either the count (if it
    * is a rate_stat) or the max (if it is a max_stat) of "stat_name" in the
    * "idx"th time bin. The updater thread updates these circular arrays once
-   * every MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND second by setting the oldest
-   * time bin to stats[stat_name], and then reset stats[stat_name] to 0.
+   * every MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND second: rate stats are
+   * monotonic counters, so the oldest time bin is set to the delta since
+   * the previous snapshot (see stats_prev_rate_value); max stats are
+   * snapshotted with a read-and-reset.
    */
   uint64_t stats_bin[num_stats][MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND /
                                 MOVING_AVERAGE_BIN_SIZE_IN_SECOND];
+
+  /*
+   * stats_prev_rate_value[stat_name] is the value of the (cumulative) rate
+   * stat "stat_name" at the time of the last bin snapshot. Owned
+   * exclusively by the stat updater thread; it is what lets the updater
+   * take per-bin deltas without ever writing to stats[].
+   */
+  uint64_t stats_prev_rate_value[num_stats];
   /*
    * stats_num_within_window[stat_name] contains the count of stat "stat_name"
    * in the past MOVING_AVERAGE_WINDOW_SIZE_IN_SECOND seconds. this array is
@@ -194,7 +287,11 @@ struct proxy_t {
    */
   int num_bins_used{0};
 
-  std::mt19937 randomGenerator;
+  /**
+   * Cheap per-proxy randomness for jitter and sampling decisions.
+   * Only safe to use from this proxy's thread.
+   */
+  Xoshiro256Plus randomGenerator;
 
   /**
    * If true, processing new requests is not safe.
@@ -202,15 +299,73 @@ struct proxy_t {
   bool being_destroyed{false};
 
   folly::fibers::FiberManager fiberManager;
+  /**
+   * Secondary fiber pool with small stacks; requests routed through
+   * shallow route trees run here (see routeFiberManager()).
+   */
+  folly::fibers::FiberManager smallStackFiberManager;
   CyclesObserver cyclesObserver;
+  TscClockCalibrator tscClockCalibrator;
 
   std::unique_ptr<ProxyStatsContainer> statsContainer;
 
+  /**
+   * Non-null iff request sampling is enabled
+   * (see --request-sampling-rate).
+   */
+  std::unique_ptr<RequestSampler> requestSampler;
+
+  /**
+   * Always-on ring of the most recent TKO transitions seen by this
+   * proxy (see the tko_events ServiceInfo command).
+   */
+  std::unique_ptr<TkoEventRing> tkoEventRing;
+
+  /**
+   * Non-null iff route handle profiling is enabled
+   * (see --route-handle-profiling).
+   */
+  std::unique_ptr<RouteHandleProfiler> routeHandleProfiler;
+
+  /**
+   * Per-namespace hit/miss counters, keyed by namespace name (see
+   * "keyspaces" in config).  Owned here rather than by the config so
+   * counts survive config swaps; the active config's KeyspaceStats
+   * table points into this map.  Written only by this proxy's thread.
+   */
+  KeyspaceStats::CounterMap keyspaceCounters;
+
+  /**
+   * Non-null iff the in-memory retry stage for failed deletes is
+   * enabled (see --asynclog-retry-count).
+   */
+  std::unique_ptr<DeleteRetryQueue> deleteRetryQueue;
+
+  /**
+   * Cumulative CPU time consumed by this proxy's thread and its recent
+   * utilization (busy time over wall time of the last sampling window,
+   * in permille).  Sampled on the proxy thread once a second; readable
+   * from any thread.  All zero where per-thread CPU accounting is
+   * unavailable (see ThreadUtil.h).
+   */
+  std::atomic<uint64_t> threadCpuUserUs{0};
+  std::atomic<uint64_t> threadCpuSystemUs{0};
+  std::atomic<uint64_t> threadCpuBusyPermille{0};
+
   folly::EventBase& eventBase() const {
     assert(eventBase_ != nullptr);
     return *eventBase_;
   }
 
+  /**
+   * The event base's shared timer for periodic housekeeping tasks.
+   * Valid once the proxy is attached to its event base.
+   */
+  PeriodicTaskScheduler& taskScheduler() const {
+    assert(taskScheduler_ != nullptr);
+    return *taskScheduler_;
+  }
+
   ~proxy_t();
 
   /**
@@ -233,6 +388,45 @@ struct proxy_t {
   std::shared_ptr<ProxyConfig> swapConfig(
       std::shared_ptr<ProxyConfig> newConfig);
 
+  /**
+   * Which slice of the canary experiment a request was routed through.
+   * kNone when no canary is active (the common case).
+   */
+  enum class CanarySlice {
+    kNone,
+    kStable,
+    kCanary,
+  };
+
+  /**
+   * Config to route a request through.  Normally the running config;
+   * while a canary is active (see --config-canary-rate), the 1-in-N
+   * slice of requests selected by hashing the routing key gets the
+   * canary config instead.  The slice is deterministic per key, so
+   * retries of a request always see the same config.
+   */
+  std::pair<std::shared_ptr<ProxyConfig>, CanarySlice> pickConfigForRequest(
+      folly::StringPiece routingKey);
+
+  /**
+   * Records the outcome of a request routed while a canary was active
+   * and, once the evaluation window has elapsed, promotes or rolls back
+   * the canary.  No-op (and cheap) for slice == kNone.
+   *
+   * Must be called from the proxy thread.
+   */
+  void canaryObserveReply(CanarySlice slice,
+                          mc_res_t result,
+                          int64_t latencyUs);
+
+  /**
+   * Installs a freshly built config as a canary next to the running one,
+   * resetting the evaluation counters.  A canary still under evaluation
+   * is discarded in favor of the newer push.  A running config must
+   * already be installed to compare against.
+   */
+  void beginConfigCanary(std::shared_ptr<ProxyConfig> config);
+
   /** Queue up and route the new incoming request */
   template <class Request>
   void dispatchRequest(
@@ -270,6 +464,20 @@ struct proxy_t {
    */
   const McrouterOptions& getRouterOptions() const;
 
+  /**
+   * Fiber pool to route a request on, given the (cached) upper bound on
+   * the config's route tree depth: trees no deeper than
+   * fibers_small_stack_max_depth run on the small-stack pool.
+   */
+  folly::fibers::FiberManager& routeFiberManager(size_t routeTreeDepth);
+
+  /**
+   * True if either fiber pool has pending or running tasks.
+   */
+  bool fiberManagersHaveTasks() const {
+    return fiberManager.hasTasks() || smallStackFiberManager.hasTasks();
+  }
+
  private:
   folly::EventBase* eventBase_{nullptr};
 
@@ -277,9 +485,53 @@ struct proxy_t {
   SFRLock configLock_;
   std::shared_ptr<ProxyConfig> config_;
 
+  /**
+   * Non-null while a newly pushed config is being canaried
+   * (see --config-canary-rate).  Guarded by configLock_.
+   */
+  std::shared_ptr<ProxyConfig> canaryConfig_;
+
+  /** nowUs() when the current canary was installed. */
+  std::atomic<int64_t> canaryStartUs_{0};
+
+  /**
+   * Per-slice outcome counters for the current canary window.  The proxy
+   * thread bumps them; the config thread resets them when installing a
+   * new canary, so they are atomic rather than guarded by configLock_.
+   */
+  std::atomic<uint64_t> canaryRequests_{0};
+  std::atomic<uint64_t> canaryErrors_{0};
+  std::atomic<uint64_t> canaryLatencySumUs_{0};
+  std::atomic<uint64_t> stableRequests_{0};
+  std::atomic<uint64_t> stableErrors_{0};
+  std::atomic<uint64_t> stableLatencySumUs_{0};
+
+  /**
+   * Ends the canary window: promotes the canary config if its error rate
+   * and mean latency stayed within --config-canary-slack-percent of the
+   * running config's, drops it otherwise.  The retired config is
+   * destroyed through the usual OLD_CONFIG message.
+   */
+  void finishConfigCanary();
+
   // Stores the id of the next request.
   uint64_t nextReqId_ = 0;
 
+  // Previous thread-CPU sample, used to derive the utilization window.
+  // Only touched from the proxy thread.
+  double lastThreadCpuSec_{0.0};
+  int64_t lastThreadCpuSampleUs_{0};
+
+  /**
+   * Reads this thread's CPU time and publishes the counters above.
+   * Runs on the proxy thread via the task scheduler.
+   */
+  void sampleThreadCpu();
+
+  // Declared before messageQueue_: the queue's drain tick is registered
+  // with the scheduler, so the scheduler must outlive it.
+  std::unique_ptr<PeriodicTaskScheduler> taskScheduler_;
+
   std::unique_ptr<MessageQueue<ProxyMessage>> messageQueue_;
 
   struct ProxyDelayedDestructor {
@@ -317,16 +569,24 @@ struct proxy_t {
       std::unique_ptr<ProxyRequestContextTyped<
         TypedThriftRequest<cpp2::McVersionRequest>>> ctx);
 
+  /** Split a bulk delete into per-key deletes and route them as one batch */
+  void routeHandlesProcessRequest(
+      const TypedThriftRequest<cpp2::McBulkDeleteRequest>& req,
+      std::unique_ptr<ProxyRequestContextTyped<
+        TypedThriftRequest<cpp2::McBulkDeleteRequest>>> ctx);
+
   /** Route request through route handle tree */
   template <class Request>
-  typename std::enable_if<TRequestListContains<Request>::value, void>::type
+  typename std::enable_if<RoutedRequestListContains<Request>::value,
+                          void>::type
   routeHandlesProcessRequest(
       const Request& req,
       std::unique_ptr<ProxyRequestContextTyped<Request>> ctx);
 
   /** Fail all unknown operations */
   template <class Request>
-  typename std::enable_if<!TRequestListContains<Request>::value, void>::type
+  typename std::enable_if<!RoutedRequestListContains<Request>::value,
+                          void>::type
   routeHandlesProcessRequest(
       const Request& req,
       std::unique_ptr<ProxyRequestContextTyped<Request>> ctx);
@@ -369,7 +629,11 @@ struct proxy_t {
     using Queue =
         UniqueIntrusiveList<WaitingRequestBase, &WaitingRequestBase::hook>;
 
-    virtual ~WaitingRequestBase() = default;
+    virtual ~WaitingRequestBase() {
+      MemoryBudget::instance().account(
+          MemoryBudget::kWaitingRequests,
+          -static_cast<int64_t>(accountedBytes_));
+    }
 
     /**
      * Continue processing proxy request.
@@ -380,6 +644,25 @@ struct proxy_t {
      * (e.g. Operation and Request).
      */
     virtual void process(proxy_t* proxy) = 0;
+
+    void setTimePushedOnQueue(int64_t now) { timePushedOnQueue_ = now; }
+    int64_t timePushedOnQueue() const { return timePushedOnQueue_; }
+
+    /**
+     * Charges the request's estimated footprint against
+     * MemoryBudget::kWaitingRequests for as long as it sits on the queue.
+     */
+    void setAccountedBytes(size_t bytes) {
+      accountedBytes_ = bytes;
+      MemoryBudget::instance().account(
+          MemoryBudget::kWaitingRequests, static_cast<int64_t>(bytes));
+    }
+
+   protected:
+    /** Time the request was enqueued, or -1 if we don't track it */
+    int64_t timePushedOnQueue_{-1};
+    /** Bytes charged against the global memory budget */
+    size_t accountedBytes_{0};
   };
 
   template <class Request>
@@ -389,23 +672,45 @@ struct proxy_t {
         const Request& req,
         std::unique_ptr<ProxyRequestContextTyped<Request>> ctx);
     void process(proxy_t* proxy) override final;
-    void setTimePushedOnQueue(int64_t now) { timePushedOnQueue_ = now; }
 
    private:
     const Request& req_;
     std::unique_ptr<ProxyRequestContextTyped<Request>> ctx_;
-
-    int64_t timePushedOnQueue_{-1};
   };
 
   /** Queue of requests we didn't start processing yet */
   WaitingRequestBase::Queue
       waitingRequests_[static_cast<int>(ProxyRequestPriority::kNumPriorities)];
 
+  /**
+   * Per-priority drain weights for pump(), parsed from the
+   * proxy_queue_weights option. Empty if the option is unset, in which
+   * case the queues are drained in strict priority order.
+   */
+  std::vector<uint64_t> drainWeights_;
+
+  /**
+   * Per-priority shed thresholds (fractions of the global memory budget),
+   * parsed from the memory_shed_thresholds option. Empty if no budget is
+   * configured, in which case no memory-based shedding happens.
+   */
+  std::vector<double> shedThresholds_;
+  /** Priority queue the weighted scheduler is currently draining */
+  int drainQueue_{0};
+  /** Requests the current queue may drain before rotating to the next one */
+  uint64_t drainCredits_{0};
+
   /** If true, we can't start processing this request right now */
   template <class Request>
   bool rateLimited(ProxyRequestPriority priority, const Request&) const;
 
+  /**
+   * If true, the global memory budget is over this priority's shed
+   * threshold and the request should be rejected with mc_res_busy.
+   */
+  template <class Request>
+  bool memoryShed(ProxyRequestPriority priority, const Request&) const;
+
   /** Will let through requests from the above queue if we have capacity */
   void pump();
 
@@ -429,6 +734,25 @@ struct old_config_req_t {
   std::shared_ptr<ProxyConfig> config_;
 };
 
+/**
+ * Posted to other proxy threads by the "pool_swap" service info
+ * command; each proxy applies the swap against whatever config it
+ * currently runs.
+ */
+struct pool_swap_req_t {
+  pool_swap_req_t(std::string poolName, std::string target)
+    : poolName_(std::move(poolName)),
+      target_(std::move(target)) {
+  }
+
+  const std::string& poolName() const { return poolName_; }
+  const std::string& target() const { return target_; }
+
+ private:
+  std::string poolName_;
+  std::string target_;
+};
+
 void proxy_config_swap(proxy_t* proxy,
                        std::shared_ptr<ProxyConfig> config);
 
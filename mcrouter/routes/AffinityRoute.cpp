@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "AffinityRoute.h"
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+constexpr size_t AffinityRoute::RotatingBloomFilter::kBits;
+constexpr size_t AffinityRoute::RotatingBloomFilter::kWords;
+constexpr size_t AffinityRoute::RotatingBloomFilter::kNumHashes;
+
+McrouterRouteHandlePtr makeAffinityRoute(
+    McrouterRouteHandlePtr read,
+    McrouterRouteHandlePtr write,
+    std::vector<McrouterRouteHandlePtr> replicas,
+    std::chrono::milliseconds window) {
+  return std::make_shared<McrouterRouteHandle<AffinityRoute>>(
+    std::move(read), std::move(write), std::move(replicas), window);
+}
+
+McrouterRouteHandlePtr makeAffinityRoute(
+    RouteHandleFactory<McrouterRouteHandleIf>& factory,
+    const folly::dynamic& json) {
+  checkLogic(json.isObject(), "AffinityRoute should be an object");
+
+  auto jread = json.get_ptr("read");
+  checkLogic(jread != nullptr, "AffinityRoute: read not specified");
+  auto read = factory.create(*jread);
+
+  auto jwrite = json.get_ptr("write");
+  checkLogic(jwrite != nullptr, "AffinityRoute: write not specified");
+  auto write = factory.create(*jwrite);
+
+  auto jreplicas = json.get_ptr("replicas");
+  checkLogic(jreplicas != nullptr, "AffinityRoute: replicas not specified");
+  auto replicas = factory.createList(*jreplicas);
+  checkLogic(!replicas.empty(), "AffinityRoute: replicas list is empty");
+
+  std::chrono::milliseconds window{4000};
+  if (auto jwindow = json.get_ptr("window_ms")) {
+    checkLogic(jwindow->isInt(), "AffinityRoute: window_ms is not an integer");
+    checkLogic(jwindow->getInt() > 0,
+               "AffinityRoute: window_ms should be positive");
+    window = std::chrono::milliseconds(jwindow->getInt());
+  }
+
+  return makeAffinityRoute(std::move(read), std::move(write),
+                           std::move(replicas), window);
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,198 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/SpookyHashV2.h>
+
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/proxy.h"
+#include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Read-my-write affinity for replicated pools.
+ *
+ * A client that reads right after writing may hit a replica that hasn't
+ * applied the write yet. This route remembers recently-written keys in a
+ * rotating bloom filter and pins reads of those keys to the replica the
+ * key hashes to, so consecutive reads of a fresh key all see the same
+ * replica instead of bouncing between ones in different states. Reads of
+ * keys with no recent write go through the normal read policy (e.g.
+ * LatestRoute), keeping its load-balancing behavior.
+ *
+ * 'replicas' must list the replicas in the same order as the write path's
+ * children so the hashed pick agrees with the write. The filter keeps a
+ * key for at least window/2 and at most one full window; false positives
+ * only cost a read its preferred-replica load balancing, never
+ * correctness.
+ */
+class AffinityRoute {
+ public:
+  static std::string routeName() { return "affinity"; }
+
+  AffinityRoute(McrouterRouteHandlePtr read,
+                McrouterRouteHandlePtr write,
+                std::vector<McrouterRouteHandlePtr> replicas,
+                std::chrono::milliseconds window)
+    : read_(std::move(read)),
+      write_(std::move(write)),
+      replicas_(std::move(replicas)),
+      filter_(std::chrono::duration_cast<std::chrono::microseconds>(window)) {
+
+    assert(read_ != nullptr);
+    assert(write_ != nullptr);
+    assert(!replicas_.empty());
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*read_, req);
+    t(*write_, req);
+  }
+
+  template <class Request>
+  typename std::enable_if<GetLike<Request>::value, ReplyT<Request>>::type
+  route(const Request& req) {
+    auto key = req.fullKey();
+    if (filter_.mayContain(key, nowUs())) {
+      auto& proxy = fiber_local::getSharedCtx()->proxy();
+      stat_incr(proxy.stats, affinity_reads_stat, 1);
+      return replicas_[replicaIndex(key)]->route(req);
+    }
+    return read_->route(req);
+  }
+
+  template <class Request>
+  typename std::enable_if<UpdateLike<Request>::value ||
+                          DeleteLike<Request>::value ||
+                          ArithmeticLike<Request>::value,
+                          ReplyT<Request>>::type
+  route(const Request& req) {
+    filter_.record(req.fullKey(), nowUs());
+    return write_->route(req);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(
+      const Request& req,
+      OtherThanT<Request,
+                 GetLike<>, UpdateLike<>, DeleteLike<>,
+                 ArithmeticLike<>> = 0) {
+    return read_->route(req);
+  }
+
+ private:
+  /**
+   * Two-generation bloom filter: inserts go to the current generation,
+   * lookups check both. Every half window the previous generation is
+   * dropped and the current one takes its place, so membership expires
+   * without ever rehashing or scanning keys.
+   *
+   * Sized for roughly 100k distinct keys per generation at a ~1% false
+   * positive rate; 128KB per generation. Single-threaded by construction:
+   * route handles are per-proxy and run on the proxy's event base.
+   */
+  class RotatingBloomFilter {
+   public:
+    explicit RotatingBloomFilter(std::chrono::microseconds window)
+        : halfWindowUs_(window.count() / 2),
+          current_(kWords, 0),
+          previous_(kWords, 0) {
+      assert(halfWindowUs_ > 0);
+    }
+
+    void record(folly::StringPiece key, int64_t now) {
+      maybeRotate(now);
+      uint64_t h1 = 0;
+      uint64_t h2 = 0;
+      folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+      h2 |= 1;
+      for (size_t i = 0; i < kNumHashes; ++i) {
+        const size_t bit = (h1 + i * h2) & (kBits - 1);
+        current_[bit / 64] |= 1ULL << (bit % 64);
+      }
+    }
+
+    bool mayContain(folly::StringPiece key, int64_t now) {
+      maybeRotate(now);
+      uint64_t h1 = 0;
+      uint64_t h2 = 0;
+      folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+      h2 |= 1;
+      bool inCurrent = true;
+      bool inPrevious = true;
+      for (size_t i = 0; i < kNumHashes; ++i) {
+        const size_t bit = (h1 + i * h2) & (kBits - 1);
+        const uint64_t mask = 1ULL << (bit % 64);
+        inCurrent = inCurrent && (current_[bit / 64] & mask);
+        inPrevious = inPrevious && (previous_[bit / 64] & mask);
+        if (!inCurrent && !inPrevious) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+   private:
+    static constexpr size_t kBits = 1 << 20;
+    static constexpr size_t kWords = kBits / 64;
+    static constexpr size_t kNumHashes = 4;
+
+    void maybeRotate(int64_t now) {
+      if (lastRotateUs_ == 0) {
+        lastRotateUs_ = now;
+        return;
+      }
+      if (now - lastRotateUs_ < halfWindowUs_) {
+        return;
+      }
+      if (now - lastRotateUs_ >= 2 * halfWindowUs_) {
+        /* Idle for a full window: everything has expired. */
+        std::fill(previous_.begin(), previous_.end(), 0);
+      } else {
+        current_.swap(previous_);
+      }
+      std::fill(current_.begin(), current_.end(), 0);
+      lastRotateUs_ = now;
+    }
+
+    const int64_t halfWindowUs_;
+    int64_t lastRotateUs_{0};
+    std::vector<uint64_t> current_;
+    std::vector<uint64_t> previous_;
+  };
+
+  const McrouterRouteHandlePtr read_;
+  const McrouterRouteHandlePtr write_;
+  const std::vector<McrouterRouteHandlePtr> replicas_;
+  RotatingBloomFilter filter_;
+
+  size_t replicaIndex(folly::StringPiece key) const {
+    return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(),
+                                             /* seed= */ 0) %
+        replicas_.size();
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -10,8 +10,7 @@
 #include <folly/dynamic.h>
 
 #include "mcrouter/lib/config/RouteHandleFactory.h"
-#include "mcrouter/lib/routes/AllFastestRoute.h"
-#include "mcrouter/routes/McRouteHandleBuilder.h"
+#include "mcrouter/routes/AllFastestRoute.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -29,7 +28,7 @@ McrouterRouteHandlePtr makeAllFastestRoute(
     return std::move(rh[0]);
   }
 
-  return makeMcrouterRouteHandle<AllFastestRoute>(std::move(rh));
+  return std::make_shared<McrouterRouteHandle<AllFastestRoute>>(std::move(rh));
 }
 
 McrouterRouteHandlePtr makeAllFastestRoute(
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/fibers/AddTasks.h>
+
+#include "mcrouter/lib/network/RequestAborter.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Sends the same request to all child route handles.
+ * Returns the fastest non-error reply, or, if there are no non-error replies,
+ * the last error reply.
+ *
+ * Unlike the generic AllFastestRoute, once the winning reply is picked the
+ * losing children are torn down: their requests that weren't written to the
+ * network yet are aborted instead of burning downstream capacity. Requests
+ * that already hit the wire complete normally and their replies are
+ * discarded.
+ */
+class AllFastestRoute {
+ public:
+  static std::string routeName() { return "all-fastest"; }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(children_, req);
+  }
+
+  explicit AllFastestRoute(std::vector<McrouterRouteHandlePtr> rh)
+      : children_(std::move(rh)) {
+    assert(!children_.empty());
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) const {
+    using Reply = ReplyT<Request>;
+
+    auto aborter = std::make_shared<RequestAborter>();
+
+    std::vector<std::function<Reply()>> funcs;
+    funcs.reserve(children_.size());
+    auto reqCopy = std::make_shared<Request>(req.clone());
+    for (auto& rh : children_) {
+      funcs.push_back(
+        [reqCopy, rh, aborter]() {
+          if (aborter->aborted()) {
+            return Reply(mc_res_aborted);
+          }
+          // Affects only this task's copy of the fiber locals.
+          fiber_local::setRequestAborter(aborter);
+          return rh->route(*reqCopy);
+        }
+      );
+    }
+
+    auto taskIt = folly::fibers::addTasks(funcs.begin(), funcs.end());
+    while (true) {
+      auto reply = taskIt.awaitNext();
+      if (!reply.isFailoverError() || !taskIt.hasNext()) {
+        if (taskIt.hasNext()) {
+          aborter->abortAll();
+        }
+        return reply;
+      }
+    }
+  }
+
+ private:
+  const std::vector<McrouterRouteHandlePtr> children_;
+};
+
+}}}  // facebook::memcache::mcrouter
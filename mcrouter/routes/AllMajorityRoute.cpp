@@ -10,8 +10,7 @@
 #include <folly/dynamic.h>
 
 #include "mcrouter/lib/config/RouteHandleFactory.h"
-#include "mcrouter/lib/routes/AllMajorityRoute.h"
-#include "mcrouter/routes/McRouteHandleBuilder.h"
+#include "mcrouter/routes/AllMajorityRoute.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -29,7 +28,7 @@ McrouterRouteHandlePtr makeAllMajorityRoute(
     return std::move(rh[0]);
   }
 
-  return makeMcrouterRouteHandle<AllMajorityRoute>(std::move(rh));
+  return std::make_shared<McrouterRouteHandle<AllMajorityRoute>>(std::move(rh));
 }
 
 McrouterRouteHandlePtr makeAllMajorityRoute(
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/fibers/AddTasks.h>
+
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/lib/network/RequestAborter.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/Reply.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Sends the same request to all child route handles and responds with one
+ * of the replies with the most common result.
+ *
+ * Unlike the generic AllMajorityRoute, this replies the moment the outcome
+ * is mathematically decided - no combination of outstanding replies can
+ * displace the current leading result - and tears the losers down the same
+ * way AllFastestRoute does: outstanding requests that weren't written to
+ * the network yet are aborted instead of burning downstream capacity. In
+ * the common unanimous-success case that means replying after half + 1
+ * replies and cancelling the rest of the fanout.
+ */
+class AllMajorityRoute {
+ public:
+  static std::string routeName() { return "all-majority"; }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(children_, req);
+  }
+
+  explicit AllMajorityRoute(std::vector<McrouterRouteHandlePtr> rh)
+      : children_(std::move(rh)) {
+    assert(!children_.empty());
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) const {
+    using Reply = ReplyT<Request>;
+
+    auto aborter = std::make_shared<RequestAborter>();
+
+    std::vector<std::function<Reply()>> funcs;
+    funcs.reserve(children_.size());
+    auto reqCopy = std::make_shared<Request>(req.clone());
+    for (auto& rh : children_) {
+      funcs.push_back(
+        [reqCopy, rh, aborter]() {
+          if (aborter->aborted()) {
+            return Reply(mc_res_aborted);
+          }
+          // Affects only this task's copy of the fiber locals.
+          fiber_local::setRequestAborter(aborter);
+          return rh->route(*reqCopy);
+        }
+      );
+    }
+
+    size_t counts[mc_nres];
+    std::fill(counts, counts + mc_nres, 0);
+    size_t majorityCount = 0;
+    Reply majorityReply = Reply(DefaultReply, req);
+
+    size_t remaining = children_.size();
+    auto taskIt = folly::fibers::addTasks(funcs.begin(), funcs.end());
+    taskIt.reserve(children_.size() / 2 + 1);
+    while (taskIt.hasNext()) {
+      auto reply = taskIt.awaitNext();
+      auto result = reply.result();
+      --remaining;
+
+      ++counts[result];
+      if ((counts[result] == majorityCount && reply.worseThan(majorityReply)) ||
+          (counts[result] > majorityCount)) {
+        majorityReply = std::move(reply);
+        majorityCount = counts[result];
+      }
+
+      if (decided(counts, majorityReply.result(), majorityCount, remaining)) {
+        break;
+      }
+    }
+
+    if (taskIt.hasNext()) {
+      aborter->abortAll();
+    }
+    return majorityReply;
+  }
+
+ private:
+  const std::vector<McrouterRouteHandlePtr> children_;
+
+  /**
+   * True once no outstanding reply can displace the leading result: every
+   * other result would still fall strictly short of the leader's count
+   * even if all remaining replies went to it. Strictly short, because a
+   * result that ties the leader can take over via reduce()'s tie-break.
+   */
+  static bool decided(const size_t (&counts)[mc_nres],
+                      mc_res_t leader,
+                      size_t majorityCount,
+                      size_t remaining) {
+    if (remaining == 0) {
+      return true;
+    }
+    for (size_t r = 0; r < mc_nres; ++r) {
+      if (r != static_cast<size_t>(leader) &&
+          counts[r] + remaining >= majorityCount) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
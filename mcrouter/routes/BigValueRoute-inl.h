@@ -13,6 +13,7 @@
 #include <folly/fibers/WhenN.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/Optional.h>
 #include <folly/Range.h>
 
 #include "mcrouter/lib/IOBufUtil.h"
@@ -23,21 +24,34 @@ template <class Reply>
 std::vector<Reply> BigValueRoute::collectAllByBatches(
   std::vector<std::function<Reply()>>& fs) const {
 
-  auto batchSize = options_.batchSize_;
-  if (batchSize == 0) {
-    batchSize = fs.size();
+  auto window = options_.batchSize_;
+  if (window == 0 || window > fs.size()) {
+    window = fs.size();
   }
 
+  /* Sliding window: keep up to `window` chunk requests in flight and
+     start the next one as soon as any slot frees up, so one slow chunk
+     no longer stalls the whole next batch. */
+  std::vector<folly::Optional<Reply>> replies(fs.size());
+  size_t next = 0;
+  std::vector<std::function<void()>> workers;
+  workers.reserve(window);
+  for (size_t w = 0; w < window; ++w) {
+    workers.push_back(
+      [&fs, &replies, &next]() {
+        while (next < fs.size()) {
+          auto i = next++;
+          replies[i].emplace(fs[i]());
+        }
+      }
+    );
+  }
+  folly::fibers::collectAll(workers.begin(), workers.end());
+
   std::vector<Reply> allReplies;
-  size_t b = 0;
-  size_t e = std::min(fs.size(), batchSize);
-  while (b < fs.size()) {
-    auto replies = folly::fibers::collectAll(fs.begin() + b, fs.begin() + e);
-    for (auto& r : replies) {
-      allReplies.emplace_back(std::move(r));
-    }
-    b = e;
-    e = std::min(fs.size(), e + batchSize);
+  allReplies.reserve(replies.size());
+  for (auto& r : replies) {
+    allReplies.emplace_back(std::move(r.value()));
   }
   return allReplies;
 }
@@ -99,7 +113,9 @@ ReplyT<Request> BigValueRoute::route(const Request& req,
     return ch_->route(req);
   }
 
-  auto reqs_info_pair = chunkUpdateRequests<ChunkUpdateT<Request>>(req);
+  auto reqs_info_pair = options_.dedupChunks_
+    ? chunkDedupUpdateRequests<ChunkUpdateT<Request>>(req)
+    : chunkUpdateRequests<ChunkUpdateT<Request>>(req);
   std::vector<std::function<UpdateReply()>> fs;
   fs.reserve(reqs_info_pair.first.size());
 
@@ -112,18 +128,25 @@ ReplyT<Request> BigValueRoute::route(const Request& req,
     );
   }
 
-  auto replies = collectAllByBatches(fs);
+  // in dedup mode every chunk may be unchanged, leaving nothing to send
+  mc_res_t chunksResult = mc_res_stored;
+  bool chunksStored = true;
+  if (!fs.empty()) {
+    auto replies = collectAllByBatches(fs);
+    // reply for all chunk update requests
+    auto reducedReply = UpdateReply::reduce(replies.begin(), replies.end());
+    chunksResult = reducedReply->result();
+    chunksStored = reducedReply->isStored();
+  }
 
-  // reply for all chunk update requests
-  auto reducedReply = UpdateReply::reduce(replies.begin(), replies.end());
-  if (reducedReply->isStored()) {
+  if (chunksStored) {
     // original key with modified value stored at the back
     auto new_req = req.clone();
     new_req.setFlags(req.flags() | MC_MSG_FLAG_BIG_VALUE);
     new_req.setValue(reqs_info_pair.second.toStringType());
     return ch_->route(new_req);
   } else {
-    return Reply(reducedReply->result());
+    return Reply(chunksResult);
   }
 }
 
@@ -160,6 +183,43 @@ BigValueRoute::chunkUpdateRequests(const FromRequest& req) const {
   return std::make_pair(std::move(big_set_reqs), info);
 }
 
+template <class ToRequest, class FromRequest>
+std::pair<std::vector<ToRequest>,
+          typename BigValueRoute::ChunksInfo>
+BigValueRoute::chunkDedupUpdateRequests(const FromRequest& req) const {
+  int num_chunks =
+      (req->get_value().computeChainDataLength() + options_.threshold_ - 1) /
+      options_.threshold_;
+
+  auto old_info = fetchChunksInfo(req.fullKey());
+
+  std::vector<uint64_t> chunk_hashes;
+  chunk_hashes.reserve(num_chunks);
+  std::vector<ToRequest> changed_reqs;
+
+  auto base_key = req.fullKey();
+  folly::IOBuf chunkValue;
+  folly::io::Cursor cursor(&req->get_value());
+  for (int i = 0; i < num_chunks; ++i) {
+    cursor.cloneAtMost(chunkValue, options_.threshold_);
+    auto hash = chunkHash(chunkValue);
+    chunk_hashes.push_back(hash);
+    // A chunk whose hash matches the previous version of the value is
+    // already stored under the same content-addressed key; skip it.
+    if (old_info && old_info->infoVersion() == 2 &&
+        static_cast<uint32_t>(i) < old_info->numChunks() &&
+        old_info->chunkHashes()[i] == hash) {
+      continue;
+    }
+    changed_reqs.emplace_back(createChunkKey(base_key, i, hash));
+    changed_reqs.back().setValue(std::move(chunkValue));
+    changed_reqs.back().setExptime(req.exptime());
+  }
+
+  return std::make_pair(std::move(changed_reqs),
+                        ChunksInfo(std::move(chunk_hashes)));
+}
+
 template<class ToRequest, class FromRequest>
 std::vector<ToRequest>
 BigValueRoute::chunkGetRequests(const FromRequest& req,
@@ -170,7 +230,7 @@ BigValueRoute::chunkGetRequests(const FromRequest& req,
   auto base_key = req.fullKey();
   for (uint32_t i = 0; i < info.numChunks(); i++) {
     // override key with chunk keys
-    big_get_reqs.emplace_back(createChunkKey(base_key, i, info.randSuffix()));
+    big_get_reqs.emplace_back(createChunkKey(base_key, i, info.suffixFor(i)));
   }
 
   return big_get_reqs;
@@ -9,20 +9,56 @@
  */
 #include "BigValueRoute.h"
 
+#include <folly/Conv.h>
+#include <folly/SpookyHashV2.h>
+#include <folly/String.h>
+
+#include "mcrouter/lib/IOBufUtil.h"
+
 namespace facebook { namespace memcache { namespace mcrouter {
 
 BigValueRoute::ChunksInfo::ChunksInfo(
     folly::StringPiece reply_value)
   : infoVersion_(1),
-    valid_(true) {
-  // Verify that reply_value is of the form version-numchunks-randSuffix,
-  // where version, numchunks and randsuffix should be numeric
+    numChunks_(0),
+    randSuffix_(0),
+    valid_(false) {
+  // Verify that reply_value is of the form version-numchunks-suffix,
+  // where suffix is a single random integer (version 1) or a
+  // comma-separated list of numChunks chunk hashes (version 2).
+  auto value_str = reply_value.str();
   uint32_t version;
-  int chars_read;
-  valid_ &= (sscanf(reply_value.data(), "%u-%u-%u%n",
-        &version, &numChunks_, &randSuffix_, &chars_read) == 3);
-  valid_ &= (static_cast<size_t>(chars_read) == reply_value.size());
-  valid_ &= (version == infoVersion_);
+  int chars_read = -1;
+  if (sscanf(value_str.c_str(), "%u-%u-%n",
+             &version, &numChunks_, &chars_read) != 2 ||
+      chars_read < 0 || static_cast<size_t>(chars_read) >= value_str.size()) {
+    return;
+  }
+  folly::StringPiece suffix(value_str);
+  suffix.advance(chars_read);
+
+  if (version == 1) {
+    int suffix_read = -1;
+    valid_ =
+      (sscanf(suffix.begin(), "%u%n", &randSuffix_, &suffix_read) == 1) &&
+      (static_cast<size_t>(suffix_read) == suffix.size());
+  } else if (version == 2) {
+    infoVersion_ = 2;
+    std::vector<folly::StringPiece> parts;
+    folly::split(',', suffix, parts);
+    if (parts.size() != numChunks_) {
+      return;
+    }
+    chunkHashes_.reserve(parts.size());
+    try {
+      for (const auto part : parts) {
+        chunkHashes_.push_back(folly::to<uint64_t>(part));
+      }
+    } catch (const std::range_error&) {
+      return;
+    }
+    valid_ = true;
+  }
 }
 
 BigValueRoute::ChunksInfo::ChunksInfo(uint32_t num_chunks)
@@ -31,13 +67,27 @@ BigValueRoute::ChunksInfo::ChunksInfo(uint32_t num_chunks)
     randSuffix_(rand()),
     valid_(true) {}
 
+BigValueRoute::ChunksInfo::ChunksInfo(std::vector<uint64_t> chunk_hashes)
+  : infoVersion_(2),
+    numChunks_(chunk_hashes.size()),
+    randSuffix_(0),
+    chunkHashes_(std::move(chunk_hashes)),
+    valid_(true) {}
+
 folly::IOBuf BigValueRoute::ChunksInfo::toStringType() const {
+  auto suffix = infoVersion_ == 1
+    ? folly::to<std::string>(randSuffix_)
+    : folly::join(",", chunkHashes_);
   return folly::IOBuf(
     folly::IOBuf::COPY_BUFFER,
-    folly::sformat("{}-{}-{}", infoVersion_, numChunks_, randSuffix_)
+    folly::sformat("{}-{}-{}", infoVersion_, numChunks_, suffix)
   );
 }
 
+uint32_t BigValueRoute::ChunksInfo::infoVersion() const {
+  return infoVersion_;
+}
+
 uint32_t BigValueRoute::ChunksInfo::numChunks() const {
   return numChunks_;
 }
@@ -46,6 +96,18 @@ uint32_t BigValueRoute::ChunksInfo::randSuffix() const {
   return randSuffix_;
 }
 
+const std::vector<uint64_t>& BigValueRoute::ChunksInfo::chunkHashes() const {
+  return chunkHashes_;
+}
+
+uint64_t BigValueRoute::ChunksInfo::suffixFor(uint32_t chunk_index) const {
+  if (infoVersion_ == 1) {
+    return randSuffix_;
+  }
+  assert(chunk_index < chunkHashes_.size());
+  return chunkHashes_[chunk_index];
+}
+
 bool BigValueRoute::ChunksInfo::valid() const {
   return valid_;
 }
@@ -68,6 +130,30 @@ folly::IOBuf BigValueRoute::createChunkKey(
   );
 }
 
+folly::Optional<BigValueRoute::ChunksInfo>
+BigValueRoute::fetchChunksInfo(folly::StringPiece key) const {
+  TypedThriftRequest<cpp2::McGetRequest> req(
+      folly::IOBuf(folly::IOBuf::COPY_BUFFER, key));
+  auto reply = ch_->route(req);
+  if (!reply.isHit() || !(reply.flags() & MC_MSG_FLAG_BIG_VALUE)) {
+    return folly::none;
+  }
+  auto* value = reply.valuePtrUnsafe();
+  ChunksInfo info(value
+                  ? coalesceAndGetRange(*value)
+                  : folly::StringPiece(""));
+  if (!info.valid()) {
+    return folly::none;
+  }
+  return info;
+}
+
+uint64_t BigValueRoute::chunkHash(folly::IOBuf& chunk) {
+  auto range = coalesceAndGetRange(chunk);
+  return folly::hash::SpookyHashV2::Hash64(range.data(), range.size(),
+                                           /* seed= */ 0);
+}
+
 McrouterRouteHandlePtr makeBigValueRoute(McrouterRouteHandlePtr rh,
                                          BigValueRouteOptions options) {
   return std::make_shared<McrouterRouteHandle<BigValueRoute>>(
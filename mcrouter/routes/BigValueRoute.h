@@ -12,6 +12,7 @@
 #include <vector>
 
 #include <folly/Format.h>
+#include <folly/Optional.h>
 
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/OperationTraits.h"
@@ -44,6 +45,13 @@ namespace facebook { namespace memcache { namespace mcrouter {
  * to child route handle and return reply. Else, return worse of the
  * replies for chunk updates
  *
+ * With dedupChunks enabled, chunk keys are derived from the chunk content
+ * hash and the metadata value stores the per-chunk hashes, so an update
+ * only writes the chunks that differ from the currently stored version of
+ * the value. Skipped chunks keep the exptime of the write that created
+ * them, so this mode is only safe for values stored without expiration
+ * times.
+ *
  * Default behavior for other type of operations
  */
 class BigValueRoute {
@@ -72,20 +80,33 @@ class BigValueRoute {
   const McrouterRouteHandlePtr ch_;
   const BigValueRouteOptions options_;
 
+  /**
+   * Metadata stored under the original key. Version 1 addresses chunks
+   * with one random suffix shared by all chunks; version 2 (dedup mode)
+   * addresses each chunk by the hash of its content, so a rewrite can
+   * skip chunks whose content did not change.
+   */
   class ChunksInfo {
    public:
     explicit ChunksInfo(folly::StringPiece reply_value);
     explicit ChunksInfo(uint32_t num_chunks);
+    explicit ChunksInfo(std::vector<uint64_t> chunk_hashes);
 
     folly::IOBuf toStringType() const;
+    uint32_t infoVersion() const;
     uint32_t numChunks() const;
     uint32_t randSuffix() const;
+    const std::vector<uint64_t>& chunkHashes() const;
+    /* Key suffix of the given chunk: the shared random suffix for
+       version 1, the chunk's own content hash for version 2. */
+    uint64_t suffixFor(uint32_t chunk_index) const;
     bool valid() const;
 
    private:
-    const uint32_t infoVersion_;
+    uint32_t infoVersion_;
     uint32_t numChunks_;
     uint32_t randSuffix_;
+    std::vector<uint64_t> chunkHashes_;
     bool valid_;
   };
 
@@ -121,6 +142,23 @@ class BigValueRoute {
   std::pair<std::vector<ToRequest>, ChunksInfo>
   chunkUpdateRequests(const FromRequest& req) const;
 
+  /**
+   * Like chunkUpdateRequests(), but addresses chunks by content hash and
+   * omits requests for chunks already stored by the previous version of
+   * the value. The returned ChunksInfo always covers all chunks.
+   */
+  template <class ToRequest, class FromRequest>
+  std::pair<std::vector<ToRequest>, ChunksInfo>
+  chunkDedupUpdateRequests(const FromRequest& req) const;
+
+  /**
+   * Fetches and parses the chunks metadata currently stored under key.
+   * @return folly::none if there is no valid big value under key.
+   */
+  folly::Optional<ChunksInfo> fetchChunksInfo(folly::StringPiece key) const;
+
+  static uint64_t chunkHash(folly::IOBuf& chunk);
+
   template <class ToRequest, class FromRequest>
   std::vector<ToRequest> chunkGetRequests(const FromRequest& req,
                                           const ChunksInfo& info) const;
@@ -13,12 +13,17 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 struct BigValueRouteOptions {
   explicit BigValueRouteOptions(size_t threshold,
-                                size_t batchSize) :
+                                size_t batchSize,
+                                bool dedupChunks = false) :
       threshold_(threshold),
-      batchSize_(batchSize) {
+      batchSize_(batchSize),
+      dedupChunks_(dedupChunks) {
   }
   const size_t threshold_;
   const size_t batchSize_;
+  /* If set, chunk keys are addressed by chunk content hash and chunks
+     that did not change since the previous write are not rewritten. */
+  const bool dedupChunks_;
 };
 
 }}}  // facebook::memcache::mcrouter
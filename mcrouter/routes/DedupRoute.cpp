@@ -0,0 +1,34 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "DedupRoute.h"
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeDedupRoute(
+    RouteHandleFactory<McrouterRouteHandleIf>& factory,
+    const folly::dynamic& json) {
+  McrouterRouteHandlePtr target;
+  if (json.isObject()) {
+    if (auto jtarget = json.get_ptr("target")) {
+      target = factory.create(*jtarget);
+    }
+  } else if (json.isString()) {
+    target = factory.create(json);
+  }
+  checkLogic(target != nullptr, "DedupRoute: target not specified");
+  return std::make_shared<McrouterRouteHandle<DedupRoute>>(std::move(target));
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/fibers/Baton.h>
+#include <folly/io/IOBuf.h>
+#include <folly/Optional.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/proxy.h"
+#include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Coalesces concurrent identical gets within one proxy. The first fiber
+ * to ask for a key becomes the leader and routes downstream as usual;
+ * any fiber that asks for the same key while the leader is in flight
+ * parks on a baton and receives a copy of the leader's reply (the value
+ * IOBuf is cloned, so the payload itself is shared, not copied).
+ *
+ * During a hot-key storm this turns hundreds of identical requests per
+ * RTT into a single downstream request. Only plain gets are coalesced:
+ * gets/lease-get/metaget carry per-request tokens and every other
+ * operation is a mutation, so they all pass straight through.
+ *
+ * All state is fiber-local to the proxy thread; no locks are involved.
+ */
+class DedupRoute {
+ public:
+  static std::string routeName() { return "dedup"; }
+
+  explicit DedupRoute(McrouterRouteHandlePtr rh) : child_(std::move(rh)) {
+    assert(child_ != nullptr);
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*child_, req);
+  }
+
+  TypedThriftReply<cpp2::McGetReply> route(
+      const TypedThriftRequest<cpp2::McGetRequest>& req) {
+    auto key = req.fullKey();
+
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+      /* A leader is already in flight for this key; wait for its reply. */
+      Follower follower;
+      it->second.followers.push_back(&follower);
+      auto& proxy = fiber_local::getSharedCtx()->proxy();
+      stat_incr(proxy.stats, dedup_gets_stat, 1);
+      follower.baton.wait();
+      assert(follower.reply.hasValue());
+      return std::move(*follower.reply);
+    }
+
+    pending_.emplace(key, Pending());
+    auto reply = child_->route(req);
+
+    /* Iterators may have been invalidated by leaders of other keys
+       registering while we were suspended; look the entry up again. */
+    auto entryIt = pending_.find(key);
+    assert(entryIt != pending_.end());
+    for (auto* follower : entryIt->second.followers) {
+      follower->reply = cloneReply(reply);
+      follower->baton.post();
+    }
+    pending_.erase(entryIt);
+    return reply;
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) {
+    return child_->route(req);
+  }
+
+ private:
+  struct Follower {
+    folly::fibers::Baton baton;
+    folly::Optional<TypedThriftReply<cpp2::McGetReply>> reply;
+  };
+
+  struct Pending {
+    /* Followers live on their fibers' stacks and stay parked until the
+       leader posts their batons, so raw pointers are safe here. */
+    std::vector<Follower*> followers;
+  };
+
+  const McrouterRouteHandlePtr child_;
+  folly::StringKeyedUnorderedMap<Pending> pending_;
+
+  static TypedThriftReply<cpp2::McGetReply> cloneReply(
+      const TypedThriftReply<cpp2::McGetReply>& reply) {
+    TypedThriftReply<cpp2::McGetReply> copy(reply.result());
+    if (const auto* value = reply.valuePtrUnsafe()) {
+      folly::IOBuf buf;
+      value->cloneInto(buf);
+      copy.setValue(std::move(buf));
+    }
+    if (reply.flags() != 0) {
+      copy.setFlags(reply.flags());
+    }
+    if (reply->__isset.message) {
+      copy->message = reply->message;
+      copy->__isset.message = true;
+    }
+    if (reply.appSpecificErrorCode() != 0) {
+      copy.setAppSpecificErrorCode(reply.appSpecificErrorCode());
+    }
+    return copy;
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
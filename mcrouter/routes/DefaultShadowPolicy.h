@@ -19,7 +19,9 @@ class DefaultShadowPolicy {
  public:
   template <class Request>
   static Request updateRequestForShadowing(const Request& req) {
-    return req.clone();
+    /* The shadow copy never mutates key or value, so share the
+       underlying buffers instead of paying for a full clone. */
+    return req.cloneShared();
   }
 
   template <class Request>
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
@@ -23,6 +24,7 @@
 #include "mcrouter/awriter.h"
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
+#include "mcrouter/DeleteRetryQueue.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
@@ -46,6 +48,10 @@ class DestinationRoute {
  public:
   std::string routeName() const;
 
+  static size_t maxDepth() {
+    return 1;
+  }
+
   std::string keyWithFailoverTag(folly::StringPiece fullKey) const;
 
   /**
@@ -71,12 +77,13 @@ class DestinationRoute {
       ctx->recordDestination(poolName_, indexInPool_,
                              *destination_->accessPoint());
     }
+    t.visitDestination(*destination_->accessPoint(), destination_->may_send());
   }
 
   template <class Request>
   ReplyT<Request> route(const Request& req, DeleteLikeT<Request> = 0) const {
     auto reply = routeWithDestination(req);
-    if (reply.isFailoverError() && spool(req)) {
+    if (reply.isFailoverError() && (addToRetryQueue(req) || spool(req))) {
       reply = ReplyT<Request>(DefaultReply, req);
       reply.setDestination(destination_->accessPoint());
     }
@@ -118,6 +125,14 @@ class DestinationRoute {
     }
 
     auto proxy = &ctx->proxy();
+    if (ctx->overCycleBudget()) {
+      /* The request already burned its CPU budget; abort the remaining
+         fanout children instead of letting them finish the core off. */
+      stat_incr(proxy->stats, request_cycle_budget_exceeded_stat, 1);
+      return constructAndLog(
+          req, *ctx, ErrorReply, std::string("cycle budget exceeded"));
+    }
+
     auto requestClass = fiber_local::getRequestClass();
     if (requestClass.is(RequestClass::kShadow)) {
       if (proxy->router().opts().target_max_shadow_requests > 0 &&
@@ -159,6 +174,21 @@ class DestinationRoute {
   ReplyT<Request> doRoute(const Request& req,
                           ProxyRequestContext& ctx) const {
     DestinationRequestCtx dctx(nowUs());
+    const int64_t deadlineUs = fiber_local::getRequestDeadlineUs();
+    int64_t remainingDeadlineUs = 0;
+    if (deadlineUs != 0) {
+      remainingDeadlineUs = deadlineUs - dctx.startTime;
+      if (remainingDeadlineUs <= 0) {
+        /* The deadline already passed while this request sat in queues
+           or earlier route handles; the client gave up, so don't burn a
+           network round trip on it. */
+        stat_incr(ctx.proxy().stats, destination_deadline_shed_stat, 1);
+        return constructAndLog(
+            req, ctx, mc_res_timeout,
+            std::string("DestinationRoute: deadline exceeded"));
+      }
+    }
+
     folly::Optional<Request> newReq;
     folly::StringPiece strippedRoutingPrefix;
     if (!keepRoutingPrefix_ && !req.routingPrefix().empty()) {
@@ -178,6 +208,17 @@ class DestinationRoute {
       }
     }
 
+    if (remainingDeadlineUs > 0) {
+      /* Stamp the remaining budget (relative ms, so clocks need not be
+         synchronized) onto the outgoing request; caret carries it to
+         downstream mcrouters and caret-speaking servers. */
+      if (!newReq) {
+        newReq.emplace(req.clone());
+      }
+      newReq->setDeadlineMs(
+          std::max<int64_t>(remainingDeadlineUs / 1000, 1));
+    }
+
     const auto& reqToSend = newReq ? *newReq : req;
     auto reply = destination_->send(reqToSend, dctx, timeout_);
     ctx.onReplyReceived(poolName_,
@@ -190,6 +231,32 @@ class DestinationRoute {
     return reply;
   }
 
+  /**
+   * Parks a failed delete in the in-memory retry stage
+   * (--asynclog-retry-count) instead of spilling it to the asynclog.
+   *
+   * @return false if the stage is disabled or full.
+   */
+  template <class Request>
+  bool addToRetryQueue(const Request& req) const {
+    auto asynclogName = fiber_local::getAsynclogName();
+    if (asynclogName.empty()) {
+      return false;
+    }
+
+    auto& proxy = fiber_local::getSharedCtx()->proxy();
+    if (!proxy.deleteRetryQueue) {
+      return false;
+    }
+
+    folly::StringPiece key = keepRoutingPrefix_ ?
+      req.fullKey() :
+      req.keyWithoutRoute();
+
+    return proxy.deleteRetryQueue->add(
+        destination_, key.str(), asynclogName.str(), timeout_);
+  }
+
   template <class Request>
   bool spool(const Request& req) const {
     auto asynclogName = fiber_local::getAsynclogName();
@@ -203,10 +270,23 @@ class DestinationRoute {
 
     auto proxy = &fiber_local::getSharedCtx()->proxy();
     auto& ap = *destination_->accessPoint();
+
+    auto lane = asynclog_lane(proxy, asynclogName);
+
+    /* Memory tier first: buffer the record in the lane's spool ring with
+       no cross-thread round trip; the lane's awriter drains it to disk. */
+    if (proxy->asynclogLanes[lane].ring &&
+        asynclog_ring_append(
+            proxy, lane,
+            asynclog_delete_record(proxy, ap, key, asynclogName))) {
+      stat_incr(proxy->stats, asynclog_requests_stat, 1);
+      return true;
+    }
+
     folly::fibers::Baton b;
-    auto res = proxy->router().asyncWriter().run(
-      [&b, &ap, proxy, key, asynclogName] () {
-        asynclog_delete(proxy, ap, key, asynclogName);
+    auto res = proxy->router().asynclogWriter(lane).run(
+      [&b, &ap, proxy, lane, key, asynclogName] () {
+        asynclog_delete(proxy, lane, ap, key, asynclogName);
         b.post();
       }
     );
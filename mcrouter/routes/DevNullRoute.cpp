@@ -17,7 +17,11 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 McrouterRouteHandlePtr makeDevNullRoute() {
-  return std::make_shared<McrouterRouteHandle<DevNullRoute>>();
+  /* DevNullRoute keeps no per-instance state (stats go through the fiber
+     context), so every config tree shares one instance. */
+  static McrouterRouteHandlePtr singleton =
+      std::make_shared<McrouterRouteHandle<DevNullRoute>>();
+  return singleton;
 }
 
 McrouterRouteHandlePtr makeDevNullRoute(
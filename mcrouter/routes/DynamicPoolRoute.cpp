@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "DynamicPoolRoute.h"
+
+#include <glog/logging.h>
+
+#include <folly/Format.h>
+
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/McrouterInstance.h"
+#include "mcrouter/McrouterLogFailure.h"
+#include "mcrouter/proxy.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+void DynamicPoolRoute::State::applyUpdate(std::string contents) {
+  try {
+    auto jServers = parseJsonString(contents);
+    ring = rebuildRing(jServers);
+    VLOG(1) << "Updated server list of pool " << poolName;
+  } catch (const std::exception& e) {
+    if (!ring) {
+      throw;
+    }
+    LOG_FAILURE("mcrouter", failure::Category::kInvalidConfig,
+                "Error updating server list of pool {}: {}. "
+                "Keeping the previous list.", poolName, e.what());
+  }
+}
+
+DynamicPoolRoute::DynamicPoolRoute(
+    proxy_t& proxy,
+    std::string poolName,
+    const std::string& serversFilePath,
+    std::function<McrouterRouteHandlePtr(const folly::dynamic&)> rebuildRing)
+  : state_(std::make_shared<State>(std::move(poolName),
+                                   std::move(rebuildRing))) {
+
+  const auto& opts = proxy.router().opts();
+  std::weak_ptr<State> weakState = state_;
+  // The first onUpdate call is synchronous, so the initial ring is in
+  // place before the config goes live; subsequent calls run on the proxy
+  // event base, where requests are routed.
+  observerHandle_ = startObservingFileCancellable(
+    serversFilePath,
+    proxy.eventBase(),
+    opts.file_observer_poll_period_ms,
+    opts.file_observer_sleep_before_update_ms,
+    [weakState](std::string contents) {
+      if (auto state = weakState.lock()) {
+        state->applyUpdate(std::move(contents));
+      }
+    });
+  checkRuntime(state_->ring != nullptr,
+               "Can not initialize server list of pool {} from '{}'",
+               state_->poolName, serversFilePath);
+}
+
+std::string DynamicPoolRoute::routeName() const {
+  return folly::sformat("dynamic-pool|{}", state_->poolName);
+}
+
+McrouterRouteHandlePtr makeDynamicPoolRoute(
+  proxy_t& proxy,
+  std::string poolName,
+  const std::string& serversFilePath,
+  std::function<McrouterRouteHandlePtr(const folly::dynamic&)> rebuildRing) {
+
+  return std::make_shared<McrouterRouteHandle<DynamicPoolRoute>>(
+    proxy,
+    std::move(poolName),
+    serversFilePath,
+    std::move(rebuildRing));
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/FileObserver.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+struct proxy_t;
+
+/**
+ * Routes to a pool whose server list is bound to a watched file instead
+ * of the static "servers" array. When the file changes, a new hash ring
+ * (reusing ProxyDestinations of servers that stayed in the pool) is
+ * built on the proxy thread and swapped in place of the old one, without
+ * a full reconfiguration. Requests started before a swap finish on the
+ * ring they started with.
+ *
+ * The watched file must contain a JSON array of server strings, in the
+ * same format as the "servers" pool property. Keeping the order of
+ * retained servers stable across updates keeps key movement minimal
+ * under the consistent hash.
+ */
+class DynamicPoolRoute {
+ public:
+  std::string routeName() const;
+
+  /**
+   * @param proxy            proxy that routes requests through this handle
+   * @param poolName         name of the pool, for logging
+   * @param serversFilePath  file with a JSON array of server strings
+   * @param rebuildRing      builds a hash ring over the given server list;
+   *                         invoked on the proxy thread
+   * @throw std::runtime_error if the initial server list can not be read
+   *        or the initial ring can not be built
+   */
+  DynamicPoolRoute(
+    proxy_t& proxy,
+    std::string poolName,
+    const std::string& serversFilePath,
+    std::function<McrouterRouteHandlePtr(const folly::dynamic&)> rebuildRing);
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    state_->ring->traverse(req, t);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) const {
+    // hold the current ring: the fiber may suspend while a swap happens
+    auto ring = state_->ring;
+    return ring->route(req);
+  }
+
+ private:
+  /**
+   * Shared with the file observer callback, which holds only a weak
+   * reference, so a config that was dropped does not keep rebuilding
+   * rings.
+   */
+  struct State {
+    State(std::string poolName__,
+          std::function<McrouterRouteHandlePtr(const folly::dynamic&)>
+            rebuildRing__)
+        : poolName(std::move(poolName__)),
+          rebuildRing(std::move(rebuildRing__)) {}
+
+    /**
+     * Parses the new server list and swaps in a new ring. On error keeps
+     * the current ring; throws only if there is no ring yet (i.e. on the
+     * initial, config-time call).
+     */
+    void applyUpdate(std::string contents);
+
+    const std::string poolName;
+    const std::function<McrouterRouteHandlePtr(const folly::dynamic&)>
+      rebuildRing;
+    McrouterRouteHandlePtr ring;
+  };
+
+  const std::shared_ptr<State> state_;
+  /// Cancels the server list observation together with this route
+  FileObserverHandle observerHandle_;
+};
+
+}}} // facebook::memcache::mcrouter
@@ -17,6 +17,14 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 McrouterRouteHandlePtr makeErrorRoute(std::string valueToSet) {
+  if (valueToSet.empty()) {
+    /* The common no-message ErrorRoute is stateless; share one instance
+       across all config trees. Routes with a custom response keep their
+       own instance since the message is per-route state. */
+    static McrouterRouteHandlePtr singleton =
+        makeMcrouterRouteHandle<ErrorRoute>(std::string());
+    return singleton;
+  }
   return makeMcrouterRouteHandle<ErrorRoute>(std::move(valueToSet));
 }
 
@@ -16,8 +16,10 @@
 
 #include <folly/dynamic.h>
 
+#include "mcrouter/ExponentialSmoothData.h"
 #include "mcrouter/lib/fbi/cpp/ParsingUtil.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/mcrouter_config.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -186,4 +188,131 @@ class FailoverLeastFailuresPolicy {
   std::vector<size_t> recentErrorCount_;
 };
 
+/**
+ * Ranks failover targets by observed latency and error rate instead of
+ * config order. Every failover attempt is timed and fed into a per-child
+ * exponentially smoothed latency average; errors inflate a child's score,
+ * so after the primary fails we try the historically fastest healthy
+ * replica first. Children without samples yet score the lowest and thus
+ * keep their config-order position at the front, so new replicas get
+ * probed quickly.
+ */
+template <typename RouteHandleIf>
+class FailoverFastestPolicy {
+ public:
+  using RouteHandlePtr = std::shared_ptr<RouteHandleIf>;
+
+  FailoverFastestPolicy(
+      const std::vector<std::shared_ptr<RouteHandleIf>>& children,
+      const folly::dynamic& policyConfig) :
+    children_(children),
+    stats_(children_.size()) {
+
+    if (auto jErrorPenalty = policyConfig.get_ptr("error_penalty_factor")) {
+      errorPenaltyFactor_ = static_cast<double>(
+          parseInt(*jErrorPenalty, "error_penalty_factor", 0, 1000000));
+    }
+  }
+
+  class ChildProxy {
+   public:
+    ChildProxy(FailoverFastestPolicy<RouteHandleIf>& failoverPolicy,
+               size_t index)
+      : failoverPolicy_(failoverPolicy), index_(index) {}
+
+    template <class Request>
+    ReplyT<Request> route(const Request& req) {
+      const auto startTimeUs = nowUs();
+      auto reply = failoverPolicy_.children_[index_]->route(req);
+      auto& stats = failoverPolicy_.stats_[index_];
+      stats.avgLatencyUs.insertSample(nowUs() - startTimeUs);
+      stats.errorRate.insertSample(reply.isError() ? 1.0 : 0.0);
+
+      return reply;
+    }
+
+   private:
+    FailoverFastestPolicy<RouteHandleIf>& failoverPolicy_;
+    size_t index_;
+  };
+
+  class Iterator : public boost::iterator_facade<
+                            Iterator,
+                            ChildProxy,
+                            std::forward_iterator_tag,
+                            ChildProxy> {
+   public:
+    Iterator(FailoverFastestPolicy<RouteHandleIf>& failoverPolicy,
+             std::vector<size_t> order,
+             size_t id)
+      : policy_(failoverPolicy), order_(std::move(order)), id_(id) {}
+
+    size_t getTrueIndex() const {
+      return order_[id_];
+    }
+
+   private:
+    void increment() {
+      ++id_;
+    }
+
+    bool equal(const Iterator& other) const {
+      return id_ == other.id_;
+    }
+
+    ChildProxy dereference() const {
+      return ChildProxy(policy_, order_[id_]);
+    }
+
+    friend class boost::iterator_core_access;
+
+    FailoverFastestPolicy<RouteHandleIf>& policy_;
+    const std::vector<size_t> order_;
+    size_t id_;
+  };
+
+
+  Iterator begin() {
+    return Iterator(*this, getFastestRouteIndices(), 0);
+  }
+
+  Iterator end() {
+    return Iterator(*this, {}, children_.size() - 1);
+  }
+
+ private:
+  struct ChildStats {
+    ExponentialSmoothData<16> avgLatencyUs;
+    ExponentialSmoothData<16> errorRate;
+  };
+
+  std::vector<size_t> getFastestRouteIndices() const {
+    std::vector<size_t> indices;
+    // Start at i = 1 since we don't consider first child
+    for (size_t i = 1; i < stats_.size(); ++i) {
+      indices.push_back(i);
+    }
+    std::stable_sort(indices.begin(), indices.end(),
+        [this](size_t a, size_t b) {
+          return score(a) < score(b);
+        }
+    );
+
+    return indices;
+  }
+
+  double score(size_t index) const {
+    const auto& stats = stats_[index];
+    // The +1 makes the error rate meaningful even when replies come back
+    // in under a microsecond and the latency average rounds down to zero.
+    return (stats.avgLatencyUs.value() + 1.0) *
+           (1.0 + errorPenaltyFactor_ * stats.errorRate.value());
+  }
+
+  const std::vector<RouteHandlePtr>& children_;
+  double errorPenaltyFactor_{10.0};
+
+  std::vector<ChildStats> stats_;
+};
+
 }}} // facebook::memcache::mcrouter
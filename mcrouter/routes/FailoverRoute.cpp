@@ -35,7 +35,8 @@ makeFailoverRouteInOrder(std::vector<McrouterRouteHandlePtr> rh,
                          std::unique_ptr<FailoverRateLimiter> rateLimiter,
                          bool failoverTagging,
                          bool enableLeasePairing,
-                         std::string name) {
+                         std::string name,
+                         std::chrono::milliseconds latchFailedNormal) {
   if (rh.size() <= 1) {
     return makeNullOrSingletonRoute(std::move(rh));
   }
@@ -47,7 +48,21 @@ makeFailoverRouteInOrder(std::vector<McrouterRouteHandlePtr> rh,
       std::move(rateLimiter),
       failoverTagging,
       enableLeasePairing,
-      std::move(name));
+      std::move(name),
+      latchFailedNormal);
+}
+
+McrouterRouteHandlePtr
+makeFailoverRouteInOrder(std::vector<McrouterRouteHandlePtr> rh,
+                         FailoverErrorsSettings failoverErrors,
+                         std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                         bool failoverTagging,
+                         bool enableLeasePairing,
+                         std::string name) {
+  return makeFailoverRouteInOrder(
+      std::move(rh), std::move(failoverErrors), std::move(rateLimiter),
+      failoverTagging, enableLeasePairing, std::move(name),
+      std::chrono::milliseconds::zero());
 }
 
 McrouterRouteHandlePtr
@@ -57,7 +72,8 @@ makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
                                bool failoverTagging,
                                bool enableLeasePairing,
                                std::string name,
-                               const folly::dynamic& json) {
+                               const folly::dynamic& json,
+                               std::chrono::milliseconds latchFailedNormal) {
   if (rh.size() <= 1) {
     return makeNullOrSingletonRoute(std::move(rh));
   }
@@ -70,9 +86,63 @@ makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
       failoverTagging,
       enableLeasePairing,
       std::move(name),
+      latchFailedNormal,
       json);
 }
 
+McrouterRouteHandlePtr
+makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
+                               FailoverErrorsSettings failoverErrors,
+                               std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                               bool failoverTagging,
+                               bool enableLeasePairing,
+                               std::string name,
+                               const folly::dynamic& json) {
+  return makeFailoverRouteLeastFailures(
+      std::move(rh), std::move(failoverErrors), std::move(rateLimiter),
+      failoverTagging, enableLeasePairing, std::move(name), json,
+      std::chrono::milliseconds::zero());
+}
+
+McrouterRouteHandlePtr
+makeFailoverRouteFastest(std::vector<McrouterRouteHandlePtr> rh,
+                         FailoverErrorsSettings failoverErrors,
+                         std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                         bool failoverTagging,
+                         bool enableLeasePairing,
+                         std::string name,
+                         const folly::dynamic& json,
+                         std::chrono::milliseconds latchFailedNormal) {
+  if (rh.size() <= 1) {
+    return makeNullOrSingletonRoute(std::move(rh));
+  }
+
+  using FailoverPolicyT = FailoverFastestPolicy<McrouterRouteHandleIf>;
+  return makeMcrouterRouteHandle<FailoverRoute, FailoverPolicyT>(
+      std::move(rh),
+      std::move(failoverErrors),
+      std::move(rateLimiter),
+      failoverTagging,
+      enableLeasePairing,
+      std::move(name),
+      latchFailedNormal,
+      json);
+}
+
+McrouterRouteHandlePtr
+makeFailoverRouteFastest(std::vector<McrouterRouteHandlePtr> rh,
+                         FailoverErrorsSettings failoverErrors,
+                         std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                         bool failoverTagging,
+                         bool enableLeasePairing,
+                         std::string name,
+                         const folly::dynamic& json) {
+  return makeFailoverRouteFastest(
+      std::move(rh), std::move(failoverErrors), std::move(rateLimiter),
+      failoverTagging, enableLeasePairing, std::move(name), json,
+      std::chrono::milliseconds::zero());
+}
+
 McrouterRouteHandlePtr makeFailoverRoute(
     const folly::dynamic& json,
     std::vector<McrouterRouteHandlePtr> children) {
@@ -82,6 +152,7 @@ McrouterRouteHandlePtr makeFailoverRoute(
   bool failoverTagging = false;
   bool enableLeasePairing = false;
   std::string name;
+  std::chrono::milliseconds latchFailedNormal{0};
   if (json.isObject()) {
     if (auto jLeasePairing = json.get_ptr("enable_lease_pairing")) {
       checkLogic(jLeasePairing->isBool(),
@@ -106,25 +177,39 @@ McrouterRouteHandlePtr makeFailoverRoute(
     if (auto jFailoverLimit = json.get_ptr("failover_limit")) {
       rateLimiter = folly::make_unique<FailoverRateLimiter>(*jFailoverLimit);
     }
+    if (auto jLatch = json.get_ptr("latch_failed_normal_ms")) {
+      checkLogic(jLatch->isInt(),
+                 "Failover: latch_failed_normal_ms is not an integer");
+      checkLogic(jLatch->getInt() >= 0,
+                 "Failover: latch_failed_normal_ms is negative");
+      latchFailedNormal = std::chrono::milliseconds(jLatch->getInt());
+    }
     if (auto jFailoverPolicy = json.get_ptr("failover_policy")) {
       checkLogic(jFailoverPolicy->isObject(),
                  "Failover: failover_policy is not object");
       auto jPolicyType = jFailoverPolicy->get_ptr("type");
       checkLogic(jPolicyType != nullptr,
                  "Failover: failover_policy object is missing 'type' field");
-      if (parseString(*jPolicyType, "type") == "LeastFailuresPolicy") {
+      auto policyType = parseString(*jPolicyType, "type");
+      if (policyType == "LeastFailuresPolicy") {
         return makeFailoverRouteLeastFailures(
             std::move(children), std::move(failoverErrors),
             std::move(rateLimiter), failoverTagging,
             enableLeasePairing, std::move(name),
-            *jFailoverPolicy);
+            *jFailoverPolicy, latchFailedNormal);
+      } else if (policyType == "FastestPolicy") {
+        return makeFailoverRouteFastest(
+            std::move(children), std::move(failoverErrors),
+            std::move(rateLimiter), failoverTagging,
+            enableLeasePairing, std::move(name),
+            *jFailoverPolicy, latchFailedNormal);
       }
     }
   }
   return makeFailoverRouteInOrder(
       std::move(children), std::move(failoverErrors),
       std::move(rateLimiter), failoverTagging,
-      enableLeasePairing, std::move(name));
+      enableLeasePairing, std::move(name), latchFailedNormal);
 }
 
 McrouterRouteHandlePtr makeFailoverRoute(
@@ -9,10 +9,16 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <folly/fibers/Baton.h>
+#include <folly/fibers/FiberManager.h>
+#include <folly/Optional.h>
+
 #include "mcrouter/config.h"
 #include "mcrouter/LeaseTokenMap.h"
 #include "mcrouter/lib/FailoverContext.h"
@@ -20,6 +26,8 @@
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/Reply.h"
 #include "mcrouter/lib/RouteHandleTraverser.h"
 #include "mcrouter/McrouterFiberContext.h"
 #include "mcrouter/McrouterInstance.h"
@@ -59,6 +67,8 @@ class FailoverRoute {
                 bool failoverTagging,
                 bool enableLeasePairing,
                 std::string name,
+                std::chrono::milliseconds latchFailedNormal =
+                    std::chrono::milliseconds::zero(),
                 const folly::dynamic& policyConfig = nullptr)
       : targets_(std::move(targets)),
         failoverErrors_(std::move(failoverErrors)),
@@ -66,7 +76,9 @@ class FailoverRoute {
         failoverTagging_(failoverTagging),
         failoverPolicy_(targets_, policyConfig),
         enableLeasePairing_(enableLeasePairing),
-        name_(std::move(name)) {
+        name_(std::move(name)),
+        latchFailedNormalUs_(
+            1000 * static_cast<int64_t>(latchFailedNormal.count())) {
     assert(targets_.size() > 1);
     assert(!enableLeasePairing_ || !name_.empty());
   }
@@ -103,8 +115,11 @@ class FailoverRoute {
     size_t childIndex = 0;
     auto reply = doRoute(req, childIndex);
 
+    // Read through a const ref: mutable raw access would needlessly drop
+    // the reply's carried wire body.
+    const auto& constReply = reply;
     const uint64_t leaseToken =
-      reply->get_leaseToken() ? *reply->get_leaseToken() : 0;
+      constReply->get_leaseToken() ? *constReply->get_leaseToken() : 0;
 
     if (!enableLeasePairing_ || leaseToken <= 1) {
       return reply;
@@ -132,6 +147,9 @@ class FailoverRoute {
   FailoverPolicyT failoverPolicy_;
   const bool enableLeasePairing_{false};
   const std::string name_;
+  /* latch_failed_normal_ms: 0 disables latching */
+  const int64_t latchFailedNormalUs_{0};
+  int64_t latchedUntilUs_{0};
 
   template <class Request>
   inline ReplyT<Request> doRoute(const Request& req) {
@@ -141,11 +159,94 @@ class FailoverRoute {
 
   template <class Request>
   ReplyT<Request> doRoute(const Request& req, size_t& childIndex) {
-    auto normalReply = targets_[0]->route(req);
     childIndex = 0;
     if (rateLimiter_) {
       rateLimiter_->bumpTotalReqs();
     }
+    if (!fiber_local::getSharedCtx()->failoverDisabled()) {
+      auto& proxy = fiber_local::getSharedCtx()->proxy();
+      if (latchFailedNormalUs_ > 0 && normalLatched(req)) {
+        /* The normal target failed a moment ago; skip it for the
+           cooldown instead of probing it on every request. */
+        stat_incr(proxy.stats, failover_normal_latched_stat, 1);
+        return routeAfterNormalReply(
+            req, ReplyT<Request>(TkoReply), childIndex);
+      }
+      if (proxy.router().opts().failover_tko_precheck &&
+          allNormalDestinationsTko(req)) {
+        /* Every destination the normal target can reach is already
+           marked TKO; go straight to the failover walk instead of
+           rediscovering that per request. The stand-in reply matches
+           what DestinationRoute would have returned. */
+        stat_incr(proxy.stats, failover_tko_precheck_skipped_stat, 1);
+        return routeAfterNormalReply(
+            req, ReplyT<Request>(TkoReply), childIndex);
+      }
+      if (GetLike<Request>::value &&
+          proxy.router().opts().hedging_delay_ms > 0) {
+        return hedgedRoute(req, childIndex);
+      }
+    }
+    auto normalReply = targets_[0]->route(req);
+    if (latchFailedNormalUs_ > 0 &&
+        !fiber_local::getSharedCtx()->failoverDisabled() &&
+        failoverErrors_.shouldFailover(normalReply, req)) {
+      latchedUntilUs_ = nowUs() + latchFailedNormalUs_;
+    }
+    return routeAfterNormalReply(req, std::move(normalReply), childIndex);
+  }
+
+  /**
+   * True if the normal target is latched out after a recent failure
+   * (latch_failed_normal_ms). The latch holds for the cooldown, and then,
+   * informed by TkoTracker, keeps holding while every destination of the
+   * normal target is still marked down, so the first re-probe happens
+   * once the host has a chance of being back rather than on a timer.
+   */
+  template <class Request>
+  bool normalLatched(const Request& req) {
+    if (latchedUntilUs_ == 0) {
+      return false;
+    }
+    if (nowUs() < latchedUntilUs_) {
+      return true;
+    }
+    if (allNormalDestinationsTko(req)) {
+      return true;
+    }
+    latchedUntilUs_ = 0;
+    return false;
+  }
+
+  /**
+   * Cheap TKO pre-check (--failover-tko-precheck): true if the normal
+   * target's subtree reaches at least one destination and every one of
+   * them is marked TKO. Only reads TkoTracker atomics, no network.
+   */
+  template <class Request>
+  bool allNormalDestinationsTko(const Request& req) const {
+    size_t seen = 0;
+    bool anyAlive = false;
+    RouteHandleTraverser<RouteHandleIf> t(
+        nullptr /* start */,
+        nullptr /* end */,
+        [&seen, &anyAlive](const AccessPoint&, bool alive) {
+          ++seen;
+          anyAlive = anyAlive || alive;
+        });
+    t(*targets_[0], req);
+    return seen > 0 && !anyAlive;
+  }
+
+  /**
+   * The tail of the non-hedged path: given the normal destination's reply,
+   * either return it or walk the failover targets sequentially.
+   */
+  template <class Request>
+  ReplyT<Request> routeAfterNormalReply(const Request& req,
+                                        ReplyT<Request> normalReply,
+                                        size_t& childIndex) {
+    childIndex = 0;
     if (fiber_local::getSharedCtx()->failoverDisabled() ||
         !failoverErrors_.shouldFailover(normalReply, req)) {
       return normalReply;
@@ -198,6 +299,132 @@ class FailoverRoute {
       return failoverReply;
     });
   }
+
+  /**
+   * Hedged path for get-like requests: route to the normal destination on
+   * a separate fiber and, if it hasn't replied within the hedging delay,
+   * fire the same request at the first failover target. The first
+   * acceptable reply wins; the loser is discarded when it arrives
+   * (in-flight network requests can't be cancelled).
+   */
+  template <class Request>
+  ReplyT<Request> hedgedRoute(const Request& req, size_t& childIndex) {
+    using Reply = ReplyT<Request>;
+
+    struct HedgeState {
+      folly::Optional<Reply> normalReply;
+      folly::Optional<Reply> hedgeReply;
+      folly::fibers::Baton normalDone;
+      folly::fibers::Baton hedgeDone;
+      folly::fibers::Baton firstDone;
+      // All fibers run on one thread, so a plain flag is enough.
+      bool anyDone{false};
+
+      void post(folly::fibers::Baton& own) {
+        own.post();
+        if (!anyDone) {
+          anyDone = true;
+          firstDone.post();
+        }
+      }
+    };
+
+    auto state = std::make_shared<HedgeState>();
+    auto reqCopy = std::make_shared<Request>(req.clone());
+    auto normalTarget = targets_[0];
+    folly::fibers::addTask([state, reqCopy, normalTarget]() {
+      state->normalReply.emplace(normalTarget->route(*reqCopy));
+      state->post(state->normalDone);
+    });
+
+    auto& proxy = fiber_local::getSharedCtx()->proxy();
+    if (state->normalDone.timed_wait(
+            std::chrono::milliseconds(hedgingDelayMs(proxy)))) {
+      return routeAfterNormalReply(
+          req, std::move(*state->normalReply), childIndex);
+    }
+
+    if (rateLimiter_ && !rateLimiter_->failoverAllowed()) {
+      stat_incr(proxy.stats, failover_rate_limited_stat, 1);
+      state->normalDone.wait();
+      return routeAfterNormalReply(
+          req, std::move(*state->normalReply), childIndex);
+    }
+
+    stat_incr(proxy.stats, hedged_requests_stat, 1);
+    auto hedgeTarget = targets_[1];
+    bool failoverTag = failoverTagging_ && req.hasHashStop();
+    folly::fibers::addTask([state, reqCopy, hedgeTarget, failoverTag]() {
+      fiber_local::setFailoverTag(failoverTag);
+      fiber_local::addRequestClass(RequestClass::kFailover);
+      state->hedgeReply.emplace(hedgeTarget->route(*reqCopy));
+      state->post(state->hedgeDone);
+    });
+
+    state->firstDone.wait();
+
+    auto acceptable = [this, &req](const Reply& reply) {
+      return !failoverErrors_.shouldFailover(reply, req);
+    };
+
+    /* Take the first acceptable reply; wait for the slower child only if
+       the faster one returned a failover-worthy error. */
+    if (state->normalReply.hasValue() && acceptable(*state->normalReply)) {
+      childIndex = 0;
+      return std::move(*state->normalReply);
+    }
+    if (state->hedgeReply.hasValue() && acceptable(*state->hedgeReply)) {
+      childIndex = 1;
+      stat_incr(proxy.stats, hedged_requests_won_stat, 1);
+      return std::move(*state->hedgeReply);
+    }
+
+    state->normalDone.wait();
+    state->hedgeDone.wait();
+    if (acceptable(*state->normalReply)) {
+      childIndex = 0;
+      return std::move(*state->normalReply);
+    }
+    if (acceptable(*state->hedgeReply)) {
+      childIndex = 1;
+      stat_incr(proxy.stats, hedged_requests_won_stat, 1);
+      return std::move(*state->hedgeReply);
+    }
+
+    /* Both attempts failed; walk any remaining failover targets in order,
+       like the non-hedged path would. */
+    return fiber_local::runWithLocals(
+        [this, &req, &proxy, &state, &childIndex]() -> Reply {
+      fiber_local::setFailoverTag(failoverTagging_ && req.hasHashStop());
+      fiber_local::addRequestClass(RequestClass::kFailover);
+      for (size_t i = 2; i < targets_.size(); ++i) {
+        auto failoverReply = targets_[i]->route(req);
+        if (!failoverErrors_.shouldFailover(failoverReply, req)) {
+          childIndex = i;
+          return failoverReply;
+        }
+      }
+      stat_incr(proxy.stats, failover_all_failed_stat, 1);
+      childIndex = 1;
+      return std::move(*state->hedgeReply);
+    });
+  }
+
+  /**
+   * How long to wait for the normal destination before hedging: the
+   * configured floor, or a multiple of the smoothed average request
+   * latency, whichever is larger.
+   */
+  size_t hedgingDelayMs(proxy_t& proxy) const {
+    const auto& opts = proxy.router().opts();
+    size_t delay = opts.hedging_delay_ms;
+    if (opts.hedging_latency_factor > 0) {
+      auto avgMs = static_cast<size_t>(
+          proxy.durationUs.value() * opts.hedging_latency_factor / 1000.0);
+      delay = std::max(delay, avgMs);
+    }
+    return std::max<size_t>(delay, 1);
+  }
 };
 
 }}} // facebook::memcache::mcrouter
@@ -12,6 +12,7 @@
 #include "mcrouter/lib/Ch3HashFunc.h"
 #include "mcrouter/lib/config/RouteHandleFactory.h"
 #include "mcrouter/lib/Crc32HashFunc.h"
+#include "mcrouter/lib/JumpHashFunc.h"
 #include "mcrouter/lib/routes/HashRoute.h"
 #include "mcrouter/lib/WeightedCh3HashFunc.h"
 #include "mcrouter/routes/McRouteHandleBuilder.h"
@@ -82,6 +83,24 @@ McrouterRouteHandlePtr makeHashRouteConstShard(
     ConstShardHashFunc(n));
 }
 
+McrouterRouteHandlePtr makeHashRouteJump(
+  std::vector<McrouterRouteHandlePtr> rh,
+  std::string salt) {
+
+  auto n = rh.size();
+  if (n == 0) {
+    return makeNullRoute();
+  }
+  if (n == 1) {
+    return std::move(rh[0]);
+  }
+
+  return makeMcrouterRouteHandle<HashRoute, JumpHashFunc>(
+    std::move(rh),
+    std::move(salt),
+    JumpHashFunc(n));
+}
+
 McrouterRouteHandlePtr makeHashRouteWeightedCh3(
   std::vector<McrouterRouteHandlePtr> rh,
   std::string salt,
@@ -101,8 +120,36 @@ McrouterRouteHandlePtr makeHashRouteWeightedCh3(
     std::move(func));
 }
 
+McrouterRouteHandlePtr makeHashRouteWeightedJump(
+  std::vector<McrouterRouteHandlePtr> rh,
+  std::string salt,
+  WeightedJumpHashFunc func) {
+
+  auto n = rh.size();
+  if (n == 0) {
+    return makeNullRoute();
+  }
+  if (n == 1) {
+    return std::move(rh[0]);
+  }
+
+  return makeMcrouterRouteHandle<HashRoute, WeightedJumpHashFunc>(
+    std::move(rh),
+    std::move(salt),
+    std::move(func));
+}
+
 }  // anonymous
 
+McrouterRouteHandlePtr makeWeightedCh3HashRoute(
+  std::vector<McrouterRouteHandlePtr> rh,
+  std::string salt,
+  WeightedCh3HashFunc func) {
+
+  return makeHashRouteWeightedCh3(std::move(rh), std::move(salt),
+                                  std::move(func));
+}
+
 McrouterRouteHandlePtr makeHashRoute(
   const folly::dynamic& json,
   std::vector<McrouterRouteHandlePtr> rh,
@@ -130,6 +177,12 @@ McrouterRouteHandlePtr makeHashRoute(
     WeightedCh3HashFunc func{json, rh.size()};
     return makeHashRouteWeightedCh3(std::move(rh), std::move(salt),
                                     std::move(func));
+  } else if (funcType == JumpHashFunc::type()) {
+    return makeHashRouteJump(std::move(rh), std::move(salt));
+  } else if (funcType == WeightedJumpHashFunc::type()) {
+    WeightedJumpHashFunc func{json, rh.size()};
+    return makeHashRouteWeightedJump(std::move(rh), std::move(salt),
+                                     std::move(func));
   } else if (funcType == ConstShardHashFunc::type()) {
     return makeHashRouteConstShard(std::move(rh), std::move(salt));
   } else if (funcType == "Latest") {
@@ -0,0 +1,37 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "HotKeyCacheRoute.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+constexpr uint32_t HotKeyCacheRoute::kHotThreshold;
+constexpr size_t HotKeyCacheRoute::kMaxValueSize;
+constexpr const char* HotKeyCacheRoute::kSnapshotMagic;
+
+McrouterRouteHandlePtr makeHotKeyCacheRoute(
+    McrouterRouteHandlePtr rh,
+    size_t maxEntries,
+    std::chrono::milliseconds ttl,
+    std::string snapshotPath,
+    std::chrono::milliseconds snapshotInterval) {
+  return std::make_shared<McrouterRouteHandle<HotKeyCacheRoute>>(
+    std::move(rh), maxEntries, ttl, std::move(snapshotPath),
+    snapshotInterval);
+}
+
+McrouterRouteHandlePtr makeHotKeyCacheRoute(McrouterRouteHandlePtr rh,
+                                            size_t maxEntries,
+                                            std::chrono::milliseconds ttl) {
+  return makeHotKeyCacheRoute(std::move(rh), maxEntries, ttl,
+                              /* snapshotPath= */ std::string(),
+                              std::chrono::milliseconds::zero());
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,318 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/FileUtil.h>
+#include <folly/io/IOBuf.h>
+#include <folly/Range.h>
+#include <folly/SpookyHashV2.h>
+#include <folly/String.h>
+
+#include "mcrouter/awriter.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/Operation.h"
+#include "mcrouter/lib/OperationTraits.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/McrouterFiberContext.h"
+#include "mcrouter/McrouterInstance.h"
+#include "mcrouter/proxy.h"
+#include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Serves plain gets for the hottest keys straight from the proxy's own
+ * memory, skipping the network entirely. A count-min sketch of recent get
+ * traffic decides which keys are hot enough to cache; values are kept in a
+ * small LRU with a hard per-value size cap, so the footprint is a few MB
+ * at most.
+ *
+ * Coherence follows L1L2CacheRoute semantics: lease gets, gets and metagets
+ * bypass the cache, and sets/deletes/arithmetic ops invalidate the local
+ * entry on their way through. Entries also carry a short TTL to bound
+ * staleness from writes routed through other mcrouter instances.
+ */
+class HotKeyCacheRoute {
+ public:
+  static std::string routeName() { return "hot-key-cache"; }
+
+  HotKeyCacheRoute(McrouterRouteHandlePtr rh,
+                   size_t maxEntries,
+                   std::chrono::milliseconds ttl,
+                   std::string snapshotPath,
+                   std::chrono::milliseconds snapshotInterval)
+    : child_(std::move(rh)),
+      maxEntries_(maxEntries),
+      ttlUs_(std::chrono::duration_cast<std::chrono::microseconds>(ttl)),
+      snapshotPath_(std::move(snapshotPath)),
+      snapshotIntervalUs_(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              snapshotInterval)) {
+
+    assert(child_ != nullptr);
+    assert(maxEntries_ > 0);
+    if (!snapshotPath_.empty()) {
+      loadSnapshot();
+    }
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*child_, req);
+  }
+
+  TypedThriftReply<cpp2::McGetReply> route(
+      const TypedThriftRequest<cpp2::McGetRequest>& req) {
+    auto key = req.fullKey();
+    const auto now = nowUs();
+    auto& proxy = fiber_local::getSharedCtx()->proxy();
+    maybeSnapshot(proxy, now);
+
+    if (auto* entry = cacheLookup(key, now)) {
+      stat_incr(proxy.stats, hot_key_cache_hits_stat, 1);
+      TypedThriftReply<cpp2::McGetReply> reply(mc_res_found);
+      folly::IOBuf value;
+      entry->value.cloneInto(value);
+      reply.setValue(std::move(value));
+      reply.setFlags(entry->flags);
+      return reply;
+    }
+
+    auto reply = child_->route(req);
+    if (reply.isHit() && sketch_.bump(key) >= kHotThreshold &&
+        reply.valuePtrUnsafe() != nullptr &&
+        reply.valuePtrUnsafe()->computeChainDataLength() <= kMaxValueSize) {
+      cacheStore(key, reply, now);
+      stat_incr(proxy.stats, hot_key_cache_stores_stat, 1);
+    }
+    return reply;
+  }
+
+  template <class Request>
+  typename std::enable_if<UpdateLike<Request>::value ||
+                          DeleteLike<Request>::value ||
+                          ArithmeticLike<Request>::value,
+                          ReplyT<Request>>::type
+  route(const Request& req) {
+    invalidate(req.fullKey());
+    return child_->route(req);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(
+      const Request& req,
+      OtherThanT<Request, UpdateLike<>, DeleteLike<>, ArithmeticLike<>> = 0) {
+    return child_->route(req);
+  }
+
+ private:
+  /* Top-20 hot keys easily fit, while a one-off burst doesn't qualify. */
+  static constexpr uint32_t kHotThreshold = 16;
+  static constexpr size_t kMaxValueSize = 4096;
+
+  /**
+   * Fixed-size count-min sketch of recent get traffic. All counters are
+   * halved periodically so that estimates track current hotness instead of
+   * all-time popularity.
+   */
+  class CountMinSketch {
+   public:
+    uint32_t bump(folly::StringPiece key) {
+      maybeDecay();
+      uint64_t h1 = 0;
+      uint64_t h2 = 0;
+      folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+      h2 |= 1;
+      uint32_t estimate = std::numeric_limits<uint32_t>::max();
+      for (size_t row = 0; row < kRows; ++row) {
+        auto& counter = counters_[row][(h1 + row * h2) % kWidth];
+        ++counter;
+        estimate = std::min(estimate, counter);
+      }
+      return estimate;
+    }
+
+    /**
+     * Pre-charges the counters for a key, e.g. when restoring a
+     * snapshot. Doesn't count towards the decay period.
+     */
+    void seed(folly::StringPiece key, uint32_t count) {
+      uint64_t h1 = 0;
+      uint64_t h2 = 0;
+      folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+      h2 |= 1;
+      for (size_t row = 0; row < kRows; ++row) {
+        counters_[row][(h1 + row * h2) % kWidth] += count;
+      }
+    }
+
+   private:
+    static constexpr size_t kRows = 4;
+    static constexpr size_t kWidth = 2048;
+    static constexpr size_t kDecayPeriod = 1 << 17;
+
+    void maybeDecay() {
+      if (++opsSinceDecay_ < kDecayPeriod) {
+        return;
+      }
+      opsSinceDecay_ = 0;
+      for (auto& row : counters_) {
+        for (auto& counter : row) {
+          counter >>= 1;
+        }
+      }
+    }
+
+    std::array<std::array<uint32_t, kWidth>, kRows> counters_{};
+    size_t opsSinceDecay_{0};
+  };
+
+  struct CacheEntry {
+    folly::IOBuf value;
+    uint64_t flags{0};
+    int64_t expiryUs{0};
+    std::list<std::string>::iterator lruIt;
+  };
+
+  /* First line of a snapshot file; bump when the format changes. */
+  static constexpr const char* kSnapshotMagic = "hot-key-cache/1";
+
+  const McrouterRouteHandlePtr child_;
+  const size_t maxEntries_;
+  const std::chrono::microseconds ttlUs_;
+  const std::string snapshotPath_;
+  const std::chrono::microseconds snapshotIntervalUs_;
+  int64_t lastSnapshotUs_{0};
+  CountMinSketch sketch_;
+  /* Front of the list is the most recently used key. */
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, CacheEntry> cache_;
+
+  CacheEntry* cacheLookup(folly::StringPiece key, int64_t now) {
+    auto it = cache_.find(key.str());
+    if (it == cache_.end()) {
+      return nullptr;
+    }
+    if (now >= it->second.expiryUs) {
+      lru_.erase(it->second.lruIt);
+      cache_.erase(it);
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+    return &it->second;
+  }
+
+  template <class Reply>
+  void cacheStore(folly::StringPiece key, const Reply& reply, int64_t now) {
+    auto it = cache_.find(key.str());
+    if (it == cache_.end()) {
+      if (cache_.size() >= maxEntries_) {
+        cache_.erase(lru_.back());
+        lru_.pop_back();
+      }
+      lru_.push_front(key.str());
+      it = cache_.emplace(key.str(), CacheEntry()).first;
+      it->second.lruIt = lru_.begin();
+    } else {
+      lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+    }
+    folly::IOBuf value;
+    reply.valuePtrUnsafe()->cloneInto(value);
+    it->second.value = std::move(value);
+    it->second.flags = reply.flags();
+    it->second.expiryUs = now + ttlUs_.count();
+  }
+
+  /**
+   * Seeds the sketch with the keys of the last snapshot, so a key that
+   * was hot before a restart is cached again on its first hit instead of
+   * re-qualifying from scratch. Values are deliberately not persisted:
+   * they may have changed while this process was down, so every key is
+   * refetched once before it is served locally again.
+   */
+  void loadSnapshot() {
+    std::string contents;
+    if (!folly::readFile(snapshotPath_.c_str(), contents)) {
+      return;
+    }
+    std::vector<folly::StringPiece> lines;
+    folly::split('\n', contents, lines, /* ignoreEmpty= */ true);
+    if (lines.empty() || lines.front() != kSnapshotMagic) {
+      LOG(ERROR) << "Ignoring hot key snapshot " << snapshotPath_
+                 << ": unrecognized format";
+      return;
+    }
+    size_t restored = 0;
+    for (size_t i = 1; i < lines.size() && restored < maxEntries_; ++i) {
+      sketch_.seed(lines[i], kHotThreshold);
+      ++restored;
+    }
+    VLOG(1) << "Restored " << restored << " hot keys from " << snapshotPath_;
+  }
+
+  /**
+   * Once per interval, hands the current hot key set to the router's
+   * async writer thread to be written out; only the small string build
+   * happens on the request path.
+   */
+  void maybeSnapshot(proxy_t& proxy, int64_t now) {
+    if (snapshotIntervalUs_.count() == 0 || snapshotPath_.empty()) {
+      return;
+    }
+    /* Wait a full interval after startup before the first write, so a
+       quick restart doesn't replace the previous snapshot with the
+       still-empty hot set. */
+    if (lastSnapshotUs_ == 0 ||
+        now - lastSnapshotUs_ < snapshotIntervalUs_.count()) {
+      if (lastSnapshotUs_ == 0) {
+        lastSnapshotUs_ = now;
+      }
+      return;
+    }
+    lastSnapshotUs_ = now;
+    std::string contents(kSnapshotMagic);
+    contents.push_back('\n');
+    for (const auto& key : lru_) {
+      contents.append(key);
+      contents.push_back('\n');
+    }
+    auto path = snapshotPath_;
+    proxy.router().asyncWriter().run([contents, path]() {
+      if (!atomicallyWriteFileToDisk(contents, path)) {
+        LOG(ERROR) << "Failed to write hot key snapshot " << path;
+      }
+    });
+  }
+
+  void invalidate(folly::StringPiece key) {
+    auto it = cache_.find(key.str());
+    if (it != cache_.end()) {
+      lru_.erase(it->second.lruIt);
+      cache_.erase(it);
+    }
+  }
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -78,8 +78,19 @@ McrouterRouteHandlePtr makeLatestRoute(
     }
   }
 
-  return makeFailoverRoute(json, getTargets(std::move(targets), failoverCount,
-      failoverThreadId, salt));
+  /* Latest pools are our most-written: without latching, a dead "latest"
+     host would be re-probed by every single request until TKO kicks in.
+     Default to a short cooldown; configs can override or set 0 to opt
+     out. */
+  folly::dynamic failoverJson =
+      json.isObject() ? json : folly::dynamic::object();
+  if (failoverJson.get_ptr("latch_failed_normal_ms") == nullptr) {
+    failoverJson["latch_failed_normal_ms"] = 100;
+  }
+
+  return makeFailoverRoute(failoverJson,
+                           getTargets(std::move(targets), failoverCount,
+                                      failoverThreadId, salt));
 }
 
 McrouterRouteHandlePtr makeLatestRoute(
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "LazyRoute.h"
+
+#include <folly/Format.h>
+#include <folly/io/async/EventBase.h>
+
+#include "mcrouter/McrouterLogFailure.h"
+#include "mcrouter/proxy.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr LazyRoute::State::materialize() {
+  if (!target) {
+    try {
+      target = materializeFunc();
+    } catch (const std::exception& e) {
+      LOG_FAILURE("mcrouter", failure::Category::kOther,
+                  "Error building lazy route: {}", e.what());
+    }
+  }
+  return target;
+}
+
+LazyRoute::LazyRoute(proxy_t& proxy,
+                     std::function<McrouterRouteHandlePtr()> materialize,
+                     bool prewarm)
+    : state_(std::make_shared<State>(std::move(materialize))) {
+  if (prewarm) {
+    std::weak_ptr<State> weakState = state_;
+    proxy.eventBase().runInEventBaseThread([weakState]() {
+      if (auto state = weakState.lock()) {
+        state->materialize();
+      }
+    });
+  }
+}
+
+std::string LazyRoute::routeName() const {
+  return folly::sformat(
+    "lazy|{}", state_->target ? state_->target->routeName() : "cold");
+}
+
+McrouterRouteHandlePtr makeLazyRoute(
+  proxy_t& proxy,
+  std::function<McrouterRouteHandlePtr()> materialize,
+  bool prewarm) {
+
+  return std::make_shared<McrouterRouteHandle<LazyRoute>>(
+    proxy, std::move(materialize), prewarm);
+}
+
+}}}  // facebook::memcache::mcrouter
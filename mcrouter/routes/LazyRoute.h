@@ -0,0 +1,90 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "mcrouter/lib/Reply.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+struct proxy_t;
+
+/**
+ * Placeholder for an expensive subtree, e.g. a server of a pool that this
+ * box rarely routes to. The real subtree, together with any
+ * ProxyDestinations it needs, is built on the proxy thread by the first
+ * request routed through this handle; until then the only cost of the
+ * subtree is this object.
+ *
+ * With prewarm set, the subtree is instead built by a background task on
+ * the proxy event base, off the critical path of both the config swap and
+ * the first request.
+ */
+class LazyRoute {
+ public:
+  std::string routeName() const;
+
+  /**
+   * @param proxy        proxy that routes requests through this handle
+   * @param materialize  builds the real subtree; invoked at most once,
+   *                     always on the proxy thread
+   * @param prewarm      build the subtree in the background right away
+   *                     instead of waiting for the first request
+   */
+  LazyRoute(proxy_t& proxy,
+            std::function<McrouterRouteHandlePtr()> materialize,
+            bool prewarm);
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    if (auto target = state_->materialize()) {
+      target->traverse(req, t);
+    }
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) const {
+    if (auto target = state_->materialize()) {
+      return target->route(req);
+    }
+    return ReplyT<Request>(ErrorReply);
+  }
+
+ private:
+  /**
+   * Shared with the background prewarm task, which holds only a weak
+   * reference: prewarm of a config that was dropped before the task ran
+   * must not resurrect its subtree.
+   */
+  struct State {
+    explicit State(std::function<McrouterRouteHandlePtr()> materializeFunc__)
+        : materializeFunc(std::move(materializeFunc__)) {}
+
+    /**
+     * Builds the subtree on first call.
+     * @return the subtree, nullptr if building it failed (the next call
+     *         will retry)
+     */
+    McrouterRouteHandlePtr materialize();
+
+    std::function<McrouterRouteHandlePtr()> materializeFunc;
+    McrouterRouteHandlePtr target;
+  };
+
+  const std::shared_ptr<State> state_;
+};
+
+}}} // facebook::memcache::mcrouter
@@ -14,6 +14,7 @@
 #include <folly/Range.h>
 
 #include "mcrouter/config.h"
+#include "mcrouter/FileDataProvider.h"
 #include "mcrouter/lib/fbi/cpp/ParsingUtil.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/WeightedCh3HashFunc.h"
@@ -28,6 +29,8 @@
 #include "mcrouter/routes/ShardHashFunc.h"
 #include "mcrouter/routes/ShardSplitter.h"
 #include "mcrouter/routes/SlowWarmUpRouteSettings.h"
+#include "mcrouter/routes/SwappableRoute.h"
+#include "mcrouter/RuntimeVarsData.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
@@ -49,6 +52,9 @@ std::vector<McrouterRouteHandlePtr> makeShadowRoutes(
 McrouterRouteHandlePtr makeAllAsyncRoute(McRouteHandleFactory& factory,
                                          const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeAffinityRoute(McRouteHandleFactory& factory,
+                                         const folly::dynamic& json);
+
 McrouterRouteHandlePtr makeAllFastestRoute(McRouteHandleFactory& factory,
                                            const folly::dynamic& json);
 
@@ -64,9 +70,18 @@ McrouterRouteHandlePtr makeAllSyncRoute(McRouteHandleFactory& factory,
 McrouterRouteHandlePtr makeAsynclogRoute(McrouterRouteHandlePtr rh,
                                          std::string asynclogName);
 
+McrouterRouteHandlePtr makeDedupRoute(McRouteHandleFactory& factory,
+                                      const folly::dynamic& json);
+
 McrouterRouteHandlePtr makeDevNullRoute(McRouteHandleFactory& factory,
                                         const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeDynamicPoolRoute(
+  proxy_t& proxy,
+  std::string poolName,
+  const std::string& serversFilePath,
+  std::function<McrouterRouteHandlePtr(const folly::dynamic&)> rebuildRing);
+
 McrouterRouteHandlePtr makeHostIdRoute(McRouteHandleFactory& factory,
                                        const folly::dynamic& json);
 
@@ -100,6 +115,11 @@ McrouterRouteHandlePtr makeL1L2CacheRoute(McRouteHandleFactory& factory,
 McrouterRouteHandlePtr makeLatestRoute(McRouteHandleFactory& factory,
                                        const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeLazyRoute(
+  proxy_t& proxy,
+  std::function<McrouterRouteHandlePtr()> materialize,
+  bool prewarm);
+
 McrouterRouteHandlePtr makeLoggingRoute(McRouteHandleFactory& factory,
                                         const folly::dynamic& json);
 
@@ -109,6 +129,9 @@ McrouterRouteHandlePtr makeMigrateRoute(McRouteHandleFactory& factory,
 McrouterRouteHandlePtr makeMissFailoverRoute(McRouteHandleFactory& factory,
                                              const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeMissFilterRoute(McRouteHandleFactory& factory,
+                                           const folly::dynamic& json);
+
 McrouterRouteHandlePtr makeModifyExptimeRoute(McRouteHandleFactory& factory,
                                               const folly::dynamic& json);
 
@@ -125,6 +148,9 @@ McrouterRouteHandlePtr makeOutstandingLimitRoute(
   McrouterRouteHandlePtr normalRoute,
   size_t maxOutstanding);
 
+McrouterRouteHandlePtr makeProfilingRoute(proxy_t& proxy,
+                                          McrouterRouteHandlePtr rh);
+
 McrouterRouteHandlePtr makeRateLimitRoute(McrouterRouteHandlePtr normalRoute,
                                           RateLimiter rateLimiter);
 
@@ -140,6 +166,11 @@ McrouterRouteHandlePtr makeShardSplitRoute(McrouterRouteHandlePtr rh,
 McrouterRouteHandlePtr makeWarmUpRoute(McRouteHandleFactory& factory,
                                        const folly::dynamic& json);
 
+McrouterRouteHandlePtr makeWeightedCh3HashRoute(
+    std::vector<McrouterRouteHandlePtr> rh,
+    std::string salt,
+    WeightedCh3HashFunc func);
+
 McrouterRouteHandlePtr makeSlowWarmUpRoute(
     McrouterRouteHandlePtr target,
     McrouterRouteHandlePtr failoverTarget,
@@ -156,6 +187,7 @@ McRouteHandleProvider::McRouteHandleProvider(
       poolFactory_(poolFactory),
       extraProvider_(createExtraRouteHandleProvider()),
       routeMap_{
+        { "AffinityRoute", &makeAffinityRoute },
         { "AllAsyncRoute", &makeAllAsyncRoute },
         { "AllFastestRoute", &makeAllFastestRoute },
         { "AllInitialRoute", &makeAllInitialRoute },
@@ -168,6 +200,7 @@ McRouteHandleProvider::McRouteHandleProvider(
             return createAsynclogRoute(std::move(p.first), std::move(p.second));
           }
         },
+        { "DedupRoute", &makeDedupRoute },
         { "DevNullRoute", &makeDevNullRoute },
         { "ErrorRoute", &makeErrorRoute },
         { "FailoverRoute", &makeFailoverRoute },
@@ -184,6 +217,7 @@ McRouteHandleProvider::McRouteHandleProvider(
         { "LoggingRoute", &makeLoggingRoute },
         { "MigrateRoute", &makeMigrateRoute },
         { "MissFailoverRoute", &makeMissFailoverRoute },
+        { "MissFilterRoute", &makeMissFilterRoute },
         { "ModifyExptimeRoute", &makeModifyExptimeRoute },
         { "ModifyKeyRoute", &makeModifyKeyRoute },
         { "NullRoute", &makeNullRoute },
@@ -256,6 +290,7 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
       timeout = parseTimeout(*jTimeout, "server_timeout");
     }
 
+    std::chrono::microseconds flushDelay{0};
     if (!region.empty() && !cluster.empty()) {
       auto& route = opts.default_route;
       if (region == route.getRegion() && cluster == route.getCluster()) {
@@ -270,8 +305,16 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
         if (opts.cross_region_timeout_ms != 0) {
           timeout = std::chrono::milliseconds(opts.cross_region_timeout_ms);
         }
+        if (opts.cross_region_flush_delay_us != 0) {
+          flushDelay =
+            std::chrono::microseconds(opts.cross_region_flush_delay_us);
+        }
       }
     }
+    if (auto jFlushDelay = json.get_ptr("flush_delay_us")) {
+      flushDelay = std::chrono::microseconds(
+        parseInt(*jFlushDelay, "flush_delay_us", 0, 1000000));
+    }
 
     mc_protocol_t protocol = mc_ascii_protocol;
     if (auto jProtocol = json.get_ptr("protocol")) {
@@ -303,6 +346,18 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
       keepRoutingPrefix = parseBool(*jKeepRoutingPrefix, "keep_routing_prefix");
     }
 
+    // Lazy pools defer ProxyDestination creation until the first request
+    // routed to each server (see LazyRoute); "prewarm" builds them from a
+    // background task on the proxy thread instead.
+    bool lazy = false;
+    if (auto jLazy = json.get_ptr("lazy")) {
+      lazy = parseBool(*jLazy, "lazy");
+    }
+    bool prewarm = false;
+    if (auto jPrewarm = json.get_ptr("prewarm")) {
+      prewarm = parseBool(*jPrewarm, "prewarm");
+    }
+
     uint64_t qosClass = opts.default_qos_class;
     uint64_t qosPath = opts.default_qos_path;
     if (auto jQos = json.get_ptr("qos")) {
@@ -327,6 +382,56 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
     }
     // servers
     auto jservers = json.get_ptr("servers");
+    if (auto jserversFile = json.get_ptr("servers_file")) {
+      checkLogic(!jservers,
+                 "pool can not have both 'servers' and 'servers_file'");
+      auto serversFilePath = parseString(*jserversFile, "servers_file").str();
+
+      // Self-contained, so DynamicPoolRoute can rebuild the pool at
+      // runtime, long after this provider is gone. ProxyDestinations of
+      // servers that stay in the pool are reused via destinationMap.
+      auto buildDestinations =
+        [&proxy = proxy_, name, timeout, protocol, useSsl, port,
+         enableCompression, qosClass, qosPath, keepRoutingPrefix, flushDelay]
+        (const folly::dynamic& jNewServers) {
+          checkLogic(jNewServers.isArray(), "servers is not an array");
+          std::vector<McrouterRouteHandlePtr> destinations;
+          destinations.reserve(jNewServers.size());
+          for (size_t i = 0; i < jNewServers.size(); ++i) {
+            const auto& server = jNewServers[i];
+            checkLogic(server.isString(), "server #{} is not a string", i);
+            auto ap = proxy.router().getAccessPoint(
+              server.stringPiece(), protocol, useSsl, port,
+              enableCompression);
+            checkLogic(ap != nullptr, "invalid server {}",
+                       server.stringPiece());
+            auto pdstn = proxy.destinationMap->find(*ap, timeout);
+            if (!pdstn) {
+              pdstn = proxy.destinationMap->emplace(
+                std::move(ap), timeout, qosClass, qosPath);
+            }
+            pdstn->updatePoolName(name);
+            pdstn->updateShortestTimeout(timeout);
+            pdstn->updateFlushDelay(flushDelay);
+            destinations.push_back(makeDestinationRoute(
+              std::move(pdstn), name, i, timeout, keepRoutingPrefix));
+          }
+          return destinations;
+        };
+
+      // initial server list; later changes are applied in place by
+      // DynamicPoolRoute, so they don't show up in accessPoints_
+      auto jInitialServers =
+        parseJsonString(FileDataProvider(serversFilePath).load());
+      auto destinations = buildDestinations(jInitialServers);
+      for (const auto& server : jInitialServers) {
+        accessPoints_[name].push_back(proxy_.router().getAccessPoint(
+          server.stringPiece(), protocol, useSsl, port, enableCompression));
+      }
+      dynamicPools_.emplace(
+        name, DynamicPool{serversFilePath, std::move(buildDestinations)});
+      return pools_.emplace(name, std::move(destinations)).first->second;
+    }
     checkLogic(jservers, "servers not found");
     checkLogic(jservers->isArray(), "servers is not an array");
     std::vector<McrouterRouteHandlePtr> destinations;
@@ -339,12 +444,33 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
         destinations.push_back(factory.create(server));
         continue;
       }
-      auto ap = AccessPoint::create(server.stringPiece(), protocol, useSsl,
-                                    port, enableCompression);
+      // access points are immutable and shared across all proxies
+      auto ap = proxy_.router().getAccessPoint(
+        server.stringPiece(), protocol, useSsl, port, enableCompression);
       checkLogic(ap != nullptr, "invalid server {}", server.stringPiece());
 
       accessPoints_[name].push_back(ap);
 
+      if (lazy) {
+        destinations.push_back(makeLazyRoute(
+          proxy_,
+          [&proxy = proxy_, ap, name, i, timeout, qosClass, qosPath,
+           keepRoutingPrefix, flushDelay]() {
+            auto pdstn = proxy.destinationMap->find(*ap, timeout);
+            if (!pdstn) {
+              pdstn = proxy.destinationMap->emplace(
+                ap, timeout, qosClass, qosPath);
+            }
+            pdstn->updatePoolName(name);
+            pdstn->updateShortestTimeout(timeout);
+            pdstn->updateFlushDelay(flushDelay);
+            return makeDestinationRoute(
+              std::move(pdstn), name, i, timeout, keepRoutingPrefix);
+          },
+          prewarm));
+        continue;
+      }
+
       auto pdstn = proxy_.destinationMap->find(*ap, timeout);
       if (!pdstn) {
         pdstn = proxy_.destinationMap->emplace(
@@ -353,6 +479,7 @@ McRouteHandleProvider::makePool(McRouteHandleFactory& factory,
       }
       pdstn->updatePoolName(name);
       pdstn->updateShortestTimeout(timeout);
+      pdstn->updateFlushDelay(flushDelay);
 
       destinations.push_back(makeDestinationRoute(
         std::move(pdstn), name, i, timeout, keepRoutingPrefix));
@@ -442,8 +569,78 @@ McRouteHandleProvider::makePoolRoute(McRouteHandleFactory& factory,
         }
       }
     }
-    auto route = makeHashRoute(jhashWithWeights, std::move(destinations),
-                               factory.getThreadId());
+    McrouterRouteHandlePtr route;
+    auto dynamicIt = dynamicPools_.find(poolJson.name);
+    if (dynamicIt != dynamicPools_.end()) {
+      checkLogic(!json.isObject() ||
+                 (!json.count("max_outstanding") &&
+                  !json.count("slow_warmup") &&
+                  !json.count("shadows")),
+                 "max_outstanding/slow_warmup/shadows are not supported "
+                 "with servers_file");
+      checkLogic(!poolJson.json.count("weights_rv"),
+                 "weights_rv is not supported with servers_file");
+      auto buildDestinations = dynamicIt->second.buildDestinations;
+      auto threadId = factory.getThreadId();
+      route = makeDynamicPoolRoute(
+        proxy_,
+        poolJson.name.str(),
+        dynamicIt->second.serversFilePath,
+        [buildDestinations, jhashWithWeights, threadId]
+        (const folly::dynamic& jServers) {
+          return makeHashRoute(
+            jhashWithWeights, buildDestinations(jServers), threadId);
+        });
+    } else if (auto jWeightsRv = poolJson.json.get_ptr("weights_rv")) {
+      /* Live weights: build the ring behind a shared slot and keep it in
+         sync with the named runtime variable, so draining a destination
+         (weight -> 0) is a runtime-vars push instead of a config push. */
+      auto rvName = parseString(*jWeightsRv, "weights_rv").str();
+      checkLogic(jhashWithWeights.count("weights") &&
+                 jhashWithWeights["hash_func"] ==
+                     WeightedCh3HashFunc::type(),
+                 "PoolRoute {}: weights_rv requires WeightedCh3 weights",
+                 poolJson.name);
+      const auto n = destinations.size();
+      auto slot = std::make_shared<WeightedCh3RingSlot>(
+          WeightedCh3Ring::fromJson(jhashWithWeights, n, "PoolRoute"));
+      rtVarsSubscriptions_.push_back(
+          proxy_.router().rtVarsData().subscribeAndCall(
+              [slot, rvName, n](
+                  std::shared_ptr<const RuntimeVarsData> /* oldVars */,
+                  std::shared_ptr<const RuntimeVarsData> newVars) {
+                if (!newVars) {
+                  return;
+                }
+                const auto* val = newVars->getVariablePtrByName(rvName);
+                if (val == nullptr) {
+                  return;
+                }
+                checkLogic(val->isArray(),
+                           "runtime vars: {} is not an array", rvName);
+                std::vector<double> weights;
+                for (size_t i = 0; i < std::min(n, val->size()); ++i) {
+                  checkLogic((*val)[i].isNumber(),
+                             "runtime vars: {}#{} is not a number",
+                             rvName, i);
+                  weights.push_back((*val)[i].asDouble());
+                }
+                /* As with config weights, missing trailing ones are 0.5 */
+                weights.resize(n, 0.5);
+                slot->setWeights(std::move(weights));
+              }));
+      std::string salt;
+      if (auto jsalt = jhashWithWeights.get_ptr("salt")) {
+        checkLogic(jsalt->isString(), "PoolRoute: salt is not a string");
+        salt = jsalt->getString();
+      }
+      route = makeWeightedCh3HashRoute(std::move(destinations),
+                                       std::move(salt),
+                                       WeightedCh3HashFunc(std::move(slot)));
+    } else {
+      route = makeHashRoute(jhashWithWeights, std::move(destinations),
+                            factory.getThreadId());
+    }
 
     auto asynclogName = poolJson.name;
     bool needAsynclog = true;
@@ -465,6 +662,19 @@ McRouteHandleProvider::makePoolRoute(McRouteHandleFactory& factory,
       route = createAsynclogRoute(std::move(route), asynclogName.str());
     }
 
+    if (proxy_.router().opts().enable_pool_route_swap) {
+      auto swapTarget = std::make_shared<SwappableRouteTarget>(
+          poolJson.name.str(), std::move(route));
+      auto swapIt = swappableRoutes_.find(poolJson.name);
+      if (swapIt == swappableRoutes_.end()) {
+        swapIt = swappableRoutes_.emplace(
+            poolJson.name,
+            std::vector<std::shared_ptr<SwappableRouteTarget>>()).first;
+      }
+      swapIt->second.push_back(swapTarget);
+      route = makeSwappableRoute(std::move(swapTarget));
+    }
+
     return route;
   } catch (const std::exception& e) {
     throwLogic("PoolRoute {}: {}", poolJson.name, e.what());
@@ -476,6 +686,20 @@ std::vector<McrouterRouteHandlePtr> McRouteHandleProvider::create(
     folly::StringPiece type,
     const folly::dynamic& json) {
 
+  auto ret = createRouteHandles(factory, type, json);
+  if (proxy_.router().opts().route_handle_profiling) {
+    for (auto& rh : ret) {
+      rh = makeProfilingRoute(proxy_, std::move(rh));
+    }
+  }
+  return ret;
+}
+
+std::vector<McrouterRouteHandlePtr> McRouteHandleProvider::createRouteHandles(
+    McRouteHandleFactory& factory,
+    folly::StringPiece type,
+    const folly::dynamic& json) {
+
   if (type == "Pool") {
     return makePool(factory, poolFactory_.parsePool(json));
   } else if (type == "ShadowRoute") {
@@ -18,6 +18,7 @@
 #include <folly/Range.h>
 
 #include "mcrouter/lib/config/RouteHandleProviderIf.h"
+#include "mcrouter/Observable.h"
 #include "mcrouter/PoolFactory.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
@@ -28,7 +29,11 @@ struct dynamic;
 namespace facebook { namespace memcache { namespace mcrouter {
 
 class ExtraRouteHandleProviderIf;
+class RuntimeVarsData;
+class SwappableRouteTarget;
 struct proxy_t;
+using ObservableRuntimeVars =
+  Observable<std::shared_ptr<const RuntimeVarsData>>;
 
 /**
  * RouteHandleProviderIf implementation that can create mcrouter-specific
@@ -59,6 +64,17 @@ class McRouteHandleProvider :
     return std::move(accessPoints_);
   }
 
+  folly::StringKeyedUnorderedMap<
+    std::vector<std::shared_ptr<SwappableRouteTarget>>>
+  releaseSwappableRoutes() {
+    return std::move(swappableRoutes_);
+  }
+
+  std::vector<ObservableRuntimeVars::CallbackHandle>
+  releaseRuntimeVarsSubscriptions() {
+    return std::move(rtVarsSubscriptions_);
+  }
+
   ~McRouteHandleProvider();
 
  private:
@@ -80,6 +96,33 @@ class McRouteHandleProvider :
     std::vector<std::shared_ptr<const AccessPoint>>
   > accessPoints_;
 
+  /**
+   * Runtime-vars subscriptions made while building routes (live pool
+   * weights via "weights_rv"). Released to the owning ProxyConfig so
+   * the callbacks are unsubscribed exactly when the config goes away.
+   */
+  std::vector<ObservableRuntimeVars::CallbackHandle> rtVarsSubscriptions_;
+
+  // poolName -> swap targets of the SwappableRoutes wrapping that
+  // pool's PoolRoutes (only with --enable-pool-route-swap)
+  folly::StringKeyedUnorderedMap<
+    std::vector<std::shared_ptr<SwappableRouteTarget>>
+  > swappableRoutes_;
+
+  /**
+   * Pools whose server list is bound to a watched file ("servers_file").
+   * buildDestinations is self-contained (it does not reference this
+   * provider), so DynamicPoolRoute can rebuild the pool at runtime.
+   */
+  struct DynamicPool {
+    std::string serversFilePath;
+    std::function<std::vector<McrouterRouteHandlePtr>(const folly::dynamic&)>
+      buildDestinations;
+  };
+
+  // poolName -> dynamic pool description
+  folly::StringKeyedUnorderedMap<DynamicPool> dynamicPools_;
+
   const std::unordered_map<folly::StringPiece, RouteFunc,
                            folly::StringPieceHash> routeMap_;
 
@@ -93,6 +136,11 @@ class McRouteHandleProvider :
 
   McrouterRouteHandlePtr
   createAsynclogRoute(McrouterRouteHandlePtr route, std::string asynclogName);
+
+  std::vector<McrouterRouteHandlePtr>
+  createRouteHandles(RouteHandleFactory<McrouterRouteHandleIf>& factory,
+                     folly::StringPiece type,
+                     const folly::dynamic& json);
 };
 
 }}} // facebook::memcache::mcrouter
@@ -0,0 +1,20 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache {
+
+/* Single home for the route handle interface chain; every other
+   translation unit sees only the extern template declaration in
+   McrouterRouteHandle.h. */
+template class RouteHandleIf<mcrouter::McrouterRouteHandleIf,
+                             RoutedRequestList>;
+
+}}  // facebook::memcache
@@ -12,31 +12,50 @@
 #include <memory>
 
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/ThriftMessageList.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
 #include "mcrouter/lib/RouteHandleIf.h"
 
-namespace facebook { namespace memcache { namespace mcrouter {
+namespace facebook { namespace memcache {
 
+namespace mcrouter {
 class McrouterRouteHandleIf;
+} // mcrouter
+
+/* The abstract interface chain under McrouterRouteHandleIf is identical
+   in every translation unit that touches a route handle; instantiate it
+   once in McrouterRouteHandle.cpp instead of in each of them. */
+extern template class RouteHandleIf<mcrouter::McrouterRouteHandleIf,
+                                    RoutedRequestList>;
+
+namespace mcrouter {
 
 template <typename Route>
 class McrouterRouteHandle :
       public RouteHandle<Route,
                          McrouterRouteHandleIf,
-                         ThriftRequestList> {
+                         RoutedRequestList> {
  public:
   template<typename... Args>
   explicit McrouterRouteHandle(Args&&... args)
     : RouteHandle<Route,
                   McrouterRouteHandleIf,
-                  ThriftRequestList>(
+                  RoutedRequestList>(
                     std::forward<Args>(args)...) {
   }
+
+  /**
+   * Access to the wrapped route, for factories that introspect already
+   * constructed handles (e.g. to collapse nested selectors).
+   */
+  Route& wrappedRoute() {
+    return this->route_;
+  }
 };
 
 class McrouterRouteHandleIf :
       public RouteHandleIf<McrouterRouteHandleIf,
-                           ThriftRequestList> {
+                           RoutedRequestList> {
  public:
   template <class Route>
   using Impl = McrouterRouteHandle<Route>;
@@ -21,14 +21,18 @@ McrouterRouteHandlePtr makeMigrateRoute(
   McrouterRouteHandlePtr fh,
   McrouterRouteHandlePtr th,
   time_t start_time_sec,
-  time_t interval_sec) {
+  time_t interval_sec,
+  bool ramp = false,
+  std::vector<double> rampCurve = std::vector<double>()) {
 
   return makeMcrouterRouteHandle<MigrateRoute, TimeProviderFunc>(
     std::move(fh),
     std::move(th),
     start_time_sec,
     interval_sec,
-    TimeProviderFunc());
+    TimeProviderFunc(),
+    ramp,
+    std::move(rampCurve));
 }
 
 McrouterRouteHandlePtr makeMigrateRoute(
@@ -49,11 +53,34 @@ McrouterRouteHandlePtr makeMigrateRoute(
     intervalSec = jinterval->asInt();
   }
 
+  bool ramp = false;
+  if (auto jramp = json.get_ptr("ramp")) {
+    checkLogic(jramp->isBool(), "MigrateRoute ramp is not bool");
+    ramp = jramp->getBool();
+  }
+
+  std::vector<double> rampCurve;
+  if (auto jrampCurve = json.get_ptr("ramp_curve")) {
+    checkLogic(ramp, "MigrateRoute ramp_curve requires ramp to be true");
+    checkLogic(jrampCurve->isArray() && jrampCurve->size() >= 2,
+               "MigrateRoute ramp_curve is not an array of >= 2 points");
+    for (const auto& jpoint : *jrampCurve) {
+      checkLogic(jpoint.isNumber(), "MigrateRoute ramp_curve point is not a"
+                                    " number");
+      auto point = jpoint.asDouble();
+      checkLogic(point >= 0.0 && point <= 100.0,
+                 "MigrateRoute ramp_curve point is not in [0, 100]");
+      rampCurve.push_back(point);
+    }
+  }
+
   return makeMigrateRoute(
     factory.create(json["from"]),
     factory.create(json["to"]),
     startTimeSec,
-    intervalSec);
+    intervalSec,
+    ramp,
+    std::move(rampCurve));
 }
 
 }}}  // facebook::memcache::mcrouter
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/routes/MissFilterRoute.h"
+#include "mcrouter/routes/McRouteHandleBuilder.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeMissFilterRoute(
+  McrouterRouteHandlePtr child,
+  size_t filterSizeBytes,
+  std::chrono::seconds missTtl) {
+  return makeMcrouterRouteHandle<MissFilterRoute>(
+    std::move(child),
+    filterSizeBytes,
+    missTtl);
+}
+
+McrouterRouteHandlePtr makeMissFilterRoute(
+    RouteHandleFactory<McrouterRouteHandleIf>& factory,
+    const folly::dynamic& json) {
+  checkLogic(json.isObject(), "MissFilterRoute should be an object");
+  checkLogic(json.count("child"), "MissFilterRoute: no child route");
+
+  size_t filterSizeMb = 4;
+  if (json.count("filter_size_mb")) {
+    checkLogic(json["filter_size_mb"].isInt(),
+               "MissFilterRoute: filter_size_mb is not an integer");
+    filterSizeMb = json["filter_size_mb"].getInt();
+    checkLogic(filterSizeMb > 0 && filterSizeMb <= 1024,
+               "MissFilterRoute: filter_size_mb should be in range (0, 1024]");
+  }
+
+  size_t missTtlSec = 60;
+  if (json.count("miss_ttl_sec")) {
+    checkLogic(json["miss_ttl_sec"].isInt(),
+               "MissFilterRoute: miss_ttl_sec is not an integer");
+    missTtlSec = json["miss_ttl_sec"].getInt();
+    checkLogic(missTtlSec > 0, "MissFilterRoute: miss_ttl_sec should be > 0");
+  }
+
+  return makeMissFilterRoute(
+    factory.create(json["child"]),
+    filterSizeMb * 1024 * 1024,
+    std::chrono::seconds(missTtlSec));
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -17,6 +17,8 @@
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+template class McrouterRouteHandle<ModifyExptimeRoute>;
+
 namespace {
 
 ModifyExptimeRoute::Action stringToAction(folly::StringPiece s) {
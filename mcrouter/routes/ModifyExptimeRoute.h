@@ -64,6 +64,9 @@ class ModifyExptimeRoute {
       const TypedThriftRequest<TRequest>& req) const {
     switch (action_) {
       case Action::Set: {
+        if (req.exptime() == exptime_) {
+          return target_->route(req);
+        }
         auto mutReq = req.clone();
         mutReq->set_exptime(exptime_);
         return target_->route(mutReq);
@@ -94,4 +97,8 @@ class ModifyExptimeRoute {
   const Action action_;
 };
 
+/* Constructed from both ModifyExptimeRoute.cpp and
+   FailoverWithExptimeRoute.cpp; instantiated once in the former. */
+extern template class McrouterRouteHandle<ModifyExptimeRoute>;
+
 }}}  // facebook::memcache::mcrouter
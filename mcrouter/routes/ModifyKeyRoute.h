@@ -17,6 +17,7 @@
 #include <folly/Conv.h>
 #include <folly/Optional.h>
 
+#include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/lib/mc/protocol.h"
 #include "mcrouter/lib/McKey.h"
@@ -72,11 +73,11 @@ class ModifyKeyRoute {
       : req.routingPrefix();
 
     if (!req.keyWithoutRoute().startsWith(keyPrefix_)) {
-      auto key = folly::to<std::string>(rp, keyPrefix_, req.keyWithoutRoute());
-      return routeReqWithKey(req, key);
+      return routeReqWithKey(
+        req, concatPieces({rp, keyPrefix_, req.keyWithoutRoute()}));
     } else if (routingPrefix_.hasValue() && rp != req.routingPrefix()) {
-      auto key = folly::to<std::string>(rp, req.keyWithoutRoute());
-      return routeReqWithKey(req, key);
+      return routeReqWithKey(
+        req, concatPieces({rp, req.keyWithoutRoute()}));
     }
     return target_->route(req);
   }
@@ -88,15 +89,13 @@ class ModifyKeyRoute {
 
   template <class Request>
   ReplyT<Request>
-  routeReqWithKey(const Request& req, folly::StringPiece key) const {
-    auto err = isKeyValid(key);
+  routeReqWithKey(const Request& req, folly::IOBuf key) const {
+    auto err = isKeyValid(getRange(key));
     if (err != mc_req_err_valid) {
       return ReplyT<Request>(ErrorReply, "ModifyKeyRoute: invalid key: " +
           std::string(mc_req_err_to_string(err)));
     }
-    auto cloneReq = req.clone();
-    cloneReq.setKey(key);
-    return target_->route(cloneReq);
+    return target_->route(req.cloneWithKey(std::move(key)));
   }
 };
 
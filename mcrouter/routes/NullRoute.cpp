@@ -17,7 +17,11 @@
 namespace facebook { namespace memcache { namespace mcrouter {
 
 McrouterRouteHandlePtr makeNullRoute() {
-  return makeMcrouterRouteHandle<NullRoute>();
+  /* NullRoute is stateless, so every config tree shares one instance
+     instead of allocating one per use. */
+  static McrouterRouteHandlePtr singleton =
+      makeMcrouterRouteHandle<NullRoute>();
+  return singleton;
 }
 
 McrouterRouteHandlePtr makeNullRoute(
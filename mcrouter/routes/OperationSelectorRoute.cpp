@@ -15,10 +15,53 @@
 
 #include "mcrouter/lib/config/RouteHandleFactory.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/mc/msg.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+namespace {
+
+/**
+ * Follows a chain of nested OperationSelectorRoutes for one operation.
+ * Stops at the first handle that is not a selector, or at a selector with
+ * no target for this operation (it replies with a default-constructed
+ * reply itself, so it must stay in the slot).
+ */
+McrouterRouteHandlePtr resolveForOp(McrouterRouteHandlePtr rh, size_t op) {
+  for (;;) {
+    auto* selector =
+      dynamic_cast<McrouterRouteHandle<OperationSelectorRoute>*>(rh.get());
+    if (selector == nullptr) {
+      return rh;
+    }
+    const auto& next = selector->wrappedRoute().policyForOp(op);
+    if (!next) {
+      return rh;
+    }
+    rh = next;
+  }
+}
+
+}  // anonymous
+
+std::vector<McrouterRouteHandlePtr> OperationSelectorRoute::flatten(
+  std::vector<McrouterRouteHandlePtr> operationPolicies,
+  McrouterRouteHandlePtr defaultPolicy) {
+
+  operationPolicies.resize(mc_nops);
+  for (size_t op = 0; op < mc_nops; ++op) {
+    auto& slot = operationPolicies[op];
+    if (!slot) {
+      slot = defaultPolicy;
+    }
+    if (slot) {
+      slot = resolveForOp(std::move(slot), op);
+    }
+  }
+  return operationPolicies;
+}
+
 McrouterRouteHandlePtr makeOperationSelectorRoute(
   std::vector<McrouterRouteHandlePtr> operationPolicies,
   McrouterRouteHandlePtr defaultPolicy) {
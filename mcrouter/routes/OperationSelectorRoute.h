@@ -28,8 +28,17 @@ class OperationSelectorRoute {
   OperationSelectorRoute(
     std::vector<McrouterRouteHandlePtr> operationPolicies,
     McrouterRouteHandlePtr&& defaultPolicy)
-      : operationPolicies_(std::move(operationPolicies)),
-        defaultPolicy_(std::move(defaultPolicy)) {
+      : operationPolicies_(
+          flatten(std::move(operationPolicies), std::move(defaultPolicy))) {
+  }
+
+  /**
+   * The handle this selector dispatches the given operation to (the default
+   * policy is already folded into every unset slot).  Null means the
+   * selector answers the operation itself with a default-constructed reply.
+   */
+  const McrouterRouteHandlePtr& policyForOp(size_t op) const {
+    return operationPolicies_[op];
   }
 
   template <class Request>
@@ -40,8 +49,6 @@ class OperationSelectorRoute {
 
     if (operationPolicies_[op]) {
       t(*operationPolicies_[op], req);
-    } else if (defaultPolicy_) {
-      t(*defaultPolicy_, req);
     }
   }
 
@@ -52,8 +59,6 @@ class OperationSelectorRoute {
 
     if (operationPolicies_[op]) {
       return operationPolicies_[op]->route(req);
-    } else if (defaultPolicy_) {
-      return defaultPolicy_->route(req);
     }
 
     return ReplyT<Request>();
@@ -61,7 +66,16 @@ class OperationSelectorRoute {
 
 private:
   const std::vector<McrouterRouteHandlePtr> operationPolicies_;
-  const McrouterRouteHandlePtr defaultPolicy_;
+
+  /**
+   * Resolves each operation slot to its final dispatch target: fills unset
+   * slots with the default policy and follows chains of nested
+   * OperationSelectorRoutes, so route() is a single indexed load no matter
+   * how deep the config nests selectors.
+   */
+  static std::vector<McrouterRouteHandlePtr> flatten(
+    std::vector<McrouterRouteHandlePtr> operationPolicies,
+    McrouterRouteHandlePtr defaultPolicy);
 };
 
 }}}  // facebook::memcache::mcrouter
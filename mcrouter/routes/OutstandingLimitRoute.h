@@ -17,6 +17,7 @@
 #include <folly/fibers/Baton.h>
 #include <folly/ScopeGuard.h>
 
+#include "mcrouter/ExponentialSmoothData.h"
 #include "mcrouter/lib/McOperationTraits.h"
 #include "mcrouter/lib/network/ThriftMessageTraits.h"
 #include "mcrouter/lib/Operation.h"
@@ -54,8 +55,17 @@ class OutstandingLimitRoute {
 
   template <class Request>
   ReplyT<Request> route(const Request& req) {
+    bool shedAfterWait = false;
     if (outstanding_ == maxOutstanding_) {
       auto& ctx = fiber_local::getSharedCtx();
+      if (pastDeadline()) {
+        /* The client would give up before we could even reach the
+           destination; don't bother queueing. */
+        stat_incr(ctx->proxy().stats,
+                  outstanding_route_deadline_shed_stat, 1);
+        return ReplyT<Request>(mc_res_timeout,
+                               "OutstandingLimitRoute: deadline exceeded");
+      }
       auto senderId = ctx->senderId();
       auto& entry = [&]() -> QueueEntry& {
         auto entry_it = senderIdToEntry_.find(senderId);
@@ -98,6 +108,7 @@ class OutstandingLimitRoute {
           stat_incr(stats, outstanding_route_update_reqs_queued_stat, 1);
         }
       }
+      shedAfterWait = pastDeadline();
     } else {
       outstanding_++;
       assert(outstanding_ <= maxOutstanding_);
@@ -123,7 +134,19 @@ class OutstandingLimitRoute {
       }
     };
 
-    return target_->route(req);
+    if (shedAfterWait) {
+      /* The wait ate through the remaining deadline budget; fast-fail and
+         let the scope guard hand the slot to the next waiter. */
+      stat_incr(fiber_local::getSharedCtx()->proxy().stats,
+                outstanding_route_deadline_shed_stat, 1);
+      return ReplyT<Request>(mc_res_timeout,
+                             "OutstandingLimitRoute: deadline exceeded");
+    }
+
+    const int64_t latencyStartUs = nowUs();
+    auto reply = target_->route(req);
+    avgLatencyUs_.insertSample(static_cast<double>(nowUs() - latencyStartUs));
+    return reply;
   }
 
  private:
@@ -132,6 +155,18 @@ class OutstandingLimitRoute {
   size_t outstanding_{0};
   size_t currentGetReqsWaiting_{0};
   size_t currentUpdateReqsWaiting_{0};
+  ExponentialSmoothData<16> avgLatencyUs_;
+
+  /**
+   * True if the current request's remaining deadline budget is smaller
+   * than the expected downstream latency, i.e. a reply would likely
+   * arrive after the client has already given up.
+   */
+  bool pastDeadline() const {
+    const auto deadlineUs = fiber_local::getRequestDeadlineUs();
+    return deadlineUs != 0 &&
+        nowUs() + static_cast<int64_t>(avgLatencyUs_.value()) >= deadlineUs;
+  }
 
   struct QueueEntry {
     QueueEntry(QueueEntry&&) = delete;
@@ -0,0 +1,23 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "ProfilingRoute.h"
+
+#include "mcrouter/proxy.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeProfilingRoute(proxy_t& proxy,
+                                          McrouterRouteHandlePtr rh) {
+  assert(proxy.routeHandleProfiler != nullptr);
+  return std::make_shared<McrouterRouteHandle<ProfilingRoute>>(
+      *proxy.routeHandleProfiler, std::move(rh));
+}
+
+}}}  // facebook::memcache::mcrouter
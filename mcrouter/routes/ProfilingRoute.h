@@ -0,0 +1,65 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "mcrouter/lib/cycles/Clocks.h"
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/RouteHandleProfiler.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Wraps another route handle and attributes CPU cycles to it.
+ *
+ * The recorded cost of a handle is inclusive: it covers the wrapped
+ * handle and everything below it, including any time the fiber spent
+ * suspended while waiting for destinations. Since every handle of the
+ * tree is wrapped, the exclusive cost of one layer is the difference
+ * between its entry and its children's.
+ */
+class ProfilingRoute {
+ public:
+  static std::string routeName() {
+    return "profiling";
+  }
+
+  ProfilingRoute(RouteHandleProfiler& profiler, McrouterRouteHandlePtr rh)
+      : profiler_(profiler),
+        child_(std::move(rh)),
+        // captured once: routeName() of most handles formats a new string
+        // on every call
+        name_(child_->routeName()) {
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*child_, req);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) {
+    const auto startCycles = cycles::getCpuCycles();
+    auto reply = child_->route(req);
+    profiler_.record(name_, cycles::getCpuCycles() - startCycles);
+    return reply;
+  }
+
+ private:
+  RouteHandleProfiler& profiler_;
+  const McrouterRouteHandlePtr child_;
+  const std::string name_;
+};
+
+}}}  // facebook::memcache::mcrouter
@@ -9,6 +9,9 @@
  */
 #include "ProxyRoute.h"
 
+#include <chrono>
+
+#include <folly/Format.h>
 #include <folly/Optional.h>
 
 #include "mcrouter/McrouterInstance.h"
@@ -22,6 +25,13 @@ namespace mcrouter {
 McrouterRouteHandlePtr makeBigValueRoute(McrouterRouteHandlePtr ch,
                                          BigValueRouteOptions options);
 
+McrouterRouteHandlePtr makeHotKeyCacheRoute(
+    McrouterRouteHandlePtr rh,
+    size_t maxEntries,
+    std::chrono::milliseconds ttl,
+    std::string snapshotPath,
+    std::chrono::milliseconds snapshotInterval);
+
 McrouterRouteHandlePtr makeLoggingRoute(McrouterRouteHandlePtr rh);
 
 ProxyRoute::ProxyRoute(proxy_t *proxy, const RouteSelectorMap &routeSelectors)
@@ -31,12 +41,29 @@ ProxyRoute::ProxyRoute(proxy_t *proxy, const RouteSelectorMap &routeSelectors)
   if (proxy_->getRouterOptions().big_value_split_threshold != 0) {
     BigValueRouteOptions options(
         proxy_->getRouterOptions().big_value_split_threshold,
-        proxy_->getRouterOptions().big_value_batch_size);
+        proxy_->getRouterOptions().big_value_batch_size,
+        proxy_->getRouterOptions().big_value_dedup_chunks);
     root_ = makeBigValueRoute(std::move(root_), std::move(options));
   }
   if (proxy_->getRouterOptions().enable_logging_route) {
     root_ = makeLoggingRoute(std::move(root_));
   }
+  if (proxy_->getRouterOptions().hot_key_cache_size != 0) {
+    const auto& opts = proxy_->getRouterOptions();
+    std::string snapshotPath;
+    if (opts.hot_key_cache_snapshot_interval_ms > 0 &&
+        !opts.async_spool.empty()) {
+      snapshotPath = folly::sformat(
+          "{}/hot-key-cache.{}.snapshot", opts.async_spool, proxy_->getId());
+    }
+    /* Outermost, so the hottest gets skip the whole tree below. */
+    root_ = makeHotKeyCacheRoute(
+        std::move(root_),
+        opts.hot_key_cache_size,
+        std::chrono::milliseconds(opts.hot_key_cache_ttl_ms),
+        std::move(snapshotPath),
+        std::chrono::milliseconds(opts.hot_key_cache_snapshot_interval_ms));
+  }
 }
 
 std::vector<McrouterRouteHandlePtr> ProxyRoute::getAllDestinations() const {
@@ -40,6 +40,14 @@ class ProxyRoute {
 
   ProxyRoute(proxy_t* proxy, const RouteSelectorMap& routeSelectors);
 
+  bool mayBlock() const {
+    return root_->mayBlock();
+  }
+
+  size_t maxDepth() const {
+    return root_->maxDepth();
+  }
+
   template <class Request>
   void traverse(const Request& req,
                 const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
@@ -51,6 +59,12 @@ class ProxyRoute {
     return root_->route(req);
   }
 
+  template <class Request>
+  std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) const {
+    return root_->routeBatch(reqs);
+  }
+
   TypedThriftReply<cpp2::McFlushAllReply> route(
       const TypedThriftRequest<cpp2::McFlushAllRequest>& req) const {
     // route to all destinations in the config.
@@ -54,6 +54,34 @@ class RateLimitRoute {
     return ReplyT<Request>(DefaultReply, req);
   }
 
+  /**
+   * Routes a whole batch (e.g. a multiget fan-out) with a single permit
+   * grab instead of one token bucket operation per request.  If only
+   * part of the batch is admitted, the first admitted requests are
+   * routed and the rest get the same reply route() uses for a rejection.
+   *
+   * @return replies in the same order as the requests.
+   */
+  template <class Request>
+  std::vector<ReplyT<Request>> routeBatch(
+      const std::vector<const Request*>& reqs) {
+    const size_t admitted = rl_.canPassThroughN<Request>(reqs.size());
+    if (LIKELY(admitted == reqs.size())) {
+      return target_->routeBatch(reqs);
+    }
+    std::vector<ReplyT<Request>> replies;
+    replies.reserve(reqs.size());
+    if (admitted > 0) {
+      std::vector<const Request*> passed(reqs.begin(),
+                                         reqs.begin() + admitted);
+      replies = target_->routeBatch(passed);
+    }
+    for (size_t i = admitted; i < reqs.size(); ++i) {
+      replies.emplace_back(DefaultReply, *reqs[i]);
+    }
+    return replies;
+  }
+
  private:
   McrouterRouteHandlePtr target_;
   RateLimiter rl_;
@@ -9,7 +9,9 @@
  */
 #include "RateLimiter.h"
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <folly/Conv.h>
@@ -42,6 +44,27 @@ double asPositiveDoubleDefault(const dynamic& obj, const string& keyName,
   return def;
 }
 
+/**
+ * Returns the shared bucket for a named parent budget, creating it on
+ * first reference.  Buckets are owned by the RateLimiters referencing
+ * them; the registry keeps weak references so that budgets dropped from
+ * every config die with the last old config.
+ */
+std::shared_ptr<DynamicAtomicTokenBucket> parentBucket(const string& name) {
+  static std::mutex lock;
+  static std::unordered_map<
+      string, std::weak_ptr<DynamicAtomicTokenBucket>> buckets;
+
+  std::lock_guard<std::mutex> lg(lock);
+  auto& entry = buckets[name];
+  if (auto bucket = entry.lock()) {
+    return bucket;
+  }
+  auto bucket = std::make_shared<DynamicAtomicTokenBucket>();
+  entry = bucket;
+  return bucket;
+}
+
 } // anonymous
 
 RateLimiter::RateLimiter(const folly::dynamic& json) {
@@ -49,39 +72,69 @@ RateLimiter::RateLimiter(const folly::dynamic& json) {
 
   auto now = TokenBucket::defaultClockNow();
 
-  if (json.count("gets_rate")) {
-    double rate = asPositiveDouble(json, "gets_rate");
-    double burst = asPositiveDoubleDefault(json, "gets_burst", rate);
-    getsTb_ = TokenBucket(rate, burst, now);
+  configureOp(json, "gets", now, gets_);
+  configureOp(json, "sets", now, sets_);
+  configureOp(json, "deletes", now, deletes_);
+}
+
+void RateLimiter::configureOp(const folly::dynamic& json,
+                              const std::string& prefix,
+                              double nowInSeconds,
+                              OpLimit& limit) {
+  auto rateKey = prefix + "_rate";
+  if (json.count(rateKey)) {
+    double rate = asPositiveDouble(json, rateKey);
+    double burst = asPositiveDoubleDefault(json, prefix + "_burst", rate);
+    limit.bucket = TokenBucket(rate, burst, nowInSeconds);
   }
 
-  if (json.count("sets_rate")) {
-    double rate = asPositiveDouble(json, "sets_rate");
-    double burst = asPositiveDoubleDefault(json, "sets_burst", rate);
-    setsTb_ = TokenBucket(rate, burst, now);
+  auto parentKey = prefix + "_parent";
+  if (json.count(parentKey)) {
+    checkLogic(json[parentKey].isString(), "{} is not a string", parentKey);
+    std::string name = json[parentKey].getString();
+    checkLogic(!name.empty(), "{} is empty", parentKey);
+    auto parentRateKey = prefix + "_parent_rate";
+    checkLogic(json.count(parentRateKey),
+               "{} requires {}", parentKey, parentRateKey);
+    double rate = asPositiveDouble(json, parentRateKey);
+    double burst =
+        asPositiveDoubleDefault(json, prefix + "_parent_burst", rate);
+    limit.parent =
+        ParentBudget{parentBucket(name), rate, burst, std::move(name)};
   }
 
-  if (json.count("deletes_rate")) {
-    double rate = asPositiveDouble(json, "deletes_rate");
-    double burst = asPositiveDoubleDefault(json, "deletes_burst", rate);
-    deletesTb_ = TokenBucket(rate, burst, now);
+  auto windowLimitKey = prefix + "_window_limit";
+  if (json.count(windowLimitKey)) {
+    double windowLimit = asPositiveDouble(json, windowLimitKey);
+    double windowMs =
+        asPositiveDoubleDefault(json, prefix + "_window_ms", 1000.0);
+    limit.shaper =
+        SlidingWindowShaper(windowLimit, windowMs / 1000.0, nowInSeconds);
   }
 }
 
 std::string RateLimiter::toDebugStr() const {
   std::vector<string> pieces;
-  if (getsTb_) {
-    pieces.push_back(folly::to<string>("gets_rate=", getsTb_->rate()));
-    pieces.push_back(folly::to<string>("gets_burst=", getsTb_->burst()));
-  }
-  if (setsTb_) {
-    pieces.push_back(folly::to<string>("sets_rate=", setsTb_->rate()));
-    pieces.push_back(folly::to<string>("sets_burst=", setsTb_->burst()));
-  }
-  if (deletesTb_) {
-    pieces.push_back(folly::to<string>("deletes_rate=", deletesTb_->rate()));
-    pieces.push_back(folly::to<string>("deletes_burst=", deletesTb_->burst()));
-  }
+  auto append = [&pieces](const string& prefix, const OpLimit& limit) {
+    if (limit.bucket) {
+      pieces.push_back(
+          folly::to<string>(prefix, "_rate=", limit.bucket->rate()));
+      pieces.push_back(
+          folly::to<string>(prefix, "_burst=", limit.bucket->burst()));
+    }
+    if (limit.parent) {
+      pieces.push_back(folly::to<string>(
+          prefix, "_parent=", limit.parent->name, ":", limit.parent->rate));
+    }
+    if (limit.shaper) {
+      pieces.push_back(folly::to<string>(
+          prefix, "_window=", limit.shaper->limit(), "/",
+          limit.shaper->windowSec() * 1000, "ms"));
+    }
+  };
+  append("gets", gets_);
+  append("sets", sets_);
+  append("deletes", deletes_);
   return folly::join('|', pieces);
 }
 
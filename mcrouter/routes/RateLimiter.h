@@ -9,8 +9,14 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+
 #include <folly/Optional.h>
 
+#include "mcrouter/AtomicTokenBucket.h"
 #include "mcrouter/lib/McOperationTraits.h"
 #include "mcrouter/lib/network/ThriftMessageTraits.h"
 #include "mcrouter/TokenBucket.h"
@@ -21,6 +27,68 @@ struct dynamic;
 
 namespace facebook { namespace memcache { namespace mcrouter {
 
+/**
+ * Caps the number of admitted requests in a sliding time window.
+ * Implemented as a weighted two-window counter: the previous window's
+ * count decays linearly as the current window fills, approximating a
+ * true sliding window without keeping per-request timestamps.
+ */
+class SlidingWindowShaper {
+ public:
+  SlidingWindowShaper(double limit, double windowSec, double nowInSeconds)
+      : limit_(limit),
+        windowSec_(windowSec),
+        windowStart_(nowInSeconds) {
+    assert(limit_ >= 1);
+    assert(windowSec_ > 0);
+  }
+
+  bool allow(double nowInSeconds) {
+    return allowN(1, nowInSeconds) == 1;
+  }
+
+  /**
+   * Batch form of allow(): admits as many of n requests as the window
+   * has room for.
+   *
+   * @return the number of requests admitted, in [0, n].
+   */
+  size_t allowN(size_t n, double nowInSeconds) {
+    if (nowInSeconds >= windowStart_ + 2 * windowSec_) {
+      /* Idle for over a full window: both windows are empty */
+      prevCount_ = 0.0;
+      curCount_ = 0.0;
+      windowStart_ = nowInSeconds;
+    } else if (nowInSeconds >= windowStart_ + windowSec_) {
+      prevCount_ = curCount_;
+      curCount_ = 0.0;
+      windowStart_ += windowSec_;
+    }
+    const double prevWeight =
+        1.0 - (nowInSeconds - windowStart_) / windowSec_;
+    const double room =
+        std::floor(limit_ - (prevCount_ * prevWeight + curCount_));
+    const double admitted = std::max(0.0, std::min<double>(n, room));
+    curCount_ += admitted;
+    return static_cast<size_t>(admitted);
+  }
+
+  double limit() const {
+    return limit_;
+  }
+
+  double windowSec() const {
+    return windowSec_;
+  }
+
+ private:
+  double limit_;
+  double windowSec_;
+  double windowStart_;
+  double prevCount_{0.0};
+  double curCount_{0.0};
+};
+
 /**
  * This is a container for TokenBucket rate limiters for different
  * operation types.
@@ -28,37 +96,51 @@ namespace facebook { namespace memcache { namespace mcrouter {
 class RateLimiter {
  public:
   /**
-   * @param json  Rate limiting configuration; must be an object. Format:
+   * @param json  Rate limiting configuration; must be an object. Format
+   *              (each line optional, shown for gets; sets/deletes take
+   *              the same keys with their own prefix):
    *
    *              { "gets_rate": GR, "gets_burst": GB,
-   *                "sets_rate": SR, "sets_burst": GB,
-   *                "deletes_rate": DR, "deletes_burst": DB }
+   *                "gets_parent": "NAME",
+   *                "gets_parent_rate": PR, "gets_parent_burst": PB,
+   *                "gets_window_limit": WL, "gets_window_ms": WM }
+   *
+   *              rate/burst are passed to the corresponding
+   *              TokenBucket's constructor; if *_rate is missing, no
+   *              per-handle bucket is created for that operation, and
+   *              if *_burst is missing, burst is set equal to rate.
    *
-   *              Where rate and burst parameters are passed to
-   *              the corresponding TokenBucket's constructor.
-   *              If some *_rate key is missing, no rate limiting is
-   *              performed for that operation.
-   *              If some *_burst key is missing, burst is set
-   *              equal to rate.
+   *              *_parent names a budget shared by every RateLimiter
+   *              referencing the same name, across pools and proxy
+   *              threads; a request must obtain a token from both its
+   *              own bucket and the parent's, so per-pool limits may
+   *              sum to more than the aggregate cap.  *_parent_rate is
+   *              required with *_parent (all configs naming one parent
+   *              should agree on it); *_parent_burst defaults to the
+   *              parent rate.
+   *
+   *              *_window_limit caps admissions within a sliding
+   *              *_window_ms window (default 1000), shaping bursts the
+   *              buckets would admit instantly.
    */
   explicit RateLimiter(const folly::dynamic& json);
 
   template <class Request>
   bool canPassThrough(GetLikeT<Request> = 0) {
-    return LIKELY(
-      !getsTb_ || getsTb_->consume(1.0, TokenBucket::defaultClockNow()));
+    return LIKELY(!gets_.configured() ||
+                  gets_.allow(TokenBucket::defaultClockNow()));
   }
 
   template <class Request>
   bool canPassThrough(UpdateLikeT<Request> = 0) {
-    return LIKELY(
-      !setsTb_ || setsTb_->consume(1.0, TokenBucket::defaultClockNow()));
+    return LIKELY(!sets_.configured() ||
+                  sets_.allow(TokenBucket::defaultClockNow()));
   }
 
   template <class Request>
   bool canPassThrough(DeleteLikeT<Request> = 0) {
-    return LIKELY(
-      !deletesTb_ || deletesTb_->consume(1.0, TokenBucket::defaultClockNow()));
+    return LIKELY(!deletes_.configured() ||
+                  deletes_.allow(TokenBucket::defaultClockNow()));
   }
 
   template <class Request>
@@ -69,15 +151,124 @@ class RateLimiter {
     return true;
   }
 
+  /**
+   * Batch form of canPassThrough() for multi-op requests: obtains
+   * permits for n same-type requests with one pass over the configured
+   * gates, so a 500-key multiget costs one atomic operation on a shared
+   * parent budget instead of 500.
+   *
+   * @return the number of requests admitted, in [0, n]; the caller
+   *         should admit the first that many requests of its batch and
+   *         reject the rest.
+   */
+  template <class Request>
+  size_t canPassThroughN(size_t n, GetLikeT<Request> = 0) {
+    if (LIKELY(!gets_.configured())) {
+      return n;
+    }
+    return gets_.allowN(n, TokenBucket::defaultClockNow());
+  }
+
+  template <class Request>
+  size_t canPassThroughN(size_t n, UpdateLikeT<Request> = 0) {
+    if (LIKELY(!sets_.configured())) {
+      return n;
+    }
+    return sets_.allowN(n, TokenBucket::defaultClockNow());
+  }
+
+  template <class Request>
+  size_t canPassThroughN(size_t n, DeleteLikeT<Request> = 0) {
+    if (LIKELY(!deletes_.configured())) {
+      return n;
+    }
+    return deletes_.allowN(n, TokenBucket::defaultClockNow());
+  }
+
+  template <class Request>
+  size_t canPassThroughN(size_t n,
+                         OtherThanT<Request,
+                                    GetLike<>,
+                                    UpdateLike<>,
+                                    DeleteLike<>> = 0) {
+    return n;
+  }
+
   /**
    * String representation useful for debugging
    */
   std::string toDebugStr() const;
 
  private:
-  folly::Optional<TokenBucket> getsTb_;
-  folly::Optional<TokenBucket> setsTb_;
-  folly::Optional<TokenBucket> deletesTb_;
+  /**
+   * A share of a named parent budget.  The bucket only stores its fill
+   * level; rate and burst come from each referencing config at consume
+   * time, so reconfigured values take effect without resetting it.
+   */
+  struct ParentBudget {
+    std::shared_ptr<DynamicAtomicTokenBucket> bucket;
+    double rate;
+    double burst;
+    std::string name;
+  };
+
+  /**
+   * All limits configured for one operation type.
+   */
+  struct OpLimit {
+    folly::Optional<TokenBucket> bucket;
+    folly::Optional<ParentBudget> parent;
+    folly::Optional<SlidingWindowShaper> shaper;
+
+    bool configured() const {
+      return bucket || parent || shaper;
+    }
+
+    /* Gates are consumed in order; tokens taken before a later gate
+       rejects are deliberately not refunded. */
+    bool allow(double nowInSeconds) {
+      if (bucket && !bucket->consume(1.0, nowInSeconds)) {
+        return false;
+      }
+      /* The shared bucket runs on its own (steady) clock */
+      if (parent &&
+          !parent->bucket->consume(1.0, parent->rate, parent->burst)) {
+        return false;
+      }
+      if (shaper && !shaper->allow(nowInSeconds)) {
+        return false;
+      }
+      return true;
+    }
+
+    /* Batch form of allow(): admits as many of n requests as every gate
+       allows, draining each bucket once instead of once per request. */
+    size_t allowN(size_t n, double nowInSeconds) {
+      double admitted = n;
+      if (bucket) {
+        admitted = std::floor(bucket->consumeOrDrain(admitted, nowInSeconds));
+      }
+      /* The shared bucket runs on its own (steady) clock */
+      if (parent && admitted >= 1.0) {
+        admitted = std::floor(parent->bucket->consumeOrDrain(
+            admitted, parent->rate, parent->burst));
+      }
+      if (shaper && admitted >= 1.0) {
+        admitted = shaper->allowN(static_cast<size_t>(admitted),
+                                  nowInSeconds);
+      }
+      return static_cast<size_t>(admitted);
+    }
+  };
+
+  void configureOp(const folly::dynamic& json,
+                   const std::string& prefix,
+                   double nowInSeconds,
+                   OpLimit& limit);
+
+  OpLimit gets_;
+  OpLimit sets_;
+  OpLimit deletes_;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -187,27 +187,41 @@ RouteHandleMap::getTargetsForKeyFast(folly::StringPiece prefix,
   if (prefix.empty()) {
     // empty prefix => route to default route
     result = &defaultRouteMap_->getTargetsForKey(key);
-  } else if (prefix == "/*/*/") {
-    // route to all routes
-    result = &allRoutes_->getTargetsForKey(key);
   } else {
-    auto starPos = prefix.find("*");
-    if (starPos == std::string::npos) {
-      // no stars at all
-      auto it = byRoute_.find(prefix);
-      if (it != byRoute_.end()) {
-        result = &it->second->getTargetsForKey(key);
-      } else {
-        // cluster in question isn't in config, try the fallback
-        result = getTargetsForKeyFallback(prefix, key);
+    // Non-empty prefixes resolve through the per-thread interning cache;
+    // repeat prefixes cost one hash probe instead of pattern scans and
+    // map lookups.
+    auto& cache = *prefixCache_;
+    auto hash = folly::hash::fnv64_buf(prefix.data(), prefix.size());
+    const PrefixCache::Entry* found = nullptr;
+    PrefixCache::Entry* evict = nullptr;
+    for (size_t probe = 0; probe < PrefixCache::kMaxProbes; ++probe) {
+      auto& e = cache.slots[(hash + probe) & (PrefixCache::kSlots - 1)];
+      if (e.prefix.empty()) {
+        evict = &e;
+        break;
+      }
+      if (prefix == e.prefix) {
+        found = &e;
+        break;
+      }
+      if (evict == nullptr) {
+        // on a full probe run, replace the first slot we looked at
+        evict = &e;
       }
-    } else if (prefix.endsWith("/*/") && starPos == prefix.size() - 2) {
-      // route to all clusters of some region (/region/*/)
-      auto region = prefix.subpiece(1, prefix.size() - 4);
-      auto it = byRegion_.find(region);
-      result = it == byRegion_.end()
-        ? &emptyV_
-        : &it->second->getTargetsForKey(key);
+    }
+    PrefixCache::Entry local;
+    if (found == nullptr) {
+      local = resolvePrefix(prefix);
+      if (evict != nullptr) {
+        *evict = local;
+      }
+      found = &local;
+    }
+    if (found->precalculated) {
+      result = found->policies
+        ? &found->policies->getTargetsForKey(key)
+        : &emptyV_;
     }
   }
   if (sendInvalidRouteToDefault_ && result != nullptr && result->empty()) {
@@ -216,12 +230,43 @@ RouteHandleMap::getTargetsForKeyFast(folly::StringPiece prefix,
   return result;
 }
 
-const std::vector<McrouterRouteHandlePtr>*
-RouteHandleMap::getTargetsForKeyFallback(folly::StringPiece prefix,
-                                         folly::StringPiece key) const {
+RouteHandleMap::PrefixCache::Entry
+RouteHandleMap::resolvePrefix(folly::StringPiece prefix) const {
+  PrefixCache::Entry entry;
+  entry.prefix = prefix.str();
+  if (prefix == "/*/*/") {
+    // route to all routes
+    entry.policies = allRoutes_.get();
+    entry.precalculated = true;
+    return entry;
+  }
+  auto starPos = prefix.find("*");
+  if (starPos == std::string::npos) {
+    // no stars at all
+    entry.precalculated = true;
+    auto it = byRoute_.find(prefix);
+    if (it != byRoute_.end()) {
+      entry.policies = it->second.get();
+    } else {
+      // cluster in question isn't in config, try the fallback
+      entry.policies = resolveFallback(prefix);
+    }
+  } else if (prefix.endsWith("/*/") && starPos == prefix.size() - 2) {
+    // route to all clusters of some region (/region/*/)
+    entry.precalculated = true;
+    auto region = prefix.subpiece(1, prefix.size() - 4);
+    auto it = byRegion_.find(region);
+    entry.policies = it == byRegion_.end() ? nullptr : it->second.get();
+  }
+  // otherwise: arbitrary glob, leave precalculated == false (slow path)
+  return entry;
+}
+
+const RoutePolicyMap*
+RouteHandleMap::resolveFallback(folly::StringPiece prefix) const {
   auto clusterStart = prefix.find('/', 1);
   if (clusterStart == std::string::npos) {
-    return &emptyV_;
+    return nullptr;
   }
 
   constexpr size_t kMaxBufLen = 128;
@@ -236,11 +281,9 @@ RouteHandleMap::getTargetsForKeyFallback(folly::StringPiece prefix,
                       kFallbackCluster);
   if (len > 0 && static_cast<size_t>(len) < kMaxBufLen) {
     auto it = byRoute_.find(folly::StringPiece(routingPrefixBuf, len));
-    return it == byRoute_.end()
-      ? &emptyV_
-      : &it->second->getTargetsForKey(key);
+    return it == byRoute_.end() ? nullptr : it->second.get();
   }
-  return &emptyV_;
+  return nullptr;
 }
 
 }}}  // facebook::memcache::mcrouter
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -17,6 +18,7 @@
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Portability.h>
 #include <folly/Range.h>
+#include <folly/ThreadLocal.h>
 
 #include "mcrouter/config.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
@@ -54,6 +56,24 @@ class RouteHandleMap {
     folly::StringPiece key) const;
 
  private:
+  /**
+   * Per-thread interning cache for non-empty routing prefixes, keyed by
+   * the raw prefix bytes.  The live set of distinct prefixes is tiny, so
+   * a small open-addressed table with linear probing turns the per-request
+   * pattern scan and map lookups into a single hash probe.
+   */
+  struct PrefixCache {
+    struct Entry {
+      std::string prefix;
+      const RoutePolicyMap* policies{nullptr};
+      /* false means the prefix needs the slow (arbitrary glob) path */
+      bool precalculated{false};
+    };
+    constexpr static size_t kSlots = 128;  // power of two
+    constexpr static size_t kMaxProbes = 4;
+    std::array<Entry, kSlots> slots;
+  };
+
   const std::vector<McrouterRouteHandlePtr> emptyV_;
   const RoutingPrefix& defaultRoute_;
   bool sendInvalidRouteToDefault_;
@@ -62,13 +82,19 @@ class RouteHandleMap {
   std::shared_ptr<RoutePolicyMap> allRoutes_;
   folly::StringKeyedUnorderedMap<std::shared_ptr<RoutePolicyMap>> byRegion_;
   folly::StringKeyedUnorderedMap<std::shared_ptr<RoutePolicyMap>> byRoute_;
+  mutable folly::ThreadLocal<PrefixCache> prefixCache_;
 
   void foreachRoutePolicy(folly::StringPiece prefix,
     std::function<void(const std::shared_ptr<RoutePolicyMap>&)> f) const;
 
-  FOLLY_NOINLINE const std::vector<McrouterRouteHandlePtr>*
-  getTargetsForKeyFallback(folly::StringPiece prefix,
-                           folly::StringPiece key) const;
+  /**
+   * Uncached part of getTargetsForKeyFast for non-empty prefixes.
+   */
+  FOLLY_NOINLINE PrefixCache::Entry
+  resolvePrefix(folly::StringPiece prefix) const;
+
+  FOLLY_NOINLINE const RoutePolicyMap*
+  resolveFallback(folly::StringPiece prefix) const;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -65,24 +65,26 @@ RoutePolicyMap::RoutePolicyMap(
     }
   }
 
-  ut_.emplace("", std::move(wildcards));
+  Trie<vector<McrouterRouteHandlePtr>> ut;
+  ut.emplace("", std::move(wildcards));
   // we iterate over keys in lexicographic order, so all prefixes of key will go
   // before key itself
   for (auto& it : t) {
-    auto existing = ut_.findPrefix(it.first);
+    auto existing = ut.findPrefix(it.first);
     // at least empty string should be there
-    assert(existing != ut_.end());
-    ut_.emplace(it.first, overrideItems(existing->second, it.second));
+    assert(existing != ut.end());
+    ut.emplace(it.first, overrideItems(existing->second, it.second));
   }
-  for (auto& it : ut_) {
+  for (auto& it : ut) {
     it.second = orderedUnique(it.second);
   }
+  ut_ = CompactTrie<vector<McrouterRouteHandlePtr>>(ut);
 }
 
 const vector<McrouterRouteHandlePtr>&
 RoutePolicyMap::getTargetsForKey(folly::StringPiece key) const {
   auto result = ut_.findPrefix(key);
-  return result == ut_.end() ? emptyV_ : result->second;
+  return result == nullptr ? emptyV_ : result->second;
 }
 
 }}}  // facebook::memcache::mcrouter
@@ -14,7 +14,7 @@
 
 #include <folly/Range.h>
 
-#include "mcrouter/lib/fbi/cpp/Trie.h"
+#include "mcrouter/lib/fbi/cpp/CompactTrie.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -59,12 +59,14 @@ class RoutePolicyMap {
  private:
   const std::vector<McrouterRouteHandlePtr> emptyV_;
   /**
-   * This Trie contains targets for each key prefix. It is built like this:
+   * This trie contains targets for each key prefix. It is built like this:
    * 1) targets for empty string are wildcards.
    * 2) targets for string of length n+1 S[0..n] are targets for S[0..n-1] with
    *    OperationSelectorRoutes for key prefix == S[0..n] overridden.
+   * It is assembled in a Trie and then compiled into a read-only
+   * CompactTrie, since after construction it is only queried.
    */
-  Trie<std::vector<McrouterRouteHandlePtr>> ut_;
+  CompactTrie<std::vector<McrouterRouteHandlePtr>> ut_;
 };
 
 }}}  // facebook::memcache::mcrouter
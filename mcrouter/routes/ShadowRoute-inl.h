@@ -11,13 +11,16 @@
 
 #include <folly/fibers/FiberManager.h>
 
+#include "mcrouter/awriter.h"
 #include "mcrouter/config-impl.h"
 #include "mcrouter/config.h"
 #include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/McOperation.h"
 #include "mcrouter/lib/network/AccessPoint.h"
 #include "mcrouter/lib/Operation.h"
+#include "mcrouter/McrouterInstance.h"
 #include "mcrouter/ProxyRequestContext.h"
+#include "mcrouter/stats.h"
 #include "mcrouter/routes/McrouterRouteHandle.h"
 #include "mcrouter/routes/ShadowRouteIf.h"
 #include "mcrouter/ShadowValidationData.h"
@@ -42,13 +45,15 @@ void ShadowRoute<ShadowPolicy>::sendAndValidateRequestGetImpl(
     std::shared_ptr<GetRequest> adjustedReq)
     const {
 
+  /* Snapshot the normal reply cheaply; clone() shares the value buffer.
+     Hashing and comparison happen on the shadow validation thread, so
+     neither costs request-fiber time. */
   uint64_t flags = normalReply.flags();
-
   mc_res_t result = normalReply.result();
-  size_t hashVal = folly::IOBufHash()(
-      normalReply.valuePtrUnsafe()
-        ? *normalReply.valuePtrUnsafe() : folly::IOBuf());
-
+  std::shared_ptr<folly::IOBuf> value;
+  if (normalReply.valuePtrUnsafe()) {
+    value = normalReply.valuePtrUnsafe()->clone();
+  }
   auto normalDest = normalReply.destination();
 
   folly::fibers::addTask(
@@ -56,7 +61,7 @@ void ShadowRoute<ShadowPolicy>::sendAndValidateRequestGetImpl(
      adjustedReq = std::move(adjustedReq),
      flags,
      result,
-     hashVal,
+     value = std::move(value),
      normalDest = std::move(normalDest)]() mutable {
       // we don't want to spool shadow request
       fiber_local::clearAsynclogName();
@@ -65,25 +70,49 @@ void ShadowRoute<ShadowPolicy>::sendAndValidateRequestGetImpl(
       auto shadowReply = shadow->route(*adjustedReq);
       uint64_t shadowFlags = shadowReply.flags();
       mc_res_t shadowResult = shadowReply.result();
-      size_t shadowHash = folly::IOBufHash()(
-          shadowReply.valuePtrUnsafe()
-            ? *shadowReply.valuePtrUnsafe() : folly::IOBuf());
-
-      if (shadowFlags != flags || shadowResult != result ||
-          hashVal != shadowHash) {
-
-        auto& proxy = fiber_local::getSharedCtx()->proxy();
-
-        ShadowValidationData validationData{McOperation<mc_op_get>().name,
-                                            normalDest.get(),
-                                            shadowReply.destination().get(),
-                                            flags,
-                                            shadowFlags,
-                                            result,
-                                            shadowResult,
-                                            adjustedReq->fullKey()};
-
-        logShadowValidationError(proxy, validationData);
+      std::shared_ptr<folly::IOBuf> shadowValue;
+      if (shadowReply.valuePtrUnsafe()) {
+        shadowValue = shadowReply.valuePtrUnsafe()->clone();
+      }
+      auto shadowDest = shadowReply.destination();
+
+      auto& proxy = fiber_local::getSharedCtx()->proxy();
+      auto validate =
+        [&proxy,
+         adjustedReq = std::move(adjustedReq),
+         flags,
+         result,
+         value = std::move(value),
+         normalDest = std::move(normalDest),
+         shadowFlags,
+         shadowResult,
+         shadowValue = std::move(shadowValue),
+         shadowDest = std::move(shadowDest)]() {
+          stat_incr_safe(proxy.stats, shadow_validation_samples_stat);
+          size_t hashVal =
+            folly::IOBufHash()(value ? *value : folly::IOBuf());
+          size_t shadowHash =
+            folly::IOBufHash()(shadowValue ? *shadowValue : folly::IOBuf());
+
+          if (shadowFlags != flags || shadowResult != result ||
+              hashVal != shadowHash) {
+            stat_incr_safe(proxy.stats, shadow_validation_mismatches_stat);
+
+            ShadowValidationData validationData{McOperation<mc_op_get>().name,
+                                                normalDest.get(),
+                                                shadowDest.get(),
+                                                flags,
+                                                shadowFlags,
+                                                result,
+                                                shadowResult,
+                                                adjustedReq->fullKey()};
+
+            logShadowValidationError(proxy, validationData);
+          }
+        };
+
+      if (!proxy.router().shadowValidationWriter().run(std::move(validate))) {
+        stat_incr_safe(proxy.stats, shadow_validation_dropped_stat);
       }
     });
 }
@@ -14,6 +14,7 @@
 #include <vector>
 
 #include <folly/fibers/FiberManager.h>
+#include <folly/Likely.h>
 #include <folly/Optional.h>
 
 #include "mcrouter/lib/Operation.h"
@@ -31,7 +32,8 @@ namespace facebook { namespace memcache { namespace mcrouter {
  *
  * Always sends the request to normalRoute.
  * In addition, asynchronously sends the same request to shadowRoutes if key
- * hash is within settings range
+ * hash is within settings range and the shadow sampling budget (if one is
+ * configured) has a token left.
  * Key range might be updated at runtime.
  * We can shadow to multiple shadow destinations for a given normal route.
  */
@@ -98,9 +100,16 @@ class ShadowRoute {
 
   template <class Request>
   bool shouldShadow(const Request& req, ShadowSettings* settings) const {
+    /* Cheap gate first: a disabled shadow costs exactly this branch. */
+    if (LIKELY(!settings->enabled())) {
+      return false;
+    }
     auto range = settings->keyRange();
-    return range.first <= req.routingKeyHash() &&
-                          req.routingKeyHash() <= range.second;
+    if (req.routingKeyHash() < range.first ||
+        range.second < req.routingKeyHash()) {
+      return false;
+    }
+    return settings->consumeShadowBudget();
   }
 
   template <class Request>
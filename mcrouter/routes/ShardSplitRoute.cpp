@@ -26,16 +26,17 @@ std::string shardSplitSuffix(size_t offset) {
   return ret;
 }
 
-std::string createSplitKey(folly::StringPiece fullKey,
-                           size_t offset,
-                           folly::StringPiece shard) {
-  std::string newKey;
-  newKey.reserve(fullKey.size() + 2);
-  newKey.append(fullKey.begin(), shard.end());
-  newKey.push_back('a' + (offset % 26));
-  newKey.push_back('a' + (offset / 26));
-  newKey.append(shard.end(), fullKey.end());
-  return newKey;
+folly::IOBuf createSplitKey(folly::StringPiece fullKey,
+                            size_t offset,
+                            folly::StringPiece shard) {
+  const char suffix[2] = {
+    static_cast<char>('a' + (offset % 26)),
+    static_cast<char>('a' + (offset / 26))
+  };
+  return concatPieces(
+    {folly::StringPiece(fullKey.begin(), shard.end()),
+     folly::StringPiece(suffix, sizeof(suffix)),
+     folly::StringPiece(shard.end(), fullKey.end())});
 }
 
 }}}  // facebook::memcache::mcrouter
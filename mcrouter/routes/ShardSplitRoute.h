@@ -19,6 +19,7 @@
 
 #include "mcrouter/config.h"
 #include "mcrouter/lib/fbi/cpp/globals.h"
+#include "mcrouter/lib/IOBufUtil.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/Operation.h"
 #include "mcrouter/lib/OperationTraits.h"
@@ -50,9 +51,9 @@ std::string shardSplitSuffix(size_t offset);
  *              and can be obtained via getShardId().
  * @return A new key which routes to the n'th shard split for 'shard'.
  */
-std::string createSplitKey(folly::StringPiece fullKey,
-                           size_t offset,
-                           folly::StringPiece shard);
+folly::IOBuf createSplitKey(folly::StringPiece fullKey,
+                            size_t offset,
+                            folly::StringPiece shard);
 
 /**
  * Splits given request according to shard splits provided by ShardSplitter
@@ -144,9 +145,7 @@ class ShardSplitRoute {
   template <class Request>
   Request splitReq(const Request& req, size_t offset,
                    folly::StringPiece shard) const {
-    auto reqCopy = req.clone();
-    reqCopy.setKey(createSplitKey(req.fullKey(), offset, shard));
-    return reqCopy;
+    return req.cloneWithKey(createSplitKey(req.fullKey(), offset, shard));
   }
 };
 
@@ -9,7 +9,10 @@
  */
 #include "ShardSplitter.h"
 
+#include <algorithm>
+
 #include <folly/dynamic.h>
+#include <folly/Likely.h>
 
 #include "mcrouter/routes/ShardHashFunc.h"
 
@@ -17,6 +20,33 @@ namespace facebook { namespace memcache { namespace mcrouter {
 
 constexpr size_t kMaxSplits = 26 * 26;
 
+namespace {
+
+/**
+ * Parses an all-digit shard id. Ids too long for uint64_t are treated as
+ * non-numeric and go through the string map.
+ */
+bool parseShardId(folly::StringPiece shard, uint64_t& id) {
+  if (shard.empty() || shard.size() > 19) {
+    return false;
+  }
+  if (shard.size() > 1 && shard[0] == '0') {
+    // Leading zeros: don't let "01" and "1" collide, keep exact string
+    // matching for such ids.
+    return false;
+  }
+  id = 0;
+  for (auto c : shard) {
+    if (!isdigit(c)) {
+      return false;
+    }
+    id = id * 10 + (c - '0');
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
 ShardSplitter::ShardSplitter(const folly::dynamic& json) {
   if (!json.isObject()) {
     return;
@@ -41,6 +71,15 @@ ShardSplitter::ShardSplitter(const folly::dynamic& json) {
       shardSplits_.emplace(it.first.c_str(), splitCnt);
     }
   }
+
+  // Compile numeric ids into a sorted array for the per-request lookup.
+  for (const auto& it : shardSplits_) {
+    uint64_t id;
+    if (parseShardId(it.first, id)) {
+      numericShardSplits_.emplace_back(id, it.second);
+    }
+  }
+  std::sort(numericShardSplits_.begin(), numericShardSplits_.end());
 }
 
 size_t ShardSplitter::getShardSplitCnt(folly::StringPiece routingKey,
@@ -49,6 +88,17 @@ size_t ShardSplitter::getShardSplitCnt(folly::StringPiece routingKey,
     return 1;
   }
 
+  uint64_t id;
+  if (LIKELY(parseShardId(shard, id))) {
+    auto it = std::lower_bound(
+      numericShardSplits_.begin(), numericShardSplits_.end(),
+      std::make_pair(id, size_t(0)));
+    if (it == numericShardSplits_.end() || it->first != id) {
+      return 1;
+    }
+    return it->second;
+  }
+
   auto splitIt = shardSplits_.find(shard);
   if (splitIt == shardSplits_.end()) {
     return 1;
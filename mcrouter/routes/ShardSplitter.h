@@ -9,6 +9,9 @@
  */
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/Range.h>
 
@@ -38,6 +41,10 @@ class ShardSplitter {
   }
  private:
   folly::StringKeyedUnorderedMap<size_t> shardSplits_;
+  // Numeric shard ids (in practice all of them) compiled into a sorted
+  // flat array at config time, so the per-request lookup is a binary
+  // search over ids instead of hashing the shard string.
+  std::vector<std::pair<uint64_t, size_t>> numericShardSplits_;
 };
 
 }}}  // facebook::memcache::mcrouter
@@ -59,6 +59,15 @@ namespace facebook { namespace memcache { namespace mcrouter {
  * To summarize, if a server is being warmed up, the percentage of requests to
  * send to server is calculated by the formula:
  *    start + (step * hitRate)
+ *
+ * Alternatively, setting "adaptive" to true replaces the fixed schedule with
+ * a feedback controller driven by the destination's observed hit rate: every
+ * "adapt_period" replies from the warming destination, the fraction of
+ * requests sent to it is adjusted proportionally to how far the recent hit
+ * rate is above or below "enable_threshold" ("gain_p"), plus an integral
+ * term ("gain_i") that keeps ramping while the destination absorbs the extra
+ * traffic and backs off when the hit rate dips. This warms a cold box as
+ * fast as it can fill without hand-tuning start/step per pool.
  */
 template <class RouteHandleIf>
 class SlowWarmUpRoute {
@@ -104,8 +113,14 @@ class SlowWarmUpRoute {
     auto reply = target_->route(req);
     if (reply.isHit()) {
       ++stats_.hits;
+      ++stats_.windowHits;
     } else if (reply.isMiss()) {
       ++stats_.misses;
+      ++stats_.windowMisses;
+    }
+    if (settings_->adaptive() && stats_.enabled &&
+        stats_.windowHits + stats_.windowMisses >= settings_->adaptPeriod()) {
+      updateFraction();
     }
     return std::move(reply);
   }
@@ -114,6 +129,9 @@ class SlowWarmUpRoute {
   struct WarmUpStats {
     uint64_t hits{0};
     uint64_t misses{0};
+    /* Replies since the last controller update */
+    uint64_t windowHits{0};
+    uint64_t windowMisses{0};
     bool enabled{false};
   };
 
@@ -121,16 +139,55 @@ class SlowWarmUpRoute {
   const std::shared_ptr<RouteHandleIf> failoverTarget_;
   const std::shared_ptr<SlowWarmUpRouteSettings> settings_;
   mutable WarmUpStats stats_;
+  /* Adaptive controller state: current fraction of requests sent to the
+     warming destination and the accumulated integral term. */
+  mutable double fraction_{0.0};
+  mutable double integral_{0.0};
 
   bool warmingUp() const {
+    bool wasEnabled = stats_.enabled;
     if (stats_.enabled) {
       stats_.enabled = hitRate() < settings_->disableThreshold();
     } else {
       stats_.enabled = hitRate() < settings_->enableThreshold();
     }
+    if (stats_.enabled && !wasEnabled) {
+      /* Entering warmup: start the controller from scratch */
+      fraction_ = settings_->start();
+      integral_ = 0.0;
+      stats_.windowHits = 0;
+      stats_.windowMisses = 0;
+    }
     return stats_.enabled;
   }
 
+  /**
+   * One step of the feedback controller: compares the hit rate observed
+   * over the last adaptPeriod() replies against the enable threshold and
+   * moves the fraction of traffic sent to the warming destination
+   * accordingly. The integral term is back-calculated when the output
+   * saturates so it can't wind up beyond the [start, 1] clamp.
+   */
+  void updateFraction() const {
+    const uint64_t total = stats_.windowHits + stats_.windowMisses;
+    const double recentRate = stats_.windowHits / static_cast<double>(total);
+    stats_.windowHits = 0;
+    stats_.windowMisses = 0;
+
+    const double error = recentRate - settings_->enableThreshold();
+    integral_ += error;
+    double fraction = settings_->start() +
+        settings_->gainP() * error + settings_->gainI() * integral_;
+    if (fraction > 1.0) {
+      integral_ -= (fraction - 1.0) / settings_->gainI();
+      fraction = 1.0;
+    } else if (fraction < settings_->start()) {
+      integral_ += (settings_->start() - fraction) / settings_->gainI();
+      fraction = settings_->start();
+    }
+    fraction_ = fraction;
+  }
+
   double hitRate() const {
     uint64_t total = stats_.hits + stats_.misses;
     if (total < settings_->minRequests()) {
@@ -141,7 +198,9 @@ class SlowWarmUpRoute {
 
   template <class RNG>
   bool shouldSendRequest(RNG& rng) const {
-    double target = settings_->start() + (hitRate() * settings_->step());
+    double target = settings_->adaptive()
+        ? fraction_
+        : settings_->start() + (hitRate() * settings_->step());
     return std::generate_canonical<double,
            std::numeric_limits<double>::digits>(rng) <= target;
   }
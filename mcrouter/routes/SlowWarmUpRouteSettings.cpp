@@ -72,6 +72,41 @@ SlowWarmUpRouteSettings::SlowWarmUpRouteSettings(const folly::dynamic& json) {
         "SlowWarmUpSettings: '{}' must be an integer greater than 0",
         minReqsName);
   }
+
+  const std::string adaptiveName = "adaptive";
+  if (auto adaptivePtr = json.get_ptr(adaptiveName)) {
+    checkLogic(adaptivePtr->isBool(),
+        "SlowWarmUpSettings: '{}' must be a boolean, but was {}",
+        adaptiveName, adaptivePtr->typeName());
+    adaptive_ = adaptivePtr->getBool();
+  }
+
+  const std::string gainPName = "gain_p";
+  if (auto gainPPtr = json.get_ptr(gainPName)) {
+    gainP_ = asNumber(gainPPtr, gainPName);
+    checkLogic(gainP_ > 0.0,
+        "SlowWarmUpSettings: '{}' must be greater than 0, but was {}",
+        gainPName, gainP_);
+  }
+
+  const std::string gainIName = "gain_i";
+  if (auto gainIPtr = json.get_ptr(gainIName)) {
+    gainI_ = asNumber(gainIPtr, gainIName);
+    checkLogic(gainI_ > 0.0,
+        "SlowWarmUpSettings: '{}' must be greater than 0, but was {}",
+        gainIName, gainI_);
+  }
+
+  const std::string adaptPeriodName = "adapt_period";
+  if (auto adaptPeriodPtr = json.get_ptr(adaptPeriodName)) {
+    checkLogic(adaptPeriodPtr->isInt(),
+        "SlowWarmUpSettings: '{}' must be an integer, but was {}",
+        adaptPeriodName, adaptPeriodPtr->typeName());
+    adaptPeriod_ = adaptPeriodPtr->getInt();
+    checkLogic(adaptPeriod_ > 0,
+        "SlowWarmUpSettings: '{}' must be an integer greater than 0",
+        adaptPeriodName);
+  }
 }
 
 }}} // facebook::memcache::mcrouter
@@ -32,6 +32,20 @@ class SlowWarmUpRouteSettings {
       step_(stepPercent),
       minRequests_(minReqs) { }
 
+  SlowWarmUpRouteSettings(double enableTs, double disableTs,
+                          double startFraction, double stepPercent,
+                          size_t minReqs,
+                          double gainP, double gainI, size_t adaptPeriod)
+    : enableThreshold_(enableTs),
+      disableThreshold_(disableTs),
+      start_(startFraction),
+      step_(stepPercent),
+      minRequests_(minReqs),
+      adaptive_(true),
+      gainP_(gainP),
+      gainI_(gainI),
+      adaptPeriod_(adaptPeriod) { }
+
   double enableThreshold() const {
     return enableThreshold_;
   }
@@ -50,6 +64,19 @@ class SlowWarmUpRouteSettings {
     return minRequests_;
   }
 
+  bool adaptive() const {
+    return adaptive_;
+  }
+  double gainP() const {
+    return gainP_;
+  }
+  double gainI() const {
+    return gainI_;
+  }
+  size_t adaptPeriod() const {
+    return adaptPeriod_;
+  }
+
  private:
   // Threshold to start warming up.
   double enableThreshold_{0.7};
@@ -63,6 +90,18 @@ class SlowWarmUpRouteSettings {
 
   // Mininum number of requests to start computing hit rate.
   size_t minRequests_{100};
+
+  // If true, the fraction of requests sent to the warming destination is
+  // adjusted by a feedback controller driven by its observed hit rate
+  // instead of the fixed start/step schedule.
+  bool adaptive_{false};
+  // Proportional gain of the controller.
+  double gainP_{0.5};
+  // Integral gain of the controller.
+  double gainI_{0.1};
+  // Number of replies from the warming destination between controller
+  // updates.
+  size_t adaptPeriod_{100};
 };
 
 }}} // facebook::memcache::mcrouter
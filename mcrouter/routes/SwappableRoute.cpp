@@ -0,0 +1,20 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "SwappableRoute.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeSwappableRoute(
+    std::shared_ptr<SwappableRouteTarget> target) {
+  return std::make_shared<McrouterRouteHandle<SwappableRoute>>(
+      std::move(target));
+}
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,113 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "mcrouter/lib/RouteHandleTraverser.h"
+#include "mcrouter/routes/McrouterRouteHandle.h"
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+/**
+ * Mutable target of a SwappableRoute, shared between the route handle
+ * in the tree and the registry on ProxyConfig so admin commands can
+ * redirect a pool without rebuilding the tree.
+ *
+ * Only the owning proxy thread reads or writes the target, so a plain
+ * shared_ptr assignment is the whole swap.
+ */
+class SwappableRouteTarget {
+ public:
+  SwappableRouteTarget(std::string poolName, McrouterRouteHandlePtr rh)
+      : poolName_(std::move(poolName)),
+        original_(std::move(rh)),
+        target_(original_) {
+  }
+
+  const std::string& poolName() const {
+    return poolName_;
+  }
+
+  McrouterRouteHandlePtr target() const {
+    return target_;
+  }
+
+  /**
+   * Name of the route currently receiving this pool's traffic.
+   */
+  std::string targetName() const {
+    return target_->routeName();
+  }
+
+  /**
+   * Redirects the pool's traffic to rh.
+   */
+  void swap(McrouterRouteHandlePtr rh) {
+    target_ = std::move(rh);
+  }
+
+  /**
+   * Restores the subtree built from the config.
+   */
+  void reset() {
+    target_ = original_;
+  }
+
+ private:
+  const std::string poolName_;
+  const McrouterRouteHandlePtr original_;
+  McrouterRouteHandlePtr target_;
+};
+
+/**
+ * Wraps a pool's route subtree so its target can be replaced at
+ * runtime through the "pool_swap" service info command (e.g. blackhole
+ * a misbehaving pool or redirect it to another one) without paying for
+ * a full reconfig.  Inserted around every PoolRoute when
+ * --enable-pool-route-swap is set.
+ *
+ * Since the target may change at runtime, this route can't bound its
+ * subtree's depth or blocking behavior, so trees containing it always
+ * route on full-size fibers.
+ */
+class SwappableRoute {
+ public:
+  explicit SwappableRoute(std::shared_ptr<SwappableRouteTarget> target)
+      : target_(std::move(target)) {
+  }
+
+  std::string routeName() const {
+    return "swappable|" + target_->poolName();
+  }
+
+  template <class Request>
+  void traverse(const Request& req,
+                const RouteHandleTraverser<McrouterRouteHandleIf>& t) const {
+    t(*target_->target(), req);
+  }
+
+  template <class Request>
+  ReplyT<Request> route(const Request& req) {
+    /* Keep a reference on the stack: a swap while this fiber is
+       suspended inside the subtree must not free it under us. */
+    auto rh = target_->target();
+    return rh->route(req);
+  }
+
+ private:
+  const std::shared_ptr<SwappableRouteTarget> target_;
+};
+
+McrouterRouteHandlePtr makeSwappableRoute(
+    std::shared_ptr<SwappableRouteTarget> target);
+
+}}}  // facebook::memcache::mcrouter
@@ -0,0 +1,148 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/test/RouteHandleTestUtil.h"
+#include "mcrouter/routes/test/RouteHandleTestUtil.h"
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::mcrouter;
+
+using std::make_shared;
+using std::vector;
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeAffinityRoute(
+    McrouterRouteHandlePtr read,
+    McrouterRouteHandlePtr write,
+    std::vector<McrouterRouteHandlePtr> replicas,
+    std::chrono::milliseconds window);
+
+}}}  // facebook::memcache::mcrouter
+
+namespace {
+
+size_t totalSawKeys(const vector<std::shared_ptr<TestHandle>>& handles) {
+  size_t total = 0;
+  for (const auto& h : handles) {
+    total += h->saw_keys.size();
+  }
+  return total;
+}
+
+}  // anonymous
+
+TEST(affinityRouteTest, recentWriteReadsPinned) {
+  auto readHandle = make_shared<TestHandle>(
+    GetRouteTestData(mc_res_found, "default"));
+  auto writeHandle = make_shared<TestHandle>(
+    UpdateRouteTestData(mc_res_stored));
+  vector<std::shared_ptr<TestHandle>> replicaHandles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  auto rh = makeAffinityRoute(get_route_handles({readHandle})[0],
+                              get_route_handles({writeHandle})[0],
+                              get_route_handles(replicaHandles),
+                              std::chrono::milliseconds(10000));
+
+  // No recent write: reads take the default read policy.
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(1, readHandle->saw_keys.size());
+  EXPECT_EQ(0, totalSawKeys(replicaHandles));
+
+  TypedThriftRequest<cpp2::McSetRequest> setReq("key");
+  setReq.setValue("value");
+  rh->route(setReq);
+  EXPECT_EQ(1, writeHandle->saw_keys.size());
+
+  // Freshly written: reads are pinned to one replica, chosen by key hash,
+  // and stick to it on every subsequent read.
+  std::string pinnedValue;
+  for (size_t i = 0; i < 10; ++i) {
+    auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+    if (i == 0) {
+      pinnedValue = reply.valueRangeSlow().str();
+    } else {
+      EXPECT_EQ(pinnedValue, reply.valueRangeSlow().str());
+    }
+  }
+  EXPECT_EQ(1, readHandle->saw_keys.size());
+  EXPECT_EQ(10, totalSawKeys(replicaHandles));
+  for (const auto& h : replicaHandles) {
+    EXPECT_TRUE(h->saw_keys.empty() || h->saw_keys.size() == 10);
+  }
+}
+
+TEST(affinityRouteTest, otherKeysKeepReadPolicy) {
+  auto readHandle = make_shared<TestHandle>(
+    GetRouteTestData(mc_res_found, "default"));
+  auto writeHandle = make_shared<TestHandle>(
+    UpdateRouteTestData(mc_res_stored));
+  vector<std::shared_ptr<TestHandle>> replicaHandles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b"))
+  };
+
+  mockFiberContext();
+  auto rh = makeAffinityRoute(get_route_handles({readHandle})[0],
+                              get_route_handles({writeHandle})[0],
+                              get_route_handles(replicaHandles),
+                              std::chrono::milliseconds(10000));
+
+  TypedThriftRequest<cpp2::McSetRequest> setReq("written");
+  setReq.setValue("value");
+  rh->route(setReq);
+
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("untouched"));
+  EXPECT_EQ(1, readHandle->saw_keys.size());
+  EXPECT_EQ(0, totalSawKeys(replicaHandles));
+}
+
+TEST(affinityRouteTest, affinityExpires) {
+  auto readHandle = make_shared<TestHandle>(
+    GetRouteTestData(mc_res_found, "default"));
+  auto writeHandle = make_shared<TestHandle>(
+    UpdateRouteTestData(mc_res_stored));
+  vector<std::shared_ptr<TestHandle>> replicaHandles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"))
+  };
+
+  mockFiberContext();
+  auto rh = makeAffinityRoute(get_route_handles({readHandle})[0],
+                              get_route_handles({writeHandle})[0],
+                              get_route_handles(replicaHandles),
+                              std::chrono::milliseconds(10));
+
+  TypedThriftRequest<cpp2::McSetRequest> setReq("key");
+  setReq.setValue("value");
+  rh->route(setReq);
+
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(1, replicaHandles[0]->saw_keys.size());
+
+  // Both filter generations rotate out after a full window.
+  std::this_thread::sleep_for(std::chrono::milliseconds(25));
+
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(1, replicaHandles[0]->saw_keys.size());
+  EXPECT_EQ(1, readHandle->saw_keys.size());
+}
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -203,3 +204,121 @@ TEST(BigValueRouteTest, bigvalue) {
     }
   });
 }
+
+TEST(BigValueRouteTest, bigvalueWindow) {
+  // with a bounded fetch window, all chunks are still fetched and merged
+  // in order.
+  const std::string rand_suffix_get = "123456";
+  const size_t num_chunks = 10;
+  const auto init_reply =
+    folly::sformat("{}-{}-{}", version, num_chunks, rand_suffix_get);
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(
+          mc_res_found, init_reply, MC_MSG_FLAG_BIG_VALUE))
+  };
+  auto route_handles = get_route_handles(test_handles);
+
+  TestFiberManager fm;
+  fm.runAll({
+    [&]() {
+      const BigValueRouteOptions windowOpts(threshold, /* batchSize= */ 3);
+      McrouterRouteHandle<BigValueRoute> rh(route_handles[0], windowOpts);
+
+      TypedThriftRequest<cpp2::McGetRequest> req_get("key_get");
+
+      auto f_get = rh.route(req_get);
+      auto keys_get = test_handles[0]->saw_keys;
+      EXPECT_EQ(num_chunks + 1, keys_get.size());
+      EXPECT_EQ("key_get", keys_get.front());
+
+      // every chunk key was fetched exactly once, whatever the order
+      std::sort(keys_get.begin() + 1, keys_get.end());
+      std::string merged_str;
+      for (size_t i = 0; i < num_chunks; i++) {
+        auto chunk_key = folly::sformat("key_get:{}:{}", i, rand_suffix_get);
+        EXPECT_TRUE(std::binary_search(keys_get.begin() + 1, keys_get.end(),
+                                       chunk_key));
+        merged_str.append(init_reply);
+      }
+
+      // chunks are reassembled in chunk order regardless of fetch order
+      EXPECT_EQ(merged_str, f_get.valueRangeSlow().str());
+    }
+  });
+}
+
+TEST(BigValueRouteTest, bigvalueDedup) {
+  const size_t num_chunks = 4;
+  const BigValueRouteOptions dedupOpts(
+    threshold, /* batchSize= */ 0, /* dedupChunks= */ true);
+  const std::string big_value(threshold * num_chunks, 'x');
+
+  TestFiberManager fm;
+  std::string metadata;
+
+  { // no previous version stored: all chunks are written
+    vector<std::shared_ptr<TestHandle>> test_handles{
+      make_shared<TestHandle>(GetRouteTestData(mc_res_notfound, ""),
+                              UpdateRouteTestData(mc_res_stored),
+                              DeleteRouteTestData(mc_res_deleted))
+    };
+    auto route_handles = get_route_handles(test_handles);
+
+    fm.runAll({
+      [&]() {
+        McrouterRouteHandle<BigValueRoute> rh(route_handles[0], dedupOpts);
+        TypedThriftRequest<cpp2::McSetRequest> req_set("key_set");
+        req_set.setValue(big_value);
+
+        auto f_set = rh.route(req_set);
+        EXPECT_EQ(mc_res_stored, f_set.result());
+        // old metadata lookup, chunk sets, new metadata set
+        EXPECT_EQ(num_chunks + 2, test_handles[0]->saw_keys.size());
+        EXPECT_EQ("get", test_handles[0]->sawOperations.front());
+        metadata = test_handles[0]->sawValues.back();
+      }
+    });
+  }
+
+  // Re-store against the metadata produced by the first write.
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(
+      GetRouteTestData(mc_res_found, metadata, MC_MSG_FLAG_BIG_VALUE),
+      UpdateRouteTestData(mc_res_stored),
+      DeleteRouteTestData(mc_res_deleted))
+  };
+  auto route_handles = get_route_handles(test_handles);
+
+  fm.runAll({
+    [&]() {
+      McrouterRouteHandle<BigValueRoute> rh(route_handles[0], dedupOpts);
+
+      { // identical value: every chunk hash matches, only metadata is written
+        TypedThriftRequest<cpp2::McSetRequest> req_set("key_set");
+        req_set.setValue(big_value);
+
+        auto f_set = rh.route(req_set);
+        EXPECT_EQ(mc_res_stored, f_set.result());
+        EXPECT_EQ(vector<std::string>({"key_set", "key_set"}),
+                  test_handles[0]->saw_keys);
+        EXPECT_EQ(metadata, test_handles[0]->sawValues.back());
+        test_handles[0]->saw_keys.clear();
+        test_handles[0]->sawValues.clear();
+      }
+
+      { // changing one chunk rewrites just that chunk plus the metadata
+        auto changed_value = big_value;
+        changed_value[0] = 'y';
+        TypedThriftRequest<cpp2::McSetRequest> req_set("key_set");
+        req_set.setValue(changed_value);
+
+        auto f_set = rh.route(req_set);
+        EXPECT_EQ(mc_res_stored, f_set.result());
+        // metadata get + one chunk set + metadata set
+        EXPECT_EQ(3, test_handles[0]->saw_keys.size());
+        EXPECT_EQ("key_set", test_handles[0]->saw_keys.back());
+        EXPECT_NE(metadata, test_handles[0]->sawValues.back());
+      }
+    }
+  });
+}
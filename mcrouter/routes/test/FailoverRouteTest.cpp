@@ -7,7 +7,9 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -37,6 +39,15 @@ makeFailoverRouteInOrder(std::vector<McrouterRouteHandlePtr> rh,
                          bool enableLeasePairing = false,
                          std::string name = "");
 
+McrouterRouteHandlePtr
+makeFailoverRouteInOrder(std::vector<McrouterRouteHandlePtr> rh,
+                         FailoverErrorsSettings failoverErrors,
+                         std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                         bool failoverTagging,
+                         bool enableLeasePairing,
+                         std::string name,
+                         std::chrono::milliseconds latchFailedNormal);
+
 McrouterRouteHandlePtr
 makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
                                FailoverErrorsSettings failoverErrors,
@@ -46,6 +57,15 @@ makeFailoverRouteLeastFailures(std::vector<McrouterRouteHandlePtr> rh,
                                std::string name,
                                const folly::dynamic& json);
 
+McrouterRouteHandlePtr
+makeFailoverRouteFastest(std::vector<McrouterRouteHandlePtr> rh,
+                         FailoverErrorsSettings failoverErrors,
+                         std::unique_ptr<FailoverRateLimiter> rateLimiter,
+                         bool failoverTagging,
+                         bool enableLeasePairing,
+                         std::string name,
+                         const folly::dynamic& json);
+
 }}}  // facebook::memcache::mcrouter
 
 TEST(failoverRouteTest, success) {
@@ -521,3 +541,106 @@ TEST(failoverRouteTest, leastFailuresComplex) {
   auto reply7 = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
   EXPECT_EQ("c", reply7.valueRangeSlow().str());
 }
+
+TEST(failoverRouteTest, fastestNoFailover) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  folly::dynamic json = folly::dynamic::object ("type", "FastestPolicy");
+  auto rh = makeFailoverRouteFastest(get_route_handles(test_handles),
+                                     FailoverErrorsSettings(),
+                                     nullptr,
+                                     /* failoverTagging */ false,
+                                     /* enableLeasePairing */ false,
+                                     "route01",
+                                     json);
+
+  auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ("a", reply.valueRangeSlow().str());
+}
+
+TEST(failoverRouteTest, fastestPrefersHealthyReplica) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "b")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "c"))
+  };
+
+  mockFiberContext();
+  folly::dynamic json = folly::dynamic::object ("type", "FastestPolicy");
+  auto rh = makeFailoverRouteFastest(get_route_handles(test_handles),
+                                     FailoverErrorsSettings(),
+                                     nullptr,
+                                     /* failoverTagging */ false,
+                                     /* enableLeasePairing */ false,
+                                     "route01",
+                                     json);
+
+  // No samples yet: children are tried in config order, so b gets hit once.
+  auto reply1 = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ("c", reply1.valueRangeSlow().str());
+  EXPECT_EQ(1, test_handles[1]->saw_keys.size());
+
+  // b's error inflated its score, so now we go straight to c.
+  auto reply2 = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ("c", reply2.valueRangeSlow().str());
+  EXPECT_EQ(1, test_handles[1]->saw_keys.size());
+  EXPECT_EQ(2, test_handles[2]->saw_keys.size());
+}
+
+TEST(failoverRouteTest, latchSkipsFailedNormal) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b"))
+  };
+
+  mockFiberContext();
+  auto rh = makeFailoverRouteInOrder(get_route_handles(test_handles),
+                                     FailoverErrorsSettings(),
+                                     nullptr,
+                                     /* failoverTagging */ false,
+                                     /* enableLeasePairing */ false,
+                                     "",
+                                     std::chrono::milliseconds(10000));
+
+  auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ("b", reply.valueRangeSlow().str());
+  EXPECT_EQ(1, test_handles[0]->saw_keys.size());
+
+  // The failed normal target is latched out: the next request goes
+  // straight to failover without probing it again.
+  reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ("b", reply.valueRangeSlow().str());
+  EXPECT_EQ(1, test_handles[0]->saw_keys.size());
+  EXPECT_EQ(2, test_handles[1]->saw_keys.size());
+}
+
+TEST(failoverRouteTest, latchCooldownExpires) {
+  std::vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_timeout, "a")),
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b"))
+  };
+
+  mockFiberContext();
+  auto rh = makeFailoverRouteInOrder(get_route_handles(test_handles),
+                                     FailoverErrorsSettings(),
+                                     nullptr,
+                                     /* failoverTagging */ false,
+                                     /* enableLeasePairing */ false,
+                                     "",
+                                     std::chrono::milliseconds(10));
+
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ(1, test_handles[0]->saw_keys.size());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(25));
+
+  // Cooldown is over and no destination is marked TKO, so the normal
+  // target gets probed again.
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+  EXPECT_EQ(2, test_handles[0]->saw_keys.size());
+}
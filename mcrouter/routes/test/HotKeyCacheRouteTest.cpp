@@ -0,0 +1,142 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <folly/experimental/TestUtil.h>
+#include <folly/FileUtil.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/test/RouteHandleTestUtil.h"
+#include "mcrouter/lib/test/TestRouteHandle.h"
+#include "mcrouter/routes/test/RouteHandleTestUtil.h"
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::mcrouter;
+
+using std::make_shared;
+using std::vector;
+
+namespace facebook { namespace memcache { namespace mcrouter {
+
+McrouterRouteHandlePtr makeHotKeyCacheRoute(McrouterRouteHandlePtr rh,
+                                            size_t maxEntries,
+                                            std::chrono::milliseconds ttl);
+
+McrouterRouteHandlePtr makeHotKeyCacheRoute(
+    McrouterRouteHandlePtr rh,
+    size_t maxEntries,
+    std::chrono::milliseconds ttl,
+    std::string snapshotPath,
+    std::chrono::milliseconds snapshotInterval);
+
+}}}  // facebook::memcache::mcrouter
+
+namespace {
+/* Matches HotKeyCacheRoute::kHotThreshold. */
+constexpr size_t kHotThreshold = 16;
+}  // anonymous
+
+TEST(hotKeyCacheRouteTest, hotKeyServedLocally) {
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"))
+  };
+
+  mockFiberContext();
+  auto rh = makeHotKeyCacheRoute(get_route_handles(test_handles)[0],
+                                 100,
+                                 std::chrono::milliseconds(1000));
+
+  // Until the key qualifies as hot, every get goes to the child.
+  for (size_t i = 0; i < kHotThreshold; ++i) {
+    auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+    EXPECT_EQ("a", reply.valueRangeSlow().str());
+  }
+  EXPECT_EQ(kHotThreshold, test_handles[0]->saw_keys.size());
+
+  // Now it's cached: the child doesn't see further gets.
+  auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ("a", reply.valueRangeSlow().str());
+  EXPECT_EQ(kHotThreshold, test_handles[0]->saw_keys.size());
+}
+
+TEST(hotKeyCacheRouteTest, writeInvalidates) {
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"),
+                            UpdateRouteTestData(mc_res_stored),
+                            DeleteRouteTestData(mc_res_deleted))
+  };
+
+  mockFiberContext();
+  auto rh = makeHotKeyCacheRoute(get_route_handles(test_handles)[0],
+                                 100,
+                                 std::chrono::milliseconds(1000));
+
+  for (size_t i = 0; i < kHotThreshold + 1; ++i) {
+    rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  }
+  EXPECT_EQ(kHotThreshold, test_handles[0]->saw_keys.size());
+
+  TypedThriftRequest<cpp2::McSetRequest> setReq("key");
+  setReq.setValue("value");
+  rh->route(setReq);
+  EXPECT_EQ(kHotThreshold + 1, test_handles[0]->saw_keys.size());
+
+  // The set invalidated the cached entry, so the next get hits the child.
+  rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(kHotThreshold + 2, test_handles[0]->saw_keys.size());
+}
+
+TEST(hotKeyCacheRouteTest, snapshotRestore) {
+  folly::test::TemporaryDirectory dir;
+  auto path = (dir.path() / "hot-key-cache.0.snapshot").string();
+  ASSERT_TRUE(folly::writeFile(
+      folly::StringPiece("hot-key-cache/1\nkey\n"), path.c_str()));
+
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"))
+  };
+
+  mockFiberContext();
+  auto rh = makeHotKeyCacheRoute(get_route_handles(test_handles)[0],
+                                 100,
+                                 std::chrono::milliseconds(1000),
+                                 path,
+                                 std::chrono::milliseconds(0));
+
+  // The restored key qualifies on its first hit: the child sees exactly
+  // one get and the second one is served locally.
+  for (size_t i = 0; i < 2; ++i) {
+    auto reply = rh->route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+    EXPECT_EQ("a", reply.valueRangeSlow().str());
+  }
+  EXPECT_EQ(1, test_handles[0]->saw_keys.size());
+}
+
+TEST(hotKeyCacheRouteTest, leaseGetBypasses) {
+  vector<std::shared_ptr<TestHandle>> test_handles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"))
+  };
+
+  mockFiberContext();
+  auto rh = makeHotKeyCacheRoute(get_route_handles(test_handles)[0],
+                                 100,
+                                 std::chrono::milliseconds(1000));
+
+  for (size_t i = 0; i < 2 * kHotThreshold; ++i) {
+    rh->route(TypedThriftRequest<cpp2::McLeaseGetRequest>("key"));
+  }
+  EXPECT_EQ(2 * kHotThreshold, test_handles[0]->saw_keys.size());
+}
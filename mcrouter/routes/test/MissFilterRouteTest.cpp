@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/lib/routes/MissFilterRoute.h"
+#include "mcrouter/lib/test/RouteHandleTestUtil.h"
+#include "mcrouter/lib/test/TestRouteHandle.h"
+
+using namespace facebook::memcache;
+
+using std::make_shared;
+using std::vector;
+
+using TestHandle = TestHandleImpl<TestRouteHandleIf>;
+
+namespace {
+constexpr size_t kFilterSizeBytes = 1024;
+}  // anonymous
+
+TEST(missFilterRouteTest, hitsPassThrough) {
+  auto child = make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"));
+
+  TestRouteHandle<MissFilterRoute<TestRouteHandleIf>> rh(
+    get_route_handles(vector<std::shared_ptr<TestHandle>>{child})[0],
+    kFilterSizeBytes,
+    std::chrono::seconds(60));
+
+  auto reply1 = rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ("a", reply1.valueRangeSlow().str());
+  auto reply2 = rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ("a", reply2.valueRangeSlow().str());
+  EXPECT_EQ(2, child->saw_keys.size());
+}
+
+TEST(missFilterRouteTest, repeatMissAnsweredLocally) {
+  auto child = make_shared<TestHandle>(GetRouteTestData(mc_res_notfound, ""));
+
+  TestRouteHandle<MissFilterRoute<TestRouteHandleIf>> rh(
+    get_route_handles(vector<std::shared_ptr<TestHandle>>{child})[0],
+    kFilterSizeBytes,
+    std::chrono::seconds(60));
+
+  auto reply1 = rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(mc_res_notfound, reply1.result());
+  EXPECT_EQ(1, child->saw_keys.size());
+
+  // The repeat miss doesn't reach the child.
+  auto reply2 = rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(mc_res_notfound, reply2.result());
+  EXPECT_EQ(1, child->saw_keys.size());
+}
+
+TEST(missFilterRouteTest, writeInvalidates) {
+  auto child = make_shared<TestHandle>(GetRouteTestData(mc_res_notfound, ""),
+                                       UpdateRouteTestData(mc_res_stored),
+                                       DeleteRouteTestData());
+
+  TestRouteHandle<MissFilterRoute<TestRouteHandleIf>> rh(
+    get_route_handles(vector<std::shared_ptr<TestHandle>>{child})[0],
+    kFilterSizeBytes,
+    std::chrono::seconds(60));
+
+  rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(1, child->saw_keys.size());
+
+  TypedThriftRequest<cpp2::McSetRequest> setReq("key");
+  setReq.setValue("value");
+  rh.route(setReq);
+  EXPECT_EQ(2, child->saw_keys.size());
+
+  // The set invalidated the cached miss, so the next get hits the child.
+  rh.route(TypedThriftRequest<cpp2::McGetRequest>("key"));
+  EXPECT_EQ(3, child->saw_keys.size());
+}
@@ -37,14 +37,58 @@ void sendRequest(folly::fibers::FiberManager& fm,
   auto context = getTestContext();
   context->setSenderIdForTest(senderId);
 
-  fm.addTask([&rh, id, context, &replyOrder]() {
+  fm.addTask([&rh, id, ctx = std::move(context), &replyOrder]() mutable {
       TypedThriftRequest<cpp2::McGetRequest> request(makeKey(id));
-      fiber_local::setSharedCtx(std::move(context));
+      fiber_local::setSharedCtx(std::move(ctx));
       rh.route(request);
       replyOrder.push_back(makeKey(id));
     });
 }
 
+TEST(oustandingLimitRouteTest, deadlineShed) {
+  auto normalHandle = std::make_shared<TestHandle>(
+    GetRouteTestData(mc_res_found, "a"));
+
+  McrouterRouteHandle<OutstandingLimitRoute> rh(
+    normalHandle->rh,
+    1);
+
+  normalHandle->pause();
+
+  TestFiberManager testfm{fiber_local::ContextTypeTag()};
+  auto& fm = testfm.getFiberManager();
+
+  std::vector<mc_res_t> results;
+  auto context = getTestContext();
+
+  fm.addTask([&rh, ctx = context.clone(), &results]() mutable {
+      TypedThriftRequest<cpp2::McGetRequest> request(makeKey(1));
+      fiber_local::setSharedCtx(std::move(ctx));
+      results.push_back(rh.route(request).result());
+    });
+  fm.addTask([&rh, ctx = context.clone(), &results]() mutable {
+      TypedThriftRequest<cpp2::McGetRequest> request(makeKey(2));
+      fiber_local::setSharedCtx(std::move(ctx));
+      // This request's client has already given up: the limit is reached,
+      // so it must be shed instead of queued.
+      fiber_local::setRequestDeadlineUs(nowUs() - 1);
+      results.push_back(rh.route(request).result());
+    });
+
+  auto& loopController =
+    dynamic_cast<folly::fibers::SimpleLoopController&>(fm.loopController());
+  loopController.loop([&]() {
+      fm.addTask([&]() {
+          normalHandle->unpause();
+        });
+      loopController.stop();
+    });
+
+  ASSERT_EQ(2, results.size());
+  EXPECT_EQ(mc_res_timeout, results[0]);
+  EXPECT_EQ(mc_res_found, results[1]);
+}
+
 TEST(oustandingLimitRouteTest, basic) {
   auto normalHandle = std::make_shared<TestHandle>(
     GetRouteTestData(mc_res_found, "a"));
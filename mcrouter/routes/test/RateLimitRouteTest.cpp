@@ -94,8 +94,72 @@ void testDeletes(bool burst = false) {
        "deletes", burst);
 }
 
+McrouterRouteHandle<RateLimitRoute> makeRh(
+    std::shared_ptr<TestHandle> handle, const std::string& jsonStr) {
+  vector<std::shared_ptr<TestHandle>> handles{std::move(handle)};
+  auto rh = get_route_handles(handles)[0];
+  return McrouterRouteHandle<RateLimitRoute>(
+      std::move(rh), RateLimiter(parseJsonString(jsonStr)));
+}
+
 } // anonymous
 
+TEST(rateLimitRouteTest, parentBudgetShared) {
+  /* Two handles with generous own limits share a parent budget that
+     only admits two deletes; the third is rejected whichever handle
+     it arrives on */
+  const std::string json =
+      "{\"deletes_rate\": 100.0,"
+      " \"deletes_parent\": \"parentBudgetShared\","
+      " \"deletes_parent_rate\": 1.0, \"deletes_parent_burst\": 2.0}";
+  auto rhA = makeRh(
+      make_shared<TestHandle>(DeleteRouteTestData(mc_res_deleted)), json);
+  auto rhB = makeRh(
+      make_shared<TestHandle>(DeleteRouteTestData(mc_res_deleted)), json);
+
+  TypedThriftRequest<cpp2::McDeleteRequest> req("key");
+  usleep(2001000);
+  EXPECT_EQ(rhA.route(req).result(), mc_res_deleted);
+  EXPECT_EQ(rhB.route(req).result(), mc_res_deleted);
+  EXPECT_EQ(rhA.route(req).result(), mc_res_notfound);
+  EXPECT_EQ(rhB.route(req).result(), mc_res_notfound);
+}
+
+TEST(rateLimitRouteTest, slidingWindow) {
+  /* Bucket would admit 4 at once; the window shaper caps admissions
+     at 2 per second */
+  auto rh = makeRh(
+      make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+      "{\"gets_rate\": 4.0, \"gets_burst\": 4.0,"
+      " \"gets_window_limit\": 2.0, \"gets_window_ms\": 1000.0}");
+
+  TypedThriftRequest<cpp2::McGetRequest> req("key");
+  usleep(1001000);
+  EXPECT_EQ(rh.route(req).result(), mc_res_found);
+  EXPECT_EQ(rh.route(req).result(), mc_res_found);
+  EXPECT_EQ(rh.route(req).result(), mc_res_notfound);
+  /* After a full window the budget is fresh */
+  usleep(2001000);
+  EXPECT_EQ(rh.route(req).result(), mc_res_found);
+}
+
+TEST(rateLimitRouteTest, batchPartialAdmit) {
+  /* The bucket holds three tokens; a five-request batch gets a single
+     permit grab admitting the first three and rejecting the rest */
+  auto rh = makeRh(
+      make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+      "{\"gets_rate\": 3.0, \"gets_burst\": 3.0}");
+
+  TypedThriftRequest<cpp2::McGetRequest> req("key");
+  usleep(1001000);
+  vector<const TypedThriftRequest<cpp2::McGetRequest>*> reqs(5, &req);
+  auto replies = rh.routeBatch(reqs);
+  ASSERT_EQ(5, replies.size());
+  for (size_t i = 0; i < replies.size(); ++i) {
+    EXPECT_EQ(replies[i].result(), i < 3 ? mc_res_found : mc_res_notfound);
+  }
+}
+
 TEST(rateLimitRouteTest, setsBasic) { testSets(); }
 TEST(rateLimitRouteTest, setsBurst) { testSets(true); }
 TEST(rateLimitRouteTest, getsBasic) { testGets(); }
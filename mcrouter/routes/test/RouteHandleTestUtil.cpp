@@ -17,13 +17,13 @@ McrouterInstance* getTestRouter() {
   return McrouterInstance::init("test", opts);
 }
 
-std::shared_ptr<ProxyRequestContext> getTestContext() {
+ProxyRequestContextPtr getTestContext() {
   return ProxyRequestContext::createRecording(*getTestRouter()->getProxy(0),
                                               nullptr);
 }
 
 void mockFiberContext() {
-  std::shared_ptr<ProxyRequestContext> ctx;
+  ProxyRequestContextPtr ctx;
   folly::fibers::runInMainContext([&ctx](){
     ctx = getTestContext();
   });
@@ -29,7 +29,7 @@ McrouterInstance* getTestRouter();
 /**
  * Create recording ProxyRequestContext for fiber locals
  */
-std::shared_ptr<ProxyRequestContext> getTestContext();
+ProxyRequestContextPtr getTestContext();
 
 /**
  * Set valid McrouterFiberContext in fiber locals
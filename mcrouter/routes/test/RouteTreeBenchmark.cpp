@@ -0,0 +1,203 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/dynamic.h>
+
+#include "mcrouter/lib/config/RouteHandleFactory.h"
+#include "mcrouter/lib/fbi/cpp/util.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/McrouterInstance.h"
+#include "mcrouter/PoolFactory.h"
+#include "mcrouter/proxy.h"
+#include "mcrouter/routes/McRouteHandleProvider.h"
+#include "mcrouter/routes/test/RouteHandleTestUtil.h"
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::mcrouter;
+
+/**
+ * Route-tree micro-interpreter benchmark: builds trees from config
+ * snippets through the regular route handle factory (no network; leaves
+ * are NullRoutes standing in for DestinationRoute, so replies are
+ * instant) and replays canned request streams through route(). The
+ * ns/request numbers isolate routing CPU from network CPU, which makes
+ * config refactors - e.g. flattening nested OperationSelectorRoutes -
+ * directly comparable.
+ */
+
+namespace {
+
+McrouterRouteHandlePtr makeTree(folly::StringPiece jsonStr) {
+  auto router = getTestRouter();
+  static PoolFactory poolFactory(folly::dynamic::object(),
+                                 router->configApi());
+  static McRouteHandleProvider provider(*router->getProxy(0), poolFactory);
+  static RouteHandleFactory<McrouterRouteHandleIf> factory(provider, 0);
+  return factory.create(parseJsonString(jsonStr));
+}
+
+std::string hashOverNullLeaves(size_t width) {
+  folly::dynamic children = folly::dynamic::array();
+  for (size_t i = 0; i < width; ++i) {
+    children.push_back("NullRoute");
+  }
+  folly::dynamic json = folly::dynamic::object
+      ("type", "HashRoute")
+      ("children", std::move(children));
+  return folly::toJson(json).toStdString();
+}
+
+const char* const kFailoverChain =
+ R"({
+  "type": "FailoverRoute",
+  "children": ["ErrorRoute", "ErrorRoute", "NullRoute"]
+ })";
+
+const char* const kOpSelectorFlat =
+ R"({
+  "type": "OperationSelectorRoute",
+  "default_policy": "NullRoute",
+  "operation_policies": {
+    "get": "NullRoute",
+    "set": "NullRoute",
+    "delete": "NullRoute"
+  }
+ })";
+
+const char* const kOpSelectorNested =
+ R"({
+  "type": "OperationSelectorRoute",
+  "default_policy": "NullRoute",
+  "operation_policies": {
+    "get": {
+      "type": "OperationSelectorRoute",
+      "default_policy": "NullRoute",
+      "operation_policies": {
+        "get": {
+          "type": "OperationSelectorRoute",
+          "default_policy": "NullRoute",
+          "operation_policies": {
+            "get": "NullRoute"
+          }
+        }
+      }
+    },
+    "set": "NullRoute",
+    "delete": "NullRoute"
+  }
+ })";
+
+std::vector<TypedThriftRequest<cpp2::McGetRequest>> makeGetStream(size_t n) {
+  std::vector<TypedThriftRequest<cpp2::McGetRequest>> requests;
+  requests.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    requests.emplace_back(folly::to<std::string>("bench:key:", i));
+  }
+  return requests;
+}
+
+void replayGets(unsigned n, folly::StringPiece treeJson) {
+  folly::BenchmarkSuspender susp;
+  auto rh = makeTree(treeJson);
+  auto requests = makeGetStream(128);
+  susp.dismiss();
+
+  size_t i = 0;
+  while (n--) {
+    auto reply = rh->route(requests[i++ % requests.size()]);
+    folly::doNotOptimizeAway(reply.result());
+  }
+}
+
+void replayMixed(unsigned n, folly::StringPiece treeJson) {
+  folly::BenchmarkSuspender susp;
+  auto rh = makeTree(treeJson);
+  auto gets = makeGetStream(128);
+  TypedThriftRequest<cpp2::McSetRequest> set;
+  set.setKey("bench:key:set");
+  set.setValue("value");
+  set.setExptime(0);
+  TypedThriftRequest<cpp2::McDeleteRequest> del;
+  del.setKey("bench:key:del");
+  susp.dismiss();
+
+  size_t i = 0;
+  while (n--) {
+    /* 8:1:1 get/set/delete, roughly our production mix. */
+    switch (i % 10) {
+      case 8:
+        folly::doNotOptimizeAway(rh->route(set).result());
+        break;
+      case 9:
+        folly::doNotOptimizeAway(rh->route(del).result());
+        break;
+      default:
+        folly::doNotOptimizeAway(
+            rh->route(gets[i % gets.size()]).result());
+        break;
+    }
+    ++i;
+  }
+}
+
+} // anonymous
+
+BENCHMARK(hashRoute10Gets, n) {
+  replayGets(n, hashOverNullLeaves(10));
+}
+
+BENCHMARK(hashRoute100Gets, n) {
+  replayGets(n, hashOverNullLeaves(100));
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(failoverChainGets, n) {
+  replayGets(n, kFailoverChain);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(opSelectorFlatGets, n) {
+  replayGets(n, kOpSelectorFlat);
+}
+
+BENCHMARK_RELATIVE(opSelectorNestedGets, n) {
+  replayGets(n, kOpSelectorNested);
+}
+
+BENCHMARK_DRAW_LINE()
+
+BENCHMARK(opSelectorFlatMixed, n) {
+  replayMixed(n, kOpSelectorFlat);
+}
+
+BENCHMARK_RELATIVE(opSelectorNestedMixed, n) {
+  replayMixed(n, kOpSelectorNested);
+}
+
+// for backward compatibility with gflags
+namespace gflags { } // gflags
+namespace google { using namespace gflags; } // google
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  mockFiberContext();
+  folly::runBenchmarks();
+  return 0;
+}
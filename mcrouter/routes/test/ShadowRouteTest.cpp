@@ -9,6 +9,7 @@
  */
 #include <memory>
 #include <random>
+#include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -81,3 +82,47 @@ TEST(shadowRouteTest, defaultPolicy) {
   EXPECT_EQ(shadowHandles[0]->saw_keys, vector<string>{"key"});
   EXPECT_EQ(shadowHandles[1]->saw_keys, vector<string>{"key"});
 }
+
+TEST(shadowRouteTest, shadowBudget) {
+  vector<std::shared_ptr<TestHandle>> normalHandle{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a")),
+  };
+  auto normalRh = get_route_handles(normalHandle)[0];
+
+  vector<std::shared_ptr<TestHandle>> shadowHandles{
+    make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b")),
+  };
+
+  TestFiberManager fm{fiber_local::ContextTypeTag()};
+
+  auto settings = ShadowSettings::create(
+      folly::dynamic::object
+        ("key_fraction_range", folly::dynamic::array(0, 1))
+        ("max_shadow_rate", 1.0),
+      *getTestRouter());
+
+  auto shadowRhs = get_route_handles(shadowHandles);
+  McrouterShadowData shadowData{
+    {std::move(shadowRhs[0]), settings},
+  };
+
+  McrouterRouteHandle<ShadowRoute<DefaultShadowPolicy>> rh(
+    normalRh,
+    std::move(shadowData),
+    DefaultShadowPolicy());
+
+  fm.run([&] () {
+    mockFiberContext();
+    for (int i = 0; i < 10; ++i) {
+      auto reply = rh.route(TypedThriftRequest<cpp2::McGetRequest>(
+          "key" + std::to_string(i)));
+      EXPECT_EQ(mc_res_found, reply.result());
+    }
+  });
+
+  // All requests hit the normal route, but the one-per-second budget
+  // lets only the first (or second, on a clock tick) through to the shadow.
+  EXPECT_EQ(10, normalHandle[0]->saw_keys.size());
+  EXPECT_LE(1, shadowHandles[0]->saw_keys.size());
+  EXPECT_GE(2, shadowHandles[0]->saw_keys.size());
+}
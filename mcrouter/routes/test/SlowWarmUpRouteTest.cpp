@@ -32,7 +32,7 @@ McrouterInstance* getRouter() {
   return McrouterInstance::init("test_shadow", opts);
 }
 
-std::shared_ptr<ProxyRequestContext> getContext() {
+ProxyRequestContextPtr getContext() {
   return ProxyRequestContext::createRecording(*getRouter()->getProxy(0),
                                               nullptr);
 }
@@ -75,7 +75,7 @@ TEST(SlowWarmUpRoute, basic) {
 
   auto ctx = getContext();
   fm.run([&]() {
-    fiber_local::setSharedCtx(ctx);
+    fiber_local::setSharedCtx(ctx.clone());
     TestRouteHandle<SlowWarmUpRoute<TestRouteHandleIf>> rh(
         std::move(target),
         std::move(failoverTarget),
@@ -128,6 +128,68 @@ TEST(SlowWarmUpRoute, basic) {
   });
 }
 
+TEST(SlowWarmUpRoute, adaptive) {
+  auto settings = std::make_shared<SlowWarmUpRouteSettings>(
+      /* enable */       0.5,
+      /* disable */      0.9,
+      /* start */        0.1,
+      /* step */         1.0,
+      /* numReqs  */     5,
+      /* gainP */        0.5,
+      /* gainI */        0.2,
+      /* adaptPeriod */  50);
+
+  TestFiberManager fm{fiber_local::ContextTypeTag()};
+
+  std::vector<std::shared_ptr<TestHandle>> targets{
+    std::make_shared<TestHandle>(GetRouteTestData(mc_res_found, "a"),
+                                 UpdateRouteTestData(mc_res_stored),
+                                 DeleteRouteTestData(mc_res_notfound)),
+    std::make_shared<TestHandle>(GetRouteTestData(mc_res_found, "b"),
+                                 UpdateRouteTestData(mc_res_stored),
+                                 DeleteRouteTestData(mc_res_notfound)),
+  };
+  auto target = get_route_handles(targets)[0];
+  auto failoverTarget = get_route_handles(targets)[1];
+
+  auto ctx = getContext();
+  fm.run([&]() {
+    fiber_local::setSharedCtx(ctx.clone());
+    TestRouteHandle<SlowWarmUpRoute<TestRouteHandleIf>> rh(
+        std::move(target),
+        std::move(failoverTarget),
+        std::move(settings));
+
+    // send 10 gets and 90 deletes (which return miss) -> hit rate is 0.1,
+    // so we enter warmup with the controller at the start fraction.
+    for (int i = 0; i < 10; ++i) {
+      auto reply = rh.route(TypedThriftRequest<cpp2::McGetRequest>("0"));
+      EXPECT_EQ("a", reply.valueRangeSlow().str());
+    }
+    for (int i = 0; i < 90; ++i) {
+      auto reply = rh.route(TypedThriftRequest<cpp2::McDeleteRequest>("0"));
+      EXPECT_EQ(mc_res_notfound, reply.result());
+    }
+
+    // send 1000 gets (round 1) -> should have normal and failover results
+    size_t numNormal1 = 0;
+    size_t numFailover1 = 0;
+    sendWorkload(rh, 1000, numNormal1, numFailover1);
+    EXPECT_TRUE(numNormal1 > 0);
+    EXPECT_TRUE(numFailover1 > 0);
+    EXPECT_EQ(1000, numNormal1 + numFailover1);
+
+    // every get to the destination hits, so the controller keeps raising
+    // the fraction: round 2 must send more traffic to the normal target.
+    size_t numNormal2 = 0;
+    size_t numFailover2 = 0;
+    sendWorkload(rh, 1000, numNormal2, numFailover2);
+    EXPECT_TRUE(numNormal2 > numNormal1);
+    EXPECT_TRUE(numFailover2 < numFailover1);
+    EXPECT_EQ(1000, numNormal2 + numFailover2);
+  });
+}
+
 TEST(SlowWarmUpRoute, minRequests) {
   auto settings = std::make_shared<SlowWarmUpRouteSettings>(
       /* enable */    0.5,
@@ -151,7 +213,7 @@ TEST(SlowWarmUpRoute, minRequests) {
 
   auto ctx = getContext();
   fm.run([&]() {
-    fiber_local::setSharedCtx(ctx);
+    fiber_local::setSharedCtx(ctx.clone());
     TestRouteHandle<SlowWarmUpRoute<TestRouteHandleIf>> rh(
         std::move(target),
         std::move(failoverTarget),
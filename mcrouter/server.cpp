@@ -12,6 +12,9 @@
 #include <signal.h>
 
 #include <cstdio>
+#include <memory>
+
+#include <folly/Memory.h>
 
 #include "mcrouter/config.h"
 #include "mcrouter/lib/network/AsyncMcServer.h"
@@ -23,6 +26,7 @@
 #include "mcrouter/proxy.h"
 #include "mcrouter/ProxyThread.h"
 #include "mcrouter/ServerOnRequest.h"
+#include "mcrouter/SocketHandover.h"
 #include "mcrouter/standalone_options.h"
 
 namespace facebook { namespace memcache { namespace mcrouter {
@@ -68,10 +72,28 @@ void serverLoop(
   /* TODO(libevent): the only reason this is not simply evb.loop() is
      because we need to call asox stuff on every loop iteration.
      We can clean this up once we convert everything to EventBase */
+  const int64_t busyPollUs = standaloneOpts.server_busy_poll_us;
+  int64_t spinDeadlineUs = 0;
   while (worker.isAlive() ||
          worker.writesPending() ||
-         proxy->fiberManager.hasTasks()) {
-    evb.loopOnce();
+         proxy->fiberManagersHaveTasks()) {
+    if (busyPollUs == 0) {
+      evb.loopOnce();
+      continue;
+    }
+    /* Adaptive busy-polling: after any iteration that found work, keep
+       draining the loop with non-blocking passes for the poll window, so
+       back-to-back requests skip the epoll_wait wakeup entirely.  Once
+       the window expires without new work we block again (interrupt
+       mode) rather than burn an idle core. */
+    if (nowUs() < spinDeadlineUs) {
+      evb.loopOnce(EVLOOP_NONBLOCK);
+    } else {
+      evb.loopOnce();
+    }
+    if (worker.writesPending() || proxy->fiberManagersHaveTasks()) {
+      spinDeadlineUs = nowUs() + busyPollUs;
+    }
   }
 
   // destroy proxy on proxy thread
@@ -84,7 +106,28 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
                const McrouterOptions& mcrouterOpts) {
   AsyncMcServer::Options opts;
 
-  if (standaloneOpts.listen_sock_fd >= 0) {
+  bool handoverEnabled = !standaloneOpts.handover_sock_path.empty();
+  if (handoverEnabled && !standaloneOpts.ssl_ports.empty()) {
+    /* Received fds can't be told apart as plain vs SSL listeners. */
+    LOG(WARNING) << "Socket handover is not supported with SSL ports; "
+                 << "ignoring --handover-sock-path";
+    handoverEnabled = false;
+  }
+
+  bool tookOverSockets = false;
+  if (handoverEnabled) {
+    auto fds = requestListeningSockets(standaloneOpts.handover_sock_path);
+    if (!fds.empty()) {
+      LOG(INFO) << "Took over " << fds.size()
+                << " listening socket(s) from a running instance";
+      opts.existingSocketFds = std::move(fds);
+      tookOverSockets = true;
+    }
+  }
+
+  if (tookOverSockets) {
+    /* sockets are already bound (and listening) in the old instance */
+  } else if (standaloneOpts.listen_sock_fd >= 0) {
     opts.existingSocketFd = standaloneOpts.listen_sock_fd;
   } else if (!standaloneOpts.unix_domain_sock.empty()) {
     opts.unixDomainSockPath = standaloneOpts.unix_domain_sock;
@@ -97,14 +140,20 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
   }
 
   opts.numThreads = mcrouterOpts.num_proxies;
+  opts.tcpDeferAcceptSecs = standaloneOpts.tcp_defer_accept_secs;
 
   opts.setPerThreadMaxConns(standaloneOpts.max_conns, opts.numThreads);
+  opts.worker.maxConnsPerPeer = standaloneOpts.max_conns_per_client_ip;
   opts.worker.defaultVersionHandler = false;
   opts.worker.maxInFlight = standaloneOpts.max_client_outstanding_reqs;
   opts.worker.sendTimeout = std::chrono::milliseconds{
     standaloneOpts.client_timeout_ms};
+  opts.worker.busyPollUs = standaloneOpts.server_busy_poll_us;
+  opts.worker.useJemallocNodumpAllocator = mcrouterOpts.jemalloc_nodump_buffers;
+  opts.worker.useHugePageBuffers = mcrouterOpts.huge_page_buffers;
   if (!mcrouterOpts.debug_fifo_root.empty()) {
     opts.worker.debugFifoPath = getServerDebugFifoFullPath(mcrouterOpts);
+    opts.worker.debugFifoRingBytes = mcrouterOpts.debug_fifo_ring_size;
   }
 
   /* Default to one read per event to help latency-sensitive workloads.
@@ -149,8 +198,29 @@ bool runServer(const McrouterStandaloneOptions& standaloneOpts,
       }
     );
 
+    std::unique_ptr<SocketHandoverServer> handoverServer;
+    if (handoverEnabled) {
+      handoverServer = folly::make_unique<SocketHandoverServer>(
+        standaloneOpts.handover_sock_path,
+        server.listeningSocketFds(),
+        standaloneOpts.handover_drain_timeout_ms,
+        [&server]() {
+          server.pauseAccepting();
+        },
+        [&server]() {
+          server.shutdown();
+        });
+      if (!handoverServer->start()) {
+        handoverServer.reset();
+      }
+    }
+
     server.join();
 
+    if (handoverServer) {
+      handoverServer->stop();
+    }
+
     LOG(INFO) << "Shutting down";
 
     McrouterInstance::freeAllMcrouters();
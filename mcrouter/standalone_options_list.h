@@ -46,6 +46,23 @@ mcrouter_option_string(
   "unix-domain-sock", no_short,
   "Unix domain socket path")
 
+mcrouter_option_string(
+  handover_sock_path, "",
+  "handover-sock-path", no_short,
+  "Unix domain socket path used for zero-downtime restarts. On startup, "
+  "if an old instance is listening on this path, its listening sockets "
+  "are taken over (via SCM_RIGHTS) instead of binding new ones. While "
+  "running, a handover request from a new instance makes this process "
+  "stop accepting and drain (see --handover-drain-timeout-ms). "
+  "Not supported together with SSL ports.")
+
+mcrouter_option_integer(
+  unsigned int, handover_drain_timeout_ms, 30000,
+  "handover-drain-timeout-ms", no_short,
+  "After handing the listening sockets to a new instance, keep serving "
+  "already-established connections for up to this long before shutting "
+  "down.")
+
 mcrouter_option_integer(
   size_t, max_conns, 0,
   "max-conns", no_short,
@@ -53,11 +70,36 @@ mcrouter_option_integer(
   "0 - disable connection eviction logic; 1 - calculate number of maximum "
   "connections based on rlimits. Eviction logic is disabled by default.")
 
+mcrouter_option_integer(
+  size_t, max_conns_per_client_ip, 0,
+  "max-conns-per-client-ip", no_short,
+  "Maximum number of connections a single client IP may keep open to each "
+  "server thread. A client above the cap has its own least recently active "
+  "connection closed, and under max-conns pressure over-quota clients are "
+  "evicted first. 0 to disable per-IP accounting.")
+
 mcrouter_option_integer(
   uint32_t, max_client_outstanding_reqs, DEFAULT_MAX_CLIENT_OUTSTANDING_REQS,
   "max-client-outstanding-reqs", no_short,
   "Maximum requests outstanding per client (0 to disable)")
 
+mcrouter_option_integer(
+  uint32_t, server_busy_poll_us, 0,
+  "server-busy-poll-us", no_short,
+  "If nonzero, set SO_BUSY_POLL to this many microseconds on accepted "
+  "connections and keep each server worker spinning on its event loop "
+  "for the same window after processing work, falling back to blocking "
+  "waits when idle. Trades idle CPU for a wakeup per event under load "
+  "(0 to disable).")
+
+mcrouter_option_integer(
+  uint32_t, tcp_defer_accept_secs, 0,
+  "tcp-defer-accept", no_short,
+  "If nonzero, set TCP_DEFER_ACCEPT with this timeout (seconds) on the "
+  "listening sockets, so a new connection wakes the acceptor only once "
+  "the client's first request bytes have arrived instead of on handshake "
+  "completion. Ignored for unix domain sockets (0 to disable).")
+
 mcrouter_option_integer(
   size_t, requests_per_read, 0,
   "reqs-per-read", no_short,
@@ -37,6 +37,10 @@
   /* Number of requests/second that couldn't be processed immediately in OLR */
   STUI(outstanding_route_get_reqs_queued, 0, 1)
   STUI(outstanding_route_update_reqs_queued, 0, 1)
+  STUI(outstanding_route_deadline_shed, 0, 1)
+  /* Requests dropped at DestinationRoute because their (possibly
+     caret-propagated) deadline had already passed */
+  STUI(destination_deadline_shed, 0, 1)
 #undef GROUP
 #define GROUP ods_stats | mcproxy_stats
   /* Average number of requests waiting in OLR at any given time */
@@ -60,10 +64,31 @@
   STUI(destination_inflight_reqs, 0, 1)
   STAT(destination_batch_size, stat_double, 0, .dbl = 0.0)
   STUI(asynclog_requests, 0, 1)
+  /* Records that went through the in-memory spool tier. */
+  STUI(asynclog_ring_spooled, 0, 1)
+  /* Memory tier backpressure: ring was full, fell back to the awriter. */
+  STUI(asynclog_spool_ring_full, 0, 1)
+  /* Spool files opened under the failover root (--async-dir-failover). */
+  STUI(asynclog_failover_spool_opens, 0, 1)
+  /* Failed deletes delivered by the in-memory retry stage
+     (--asynclog-retry-count) without touching the spool. */
+  STUI(retried_deletes, 0, 1)
   /* Proxy requests we started routing */
   STUI(proxy_reqs_processing, 0, 1)
   /* Proxy requests queued up and not routed yet */
   STUI(proxy_reqs_waiting, 0, 1)
+  /* Proxy requests rejected with busy because the memory budget
+     (--memory-budget-mb) was over this priority's shed threshold */
+  STUI(proxy_reqs_memory_shed, 0, 1)
+  /* Fanout children aborted because the request was over its
+     --request-cycle-budget of proxy CPU */
+  STUI(request_cycle_budget_exceeded, 0, 1)
+  /* Bytes tracked by the process-wide memory budget, by category */
+  STUI(mem_budget_read_buffers, 0, 0)
+  STUI(mem_budget_write_buffers, 0, 0)
+  STUI(mem_budget_waiting_requests, 0, 0)
+  /* Bytes of jemalloc chunks advised MADV_HUGEPAGE (--huge-page-buffers) */
+  STUI(huge_page_arena_bytes, 0, 0)
   STAT(client_queue_notify_period, stat_double, 0, .dbl = 0.0)
 //  STUI(bytes_read, 0)
 //  STUI(bytes_written, 0)
@@ -77,9 +102,14 @@
   STAT(ps_system_time_sec, stat_double, 0, .dbl = 0.0)
   STUI(ps_vsize, 0, 0)
   STUI(ps_rss, 0, 0)
+  /* Bytes of this process' anon memory resident in transparent hugepages,
+     summed over /proc/self/smaps; only collected with --huge-page-buffers */
+  STUI(ps_anon_huge_pages, 0, 0)
   STUI(fibers_allocated, 0, 0)
   STUI(fibers_pool_size, 0, 0)
   STUI(fibers_stack_high_watermark, 0, 0)
+  STUI(fibers_small_stack_allocated, 0, 0)
+  STUI(fibers_small_stack_high_watermark, 0, 0)
 //  STUI(failed_client_connections, 0)
   STUI(successful_client_connections, 0, 1)
   STUI(cycles_avg, 0, 1)
@@ -91,6 +121,9 @@
   STUI(cycles_p95, 0, 1)
   STUI(cycles_p99, 0, 1)
   STUI(cycles_num, 0, 1)
+  STUI(cycles_llc_misses, 0, 1)
+  STUI(cycles_stalled, 0, 1)
+  STUI(cycles_branch_misses, 0, 1)
   STAT(duration_us, stat_double, 0, .dbl = 0.0)
 #undef GROUP
 #define GROUP ods_stats | mcproxy_stats | max_stats
@@ -236,6 +269,12 @@
   STUI(config_last_attempt, 0, 0)
   STUI(config_last_success, 0, 0)
   STUI(config_failures, 0, 0)
+  // Config pushes installed as canaries (see --config-canary-rate).
+  STUI(config_canary_started, 0, 0)
+  // Canary configs promoted to serve all traffic.
+  STUI(config_canary_promoted, 0, 0)
+  // Canary configs discarded for regressing errors or latency.
+  STUI(config_canary_rolled_back, 0, 0)
   STUI(start_time, 0, 0)
   STUI(dev_null_requests, 0, 1)
 #undef GROUP
@@ -254,6 +293,24 @@
   STUIR(failover_all, 0, 1)
   STUIR(failover_all_failed, 0, 1)
   STUIR(failover_rate_limited, 0, 1)
+  /* Requests sent straight to failover because --failover-tko-precheck
+     found every destination of the normal target marked TKO */
+  STUIR(failover_tko_precheck_skipped, 0, 1)
+  /* Requests that skipped a normal target latched out after a recent
+     failure (latch_failed_normal_ms) */
+  STUIR(failover_normal_latched, 0, 1)
+  STUIR(hedged_requests, 0, 1)
+  STUIR(hedged_requests_won, 0, 1)
+  STUIR(hot_key_cache_hits, 0, 1)
+  STUIR(hot_key_cache_stores, 0, 1)
+  STUIR(dedup_gets, 0, 1)
+  /* Reads pinned to the write replica by AffinityRoute's bloom filter */
+  STUIR(affinity_reads, 0, 1)
+  /* Shadow reply comparisons processed by the background validator */
+  STUIR(shadow_validation_samples, 0, 1)
+  STUIR(shadow_validation_mismatches, 0, 1)
+  /* Comparisons dropped because the validator queue was full */
+  STUIR(shadow_validation_dropped, 0, 1)
 #undef GROUP
 #define GROUP ods_stats | count_stats
   STUI(result_error_count, 0, 1)
@@ -15,11 +15,15 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <map>
+
 #include <folly/Conv.h>
 #include <folly/json.h>
 #include <folly/Range.h>
 
 #include "mcrouter/config.h"
+#include "mcrouter/KeyspaceStats.h"
+#include "mcrouter/lib/allocator/JemallocHugePageAllocator.h"
 #include "mcrouter/lib/fbi/cpp/util.h"
 #include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
 #include "mcrouter/lib/network/TypedThriftMessage.h"
@@ -29,6 +33,7 @@
 #include "mcrouter/ProxyDestination.h"
 #include "mcrouter/ProxyDestinationMap.h"
 #include "mcrouter/ProxyThread.h"
+#include "mcrouter/RouteHandleProfiler.h"
 
 /**                             .__
  * __  _  _______ _______  ____ |__| ____    ____
@@ -69,12 +74,19 @@ struct ServerStat {
   bool isSoftTko{false};
   double sumLatencies{0.0};
   size_t cntLatencies{0};
+  LogScaleHistogram<> latencyHistogram;
   size_t pendingRequestsCount{0};
   size_t inflightRequestsCount{0};
 
   std::string toString() const {
     double avgLatency = cntLatencies == 0 ? 0 : sumLatencies / cntLatencies;
     auto res = folly::format("avg_latency_us:{:.3f}", avgLatency).str();
+    if (latencyHistogram.count() > 0) {
+      folly::format(" p99_latency_us:{}",
+                    latencyHistogram.getPercentile(0.99)).appendTo(res);
+      folly::format(" p999_latency_us:{}",
+                    latencyHistogram.getPercentile(0.999)).appendTo(res);
+    }
     folly::format(" pending_reqs:{}", pendingRequestsCount).appendTo(res);
     folly::format(" inflight_reqs:{}", inflightRequestsCount).appendTo(res);
     if (isHardTko) {
@@ -150,7 +162,7 @@ double stats_aggregate_rate_value(const McrouterInstance& router, int idx) {
 
   if (num_bins_used != 0) {
     uint64_t num = 0;
-    for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
       num += router.getProxy(i)->stats_num_within_window[idx];
     }
     rate = (double)num / (num_bins_used * MOVING_AVERAGE_BIN_SIZE_IN_SECOND);
@@ -165,7 +177,7 @@ uint64_t stats_aggregate_max_value(const McrouterInstance& router, int idx) {
 
   for (int j = 0; j < num_bins_used; ++j) {
     uint64_t binSum = 0;
-    for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
       binSum += router.getProxy(i)->stats_bin[idx][j];
     }
     max = std::max(max, binSum);
@@ -294,6 +306,32 @@ static int get_proc_stat(pid_t pid, proc_stat_data_t *data) {
   return 0;
 }
 
+/**
+ * Sums the AnonHugePages fields of /proc/self/smaps: bytes of this
+ * process' anonymous memory the kernel currently backs with transparent
+ * hugepages. Walking smaps is not free on a process with a big address
+ * space, so callers only do it when hugepage use is actually enabled.
+ */
+static uint64_t get_anon_huge_page_bytes() {
+  FILE* smaps_file = fopen("/proc/self/smaps", "r");
+  if (smaps_file == nullptr) {
+    LOG(ERROR) << "Can't open /proc/self/smaps: " << strerror(errno);
+    return 0;
+  }
+
+  uint64_t total_kb = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), smaps_file) != nullptr) {
+    unsigned long kb;
+    if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+      total_kb += kb;
+    }
+  }
+  fclose(smaps_file);
+
+  return total_kb * 1024;
+}
+
 void prepare_stats(McrouterInstance& router, stat_t* stats) {
   init_stats(stats);
 
@@ -307,7 +345,7 @@ void prepare_stats(McrouterInstance& router, stat_t* stats) {
   uint64_t outstandingUpdateReqsHelper = 0;
   uint64_t outstandingUpdateWaitTimeSumUs = 0;
 
-  for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+  for (size_t i = 0; i < router.proxyCount(); ++i) {
     auto proxy = router.getProxy(i);
     config_last_success = std::max(config_last_success,
       proxy->stats[config_last_success_stat].data.uint64);
@@ -391,33 +429,58 @@ void prepare_stats(McrouterInstance& router, stat_t* stats) {
   stats[ps_rss_stat].data.uint64 = ps_data.rss;
   stats[ps_vsize_stat].data.uint64 = ps_data.vsize;
 
+#ifdef CAN_USE_JEMALLOC_HUGE_PAGE_ALLOCATOR
+  stats[huge_page_arena_bytes_stat].data.uint64 =
+    JemallocHugePageAllocator::advisedBytes();
+  if (router.opts().huge_page_buffers) {
+    stats[ps_anon_huge_pages_stat].data.uint64 = get_anon_huge_page_bytes();
+  }
+#endif
+
+  auto& memoryBudget = MemoryBudget::instance();
+  stats[mem_budget_read_buffers_stat].data.uint64 =
+    memoryBudget.used(MemoryBudget::kReadBuffers);
+  stats[mem_budget_write_buffers_stat].data.uint64 =
+    memoryBudget.used(MemoryBudget::kWriteBuffers);
+  stats[mem_budget_waiting_requests_stat].data.uint64 =
+    memoryBudget.used(MemoryBudget::kWaitingRequests);
+
   stats[fibers_allocated_stat].data.uint64 = 0;
   stats[fibers_pool_size_stat].data.uint64 = 0;
   stats[fibers_stack_high_watermark_stat].data.uint64 = 0;
-  for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+  stats[fibers_small_stack_allocated_stat].data.uint64 = 0;
+  stats[fibers_small_stack_high_watermark_stat].data.uint64 = 0;
+  for (size_t i = 0; i < router.proxyCount(); ++i) {
     auto pr = router.getProxy(i);
     stats[fibers_allocated_stat].data.uint64 +=
       pr->fiberManager.fibersAllocated();
     stats[fibers_pool_size_stat].data.uint64 +=
-      pr->fiberManager.fibersPoolSize();
+      pr->fiberManager.fibersPoolSize() +
+      pr->smallStackFiberManager.fibersPoolSize();
     stats[fibers_stack_high_watermark_stat].data.uint64 =
       std::max(stats[fibers_stack_high_watermark_stat].data.uint64,
                pr->fiberManager.stackHighWatermark());
+    stats[fibers_small_stack_allocated_stat].data.uint64 +=
+      pr->smallStackFiberManager.fibersAllocated();
+    stats[fibers_small_stack_high_watermark_stat].data.uint64 =
+      std::max(stats[fibers_small_stack_high_watermark_stat].data.uint64,
+               pr->smallStackFiberManager.stackHighWatermark());
     stats[duration_us_stat].data.dbl += pr->durationUs.value();
     stats[client_queue_notify_period_stat].data.dbl += pr->queueNotifyPeriod();
   }
-  if (router.opts().num_proxies > 0) {
-    stats[duration_us_stat].data.dbl /= router.opts().num_proxies;
+  if (router.proxyCount() > 0) {
+    stats[duration_us_stat].data.dbl /= router.proxyCount();
     stats[client_queue_notify_period_stat].data.dbl /=
-      router.opts().num_proxies;
+      router.proxyCount();
   }
 
   for (int i = 0; i < num_stats; i++) {
     if (stats[i].aggregate && !(stats[i].group & rate_stats)) {
-      for (size_t j = 0; j < router.opts().num_proxies; ++j) {
+      for (size_t j = 0; j < router.proxyCount(); ++j) {
         auto pr = router.getProxy(j);
         if (stats[i].type == stat_uint64) {
-          stats[i].data.uint64 += pr->stats[i].data.uint64;
+          stats[i].data.uint64 +=
+            stat_get_uint64(pr->stats, static_cast<stat_name_t>(i));
         } else if (stats[i].type == stat_int64) {
           stats[i].data.int64 += pr->stats[i].data.int64;
         } else if (stats[i].type == stat_double) {
@@ -430,13 +493,14 @@ void prepare_stats(McrouterInstance& router, stat_t* stats) {
   }
 }
 
-// Thread-safe increment of the given counter
+// Thread-safe increment of the given counter. Relaxed ordering is enough:
+// stats are monotonic counters and no other data is published through them.
 void stat_incr_safe(stat_t* stats, stat_name_t stat_name) {
-  __sync_fetch_and_add(&stats[stat_name].data.uint64, 1);
+  __atomic_fetch_add(&stats[stat_name].data.uint64, 1, __ATOMIC_RELAXED);
 }
 
 void stat_decr_safe(stat_t* stats, stat_name_t stat_name) {
-  __sync_fetch_and_add(&stats[stat_name].data.uint64, -1);
+  __atomic_fetch_add(&stats[stat_name].data.uint64, -1, __ATOMIC_RELAXED);
 }
 
 void stat_set_uint64(stat_t* stats,
@@ -444,12 +508,18 @@ void stat_set_uint64(stat_t* stats,
                      uint64_t value) {
   stat_t* stat = &stats[stat_num];
   assert(stat->type == stat_uint64);
-  stat->data.uint64 = value;
+  __atomic_store_n(&stat->data.uint64, value, __ATOMIC_RELAXED);
 }
 
 uint64_t stat_get_uint64(stat_t* stats, stat_name_t stat_num) {
   stat_t* stat = &stats[stat_num];
-  return stat->data.uint64;
+  return __atomic_load_n(&stat->data.uint64, __ATOMIC_RELAXED);
+}
+
+uint64_t stat_fetch_reset_uint64(stat_t* stats, stat_name_t stat_num) {
+  stat_t* stat = &stats[stat_num];
+  assert(stat->type == stat_uint64);
+  return __atomic_exchange_n(&stat->data.uint64, 0, __ATOMIC_RELAXED);
 }
 
 static stat_group_t stat_parse_group_str(folly::StringPiece str) {
@@ -471,6 +541,12 @@ static stat_group_t stat_parse_group_str(folly::StringPiece str) {
     return server_stats;
   } else if (str == "suspect_servers") {
     return suspect_server_stats;
+  } else if (str == "route_handles") {
+    return route_handle_stats;
+  } else if (str == "keyspaces") {
+    return keyspace_stats;
+  } else if (str == "threads") {
+    return thread_stats;
   } else if (str == "memory") {
     return memory_stats;
   } else if (str == "count") {
@@ -525,7 +601,7 @@ TypedThriftReply<cpp2::McStatsReply> stats_reply(proxy_t* proxy,
   if (groups & server_stats) {
     folly::StringKeyedUnorderedMap<ServerStat> serverStats;
     auto& router = proxy->router();
-    for (size_t i = 0; i < router.opts().num_proxies; ++i) {
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
       router.getProxy(i)->destinationMap->foreachDestinationSynced(
         [&serverStats](folly::StringPiece key, const ProxyDestination& pdstn) {
           auto& stat = serverStats[key];
@@ -542,6 +618,7 @@ TypedThriftReply<cpp2::McStatsReply> stats_reply(proxy_t* proxy,
             stat.sumLatencies += pdstn.stats().avgLatency.value();
             ++stat.cntLatencies;
           }
+          stat.latencyHistogram.merge(pdstn.stats().latencyHistogram);
           stat.pendingRequestsCount += pdstn.getPendingRequestCount();
           stat.inflightRequestsCount += pdstn.getInflightRequestCount();
         }
@@ -552,6 +629,74 @@ TypedThriftReply<cpp2::McStatsReply> stats_reply(proxy_t* proxy,
     }
   }
 
+  if (groups & route_handle_stats) {
+    std::map<std::string, RouteHandleProfiler::Entry> routeHandleStats;
+    auto& router = proxy->router();
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
+      if (const auto& profiler = router.getProxy(i)->routeHandleProfiler) {
+        for (const auto& it : profiler->entries()) {
+          auto& entry = routeHandleStats[it.first];
+          entry.calls += it.second.calls;
+          entry.totalCycles += it.second.totalCycles;
+          entry.maxCycles = std::max(entry.maxCycles, it.second.maxCycles);
+        }
+      }
+    }
+    for (const auto& it : routeHandleStats) {
+      const auto& entry = it.second;
+      reply.addStat(
+          it.first,
+          folly::format("calls:{} avg_cycles:{} max_cycles:{}",
+                        entry.calls,
+                        entry.calls == 0 ? 0 : entry.totalCycles / entry.calls,
+                        entry.maxCycles).str());
+    }
+  }
+
+  if (groups & keyspace_stats) {
+    folly::StringKeyedUnorderedMap<KeyspaceStats::Counters> keyspaceStats;
+    auto& router = proxy->router();
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
+      for (const auto& it : router.getProxy(i)->keyspaceCounters) {
+        auto& entry = keyspaceStats[it.first];
+        entry.requests += it.second.requests;
+        entry.hits += it.second.hits;
+        entry.misses += it.second.misses;
+        entry.errors += it.second.errors;
+      }
+    }
+    for (const auto& it : keyspaceStats) {
+      const auto& entry = it.second;
+      reply.addStat(
+          it.first,
+          folly::format("requests:{} hits:{} misses:{} errors:{}",
+                        entry.requests,
+                        entry.hits,
+                        entry.misses,
+                        entry.errors).str());
+    }
+  }
+
+  if (groups & thread_stats) {
+    /* Per-proxy-thread CPU accounting, sampled on each proxy thread
+       (see proxy_t::sampleThreadCpu).  Lets automation tell a CPU-bound
+       mcrouter from slow backends without host-level guesswork. */
+    auto& router = proxy->router();
+    for (size_t i = 0; i < router.proxyCount(); ++i) {
+      auto pr = router.getProxy(i);
+      reply.addStat(
+          folly::format("proxy{}", i).str(),
+          folly::format(
+              "cpu_user_sec:{:.3f} cpu_system_sec:{:.3f} "
+              "cpu_busy_permille:{}",
+              pr->threadCpuUserUs.load(std::memory_order_relaxed) / 1000000.0,
+              pr->threadCpuSystemUs.load(std::memory_order_relaxed) /
+                  1000000.0,
+              pr->threadCpuBusyPermille.load(std::memory_order_relaxed))
+              .str());
+    }
+  }
+
   if (groups & suspect_server_stats) {
     auto suspectServers = proxy->router().tkoTrackerMap().getSuspectServers();
     for (const auto& it : suspectServers) {
@@ -73,6 +73,9 @@ enum stat_group_t {
   server_stats         =    0x10000,
   memory_stats         =    0x20000,
   suspect_server_stats =    0x40000,
+  route_handle_stats   =    0x80000,
+  keyspace_stats       =   0x100000,
+  thread_stats         =   0x200000,
   unknown_stats        = 0x10000000,
 };
 
@@ -93,8 +96,17 @@ struct stat_t {
 
 void init_stats(stat_t* stats);
 
+/**
+ * Increments a counter. May only be called from the thread that owns the
+ * stats array (one writer per array). Aggregation threads read the
+ * counter concurrently with relaxed atomic loads, so the hot path needs
+ * neither a lock nor an atomic read-modify-write.
+ */
 inline void stat_incr(stat_t* stats, stat_name_t stat_num, int64_t amount) {
-  stats[stat_num].data.uint64 += amount;
+  auto& counter = stats[stat_num].data.uint64;
+  __atomic_store_n(&counter,
+                   __atomic_load_n(&counter, __ATOMIC_RELAXED) + amount,
+                   __ATOMIC_RELAXED);
 }
 
 inline void stat_decr(stat_t* stats, stat_name_t stat_num, int64_t amount) {
@@ -118,6 +130,12 @@ uint64_t stats_aggregate_max_value(const McrouterInstance& router, int idx);
 
 void stat_set_uint64(stat_t*, stat_name_t, uint64_t);
 uint64_t stat_get_uint64(stat_t*, stat_name_t);
+
+/**
+ * Atomically reads and zeroes the counter. Used by the stat updater
+ * thread to take per-bin snapshots of max stats owned by proxy threads.
+ */
+uint64_t stat_fetch_reset_uint64(stat_t*, stat_name_t);
 uint64_t stat_get_config_age(const stat_t* stats, uint64_t now);
 TypedThriftReply<cpp2::McStatsReply> stats_reply(proxy_t*, folly::StringPiece);
 void prepare_stats(McrouterInstance& router, stat_t* stats);
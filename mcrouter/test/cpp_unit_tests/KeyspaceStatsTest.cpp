@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <gtest/gtest.h>
+
+#include <folly/dynamic.h>
+
+#include "mcrouter/KeyspaceStats.h"
+
+using facebook::memcache::mcrouter::KeyspaceStats;
+
+TEST(KeyspaceStats, longestPrefixWins) {
+  KeyspaceStats::CounterMap counters;
+  folly::dynamic json = folly::dynamic::object
+      ("user:", "user")
+      ("user:feed:", "feed")
+      ("ads:", "ads");
+  KeyspaceStats stats(json, counters);
+
+  stats.record("user:123", mc_res_found);
+  stats.record("user:feed:123", mc_res_notfound);
+  stats.record("ads:1", mc_res_timeout);
+  stats.record("unrelated:1", mc_res_found);
+
+  EXPECT_EQ(3, counters.size());
+  EXPECT_EQ(1, counters["user"].requests);
+  EXPECT_EQ(1, counters["user"].hits);
+  EXPECT_EQ(0, counters["user"].misses);
+  EXPECT_EQ(1, counters["feed"].requests);
+  EXPECT_EQ(1, counters["feed"].misses);
+  EXPECT_EQ(1, counters["ads"].requests);
+  EXPECT_EQ(1, counters["ads"].errors);
+}
+
+TEST(KeyspaceStats, sharedNamespace) {
+  KeyspaceStats::CounterMap counters;
+  folly::dynamic json = folly::dynamic::object
+      ("a:", "shared")
+      ("b:", "shared");
+  KeyspaceStats stats(json, counters);
+
+  stats.record("a:1", mc_res_found);
+  stats.record("b:1", mc_res_notfound);
+
+  EXPECT_EQ(1, counters.size());
+  EXPECT_EQ(2, counters["shared"].requests);
+  EXPECT_EQ(1, counters["shared"].hits);
+  EXPECT_EQ(1, counters["shared"].misses);
+}
+
+TEST(KeyspaceStats, countersSurviveTableSwap) {
+  KeyspaceStats::CounterMap counters;
+  folly::dynamic json = folly::dynamic::object("user:", "user");
+  {
+    KeyspaceStats stats(json, counters);
+    stats.record("user:1", mc_res_found);
+  }
+  /* A new table built against the same map keeps accumulating into the
+     existing counters, as on a config swap. */
+  KeyspaceStats stats(json, counters);
+  stats.record("user:2", mc_res_found);
+
+  EXPECT_EQ(2, counters["user"].requests);
+  EXPECT_EQ(2, counters["user"].hits);
+}
+
+TEST(KeyspaceStats, invalidConfig) {
+  KeyspaceStats::CounterMap counters;
+  EXPECT_THROW(KeyspaceStats(folly::dynamic::array(1, 2), counters),
+               std::logic_error);
+  EXPECT_THROW(KeyspaceStats(folly::dynamic::object("", "empty"), counters),
+               std::logic_error);
+  EXPECT_THROW(KeyspaceStats(folly::dynamic::object("a:", 42), counters),
+               std::logic_error);
+}
@@ -123,6 +123,30 @@ TEST(LeaseTokenMap, shrink) {
   EXPECT_EQ(map.size(), 0);
 }
 
+TEST(LeaseTokenMap, concurrentAccess) {
+  folly::ScopedEventBaseThread evbAuxThread;
+  LeaseTokenMap map(evbAuxThread);
+
+  constexpr size_t kNumThreads = 8;
+  constexpr size_t kOpsPerThread = 2000;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&map, t]() {
+      for (size_t i = 0; i < kOpsPerThread; ++i) {
+        uint64_t origToken = t * kOpsPerThread + i;
+        uint64_t specToken = map.insert("route01", {origToken, t});
+        assertQueryTrue(map, "route01", specToken, {origToken, t});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(map.size(), 0);
+}
+
 TEST(LeaseTokenMap, stress) {
   size_t tokenTtl = 1000;
   folly::ScopedEventBaseThread evbAuxThread;
@@ -74,7 +74,8 @@ class TestMcrouterBasic(McrouterTestCase):
 
         # Stats with args
         args = ['detailed', 'cmd', 'cmd-in', 'cmd-out', 'cmd-error',
-                'servers', 'suspect_servers', 'memory', 'count', 'outlier']
+                'servers', 'suspect_servers', 'memory', 'count', 'outlier',
+                'threads']
         for arg in args:
             res = mcr.issue_command_and_read_all('stats{0}\r\n'.format(arg))
             self.assertTrue('CLIENT_ERROR' in res)
@@ -93,6 +94,16 @@ class TestMcrouterBasic(McrouterTestCase):
         res = mcr.issue_command_and_read_all('stats invalid_option\r\n')
         self.assertTrue('CLIENT_ERROR' in res)
 
+    def test_stats_threads(self):
+        mcr = self.get_mcrouter(['--proxy-threads=2'])
+
+        # One entry per proxy thread, keyed by proxy id.
+        res = mcr.issue_command_and_read_all('stats threads\r\n')
+        self.assertTrue('STAT proxy0 ' in res)
+        self.assertTrue('STAT proxy1 ' in res)
+        self.assertTrue('cpu_user_sec' in res)
+        self.assertTrue('cpu_busy_permille' in res)
+
     def test_stats_deadlock(self):
         mcr = self.get_mcrouter(['--proxy-threads=8'])
 
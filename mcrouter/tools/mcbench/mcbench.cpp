@@ -0,0 +1,249 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/dynamic.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/json.h>
+#include <folly/SpinLock.h>
+
+#include "mcrouter/config.h"
+#include "mcrouter/lib/network/AsyncMcServer.h"
+#include "mcrouter/lib/network/AsyncMcServerWorker.h"
+#include "mcrouter/lib/network/gen-cpp2/mc_caret_protocol_types.h"
+#include "mcrouter/lib/network/McServerRequestContext.h"
+#include "mcrouter/lib/network/ThriftMsgDispatcher.h"
+#include "mcrouter/lib/network/TypedThriftMessage.h"
+#include "mcrouter/McrouterClient.h"
+#include "mcrouter/McrouterInstance.h"
+
+/**
+ * Loopback throughput benchmark: a synthetic in-memory backend behind
+ * AsyncMcServer, an McrouterInstance configured from a JSON snippet and
+ * a load generator over McrouterClient, all in one process. Answers
+ * "what does this route-tree shape cost" in minutes instead of needing
+ * a test cluster, e.g.:
+ *
+ *   mcbench --route='PoolRoute|A'
+ *   mcbench --route='{"type":"ShadowRoute", ...}' --concurrency=512
+ *
+ * The pool "A" always points at the in-process backend; --config-str
+ * replaces the whole config for multi-pool shapes. The backend replies
+ * from memory, so the numbers isolate mcrouter's own overhead (routing,
+ * serialization, fibers, notification queues) plus loopback TCP.
+ */
+
+DEFINE_int32(port, 11510, "Port for the in-process backend server");
+DEFINE_string(route, "PoolRoute|A",
+              "Route handle tree to benchmark; pool A is the backend");
+DEFINE_string(config_str, "",
+              "Full mcrouter config JSON; overrides --route");
+DEFINE_int32(proxy_threads, 1, "Number of mcrouter proxy threads");
+DEFINE_int32(backend_threads, 2, "Number of backend server threads");
+DEFINE_int64(num_requests, 1000000, "Total number of gets to send");
+DEFINE_int32(concurrency, 256, "Maximum outstanding requests");
+DEFINE_int32(num_keys, 1024, "Number of distinct keys");
+DEFINE_int32(value_size, 512, "Value size stored for each key");
+
+using namespace facebook::memcache;
+using namespace facebook::memcache::cpp2;
+using namespace facebook::memcache::mcrouter;
+
+namespace {
+
+/**
+ * Backend handler: everything is served from a single preallocated
+ * value, so backend time is negligible compared to the router stack
+ * under test.
+ */
+class BenchOnRequest : public ThriftMsgDispatcher<TRequestList,
+                                                  BenchOnRequest,
+                                                  McServerRequestContext&&> {
+ public:
+  explicit BenchOnRequest(size_t valueSize)
+      : value_(folly::IOBuf::COPY_BUFFER, std::string(valueSize, 'v')) {}
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<McGetRequest>&&) {
+    TypedThriftReply<McGetReply> reply(mc_res_found);
+    folly::IOBuf cloned;
+    value_.cloneInto(cloned);
+    reply.setValue(std::move(cloned));
+    McServerRequestContext::reply(std::move(ctx), std::move(reply));
+  }
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<McSetRequest>&&) {
+    McServerRequestContext::reply(
+        std::move(ctx), TypedThriftReply<McSetReply>(mc_res_stored));
+  }
+
+  void onRequest(McServerRequestContext&& ctx,
+                 TypedThriftRequest<McDeleteRequest>&&) {
+    McServerRequestContext::reply(
+        std::move(ctx), TypedThriftReply<McDeleteReply>(mc_res_deleted));
+  }
+
+  template <class Request>
+  void onRequest(McServerRequestContext&& ctx, Request&&) {
+    McServerRequestContext::reply(
+        std::move(ctx),
+        ReplyT<typename std::decay<Request>::type>(mc_res_remote_error));
+  }
+
+ private:
+  folly::IOBuf value_;
+};
+
+std::string makeConfig() {
+  if (!FLAGS_config_str.empty()) {
+    return FLAGS_config_str;
+  }
+  folly::dynamic route = FLAGS_route.front() == '{'
+      ? folly::parseJson(FLAGS_route)
+      : folly::dynamic(FLAGS_route);
+  folly::dynamic config = folly::dynamic::object
+      ("pools", folly::dynamic::object
+        ("A", folly::dynamic::object
+          ("servers", folly::dynamic{
+            folly::to<std::string>("127.0.0.1:", FLAGS_port)})))
+      ("route", std::move(route));
+  return folly::toJson(config).toStdString();
+}
+
+/** Collects latencies from proxy-thread callbacks. */
+class LatencyRecorder {
+ public:
+  explicit LatencyRecorder(size_t expected) : expected_(expected) {
+    latenciesUs_.reserve(expected);
+  }
+
+  void record(int64_t latencyUs) {
+    {
+      folly::SpinLockGuard guard(lock_);
+      latenciesUs_.push_back(latencyUs);
+    }
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (++completed_ == expected_) {
+      done_.notify_one();
+    }
+  }
+
+  void waitForCompletion(size_t expected) {
+    std::unique_lock<std::mutex> lg(mutex_);
+    done_.wait(lg, [&] { return completed_ >= expected; });
+  }
+
+  void report(double elapsedSec) {
+    std::sort(latenciesUs_.begin(), latenciesUs_.end());
+    auto pct = [&](double p) {
+      size_t idx = std::min(
+          latenciesUs_.size() - 1,
+          static_cast<size_t>(p * latenciesUs_.size()));
+      return latenciesUs_[idx];
+    };
+    LOG(INFO) << "requests: " << latenciesUs_.size();
+    LOG(INFO) << "rps:      "
+              << static_cast<int64_t>(latenciesUs_.size() / elapsedSec);
+    LOG(INFO) << "p50 (us): " << pct(0.50);
+    LOG(INFO) << "p90 (us): " << pct(0.90);
+    LOG(INFO) << "p99 (us): " << pct(0.99);
+    LOG(INFO) << "p999 (us):" << pct(0.999);
+  }
+
+ private:
+  const size_t expected_;
+  folly::SpinLock lock_;
+  std::vector<int64_t> latenciesUs_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t completed_{0};
+};
+
+} // anonymous
+
+// for backward compatibility with gflags
+namespace gflags { } // gflags
+namespace google { using namespace gflags; } // google
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  /* Backend. */
+  AsyncMcServer::Options serverOpts;
+  serverOpts.ports.push_back(FLAGS_port);
+  serverOpts.numThreads = FLAGS_backend_threads;
+  serverOpts.worker.versionString = "mcbench-backend-1.0";
+  AsyncMcServer server(serverOpts);
+  server.spawn([](size_t /* threadId */,
+                  folly::EventBase& evb,
+                  AsyncMcServerWorker& worker) {
+    worker.setOnRequest(BenchOnRequest(FLAGS_value_size));
+    evb.loopForever();
+  });
+
+  /* Router under test. */
+  McrouterOptions routerOpts;
+  routerOpts.config_str = makeConfig();
+  routerOpts.num_proxies = FLAGS_proxy_threads;
+  routerOpts.asynclog_disable = true;
+  auto router = McrouterInstance::init("mcbench", routerOpts);
+  CHECK(router != nullptr) << "Failed to initialize mcrouter";
+
+  auto client = router->createClient(FLAGS_concurrency);
+  CHECK(client != nullptr);
+
+  /* Distinct keys so hashing routes spread work realistically. */
+  std::vector<TypedThriftRequest<McGetRequest>> requests;
+  requests.reserve(FLAGS_num_keys);
+  for (int32_t i = 0; i < FLAGS_num_keys; ++i) {
+    TypedThriftRequest<McGetRequest> req;
+    req.setKey(folly::to<std::string>("mcbench:", i));
+    requests.push_back(std::move(req));
+  }
+
+  LOG(INFO) << "Benchmarking route: "
+            << (FLAGS_config_str.empty() ? FLAGS_route : FLAGS_config_str);
+
+  const size_t numRequests = FLAGS_num_requests;
+  LatencyRecorder recorder(numRequests);
+  const auto startUs = nowUs();
+
+  for (size_t i = 0; i < numRequests; ++i) {
+    const auto& req = requests[i % requests.size()];
+    const auto sentUs = nowUs();
+    /* send() blocks once FLAGS_concurrency requests are outstanding. */
+    client->send(req, [&recorder, sentUs](
+        const TypedThriftRequest<McGetRequest>&,
+        TypedThriftReply<McGetReply>&&) {
+      recorder.record(nowUs() - sentUs);
+    });
+  }
+  recorder.waitForCompletion(numRequests);
+
+  const double elapsedSec = (nowUs() - startUs) / 1e6;
+  recorder.report(elapsedSec);
+
+  client.reset();
+  McrouterInstance::freeAllMcrouters();
+  server.shutdown();
+  server.join();
+  return 0;
+}
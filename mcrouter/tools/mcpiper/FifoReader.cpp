@@ -10,14 +10,18 @@
 #include "FifoReader.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 
+#include <folly/FileUtil.h>
 #include <folly/io/async/EventBase.h>
 
 namespace fs = boost::filesystem;
@@ -97,6 +101,20 @@ bool isMessageHeader(const folly::IOBufQueue& bufQueue) {
   return magic == MessageHeader().magic();
 }
 
+/**
+ * Writes the capture filter spec to "<fifoPath>.filter", so the writer
+ * picks it up when it connects. An empty spec removes any stale file
+ * left behind by a previous reader, restoring unfiltered capture.
+ */
+void placeFilterSpec(const std::string& fifoPath, const std::string& spec) {
+  auto specPath = fifoPath + ".filter";
+  if (spec.empty()) {
+    ::unlink(specPath.c_str());
+  } else if (!folly::writeFile(spec, specPath.c_str())) {
+    PLOG(WARNING) << "Error writing capture filter spec: " << specPath;
+  }
+}
+
 } // anonymous namespace
 
 FifoReadCallback::FifoReadCallback(std::string fifoName,
@@ -157,6 +175,9 @@ void FifoReadCallback::handleMessageHeader(MessageHeader msgHeader) noexcept {
   from_ = msgHeader.getLocalAddress();
   to_ = msgHeader.getPeerAddress();
   typeId_ = msgHeader.typeId();
+  routerProtocol_ = msgHeader.routerProtocol();
+  keyOffset_ = msgHeader.keyOffset();
+  keySize_ = msgHeader.keySize();
   if (msgHeader.direction() == MessageDirection::Received) {
     std::swap(from_, to_);
   }
@@ -167,14 +188,144 @@ void FifoReadCallback::forwardMessage(const PacketHeader& header,
   auto data = buf->coalesce();
   CHECK(data.size() == header.packetSize()) << "Invalid header buffer size!";
   if (typeId_ != 0) {
+    folly::StringPiece requestKey;
+    if (keySize_ > 0 &&
+        static_cast<size_t>(keyOffset_) + keySize_ <= data.size()) {
+      requestKey.reset(
+          reinterpret_cast<const char*>(data.data()) + keyOffset_, keySize_);
+    }
     messageReady_(header.connectionId(), header.packetId(),
-                  std::move(from_), std::move(to_), typeId_, data);
+                  std::move(from_), std::move(to_), typeId_,
+                  routerProtocol_, requestKey, data);
     typeId_ = 0;
   } else {
     VLOG(2) << "Type id is 0. Skipping message.";
   }
 }
 
+RingFifoReader::RingFifoReader(folly::EventBase& evb,
+                               std::string path,
+                               const MessageReadyFn& messageReady)
+    : evb_(evb),
+      path_(std::move(path)),
+      readCallback_(path_, messageReady) {
+  runPoll();
+}
+
+RingFifoReader::~RingFifoReader() {
+  if (header_) {
+    // Detach: the writer stops capturing once the heartbeat goes stale.
+    header_->readerHeartbeatUs.store(0, std::memory_order_release);
+    munmap(header_, sizeof(RingFileHeader) + capacity_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool RingFifoReader::tryMap() noexcept {
+  int fd = ::open(path_.c_str(), O_RDWR);
+  if (fd < 0) {
+    return false;
+  }
+
+  RingFileHeader headerCopy;
+  if (folly::readFull(fd, &headerCopy, sizeof(headerCopy)) !=
+          sizeof(headerCopy) ||
+      headerCopy.magic != kRingFileMagic) {
+    // Not (yet) initialized by a writer.
+    close(fd);
+    return false;
+  }
+
+  const size_t capacity = headerCopy.capacity;
+  void* mem = mmap(nullptr,
+                   sizeof(RingFileHeader) + capacity,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED,
+                   fd,
+                   0);
+  if (mem == MAP_FAILED) {
+    PLOG(WARNING) << "Error mapping debug ring \"" << path_ << "\"";
+    close(fd);
+    return false;
+  }
+
+  fd_ = fd;
+  capacity_ = capacity;
+  header_ = reinterpret_cast<RingFileHeader*>(mem);
+  data_ = reinterpret_cast<const char*>(mem) + sizeof(RingFileHeader);
+  LOG(INFO) << "Reading debug ring \"" << path_ << "\" ("
+            << capacity_ << " bytes)";
+  return true;
+}
+
+void RingFifoReader::copyOut(void* dst, uint64_t offset, size_t len) const {
+  const size_t pos = offset & (capacity_ - 1);
+  const size_t firstChunk = std::min(len, capacity_ - pos);
+  std::memcpy(dst, data_ + pos, firstChunk);
+  if (len > firstChunk) {
+    std::memcpy(reinterpret_cast<char*>(dst) + firstChunk,
+                data_,
+                len - firstChunk);
+  }
+}
+
+void RingFifoReader::runPoll() {
+  if (header_ || tryMap()) {
+    using namespace std::chrono;
+    header_->readerHeartbeatUs.store(
+        duration_cast<microseconds>(system_clock::now().time_since_epoch())
+            .count(),
+        std::memory_order_relaxed);
+
+    const auto writePos = header_->writePos.load(std::memory_order_acquire);
+    auto readPos = header_->readPos.load(std::memory_order_relaxed);
+    while (writePos - readPos >= sizeof(RingRecordHeader)) {
+      RingRecordHeader record;
+      copyOut(&record, readPos, sizeof(RingRecordHeader));
+      if (record.magic != kRingRecordMagic || record.size > capacity_) {
+        LOG(ERROR) << "Corrupt record in debug ring \"" << path_
+                   << "\"; skipping to the write position.";
+        readPos = writePos;
+        break;
+      }
+      if (writePos - readPos < sizeof(RingRecordHeader) + record.size) {
+        break;
+      }
+
+      if (lastSeqId_ != 0 && record.seqId > lastSeqId_ + 1) {
+        VLOG(1) << "Debug ring \"" << path_ << "\" dropped "
+                << (record.seqId - lastSeqId_ - 1) << " record(s)";
+      }
+      lastSeqId_ = record.seqId;
+
+      uint64_t offset = readPos + sizeof(RingRecordHeader);
+      size_t remaining = record.size;
+      while (remaining > 0) {
+        void* buf;
+        size_t len;
+        readCallback_.getReadBuffer(&buf, &len);
+        const size_t toCopy = std::min(len, remaining);
+        copyOut(buf, offset, toCopy);
+        readCallback_.readDataAvailable(toCopy);
+        offset += toCopy;
+        remaining -= toCopy;
+      }
+
+      readPos += sizeof(RingRecordHeader) + record.size;
+      header_->readPos.store(readPos, std::memory_order_release);
+    }
+    if (readPos != header_->readPos.load(std::memory_order_relaxed)) {
+      header_->readPos.store(readPos, std::memory_order_release);
+    }
+  }
+
+  evb_.runAfterDelay([this]() {
+      runPoll();
+    }, kPollIntervalMs);
+}
+
 void FifoReadCallback::readEOF() noexcept {
   LOG(INFO) << "Fifo \"" << fifoName_ << "\" disconnected";
 }
@@ -185,11 +336,13 @@ void FifoReadCallback::readErr(const folly::AsyncSocketException& e) noexcept {
 
 FifoReaderManager::FifoReaderManager(
     folly::EventBase& evb, MessageReadyFn messageReady, std::string dir,
-    std::unique_ptr<boost::regex> filenamePattern)
+    std::unique_ptr<boost::regex> filenamePattern,
+    std::string filterSpec)
     : evb_(evb),
       messageReady_(std::move(messageReady)),
       directory_(std::move(dir)),
-      filenamePattern_(std::move(filenamePattern)) {
+      filenamePattern_(std::move(filenamePattern)),
+      filterSpec_(std::move(filterSpec)) {
   runScanDirectory();
 }
 
@@ -208,6 +361,10 @@ std::vector<std::string> FifoReaderManager::getMatchedFiles() const {
           continue;
         }
         auto& path = it->path();
+        // Capture filter spec files sit next to the fifos they describe.
+        if (folly::StringPiece(path.filename().string()).endsWith(".filter")) {
+          continue;
+        }
         if (!filenamePattern_ ||
             boost::regex_search(path.filename().string(),
                                 *filenamePattern_,
@@ -227,9 +384,22 @@ std::vector<std::string> FifoReaderManager::getMatchedFiles() const {
 void FifoReaderManager::runScanDirectory() {
   auto fifos = getMatchedFiles();
   for (const auto& fifo : fifos) {
+    // Shared-memory rings are polled rather than read as pipes.
+    if (folly::StringPiece(fifo).endsWith(".ring")) {
+      if (ringReaders_.find(fifo) == ringReaders_.end()) {
+        placeFilterSpec(fifo, filterSpec_);
+        ringReaders_.emplace(
+            fifo,
+            folly::make_unique<RingFifoReader>(evb_, fifo, messageReady_));
+      }
+      continue;
+    }
     if (fifoReaders_.find(fifo) != fifoReaders_.end()) {
       continue;
     }
+    // The spec must be in place before the open() below, which is what
+    // makes the writer consider the fifo connected and load the filter.
+    placeFilterSpec(fifo, filterSpec_);
     auto fd = ::open(fifo.c_str(), O_RDONLY | O_NONBLOCK);
     if (fd >= 0) {
       auto pipeReader = folly::AsyncPipeReader::UniquePtr(
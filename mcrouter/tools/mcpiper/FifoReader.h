@@ -20,9 +20,11 @@
 #include <folly/io/async/AsyncSocketException.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/Optional.h>
+#include <folly/Range.h>
 #include <folly/SocketAddress.h>
 
 #include "mcrouter/lib/debug/ConnectionFifoProtocol.h"
+#include "mcrouter/lib/debug/RingFifoProtocol.h"
 
 namespace folly {
 class EventBase;
@@ -35,17 +37,26 @@ class FifoReader;
 /**
  * Function called when a message is completely read from the fifo.
  *
- * @param connectionId  Id of the connection.
- * @param packetId      Id of the packet.
- * @param from          Address of the endpoint that sent the message.
- * @param to            Address of the endpoint that received the message.
- * @param data          The data of the message.
+ * @param connectionId    Id of the connection.
+ * @param packetId        Id of the packet.
+ * @param from            Address of the endpoint that sent the message.
+ * @param to              Address of the endpoint that received the message.
+ * @param typeId          Id of the type of the message.
+ * @param routerProtocol  Protocol of the captured stream, as reported by
+ *                        the writer; mc_unknown_protocol if the writer
+ *                        did not know it (or is too old to say).
+ * @param requestKey      Key of the message, when its position was
+ *                        carried by the capture header; points into
+ *                        data. Empty if unknown.
+ * @param data            The data of the message.
  */
 using MessageReadyFn = std::function<void(uint64_t connectionId,
                                           uint64_t packetId,
                                           folly::SocketAddress from,
                                           folly::SocketAddress to,
                                           uint32_t typeId,
+                                          mc_protocol_t routerProtocol,
+                                          folly::StringPiece requestKey,
                                           folly::ByteRange data)>;
 
 class FifoReadCallback : public folly::AsyncReader::ReadCallback {
@@ -73,12 +84,54 @@ class FifoReadCallback : public folly::AsyncReader::ReadCallback {
   folly::SocketAddress to_;
   uint32_t typeId_{0};
 
+  // Parse metadata carried by version 4+ message headers.
+  mc_protocol_t routerProtocol_{mc_unknown_protocol};
+  uint32_t keyOffset_{0};
+  uint16_t keySize_{0};
+
   void forwardMessage(const PacketHeader& header,
                       std::unique_ptr<folly::IOBuf> buf);
 
   void handleMessageHeader(MessageHeader msgHeader) noexcept;
 };
 
+/**
+ * Reads a shared-memory ring fifo (see lib/debug/RingFifoProtocol.h).
+ *
+ * Polls the mapped ring on the event base, publishes the reader
+ * heartbeat (which is what makes the writer consider the ring
+ * connected), and feeds the payload of complete records to a
+ * FifoReadCallback, which parses it exactly like the pipe byte stream.
+ */
+class RingFifoReader {
+ public:
+  RingFifoReader(folly::EventBase& evb,
+                 std::string path,
+                 const MessageReadyFn& messageReady);
+  ~RingFifoReader();
+
+  // non-copyable
+  RingFifoReader(const RingFifoReader&) = delete;
+  RingFifoReader& operator=(const RingFifoReader&) = delete;
+
+ private:
+  static constexpr size_t kPollIntervalMs = 10;
+
+  folly::EventBase& evb_;
+  const std::string path_;
+  FifoReadCallback readCallback_;
+
+  RingFileHeader* header_{nullptr};
+  const char* data_{nullptr};
+  size_t capacity_{0};
+  int fd_{-1};
+  uint64_t lastSeqId_{0};
+
+  bool tryMap() noexcept;
+  void runPoll();
+  void copyOut(void* dst, uint64_t offset, size_t len) const;
+};
+
 /**
  * Manages all fifo readers in a directory.
  */
@@ -96,11 +149,18 @@ class FifoReaderManager {
    *                        read from the fifo.
    * @param dir             Directory to watch.
    * @param filenamePattern Regex that file names must match.
+   * @param filterSpec      Capture filter spec (see lib/debug/
+   *                        FifoDebugFilter.h) placed at "<fifo>.filter"
+   *                        before each fifo is opened, so the writer
+   *                        drops unmatched traffic instead of copying
+   *                        it. Empty means capture everything; any
+   *                        stale spec file is then removed.
    */
   FifoReaderManager(folly::EventBase& evb,
                     MessageReadyFn messageReady,
                     std::string dir,
-                    std::unique_ptr<boost::regex> filenamePattern);
+                    std::unique_ptr<boost::regex> filenamePattern,
+                    std::string filterSpec);
 
   // non-copyable
   FifoReaderManager(const FifoReaderManager&) = delete;
@@ -115,7 +175,10 @@ class FifoReaderManager {
   MessageReadyFn messageReady_;
   const std::string directory_;
   const std::unique_ptr<boost::regex> filenamePattern_;
+  const std::string filterSpec_;
   std::unordered_map<std::string, FifoReader> fifoReaders_;
+  std::unordered_map<std::string, std::unique_ptr<RingFifoReader>>
+      ringReaders_;
 
   std::vector<std::string> getMatchedFiles() const;
   void runScanDirectory();
@@ -0,0 +1,173 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "MessageAggregator.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/Format.h>
+#include <folly/SpookyHashV2.h>
+#include <folly/String.h>
+
+#include "mcrouter/lib/McResUtil.h"
+
+namespace facebook { namespace memcache {
+
+constexpr size_t MessageAggregator::kSketchDepth;
+constexpr size_t MessageAggregator::kSketchWidth;
+
+MessageAggregator::MessageAggregator(size_t topKeysCount)
+    : topKeysCount_(topKeysCount),
+      sketch_(kSketchDepth * kSketchWidth, 0) {
+}
+
+uint64_t MessageAggregator::sketchAdd(folly::StringPiece key) {
+  uint64_t h1 = 0;
+  uint64_t h2 = 0;
+  folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+
+  uint64_t estimate = std::numeric_limits<uint64_t>::max();
+  for (size_t row = 0; row < kSketchDepth; ++row) {
+    auto& counter = sketch_[row * kSketchWidth + ((h1 + row * h2) &
+                                                  (kSketchWidth - 1))];
+    ++counter;
+    estimate = std::min(estimate, counter);
+  }
+  return estimate;
+}
+
+void MessageAggregator::refreshTopKeysMin() {
+  topKeysMin_ = std::numeric_limits<uint64_t>::max();
+  for (const auto& entry : topKeys_) {
+    topKeysMin_ = std::min(topKeysMin_, entry.second);
+  }
+}
+
+void MessageAggregator::updateTopKeys(folly::StringPiece key,
+                                      uint64_t estimate) {
+  auto it = topKeys_.find(key.str());
+  if (it != topKeys_.end()) {
+    it->second = estimate;
+    return;
+  }
+
+  if (topKeys_.size() < topKeysCount_) {
+    topKeys_.emplace(key.str(), estimate);
+    if (topKeys_.size() == topKeysCount_) {
+      refreshTopKeysMin();
+    }
+    return;
+  }
+
+  if (estimate <= topKeysMin_) {
+    return;
+  }
+  // Evict the current smallest entry to make room.
+  auto minIt = std::min_element(
+      topKeys_.begin(),
+      topKeys_.end(),
+      [](const std::pair<const std::string, uint64_t>& a,
+         const std::pair<const std::string, uint64_t>& b) {
+        return a.second < b.second;
+      });
+  topKeys_.erase(minIt);
+  topKeys_.emplace(key.str(), estimate);
+  refreshTopKeysMin();
+}
+
+void MessageAggregator::addRequest(folly::StringPiece key) {
+  ++requests_;
+  if (key.empty() || topKeysCount_ == 0) {
+    return;
+  }
+  updateTopKeys(key, sketchAdd(key));
+}
+
+void MessageAggregator::addReply(mc_res_t result,
+                                 size_t valueSize,
+                                 int64_t latencyUs) {
+  ++replies_;
+  if (isErrorResult(result)) {
+    ++errors_;
+  } else if (isHitResult(result)) {
+    ++hits_;
+  } else if (isMissResult(result)) {
+    ++misses_;
+  }
+  valueSizes_.insertSample(valueSize);
+  if (latencyUs > 0) {
+    latenciesUs_.insertSample(latencyUs);
+  }
+}
+
+std::string MessageAggregator::summarizeAndReset(double windowSeconds) {
+  std::string out;
+
+  out.append(folly::sformat("\n=== last {:.1f}s ===\n", windowSeconds));
+  out.append(folly::sformat(
+      "requests: {} ({:.0f}/s)  replies: {}\n",
+      requests_,
+      windowSeconds > 0 ? requests_ / windowSeconds : 0.0,
+      replies_));
+  if (replies_ > 0) {
+    out.append(folly::sformat(
+        "hits: {}  misses: {}  errors: {}", hits_, misses_, errors_));
+    if (hits_ + misses_ > 0) {
+      out.append(folly::sformat(
+          "  hit rate: {:.1f}%", 100.0 * hits_ / (hits_ + misses_)));
+    }
+    out.push_back('\n');
+  }
+  if (latenciesUs_.count() > 0) {
+    out.append(folly::sformat(
+        "latency (us): p50 {}  p95 {}  p99 {}  p999 {}\n",
+        latenciesUs_.getPercentile(0.5),
+        latenciesUs_.getPercentile(0.95),
+        latenciesUs_.getPercentile(0.99),
+        latenciesUs_.getPercentile(0.999)));
+  }
+  if (valueSizes_.count() > 0) {
+    out.append(folly::sformat(
+        "value size (bytes): p50 {}  p99 {}\n",
+        valueSizes_.getPercentile(0.5),
+        valueSizes_.getPercentile(0.99)));
+  }
+  if (!topKeys_.empty()) {
+    std::vector<std::pair<uint64_t, folly::StringPiece>> hotKeys;
+    hotKeys.reserve(topKeys_.size());
+    for (const auto& entry : topKeys_) {
+      hotKeys.emplace_back(entry.second, entry.first);
+    }
+    std::sort(hotKeys.begin(),
+              hotKeys.end(),
+              [](const std::pair<uint64_t, folly::StringPiece>& a,
+                 const std::pair<uint64_t, folly::StringPiece>& b) {
+                return a.first > b.first;
+              });
+    out.append(folly::sformat(
+        "top {} keys (count-min estimates):\n", hotKeys.size()));
+    for (const auto& entry : hotKeys) {
+      out.append(folly::sformat(
+          "  ~{} {}\n", entry.first, folly::backslashify(entry.second.str())));
+    }
+  }
+
+  // Start a new window.
+  std::fill(sketch_.begin(), sketch_.end(), 0);
+  topKeys_.clear();
+  topKeysMin_ = 0;
+  requests_ = replies_ = hits_ = misses_ = errors_ = 0;
+  valueSizes_ = mcrouter::LogScaleHistogram<>();
+  latenciesUs_ = mcrouter::LogScaleHistogram<>();
+
+  return out;
+}
+
+}} // facebook::memcache
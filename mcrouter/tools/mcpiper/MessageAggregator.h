@@ -0,0 +1,91 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Range.h>
+
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/LogScaleHistogram.h"
+
+namespace facebook { namespace memcache {
+
+/**
+ * Online aggregation of sniffed traffic, used by mcpiper's aggregate
+ * mode instead of printing every message.
+ *
+ * Key frequencies are estimated with a count-min sketch and the keys
+ * with the largest estimates are kept in a bounded top-k set, so memory
+ * stays fixed no matter how many distinct keys fly by.  Value sizes and
+ * request-to-reply latencies are recorded in log-scale histograms.
+ * All state belongs to the current reporting window and is reset when
+ * a summary is rendered.
+ */
+class MessageAggregator {
+ public:
+  explicit MessageAggregator(size_t topKeysCount);
+
+  void addRequest(folly::StringPiece key);
+
+  /**
+   * Records one reply.
+   *
+   * @param result     Reply result, used for hit/miss/error counts.
+   * @param valueSize  Size of the reply value, in bytes.
+   * @param latencyUs  Time since the matching request was sniffed, in
+   *                   microseconds, or 0 if the request wasn't matched.
+   */
+  void addReply(mc_res_t result, size_t valueSize, int64_t latencyUs);
+
+  /**
+   * Renders the summary of the current window and starts a new one.
+   *
+   * @param windowSeconds  Wall time covered by the window, for rates.
+   */
+  std::string summarizeAndReset(double windowSeconds);
+
+ private:
+  // Sketch geometry: 4 rows of 16k counters keep collisions negligible
+  // for the key cardinalities a single reporting window sees.
+  static constexpr size_t kSketchDepth = 4;
+  static constexpr size_t kSketchWidth = 1 << 14;
+
+  const size_t topKeysCount_;
+  std::vector<uint64_t> sketch_;
+
+  // Key -> estimated count; at most topKeysCount_ entries.
+  std::unordered_map<std::string, uint64_t> topKeys_;
+  // Smallest estimate in topKeys_ once it's full.  May lag behind if
+  // the smallest entry keeps growing; that only admits new keys a bit
+  // too eagerly.
+  uint64_t topKeysMin_{0};
+
+  uint64_t requests_{0};
+  uint64_t replies_{0};
+  uint64_t hits_{0};
+  uint64_t misses_{0};
+  uint64_t errors_{0};
+  mcrouter::LogScaleHistogram<> valueSizes_;
+  mcrouter::LogScaleHistogram<> latenciesUs_;
+
+  /**
+   * Increments the key's counters and returns the new count-min
+   * estimate (the smallest of the incremented cells).
+   */
+  uint64_t sketchAdd(folly::StringPiece key);
+
+  void updateTopKeys(folly::StringPiece key, uint64_t estimate);
+  void refreshTopKeysMin();
+};
+
+}} // facebook::memcache
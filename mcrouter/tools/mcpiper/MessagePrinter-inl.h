@@ -70,6 +70,18 @@ void MessagePrinter::requestReady(uint64_t msgId,
                                   const folly::SocketAddress& to,
                                   mc_protocol_t protocol) {
   auto key = request.fullKey().str();
+  if (aggregator_) {
+    if (Request::OpType::mc_op != mc_op_end) {
+      ++totalMessages_;
+      if (matchAddress(from, to) && matchKey(key) &&
+          (!filter_.protocol.hasValue() ||
+           filter_.protocol.value() == protocol)) {
+        aggregator_->addRequest(key);
+      }
+      maybeEmitAggregationSummary();
+    }
+    return;
+  }
   printMessage(
       msgId,
       std::move(request),
@@ -85,9 +97,23 @@ template <class Reply>
 void MessagePrinter::replyReady(uint64_t msgId,
                                 Reply&& reply,
                                 std::string key,
+                                int64_t latencyUs,
                                 const folly::SocketAddress& from,
                                 const folly::SocketAddress& to,
                                 mc_protocol_t protocol) {
+  if (aggregator_) {
+    if (Reply::OpType::mc_op != mc_op_end) {
+      ++totalMessages_;
+      if (matchAddress(from, to) && matchKey(key) &&
+          (!filter_.protocol.hasValue() ||
+           filter_.protocol.value() == protocol)) {
+        aggregator_->addReply(
+            reply.result(), reply.valueRangeSlow().size(), latencyUs);
+      }
+      maybeEmitAggregationSummary();
+    }
+    return;
+  }
   printMessage(msgId, std::move(reply), key, Reply::OpType::mc_op,
                reply.result(), from, to, protocol);
 }
@@ -9,6 +9,8 @@
  */
 #include "MessagePrinter.h"
 
+#include <folly/Memory.h>
+
 namespace facebook { namespace memcache {
 
 namespace {
@@ -33,6 +35,64 @@ MessagePrinter::MessagePrinter(Options options,
   if (options_.disableColor) {
     targetOut_.setColorOutput(false);
   }
+  if (options_.aggregationIntervalMs > 0) {
+    aggregator_ = folly::make_unique<MessageAggregator>(options_.topKeysCount);
+    lastAggregationSummary_ = std::chrono::steady_clock::now();
+  }
+}
+
+bool MessagePrinter::handlePreParsed(mc_protocol_t protocol,
+                                     folly::StringPiece requestKey,
+                                     const folly::SocketAddress& from,
+                                     const folly::SocketAddress& to) {
+  // Protocol mismatches would be dropped after parsing anyway; drop
+  // them here, before any parsing work is done.
+  if (protocol != mc_unknown_protocol && filter_.protocol.hasValue() &&
+      filter_.protocol.value() != protocol) {
+    ++totalMessages_;
+    if (aggregator_) {
+      maybeEmitAggregationSummary();
+    }
+    return true;
+  }
+
+  // In aggregation mode, requests are consumed entirely by their key,
+  // so a header-carried key makes parsing the body unnecessary.
+  if (aggregator_ && !requestKey.empty() &&
+      (protocol != mc_unknown_protocol || !filter_.protocol.hasValue())) {
+    ++totalMessages_;
+    if (matchAddress(from, to) && matchKey(requestKey)) {
+      aggregator_->addRequest(requestKey);
+    }
+    maybeEmitAggregationSummary();
+    return true;
+  }
+
+  return false;
+}
+
+bool MessagePrinter::matchKey(folly::StringPiece key) const {
+  if (!filter_.pattern) {
+    return true;
+  }
+  bool found = boost::regex_search(key.begin(), key.end(), *filter_.pattern);
+  return found != filter_.invertMatch;
+}
+
+void MessagePrinter::maybeEmitAggregationSummary() {
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = now - lastAggregationSummary_;
+  if (elapsed < std::chrono::milliseconds(options_.aggregationIntervalMs)) {
+    return;
+  }
+
+  StyledString out;
+  out.append(aggregator_->summarizeAndReset(
+      std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
+          .count()));
+  targetOut_ << out;
+  targetOut_.flush();
+  lastAggregationSummary_ = now;
 }
 
 bool MessagePrinter::matchAddress(const folly::SocketAddress& from,
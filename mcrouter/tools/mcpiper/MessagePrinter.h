@@ -9,13 +9,16 @@
  */
 #pragma once
 
+#include <chrono>
 #include <iostream>
+#include <memory>
 
 #include <boost/regex.hpp>
 #include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
 
 #include "mcrouter/tools/mcpiper/AnsiColorCodeStream.h"
+#include "mcrouter/tools/mcpiper/MessageAggregator.h"
 #include "mcrouter/tools/mcpiper/PrettyFormat.h"
 #include "mcrouter/tools/mcpiper/SnifferParser.h"
 #include "mcrouter/tools/mcpiper/StyledString.h"
@@ -48,6 +51,14 @@ class MessagePrinter {
     // Disable nice coloring.
     bool disableColor{false};
 
+    // If nonzero, aggregate mode: instead of printing messages, emit a
+    // summary (top keys, hit rate, latency percentiles) every this many
+    // milliseconds.
+    uint32_t aggregationIntervalMs{0};
+
+    // Number of hot keys tracked in aggregate mode.
+    size_t topKeysCount{20};
+
     // Callback that will be called when application should stop
     // sending messages to MessagePrinter.
     std::function<void(const MessagePrinter&)> stopRunningFn =
@@ -86,6 +97,27 @@ class MessagePrinter {
     return std::make_pair(totalMessages_, printedMessages_);
   }
 
+  /**
+   * Offers a captured message before its body is parsed, based on the
+   * metadata carried by the capture protocol (see MessageHeader).
+   *
+   * @param protocol    Protocol of the captured stream;
+   *                    mc_unknown_protocol if the writer didn't say.
+   * @param requestKey  Key of the message, when carried by the capture
+   *                    header. Empty if unknown.
+   * @param from        Address that sent the message.
+   * @param to          Address to where the message was sent.
+   *
+   * @return            True if the message was fully handled (dropped
+   *                    by the protocol filter or, in aggregation mode,
+   *                    a request counted straight from its key) and
+   *                    parsing its body can be skipped.
+   */
+  bool handlePreParsed(mc_protocol_t protocol,
+                       folly::StringPiece requestKey,
+                       const folly::SocketAddress& from,
+                       const folly::SocketAddress& to);
+
   template <class Message>
   void printMessage(uint64_t msgId,
                     Message&& message,
@@ -107,6 +139,10 @@ class MessagePrinter {
   uint64_t printedMessages_{0};
   uint32_t afterMatchCount_{0};
 
+  // Present iff options_.aggregationIntervalMs > 0.
+  std::unique_ptr<MessageAggregator> aggregator_;
+  std::chrono::steady_clock::time_point lastAggregationSummary_;
+
   // SnifferParser Callbacks
   template <class Request>
   void requestReady(uint64_t msgId,
@@ -118,6 +154,7 @@ class MessagePrinter {
   void replyReady(uint64_t msgId,
                   Reply&& reply,
                   std::string key,
+                  int64_t latencyUs,
                   const folly::SocketAddress& from,
                   const folly::SocketAddress& to,
                   mc_protocol_t protocol);
@@ -138,6 +175,20 @@ class MessagePrinter {
   bool matchAddress(const folly::SocketAddress& from,
                     const folly::SocketAddress& to) const;
 
+  /**
+   * Tells whether a key passes the pattern filter.  Used in aggregate
+   * mode, where the pattern is matched against the raw key instead of
+   * the formatted message.
+   */
+  bool matchKey(folly::StringPiece key) const;
+
+  /**
+   * Prints the aggregated summary and starts a new window if the
+   * reporting interval has elapsed.  Called from the message path, so
+   * summaries are only emitted while traffic is flowing.
+   */
+  void maybeEmitAggregationSummary();
+
   /**
    * Matches all the occurences of "pattern" in "text"
    *
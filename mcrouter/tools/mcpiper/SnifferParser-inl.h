@@ -59,10 +59,13 @@ template <class Callback>
 template <class Reply>
 void SnifferParser<Callback>::replyReady(uint64_t msgId, Reply&& reply) {
   std::string key;
+  int64_t latencyUs = 0;
   if (msgId != 0) {
     auto pairMsgIt = msgs_.find(msgId);
     if (pairMsgIt != msgs_.end()) {
       key = std::move(pairMsgIt->second.key);
+      latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - pairMsgIt->second.created).count();
       msgs_.erase(pairMsgIt->first);
     }
   }
@@ -70,6 +73,7 @@ void SnifferParser<Callback>::replyReady(uint64_t msgId, Reply&& reply) {
       msgId,
       std::move(reply),
       std::move(key),
+      latencyUs,
       fromAddress_,
       toAddress_,
       parser_.getProtocol());
@@ -26,7 +26,10 @@ namespace facebook { namespace memcache {
  *
  * @param Callback  Callback containing two functions:
  *                  void requestReady(msgId, request, from, to, protocol);
- *                  void replyReady(msgId, reply, key, from, to, protocol);
+ *                  void replyReady(msgId, reply, key, latencyUs,
+ *                                  from, to, protocol);
+ *                  latencyUs is the time since the matching request was
+ *                  parsed, or 0 if the request wasn't seen.
  */
 template <class Callback>
 class SnifferParser {
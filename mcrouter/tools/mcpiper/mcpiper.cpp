@@ -39,17 +39,20 @@ struct Settings {
   std::string matchExpression;
 
   // Named args
+  uint32_t aggregationInterval{0};
   bool disableColor{false};
   std::string fifoRoot{getDefaultFifoRoot()};
   std::string filenamePattern;
   std::string host;
   bool ignoreCase{false};
   bool invertMatch{false};
+  std::string keyPrefix;
   uint32_t maxMessages{0};
   uint32_t numAfterMatch{0};
   uint16_t port{0};
   bool quiet{false};
   std::string timeFormat;
+  uint32_t topKeys{20};
   uint32_t valueMinSize{0};
   size_t verboseLevel{0};
   std::string protocol;
@@ -78,6 +81,10 @@ Settings parseOptions(int argc, char **argv) {
   namedOpts.add_options()
     ("help,h", "Print this help message.")
     ("version", "Print mcpiper version and exit.")
+    ("aggregate,a",
+      po::value<uint32_t>(&settings.aggregationInterval)->implicit_value(10),
+      "Instead of printing messages, show an aggregated summary (top keys, "
+      "hit rate, latency percentiles) every <arg> seconds.")
     ("disable-color,K",
       po::bool_switch(&settings.disableColor)->default_value(false),
       "Turn off colorized output.")
@@ -96,6 +103,11 @@ Settings parseOptions(int argc, char **argv) {
     ("invert-match,v",
       po::bool_switch(&settings.invertMatch)->default_value(false),
       "Invert match")
+    ("key-prefix,k",
+      po::value<std::string>(&settings.keyPrefix),
+      "Only capture messages containing <arg>. Unlike PATTERN, this filter "
+      "is pushed down to mcrouter and applied before messages are copied "
+      "into the fifos, so unmatched traffic costs nothing to capture.")
     ("max-messages,n",
       po::value<uint32_t>(&settings.maxMessages),
       "Display only <arg> messages and exit.")
@@ -112,6 +124,9 @@ Settings parseOptions(int argc, char **argv) {
       po::value<std::string>(&settings.timeFormat),
       "Displays timestamp on every match; "
       "ARG is \"absolute\", \"diff\" or \"offset\".")
+    ("top-keys",
+      po::value<uint32_t>(&settings.topKeys),
+      "Number of hot keys to track in aggregate mode (see --aggregate).")
     ("value-min-size,m",
       po::value<uint32_t>(&settings.valueMinSize),
       "Minimum size of the value of messages to display")
@@ -195,6 +210,8 @@ MessagePrinter::Options getOptions(const Settings& settings) {
   options.quiet = settings.quiet;
   options.maxMessages = settings.maxMessages;
   options.disableColor = settings.disableColor;
+  options.aggregationIntervalMs = settings.aggregationInterval * 1000;
+  options.topKeysCount = settings.topKeys;
 
   // Time Function
   static struct timeval prevTs = {0, 0};
@@ -284,6 +301,15 @@ void run(Settings settings) {
     std::cout << "Filename pattern: " << *filenamePattern << std::endl;
   }
 
+  // Builds the capture filter spec pushed down to mcrouter
+  // (see lib/debug/FifoDebugFilter.h).
+  std::string filterSpec;
+  if (!settings.keyPrefix.empty()) {
+    filterSpec = folly::sformat("key_prefix={}\n", settings.keyPrefix);
+    std::cout << "Key prefix (pushed down): " << settings.keyPrefix
+              << std::endl;
+  }
+
   MessagePrinter messagePrinter(getOptions(settings),
                                 getFilter(settings),
                                 createValueFormatter());
@@ -296,7 +322,17 @@ void run(Settings settings) {
                                   folly::SocketAddress from,
                                   folly::SocketAddress to,
                                   uint32_t typeId,
+                                  mc_protocol_t routerProtocol,
+                                  folly::StringPiece requestKey,
                                   folly::ByteRange data) {
+      // Metadata carried by the capture header may be enough to handle
+      // the message without parsing its body at all.
+      if (packetId == 0 &&
+          messagePrinter.handlePreParsed(routerProtocol, requestKey,
+                                         from, to)) {
+        return;
+      }
+
       auto it = parserMap.find(connectionId);
       if (it == parserMap.end()) {
         it = parserMap.emplace(std::piecewise_construct,
@@ -316,7 +352,8 @@ void run(Settings settings) {
 
   folly::EventBase eventBase;
   FifoReaderManager fifoManager(eventBase, fifoReaderCallback,
-                                settings.fifoRoot, std::move(filenamePattern));
+                                settings.fifoRoot, std::move(filenamePattern),
+                                std::move(filterSpec));
 
   while (eventBase.loopOnce()) {
     // Update stats
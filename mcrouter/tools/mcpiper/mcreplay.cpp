@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <folly/FileUtil.h>
+#include <folly/Range.h>
+
+#include "mcrouter/config.h"
+#include "mcrouter/lib/debug/ConnectionFifoProtocol.h"
+#include "mcrouter/lib/mc/msg.h"
+#include "mcrouter/tools/mcpiper/ClientServerMcParser.h"
+
+/**
+ * Parser replay harness: re-parses traffic captured from mcrouter's debug
+ * fifos (save a fifo to a file with e.g. "cat /var/mcrouter/fifos/... >
+ * trace") through the same ClientServerMcParser stack that mcpiper uses,
+ * as fast as the parsers will go. Prints throughput (MB/s, messages/s) to
+ * stderr and a stable parse digest - per-type request counts, per-result
+ * reply counts, key and value byte totals - to stdout.
+ *
+ * The digest is the point: parser changes ship with before/after numbers
+ * on real traffic shapes, and running old and new binaries over the same
+ * trace and diffing their stdout asserts the two parser builds agree on
+ * every message. --chunk-bytes re-feeds packets in small pieces to
+ * exercise the parsers' cross-buffer resume paths, where ragel state
+ * machine bugs like to hide.
+ *
+ * Usage:
+ *   mcreplay trace1 [trace2 ...]
+ *   mcreplay --repeat=100 --chunk-bytes=7 trace1
+ */
+
+DEFINE_int64(repeat, 1, "Number of times to replay each trace");
+DEFINE_int64(chunk_bytes, 0,
+             "Feed each packet to the parser in chunks of at most this many "
+             "bytes (0 = whole packets)");
+
+using namespace facebook::memcache;
+
+namespace {
+
+/**
+ * Accumulates a deterministic summary of everything the parsers produced.
+ * std::map keeps the output ordering stable so that two runs (or two
+ * builds) can be compared with diff.
+ */
+class ReplayDigest {
+ public:
+  template <class Request>
+  void requestReady(uint64_t /* msgId */, Request&& request) {
+    auto& entry = requests_[Request::name];
+    ++entry.count;
+    entry.bytes += request.fullKey().size();
+  }
+
+  template <class Reply>
+  void replyReady(uint64_t /* msgId */, Reply&& reply) {
+    auto& entry = replies_[mc_res_to_string(reply.result())];
+    ++entry.count;
+    if (const auto* value = reply.valuePtrUnsafe()) {
+      entry.bytes += value->computeChainDataLength();
+    }
+  }
+
+  uint64_t totalMessages() const {
+    uint64_t total = 0;
+    for (const auto& it : requests_) {
+      total += it.second.count;
+    }
+    for (const auto& it : replies_) {
+      total += it.second.count;
+    }
+    return total;
+  }
+
+  void print(std::ostream& out) const {
+    for (const auto& it : requests_) {
+      out << "request " << it.first << ": " << it.second.count
+          << " messages, " << it.second.bytes << " key bytes" << std::endl;
+    }
+    for (const auto& it : replies_) {
+      out << "reply " << it.first << ": " << it.second.count
+          << " messages, " << it.second.bytes << " value bytes" << std::endl;
+    }
+  }
+
+ private:
+  struct Entry {
+    uint64_t count{0};
+    uint64_t bytes{0};
+  };
+
+  std::map<std::string, Entry> requests_;
+  std::map<std::string, Entry> replies_;
+};
+
+/** One fifo packet, pointing into the loaded trace buffer. */
+struct Packet {
+  uint64_t connectionId;
+  uint32_t packetId;
+  uint32_t typeId;
+  folly::ByteRange data;
+};
+
+/**
+ * Splits a saved fifo stream into packets, mirroring the framing that
+ * FifoReadCallback parses incrementally: an optional MessageHeader
+ * (identified by its magic) followed by PacketHeader + body, with
+ * continuation packets of large messages carrying only a PacketHeader.
+ * A truncated tail - the fifo writer stops mid-message on disconnect -
+ * is expected and silently dropped.
+ */
+std::vector<Packet> parseTrace(folly::ByteRange trace) {
+  std::vector<Packet> packets;
+  std::unordered_map<uint64_t, uint32_t> connectionTypeIds;
+
+  const uint8_t* p = trace.begin();
+  const uint8_t* end = trace.end();
+  while (static_cast<size_t>(end - p) >= sizeof(uint32_t)) {
+    uint32_t magic;
+    std::memcpy(&magic, p, sizeof(magic));
+    if (folly::Endian::little(magic) == MessageHeader().magic()) {
+      if (static_cast<size_t>(end - p) < sizeof(uint32_t) + sizeof(uint8_t)) {
+        break;
+      }
+      const size_t headerSize = MessageHeader::size(p[sizeof(uint32_t)]);
+      CHECK(headerSize <= sizeof(MessageHeader))
+        << "MessageHeader struct cannot hold message header data";
+      if (static_cast<size_t>(end - p) < headerSize) {
+        break;
+      }
+      MessageHeader msgHeader;
+      std::memcpy(&msgHeader, p, headerSize);
+      p += headerSize;
+      connectionTypeIds[msgHeader.connectionId()] = msgHeader.typeId();
+    }
+
+    if (static_cast<size_t>(end - p) < sizeof(PacketHeader)) {
+      break;
+    }
+    PacketHeader packetHeader;
+    std::memcpy(&packetHeader, p, sizeof(PacketHeader));
+    p += sizeof(PacketHeader);
+    CHECK(packetHeader.packetSize() <= kFifoMaxPacketSize)
+      << "Packet too large: " << packetHeader.packetSize();
+    if (packetHeader.packetSize() > static_cast<size_t>(end - p)) {
+      break;
+    }
+
+    const auto typeId = connectionTypeIds[packetHeader.connectionId()];
+    if (typeId != 0) {
+      packets.push_back({packetHeader.connectionId(),
+                         packetHeader.packetId(),
+                         typeId,
+                         folly::ByteRange(p, packetHeader.packetSize())});
+    } else {
+      VLOG(2) << "Type id is 0. Skipping message.";
+    }
+    p += packetHeader.packetSize();
+  }
+
+  return packets;
+}
+
+/**
+ * Feeds one packet to the parser, optionally split into --chunk-bytes
+ * pieces so that messages straddle parser read buffers.
+ */
+void feedPacket(ClientServerMcParser<ReplayDigest>& parser,
+                const Packet& packet) {
+  const size_t chunkBytes = FLAGS_chunk_bytes > 0
+      ? FLAGS_chunk_bytes
+      : packet.data.size();
+  auto remaining = packet.data;
+  bool isFirstPacket = (packet.packetId == 0);
+  while (!remaining.empty()) {
+    auto chunk = remaining.subpiece(0, std::min(chunkBytes, remaining.size()));
+    parser.parse(chunk, packet.typeId, isFirstPacket);
+    isFirstPacket = false;
+    remaining.advance(chunk.size());
+  }
+}
+
+} // anonymous
+
+// for backward compatibility with gflags
+namespace gflags { } // gflags
+namespace google { using namespace gflags; } // google
+
+int main(int argc, char** argv) {
+  gflags::SetUsageMessage("mcreplay [options] trace_file...");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (argc < 2) {
+    std::cerr << "No trace files given. Save a debug fifo to a file "
+                 "(e.g. cat /var/mcrouter/fifos/<fifo> > trace) and pass "
+                 "it as an argument." << std::endl;
+    return 1;
+  }
+
+  /* Load and frame all traces up front; only parsing is timed. */
+  std::vector<std::string> traces;
+  std::vector<Packet> packets;
+  uint64_t payloadBytes = 0;
+  for (int i = 1; i < argc; ++i) {
+    traces.emplace_back();
+    if (!folly::readFile(argv[i], traces.back())) {
+      PLOG(ERROR) << "Error reading trace file: " << argv[i];
+      return 1;
+    }
+    auto filePackets = parseTrace(folly::StringPiece(traces.back()));
+    LOG(INFO) << argv[i] << ": " << filePackets.size() << " packets, "
+              << traces.back().size() << " bytes";
+    for (auto& packet : filePackets) {
+      payloadBytes += packet.data.size();
+      packets.push_back(std::move(packet));
+    }
+  }
+  if (packets.empty()) {
+    LOG(ERROR) << "No complete packets found in given traces.";
+    return 1;
+  }
+
+  ReplayDigest digest;
+  std::unordered_map<uint64_t,
+                     ClientServerMcParser<ReplayDigest>> parsers;
+
+  const auto startUs = facebook::memcache::mcrouter::nowUs();
+  for (int64_t r = 0; r < FLAGS_repeat; ++r) {
+    /* Fresh parser state per pass, as if the connections reconnected. */
+    for (auto& it : parsers) {
+      it.second.reset();
+    }
+    for (const auto& packet : packets) {
+      auto it = parsers.find(packet.connectionId);
+      if (it == parsers.end()) {
+        it = parsers.emplace(std::piecewise_construct,
+                             std::forward_as_tuple(packet.connectionId),
+                             std::forward_as_tuple(digest)).first;
+      }
+      feedPacket(it->second, packet);
+    }
+  }
+  const double elapsedSec =
+      (facebook::memcache::mcrouter::nowUs() - startUs) / 1e6;
+
+  const uint64_t totalBytes = payloadBytes * FLAGS_repeat;
+  LOG(INFO) << "bytes:      " << totalBytes;
+  LOG(INFO) << "messages:   " << digest.totalMessages();
+  LOG(INFO) << "elapsed:    " << elapsedSec << "s";
+  LOG(INFO) << "MB/s:       " << totalBytes / elapsedSec / (1024 * 1024);
+  LOG(INFO) << "messages/s: "
+            << static_cast<uint64_t>(digest.totalMessages() / elapsedSec);
+
+  digest.print(std::cout);
+  return 0;
+}
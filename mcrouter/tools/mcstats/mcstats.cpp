@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2016, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "mcrouter/StatsDeltaFormat.h"
+
+/**
+ * Dumps a binary delta stats spool (written by mcrouter with
+ * --stats-binary-delta-format) back to text.  By default prints the
+ * reconstructed final value of every counter - the same content the JSON
+ * stats file would hold - after replaying all ticks; --deltas also
+ * prints one line per tick with its timestamp and how many counters
+ * changed.
+ *
+ * Usage:
+ *   mcstats /var/mcrouter/stats/<prefix>.stats_delta
+ */
+
+DEFINE_bool(deltas, false,
+            "Also print a line per tick: timestamp and number of changed "
+            "counters");
+
+using namespace facebook::memcache::mcrouter;
+
+namespace {
+
+void printValue(std::ostream& out, uint8_t type, uint64_t bits) {
+  switch (static_cast<stat_type_t>(type)) {
+    case stat_double: {
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      out << value;
+      break;
+    }
+    case stat_int64:
+      out << static_cast<int64_t>(bits);
+      break;
+    default:
+      out << bits;
+      break;
+  }
+}
+
+} // anonymous
+
+// for backward compatibility with gflags
+namespace gflags { } // gflags
+namespace google { using namespace gflags; } // google
+
+int main(int argc, char** argv) {
+  gflags::SetUsageMessage("mcstats [options] stats_delta_file");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (argc != 2) {
+    std::cerr << "Expected exactly one stats delta spool file." << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<StatsDeltaReader> reader;
+  try {
+    reader.reset(new StatsDeltaReader(argv[1]));
+  } catch (const std::exception& e) {
+    std::cerr << "Can't open " << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+  }
+  if (reader->statNames().empty()) {
+    std::cerr << argv[1] << " doesn't start with a stats delta name table."
+              << std::endl;
+    return 1;
+  }
+
+  uint64_t timestampMs = 0;
+  uint64_t lastTimestampMs = 0;
+  size_t numTicks = 0;
+  std::vector<uint64_t> before;
+  while (true) {
+    if (FLAGS_deltas) {
+      before = reader->values();
+    }
+    if (!reader->nextTick(timestampMs)) {
+      break;
+    }
+    ++numTicks;
+    lastTimestampMs = timestampMs;
+    if (FLAGS_deltas) {
+      size_t changed = 0;
+      for (size_t i = 0; i < before.size(); ++i) {
+        changed += before[i] != reader->values()[i];
+      }
+      std::cout << "tick " << timestampMs << ": " << changed
+                << " counters changed" << std::endl;
+    }
+  }
+
+  LOG(INFO) << argv[1] << ": " << reader->statNames().size() << " stats, "
+            << numTicks << " ticks, last at " << lastTimestampMs;
+
+  for (size_t i = 0; i < reader->statNames().size(); ++i) {
+    std::cout << reader->statNames()[i] << " ";
+    printValue(std::cout, reader->types()[i], reader->values()[i]);
+    std::cout << std::endl;
+  }
+  return 0;
+}